@@ -14,6 +14,97 @@ AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
 AC_MSG_RESULT([$has_64bit_asm])
 ])
 
+dnl
+AC_DEFUN([SECP_X86_64_ADX_ASM_CHECK],[
+AC_MSG_CHECKING(for x86_64 BMI2/ADX assembly and cpuid.h availability)
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <stdint.h>
+  #include <cpuid.h>]],[[
+  unsigned int eax, ebx, ecx, edx;
+  uint64_t a = 11, lo, hi;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  __asm__ __volatile__("mulxq %%rsi, %0, %1; adcxq %0, %1; adoxq %0, %1" : "=&r"(lo), "=&r"(hi) : "d"(a), "S"((uint64_t)ebx) : "cc");
+  ]])],[has_x86_64_adx_asm=yes],[has_x86_64_adx_asm=no])
+AC_MSG_RESULT([$has_x86_64_adx_asm])
+])
+
+dnl
+AC_DEFUN([SECP_ARM64_ASM_CHECK],[
+AC_MSG_CHECKING(for AArch64 assembly availability)
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <stdint.h>]],[[
+  uint64_t a = 11, b = 13, lo, hi;
+  __asm__ __volatile__("mul %0, %2, %3; umulh %1, %2, %3; adds %0, %0, %2; adc %1, %1, xzr" : "=&r"(lo), "=&r"(hi) : "r"(a), "r"(b) : "cc");
+  ]])],[has_arm64_asm=yes],[has_arm64_asm=no])
+AC_MSG_RESULT([$has_arm64_asm])
+])
+
+dnl
+AC_DEFUN([SECP_AVX2_CHECK],[
+AC_MSG_CHECKING(for AVX2 intrinsics availability)
+CFLAGS_TEMP="$CFLAGS"
+CFLAGS="$CFLAGS -mavx2"
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <immintrin.h>]],[[
+  __m256i a = _mm256_set1_epi64x(11);
+  a = _mm256_mul_epu32(a, a);
+  return _mm256_extract_epi64(a, 0) != 121;
+  ]])],[has_avx2=yes],[has_avx2=no])
+CFLAGS="$CFLAGS_TEMP"
+AC_MSG_RESULT([$has_avx2])
+])
+
+dnl
+AC_DEFUN([SECP_NEON_CHECK],[
+AC_MSG_CHECKING(for NEON intrinsics availability)
+CFLAGS_TEMP="$CFLAGS"
+for neon_cflags in "" "-mfpu=neon"; do
+  CFLAGS="$CFLAGS_TEMP $neon_cflags"
+  AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+    #include <arm_neon.h>]],[[
+    uint64x2_t a = vmlal_lane_u32(vdupq_n_u64(1), vdup_n_u32(11), vdup_n_u32(13), 1);
+    return vgetq_lane_u64(vextq_u64(a, a, 1), 0) != 144;
+    ]])],[has_neon=yes],[has_neon=no])
+  if test x"$has_neon" = x"yes"; then
+    break
+  fi
+done
+CFLAGS="$CFLAGS_TEMP"
+AC_MSG_RESULT([$has_neon])
+])
+
+dnl
+AC_DEFUN([SECP_SHANI_CHECK],[
+AC_MSG_CHECKING(for SHA-NI intrinsics availability)
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <immintrin.h>
+  #include <cpuid.h>
+  __attribute__((target("sha,sse4.1"))) static __m128i f(__m128i a, __m128i b, __m128i c) {
+    return _mm_blend_epi16(_mm_sha256rnds2_epu32(a, b, c), _mm_sha256msg2_epu32(_mm_sha256msg1_epu32(a, b), c), 0xF0);
+  }]],[[
+  unsigned int eax, ebx, ecx, edx;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return _mm_cvtsi128_si32(f(_mm_set1_epi32(eax), _mm_set1_epi32(ebx), _mm_set1_epi32(ecx)));
+  ]])],[has_shani=yes],[has_shani=no])
+AC_MSG_RESULT([$has_shani])
+])
+
+dnl
+AC_DEFUN([SECP_ARMV8_SHA2_CHECK],[
+AC_MSG_CHECKING(for ARMv8 SHA2 intrinsics availability)
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <arm_neon.h>
+  #include <sys/auxv.h>
+  #include <asm/hwcap.h>
+  __attribute__((target("+crypto"))) static uint32x4_t f(uint32x4_t a, uint32x4_t b, uint32x4_t c) {
+    return vsha256h2q_u32(vsha256hq_u32(a, b, c), a, vsha256su1q_u32(vsha256su0q_u32(a, b), b, c));
+  }]],[[
+  uint32x4_t a = vdupq_n_u32((uint32_t)(getauxval(AT_HWCAP) & HWCAP_SHA2));
+  return vgetq_lane_u32(f(a, a, a), 0);
+  ]])],[has_armv8_sha2=yes],[has_armv8_sha2=no])
+AC_MSG_RESULT([$has_armv8_sha2])
+])
+
 dnl
 AC_DEFUN([SECP_OPENSSL_CHECK],[
 if test x"$use_pkgconfig" = x"yes"; then
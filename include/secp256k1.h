@@ -55,18 +55,76 @@ typedef struct secp256k1_context_struct secp256k1_context_t;
 # define SECP256K1_CONTEXT_SIGN   (1 << 1)
 # define SECP256K1_CONTEXT_COMMIT (1 << 7)
 # define SECP256K1_CONTEXT_RANGEPROOF (1 << 8)
+/** Build every part of the context not requested by the other flags once, on its first use.
+ *  Thread-safe where the compiler provides __sync builtins. */
+# define SECP256K1_CONTEXT_LAZY (1 << 9)
 
 /** Create a secp256k1 context object.
  *  Returns: a newly created context object.
  *  In:      flags: which parts of the context to initialize.
+ *
+ *  With SECP256K1_CONTEXT_LAZY, functions needing a part that was not initialized build it
+ *  instead of failing. The part is then shared with all clones of the context, before or after
+ *  that point, and built only once even if several threads need it at the same time.
+ *  SECP256K1_CONTEXT_LAZY on its own makes context creation itself cheap.
  */
 secp256k1_context_t* secp256k1_context_create(
   int flags
 ) SECP256K1_WARN_UNUSED_RESULT;
 
+/** Create a secp256k1 context object with verification tables of a chosen size.
+ *  Returns: a newly created context object.
+ *  In:      flags:         which parts of the context to initialize.
+ *           ecmult_window: window size of the tables used for verification, in range [2..24],
+ *                          or 0 for the default (see --with-ecmult-window). The tables take
+ *                          2^(ecmult_window-2) * 64 bytes, twice that with the endomorphism
+ *                          optimization. Larger windows make verification faster.
+ *
+ *  With static precomputation, windows beyond the one the tables were generated for are
+ *  reduced to it.
+ */
+secp256k1_context_t* secp256k1_context_create_window(
+  int flags,
+  int ecmult_window
+) SECP256K1_WARN_UNUSED_RESULT;
+
+/** A function that allocates size bytes, aligned for any type, for secp256k1_context_create_with_allocator.
+ *  userdata is the pointer passed there. Returning NULL aborts the process, as a failed malloc does. */
+typedef void* (*secp256k1_alloc_function_t)(size_t size, void *userdata);
+
+/** A function that releases memory returned by the matching secp256k1_alloc_function_t, which is passed
+ *  the size that was requested. */
+typedef void (*secp256k1_free_function_t)(void *ptr, size_t size, void *userdata);
+
+/** Create a secp256k1 context object whose precomputed tables are allocated with alloc_fn.
+ *  Returns: a newly created context object.
+ *  In:      flags:    which parts of the context to initialize, as for secp256k1_context_create.
+ *           alloc_fn: allocates the tables (cannot be NULL).
+ *           free_fn:  releases them (cannot be NULL).
+ *           userdata: passed to both functions.
+ *
+ *  This allows the tables (up to a few megabytes, read at random offsets) to be put on huge pages, or
+ *  on the NUMA node of the threads that will use them. The memory should be aligned to 64 bytes, which
+ *  the tables of other contexts are, so that every table entry lies within a single cache line. Tables
+ *  built later by a context created with SECP256K1_CONTEXT_LAZY, or by its clones, are allocated the
+ *  same way, so alloc_fn and free_fn may be called from any thread that uses these contexts. The tables
+ *  are released with free_fn when the last of them is destroyed. Small bookkeeping structures still
+ *  come from malloc, and with static precomputation there are no tables to allocate.
+ */
+secp256k1_context_t* secp256k1_context_create_with_allocator(
+  int flags,
+  secp256k1_alloc_function_t alloc_fn,
+  secp256k1_free_function_t free_fn,
+  void *userdata
+) SECP256K1_WARN_UNUSED_RESULT SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
 /** Copies a secp256k1 context object.
  *  Returns: a newly created context object.
  *  In:      ctx: an existing context to copy
+ *
+ *  The precomputed tables are not copied but shared (read-only) with ctx, so a clone only
+ *  costs a few hundred bytes. The clone has its own copy of the blinding state, and can be
+ *  randomized and destroyed independently of ctx.
  */
 secp256k1_context_t* secp256k1_context_clone(
   const secp256k1_context_t* ctx
@@ -79,6 +137,78 @@ void secp256k1_context_destroy(
   secp256k1_context_t* ctx
 ) SECP256K1_ARG_NONNULL(1);
 
+/** Help build parts of a context created with SECP256K1_CONTEXT_LAZY ahead of their first use.
+ *  In:      ctx:   a context created with SECP256K1_CONTEXT_LAZY, or a clone of one; for any other
+ *                  context this does nothing.
+ *           flags: which parts to build (SECP256K1_CONTEXT_VERIFY, _SIGN, _COMMIT and _RANGEPROOF).
+ *
+ *  The verification and range proof tables are computed in independent segments (of 1024 entries
+ *  and of one power of ten respectively), which every thread calling this, secp256k1_context_wait_built
+ *  or a function that needs the tables claims one at a time. This returns as soon as no segment is left
+ *  to claim, possibly while other threads still compute theirs. Calling it from background threads lets
+ *  the tables be built in parallel with each other, and with other initialization work.
+ */
+void secp256k1_context_build_work(
+  const secp256k1_context_t* ctx,
+  int flags
+) SECP256K1_ARG_NONNULL(1);
+
+/** Wait until parts of a context are built, helping to build them if they are not.
+ *  Returns: 1 if all parts selected by flags are built, 0 if some are not (which only happens for
+ *           contexts not created with SECP256K1_CONTEXT_LAZY).
+ *  In:      ctx:   an existing context object
+ *           flags: which parts to wait for, as for secp256k1_context_build_work.
+ *
+ *  Functions that need a part of a lazy context do this implicitly; calling it explicitly moves the
+ *  wait to a point of the caller's choosing.
+ */
+int secp256k1_context_wait_built(
+  const secp256k1_context_t* ctx,
+  int flags
+) SECP256K1_ARG_NONNULL(1);
+
+/** Serialize the precomputed tables of a context, for secp256k1_context_create_from_buffer.
+ *  Returns: 1 if the tables were written (or output is NULL), 0 if *outputlen was too small.
+ *  In:      ctx:       a secp256k1 context object
+ *  Out:     output:    a pointer to an array of at least *outputlen bytes, or NULL to only
+ *                      compute the size
+ *  In/Out:  outputlen: the size of output; set to the size of the serialization (even if 0
+ *                      was returned)
+ *
+ *  Only the tables ctx has built are written (for a lazy context, those built so far). The
+ *  blinding state is not. The format is versioned and checksummed, and it depends on the build
+ *  configuration, so it can only be loaded by a library built the same way on a platform
+ *  with the same byte order.
+ */
+int secp256k1_context_serialize(
+  const secp256k1_context_t* ctx,
+  unsigned char *output,
+  size_t *outputlen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(3);
+
+/** Create a secp256k1 context object using the tables in a serialized context.
+ *  Returns: a newly created context object, or NULL if input is not a valid serialization
+ *           from a library with the same configuration.
+ *  In:      input:    a serialization created by secp256k1_context_serialize, aligned to at
+ *                     least 8 bytes (as malloc and mmap results are); with 64 bytes (as mmap
+ *                     results are), every table entry lies within a single cache line
+ *           inputlen: the length of input
+ *           flags:    which parts of the context to initialize, as for secp256k1_context_create
+ *
+ *  The tables are used in place rather than copied, so input can be a read-only mmap of a file
+ *  shared by many processes. It must stay valid and unchanged until the returned context and
+ *  all of its clones are destroyed. The checksum is verified, but the points are not, so input
+ *  must come from a trusted source. Parts requested by flags that input does not contain are
+ *  built as secp256k1_context_create would (with the window of input's verification tables, if
+ *  any), and SECP256K1_CONTEXT_LAZY works as usual. The context starts with the default
+ *  blinding; use secp256k1_context_randomize as with any other context.
+ */
+secp256k1_context_t* secp256k1_context_create_from_buffer(
+  const unsigned char *input,
+  size_t inputlen,
+  int flags
+) SECP256K1_WARN_UNUSED_RESULT SECP256K1_ARG_NONNULL(1);
+
 /** Verify an ECDSA signature.
  *  Returns: 1: correct signature
  *           0: incorrect signature
@@ -380,6 +510,26 @@ SECP256K1_WARN_UNUSED_RESULT int secp256k1_pedersen_commit(
   uint64_t value
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
 
+/** Generate many pedersen commitments at once.
+ *  Returns 1: all commitments successfully created.
+ *          0: error for at least one of them (those commitments are zeroed)
+ *  In:     ctx:        pointer to a context object, initialized for signing and commitment (cannot be NULL)
+ *          blinds:     pointer to n pointers to 32-byte blinding factors (cannot be NULL if n is non-zero)
+ *          values:     pointer to n unsigned 64-bit integer values to commit to (cannot be NULL if n is non-zero)
+ *          n:          number of commitments to create.
+ *  Out:    commits:    pointer to n pointers to 33-byte arrays for the commitments (cannot be NULL if n is non-zero)
+ *
+ *  The results are the same as those of n secp256k1_pedersen_commit calls, but the conversion of all of
+ *  them to affine coordinates shares a single field inversion.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_pedersen_commit_batch(
+  const secp256k1_context_t* ctx,
+  unsigned char * const *commits,
+  const unsigned char * const *blinds,
+  const uint64_t *values,
+  size_t n
+) SECP256K1_ARG_NONNULL(1);
+
 /** Computes the sum of multiple positive and negative blinding factors.
  *  Returns 1: sum successfully computed.
  *          0: error
@@ -397,6 +547,27 @@ SECP256K1_WARN_UNUSED_RESULT int secp256k1_pedersen_blind_sum(
   int npositive
 )SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
 
+/** Computes the sum of blinding factors from one contiguous buffer, each with its own sign.
+ *  Returns 1: sum successfully computed.
+ *          0: error (a blinding factor is not below the group order)
+ *  In:     ctx:        pointer to a context object (cannot be NULL)
+ *          blinds:     pointer to n consecutive 32-byte blinding factors (cannot be NULL if n is non-zero)
+ *          n:          number of factors in blinds.
+ *          negative:   bitmap of (n + 7) / 8 bytes; bit (i & 7) of byte i / 8 is set if factor i is subtracted
+ *                      rather than added. If NULL, all factors are added.
+ *  Out:    blind_out:  pointer to a 32-byte array for the sum (cannot be NULL)
+ *
+ *  This gives the same result as secp256k1_pedersen_blind_sum, but reduces the sum modulo the group order only
+ *  once, at the end, which makes it cheaper for thousands of factors.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_pedersen_blind_sum_batch(
+  const secp256k1_context_t* ctx,
+  unsigned char *blind_out,
+  const unsigned char *blinds,
+  size_t n,
+  const unsigned char *negative
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
 /** Verify a tally of pedersen commitments
  * Returns 1: commitments successfully sum to zero.
  *         0: Commitments do not sum to zero or other error.
@@ -527,6 +698,37 @@ SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_info(
  int plen
 )SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
 
+/** Largest number of bytes the header of a range-proof can take. */
+#define SECP256K1_RANGEPROOF_HEADER_MAX_SIZE 10
+
+/** Read the header of a range-proof from its first bytes, without needing the rest of the proof.
+ *  Returns 1: Header successfully decoded.
+ *          0: The header is malformed, or longer than len bytes. Having the first
+ *             SECP256K1_RANGEPROOF_HEADER_MAX_SIZE bytes of a proof is always enough to decide.
+ *  In:   ctx: pointer to a context object
+ *        proof: pointer to character array with the start of the proof.
+ *        len: number of bytes available at proof.
+ *  Out:  exp: Exponent used in the proof (-1 means the value isn't private).
+ *        mantissa: Number of bits covered by the proof.
+ *        min_value: pointer to an unsigned int64 which will be updated with the minimum value that commit could have. (cannot be NULL)
+ *        max_value: pointer to an unsigned int64 which will be updated with the maximum value that commit could have. (cannot be NULL)
+ *        plen: pointer to an integer which will be updated with the length the whole proof must have; proofs of any other length
+ *              fail to verify. (cannot be NULL)
+ *
+ *  This does no allocation and no elliptic curve operations, so it can be used to reject malformed or
+ *  oversized proofs before receiving them fully.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_peek(
+ const secp256k1_context_t* ctx,
+ int *exp,
+ int *mantissa,
+ uint64_t *min_value,
+ uint64_t *max_value,
+ int *plen,
+ const unsigned char *proof,
+ int len
+)SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5) SECP256K1_ARG_NONNULL(6) SECP256K1_ARG_NONNULL(7);
+
 /*************************************** ex *****************************/
 
 typedef secp256k1_context_t secp256k1_context;
@@ -619,6 +821,25 @@ int secp256k1_ec_pubkey_create_ex(
     const unsigned char *seckey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
 
+/** Compute the public keys for many secret keys at once.
+ *
+ *  Returns: 1 if all secret keys were valid, 0 otherwise.
+ *  Args:   ctx:     pointer to a context object, initialized for signing (cannot be NULL)
+ *  Out:    pubkeys: array of n public key objects. pubkeys[i] is set to the public key of seckeys[i] if
+ *                   that is valid, and zeroed otherwise.
+ *  In:     seckeys: array of n pointers to 32-byte secret keys.
+ *          n:       number of keys.
+ *
+ *  The results are the same as those of secp256k1_ec_pubkey_create_ex on every key, but the
+ *  conversion of all of them to affine coordinates shares a single field inversion.
+ */
+int secp256k1_ec_pubkey_create_batch(
+    const secp256k1_context* ctx,
+    secp256k1_pubkey *pubkeys,
+    const unsigned char * const *seckeys,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
 
 /** Create an ECDSA signature.
  *
@@ -643,6 +864,96 @@ int secp256k1_ecdsa_sign_ex(
     const void *ndata
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/** Create ECDSA signatures for many messages at once.
+ *
+ *  Returns: 1 if all signatures were created, 0 otherwise.
+ *  Args:    ctx:     pointer to a context object, initialized for signing (cannot be NULL)
+ *  Out:     sigs:    array of n signature objects. sigs[i] is set to the signature of msgs32[i] with
+ *                    seckeys[i] if that succeeded, and zeroed otherwise.
+ *           valid:   array of n ints, set to 1 for every created signature and 0 for every failure (can be NULL).
+ *  In:      msgs32:  array of n pointers to the 32-byte message hashes being signed.
+ *           seckeys: array of n pointers to 32-byte secret keys.
+ *           n:       number of signatures.
+ *
+ *  The results are the same as those of secp256k1_ecdsa_sign_ex with the default nonce function on
+ *  every entry, but per 32 signatures the R points share a single field inversion and the nonces a
+ *  single (blinded) scalar inversion. Like secp256k1_ecdsa_sign_ex, it is constant time in the
+ *  secret keys and nonces.
+ */
+int secp256k1_ecdsa_sign_batch(
+    const secp256k1_context* ctx,
+    secp256k1_ecdsa_signature *sigs,
+    int *valid,
+    const unsigned char * const *msgs32,
+    const unsigned char * const *seckeys,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
+/** Opaque data structure that holds a secret key together with everything derived from it that
+ *  signing can reuse: the parsed scalar, the public key and the key-dependent part of the RFC6979
+ *  nonce derivation.
+ *
+ *  The exact representation of data inside is implementation defined and not
+ *  guaranteed to be portable between different platforms or versions. It is
+ *  however guaranteed to be 128 bytes in size, and can be safely copied/moved.
+ *  It contains the secret key, so it should be cleared after use like one.
+ */
+typedef struct {
+    unsigned char data[128];
+} secp256k1_keypair;
+
+/** Compute a keypair for a secret key.
+ *
+ *  Returns: 1: secret was valid, keypair ready to use
+ *           0: secret was invalid, try again (keypair is zeroed)
+ *  Args:   ctx:     pointer to a context object, initialized for signing (cannot be NULL)
+ *  Out:    keypair: pointer to the created keypair (cannot be NULL)
+ *  In:     seckey:  pointer to a 32-byte secret key (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_keypair_create(
+    const secp256k1_context* ctx,
+    secp256k1_keypair *keypair,
+    const unsigned char *seckey
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Get the public key of a keypair.
+ *
+ *  Returns: 1
+ *  Args:   ctx:     a secp256k1 context object
+ *  Out:    pubkey:  pointer to the public key, equal to what secp256k1_ec_pubkey_create_ex returns
+ *                   for the secret key (cannot be NULL)
+ *  In:     keypair: pointer to a keypair created by secp256k1_keypair_create (cannot be NULL)
+ */
+int secp256k1_keypair_pub(
+    const secp256k1_context* ctx,
+    secp256k1_pubkey *pubkey,
+    const secp256k1_keypair *keypair
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Create an ECDSA signature with a keypair.
+ *
+ *  Returns: 1: signature created
+ *           0: the nonce generation function failed, or the keypair was invalid.
+ *  Args:    ctx:     pointer to a context object, initialized for signing (cannot be NULL)
+ *  Out:     sig:     pointer to an array where the signature will be placed (cannot be NULL)
+ *  In:      msg32:   the 32-byte message hash being signed (cannot be NULL)
+ *           keypair: pointer to a keypair created by secp256k1_keypair_create (cannot be NULL)
+ *           noncefp: pointer to a nonce generation function. If NULL, secp256k1_nonce_function_default is used
+ *           ndata:   pointer to arbitrary data used by the nonce generation function (can be NULL)
+ *
+ *  The signature is identical to the one secp256k1_ecdsa_sign_ex creates for the same secret key,
+ *  but the key is not parsed again, and with the RFC6979 nonce function the part of the nonce
+ *  derivation that only depends on the key is not repeated.
+ */
+int secp256k1_ecdsa_sign_keypair(
+    const secp256k1_context* ctx,
+    secp256k1_ecdsa_signature *sig,
+    const unsigned char *msg32,
+    const secp256k1_keypair *keypair,
+    secp256k1_nonce_function noncefp,
+    const void *ndata
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
 /** Parse a variable-length public key into the pubkey object.
  *
  *  Returns: 1 if the public key was fully valid.
@@ -664,6 +975,28 @@ int secp256k1_ec_pubkey_parse(
     size_t inputlen
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
 
+/** Parse many compressed public keys at once.
+ *
+ *  Returns: 1 if all public keys were fully valid.
+ *           0 if any of them could not be parsed or is invalid.
+ *  Args: ctx:     a secp256k1 context object.
+ *  Out:  pubkeys: array of n pubkey objects. pubkeys[i] is set to the parsed version of inputs[i] if
+ *                 that is valid, and zeroed otherwise.
+ *        valid:   array of n ints, set to 1 for every valid input and 0 for every invalid one (can be NULL).
+ *  In:   inputs:  array of n pointers to 33-byte compressed public keys (header byte 0x02 or 0x03).
+ *        n:       number of public keys.
+ *
+ *  The results are the same as those of secp256k1_ec_pubkey_parse on every input, but the square roots
+ *  of four keys are computed side by side, which is faster with the avx2 field implementation.
+ */
+int secp256k1_ec_pubkey_parse_batch(
+    const secp256k1_context* ctx,
+    secp256k1_pubkey* pubkeys,
+    int *valid,
+    const unsigned char * const *inputs,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
 
 /** Serialize a pubkey object into a serialized byte sequence.
  *
@@ -690,6 +1023,71 @@ int secp256k1_ec_pubkey_serialize(
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
 
+/** Parse a DER ECDSA signature.
+ *
+ *  Returns: 1 when the signature could be parsed, 0 otherwise.
+ *  Args: ctx:      a secp256k1 context object
+ *  Out:  sig:      a pointer to a signature object, set to the parsed signature, or zeroed on failure
+ *  In:   input:    a pointer to the signature to be parsed
+ *        inputlen: the length of the array pointed to by input
+ *
+ *  This accepts the same encodings as secp256k1_ecdsa_verify does. High-S signatures are parsed as
+ *  they are; apply secp256k1_ecdsa_signature_normalize to verify them with secp256k1_ecdsa_verify_ex.
+ */
+int secp256k1_ecdsa_signature_parse_der(
+    const secp256k1_context* ctx,
+    secp256k1_ecdsa_signature* sig,
+    const unsigned char *input,
+    size_t inputlen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Parse an ECDSA signature in "lax DER" format, as found in historical blockchain data.
+ *
+ *  Returns: 1 when the signature could be parsed, 0 otherwise.
+ *  Args: ctx:      a secp256k1 context object
+ *  Out:  sig:      a pointer to a signature object, set to the parsed signature, or zeroed on failure
+ *  In:   input:    a pointer to the signature to be parsed
+ *        inputlen: the length of the array pointed to by input
+ *
+ *  Everything secp256k1_ecdsa_signature_parse_der accepts is parsed the same way. In addition this
+ *  accepts the violations listed in contrib/lax_der_parsing.h (zero-length and overly padded
+ *  integers, long-form lengths, an ignored sequence length and trailing data). Like
+ *  ecdsa_signature_parse_der_lax there, an integer that does not fit is not a parse failure, but
+ *  results in a zero signature, which never verifies. Do not use this for new systems.
+ */
+int secp256k1_ecdsa_signature_parse_der_lax(
+    const secp256k1_context* ctx,
+    secp256k1_ecdsa_signature* sig,
+    const unsigned char *input,
+    size_t inputlen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Parse many DER ECDSA signatures located in one buffer.
+ *
+ *  Returns: 1 if all signatures could be parsed, 0 otherwise.
+ *  Args: ctx:     a secp256k1 context object
+ *  Out:  sigs:    array of n signature objects, set to the parsed signatures, or zeroed on failure
+ *        valid:   array of n ints, set to 1 for every parsed signature and 0 for every failure (can be NULL).
+ *  In:   input:   the buffer containing the signatures, for example a memory-mapped block file
+ *        offsets: array of n offsets into input at which the signatures start
+ *        lens:    array of n lengths of the signatures
+ *        n:       number of signatures
+ *        lax:     0 to parse like secp256k1_ecdsa_signature_parse_der, 1 to parse like
+ *                 secp256k1_ecdsa_signature_parse_der_lax
+ *
+ *  The signatures are read in place; there is no need to copy them out of the buffer first.
+ */
+int secp256k1_ecdsa_signature_parse_der_batch(
+    const secp256k1_context* ctx,
+    secp256k1_ecdsa_signature *sigs,
+    int *valid,
+    const unsigned char *input,
+    const size_t *offsets,
+    const size_t *lens,
+    size_t n,
+    int lax
+) SECP256K1_ARG_NONNULL(1);
+
 /** Serialize an ECDSA signature in DER format.
  *
  *  Returns: 1 if enough space was available to serialize, 0 otherwise
@@ -782,6 +1180,174 @@ int secp256k1_ecdsa_verify_ex(
     const secp256k1_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/** Verify a batch of ECDSA signatures.
+ *
+ *  Returns: 1: all signatures are correct
+ *           0: at least one signature is incorrect or unparseable
+ *  Args:    ctx:           a secp256k1 context object, initialized for verification.
+ *  Out:     first_invalid: if not NULL, set to the index of the first incorrect signature,
+ *                          or to n if all of them are correct.
+ *  In:      sigs:          pointer to n pointers to signatures (cannot be NULL if n is non-zero)
+ *           msgs32:        pointer to n pointers to 32-byte message hashes (cannot be NULL if n is non-zero)
+ *           pubkeys:       pointer to n pointers to initialized public keys (cannot be NULL if n is non-zero)
+ *           n:             number of signatures to verify.
+ *
+ * The result is the same as calling secp256k1_ecdsa_verify_ex on every entry in turn, and stopping
+ * at the first failure, but the work that is independent of the individual points is shared. In
+ * particular only lower-S signatures are accepted.
+ */
+int secp256k1_ecdsa_verify_batch(
+    const secp256k1_context* ctx,
+    size_t *first_invalid,
+    const secp256k1_ecdsa_signature * const *sigs,
+    const unsigned char * const *msgs32,
+    const secp256k1_pubkey * const *pubkeys,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
+/** Opaque data structure that holds precomputed multiples of a public key, for verifying many
+ *  signatures against it.
+ *
+ *  secp256k1_ecdsa_verify_ex computes a small table of multiples of the public key for every
+ *  signature. This object holds a wider one, computed once, which makes the multiplication by
+ *  the public key's part cheaper as well. It takes 16 KiB (32 KiB with the endomorphism
+ *  optimization) and is not modified by secp256k1_ecdsa_verify_precomp, so it may be shared
+ *  between threads.
+ */
+typedef struct secp256k1_pubkey_precomp_struct secp256k1_pubkey_precomp;
+
+/** Precompute the multiples of a public key for secp256k1_ecdsa_verify_precomp.
+ *
+ *  Returns: a newly created precomputation object, or NULL if pubkey is invalid.
+ *  Args:   ctx:    a secp256k1 context object (cannot be NULL)
+ *  In:     pubkey: the public key to precompute for (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT secp256k1_pubkey_precomp* secp256k1_pubkey_precomp_create(
+    const secp256k1_context* ctx,
+    const secp256k1_pubkey *pubkey
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Destroy a public key precomputation object.
+ *
+ *  The pointer may not be used afterwards.
+ *  Args:   precomp: object to destroy (can be NULL)
+ */
+void secp256k1_pubkey_precomp_destroy(
+    secp256k1_pubkey_precomp* precomp
+);
+
+/** Verify an ECDSA signature against a precomputed public key.
+ *
+ *  Returns: 1: correct signature
+ *           0: incorrect or unparseable signature
+ *  Args:    ctx:     a secp256k1 context object, initialized for verification.
+ *  In:      sig:     the signature being verified (cannot be NULL)
+ *           msg32:   the 32-byte message hash being verified (cannot be NULL)
+ *           precomp: the precomputation object of the public key to verify with (cannot be NULL)
+ *
+ * The result is the same as that of secp256k1_ecdsa_verify_ex with the public key the
+ * precomputation object was created for; in particular only lower-S signatures are accepted.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_verify_precomp(
+    const secp256k1_context* ctx,
+    const secp256k1_ecdsa_signature *sig,
+    const unsigned char *msg32,
+    const secp256k1_pubkey_precomp *precomp
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
+/** Opaque data structure that holds a cache of signatures that were found to be valid.
+ *
+ *  The cache has a fixed number of entries, each the salted SHA256 of a (signature, message,
+ *  public key) triple, stored in a cuckoo hash table of 36-byte slots. When it is full, adding
+ *  an entry evicts another one. Any number of threads may use a cache at the same time: lookups
+ *  and insertions take no locks, and an insertion that runs into another one drops its entry
+ *  instead of waiting. On compilers without atomic builtins (see HAVE_BUILTIN_SYNC) only one
+ *  thread may use a cache at a time.
+ */
+typedef struct secp256k1_sigcache_struct secp256k1_sigcache;
+
+/** Create a signature cache.
+ *
+ *  Returns: a newly created cache, or NULL if max_entries is 0 or too large.
+ *  Args:   ctx:         a secp256k1 context object (cannot be NULL)
+ *  In:     max_entries: the number of entries the cache can hold (less than 2^32)
+ *          seed32:      32 bytes of secret randomness to salt the hashes with, so that nobody can
+ *                       choose signatures that evict each other (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT secp256k1_sigcache* secp256k1_sigcache_create(
+    const secp256k1_context* ctx,
+    size_t max_entries,
+    const unsigned char *seed32
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(3);
+
+/** Destroy a signature cache.
+ *
+ *  The pointer may not be used afterwards, and no other thread may still be using the cache.
+ *  Args:   cache: cache to destroy (can be NULL)
+ */
+void secp256k1_sigcache_destroy(
+    secp256k1_sigcache* cache
+);
+
+/** Get the number of lookups that were answered from a cache, and of those that were not.
+ *
+ *  Args:   cache:  an existing cache (cannot be NULL)
+ *  Out:    hits:   number of secp256k1_ecdsa_verify_cached calls that found their entry (can be NULL)
+ *          misses: number of secp256k1_ecdsa_verify_cached calls that verified the signature (can be NULL)
+ */
+void secp256k1_sigcache_get_stats(
+    const secp256k1_sigcache* cache,
+    size_t *hits,
+    size_t *misses
+) SECP256K1_ARG_NONNULL(1);
+
+/** Verify an ECDSA signature, using a cache of earlier results.
+ *
+ *  Returns: 1: correct signature
+ *           0: incorrect or unparseable signature
+ *  Args:    ctx:    a secp256k1 context object, initialized for verification.
+ *  In/Out:  cache:  the signature cache to look up the signature in, and to add it to if it is
+ *                   valid and was not found (cannot be NULL)
+ *  In:      sig, msg32, pubkey: as for secp256k1_ecdsa_verify_ex (cannot be NULL)
+ *
+ * The result is the same as that of secp256k1_ecdsa_verify_ex. Signatures that are found only
+ * cost the hash of their entry; all others are verified. Invalid signatures are never added.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_verify_cached(
+    const secp256k1_context* ctx,
+    secp256k1_sigcache *cache,
+    const secp256k1_ecdsa_signature *sig,
+    const unsigned char *msg32,
+    const secp256k1_pubkey *pubkey
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
+/** Recover the public keys of many compact signatures (64 bytes + recovery id) at once.
+ *
+ *  Returns: 1 if all public keys were recovered.
+ *           0 if any of the signatures could not be parsed or recovered.
+ *  Args: ctx:     a secp256k1 context object, initialized for verification.
+ *  Out:  pubkeys: array of n pubkey objects. pubkeys[i] is set to the key recovered from sigs64[i]
+ *                 if that succeeded, and zeroed otherwise.
+ *        valid:   array of n ints, set to 1 for every recovered key and 0 for every failure (can be NULL).
+ *  In:   sigs64:  array of n pointers to 64-byte compact signatures.
+ *        recids:  array of n recovery ids (0-3, as returned by ecdsa_sign_compact).
+ *        msgs32:  array of n pointers to the 32-byte message hashes that were signed.
+ *        n:       number of signatures.
+ *
+ *  The results are the same as those of secp256k1_ecdsa_recover_compact on every entry, but the
+ *  inversions of the r values and of the resulting points are shared between up to 32 signatures,
+ *  and the R points are decompressed four at a time.
+ */
+int secp256k1_ecdsa_recover_batch(
+    const secp256k1_context* ctx,
+    secp256k1_pubkey *pubkeys,
+    int *valid,
+    const unsigned char * const *sigs64,
+    const int *recids,
+    const unsigned char * const *msgs32,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
 /** Tweak a public key by adding tweak times the generator to it.
  * Returns: 0 if the tweak was out of range (chance of around 1 in 2^128 for
  *          uniformly random 32-byte arrays, or if the resulting public key
@@ -798,6 +1364,697 @@ int secp256k1_ec_pubkey_tweak_add_ex(
     const unsigned char *tweak
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
 
+/** Tweak many public keys, like secp256k1_ec_pubkey_tweak_add_ex on each of them.
+ *
+ *  Returns: 1 if every public key was tweaked, 0 if any tweak was out of range or any result would
+ *           be invalid (those public keys are zeroed; the others are still tweaked).
+ *  Args:    ctx:     pointer to a context object, initialized for signing (cannot be NULL)
+ *  In/Out:  pubkeys: array of n public key objects (cannot be NULL if n is non-zero)
+ *  In:      tweaks:  array of n pointers to 32-byte tweaks (cannot be NULL if n is non-zero)
+ *           n:       number of public keys.
+ *
+ *  This is meant for deriving many child public keys, so it needs the signing tables: each tweak
+ *  times the generator is computed with them, which is much cheaper than the double multiplication
+ *  secp256k1_ec_pubkey_tweak_add_ex does, and the results are converted to affine coordinates
+ *  together with a single field inversion.
+ */
+int secp256k1_ec_pubkey_tweak_add_batch(
+    const secp256k1_context* ctx,
+    secp256k1_pubkey *pubkeys,
+    const unsigned char * const *tweaks,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
+/** Opaque data structure that holds a precomputed table for multiplying a fixed point.
+ *
+ *  The table is the same as the one a context initialized for signing uses for the generator,
+ *  so that multiplying the point costs about as much as computing a public key, in constant time.
+ *  It takes 64 KiB, and a few hundred microseconds to compute. It is not modified by
+ *  secp256k1_point_precomp_multiply, so it may be shared between threads.
+ */
+typedef struct secp256k1_point_precomp_struct secp256k1_point_precomp;
+
+/** Precompute a table for multiplying point.
+ *
+ *  Returns: a newly created precomputation object, or NULL if point is invalid.
+ *  Args:   ctx:    a secp256k1 context object (cannot be NULL)
+ *  In:     point:  the point to multiply (cannot be NULL)
+ *          seed32: 32-byte random seed to blind the multiplications with, as in
+ *                  secp256k1_context_randomize (can be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT secp256k1_point_precomp* secp256k1_point_precomp_create(
+    const secp256k1_context* ctx,
+    const secp256k1_pubkey *point,
+    const unsigned char *seed32
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Destroy a precomputation object.
+ *
+ *  The pointer may not be used afterwards.
+ *  Args:   precomp: object to destroy (can be NULL)
+ */
+void secp256k1_point_precomp_destroy(
+    secp256k1_point_precomp* precomp
+);
+
+/** Multiply the point of a precomputation object by a scalar, in constant time.
+ *
+ *  Returns: 0 if the scalar was out of range or zero, 1 otherwise.
+ *  Args:   ctx:     a secp256k1 context object (cannot be NULL)
+ *  Out:    result:  pointer to a public key object for scalar times the point (zeroed on failure)
+ *  In:     precomp: the precomputation object for the point (cannot be NULL)
+ *          scalar:  pointer to a 32-byte scalar (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_point_precomp_multiply(
+    const secp256k1_context* ctx,
+    secp256k1_pubkey *result,
+    const secp256k1_point_precomp *precomp,
+    const unsigned char *scalar
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
+/** Compute an EC Diffie-Hellman secret in constant time.
+ *
+ *  Returns: 1 if the secret was computed, 0 if scalar was out of range or zero.
+ *  Args:   ctx:    a secp256k1 context object (cannot be NULL)
+ *  Out:    result: a 32-byte array which will be set to the SHA256 of the compressed
+ *                  serialization of scalar times point (cannot be NULL)
+ *  In:     point:  pointer to a public key object (cannot be NULL)
+ *          scalar: a 32-byte scalar with which to multiply the point (cannot be NULL)
+ *
+ *  Unlike secp256k1_point_multiply, the point is taken in parsed form and the shared point
+ *  is hashed internally, so that no serialization round-trip is needed.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdh(
+    const secp256k1_context* ctx,
+    unsigned char *result,
+    const secp256k1_pubkey *point,
+    const unsigned char *scalar
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
+/** Compute the EC Diffie-Hellman secrets of one secret key with many public keys.
+ *
+ *  Returns: 1 if the secrets were computed, 0 if scalar was out of range or zero.
+ *  Args:   ctx:     a secp256k1 context object (cannot be NULL)
+ *  Out:    results: an array of 32*n bytes; bytes 32*i..32*i+31 are set to the result of
+ *                   secp256k1_ecdh for points[i]
+ *  In:     points:  array of n pointers to public key objects
+ *          n:       number of public keys
+ *          scalar:  a 32-byte scalar with which to multiply every point (cannot be NULL)
+ *
+ *  The scalar is recoded once, and the points are processed in groups of 16 whose final
+ *  conversions to affine coordinates share a single inversion.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdh_batch(
+    const secp256k1_context* ctx,
+    unsigned char *results,
+    const secp256k1_pubkey * const *points,
+    size_t n,
+    const unsigned char *scalar
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(5);
+
+/** Opaque data structure that holds a parsed Pedersen commitment.
+ *
+ *  The exact representation of data inside is implementation defined and not
+ *  guaranteed to be portable between different platforms or versions. It is
+ *  however guaranteed to be 64 bytes in size, and can be safely copied/moved.
+ *  If you need to convert to a format suitable for storage or transmission, use
+ *  secp256k1_pedersen_commitment_serialize and secp256k1_pedersen_commitment_parse.
+ */
+typedef struct {
+    unsigned char data[64];
+} secp256k1_pedersen_commitment;
+
+/** Parse a 33-byte serialized Pedersen commitment into a commitment object.
+ *
+ *  Returns: 1 if the commitment was fully valid.
+ *           0 if the commitment could not be parsed or is invalid.
+ *  Args: ctx:    a secp256k1 context object.
+ *  Out:  commit: pointer to a commitment object. If 1 is returned, it is set to a
+ *                parsed version of input. If not, it is zeroed.
+ *  In:   input:  pointer to a 33-byte serialized commitment.
+ */
+int secp256k1_pedersen_commitment_parse(
+    const secp256k1_context* ctx,
+    secp256k1_pedersen_commitment* commit,
+    const unsigned char *input
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Serialize a commitment object into the 33-byte format taken by the other Pedersen functions.
+ *
+ *  Returns: 1 always.
+ *  Args:   ctx:    a secp256k1 context object.
+ *  Out:    output: a pointer to a 33-byte array to place the serialized commitment in.
+ *  In:     commit: a pointer to an initialized commitment object.
+ */
+int secp256k1_pedersen_commitment_serialize(
+    const secp256k1_context* ctx,
+    unsigned char *output,
+    const secp256k1_pedersen_commitment* commit
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Verify a tally of parsed Pedersen commitments, like secp256k1_pedersen_verify_tally.
+ *  Returns 1: commitments successfully sum to zero.
+ *          0: Commitments do not sum to zero or other error.
+ *  Args:   ctx:      pointer to a context object, initialized for commitment (cannot be NULL)
+ *  In:     commits:  pointer to pointers to parsed commitments. (cannot be NULL if pcnt is non-zero)
+ *          pcnt:     number of commitments pointed to by commits.
+ *          ncommits: pointer to pointers to parsed negative commitments. (cannot be NULL if ncnt is non-zero)
+ *          ncnt:     number of commitments pointed to by ncommits.
+ *          excess:   signed 64bit amount to add to the total to bring it to zero, can be negative.
+ *
+ *  As the commitments need no decompression, and are summed in affine coordinates with the field
+ *  inversions shared between many additions, this is several times faster for large tallies.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_pedersen_verify_tally_ex(
+    const secp256k1_context* ctx,
+    const secp256k1_pedersen_commitment * const *commits,
+    size_t pcnt,
+    const secp256k1_pedersen_commitment * const *ncommits,
+    size_t ncnt,
+    int64_t excess
+) SECP256K1_ARG_NONNULL(1);
+
+/** Generate a Pedersen commitment, like secp256k1_pedersen_commit, as a commitment object.
+ *  Returns 1: commitment successfully created.
+ *          0: error (the commitment is zeroed)
+ *  Args:   ctx:    pointer to a context object, initialized for signing and commitment (cannot be NULL)
+ *  Out:    commit: pointer to the commitment object to set (cannot be NULL)
+ *  In:     blind:  pointer to a 32-byte blinding factor (cannot be NULL)
+ *          value:  unsigned 64-bit integer value to commit to.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_pedersen_commit_ex(
+    const secp256k1_context* ctx,
+    secp256k1_pedersen_commitment *commit,
+    const unsigned char *blind,
+    uint64_t value
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Verify a range proof for a parsed commitment, like secp256k1_rangeproof_verify.
+ *  Returns 1: Value is within the range [0..2^64), the specifically proven range is in the min/max value outputs.
+ *          0: Proof failed or other error.
+ *  Args:   ctx:       pointer to a context object, initialized for range-proof and commitment (cannot be NULL)
+ *  Out:    min_value: pointer to a unsigned int64 which will be updated with the minimum value that commit could have. (cannot be NULL)
+ *          max_value: pointer to a unsigned int64 which will be updated with the maximum value that commit could have. (cannot be NULL)
+ *  In:     commit:    the commitment being proved. (cannot be NULL)
+ *          proof:     pointer to character array with the proof. (cannot be NULL)
+ *          plen:      length of proof in bytes.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_verify_ex(
+    const secp256k1_context* ctx,
+    uint64_t *min_value,
+    uint64_t *max_value,
+    const secp256k1_pedersen_commitment *commit,
+    const unsigned char *proof,
+    int plen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
+/** Verify a range proof for a parsed commitment and rewind it, like secp256k1_rangeproof_rewind.
+ *  Returns 1: Value is within the range [0..2^64), and the proof could be rewound with nonce.
+ *          0: Proof failed, rewind failed, or other error.
+ *  All arguments are as for secp256k1_rangeproof_rewind, except that commit is a commitment object.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_rewind_ex(
+    const secp256k1_context* ctx,
+    unsigned char *blind_out,
+    uint64_t *value_out,
+    unsigned char *message_out,
+    int *outlen,
+    const unsigned char *nonce,
+    uint64_t *min_value,
+    uint64_t *max_value,
+    const secp256k1_pedersen_commitment *commit,
+    const unsigned char *proof,
+    int plen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(6) SECP256K1_ARG_NONNULL(7) SECP256K1_ARG_NONNULL(8) SECP256K1_ARG_NONNULL(9) SECP256K1_ARG_NONNULL(10);
+
+/** Opaque data structure that holds a bump allocator for temporary memory.
+ *
+ *  Operations that take a scratch space draw all their large temporaries from it
+ *  instead of from the stack or the heap, and release them again before returning.
+ *  A scratch space must not be used by more than one thread at a time.
+ */
+typedef struct secp256k1_scratch_space_struct secp256k1_scratch_space;
+
+/** Scratch space (in bytes) that suffices for a single secp256k1_rangeproof_verify_scratch call. */
+#define SECP256K1_RANGEPROOF_SCRATCH_SIZE 65536
+
+/** Create a secp256k1 scratch space object.
+ *
+ *  Returns: a newly created scratch space.
+ *  Args:   ctx:       a secp256k1 context object (cannot be NULL)
+ *  In:     max_size:  amount of memory to allocate, in bytes.
+ */
+SECP256K1_WARN_UNUSED_RESULT secp256k1_scratch_space* secp256k1_scratch_space_create(
+    const secp256k1_context* ctx,
+    size_t max_size
+) SECP256K1_ARG_NONNULL(1);
+
+/** Destroy a secp256k1 scratch space.
+ *
+ *  The pointer may not be used afterwards.
+ *  Args:   scratch:   space to destroy (can be NULL)
+ */
+void secp256k1_scratch_space_destroy(
+    secp256k1_scratch_space* scratch
+);
+
+/** Verify a range proof, like secp256k1_rangeproof_verify, but taking all temporaries from scratch.
+ *  Returns 1: Value is within the range [0..2^64), the specifically proven range is in the min/max value outputs.
+ *          0: Proof failed, or scratch has less than SECP256K1_RANGEPROOF_SCRATCH_SIZE bytes available.
+ *  Args:   ctx:     pointer to a context object, initialized for range-proof and commitment (cannot be NULL)
+ *          scratch: scratch space to use for temporaries (cannot be NULL)
+ *  In:     commit:  the 33-byte commitment being proved. (cannot be NULL)
+ *          proof:   pointer to character array with the proof. (cannot be NULL)
+ *          plen:    length of proof in bytes.
+ *  Out:    min_value: pointer to a unsigned int64 which will be updated with the minimum value that commit could have. (cannot be NULL)
+ *          max_value: pointer to a unsigned int64 which will be updated with the maximum value that commit could have. (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_verify_scratch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    uint64_t *min_value,
+    uint64_t *max_value,
+    const unsigned char *commit,
+    const unsigned char *proof,
+    int plen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5) SECP256K1_ARG_NONNULL(6);
+
+/** Verify many range proofs at once.
+ *  Returns 1: Every proof verifies; the range proven for commits[i] is in min_values[i] and max_values[i].
+ *          0: Some proof failed, or scratch cannot hold the temporaries of a single proof.
+ *  Args:   ctx:        pointer to a context object, initialized for range-proof and commitment (cannot be NULL)
+ *          scratch:    scratch space to use for temporaries (cannot be NULL)
+ *  In:     commits:    array of n pointers to the 33-byte commitments being proved.
+ *          proofs:     array of n pointers to the proofs.
+ *          plens:      array of the n proof lengths in bytes.
+ *          n:          number of proofs.
+ *  Out:    min_values: array of n unsigned int64s, receiving the minimum value each commit could have.
+ *          max_values: array of n unsigned int64s, receiving the maximum value each commit could have.
+ *
+ *  All proofs are decoded before any of them is verified, after which the ring signatures of as many proofs
+ *  as fit into scratch are verified together; this is faster than verifying each proof on its own. A scratch
+ *  space of SECP256K1_RANGEPROOF_SCRATCH_SIZE bytes holds at least one proof, and larger ones batch more.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_verify_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    const unsigned char * const *commits,
+    const unsigned char * const *proofs,
+    const int *plens,
+    size_t n,
+    uint64_t *min_values,
+    uint64_t *max_values
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** What a range proof created by secp256k1_rangeproof_sign for a given set of arguments costs. */
+typedef struct {
+    int exp;            /* exponent the proof uses (-1 if the value is public) */
+    int mantissa;       /* number of bits of the value the proof covers */
+    uint64_t min_value; /* range the proof shows */
+    uint64_t max_value;
+    int plen;           /* exact size of the proof in bytes */
+    int verify_ecmults; /* number of ring members, each costing the verifier one a*P + b*G multiplication */
+} secp256k1_rangeproof_cost;
+
+/** Objectives for choosing range proof parameters. */
+#define SECP256K1_RANGEPROOF_MINIMIZE_SIZE 0
+#define SECP256K1_RANGEPROOF_MINIMIZE_VERIFY 1
+
+/** Compute what a range proof for the given arguments would cost, without creating it.
+ *  Returns 1: cost has been filled in.
+ *          0: secp256k1_rangeproof_sign would fail for these arguments.
+ *  Args:   ctx:       pointer to a context object (cannot be NULL)
+ *  Out:    cost:      the parameters the proof would use, its size and its verification cost (cannot be NULL)
+ *  In:     min_value, exp, min_bits, value: as for secp256k1_rangeproof_sign.
+ *
+ *  This does no allocation and no elliptic curve operations. The reported size is exactly what
+ *  secp256k1_rangeproof_sign produces, and the range is what secp256k1_rangeproof_verify will report.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_cost_estimate(
+    const secp256k1_context* ctx,
+    secp256k1_rangeproof_cost *cost,
+    uint64_t min_value,
+    int exp,
+    int min_bits,
+    uint64_t value
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Choose the exponent for a range proof that is cheapest under some objective, within privacy constraints.
+ *  Returns 1: cost has been filled in for the best exponent.
+ *          0: secp256k1_rangeproof_sign would fail for every allowed exponent, or objective is unknown.
+ *  Args:   ctx:       pointer to a context object (cannot be NULL)
+ *  Out:    cost:      the cost of the chosen proof; cost->exp is the exponent to sign with (cannot be NULL)
+ *  In:     min_value: as for secp256k1_rangeproof_sign.
+ *          max_exp:   largest exponent (number of low decimal digits made public) that is acceptable, from -1 to 18.
+ *                     Only -1 itself allows making the whole value public.
+ *          min_bits:  as for secp256k1_rangeproof_sign; the proof keeps at least this many bits of the value private.
+ *          value:     actual value of the commitment.
+ *          objective: SECP256K1_RANGEPROOF_MINIMIZE_SIZE or SECP256K1_RANGEPROOF_MINIMIZE_VERIFY.
+ *
+ *  Every exponent from 0 to max_exp is considered. Ties on the objective are broken by the other one, and then
+ *  in favour of the smaller exponent, which reveals less.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_choose_params(
+    const secp256k1_context* ctx,
+    secp256k1_rangeproof_cost *cost,
+    uint64_t min_value,
+    int max_exp,
+    int min_bits,
+    uint64_t value,
+    int objective
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Author a range proof like secp256k1_rangeproof_sign, with the exponent chosen by secp256k1_rangeproof_choose_params.
+ *  Returns 1: Proof successfully created.
+ *          0: Error
+ *  All arguments are as for secp256k1_rangeproof_sign, except that max_exp and objective are passed to
+ *  secp256k1_rangeproof_choose_params to pick the exponent.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_rangeproof_sign_optimal(
+    const secp256k1_context* ctx,
+    unsigned char *proof,
+    int *plen,
+    uint64_t min_value,
+    const unsigned char *commit,
+    const unsigned char *blind,
+    const unsigned char *nonce,
+    int max_exp,
+    int min_bits,
+    uint64_t value,
+    int objective
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(5) SECP256K1_ARG_NONNULL(6) SECP256K1_ARG_NONNULL(7);
+
+/** Scratch space (in bytes) that suffices for a secp256k1_ct_transaction_verify call with noutputs outputs. */
+#define SECP256K1_CT_TRANSACTION_SCRATCH_SIZE(noutputs) (SECP256K1_RANGEPROOF_SCRATCH_SIZE + 128 * ((noutputs) + 1))
+
+/** Verify a confidential transaction: that its commitments balance, and that every output has a valid range proof.
+ *  Returns 1: sum(inputs) - sum(outputs) - excess*H == 0, and every proof verifies; the range proven for outputs[i]
+ *             is in min_values[i] and max_values[i].
+ *          0: The commitments do not balance, some commitment cannot be parsed, some proof failed, or scratch
+ *             has less than SECP256K1_CT_TRANSACTION_SCRATCH_SIZE(noutputs) bytes available.
+ *  Args:   ctx:        pointer to a context object, initialized for range-proof and commitment (cannot be NULL)
+ *          scratch:    scratch space to use for temporaries (cannot be NULL)
+ *  In:     inputs:     array of ninputs pointers to 33-byte input commitments.
+ *          ninputs:    number of inputs.
+ *          outputs:    array of noutputs pointers to 33-byte output commitments.
+ *          noutputs:   number of outputs.
+ *          excess:     signed 64bit amount (such as the fee) that the inputs exceed the outputs by.
+ *          proofs:     array of noutputs pointers to the range proofs of the outputs.
+ *          plens:      array of the noutputs proof lengths in bytes.
+ *  Out:    min_values: array of noutputs unsigned int64s, receiving the minimum value each output could have.
+ *          max_values: array of noutputs unsigned int64s, receiving the maximum value each output could have.
+ *
+ *  This gives the same result as secp256k1_pedersen_verify_tally followed by secp256k1_rangeproof_verify_batch,
+ *  but decompresses every output commitment only once, and checks the (cheap) balance before any proof.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_ct_transaction_verify(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    const unsigned char * const *inputs,
+    size_t ninputs,
+    const unsigned char * const *outputs,
+    size_t noutputs,
+    int64_t excess,
+    const unsigned char * const *proofs,
+    const int *plens,
+    uint64_t *min_values,
+    uint64_t *max_values
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Opaque data structure that holds a list of verification jobs which any number of threads can
+ *  work on together.
+ *
+ *  The library does not create threads itself. Instead, jobs are submitted from one thread, after which
+ *  every thread that should help calls secp256k1_verify_pool_work, each with its own scratch space, and
+ *  the outcome is read with secp256k1_verify_pool_result once all those calls have returned. Workers
+ *  claim one job at a time with an atomic counter, so there is no lock, and they stop claiming jobs as
+ *  soon as any job has failed. All jobs share the (read-only) context the pool was created for.
+ *
+ *  On compilers without atomic builtins (see HAVE_BUILTIN_SYNC) only one thread may call
+ *  secp256k1_verify_pool_work at a time.
+ */
+typedef struct secp256k1_verify_pool_struct secp256k1_verify_pool;
+
+/** Create a verification pool with room for max_jobs jobs.
+ *
+ *  Returns: a newly created pool, without jobs.
+ *  Args:   ctx:       a secp256k1 context object, which must outlive the pool (cannot be NULL)
+ *  In:     max_jobs:  the maximum number of jobs that can be submitted.
+ */
+SECP256K1_WARN_UNUSED_RESULT secp256k1_verify_pool* secp256k1_verify_pool_create(
+    const secp256k1_context* ctx,
+    size_t max_jobs
+) SECP256K1_ARG_NONNULL(1);
+
+/** Destroy a verification pool.
+ *
+ *  Args:   pool:      pool to destroy (can be NULL)
+ */
+void secp256k1_verify_pool_destroy(
+    secp256k1_verify_pool* pool
+);
+
+/** Remove all jobs from a pool, so that it can be reused.
+ *
+ *  Args:   pool:      an existing pool, which no thread is working on (cannot be NULL)
+ */
+void secp256k1_verify_pool_clear(
+    secp256k1_verify_pool* pool
+) SECP256K1_ARG_NONNULL(1);
+
+/** Add an ECDSA verification job, as done by secp256k1_ecdsa_verify_ex, to a pool.
+ *
+ *  Returns: 1 if the job was added, 0 if the pool is full.
+ *  Args:   pool:      an existing pool, which no thread is working on (cannot be NULL)
+ *  In:     sig, msg32, pubkey: as for secp256k1_ecdsa_verify_ex, which must stay valid
+ *                     until the pool has been worked on (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_verify_pool_submit_ecdsa(
+    secp256k1_verify_pool* pool,
+    const secp256k1_ecdsa_signature *sig,
+    const unsigned char *msg32,
+    const secp256k1_pubkey *pubkey
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
+/** Add a range proof verification job, as done by secp256k1_rangeproof_verify, to a pool.
+ *
+ *  Returns: 1 if the job was added, 0 if the pool is full.
+ *  Args:   pool:      an existing pool, which no thread is working on (cannot be NULL)
+ *  Out:    min_value, max_value: if not NULL, receive the proven range once the job has passed.
+ *  In:     commit, proof, plen: as for secp256k1_rangeproof_verify, which must stay valid
+ *                     until the pool has been worked on (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_verify_pool_submit_rangeproof(
+    secp256k1_verify_pool* pool,
+    uint64_t *min_value,
+    uint64_t *max_value,
+    const unsigned char *commit,
+    const unsigned char *proof,
+    int plen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
+/** Add a range proof verification, as done by secp256k1_rangeproof_verify, to a pool as up to nparts jobs
+ *  that each verify some of the proof's rings, so that several threads can work on a single proof.
+ *
+ *  Returns: 1 if the jobs were added, 0 if the pool has fewer than nparts free jobs or nparts is 0.
+ *  Args:   pool:      an existing pool, which no thread is working on (cannot be NULL)
+ *  Out:    min_value, max_value: if not NULL, receive the proven range once every part has passed.
+ *  In:     commit, proof, plen: as for secp256k1_rangeproof_verify; proof must stay valid until the pool
+ *                     has been worked on (cannot be NULL)
+ *          nparts:    the number of jobs to split the proof into; fewer are used if the proof has fewer rings.
+ *
+ *  The proof is decoded (and its commitment decompressed) right away, which costs a few percent of its
+ *  verification. A 64-bit proof has 32 rings of nearly equal cost, so it splits well into up to 32 parts. The
+ *  rings are hashed together in a fixed order by whichever thread finishes the last part. A malformed proof is
+ *  added as a single job that fails; a failure is reported as the index of one of the jobs added here.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_verify_pool_submit_rangeproof_split(
+    secp256k1_verify_pool* pool,
+    uint64_t *min_value,
+    uint64_t *max_value,
+    const unsigned char *commit,
+    const unsigned char *proof,
+    int plen,
+    size_t nparts
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
+/** Add a tally verification job, as done by secp256k1_pedersen_verify_tally, to a pool.
+ *
+ *  Returns: 1 if the job was added, 0 if the pool is full.
+ *  Args:   pool:      an existing pool, which no thread is working on (cannot be NULL)
+ *  In:     commits, pcnt, ncommits, ncnt, excess: as for secp256k1_pedersen_verify_tally; the arrays
+ *                     must stay valid until the pool has been worked on (cannot be NULL)
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_verify_pool_submit_tally(
+    secp256k1_verify_pool* pool,
+    const unsigned char * const *commits,
+    int pcnt,
+    const unsigned char * const *ncommits,
+    int ncnt,
+    int64_t excess
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(4);
+
+/** Verify jobs of a pool until none are left or one has failed. May be called from many threads at once.
+ *
+ *  Args:   pool:      an existing pool (cannot be NULL)
+ *          scratch:   scratch space for this thread's range proof jobs, with at least
+ *                     SECP256K1_RANGEPROOF_SCRATCH_SIZE bytes; if NULL, every range proof job
+ *                     allocates its own temporaries.
+ */
+void secp256k1_verify_pool_work(
+    secp256k1_verify_pool* pool,
+    secp256k1_scratch_space* scratch
+) SECP256K1_ARG_NONNULL(1);
+
+/** Get the outcome of a pool after every call to secp256k1_verify_pool_work on it has returned.
+ *
+ *  Returns: 1 if every submitted job passed, 0 if some job failed or was never worked on.
+ *  Args:   pool:      an existing pool (cannot be NULL)
+ *  Out:    failed:    if not NULL, receives the index (in order of submission) of the failed job that was
+ *                     found first, or the number of jobs if all passed.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_verify_pool_result(
+    const secp256k1_verify_pool* pool,
+    size_t *failed
+) SECP256K1_ARG_NONNULL(1);
+
+/** Opaque data structure that verifies a stream of items in batches, so that callers can add signatures,
+ *  range proofs and tallies as they arrive without managing batch boundaries themselves.
+ *
+ *  Items are copied into fixed-size batches (64 ECDSA signatures or 8 range proofs), and every batch that
+ *  fills up is verified at once with secp256k1_ecdsa_verify_batch or secp256k1_rangeproof_verify_batch.
+ *  Tallies are cheap and are checked as they are added. If the session was created with a verification
+ *  pool, full batches are submitted to the pool as jobs instead, for the threads working on the pool to
+ *  verify in parallel once secp256k1_verify_session_finish has been called; a batch that does not fit into
+ *  the pool any more is verified right away.
+ *
+ *  Items are numbered in the order they are added, starting at 0, regardless of their type.
+ */
+typedef struct secp256k1_verify_session_struct secp256k1_verify_session;
+
+/** Create a verification session.
+ *
+ *  Returns: a newly created session, without items.
+ *  Args:   ctx:     a secp256k1 context object, which must outlive the session (cannot be NULL)
+ *          scratch: scratch space for verifying range proofs, with at least SECP256K1_RANGEPROOF_SCRATCH_SIZE
+ *                   bytes, which must outlive the session; if NULL, the session allocates its own.
+ *          pool:    a verification pool for ctx to submit full batches to, which must outlive the session
+ *                   (can be NULL, to verify every batch on the calling thread).
+ */
+SECP256K1_WARN_UNUSED_RESULT secp256k1_verify_session* secp256k1_verify_session_create(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    secp256k1_verify_pool* pool
+) SECP256K1_ARG_NONNULL(1);
+
+/** Destroy a verification session. If it submitted batches to a pool, no thread may be working on that pool.
+ *
+ *  Args:   session: session to destroy (can be NULL)
+ */
+void secp256k1_verify_session_destroy(
+    secp256k1_verify_session* session
+);
+
+/** Add an ECDSA signature to verify, as done by secp256k1_ecdsa_verify_ex, to a session.
+ *
+ *  Returns: 0 if some item of the session is known to have failed (so that the rest need not be added), 1 otherwise.
+ *  Args:   session: an existing, unfinished session (cannot be NULL)
+ *  In:     sig, msg32, pubkey: as for secp256k1_ecdsa_verify_ex; they are copied (cannot be NULL)
+ */
+int secp256k1_verify_session_add_ecdsa(
+    secp256k1_verify_session* session,
+    const secp256k1_ecdsa_signature *sig,
+    const unsigned char *msg32,
+    const secp256k1_pubkey *pubkey
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
+/** Add a range proof to verify, as done by secp256k1_rangeproof_verify, to a session.
+ *
+ *  Returns: 0 if some item of the session is known to have failed (so that the rest need not be added), 1 otherwise.
+ *  Args:   session: an existing, unfinished session (cannot be NULL)
+ *  Out:    min_value, max_value: if not NULL, receive the proven range once the proof has passed; they must
+ *                   stay valid until the session's result is known.
+ *  In:     commit, proof, plen: as for secp256k1_rangeproof_verify; they are copied (cannot be NULL)
+ */
+int secp256k1_verify_session_add_rangeproof(
+    secp256k1_verify_session* session,
+    uint64_t *min_value,
+    uint64_t *max_value,
+    const unsigned char *commit,
+    const unsigned char *proof,
+    int plen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
+/** Check a tally, as done by secp256k1_pedersen_verify_tally, as an item of a session.
+ *
+ *  Returns: 0 if some item of the session is known to have failed (so that the rest need not be added), 1 otherwise.
+ *  Args:   session: an existing, unfinished session (cannot be NULL)
+ *  In:     commits, pcnt, ncommits, ncnt, excess: as for secp256k1_pedersen_verify_tally (cannot be NULL)
+ */
+int secp256k1_verify_session_add_tally(
+    secp256k1_verify_session* session,
+    const unsigned char * const *commits,
+    int pcnt,
+    const unsigned char * const *ncommits,
+    int ncnt,
+    int64_t excess
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(4);
+
+/** Verify (or, with a pool, submit) the partially filled batches of a session. No items can be added afterwards.
+ *
+ *  Returns: 0 if some item of the session is known to have failed, 1 otherwise. Without a pool this is the
+ *           outcome of the session; with one, the pool has to be worked on before secp256k1_verify_session_result
+ *           gives it.
+ *  Args:   session: an existing, unfinished session (cannot be NULL)
+ */
+int secp256k1_verify_session_finish(
+    secp256k1_verify_session* session
+) SECP256K1_ARG_NONNULL(1);
+
+/** Get the outcome of a finished session, after every call to secp256k1_verify_pool_work on its pool has returned.
+ *
+ *  Returns: 1 if every item added to the session passed, 0 if some item failed or was never verified.
+ *  Args:   session: an existing session (cannot be NULL)
+ *  Out:    failed:  if not NULL, receives the index of the first item that failed or was not verified (because
+ *                   verification stopped at a failure elsewhere), or the number of items if all passed.
+ */
+SECP256K1_WARN_UNUSED_RESULT int secp256k1_verify_session_result(
+    const secp256k1_verify_session* session,
+    size_t *failed
+) SECP256K1_ARG_NONNULL(1);
+
+/** Counts of the hot operations performed by one thread, for profiling the cost of API calls. */
+typedef struct {
+    uint64_t fe_mul;              /* field multiplications */
+    uint64_t fe_sqr;              /* field squarings */
+    uint64_t fe_inv;              /* constant-time field inversions */
+    uint64_t fe_inv_var;          /* variable-time field inversions */
+    uint64_t fe_sqrt_var;         /* field square roots */
+    uint64_t gej_add_var;         /* variable-time point additions */
+    uint64_t gej_double_var;      /* variable-time point doublings */
+    uint64_t ecmult;              /* a*P + b*G multiplications */
+    uint64_t ecmult_multi;        /* multi-multiplications ... */
+    uint64_t ecmult_multi_points; /* ... and their total number of points */
+    uint64_t ecmult_gen;          /* multiplications of G */
+    uint64_t ecmult_gen2;         /* multiplications of the value generator of commitments */
+    uint64_t ecmult_const;        /* constant-time multiplications of arbitrary points (ECDH) */
+} secp256k1_op_counters;
+
+/** Read the operation counters of the calling thread.
+ *
+ *  Returns: 1 if the library was configured with --enable-op-counters, 0 otherwise (in which case
+ *           nothing is counted and counters is set to all zeroes).
+ *  Out:    counters: the counts since the thread started or since the last reset (cannot be NULL)
+ *  In:     reset:    if nonzero, set the counters of the calling thread to zero after reading them
+ *
+ *  Every operation is counted where it is implemented, so for example the additions inside a
+ *  multiplication are included in gej_add_var as well.
+ */
+int secp256k1_debug_get_counters(
+    secp256k1_op_counters *counters,
+    int reset
+) SECP256K1_ARG_NONNULL(1);
+
 # ifdef __cplusplus
 }
 # endif
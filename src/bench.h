@@ -7,14 +7,145 @@
 #ifndef _SECP256K1_BENCH_H_
 #define _SECP256K1_BENCH_H_
 
+#if defined HAVE_CONFIG_H
+#include "libsecp256k1-config.h"
+#endif
+
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "sys/time.h"
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+#ifdef HAVE_PERF_EVENT_OPEN
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* The harness is configured through the environment, so that every bench_* binary takes the same settings:
+ * * SECP256K1_BENCH_FILTER: comma-separated substrings; only benchmarks whose name contains one of them run.
+ * * SECP256K1_BENCH_FORMAT: "text" (the default), "csv" or "json" (one object per line).
+ * * SECP256K1_BENCH_RUNS: number of timed runs, instead of the count each benchmark passes.
+ * * SECP256K1_BENCH_WARMUP: number of untimed runs before those (default 1).
+ * * SECP256K1_BENCH_CPU: pin the process to this CPU before the first benchmark.
+ * Where the kernel allows it (see /proc/sys/kernel/perf_event_paranoid), last-level cache misses are
+ * counted as well.
+ */
+
+/* The build configuration, reported with every result so that runs of different builds can be compared. */
+#if defined(USE_FIELD_5X52_AVX2)
+#define BENCH_CONFIG_FIELD "avx2"
+#elif defined(USE_FIELD_5X52)
+#define BENCH_CONFIG_FIELD "64bit"
+#elif defined(USE_FIELD_10X26_NEON)
+#define BENCH_CONFIG_FIELD "neon"
+#elif defined(USE_FIELD_10X26)
+#define BENCH_CONFIG_FIELD "32bit"
+#else
+#define BENCH_CONFIG_FIELD "unknown"
+#endif
+#if defined(USE_SCALAR_4X64)
+#define BENCH_CONFIG_SCALAR "64bit"
+#elif defined(USE_SCALAR_8X32)
+#define BENCH_CONFIG_SCALAR "32bit"
+#else
+#define BENCH_CONFIG_SCALAR "unknown"
+#endif
+#if defined(USE_NUM_GMP)
+#define BENCH_CONFIG_BIGNUM "gmp"
+#else
+#define BENCH_CONFIG_BIGNUM "no"
+#endif
+#if defined(USE_ENDOMORPHISM)
+#define BENCH_CONFIG_ENDOMORPHISM "yes"
+#else
+#define BENCH_CONFIG_ENDOMORPHISM "no"
+#endif
+#if defined(USE_ASM_X86_64)
+#define BENCH_CONFIG_ASM "x86_64"
+#elif defined(USE_ASM_ARM64)
+#define BENCH_CONFIG_ASM "arm64"
+#else
+#define BENCH_CONFIG_ASM "no"
+#endif
+#if defined(USE_ECMULT_STATIC_PRECOMPUTATION)
+#define BENCH_CONFIG_STATIC_PRECOMPUTATION "yes"
+#else
+#define BENCH_CONFIG_STATIC_PRECOMPUTATION "no"
+#endif
+#if defined(ECMULT_GEN_KB)
+#define BENCH_CONFIG_ECMULT_GEN_KB ECMULT_GEN_KB
+#else
+#define BENCH_CONFIG_ECMULT_GEN_KB 86
+#endif
 
 static double gettimedouble(void) {
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_nsec * 0.000000001 + ts.tv_sec;
+#else
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return tv.tv_usec * 0.000001 + tv.tv_sec;
+#endif
+}
+
+/* The time stamp counter, where we know how to read it. It counts reference cycles, which only match core
+ * cycles with frequency scaling and turbo disabled. */
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_HAVE_CYCLES 1
+static uint64_t bench_cycles(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+#else
+#define BENCH_HAVE_CYCLES 0
+static uint64_t bench_cycles(void) {
+    return 0;
+}
+#endif
+
+/* A hardware counter of the last-level cache misses of this thread, or -1 if there is none. */
+static int bench_llc_fd(void) {
+    static int fd = -2;
+    if (fd == -2) {
+        fd = -1;
+#ifdef HAVE_PERF_EVENT_OPEN
+        {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd < 0) {
+                fd = -1;
+            }
+        }
+#endif
+    }
+    return fd;
+}
+
+static uint64_t bench_llc_misses(void) {
+    uint64_t count = 0;
+#ifdef HAVE_PERF_EVENT_OPEN
+    if (bench_llc_fd() >= 0 && read(bench_llc_fd(), &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+    }
+#endif
+    return count;
 }
 
 void print_number(double x) {
@@ -28,29 +159,196 @@ void print_number(double x) {
     printf("%.*f", c, x);
 }
 
+static int bench_env_int(const char *var, int def) {
+    const char *value = getenv(var);
+    if (value == NULL || *value == 0) {
+        return def;
+    }
+    return atoi(value);
+}
+
+static int bench_match(const char *name) {
+    const char *filter = getenv("SECP256K1_BENCH_FILTER");
+    size_t len;
+    if (filter == NULL || *filter == 0) {
+        return 1;
+    }
+    while (*filter) {
+        len = strcspn(filter, ",");
+        if (len > 0 && len <= strlen(name)) {
+            const char *pos;
+            for (pos = name; *pos; pos++) {
+                if (strncmp(pos, filter, len) == 0) {
+                    return 1;
+                }
+            }
+        }
+        filter += len;
+        if (*filter == ',') {
+            filter++;
+        }
+    }
+    return 0;
+}
+
+/* Pin to SECP256K1_BENCH_CPU, once per process. */
+static void bench_pin(void) {
+    static int pinned = 0;
+    int cpu;
+    if (pinned) {
+        return;
+    }
+    pinned = 1;
+    cpu = bench_env_int("SECP256K1_BENCH_CPU", -1);
+    if (cpu < 0) {
+        return;
+    }
+#ifdef HAVE_SCHED_SETAFFINITY
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            fprintf(stderr, "bench: cannot pin to CPU %i\n", cpu);
+        }
+    }
+#else
+    fprintf(stderr, "bench: CPU pinning is not supported on this platform\n");
+#endif
+}
+
+static int bench_cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* The nearest-rank percentile of n sorted values. */
+static double bench_percentile(const double *sorted, int n, int percent) {
+    int rank = (n * percent + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void bench_print_config_json(void) {
+    printf("\"config\": {\"field\": \"%s\", \"scalar\": \"%s\", \"bignum\": \"%s\", \"endomorphism\": \"%s\", \"asm\": \"%s\", "
+           "\"static_precomputation\": \"%s\", \"ecmult_gen_kb\": %i}",
+           BENCH_CONFIG_FIELD, BENCH_CONFIG_SCALAR, BENCH_CONFIG_BIGNUM, BENCH_CONFIG_ENDOMORPHISM, BENCH_CONFIG_ASM,
+           BENCH_CONFIG_STATIC_PRECOMPUTATION, BENCH_CONFIG_ECMULT_GEN_KB);
+}
+
+/* Run benchmark count times (after the warmup runs), each time between setup and teardown, and report the
+ * time per iteration, where each benchmark call performs iter iterations. */
 void run_benchmark(char *name, void (*benchmark)(void*), void (*setup)(void*), void (*teardown)(void*), void* data, int count, int iter) {
+    static int csv_header = 0;
+    const char *format = getenv("SECP256K1_BENCH_FORMAT");
+    double *times, *cycles, *misses;
+    double min, max, sum = 0.0, median, p99, cycles_median, misses_median;
+    int have_misses = bench_llc_fd() >= 0;
+    int warmup = bench_env_int("SECP256K1_BENCH_WARMUP", 1);
     int i;
-    double min = HUGE_VAL;
-    double sum = 0.0;
-    double max = 0.0;
+
+    if (!bench_match(name)) {
+        return;
+    }
+    bench_pin();
+    count = bench_env_int("SECP256K1_BENCH_RUNS", count);
+    if (count < 1) {
+        count = 1;
+    }
+    times = (double *)malloc(sizeof(double) * count);
+    cycles = (double *)malloc(sizeof(double) * count);
+    misses = (double *)malloc(sizeof(double) * count);
+    if (times == NULL || cycles == NULL || misses == NULL) {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < warmup; i++) {
+        if (setup) setup(data);
+        benchmark(data);
+        if (teardown) teardown(data);
+    }
     for (i = 0; i < count; i++) {
-        double begin, total;
+        double begin;
+        uint64_t begin_cycles, begin_misses;
         if (setup) setup(data);
+        begin_misses = bench_llc_misses();
+        begin_cycles = bench_cycles();
         begin = gettimedouble();
         benchmark(data);
-        total = gettimedouble() - begin;
+        times[i] = (gettimedouble() - begin) * 1000000.0 / iter;
+        cycles[i] = (double)(bench_cycles() - begin_cycles) / iter;
+        misses[i] = (double)(bench_llc_misses() - begin_misses) / iter;
         if (teardown) teardown(data);
-        if (total < min) min = total;
-        if (total > max) max = total;
-        sum += total;
-    }
-    printf("%s: min ", name);
-    print_number(min * 1000000.0 / iter);
-    printf("us / avg ");
-    print_number((sum / count) * 1000000.0 / iter);
-    printf("us / max ");
-    print_number(max * 1000000.0 / iter);
-    printf("us\n");
+        sum += times[i];
+    }
+    qsort(times, count, sizeof(double), bench_cmp_double);
+    qsort(cycles, count, sizeof(double), bench_cmp_double);
+    qsort(misses, count, sizeof(double), bench_cmp_double);
+    min = times[0];
+    max = times[count - 1];
+    median = bench_percentile(times, count, 50);
+    p99 = bench_percentile(times, count, 99);
+    cycles_median = bench_percentile(cycles, count, 50);
+    misses_median = bench_percentile(misses, count, 50);
+
+    if (format != NULL && strcmp(format, "csv") == 0) {
+        if (!csv_header) {
+            printf("name,runs,iters,min_us,avg_us,median_us,p99_us,max_us,median_cycles,median_llc_misses,"
+                   "field,scalar,bignum,endomorphism,asm,static_precomputation,ecmult_gen_kb\n");
+            csv_header = 1;
+        }
+        printf("\"%s\",%i,%i,%.6f,%.6f,%.6f,%.6f,%.6f,", name, count, iter, min, sum / count, median, p99, max);
+        if (BENCH_HAVE_CYCLES) {
+            printf("%.1f", cycles_median);
+        }
+        printf(",");
+        if (have_misses) {
+            printf("%.1f", misses_median);
+        }
+        printf(",%s,%s,%s,%s,%s,%s,%i\n",
+               BENCH_CONFIG_FIELD, BENCH_CONFIG_SCALAR, BENCH_CONFIG_BIGNUM, BENCH_CONFIG_ENDOMORPHISM, BENCH_CONFIG_ASM,
+               BENCH_CONFIG_STATIC_PRECOMPUTATION, BENCH_CONFIG_ECMULT_GEN_KB);
+    } else if (format != NULL && strcmp(format, "json") == 0) {
+        printf("{\"name\": \"%s\", \"runs\": %i, \"iters\": %i, \"min_us\": %.6f, \"avg_us\": %.6f, \"median_us\": %.6f, "
+               "\"p99_us\": %.6f, \"max_us\": %.6f, ", name, count, iter, min, sum / count, median, p99, max);
+        if (BENCH_HAVE_CYCLES) {
+            printf("\"median_cycles\": %.1f, ", cycles_median);
+        } else {
+            printf("\"median_cycles\": null, ");
+        }
+        if (have_misses) {
+            printf("\"median_llc_misses\": %.1f, ", misses_median);
+        } else {
+            printf("\"median_llc_misses\": null, ");
+        }
+        bench_print_config_json();
+        printf("}\n");
+    } else {
+        printf("%s: min ", name);
+        print_number(min);
+        printf("us / avg ");
+        print_number(sum / count);
+        printf("us / median ");
+        print_number(median);
+        printf("us / p99 ");
+        print_number(p99);
+        printf("us / max ");
+        print_number(max);
+        printf("us");
+        if (BENCH_HAVE_CYCLES) {
+            printf(" / ");
+            print_number(cycles_median);
+            printf(" cycles");
+        }
+        if (have_misses) {
+            printf(" / %.1f LLC misses", misses_median);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+    free(times);
+    free(cycles);
+    free(misses);
 }
 
 #endif
@@ -8,9 +8,17 @@
 
 #include "include/secp256k1.h"
 #include "util.h"
+#include "num_impl.h"
+#include "field_impl.h"
+#include "group_impl.h"
+#include "scalar_impl.h"
+#include "ecdh_impl.h"
 #include "bench.h"
 
 typedef struct {
+    secp256k1_context_t *ctx;
+    secp256k1_point_precomp *precomp;
+    secp256k1_pubkey pubkey;
     unsigned char point[33];
     int pointlen;
     unsigned char scalar[32];
@@ -41,9 +49,99 @@ static void bench_multiply(void* arg) {
     }
 }
 
+static void bench_multiply_precomp(void* arg) {
+    int i;
+    secp256k1_pubkey result;
+    bench_multiply_t *data = (bench_multiply_t*)arg;
+
+    for (i = 0; i < 20000; i++) {
+        CHECK(secp256k1_point_precomp_multiply(data->ctx, &result, data->precomp, data->scalar) == 1);
+        data->scalar[i & 31] ^= result.data[i & 63];
+    }
+}
+
+static void bench_ecdh(void* arg) {
+    int i;
+    unsigned char res[32];
+    bench_multiply_t *data = (bench_multiply_t*)arg;
+
+    for (i = 0; i < 20000; i++) {
+        CHECK(secp256k1_ecdh(data->ctx, res, &data->pubkey, data->scalar) == 1);
+    }
+}
+
+static void bench_tweak_mul(void* arg) {
+    int i;
+    bench_multiply_t *data = (bench_multiply_t*)arg;
+    unsigned char point[33];
+
+    memcpy(point, data->point, 33);
+    for (i = 0; i < 20000; i++) {
+        CHECK(secp256k1_ec_pubkey_tweak_mul(data->ctx, point, 33, data->scalar) == 1);
+    }
+}
+
+/* The two internal constant-time multiplications, timed directly so that both can be compared in one build. */
+static void bench_point_multiply(void* arg, int ladder) {
+    int i;
+    secp256k1_ge_t a;
+    secp256k1_fe_t x;
+    secp256k1_gej_t r;
+    secp256k1_scalar_t s;
+    bench_multiply_t *data = (bench_multiply_t*)arg;
+
+    CHECK(secp256k1_fe_set_b32(&x, data->point + 1));
+    CHECK(secp256k1_ge_set_xo_var(&a, &x, data->point[0] == 0x03));
+    secp256k1_scalar_set_b32(&s, data->scalar, NULL);
+    for (i = 0; i < 20000; i++) {
+        if (ladder) {
+            secp256k1_ecdh_point_multiply_ladder(&r, &a, &s);
+        } else {
+            secp256k1_ecdh_point_multiply_wnaf_batch(&r, &a, 1, &s);
+        }
+    }
+}
+
+static void bench_point_multiply_wnaf(void* arg) {
+    bench_point_multiply(arg, 0);
+}
+
+static void bench_point_multiply_ladder(void* arg) {
+    bench_point_multiply(arg, 1);
+}
+
+#define BENCH_ECDH_BATCH 64
+
+static void bench_ecdh_batch(void* arg) {
+    int i;
+    static unsigned char res[32 * BENCH_ECDH_BATCH];
+    const secp256k1_pubkey *points[BENCH_ECDH_BATCH];
+    bench_multiply_t *data = (bench_multiply_t*)arg;
+
+    for (i = 0; i < BENCH_ECDH_BATCH; i++) {
+        points[i] = &data->pubkey;
+    }
+    for (i = 0; i < 20000 / BENCH_ECDH_BATCH; i++) {
+        CHECK(secp256k1_ecdh_batch(data->ctx, res, points, BENCH_ECDH_BATCH, data->scalar) == 1);
+    }
+}
+
 int main(void) {
     bench_multiply_t data;
 
     run_benchmark("ecdh_mult", bench_multiply, bench_multiply_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdh_point_multiply_wnaf", bench_point_multiply_wnaf, bench_multiply_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdh_point_multiply_ladder", bench_point_multiply_ladder, bench_multiply_setup, NULL, &data, 10, 20000);
+
+    data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+    bench_multiply_setup(&data);
+    CHECK(secp256k1_ec_pubkey_parse(data.ctx, &data.pubkey, data.point, data.pointlen));
+    run_benchmark("ecdh", bench_ecdh, NULL, NULL, &data, 10, 20000);
+    run_benchmark("ecdh_batch", bench_ecdh_batch, NULL, NULL, &data, 10, (20000 / BENCH_ECDH_BATCH) * BENCH_ECDH_BATCH);
+    run_benchmark("ec_pubkey_tweak_mul", bench_tweak_mul, NULL, NULL, &data, 10, 20000);
+    data.precomp = secp256k1_point_precomp_create(data.ctx, &data.pubkey, NULL);
+    run_benchmark("ecdh_mult_precomp", bench_multiply_precomp, bench_multiply_setup, NULL, &data, 10, 20000);
+    secp256k1_point_precomp_destroy(data.precomp);
+    secp256k1_context_destroy(data.ctx);
     return 0;
 }
@@ -14,6 +14,7 @@
 #include "group_impl.h"
 #include "scalar_impl.h"
 #include "ecmult_impl.h"
+#include "ecmult_gen_impl.h"
 #include "bench.h"
 
 typedef struct {
@@ -23,6 +24,8 @@ typedef struct {
     secp256k1_gej_t gej_x, gej_y;
     unsigned char data[32];
     int wnaf[256];
+    uint64_t value;
+    secp256k1_ecmult_gen2_context_t gen2;
 } bench_inv_t;
 
 void bench_setup(void* arg) {
@@ -234,6 +237,42 @@ void bench_ecmult_wnaf(void* arg) {
     }
 }
 
+void bench_setup_ecmult_gen2(void* arg) {
+    bench_inv_t *data = (bench_inv_t*)arg;
+    bench_setup(arg);
+    data->value = ((uint64_t)0x01234567 << 32) | 0x89abcdef;
+    secp256k1_ecmult_gen2_context_init(&data->gen2);
+    secp256k1_ecmult_gen2_context_build(&data->gen2, NULL);
+}
+
+void bench_teardown_ecmult_gen2(void* arg) {
+    bench_inv_t *data = (bench_inv_t*)arg;
+    secp256k1_ecmult_gen2_context_clear(&data->gen2, NULL);
+}
+
+void bench_ecmult_gen2_small(void* arg) {
+    int i;
+    bench_inv_t *data = (bench_inv_t*)arg;
+
+    for (i = 0; i < 2000; i++) {
+        secp256k1_ecmult_gen2_small(&data->gen2, &data->gej_x, data->value);
+        data->value ^= data->value << 13;
+        data->value ^= data->value >> 7;
+        data->value ^= data->value << 17;
+    }
+}
+
+void bench_ecmult_gen2_small_var(void* arg) {
+    int i;
+    bench_inv_t *data = (bench_inv_t*)arg;
+
+    for (i = 0; i < 2000; i++) {
+        secp256k1_ecmult_gen2_small_var(&data->gen2, &data->gej_x, data->value);
+        data->value ^= data->value << 13;
+        data->value ^= data->value >> 7;
+        data->value ^= data->value << 17;
+    }
+}
 
 void bench_sha256(void* arg) {
     int i;
@@ -247,6 +286,24 @@ void bench_sha256(void* arg) {
     }
 }
 
+void bench_sha256_x4(void* arg) {
+    int i, j;
+    bench_inv_t *data = (bench_inv_t*)arg;
+    secp256k1_sha256_t sha[4];
+    const unsigned char *ptrs[4];
+    unsigned char out[128];
+
+    for (i = 0; i < 20000 / 4; i++) {
+        for (j = 0; j < 4; j++) {
+            secp256k1_sha256_initialize(&sha[j]);
+            ptrs[j] = data->data;
+        }
+        secp256k1_sha256_write_x4(sha, ptrs, 32);
+        secp256k1_sha256_finalize_x4(sha, out);
+        memcpy(data->data, out + 32 * (i & 3), 32);
+    }
+}
+
 void bench_hmac_sha256(void* arg) {
     int i;
     bench_inv_t *data = (bench_inv_t*)arg;
@@ -270,6 +327,58 @@ void bench_rfc6979_hmac_sha256(void* arg) {
     }
 }
 
+void bench_rfc6979_hmac_sha256_midstate(void* arg) {
+    int i;
+    bench_inv_t *data = (bench_inv_t*)arg;
+    secp256k1_rfc6979_hmac_sha256_t rng;
+    secp256k1_sha256_midstate_t mid;
+    unsigned char key[32];
+
+    secp256k1_scalar_get_b32(key, &data->scalar_x);
+    secp256k1_rfc6979_hmac_sha256_key_midstate(&mid, key, 32);
+    for (i = 0; i < 20000; i++) {
+        secp256k1_rfc6979_hmac_sha256_initialize_midstate(&rng, &mid, key, 32, data->data, 32, NULL, 0);
+        secp256k1_rfc6979_hmac_sha256_generate(&rng, data->data, 32);
+    }
+}
+
+void bench_setup_sha256_portable(void* arg) {
+    bench_setup(arg);
+    secp256k1_sha256_transform_impl = secp256k1_sha256_transform_portable;
+}
+
+#if defined(HAVE_SHA256_SHANI)
+void bench_setup_sha256_shani(void* arg) {
+    bench_setup(arg);
+    secp256k1_sha256_transform_impl = secp256k1_sha256_transform_shani;
+}
+#endif
+
+#if defined(SECP256K1_SHA256_ARMV8)
+void bench_setup_sha256_armv8(void* arg) {
+    bench_setup(arg);
+    secp256k1_sha256_transform_impl = secp256k1_sha256_transform_armv8;
+}
+#endif
+
+void bench_teardown_sha256(void* arg) {
+    (void)arg;
+    secp256k1_sha256_transform_impl = secp256k1_sha256_transform_select;
+}
+
+
+#if defined(USE_SCALAR_4X64) && defined(USE_ASM_X86_64) && defined(HAVE_ASM_X86_64_ADX)
+/* Run with the baseline x86_64 assembly even where BMI2/ADX are available. */
+void bench_setup_noadx(void* arg) {
+    secp256k1_x86_64_features = SECP256K1_X86_64_DETECTED;
+    bench_setup(arg);
+}
+
+void bench_teardown_noadx(void* arg) {
+    (void)arg;
+    secp256k1_x86_64_features = 0;
+}
+#endif
 
 int have_flag(int argc, char** argv, char *flag) {
     char** argm = argv + argc;
@@ -290,6 +399,12 @@ int main(int argc, char **argv) {
     if (have_flag(argc, argv, "scalar") || have_flag(argc, argv, "negate")) run_benchmark("scalar_negate", bench_scalar_negate, bench_setup, NULL, &data, 10, 2000000);
     if (have_flag(argc, argv, "scalar") || have_flag(argc, argv, "sqr")) run_benchmark("scalar_sqr", bench_scalar_sqr, bench_setup, NULL, &data, 10, 200000);
     if (have_flag(argc, argv, "scalar") || have_flag(argc, argv, "mul")) run_benchmark("scalar_mul", bench_scalar_mul, bench_setup, NULL, &data, 10, 200000);
+#if defined(USE_SCALAR_4X64) && defined(USE_ASM_X86_64) && defined(HAVE_ASM_X86_64_ADX)
+    if (secp256k1_x86_64_have_bmi2_adx()) {
+        if (have_flag(argc, argv, "scalar") || have_flag(argc, argv, "sqr")) run_benchmark("scalar_sqr_noadx", bench_scalar_sqr, bench_setup_noadx, bench_teardown_noadx, &data, 10, 200000);
+        if (have_flag(argc, argv, "scalar") || have_flag(argc, argv, "mul")) run_benchmark("scalar_mul_noadx", bench_scalar_mul, bench_setup_noadx, bench_teardown_noadx, &data, 10, 200000);
+    }
+#endif
 #ifdef USE_ENDOMORPHISM
     if (have_flag(argc, argv, "scalar") || have_flag(argc, argv, "split")) run_benchmark("scalar_split", bench_scalar_split, bench_setup, NULL, &data, 10, 20000);
 #endif
@@ -310,9 +425,30 @@ int main(int argc, char **argv) {
     if (have_flag(argc, argv, "group") || have_flag(argc, argv, "add")) run_benchmark("group_add_affine_var", bench_group_add_affine_var, bench_setup, NULL, &data, 10, 200000);
 
     if (have_flag(argc, argv, "ecmult") || have_flag(argc, argv, "wnaf")) run_benchmark("ecmult_wnaf", bench_ecmult_wnaf, bench_setup, NULL, &data, 10, 20000);
+    if (have_flag(argc, argv, "ecmult") || have_flag(argc, argv, "gen2")) run_benchmark("ecmult_gen2_small", bench_ecmult_gen2_small, bench_setup_ecmult_gen2, bench_teardown_ecmult_gen2, &data, 10, 2000);
+    if (have_flag(argc, argv, "ecmult") || have_flag(argc, argv, "gen2")) run_benchmark("ecmult_gen2_small_var", bench_ecmult_gen2_small_var, bench_setup_ecmult_gen2, bench_teardown_ecmult_gen2, &data, 10, 2000);
 
     if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "sha256")) run_benchmark("hash_sha256", bench_sha256, bench_setup, NULL, &data, 10, 20000);
+    if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "sha256")) run_benchmark("hash_sha256_x4", bench_sha256_x4, bench_setup, NULL, &data, 10, 20000);
     if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "hmac")) run_benchmark("hash_hmac_sha256", bench_hmac_sha256, bench_setup, NULL, &data, 10, 20000);
     if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "rng6979")) run_benchmark("hash_rfc6979_hmac_sha256", bench_rfc6979_hmac_sha256, bench_setup, NULL, &data, 10, 20000);
+    if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "rng6979")) run_benchmark("hash_rfc6979_hmac_sha256_midstate", bench_rfc6979_hmac_sha256_midstate, bench_setup, NULL, &data, 10, 20000);
+    if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "sha256")) run_benchmark("hash_sha256_portable", bench_sha256, bench_setup_sha256_portable, bench_teardown_sha256, &data, 10, 20000);
+    if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "hmac")) run_benchmark("hash_hmac_sha256_portable", bench_hmac_sha256, bench_setup_sha256_portable, bench_teardown_sha256, &data, 10, 20000);
+    if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "rng6979")) run_benchmark("hash_rfc6979_hmac_sha256_portable", bench_rfc6979_hmac_sha256, bench_setup_sha256_portable, bench_teardown_sha256, &data, 10, 20000);
+#if defined(HAVE_SHA256_SHANI)
+    if (secp256k1_sha256_shani_available()) {
+        if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "sha256")) run_benchmark("hash_sha256_shani", bench_sha256, bench_setup_sha256_shani, bench_teardown_sha256, &data, 10, 20000);
+        if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "hmac")) run_benchmark("hash_hmac_sha256_shani", bench_hmac_sha256, bench_setup_sha256_shani, bench_teardown_sha256, &data, 10, 20000);
+        if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "rng6979")) run_benchmark("hash_rfc6979_hmac_sha256_shani", bench_rfc6979_hmac_sha256, bench_setup_sha256_shani, bench_teardown_sha256, &data, 10, 20000);
+    }
+#endif
+#if defined(SECP256K1_SHA256_ARMV8)
+    if (secp256k1_sha256_armv8_available()) {
+        if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "sha256")) run_benchmark("hash_sha256_armv8", bench_sha256, bench_setup_sha256_armv8, bench_teardown_sha256, &data, 10, 20000);
+        if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "hmac")) run_benchmark("hash_hmac_sha256_armv8", bench_hmac_sha256, bench_setup_sha256_armv8, bench_teardown_sha256, &data, 10, 20000);
+        if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "rng6979")) run_benchmark("hash_rfc6979_hmac_sha256_armv8", bench_rfc6979_hmac_sha256, bench_setup_sha256_armv8, bench_teardown_sha256, &data, 10, 20000);
+    }
+#endif
     return 0;
 }
@@ -0,0 +1,284 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille                                   *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "include/secp256k1.h"
+#include "util.h"
+#include "bench.h"
+
+/* Aggregate throughput of verify, sign, rangeproof verify and ECDH on 1..N threads, with the threads
+ * using one context, clones of one context (which share its tables), or contexts of their own (so that
+ * every thread uses its own copy of the ~1MB verification tables). rangeproof_verify_split measures the latency
+ * of a single 64-bit range proof whose rings are shared out between the threads through a verification pool.
+ * Usage: bench_parallel [max_threads], which defaults to the number of online CPUs; SECP256K1_BENCH_FILTER and
+ * SECP256K1_BENCH_FORMAT apply. */
+
+#define BENCH_PARALLEL_FLAGS (SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_COMMIT | SECP256K1_CONTEXT_RANGEPROOF)
+
+/* The inputs, shared read-only by all threads. */
+typedef struct {
+    unsigned char msg[32];
+    unsigned char key[32];
+    unsigned char sig[72];
+    int siglen;
+    unsigned char pubkey[33];
+    int pubkeylen;
+    secp256k1_pubkey point;
+    unsigned char commit[33];
+    unsigned char proof[5134];
+    int prooflen;
+    unsigned char proof64[5134];
+    int proof64len;
+} bench_parallel_data_t;
+
+typedef void (*bench_parallel_op_t)(const secp256k1_context_t *ctx, const bench_parallel_data_t *data, int iters);
+
+typedef struct {
+    const secp256k1_context_t *ctx;
+    const bench_parallel_data_t *data;
+    bench_parallel_op_t op;
+    int iters;
+} bench_parallel_thread_t;
+
+static pthread_mutex_t bench_parallel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bench_parallel_cond = PTHREAD_COND_INITIALIZER;
+static int bench_parallel_ready;
+static int bench_parallel_go;
+
+static void bench_parallel_verify(const secp256k1_context_t *ctx, const bench_parallel_data_t *data, int iters) {
+    int i;
+    for (i = 0; i < iters; i++) {
+        CHECK(secp256k1_ecdsa_verify(ctx, data->msg, data->sig, data->siglen, data->pubkey, data->pubkeylen) == 1);
+    }
+}
+
+static void bench_parallel_sign(const secp256k1_context_t *ctx, const bench_parallel_data_t *data, int iters) {
+    int i;
+    unsigned char msg[32];
+    unsigned char sig[72];
+    int siglen;
+    memcpy(msg, data->msg, 32);
+    for (i = 0; i < iters; i++) {
+        siglen = 72;
+        msg[i & 31] ^= i >> 5;
+        CHECK(secp256k1_ecdsa_sign(ctx, msg, sig, &siglen, data->key, NULL, NULL));
+    }
+}
+
+static void bench_parallel_rangeproof(const secp256k1_context_t *ctx, const bench_parallel_data_t *data, int iters) {
+    int i;
+    uint64_t minv, maxv;
+    for (i = 0; i < iters; i++) {
+        CHECK(secp256k1_rangeproof_verify(ctx, &minv, &maxv, data->commit, data->proof, data->prooflen));
+    }
+}
+
+static void bench_parallel_ecdh(const secp256k1_context_t *ctx, const bench_parallel_data_t *data, int iters) {
+    int i;
+    unsigned char res[32];
+    for (i = 0; i < iters; i++) {
+        CHECK(secp256k1_ecdh(ctx, res, &data->point, data->key) == 1);
+    }
+}
+
+static void *bench_parallel_thread(void *arg) {
+    bench_parallel_thread_t *thread = (bench_parallel_thread_t *)arg;
+    /* Check in, and wait until all threads are started. */
+    pthread_mutex_lock(&bench_parallel_mutex);
+    bench_parallel_ready++;
+    pthread_cond_broadcast(&bench_parallel_cond);
+    while (!bench_parallel_go) {
+        pthread_cond_wait(&bench_parallel_cond, &bench_parallel_mutex);
+    }
+    pthread_mutex_unlock(&bench_parallel_mutex);
+    thread->op(thread->ctx, thread->data, thread->iters);
+    return NULL;
+}
+
+/* Run op iters times on each of nthreads threads, and return the elapsed wall-clock time. */
+static double bench_parallel_run(secp256k1_context_t **ctxs, const bench_parallel_data_t *data, bench_parallel_op_t op, int iters, int nthreads) {
+    pthread_t tids[256];
+    bench_parallel_thread_t threads[256];
+    double begin;
+    int i;
+
+    bench_parallel_ready = 0;
+    bench_parallel_go = 0;
+    for (i = 0; i < nthreads; i++) {
+        threads[i].ctx = ctxs[i];
+        threads[i].data = data;
+        threads[i].op = op;
+        threads[i].iters = iters;
+        CHECK(pthread_create(&tids[i], NULL, bench_parallel_thread, &threads[i]) == 0);
+    }
+    pthread_mutex_lock(&bench_parallel_mutex);
+    while (bench_parallel_ready < nthreads) {
+        pthread_cond_wait(&bench_parallel_cond, &bench_parallel_mutex);
+    }
+    begin = gettimedouble();
+    bench_parallel_go = 1;
+    pthread_cond_broadcast(&bench_parallel_cond);
+    pthread_mutex_unlock(&bench_parallel_mutex);
+    for (i = 0; i < nthreads; i++) {
+        CHECK(pthread_join(tids[i], NULL) == 0);
+    }
+    return gettimedouble() - begin;
+}
+
+static void *bench_parallel_pool_thread(void *arg) {
+    secp256k1_verify_pool_work((secp256k1_verify_pool *)arg, NULL);
+    return NULL;
+}
+
+/* Verify the 64-bit proof iters times, each time split over nthreads threads (the calling one included), and return
+ * the elapsed wall-clock time. Starting the threads for every proof is part of the measured latency. */
+static double bench_parallel_split(const secp256k1_context_t *ctx, const bench_parallel_data_t *data, int iters, int nthreads) {
+    pthread_t tids[256];
+    secp256k1_verify_pool *pool;
+    uint64_t minv, maxv;
+    double begin;
+    int i, t;
+
+    pool = secp256k1_verify_pool_create(ctx, 32);
+    begin = gettimedouble();
+    for (i = 0; i < iters; i++) {
+        secp256k1_verify_pool_clear(pool);
+        CHECK(secp256k1_verify_pool_submit_rangeproof_split(pool, &minv, &maxv, data->commit, data->proof64, data->proof64len, 32));
+        for (t = 1; t < nthreads; t++) {
+            CHECK(pthread_create(&tids[t], NULL, bench_parallel_pool_thread, pool) == 0);
+        }
+        secp256k1_verify_pool_work(pool, NULL);
+        for (t = 1; t < nthreads; t++) {
+            CHECK(pthread_join(tids[t], NULL) == 0);
+        }
+        CHECK(secp256k1_verify_pool_result(pool, NULL));
+    }
+    begin = gettimedouble() - begin;
+    secp256k1_verify_pool_destroy(pool);
+    return begin;
+}
+
+static void bench_parallel_report(const char *name, const char *mode, int nthreads, int ops, double seconds, double efficiency) {
+    static int csv_header = 0;
+    const char *format = getenv("SECP256K1_BENCH_FORMAT");
+    double rate = ops / seconds;
+    if (format != NULL && strcmp(format, "csv") == 0) {
+        if (!csv_header) {
+            printf("name,contexts,threads,ops,seconds,ops_per_sec,efficiency,"
+                   "field,scalar,bignum,endomorphism,asm,static_precomputation,ecmult_gen_kb\n");
+            csv_header = 1;
+        }
+        printf("\"%s\",%s,%i,%i,%.6f,%.1f,%.4f,%s,%s,%s,%s,%s,%s,%i\n", name, mode, nthreads, ops, seconds, rate, efficiency,
+               BENCH_CONFIG_FIELD, BENCH_CONFIG_SCALAR, BENCH_CONFIG_BIGNUM, BENCH_CONFIG_ENDOMORPHISM, BENCH_CONFIG_ASM,
+               BENCH_CONFIG_STATIC_PRECOMPUTATION, BENCH_CONFIG_ECMULT_GEN_KB);
+    } else if (format != NULL && strcmp(format, "json") == 0) {
+        printf("{\"name\": \"%s\", \"contexts\": \"%s\", \"threads\": %i, \"ops\": %i, \"seconds\": %.6f, "
+               "\"ops_per_sec\": %.1f, \"efficiency\": %.4f, ", name, mode, nthreads, ops, seconds, rate, efficiency);
+        bench_print_config_json();
+        printf("}\n");
+    } else {
+        printf("%s (%s contexts, %i threads): ", name, mode, nthreads);
+        print_number(rate);
+        printf(" ops/s, efficiency ");
+        print_number(efficiency * 100.0);
+        printf("%%\n");
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    static const char *modes[3] = {"shared", "cloned", "separate"};
+    static const struct {
+        const char *name;
+        bench_parallel_op_t op;
+        int iters; /* per thread */
+    } ops[4] = {
+        {"ecdsa_verify", bench_parallel_verify, 2000},
+        {"ecdsa_sign", bench_parallel_sign, 4000},
+        {"rangeproof_verify", bench_parallel_rangeproof, 100},
+        {"ecdh", bench_parallel_ecdh, 2000}
+    };
+    secp256k1_context_t *base;
+    secp256k1_context_t *ctxs[256];
+    bench_parallel_data_t data;
+    unsigned char blind[32];
+    int max_threads, nthreads, mode, op, i;
+
+    max_threads = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+    if (max_threads > 256) {
+        max_threads = 256;
+    }
+
+    base = secp256k1_context_create(BENCH_PARALLEL_FLAGS);
+    for (i = 0; i < 32; i++) data.msg[i] = 1 + i;
+    for (i = 0; i < 32; i++) data.key[i] = 33 + i;
+    for (i = 0; i < 32; i++) blind[i] = 65 + i;
+    data.siglen = 72;
+    CHECK(secp256k1_ecdsa_sign(base, data.msg, data.sig, &data.siglen, data.key, NULL, NULL));
+    data.pubkeylen = 33;
+    CHECK(secp256k1_ec_pubkey_create(base, data.pubkey, &data.pubkeylen, data.key, 1));
+    CHECK(secp256k1_ec_pubkey_parse(base, &data.point, data.pubkey, data.pubkeylen));
+    CHECK(secp256k1_pedersen_commit(base, data.commit, blind, 12345));
+    data.prooflen = sizeof(data.proof);
+    CHECK(secp256k1_rangeproof_sign(base, data.proof, &data.prooflen, 0, data.commit, blind, data.commit, 0, 32, 12345));
+    data.proof64len = sizeof(data.proof64);
+    CHECK(secp256k1_rangeproof_sign(base, data.proof64, &data.proof64len, 0, data.commit, blind, data.commit, 0, 64, 12345));
+
+    for (op = 0; op < 4; op++) {
+        double single = 0.0;
+        if (!bench_match(ops[op].name)) {
+            continue;
+        }
+        for (mode = 0; mode < 3; mode++) {
+            for (nthreads = 1; nthreads <= max_threads; nthreads++) {
+                double seconds, rate;
+                /* Contexts are set up outside of the timed region. */
+                for (i = 0; i < nthreads; i++) {
+                    ctxs[i] = mode == 0 ? base : mode == 1 ? secp256k1_context_clone(base) : secp256k1_context_create(BENCH_PARALLEL_FLAGS);
+                }
+                /* Warm up the tables and the threads. */
+                bench_parallel_run(ctxs, &data, ops[op].op, ops[op].iters / 10 + 1, nthreads);
+                seconds = bench_parallel_run(ctxs, &data, ops[op].op, ops[op].iters, nthreads);
+                rate = (double)ops[op].iters * nthreads / seconds;
+                if (mode == 0 && nthreads == 1) {
+                    single = rate;
+                }
+                /* Efficiency is relative to one thread on the shared context. */
+                bench_parallel_report(ops[op].name, modes[mode], nthreads, ops[op].iters * nthreads, seconds, rate / (single * nthreads));
+                if (mode != 0) {
+                    for (i = 0; i < nthreads; i++) {
+                        secp256k1_context_destroy(ctxs[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    if (bench_match("rangeproof_verify_split")) {
+        double single = 0.0;
+        for (nthreads = 1; nthreads <= max_threads && nthreads <= 32; nthreads++) {
+            double seconds, rate;
+            bench_parallel_split(base, &data, 5, nthreads);
+            seconds = bench_parallel_split(base, &data, 100, nthreads);
+            rate = 100 / seconds;
+            if (nthreads == 1) {
+                single = rate;
+            }
+            bench_parallel_report("rangeproof_verify_split", modes[0], nthreads, 100, seconds, rate / (single * nthreads));
+        }
+    }
+
+    secp256k1_context_destroy(base);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**********************************************************************
+ * Copyright (c) 2015 Gregory Maxwell                                 *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#include <stdint.h>
+
+#include "include/secp256k1.h"
+#include "util.h"
+#include "bench.h"
+
+#define BENCH_TALLY_SIZE 10000
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    unsigned char commits[BENCH_TALLY_SIZE][33];
+    secp256k1_pedersen_commitment parsed[BENCH_TALLY_SIZE];
+    const unsigned char *commitp[BENCH_TALLY_SIZE];
+    const secp256k1_pedersen_commitment *parsedp[BENCH_TALLY_SIZE];
+    int64_t excess;
+} bench_tally_t;
+
+static void bench_tally_setup(void* arg) {
+    int i;
+    int j;
+    static unsigned char blinds[BENCH_TALLY_SIZE][32];
+    static const unsigned char *blindp[BENCH_TALLY_SIZE];
+    bench_tally_t *data = (bench_tally_t*)arg;
+
+    /* The last commitment is negative and balances the blinding factors of all others. */
+    data->excess = 0;
+    for (i = 0; i < BENCH_TALLY_SIZE - 1; i++) {
+        for (j = 0; j < 32; j++) {
+            blinds[i][j] = i + j + 1;
+        }
+        blinds[i][0] = i >> 8;
+        blindp[i] = blinds[i];
+        CHECK(secp256k1_pedersen_commit(data->ctx, data->commits[i], blinds[i], i));
+        data->excess += i;
+    }
+    CHECK(secp256k1_pedersen_blind_sum(data->ctx, blinds[i], blindp, i, i));
+    CHECK(secp256k1_pedersen_commit(data->ctx, data->commits[i], blinds[i], 0));
+    for (i = 0; i < BENCH_TALLY_SIZE; i++) {
+        data->commitp[i] = data->commits[i];
+        CHECK(secp256k1_pedersen_commitment_parse(data->ctx, &data->parsed[i], data->commits[i]));
+        data->parsedp[i] = &data->parsed[i];
+    }
+}
+
+static void bench_tally(void* arg) {
+    int i;
+    bench_tally_t *data = (bench_tally_t*)arg;
+
+    for (i = 0; i < 10; i++) {
+        CHECK(secp256k1_pedersen_verify_tally(data->ctx, data->commitp, BENCH_TALLY_SIZE - 1, &data->commitp[BENCH_TALLY_SIZE - 1], 1, data->excess));
+    }
+}
+
+static void bench_tally_ex(void* arg) {
+    int i;
+    bench_tally_t *data = (bench_tally_t*)arg;
+
+    for (i = 0; i < 10; i++) {
+        CHECK(secp256k1_pedersen_verify_tally_ex(data->ctx, data->parsedp, BENCH_TALLY_SIZE - 1, &data->parsedp[BENCH_TALLY_SIZE - 1], 1, data->excess));
+    }
+}
+
+#define BENCH_COMMIT_BATCH 64
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    unsigned char commits[BENCH_COMMIT_BATCH][33];
+    unsigned char blinds[BENCH_COMMIT_BATCH][32];
+    unsigned char *commitp[BENCH_COMMIT_BATCH];
+    const unsigned char *blindp[BENCH_COMMIT_BATCH];
+    uint64_t values[BENCH_COMMIT_BATCH];
+} bench_commit_t;
+
+static void bench_commit_setup(void* arg) {
+    int i;
+    int j;
+    bench_commit_t *data = (bench_commit_t*)arg;
+
+    for (i = 0; i < BENCH_COMMIT_BATCH; i++) {
+        for (j = 0; j < 32; j++) {
+            data->blinds[i][j] = i + j + 1;
+        }
+        data->blindp[i] = data->blinds[i];
+        data->commitp[i] = data->commits[i];
+        data->values[i] = i;
+    }
+}
+
+static void bench_commit(void* arg) {
+    int i;
+    int j;
+    bench_commit_t *data = (bench_commit_t*)arg;
+
+    for (i = 0; i < 20; i++) {
+        for (j = 0; j < BENCH_COMMIT_BATCH; j++) {
+            CHECK(secp256k1_pedersen_commit(data->ctx, data->commits[j], data->blinds[j], data->values[j]));
+        }
+    }
+}
+
+static void bench_commit_batch(void* arg) {
+    int i;
+    bench_commit_t *data = (bench_commit_t*)arg;
+
+    for (i = 0; i < 20; i++) {
+        CHECK(secp256k1_pedersen_commit_batch(data->ctx, data->commitp, data->blindp, data->values, BENCH_COMMIT_BATCH));
+    }
+}
+
+#define BENCH_BLIND_SUM_SIZE 10000
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    unsigned char blinds[BENCH_BLIND_SUM_SIZE * 32];
+    const unsigned char *blindp[BENCH_BLIND_SUM_SIZE];
+    unsigned char negative[(BENCH_BLIND_SUM_SIZE + 7) / 8];
+    unsigned char sum[32];
+} bench_blind_sum_t;
+
+static void bench_blind_sum_setup(void* arg) {
+    int i;
+    int j;
+    bench_blind_sum_t *data = (bench_blind_sum_t*)arg;
+
+    /* The second half of the factors is negative. */
+    for (i = 0; i < BENCH_BLIND_SUM_SIZE; i++) {
+        for (j = 0; j < 32; j++) {
+            data->blinds[i * 32 + j] = i + j + 1;
+        }
+        data->blinds[i * 32] = i >> 8;
+        data->blindp[i] = &data->blinds[i * 32];
+    }
+    for (i = 0; i < BENCH_BLIND_SUM_SIZE; i++) {
+        if (i >= BENCH_BLIND_SUM_SIZE / 2) {
+            data->negative[i >> 3] |= 1 << (i & 7);
+        } else {
+            data->negative[i >> 3] &= ~(1 << (i & 7));
+        }
+    }
+}
+
+static void bench_blind_sum(void* arg) {
+    int i;
+    bench_blind_sum_t *data = (bench_blind_sum_t*)arg;
+
+    for (i = 0; i < 10; i++) {
+        CHECK(secp256k1_pedersen_blind_sum(data->ctx, data->sum, data->blindp, BENCH_BLIND_SUM_SIZE, BENCH_BLIND_SUM_SIZE / 2));
+    }
+}
+
+static void bench_blind_sum_batch(void* arg) {
+    int i;
+    bench_blind_sum_t *data = (bench_blind_sum_t*)arg;
+
+    for (i = 0; i < 10; i++) {
+        CHECK(secp256k1_pedersen_blind_sum_batch(data->ctx, data->sum, data->blinds, BENCH_BLIND_SUM_SIZE, data->negative));
+    }
+}
+
+int main(void) {
+    static bench_commit_t commit;
+    static bench_tally_t data;
+    static bench_blind_sum_t sum;
+
+    data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_COMMIT);
+    bench_tally_setup(&data);
+
+    run_benchmark("pedersen_verify_tally", bench_tally, NULL, NULL, &data, 10, 10 * BENCH_TALLY_SIZE);
+    run_benchmark("pedersen_verify_tally_ex", bench_tally_ex, NULL, NULL, &data, 10, 10 * BENCH_TALLY_SIZE);
+
+    commit.ctx = data.ctx;
+    run_benchmark("pedersen_commit", bench_commit, bench_commit_setup, NULL, &commit, 10, 20 * BENCH_COMMIT_BATCH);
+    run_benchmark("pedersen_commit_batch", bench_commit_batch, bench_commit_setup, NULL, &commit, 10, 20 * BENCH_COMMIT_BATCH);
+
+    sum.ctx = data.ctx;
+    run_benchmark("pedersen_blind_sum", bench_blind_sum, bench_blind_sum_setup, NULL, &sum, 10, 10 * BENCH_BLIND_SUM_SIZE);
+    run_benchmark("pedersen_blind_sum_batch", bench_blind_sum_batch, bench_blind_sum_setup, NULL, &sum, 10, 10 * BENCH_BLIND_SUM_SIZE);
+
+    secp256k1_context_destroy(data.ctx);
+    return 0;
+}
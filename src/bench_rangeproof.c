@@ -20,6 +20,19 @@ typedef struct {
     uint64_t v;
 } bench_rangeproof_t;
 
+#define BENCH_RANGEPROOF_BATCH 64
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    secp256k1_scratch_space* scratch;
+    unsigned char commits[BENCH_RANGEPROOF_BATCH][33];
+    unsigned char proofs[BENCH_RANGEPROOF_BATCH][5134];
+    const unsigned char *commitp[BENCH_RANGEPROOF_BATCH];
+    const unsigned char *proofp[BENCH_RANGEPROOF_BATCH];
+    int plens[BENCH_RANGEPROOF_BATCH];
+    int min_bits;
+} bench_rangeproof_batch_t;
+
 static void bench_rangeproof_setup(void* arg) {
     int i;
     uint64_t minv;
@@ -49,14 +62,218 @@ static void bench_rangeproof(void* arg) {
     }
 }
 
+/* Rewinding, as a wallet does for every output it scans: with the right nonce, and with another one. */
+static void bench_rangeproof_rewind(void* arg) {
+    int i;
+    bench_rangeproof_t *data = (bench_rangeproof_t*)arg;
+
+    for (i = 0; i < 100; i++) {
+        unsigned char blind[32];
+        uint64_t v, minv, maxv;
+        CHECK(secp256k1_rangeproof_rewind(data->ctx, blind, &v, NULL, NULL, data->commit, &minv, &maxv, data->commit, data->proof, data->len));
+    }
+}
+
+static void bench_rangeproof_rewind_foreign(void* arg) {
+    int i;
+    bench_rangeproof_t *data = (bench_rangeproof_t*)arg;
+
+    for (i = 0; i < 100; i++) {
+        unsigned char blind[32];
+        uint64_t v, minv, maxv;
+        CHECK(!secp256k1_rangeproof_rewind(data->ctx, blind, &v, NULL, NULL, data->blind, &minv, &maxv, data->commit, data->proof, data->len));
+    }
+}
+
+static void bench_rangeproof_sign(void* arg) {
+    int i;
+    bench_rangeproof_t *data = (bench_rangeproof_t*)arg;
+
+    for (i = 0; i < 20; i++) {
+        data->len = 5134;
+        data->blind[0] = i + 1;
+        CHECK(secp256k1_rangeproof_sign(data->ctx, data->proof, &data->len, 0, data->commit, data->blind, data->commit, 0, data->min_bits, data->v));
+    }
+}
+
+static void bench_rangeproof_batch_setup(void* arg) {
+    int i;
+    int j;
+    unsigned char blind[32];
+    bench_rangeproof_batch_t *data = (bench_rangeproof_batch_t*)arg;
+
+    for (i = 0; i < BENCH_RANGEPROOF_BATCH; i++) {
+        for (j = 0; j < 32; j++) blind[j] = i + j + 1;
+        CHECK(secp256k1_pedersen_commit(data->ctx, data->commits[i], blind, i));
+        data->plens[i] = 5134;
+        CHECK(secp256k1_rangeproof_sign(data->ctx, data->proofs[i], &data->plens[i], 0, data->commits[i], blind, data->commits[i], 0, data->min_bits, i));
+        data->commitp[i] = data->commits[i];
+        data->proofp[i] = data->proofs[i];
+    }
+}
+
+static void bench_rangeproof_batch(void* arg) {
+    int i;
+    uint64_t minv[BENCH_RANGEPROOF_BATCH];
+    uint64_t maxv[BENCH_RANGEPROOF_BATCH];
+    bench_rangeproof_batch_t *data = (bench_rangeproof_batch_t*)arg;
+
+    for (i = 0; i < 1000 / BENCH_RANGEPROOF_BATCH + 1; i++) {
+        CHECK(secp256k1_rangeproof_verify_batch(data->ctx, data->scratch, data->commitp, data->proofp, data->plens, BENCH_RANGEPROOF_BATCH, minv, maxv));
+    }
+}
+
+/* The proof shapes the suite sweeps: the exponent and min_bits given to the signer, and the value and minimum,
+ * from an exact value proof to the full 64 bits. How the remaining bits are split into rings is up to
+ * secp256k1_range_proveparams; the mantissa it chose and the resulting proof size are part of each benchmark's
+ * name, as "rangeproof_<op>_e<exp>_m<mantissa>_<size>b". */
+typedef struct {
+    int exp;
+    int min_bits;
+    uint64_t value;
+    uint64_t min_value;
+} bench_rangeproof_shape_t;
+
+static const bench_rangeproof_shape_t bench_rangeproof_shapes[] = {
+    {-1, 0, 123456789, 0},
+    {0, 0, 1000, 0},
+    {0, 0, 123456789, 0},
+    {0, 32, 123456789, 0},
+    {0, 52, 123456789, 0},
+    {0, 64, 123456789, 0},
+    {2, 32, 123456700, 0},
+    {4, 32, 123450000, 0},
+    {3, 0, 120000000, 100000000},
+    {8, 0, 2100000000000000ULL, 0}
+};
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    bench_rangeproof_shape_t shape;
+    unsigned char commit[33];
+    unsigned char blind[32];
+    unsigned char proof[5134];
+    int len;
+} bench_rangeproof_suite_t;
+
+static void bench_rangeproof_suite_setup(void* arg) {
+    int i;
+    uint64_t minv;
+    uint64_t maxv;
+    bench_rangeproof_suite_t *data = (bench_rangeproof_suite_t*)arg;
+
+    for (i = 0; i < 32; i++) data->blind[i] = i + 1;
+    CHECK(secp256k1_pedersen_commit(data->ctx, data->commit, data->blind, data->shape.value));
+    data->len = 5134;
+    CHECK(secp256k1_rangeproof_sign(data->ctx, data->proof, &data->len, data->shape.min_value, data->commit, data->blind, data->commit,
+     data->shape.exp, data->shape.min_bits, data->shape.value));
+    CHECK(secp256k1_rangeproof_verify(data->ctx, &minv, &maxv, data->commit, data->proof, data->len));
+}
+
+static void bench_rangeproof_suite_sign(void* arg) {
+    int i;
+    bench_rangeproof_suite_t *data = (bench_rangeproof_suite_t*)arg;
+
+    for (i = 0; i < 5; i++) {
+        data->len = 5134;
+        CHECK(secp256k1_rangeproof_sign(data->ctx, data->proof, &data->len, data->shape.min_value, data->commit, data->blind, data->commit,
+         data->shape.exp, data->shape.min_bits, data->shape.value));
+    }
+}
+
+static void bench_rangeproof_suite_verify(void* arg) {
+    int i;
+    bench_rangeproof_suite_t *data = (bench_rangeproof_suite_t*)arg;
+
+    for (i = 0; i < 20; i++) {
+        uint64_t minv, maxv;
+        CHECK(secp256k1_rangeproof_verify(data->ctx, &minv, &maxv, data->commit, data->proof, data->len));
+    }
+}
+
+static void bench_rangeproof_suite_rewind(void* arg) {
+    int i;
+    bench_rangeproof_suite_t *data = (bench_rangeproof_suite_t*)arg;
+
+    for (i = 0; i < 20; i++) {
+        unsigned char blind[32];
+        uint64_t v, minv, maxv;
+        CHECK(secp256k1_rangeproof_rewind(data->ctx, blind, &v, NULL, NULL, data->commit, &minv, &maxv, data->commit, data->proof, data->len));
+    }
+}
+
+static void bench_rangeproof_suite_info(void* arg) {
+    int i;
+    bench_rangeproof_suite_t *data = (bench_rangeproof_suite_t*)arg;
+
+    for (i = 0; i < 10000; i++) {
+        int exp, mantissa;
+        uint64_t minv, maxv;
+        CHECK(secp256k1_rangeproof_info(data->ctx, &exp, &mantissa, &minv, &maxv, data->proof, data->len));
+    }
+}
+
+static void bench_rangeproof_suite(secp256k1_context_t *ctx) {
+    static bench_rangeproof_suite_t data;
+    char name[64];
+    size_t i;
+
+    data.ctx = ctx;
+    for (i = 0; i < sizeof(bench_rangeproof_shapes) / sizeof(bench_rangeproof_shapes[0]); i++) {
+        int exp, mantissa;
+        uint64_t minv, maxv;
+        data.shape = bench_rangeproof_shapes[i];
+        bench_rangeproof_suite_setup(&data);
+        CHECK(secp256k1_rangeproof_info(ctx, &exp, &mantissa, &minv, &maxv, data.proof, data.len));
+        sprintf(name, "rangeproof_sign_e%i_m%i_%ib", exp, mantissa, data.len);
+        run_benchmark(name, bench_rangeproof_suite_sign, bench_rangeproof_suite_setup, NULL, &data, 10, 5);
+        sprintf(name, "rangeproof_verify_e%i_m%i_%ib", exp, mantissa, data.len);
+        run_benchmark(name, bench_rangeproof_suite_verify, bench_rangeproof_suite_setup, NULL, &data, 10, 20);
+        sprintf(name, "rangeproof_rewind_e%i_m%i_%ib", exp, mantissa, data.len);
+        run_benchmark(name, bench_rangeproof_suite_rewind, bench_rangeproof_suite_setup, NULL, &data, 10, 20);
+        sprintf(name, "rangeproof_info_e%i_m%i_%ib", exp, mantissa, data.len);
+        run_benchmark(name, bench_rangeproof_suite_info, bench_rangeproof_suite_setup, NULL, &data, 10, 10000);
+    }
+}
+
+/* With --enable-op-counters, print what a single verification costs. */
+static void bench_rangeproof_counters(bench_rangeproof_t *data) {
+    secp256k1_op_counters c;
+    uint64_t minv, maxv;
+    bench_rangeproof_setup(data);
+    secp256k1_debug_get_counters(&c, 1);
+    CHECK(secp256k1_rangeproof_verify(data->ctx, &minv, &maxv, data->commit, data->proof, data->len));
+    if (secp256k1_debug_get_counters(&c, 1)) {
+        printf("rangeproof_verify (%i bits) operations: %lu fe_mul, %lu fe_sqr, %lu fe_inv, %lu fe_inv_var, %lu fe_sqrt_var, "
+               "%lu gej_add_var, %lu gej_double_var, %lu ecmult, %lu ecmult_multi (%lu points), %lu ecmult_gen, %lu ecmult_gen2\n",
+               data->min_bits, (unsigned long)c.fe_mul, (unsigned long)c.fe_sqr, (unsigned long)c.fe_inv, (unsigned long)c.fe_inv_var,
+               (unsigned long)c.fe_sqrt_var, (unsigned long)c.gej_add_var, (unsigned long)c.gej_double_var, (unsigned long)c.ecmult,
+               (unsigned long)c.ecmult_multi, (unsigned long)c.ecmult_multi_points, (unsigned long)c.ecmult_gen, (unsigned long)c.ecmult_gen2);
+    }
+}
+
 int main(void) {
     bench_rangeproof_t data;
+    static bench_rangeproof_batch_t batch;
 
     data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_COMMIT | SECP256K1_CONTEXT_RANGEPROOF);
 
     data.min_bits = 32;
 
+    bench_rangeproof_counters(&data);
     run_benchmark("rangeproof_verif_bit", bench_rangeproof, bench_rangeproof_setup, NULL, &data, 10, 1000 * data.min_bits);
+    run_benchmark("rangeproof_sign", bench_rangeproof_sign, bench_rangeproof_setup, NULL, &data, 10, 20);
+    run_benchmark("rangeproof_rewind", bench_rangeproof_rewind, bench_rangeproof_setup, NULL, &data, 10, 100);
+    run_benchmark("rangeproof_rewind_foreign", bench_rangeproof_rewind_foreign, bench_rangeproof_setup, NULL, &data, 10, 100);
+
+    batch.ctx = data.ctx;
+    batch.min_bits = data.min_bits;
+    batch.scratch = secp256k1_scratch_space_create(batch.ctx, BENCH_RANGEPROOF_BATCH * SECP256K1_RANGEPROOF_SCRATCH_SIZE);
+    run_benchmark("rangeproof_verify_batch_bit", bench_rangeproof_batch, bench_rangeproof_batch_setup, NULL, &batch, 10,
+     (1000 / BENCH_RANGEPROOF_BATCH + 1) * BENCH_RANGEPROOF_BATCH * batch.min_bits);
+    secp256k1_scratch_space_destroy(batch.scratch);
+
+    bench_rangeproof_suite(data.ctx);
 
     secp256k1_context_destroy(data.ctx);
     return 0;
@@ -8,10 +8,18 @@
 #include "util.h"
 #include "bench.h"
 
+#define BENCH_RECOVER_BATCH 100
+
 typedef struct {
     secp256k1_context_t *ctx;
     unsigned char msg[32];
     unsigned char sig[64];
+    unsigned char msgs[BENCH_RECOVER_BATCH][32];
+    unsigned char sigs[BENCH_RECOVER_BATCH][64];
+    const unsigned char *msgptr[BENCH_RECOVER_BATCH];
+    const unsigned char *sigptr[BENCH_RECOVER_BATCH];
+    int recids[BENCH_RECOVER_BATCH];
+    secp256k1_pubkey pubkeys[BENCH_RECOVER_BATCH];
 } bench_recover_t;
 
 void bench_recover(void* arg) {
@@ -39,12 +47,51 @@ void bench_recover_setup(void* arg) {
     for (i = 0; i < 64; i++) data->sig[i] = 65 + i;
 }
 
+void bench_recover_single(void* arg) {
+    int i;
+    bench_recover_t *data = (bench_recover_t*)arg;
+    unsigned char pubkey[33];
+
+    for (i = 0; i < 20000; i++) {
+        int pubkeylen = 33;
+        int j = i % BENCH_RECOVER_BATCH;
+        CHECK(secp256k1_ecdsa_recover_compact(data->ctx, data->msgs[j], data->sigs[j], pubkey, &pubkeylen, 1, data->recids[j]));
+    }
+}
+
+void bench_recover_batch(void* arg) {
+    int i;
+    bench_recover_t *data = (bench_recover_t*)arg;
+
+    for (i = 0; i < 20000 / BENCH_RECOVER_BATCH; i++) {
+        CHECK(secp256k1_ecdsa_recover_batch(data->ctx, data->pubkeys, NULL, data->sigptr, data->recids, data->msgptr, BENCH_RECOVER_BATCH));
+    }
+}
+
+void bench_recover_batch_setup(void* arg) {
+    int i, j;
+    bench_recover_t *data = (bench_recover_t*)arg;
+    unsigned char key[32];
+
+    for (i = 0; i < BENCH_RECOVER_BATCH; i++) {
+        for (j = 0; j < 32; j++) {
+            key[j] = 1 + i + j;
+            data->msgs[i][j] = 33 + i + j;
+        }
+        CHECK(secp256k1_ecdsa_sign_compact(data->ctx, data->msgs[i], data->sigs[i], key, NULL, NULL, &data->recids[i]));
+        data->msgptr[i] = data->msgs[i];
+        data->sigptr[i] = data->sigs[i];
+    }
+}
+
 int main(void) {
     bench_recover_t data;
 
-    data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+    data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_SIGN);
 
     run_benchmark("ecdsa_recover", bench_recover, bench_recover_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_recover_signed", bench_recover_single, bench_recover_batch_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_recover_batch", bench_recover_batch, bench_recover_batch_setup, NULL, &data, 10, 20000);
 
     secp256k1_context_destroy(data.ctx);
     return 0;
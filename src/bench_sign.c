@@ -38,12 +38,195 @@ static void bench_sign(void* arg) {
     }
 }
 
+/* A signer with one long-lived key: only the message changes between signatures. */
+static void bench_sign_ex(void* arg) {
+    int i;
+    bench_sign_t *data = (bench_sign_t*)arg;
+
+    secp256k1_ecdsa_signature sig;
+    for (i = 0; i < 20000; i++) {
+        int j;
+        CHECK(secp256k1_ecdsa_sign_ex(data->ctx, &sig, data->msg, data->key, NULL, NULL));
+        for (j = 0; j < 32; j++) {
+            data->msg[j] = sig.data[j];        /* Move former R to message. */
+        }
+    }
+}
+
+static void bench_sign_keypair(void* arg) {
+    int i;
+    bench_sign_t *data = (bench_sign_t*)arg;
+
+    secp256k1_keypair keypair;
+    secp256k1_ecdsa_signature sig;
+    CHECK(secp256k1_keypair_create(data->ctx, &keypair, data->key));
+    for (i = 0; i < 20000; i++) {
+        int j;
+        CHECK(secp256k1_ecdsa_sign_keypair(data->ctx, &sig, data->msg, &keypair, NULL, NULL));
+        for (j = 0; j < 32; j++) {
+            data->msg[j] = sig.data[j];        /* Move former R to message. */
+        }
+    }
+}
+
+#define BENCH_KEYGEN_BATCH 256
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    unsigned char keys[BENCH_KEYGEN_BATCH][32];
+    const unsigned char *keyp[BENCH_KEYGEN_BATCH];
+    secp256k1_pubkey pubkeys[BENCH_KEYGEN_BATCH];
+} bench_keygen_t;
+
+static void bench_keygen_setup(void* arg) {
+    int i;
+    int j;
+    bench_keygen_t *data = (bench_keygen_t*)arg;
+
+    for (i = 0; i < BENCH_KEYGEN_BATCH; i++) {
+        for (j = 0; j < 32; j++) data->keys[i][j] = i + j + 65;
+        data->keyp[i] = data->keys[i];
+    }
+}
+
+static void bench_keygen(void* arg) {
+    int i;
+    int j;
+    bench_keygen_t *data = (bench_keygen_t*)arg;
+
+    for (i = 0; i < 40; i++) {
+        for (j = 0; j < BENCH_KEYGEN_BATCH; j++) {
+            CHECK(secp256k1_ec_pubkey_create_ex(data->ctx, &data->pubkeys[j], data->keys[j]));
+        }
+    }
+}
+
+static void bench_keygen_batch(void* arg) {
+    int i;
+    bench_keygen_t *data = (bench_keygen_t*)arg;
+
+    for (i = 0; i < 40; i++) {
+        CHECK(secp256k1_ec_pubkey_create_batch(data->ctx, data->pubkeys, data->keyp, BENCH_KEYGEN_BATCH));
+    }
+}
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    unsigned char msgs[BENCH_KEYGEN_BATCH][32];
+    unsigned char keys[BENCH_KEYGEN_BATCH][32];
+    const unsigned char *msgp[BENCH_KEYGEN_BATCH];
+    const unsigned char *keyp[BENCH_KEYGEN_BATCH];
+    secp256k1_ecdsa_signature sigs[BENCH_KEYGEN_BATCH];
+} bench_sign_batch_t;
+
+static void bench_sign_batch_setup(void* arg) {
+    int i;
+    int j;
+    bench_sign_batch_t *data = (bench_sign_batch_t*)arg;
+
+    for (i = 0; i < BENCH_KEYGEN_BATCH; i++) {
+        for (j = 0; j < 32; j++) {
+            data->msgs[i][j] = i + j + 1;
+            data->keys[i][j] = i + j + 65;
+        }
+        data->msgp[i] = data->msgs[i];
+        data->keyp[i] = data->keys[i];
+    }
+}
+
+static void bench_sign_individual(void* arg) {
+    int i;
+    int j;
+    bench_sign_batch_t *data = (bench_sign_batch_t*)arg;
+
+    for (i = 0; i < 40; i++) {
+        for (j = 0; j < BENCH_KEYGEN_BATCH; j++) {
+            CHECK(secp256k1_ecdsa_sign_ex(data->ctx, &data->sigs[j], data->msgs[j], data->keys[j], NULL, NULL));
+            data->msgs[j][0] = data->sigs[j].data[0];
+        }
+    }
+}
+
+static void bench_sign_batch(void* arg) {
+    int i;
+    int j;
+    bench_sign_batch_t *data = (bench_sign_batch_t*)arg;
+
+    for (i = 0; i < 40; i++) {
+        CHECK(secp256k1_ecdsa_sign_batch(data->ctx, data->sigs, NULL, data->msgp, data->keyp, BENCH_KEYGEN_BATCH));
+        for (j = 0; j < BENCH_KEYGEN_BATCH; j++) {
+            data->msgs[j][0] = data->sigs[j].data[0];
+        }
+    }
+}
+
+typedef struct {
+    secp256k1_context_t* ctx;
+    unsigned char tweaks[BENCH_KEYGEN_BATCH][32];
+    const unsigned char *tweakp[BENCH_KEYGEN_BATCH];
+    secp256k1_pubkey pubkeys[BENCH_KEYGEN_BATCH];
+} bench_tweak_batch_t;
+
+static void bench_tweak_batch_setup(void* arg) {
+    int i;
+    int j;
+    unsigned char key[32];
+    bench_tweak_batch_t *data = (bench_tweak_batch_t*)arg;
+
+    for (j = 0; j < 32; j++) key[j] = j + 65;
+    for (i = 0; i < BENCH_KEYGEN_BATCH; i++) {
+        for (j = 0; j < 32; j++) data->tweaks[i][j] = i + j + 1;
+        data->tweakp[i] = data->tweaks[i];
+        CHECK(secp256k1_ec_pubkey_create_ex(data->ctx, &data->pubkeys[i], key));
+    }
+}
+
+static void bench_tweak_individual(void* arg) {
+    int i;
+    int j;
+    bench_tweak_batch_t *data = (bench_tweak_batch_t*)arg;
+
+    for (i = 0; i < 40; i++) {
+        for (j = 0; j < BENCH_KEYGEN_BATCH; j++) {
+            CHECK(secp256k1_ec_pubkey_tweak_add_ex(data->ctx, &data->pubkeys[j], data->tweaks[j]));
+        }
+    }
+}
+
+static void bench_tweak_batch(void* arg) {
+    int i;
+    bench_tweak_batch_t *data = (bench_tweak_batch_t*)arg;
+
+    for (i = 0; i < 40; i++) {
+        CHECK(secp256k1_ec_pubkey_tweak_add_batch(data->ctx, data->pubkeys, data->tweakp, BENCH_KEYGEN_BATCH));
+    }
+}
+
 int main(void) {
     bench_sign_t data;
+    static bench_keygen_t keygen;
+    static bench_sign_batch_t signbatch;
+    static bench_tweak_batch_t tweakbatch;
 
     data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
 
     run_benchmark("ecdsa_sign", bench_sign, bench_sign_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_sign_ex", bench_sign_ex, bench_sign_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_sign_keypair", bench_sign_keypair, bench_sign_setup, NULL, &data, 10, 20000);
+
+    keygen.ctx = data.ctx;
+    run_benchmark("ec_pubkey_create", bench_keygen, bench_keygen_setup, NULL, &keygen, 10, 40 * BENCH_KEYGEN_BATCH);
+    run_benchmark("ec_pubkey_create_batch", bench_keygen_batch, bench_keygen_setup, NULL, &keygen, 10, 40 * BENCH_KEYGEN_BATCH);
+
+    signbatch.ctx = data.ctx;
+    run_benchmark("ecdsa_sign_individual", bench_sign_individual, bench_sign_batch_setup, NULL, &signbatch, 10, 40 * BENCH_KEYGEN_BATCH);
+    run_benchmark("ecdsa_sign_batch", bench_sign_batch, bench_sign_batch_setup, NULL, &signbatch, 10, 40 * BENCH_KEYGEN_BATCH);
+
+    /* Tweaking one key at a time uses the verification tables. */
+    tweakbatch.ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    run_benchmark("ec_pubkey_tweak_add", bench_tweak_individual, bench_tweak_batch_setup, NULL, &tweakbatch, 10, 40 * BENCH_KEYGEN_BATCH);
+    run_benchmark("ec_pubkey_tweak_add_batch", bench_tweak_batch, bench_tweak_batch_setup, NULL, &tweakbatch, 10, 40 * BENCH_KEYGEN_BATCH);
+    secp256k1_context_destroy(tweakbatch.ctx);
 
     secp256k1_context_destroy(data.ctx);
     return 0;
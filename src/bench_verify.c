@@ -19,6 +19,10 @@ typedef struct {
     int siglen;
     unsigned char pubkey[33];
     int pubkeylen;
+    secp256k1_ecdsa_signature sigobj;
+    secp256k1_pubkey pubkeyobj;
+    secp256k1_pubkey_precomp *precomp;
+    secp256k1_sigcache *cache;
 } benchmark_verify_t;
 
 static void benchmark_verify(void* arg) {
@@ -36,7 +40,59 @@ static void benchmark_verify(void* arg) {
     }
 }
 
-int main(void) {
+/* The parsed-object interface, with the message varied instead of the signature. */
+static void benchmark_verify_ex(void* arg) {
+    int i;
+    benchmark_verify_t* data = (benchmark_verify_t*)arg;
+
+    for (i = 0; i < 20000; i++) {
+        data->msg[31] ^= (i & 0xFF);
+        data->msg[30] ^= ((i >> 8) & 0xFF);
+        CHECK(secp256k1_ecdsa_verify_ex(data->ctx, &data->sigobj, data->msg, &data->pubkeyobj) == (i == 0));
+        data->msg[31] ^= (i & 0xFF);
+        data->msg[30] ^= ((i >> 8) & 0xFF);
+    }
+}
+
+static void benchmark_verify_precomp(void* arg) {
+    int i;
+    benchmark_verify_t* data = (benchmark_verify_t*)arg;
+
+    for (i = 0; i < 20000; i++) {
+        data->msg[31] ^= (i & 0xFF);
+        data->msg[30] ^= ((i >> 8) & 0xFF);
+        CHECK(secp256k1_ecdsa_verify_precomp(data->ctx, &data->sigobj, data->msg, data->precomp) == (i == 0));
+        data->msg[31] ^= (i & 0xFF);
+        data->msg[30] ^= ((i >> 8) & 0xFF);
+    }
+}
+
+/* A hit on every iteration but the first, which fills the cache. */
+static void benchmark_verify_cached(void* arg) {
+    int i;
+    benchmark_verify_t* data = (benchmark_verify_t*)arg;
+
+    for (i = 0; i < 20000; i++) {
+        CHECK(secp256k1_ecdsa_verify_cached(data->ctx, data->cache, &data->sigobj, data->msg, &data->pubkeyobj) == 1);
+    }
+}
+
+/* Report the verification time for a range of table sizes, with "bench_verify window". */
+static void benchmark_verify_windows(benchmark_verify_t* data) {
+    static const int windows[] = {6, 8, 10, 12, 14, 15, 16, 17, 18};
+    secp256k1_context_t *ctx = data->ctx;
+    char name[64];
+    size_t i;
+    for (i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+        data->ctx = secp256k1_context_create_window(SECP256K1_CONTEXT_VERIFY, windows[i]);
+        sprintf(name, "ecdsa_verify_window_%i (%luKiB)", windows[i], (64ul << (windows[i] - 2)) >> 10);
+        run_benchmark(name, benchmark_verify, NULL, NULL, data, 3, 20000);
+        secp256k1_context_destroy(data->ctx);
+    }
+    data->ctx = ctx;
+}
+
+int main(int argc, char **argv) {
     int i;
     benchmark_verify_t data;
 
@@ -49,8 +105,23 @@ int main(void) {
     data.pubkeylen = 33;
     CHECK(secp256k1_ec_pubkey_create(data.ctx, data.pubkey, &data.pubkeylen, data.key, 1));
 
+    CHECK(secp256k1_ecdsa_signature_parse_der(data.ctx, &data.sigobj, data.sig, data.siglen));
+    CHECK(secp256k1_ec_pubkey_parse(data.ctx, &data.pubkeyobj, data.pubkey, data.pubkeylen));
+    data.precomp = secp256k1_pubkey_precomp_create(data.ctx, &data.pubkeyobj);
+    CHECK(data.precomp != NULL);
+    data.cache = secp256k1_sigcache_create(data.ctx, 1024, data.key);
+    CHECK(data.cache != NULL);
+
     run_benchmark("ecdsa_verify", benchmark_verify, NULL, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_verify_ex", benchmark_verify_ex, NULL, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_verify_precomp", benchmark_verify_precomp, NULL, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_verify_cached", benchmark_verify_cached, NULL, NULL, &data, 10, 20000);
+    if (argc > 1 && strcmp(argv[1], "window") == 0) {
+        benchmark_verify_windows(&data);
+    }
 
+    secp256k1_pubkey_precomp_destroy(data.precomp);
+    secp256k1_sigcache_destroy(data.cache);
     secp256k1_context_destroy(data.ctx);
     return 0;
 }
@@ -13,10 +13,26 @@
 #include "group.h"
 #include "ecmult.h"
 #include "ecmult_gen.h"
+#include "scratch.h"
 
 int secp256k1_borromean_verify(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_scalar_t *evalues, const unsigned char *e0, const secp256k1_scalar_t *s,
  const secp256k1_gej_t *pubs, const int *rsizes, int nrings, const unsigned char *m, int mlen);
 
+/** Scratch space needed per ring by secp256k1_borromean_verify_batch, which makes
+ *  SECP256K1_BORROMEAN_VERIFY_BATCH_OBJECTS allocations in total. */
+#define SECP256K1_BORROMEAN_VERIFY_BATCH_RING_SIZE (sizeof(secp256k1_scalar_t) + sizeof(secp256k1_gej_t) + 2 * sizeof(secp256k1_fe_t) + 33 + sizeof(int))
+#define SECP256K1_BORROMEAN_VERIFY_BATCH_OBJECTS 6
+
+/** Verify n Borromean ring signatures at once. Signature k has nrings[k] rings, challenge e0[k] and the
+ *  mlen byte message &m[k * mlen]; the ring sizes, s values and pubkeys of all signatures are concatenated
+ *  in rsizes, s and pubs. Returns 1 if all of them verify, and 0 if any fails or scratch is too small. */
+static int secp256k1_borromean_verify_batch(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_scratch_t *scratch,
+ const unsigned char * const *e0, const secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const int *rsizes, const int *nrings,
+ size_t n, const unsigned char *m, int mlen);
+
+/** Number of rings whose points secp256k1_borromean_sign serializes together. */
+#define SECP256K1_BORROMEAN_SIGN_CHUNK 32
+
 int secp256k1_borromean_sign(const secp256k1_ecmult_context_t* ecmult_ctx, const secp256k1_ecmult_gen_context_t *ecmult_gen_ctx,
  unsigned char *e0, secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const secp256k1_scalar_t *k, const secp256k1_scalar_t *sec,
  const int *rsizes, const int *secidx, int nrings, const unsigned char *m, int mlen);
@@ -37,6 +37,212 @@ SECP256K1_INLINE static void secp256k1_borromean_hash(unsigned char *hash, const
     secp256k1_sha256_finalize(&sha256_en, hash);
 }
 
+/* Borromean hashes waiting to be computed four at a time, each into its own scalar. */
+typedef struct {
+    const unsigned char *e[4];
+    const unsigned char *m[4];
+    uint32_t pos[8]; /* big endian ring and member index of each hash */
+    secp256k1_scalar_t *out[4];
+    int n;
+    int ok; /* cleared if any hash so far was not a valid nonzero scalar */
+} secp256k1_borromean_hash_queue_t;
+
+static void secp256k1_borromean_hash_queue_init(secp256k1_borromean_hash_queue_t *q) {
+    q->n = 0;
+    q->ok = 1;
+}
+
+/* Compute the queued hashes, all of which must have the same mlen and elen. */
+static void secp256k1_borromean_hash_queue_flush(secp256k1_borromean_hash_queue_t *q, int mlen, int elen) {
+    secp256k1_sha256_t sha256_en[4];
+    const unsigned char *data[4];
+    unsigned char out[128];
+    int overflow;
+    int i;
+    if (q->n == 1) {
+        secp256k1_borromean_hash(out, q->m[0], mlen, q->e[0], elen, BE32(q->pos[0]), BE32(q->pos[1]));
+    } else if (q->n > 1) {
+        for (i = 0; i < 4; i++) {
+            /* Unused lanes repeat the first hash. */
+            const int k = i < q->n ? i : 0;
+            secp256k1_sha256_initialize(&sha256_en[i]);
+            data[i] = q->e[k];
+        }
+        secp256k1_sha256_write_x4(sha256_en, data, elen);
+        for (i = 0; i < 4; i++) {
+            data[i] = q->m[i < q->n ? i : 0];
+        }
+        secp256k1_sha256_write_x4(sha256_en, data, mlen);
+        for (i = 0; i < 4; i++) {
+            data[i] = (const unsigned char *)&q->pos[2 * (i < q->n ? i : 0)];
+        }
+        secp256k1_sha256_write_x4(sha256_en, data, 8);
+        secp256k1_sha256_finalize_x4(sha256_en, out);
+    }
+    for (i = 0; i < q->n; i++) {
+        secp256k1_scalar_set_b32(q->out[i], &out[32 * i], &overflow);
+        q->ok &= !overflow && !secp256k1_scalar_is_zero(q->out[i]);
+    }
+    q->n = 0;
+}
+
+/* Queue *out = to_scalar(secp256k1_borromean_hash(m, mlen, e, elen, ridx, eidx)). m and e must stay
+ * valid until the next flush. */
+static void secp256k1_borromean_hash_queue_add(secp256k1_borromean_hash_queue_t *q, secp256k1_scalar_t *out,
+ const unsigned char *m, int mlen, const unsigned char *e, int elen, int ridx, int eidx) {
+    q->e[q->n] = e;
+    q->m[q->n] = m;
+    q->pos[2 * q->n] = BE32((uint32_t)ridx);
+    q->pos[2 * q->n + 1] = BE32((uint32_t)eidx);
+    q->out[q->n] = out;
+    q->n++;
+    if (q->n == 4) {
+        secp256k1_borromean_hash_queue_flush(q, mlen, elen);
+    }
+}
+
+/* Advance all rings of the n signatures to their last point, which is left serialized in rbuf in ring order. ens, rgej,
+ * rz, rzi and rpos must have room for the total number of rings, and rbuf for 33 bytes per ring. If evalues is not NULL,
+ * the challenge of every pubkey is saved in it. ring0 is added to every ring index that is hashed, so that (with n == 1)
+ * the rings of one signature can be processed in several parts. */
+static int secp256k1_borromean_verify_rings(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_scalar_t *evalues, secp256k1_scalar_t *ens,
+ secp256k1_gej_t *rgej, secp256k1_fe_t *rz, secp256k1_fe_t *rzi, unsigned char *rbuf, int *rpos, const unsigned char * const *e0,
+ const secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const int *rsizes, const int *nrings, size_t n, int ring0,
+ const unsigned char *m, int mlen) {
+    secp256k1_ge_t rge;
+    secp256k1_borromean_hash_queue_t q;
+    size_t k;
+    size_t r;
+    size_t nr;
+    int i;
+    int j;
+    int count;
+    int size;
+    int maxsize;
+    count = 0;
+    maxsize = 0;
+    r = 0;
+    secp256k1_borromean_hash_queue_init(&q);
+    for (k = 0; k < n; k++) {
+        VERIFY_CHECK(nrings[k] > 0);
+        for (i = 0; i < nrings[k]; i++) {
+            DEBUG_CHECK(INT_MAX - count > rsizes[r]);
+            secp256k1_borromean_hash_queue_add(&q, &ens[r], &m[k * mlen], mlen, e0[k], 32, ring0 + i, 0);
+            rpos[r] = count;
+            count += rsizes[r];
+            if (rsizes[r] > maxsize) {
+                maxsize = rsizes[r];
+            }
+            r++;
+        }
+    }
+    secp256k1_borromean_hash_queue_flush(&q, mlen, 32);
+    if (!q.ok) {
+        return 0;
+    }
+    /* Member j of a ring only depends on member j - 1 of the same ring, so all rings advance one
+     * member at a time and the resulting points share a single batch inversion and are hashed four
+     * at a time. */
+    for (j = 0; j < maxsize; j++) {
+        nr = 0;
+        for (r = 0, k = 0; k < n; k++) {
+            for (i = 0; i < nrings[k]; i++, r++) {
+                if (j < rsizes[r]) {
+                    const int idx = rpos[r] + j;
+                    if (secp256k1_scalar_is_zero(&s[idx]) || secp256k1_gej_is_infinity(&pubs[idx])) {
+                        return 0;
+                    }
+                    if (evalues) {
+                        evalues[idx] = ens[r];
+                    }
+                    secp256k1_ecmult(ecmult_ctx, &rgej[nr], &pubs[idx], &ens[r], &s[idx]);
+                    if (secp256k1_gej_is_infinity(&rgej[nr])) {
+                        return 0;
+                    }
+                    rz[nr] = rgej[nr].z;
+                    nr++;
+                }
+            }
+        }
+        secp256k1_fe_inv_all_var(nr, rzi, rz);
+        nr = 0;
+        for (r = 0, k = 0; k < n; k++) {
+            for (i = 0; i < nrings[k]; i++, r++) {
+                if (j < rsizes[r]) {
+                    /* Rings end at different steps, so the last point of each stays in rbuf to hash them
+                     * in ring order. */
+                    secp256k1_ge_set_gej_zinv(&rge, &rgej[nr], &rzi[nr]);
+                    secp256k1_eckey_pubkey_serialize(&rge, &rbuf[r * 33], &size, 1);
+                    nr++;
+                    if (j != rsizes[r] - 1) {
+                        secp256k1_borromean_hash_queue_add(&q, &ens[r], &m[k * mlen], mlen, &rbuf[r * 33], 33, ring0 + i, j + 1);
+                    }
+                }
+            }
+        }
+        secp256k1_borromean_hash_queue_flush(&q, mlen, 33);
+        if (!q.ok) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Check e0 against the last points of the nrings rings of a signature, serialized in ring order in rbuf. */
+static int secp256k1_borromean_verify_e0(const unsigned char *rbuf, int nrings, const unsigned char *e0, const unsigned char *m, int mlen) {
+    secp256k1_sha256_t sha256_e0;
+    unsigned char tmp[32];
+    int i;
+    secp256k1_sha256_initialize(&sha256_e0);
+    for (i = 0; i < nrings; i++) {
+        secp256k1_sha256_write(&sha256_e0, &rbuf[i * 33], 33);
+    }
+    secp256k1_sha256_write(&sha256_e0, m, mlen);
+    secp256k1_sha256_finalize(&sha256_e0, tmp);
+    return memcmp(e0, tmp, 32) == 0;
+}
+
+/* As secp256k1_borromean_verify_rings, followed by the check of every e0. */
+static int secp256k1_borromean_verify_batch_inner(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_scalar_t *evalues, secp256k1_scalar_t *ens,
+ secp256k1_gej_t *rgej, secp256k1_fe_t *rz, secp256k1_fe_t *rzi, unsigned char *rbuf, int *rpos, const unsigned char * const *e0,
+ const secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const int *rsizes, const int *nrings, size_t n,
+ const unsigned char *m, int mlen) {
+    size_t k;
+    size_t r;
+    if (!secp256k1_borromean_verify_rings(ecmult_ctx, evalues, ens, rgej, rz, rzi, rbuf, rpos, e0, s, pubs, rsizes, nrings, n, 0, m, mlen)) {
+        return 0;
+    }
+    for (r = 0, k = 0; k < n; r += nrings[k], k++) {
+        if (!secp256k1_borromean_verify_e0(&rbuf[r * 33], nrings[k], e0[k], &m[k * mlen], mlen)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Advance rings first..last-1 of a signature with nrings rings, leaving their last points serialized at &rbuf[33 * first].
+ * Parts covering all rings, in any order and on any threads, followed by secp256k1_borromean_verify_e0 on the whole of rbuf,
+ * verify the signature just like secp256k1_borromean_verify. At most SECP256K1_BORROMEAN_SIGN_CHUNK rings fit in one part. */
+static int secp256k1_borromean_verify_part(const secp256k1_ecmult_context_t* ecmult_ctx, unsigned char *rbuf, const unsigned char *e0,
+ const secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const int *rsizes, int first, int last, const unsigned char *m, int mlen) {
+    secp256k1_scalar_t ens[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_gej_t rgej[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_fe_t rz[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_fe_t rzi[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    int rpos[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    int offset;
+    int nrings;
+    int i;
+    VERIFY_CHECK(first >= 0 && first < last && last - first <= SECP256K1_BORROMEAN_SIGN_CHUNK);
+    offset = 0;
+    for (i = 0; i < first; i++) {
+        offset += rsizes[i];
+    }
+    nrings = last - first;
+    return secp256k1_borromean_verify_rings(ecmult_ctx, NULL, ens, rgej, rz, rzi, &rbuf[33 * first], rpos, &e0, &s[offset], &pubs[offset],
+     &rsizes[first], &nrings, 1, first, m, mlen);
+}
+
 /**  "Borromean" ring signature.
  *   Verifies nrings concurrent ring signatures all sharing a challenge value.
  *   Signature is one s value per pubkey and a hash.
@@ -50,19 +256,24 @@ SECP256K1_INLINE static void secp256k1_borromean_hash(unsigned char *hash, const
  *   | | | en = to_scalar(e)
  *   | | r_i = r
  *   | return e_0 ==== H(r_{0..i}||m)
+ *   The rings are independent until the final hash, so they are advanced together, one pubkey at a time,
+ *   as for a batch of one: the points of each step share a single inversion.
  */
 int secp256k1_borromean_verify(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_scalar_t *evalues, const unsigned char *e0,
  const secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const int *rsizes, int nrings, const unsigned char *m, int mlen) {
-    secp256k1_gej_t rgej;
-    secp256k1_ge_t rge;
-    secp256k1_scalar_t ens;
-    secp256k1_sha256_t sha256_e0;
-    unsigned char tmp[33];
-    int i;
-    int j;
-    int count;
-    int size;
-    int overflow;
+    secp256k1_scalar_t ens_buf[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_gej_t rgej_buf[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_fe_t rz_buf[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_fe_t rzi_buf[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    unsigned char rbuf_buf[33 * SECP256K1_BORROMEAN_SIGN_CHUNK];
+    int rpos_buf[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_scalar_t *ens = ens_buf;
+    secp256k1_gej_t *rgej = rgej_buf;
+    secp256k1_fe_t *rz = rz_buf;
+    secp256k1_fe_t *rzi = rzi_buf;
+    unsigned char *rbuf = rbuf_buf;
+    int *rpos = rpos_buf;
+    int ret;
     VERIFY_CHECK(ecmult_ctx != NULL);
     VERIFY_CHECK(e0 != NULL);
     VERIFY_CHECK(s != NULL);
@@ -70,54 +281,99 @@ int secp256k1_borromean_verify(const secp256k1_ecmult_context_t* ecmult_ctx, sec
     VERIFY_CHECK(rsizes != NULL);
     VERIFY_CHECK(nrings > 0);
     VERIFY_CHECK(m != NULL);
-    count = 0;
-    secp256k1_sha256_initialize(&sha256_e0);
-    for (i = 0; i < nrings; i++) {
-        DEBUG_CHECK(INT_MAX - count > rsizes[i]);
-        secp256k1_borromean_hash(tmp, m, mlen, e0, 32, i, 0);
-        secp256k1_scalar_set_b32(&ens, tmp, &overflow);
-        for (j = 0; j < rsizes[i]; j++) {
-            if (overflow || secp256k1_scalar_is_zero(&s[count]) || secp256k1_scalar_is_zero(&ens) || secp256k1_gej_is_infinity(&pubs[count])) {
-                return 0;
-            }
-            if (evalues) {
-                /*If requested, save the challenges for proof rewind.*/
-                evalues[count] = ens;
-            }
-            secp256k1_ecmult(ecmult_ctx, &rgej, &pubs[count], &ens, &s[count]);
-            if (secp256k1_gej_is_infinity(&rgej)) {
-                return 0;
-            }
-            /* OPT: loop can be hoisted and split to use batch inversion across all the rings; this would make it much faster. */
-            secp256k1_ge_set_gej_var(&rge, &rgej);
-            secp256k1_eckey_pubkey_serialize(&rge, tmp, &size, 1);
-            if (j != rsizes[i] - 1) {
-                secp256k1_borromean_hash(tmp, m, mlen, tmp, 33, i, j + 1);
-                secp256k1_scalar_set_b32(&ens, tmp, &overflow);
-            } else {
-                secp256k1_sha256_write(&sha256_e0, tmp, size);
-            }
-            count++;
-        }
+    /* Range proofs have at most 32 rings; anything larger gets its temporaries from the heap. */
+    if (nrings > SECP256K1_BORROMEAN_SIGN_CHUNK) {
+        ens = (secp256k1_scalar_t *)checked_malloc(sizeof(secp256k1_scalar_t) * nrings);
+        rgej = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * nrings);
+        rz = (secp256k1_fe_t *)checked_malloc(sizeof(secp256k1_fe_t) * nrings);
+        rzi = (secp256k1_fe_t *)checked_malloc(sizeof(secp256k1_fe_t) * nrings);
+        rbuf = (unsigned char *)checked_malloc(33 * nrings);
+        rpos = (int *)checked_malloc(sizeof(int) * nrings);
+    }
+    ret = secp256k1_borromean_verify_batch_inner(ecmult_ctx, evalues, ens, rgej, rz, rzi, rbuf, rpos, &e0, s, pubs, rsizes, &nrings, 1, m, mlen);
+    if (nrings > SECP256K1_BORROMEAN_SIGN_CHUNK) {
+        free(ens);
+        free(rgej);
+        free(rz);
+        free(rzi);
+        free(rbuf);
+        free(rpos);
+    }
+    return ret;
+}
+
+static int secp256k1_borromean_verify_batch(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_scratch_t *scratch,
+ const unsigned char * const *e0, const secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const int *rsizes, const int *nrings,
+ size_t n, const unsigned char *m, int mlen) {
+    size_t checkpoint = secp256k1_scratch_checkpoint(scratch);
+    secp256k1_scalar_t *ens;
+    secp256k1_gej_t *rgej;
+    secp256k1_fe_t *rz;
+    secp256k1_fe_t *rzi;
+    unsigned char *rbuf;
+    int *rpos;
+    size_t total;
+    size_t k;
+    int ret = 0;
+    VERIFY_CHECK(ecmult_ctx != NULL);
+    VERIFY_CHECK(n == 0 || (e0 != NULL && s != NULL && pubs != NULL && rsizes != NULL && nrings != NULL && m != NULL));
+    if (n == 0) {
+        return 1;
+    }
+    total = 0;
+    for (k = 0; k < n; k++) {
+        total += nrings[k];
+    }
+    ens = (secp256k1_scalar_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_scalar_t) * total);
+    rgej = (secp256k1_gej_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_gej_t) * total);
+    rz = (secp256k1_fe_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_fe_t) * total);
+    rzi = (secp256k1_fe_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_fe_t) * total);
+    rbuf = (unsigned char *)secp256k1_scratch_alloc(scratch, 33 * total);
+    rpos = (int *)secp256k1_scratch_alloc(scratch, sizeof(int) * total);
+    if (ens != NULL && rgej != NULL && rz != NULL && rzi != NULL && rbuf != NULL && rpos != NULL) {
+        ret = secp256k1_borromean_verify_batch_inner(ecmult_ctx, NULL, ens, rgej, rz, rzi, rbuf, rpos, e0, s, pubs, rsizes, nrings, n, m, mlen);
+    }
+    secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+    return ret;
+}
+
+/* Serialize the n points a into &rbuf[33 * rings[i]], with a single batch inversion. */
+static void secp256k1_borromean_serialize_all_var(unsigned char *rbuf, const secp256k1_gej_t *a, secp256k1_fe_t *az,
+ secp256k1_fe_t *azi, const int *rings, int n) {
+    secp256k1_ge_t ge;
+    int size;
+    int i;
+    for (i = 0; i < n; i++) {
+        az[i] = a[i].z;
+    }
+    secp256k1_fe_inv_all_var(n, azi, az);
+    for (i = 0; i < n; i++) {
+        secp256k1_ge_set_gej_zinv(&ge, &a[i], &azi[i]);
+        secp256k1_eckey_pubkey_serialize(&ge, &rbuf[33 * rings[i]], &size, 1);
     }
-    secp256k1_sha256_write(&sha256_e0, m, mlen);
-    secp256k1_sha256_finalize(&sha256_e0, tmp);
-    return memcmp(e0, tmp, 32) == 0;
 }
 
 int secp256k1_borromean_sign(const secp256k1_ecmult_context_t* ecmult_ctx, const secp256k1_ecmult_gen_context_t *ecmult_gen_ctx,
  unsigned char *e0, secp256k1_scalar_t *s, const secp256k1_gej_t *pubs, const secp256k1_scalar_t *k, const secp256k1_scalar_t *sec,
  const int *rsizes, const int *secidx, int nrings, const unsigned char *m, int mlen) {
-    secp256k1_gej_t rgej;
-    secp256k1_ge_t rge;
-    secp256k1_scalar_t ens;
+    secp256k1_gej_t rgej[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_ge_t rge[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_fe_t rz[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_fe_t rzi[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    secp256k1_scalar_t ens[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    unsigned char rbuf[33 * SECP256K1_BORROMEAN_SIGN_CHUNK];
+    int rpos[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    int rj[SECP256K1_BORROMEAN_SIGN_CHUNK];
+    int act[SECP256K1_BORROMEAN_SIGN_CHUNK];
     secp256k1_sha256_t sha256_e0;
-    unsigned char tmp[33];
+    secp256k1_borromean_hash_queue_t q;
+    int c;
+    int n;
+    int na;
     int i;
-    int j;
+    int r;
     int count;
     int size;
-    int overflow;
     VERIFY_CHECK(ecmult_ctx != NULL);
     VERIFY_CHECK(ecmult_gen_ctx != NULL);
     VERIFY_CHECK(e0 != NULL);
@@ -129,71 +385,114 @@ int secp256k1_borromean_sign(const secp256k1_ecmult_context_t* ecmult_ctx, const
     VERIFY_CHECK(secidx != NULL);
     VERIFY_CHECK(nrings > 0);
     VERIFY_CHECK(m != NULL);
+    /* As in secp256k1_borromean_verify_batch, the rings of a chunk advance one member at a time, so
+     * that the points of each step are serialized with a single batch inversion and hashed four at a
+     * time. */
     secp256k1_sha256_initialize(&sha256_e0);
+    secp256k1_borromean_hash_queue_init(&q);
     count = 0;
-    for (i = 0; i < nrings; i++) {
-        DEBUG_CHECK(INT_MAX - count > rsizes[i]);
-        secp256k1_ecmult_gen(ecmult_gen_ctx, &rgej, &k[i]);
-        secp256k1_ge_set_gej(&rge, &rgej);
-        if (secp256k1_gej_is_infinity(&rgej)) {
-            return 0;
-        }
-        secp256k1_eckey_pubkey_serialize(&rge, tmp, &size, 1);
-        for (j = secidx[i] + 1; j < rsizes[i]; j++) {
-            secp256k1_borromean_hash(tmp, m, mlen, tmp, 33, i, j);
-            secp256k1_scalar_set_b32(&ens, tmp, &overflow);
-            if (overflow || secp256k1_scalar_is_zero(&ens)) {
+    for (c = 0; c < nrings; c += n) {
+        n = nrings - c < SECP256K1_BORROMEAN_SIGN_CHUNK ? nrings - c : SECP256K1_BORROMEAN_SIGN_CHUNK;
+        for (i = 0; i < n; i++) {
+            DEBUG_CHECK(INT_MAX - count > rsizes[c + i]);
+            rpos[i] = count;
+            count += rsizes[c + i];
+            secp256k1_ecmult_gen(ecmult_gen_ctx, &rgej[i], &k[c + i]);
+            if (secp256k1_gej_is_infinity(&rgej[i])) {
                 return 0;
             }
-            /** The signing algorithm as a whole is not memory uniform so there is likely a cache sidechannel that
-             *  leaks which members are non-forgeries. That the forgeries themselves are variable time may leave
-             *  an additional privacy impacting timing side-channel, but not a key loss one.
-             */
-            secp256k1_ecmult(ecmult_ctx, &rgej, &pubs[count + j], &ens, &s[count + j]);
-            if (secp256k1_gej_is_infinity(&rgej)) {
+            rj[i] = secidx[c + i] + 1;
+            act[i] = i;
+        }
+        secp256k1_ge_set_all_gej(n, rge, rgej);
+        for (i = 0; i < n; i++) {
+            secp256k1_eckey_pubkey_serialize(&rge[i], &rbuf[33 * i], &size, 1);
+        }
+        do {
+            for (i = 0; i < n; i++) {
+                if (rj[i] < rsizes[c + i]) {
+                    secp256k1_borromean_hash_queue_add(&q, &ens[i], m, mlen, &rbuf[33 * i], 33, c + i, rj[i]);
+                }
+            }
+            secp256k1_borromean_hash_queue_flush(&q, mlen, 33);
+            if (!q.ok) {
                 return 0;
             }
-            secp256k1_ge_set_gej_var(&rge, &rgej);
-            secp256k1_eckey_pubkey_serialize(&rge, tmp, &size, 1);
+            na = 0;
+            for (i = 0; i < n; i++) {
+                r = c + i;
+                if (rj[i] < rsizes[r]) {
+                    /** The signing algorithm as a whole is not memory uniform so there is likely a cache sidechannel that
+                     *  leaks which members are non-forgeries. That the forgeries themselves are variable time may leave
+                     *  an additional privacy impacting timing side-channel, but not a key loss one.
+                     */
+                    secp256k1_ecmult(ecmult_ctx, &rgej[na], &pubs[rpos[i] + rj[i]], &ens[i], &s[rpos[i] + rj[i]]);
+                    if (secp256k1_gej_is_infinity(&rgej[na])) {
+                        return 0;
+                    }
+                    act[na++] = i;
+                    rj[i]++;
+                }
+            }
+            secp256k1_borromean_serialize_all_var(rbuf, rgej, rz, rzi, act, na);
+        } while (na > 0);
+        for (i = 0; i < n; i++) {
+            secp256k1_sha256_write(&sha256_e0, &rbuf[33 * i], 33);
         }
-        secp256k1_sha256_write(&sha256_e0, tmp, size);
-        count += rsizes[i];
     }
     secp256k1_sha256_write(&sha256_e0, m, mlen);
     secp256k1_sha256_finalize(&sha256_e0, e0);
     count = 0;
-    for (i = 0; i < nrings; i++) {
-        DEBUG_CHECK(INT_MAX - count > rsizes[i]);
-        secp256k1_borromean_hash(tmp, m, mlen, e0, 32, i, 0);
-        secp256k1_scalar_set_b32(&ens, tmp, &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&ens)) {
+    for (c = 0; c < nrings; c += n) {
+        n = nrings - c < SECP256K1_BORROMEAN_SIGN_CHUNK ? nrings - c : SECP256K1_BORROMEAN_SIGN_CHUNK;
+        for (i = 0; i < n; i++) {
+            rpos[i] = count;
+            count += rsizes[c + i];
+            secp256k1_borromean_hash_queue_add(&q, &ens[i], m, mlen, e0, 32, c + i, 0);
+            rj[i] = 0;
+        }
+        secp256k1_borromean_hash_queue_flush(&q, mlen, 32);
+        if (!q.ok) {
             return 0;
         }
-        for (j = 0; j < secidx[i]; j++) {
-            secp256k1_ecmult(ecmult_ctx, &rgej, &pubs[count + j], &ens, &s[count + j]);
-            if (secp256k1_gej_is_infinity(&rgej)) {
+        do {
+            na = 0;
+            for (i = 0; i < n; i++) {
+                if (rj[i] < secidx[c + i]) {
+                    secp256k1_ecmult(ecmult_ctx, &rgej[na], &pubs[rpos[i] + rj[i]], &ens[i], &s[rpos[i] + rj[i]]);
+                    if (secp256k1_gej_is_infinity(&rgej[na])) {
+                        return 0;
+                    }
+                    act[na++] = i;
+                }
+            }
+            secp256k1_borromean_serialize_all_var(rbuf, rgej, rz, rzi, act, na);
+            for (i = 0; i < na; i++) {
+                r = act[i];
+                rj[r]++;
+                secp256k1_borromean_hash_queue_add(&q, &ens[r], m, mlen, &rbuf[33 * r], 33, c + r, rj[r]);
+            }
+            secp256k1_borromean_hash_queue_flush(&q, mlen, 33);
+            if (!q.ok) {
                 return 0;
             }
-            secp256k1_ge_set_gej_var(&rge, &rgej);
-            secp256k1_eckey_pubkey_serialize(&rge, tmp, &size, 1);
-            secp256k1_borromean_hash(tmp, m, mlen, tmp, 33, i, j + 1);
-            secp256k1_scalar_set_b32(&ens, tmp, &overflow);
-            if (overflow || secp256k1_scalar_is_zero(&ens)) {
+        } while (na > 0);
+        for (i = 0; i < n; i++) {
+            const int idx = rpos[i] + secidx[c + i];
+            secp256k1_scalar_mul(&s[idx], &ens[i], &sec[c + i]);
+            secp256k1_scalar_negate(&s[idx], &s[idx]);
+            secp256k1_scalar_add(&s[idx], &s[idx], &k[c + i]);
+            if (secp256k1_scalar_is_zero(&s[idx])) {
                 return 0;
             }
         }
-        secp256k1_scalar_mul(&s[count + j], &ens, &sec[i]);
-        secp256k1_scalar_negate(&s[count + j], &s[count + j]);
-        secp256k1_scalar_add(&s[count + j], &s[count + j], &k[i]);
-        if (secp256k1_scalar_is_zero(&s[count + j])) {
-            return 0;
-        }
-        count += rsizes[i];
     }
-    secp256k1_scalar_clear(&ens);
-    secp256k1_ge_clear(&rge);
-    secp256k1_gej_clear(&rgej);
-    memset(tmp, 0, 33);
+    for (i = 0; i < SECP256K1_BORROMEAN_SIGN_CHUNK; i++) {
+        secp256k1_scalar_clear(&ens[i]);
+        secp256k1_ge_clear(&rge[i]);
+        secp256k1_gej_clear(&rgej[i]);
+    }
+    memset(rbuf, 0, sizeof(rbuf));
     return 1;
 }
 
@@ -0,0 +1,51 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille                                   *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_CPUID_IMPL_H_
+#define _SECP256K1_CPUID_IMPL_H_
+
+#if defined HAVE_CONFIG_H
+#include "libsecp256k1-config.h"
+#endif
+
+#include "util.h"
+
+#if defined(USE_ASM_X86_64) && defined(HAVE_ASM_X86_64_ADX)
+#include <cpuid.h>
+
+#define SECP256K1_X86_64_DETECTED 1
+#define SECP256K1_X86_64_BMI2_ADX 2
+
+/** The CPU features the x86_64 assembly can use: 0 until they have been detected, and then
+ *  SECP256K1_X86_64_DETECTED plus the flags of the features that are available. Concurrent first
+ *  uses all store the same value, so no locking is needed. Tests and benchmarks may set it to
+ *  SECP256K1_X86_64_DETECTED to force the baseline code. */
+static int secp256k1_x86_64_features = 0;
+
+static int secp256k1_x86_64_features_detect(void) {
+    unsigned int eax, ebx, ecx, edx;
+    int features = SECP256K1_X86_64_DETECTED;
+    if (__get_cpuid_max(0, NULL) >= 7) {
+        /* BMI2 (for MULX) is bit 8, ADX (ADCX/ADOX) bit 19 of EBX. */
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (((ebx >> 8) & 1) && ((ebx >> 19) & 1)) {
+            features |= SECP256K1_X86_64_BMI2_ADX;
+        }
+    }
+    secp256k1_x86_64_features = features;
+    return features;
+}
+
+static SECP256K1_INLINE int secp256k1_x86_64_have_bmi2_adx(void) {
+    int features = secp256k1_x86_64_features;
+    if (EXPECT(features == 0, 0)) {
+        features = secp256k1_x86_64_features_detect();
+    }
+    return (features & SECP256K1_X86_64_BMI2_ADX) != 0;
+}
+#endif
+
+#endif
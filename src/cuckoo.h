@@ -0,0 +1,45 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille, Gregory Maxwell                  *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_CUCKOO_
+#define _SECP256K1_CUCKOO_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of slots a key can be stored in, each selected by one 32-bit word of the key. */
+#define SECP256K1_CUCKOO_WAYS 4
+
+/** Number of stored keys an insertion moves to another of their slots before it drops the last one. */
+#define SECP256K1_CUCKOO_MAX_KICKS 8
+
+/** A slot is written under a sequence lock: seq is odd while a writer owns it, and is advanced by two
+ *  after every write, so that a reader can tell that the key it read was not changed meanwhile. A seq
+ *  of 0 marks a slot that was never written. */
+typedef struct {
+    uint32_t seq;
+    uint32_t key[8];
+} secp256k1_cuckoo_slot_t;
+
+/** A fixed-size set of 32-byte keys, which must be uniformly random (e.g. hashes with a secret salt),
+ *  as the slots are derived from them directly. Lookups and insertions may run concurrently without
+ *  locks, if we have atomics: a reader that meets a slot being written treats it as a miss, and a
+ *  writer that meets one gives up, dropping a key. The set is a cache, so dropping keys is fine. */
+typedef struct {
+    secp256k1_cuckoo_slot_t *slots;
+    size_t n_slots;
+} secp256k1_cuckoo_t;
+
+/** Initialize a set with n_slots slots, where 0 < n_slots < 2^32. */
+static void secp256k1_cuckoo_init(secp256k1_cuckoo_t *set, size_t n_slots);
+static void secp256k1_cuckoo_clear(secp256k1_cuckoo_t *set);
+
+/** Return whether key32 is in the set. */
+static int secp256k1_cuckoo_contains(const secp256k1_cuckoo_t *set, const unsigned char *key32);
+/** Add key32 to the set, possibly evicting some other key. */
+static void secp256k1_cuckoo_insert(secp256k1_cuckoo_t *set, const unsigned char *key32);
+
+#endif
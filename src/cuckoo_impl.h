@@ -0,0 +1,135 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille, Gregory Maxwell                  *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_CUCKOO_IMPL_H_
+#define _SECP256K1_CUCKOO_IMPL_H_
+
+#include <string.h>
+
+#include "util.h"
+#include "cuckoo.h"
+
+static void secp256k1_cuckoo_init(secp256k1_cuckoo_t *set, size_t n_slots) {
+    VERIFY_CHECK(n_slots > 0);
+    VERIFY_CHECK((uint64_t)n_slots <= 0xFFFFFFFFULL);
+    set->slots = (secp256k1_cuckoo_slot_t *)checked_malloc(sizeof(secp256k1_cuckoo_slot_t) * n_slots);
+    memset(set->slots, 0, sizeof(secp256k1_cuckoo_slot_t) * n_slots);
+    set->n_slots = n_slots;
+}
+
+static void secp256k1_cuckoo_clear(secp256k1_cuckoo_t *set) {
+    free(set->slots);
+    set->slots = NULL;
+    set->n_slots = 0;
+}
+
+/* Map word 'way' of key onto the slots, by multiplying rather than with a division. */
+static size_t secp256k1_cuckoo_index(const secp256k1_cuckoo_t *set, const uint32_t *key, int way) {
+    return (size_t)(((uint64_t)key[way] * set->n_slots) >> 32);
+}
+
+static void secp256k1_cuckoo_barrier(void) {
+#ifdef HAVE_BUILTIN_SYNC
+    __sync_synchronize();
+#endif
+}
+
+/* Read the key in slot, and the seq it was written under. Returns 0 if the slot is empty or was
+ * being written. */
+static int secp256k1_cuckoo_read(const secp256k1_cuckoo_slot_t *slot, uint32_t *key, uint32_t *seq) {
+    const volatile secp256k1_cuckoo_slot_t *v = slot;
+    uint32_t s = v->seq;
+    int i;
+    if (s == 0 || (s & 1)) {
+        return 0;
+    }
+    secp256k1_cuckoo_barrier();
+    for (i = 0; i < 8; i++) {
+        key[i] = v->key[i];
+    }
+    secp256k1_cuckoo_barrier();
+    *seq = s;
+    return v->seq == s;
+}
+
+/* Overwrite slot with key, if its seq is still seq. Returns 0 if another writer got there first. */
+static int secp256k1_cuckoo_write(secp256k1_cuckoo_slot_t *slot, const uint32_t *key, uint32_t seq) {
+    volatile secp256k1_cuckoo_slot_t *v = slot;
+    int i;
+#ifdef HAVE_BUILTIN_SYNC
+    if (!__sync_bool_compare_and_swap(&slot->seq, seq, seq + 1)) {
+        return 0;
+    }
+#else
+    if (slot->seq != seq) {
+        return 0;
+    }
+    slot->seq = seq + 1;
+#endif
+    for (i = 0; i < 8; i++) {
+        v->key[i] = key[i];
+    }
+    secp256k1_cuckoo_barrier();
+    /* A wrap to 0 only makes the slot look empty again. */
+    v->seq = seq + 2;
+    return 1;
+}
+
+static int secp256k1_cuckoo_contains(const secp256k1_cuckoo_t *set, const unsigned char *key32) {
+    uint32_t key[8], stored[8];
+    uint32_t seq;
+    int way;
+    memcpy(key, key32, 32);
+    for (way = 0; way < SECP256K1_CUCKOO_WAYS; way++) {
+        if (secp256k1_cuckoo_read(&set->slots[secp256k1_cuckoo_index(set, key, way)], stored, &seq) &&
+            memcmp(stored, key, 32) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void secp256k1_cuckoo_insert(secp256k1_cuckoo_t *set, const unsigned char *key32) {
+    uint32_t key[8], evicted[8];
+    uint32_t seq;
+    size_t index = 0, home = set->n_slots, from = set->n_slots;
+    int kick, way;
+    memcpy(key, key32, 32);
+    for (kick = 0; kick <= SECP256K1_CUCKOO_MAX_KICKS; kick++) {
+        /* Take an empty slot if the key has one. */
+        for (way = 0; way < SECP256K1_CUCKOO_WAYS; way++) {
+            index = secp256k1_cuckoo_index(set, key, way);
+            if (*(volatile uint32_t *)&set->slots[index].seq == 0 && secp256k1_cuckoo_write(&set->slots[index], key, 0)) {
+                return;
+            }
+        }
+        if (kick == SECP256K1_CUCKOO_MAX_KICKS) {
+            break;
+        }
+        /* Otherwise evict the key in one of its slots, a different way every time, and find a place
+         * for that one. The new key is never evicted again, and neither is the one just placed. */
+        for (way = 0; way < SECP256K1_CUCKOO_WAYS; way++) {
+            index = secp256k1_cuckoo_index(set, key, (kick + way) % SECP256K1_CUCKOO_WAYS);
+            if (index != home && index != from) {
+                break;
+            }
+        }
+        if (way == SECP256K1_CUCKOO_WAYS) {
+            return;
+        }
+        if (!secp256k1_cuckoo_read(&set->slots[index], evicted, &seq) || !secp256k1_cuckoo_write(&set->slots[index], key, seq)) {
+            /* Contended; the cache just loses this key. */
+            return;
+        }
+        if (kick == 0) {
+            home = index;
+        }
+        memcpy(key, evicted, 32);
+        from = index;
+    }
+}
+
+#endif
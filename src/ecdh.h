@@ -10,6 +10,21 @@
 #include "scalar.h"
 #include "group.h"
 
+/** Maximum number of points secp256k1_ecdh_point_multiply_batch takes at once. */
+#define SECP256K1_ECDH_BATCH_MAX 16
+
 static void secp256k1_ecdh_point_multiply(secp256k1_gej_t *r, const secp256k1_ge_t *a, const secp256k1_scalar_t *q);
 
+/** Set r[i] = q * a[i] for i = 0..n-1 (n at most SECP256K1_ECDH_BATCH_MAX). Unless USE_ECDH_LADDER is
+ *  defined, this recodes q only once and runs the wNAF ladders of all points side by side. */
+static void secp256k1_ecdh_point_multiply_batch(secp256k1_gej_t *r, const secp256k1_ge_t *a, size_t n, const secp256k1_scalar_t *q);
+
+/** The windowed (wNAF) multiplication, which is used unless USE_ECDH_LADDER is defined. */
+static void secp256k1_ecdh_point_multiply_wnaf_batch(secp256k1_gej_t *r, const secp256k1_ge_t *a, size_t n, const secp256k1_scalar_t *q);
+
+/** Set r = q * a with a co-Z Montgomery ladder (Rivain 2011, algorithm 9), which does the same two co-Z
+ *  additions for every bit, keeps no table and uses well under 1 KiB of stack. Constant-time, except for
+ *  a few specific values of q, such as 0. Used when USE_ECDH_LADDER is defined. */
+static void secp256k1_ecdh_point_multiply_ladder(secp256k1_gej_t *r, const secp256k1_ge_t *a, const secp256k1_scalar_t *q);
+
 #endif
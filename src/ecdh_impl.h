@@ -56,52 +56,280 @@ static int secp256k1_ecdh_wnaf(int *wnaf, const secp256k1_scalar_t *a, int w) {
 }
 
 
-static void secp256k1_ecdh_point_multiply(secp256k1_gej_t *r, const secp256k1_ge_t *a, const secp256k1_scalar_t *scalar) {
-    secp256k1_ge_t pre_a[ECMULT_TABLE_SIZE(WINDOW_A)];
+#ifdef USE_ENDOMORPHISM
+/** Number of wNAF digits (minus one) for a 128-bit half of a GLV split. */
+#define SECP256K1_ECDH_WNAF_SIZE(w) ((128 + (w) - 1) / (w))
+
+/** Like secp256k1_ecdh_wnaf, for one ~128-bit half of a GLV split, returning a skew of 1 or 2.
+ *  Forcing oddness by negation would make such a number 256 bits long, so instead the half is
+ *  negated if it is high (making it small), and 1 (for even numbers) or 2 (for odd ones) is added
+ *  first; the wNAF then represents a + skew, and the caller subtracts skew times the point
+ *  afterwards. This is the technique from section 4.2 of the Okeya/Tagaki paper. */
+static int secp256k1_ecdh_wnaf_lambda(int *wnaf, const secp256k1_scalar_t *a, int w) {
+    secp256k1_scalar_t s = *a;
+    secp256k1_scalar_t neg_s;
+    int global_sign;
+    int flip;
+    int bit;
+    int not_neg_one;
+    int word = 0;
+    int u_last;
+    int u;
+
+    flip = secp256k1_scalar_is_high(&s);
+    /* Add 1 to even numbers and 2 to odd ones, noting that negation flips parity. */
+    bit = flip ^ (int)(s.d[0] & 1);
+    /* Adding 2 to -1 would overflow; for -1 alone negating already gives the odd number 1,
+     * so claim that the 2 was added and the sign flipped twice. */
+    secp256k1_scalar_negate(&neg_s, &s);
+    not_neg_one = !secp256k1_scalar_is_one(&neg_s);
+    secp256k1_scalar_cadd_bit(&s, bit, not_neg_one);
+    global_sign = secp256k1_scalar_cond_negate(&s, flip);
+    global_sign *= not_neg_one * 2 - 1;
+
+    u_last = secp256k1_scalar_shr_int(&s, w);
+    while (word * w < 128) {
+        int sign;
+        int even;
+
+        u = secp256k1_scalar_shr_int(&s, w);
+        even = ((u & 1) == 0);
+        sign = 2 * (u_last > 0) - 1;
+        u += sign * even;
+        u_last -= sign * even * (1 << w);
+
+        wnaf[word++] = u_last * global_sign;
+
+        u_last = u;
+    }
+    wnaf[word] = u * global_sign;
+
+    VERIFY_CHECK(secp256k1_scalar_is_zero(&s));
+    VERIFY_CHECK(word == SECP256K1_ECDH_WNAF_SIZE(w));
+    return 1 << bit;
+}
+
+/** Set r = b if flag is true, otherwise leave it, in constant time. */
+static void secp256k1_ecdh_gej_cmov(secp256k1_gej_t *r, const secp256k1_gej_t *b, int flag) {
+    secp256k1_fe_cmov(&r->x, &b->x, flag);
+    secp256k1_fe_cmov(&r->y, &b->y, flag);
+    secp256k1_fe_cmov(&r->z, &b->z, flag);
+    r->infinity ^= (r->infinity ^ b->infinity) & flag;
+}
+
+/** Subtract skew * c (skew 1 or 2) from r, in constant time. */
+static void secp256k1_ecdh_unskew(secp256k1_gej_t *r, const secp256k1_ge_t *c, int skew) {
+    secp256k1_ge_t neg;
+    secp256k1_gej_t twice;
+    secp256k1_ge_neg(&neg, c);
+    secp256k1_gej_add_ge(r, r, &neg);
+    secp256k1_gej_add_ge(&twice, r, &neg);
+    secp256k1_ecdh_gej_cmov(r, &twice, skew == 2);
+}
+
+static void secp256k1_ecdh_point_multiply_wnaf_batch(secp256k1_gej_t *r, const secp256k1_ge_t *a, size_t n, const secp256k1_scalar_t *scalar) {
+    secp256k1_ge_t pre_a[SECP256K1_ECDH_BATCH_MAX][ECMULT_TABLE_SIZE(WINDOW_A)];
+    secp256k1_ge_t pre_a_lam[SECP256K1_ECDH_BATCH_MAX][ECMULT_TABLE_SIZE(WINDOW_A)];
+    secp256k1_fe_t Z[SECP256K1_ECDH_BATCH_MAX];
+    secp256k1_ge_t tmpa;
+    secp256k1_scalar_t q_1, q_lam;
+
+    int wnaf_1[1 + SECP256K1_ECDH_WNAF_SIZE(WINDOW_A - 1)];
+    int wnaf_lam[1 + SECP256K1_ECDH_WNAF_SIZE(WINDOW_A - 1)];
+    int skew_1, skew_lam;
+
+    size_t k;
+    int i;
+    VERIFY_CHECK(n <= SECP256K1_ECDH_BATCH_MAX);
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_CONST, n);
+
+    /* split q into q_1 and q_lam (where q = q_1 + q_lam*lambda, and q_1 and q_lam are ~128 bit),
+     * and build the wnaf representations of both, shared by all points. */
+    secp256k1_scalar_split_lambda(&q_1, &q_lam, scalar);
+    skew_1 = secp256k1_ecdh_wnaf_lambda(wnaf_1, &q_1, WINDOW_A - 1);
+    skew_lam = secp256k1_ecdh_wnaf_lambda(wnaf_lam, &q_lam, WINDOW_A - 1);
+
+    /* Calculate odd multiples of every a[k] and of lambda*a[k], all on the same Z[k]
+     * (multiplying x by beta commutes with the shared denominator). */
+    for (k = 0; k < n; k++) {
+        secp256k1_gej_set_ge(&r[k], &a[k]);
+        secp256k1_ecmult_odd_multiples_table_globalz_windowa(pre_a[k], &Z[k], &r[k]);
+        for (i = 0; i < ECMULT_TABLE_SIZE(WINDOW_A); i++) {
+            secp256k1_ge_mul_lambda(&pre_a_lam[k][i], &pre_a[k][i]);
+        }
+        secp256k1_gej_set_infinity(&r[k]);
+    }
+
+    /* The two ~128-bit ladders run in lockstep, sharing the doublings. */
+    for (i = SECP256K1_ECDH_WNAF_SIZE(WINDOW_A - 1); i >= 0; i--) {
+        int m1 = wnaf_1[i];
+        int mlam = wnaf_lam[i];
+        VERIFY_CHECK(m1 != 0);
+        VERIFY_CHECK(mlam != 0);
+        for (k = 0; k < n; k++) {
+            int j;
+            for (j = 0; j < WINDOW_A - 1; ++j) {
+                secp256k1_gej_double_var(&r[k], &r[k], NULL);
+            }
+            ECMULT_TABLE_GET_GE(&tmpa, pre_a[k], m1, WINDOW_A);
+            secp256k1_gej_add_ge(&r[k], &r[k], &tmpa);
+            ECMULT_TABLE_GET_GE(&tmpa, pre_a_lam[k], mlam, WINDOW_A);
+            secp256k1_gej_add_ge(&r[k], &r[k], &tmpa);
+        }
+    }
+
+    for (k = 0; k < n; k++) {
+        /* r[k] is now (q + skew_1 + skew_lam*lambda) * a[k], on the Z[k] denominator; secp256k1_gej_add_ge
+         * copes with the (negligible) case that this is infinity. */
+        secp256k1_fe_mul(&r[k].z, &r[k].z, &Z[k]);
+        secp256k1_ecdh_unskew(&r[k], &a[k], skew_1);
+        secp256k1_ge_mul_lambda(&tmpa, &a[k]);
+        secp256k1_ecdh_unskew(&r[k], &tmpa, skew_lam);
+    }
+}
+#else
+static void secp256k1_ecdh_point_multiply_wnaf_batch(secp256k1_gej_t *r, const secp256k1_ge_t *a, size_t n, const secp256k1_scalar_t *scalar) {
+    secp256k1_ge_t pre_a[SECP256K1_ECDH_BATCH_MAX][ECMULT_TABLE_SIZE(WINDOW_A)];
+    secp256k1_fe_t Z[SECP256K1_ECDH_BATCH_MAX];
     secp256k1_ge_t tmpa;
-    secp256k1_fe_t Z;
 
     int wnaf[256];
     int n_words;
 
+    size_t k;
     int i;
     int is_zero = secp256k1_scalar_is_zero(scalar);
     secp256k1_scalar_t sc = *scalar;
+    VERIFY_CHECK(n <= SECP256K1_ECDH_BATCH_MAX);
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_CONST, n);
     /* the wNAF ladder cannot handle zero, so bump this to one .. we will
      * correct the result after the fact */
     sc.d[0] += is_zero;
 
-    /* build wnaf representation for q. */
+    /* build wnaf representation for q, shared by all points. */
     n_words = secp256k1_ecdh_wnaf(wnaf, &sc, WINDOW_A - 1);
 
-    /* Calculate odd multiples of a.
-     * All multiples are brought to the same Z 'denominator', which is stored
-     * in Z. Due to secp256k1' isomorphism we can do all operations pretending
-     * that the Z coordinate was 1, use affine addition formulae, and correct
-     * the Z coordinate of the result once at the end.
+    /* Calculate odd multiples of every a[k].
+     * All multiples of one point are brought to the same Z 'denominator', which
+     * is stored in Z[k]. Due to secp256k1' isomorphism we can do all operations
+     * pretending that the Z coordinate was 1, use affine addition formulae, and
+     * correct the Z coordinate of the result once at the end.
      */
-    secp256k1_gej_set_ge(r, a);
-    secp256k1_ecmult_odd_multiples_table_globalz_windowa(pre_a, &Z, r);
-    secp256k1_gej_set_infinity(r);
+    for (k = 0; k < n; k++) {
+        secp256k1_gej_set_ge(&r[k], &a[k]);
+        secp256k1_ecmult_odd_multiples_table_globalz_windowa(pre_a[k], &Z[k], &r[k]);
+        secp256k1_gej_set_infinity(&r[k]);
+    }
 
     for (i = n_words; i >= 0; i--) {
-        int n;
-        int j;
-        for (j = 0; j < WINDOW_A - 1; ++j) {
+        int m = wnaf[i];
+        VERIFY_CHECK(m != 0);
+        for (k = 0; k < n; k++) {
+            int j;
+            for (j = 0; j < WINDOW_A - 1; ++j) {
+                secp256k1_gej_double_var(&r[k], &r[k], NULL);
+            }
+            ECMULT_TABLE_GET_GE(&tmpa, pre_a[k], m, WINDOW_A);
+            secp256k1_gej_add_ge(&r[k], &r[k], &tmpa);
+        }
+    }
+
+    for (k = 0; k < n; k++) {
+        if (!r[k].infinity) {
+            secp256k1_fe_mul(&r[k].z, &r[k].z, &Z[k]);
+        }
+        /* correct for zero */
+        r[k].infinity |= is_zero;
+    }
+}
+#endif
+
+/** Conditionally swap the x and y coordinates of two points with the same Z coordinate, in constant time. */
+static void secp256k1_ecdh_coz_cswap(secp256k1_gej_t *a, secp256k1_gej_t *b, int flag) {
+    secp256k1_fe_t t = a->x;
+    secp256k1_fe_cmov(&a->x, &b->x, flag);
+    secp256k1_fe_cmov(&b->x, &t, flag);
+    t = a->y;
+    secp256k1_fe_cmov(&a->y, &b->y, flag);
+    secp256k1_fe_cmov(&b->y, &t, flag);
+}
+
+static void secp256k1_ecdh_point_multiply_ladder(secp256k1_gej_t *r, const secp256k1_ge_t *a, const secp256k1_scalar_t *scalar) {
+    /* The group order n, and 2n, as 33-byte big endian numbers. */
+    static const unsigned char order[2][33] = {{
+        0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+        0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B, 0xBF, 0xD2, 0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41
+    }, {
+        0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFD,
+        0x75, 0x5D, 0xB9, 0xCD, 0x5E, 0x91, 0x40, 0x77, 0x7F, 0xA4, 0xBD, 0x19, 0xA0, 0x6C, 0x82, 0x82
+    }};
+    unsigned char k[32];
+    unsigned char k1[33], k2[33];
+    secp256k1_gej_t r0, r1;
+    int carry1 = 0, carry2 = 0;
+    int swap = 0;
+    int mask;
+    int bit;
+    int i;
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_CONST, 1);
+
+    /* The ladder needs a fixed top bit, so it multiplies by k + n or k + 2n instead of by k, whichever has
+     * bit 256 set (k + n does unless k < 2^256 - n, and then k + 2n does). */
+    secp256k1_scalar_get_b32(k, scalar);
+    for (i = 32; i >= 0; i--) {
+        int ki = i > 0 ? k[i - 1] : 0;
+        carry1 += ki + order[0][i];
+        carry2 += ki + order[1][i];
+        k1[i] = carry1 & 0xFF;
+        k2[i] = carry2 & 0xFF;
+        carry1 >>= 8;
+        carry2 >>= 8;
+    }
+    mask = -(k1[0] & 1);
+    for (i = 0; i < 33; i++) {
+        k1[i] = (k1[i] & mask) | (k2[i] & ~mask);
+    }
+
+    /* The points are kept as (R_swap, R_{1-swap}), where R1 - R0 = a. */
+    secp256k1_gej_coz_double(&r1, &r0, a);
+    for (i = 255; i >= 0; i--) {
+        bit = (k1[32 - (i >> 3)] >> (i & 7)) & 1;
+        secp256k1_ecdh_coz_cswap(&r0, &r1, swap ^ bit);
+        swap = bit;
+        /* (R_b, R_{1-b}) becomes (R_b - R_{1-b}, R_b + R_{1-b}), and then (2*R_b, R_b + R_{1-b}). */
+        secp256k1_gej_coz_addc(&r0, &r1);
+        secp256k1_gej_coz_add(&r1, &r0);
+    }
+    secp256k1_ecdh_coz_cswap(&r0, &r1, swap);
+
+    if (secp256k1_fe_normalizes_to_zero(&r0.z)) {
+        /* Some step added two points with the same x coordinate, which only happens for a handful of scalars
+         * (such as 0), all of them public for practical purposes. Redo those with additions that cope. */
+        secp256k1_gej_set_infinity(r);
+        for (i = 255; i >= 0; i--) {
             secp256k1_gej_double_var(r, r, NULL);
+            if ((k[31 - (i >> 3)] >> (i & 7)) & 1) {
+                secp256k1_gej_add_ge_var(r, r, a, NULL);
+            }
         }
-        n = wnaf[i];
-        VERIFY_CHECK(n != 0);
-        ECMULT_TABLE_GET_GE(&tmpa, pre_a, n, WINDOW_A);
-        secp256k1_gej_add_ge(r, r, &tmpa);
+        return;
     }
+    *r = r0;
+}
 
-    if (!r->infinity) {
-        secp256k1_fe_mul(&r->z, &r->z, &Z);
+static void secp256k1_ecdh_point_multiply_batch(secp256k1_gej_t *r, const secp256k1_ge_t *a, size_t n, const secp256k1_scalar_t *scalar) {
+#ifdef USE_ECDH_LADDER
+    size_t k;
+    for (k = 0; k < n; k++) {
+        secp256k1_ecdh_point_multiply_ladder(&r[k], &a[k], scalar);
     }
+#else
+    secp256k1_ecdh_point_multiply_wnaf_batch(r, a, n, scalar);
+#endif
+}
 
-    /* correct for zero */
-    r->infinity |= is_zero;
+static void secp256k1_ecdh_point_multiply(secp256k1_gej_t *r, const secp256k1_ge_t *a, const secp256k1_scalar_t *scalar) {
+    secp256k1_ecdh_point_multiply_batch(r, a, 1, scalar);
 }
 
 #endif
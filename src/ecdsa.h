@@ -15,10 +15,28 @@ typedef struct {
     secp256k1_scalar_t r, s;
 } secp256k1_ecdsa_sig_t;
 
+/** Number of signatures whose s values are inverted together by secp256k1_ecdsa_sig_verify_batch. */
+#define SECP256K1_ECDSA_VERIFY_BATCH_CHUNK 32
+
+/** Number of signatures whose r values are inverted together by secp256k1_ecdsa_sig_recover_batch.
+ *  Must be a multiple of 4. */
+#define SECP256K1_ECDSA_RECOVER_BATCH_CHUNK 32
+
+/** Number of signatures whose nonces and R points are inverted together by secp256k1_ecdsa_sig_sign_batch. */
+#define SECP256K1_ECDSA_SIGN_BATCH_CHUNK 32
+
 static int secp256k1_ecdsa_sig_parse(secp256k1_ecdsa_sig_t *r, const unsigned char *sig, int size);
+/** Parse the encodings accepted by secp256k1_ecdsa_signature_parse_der_lax. Out of range integers
+ *  result in a zero signature rather than a failure. */
+static int secp256k1_ecdsa_sig_parse_lax(secp256k1_ecdsa_sig_t *r, const unsigned char *sig, size_t size);
 static int secp256k1_ecdsa_sig_serialize(unsigned char *sig, int *size, const secp256k1_ecdsa_sig_t *a);
 static int secp256k1_ecdsa_sig_verify(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, const secp256k1_ge_t *pubkey, const secp256k1_scalar_t *message);
+/** The same as secp256k1_ecdsa_sig_verify, with the multiples of the public key taken from a table. */
+static int secp256k1_ecdsa_sig_verify_point(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, const secp256k1_ecmult_point_table_t *pubkey, const secp256k1_scalar_t *message);
+static size_t secp256k1_ecdsa_sig_verify_batch(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sigs, const secp256k1_ge_t *pubkeys, const secp256k1_scalar_t *messages, size_t n);
 static int secp256k1_ecdsa_sig_sign(const secp256k1_ecmult_gen_context_t *ctx, secp256k1_ecdsa_sig_t *sig, const secp256k1_scalar_t *seckey, const secp256k1_scalar_t *message, const secp256k1_scalar_t *nonce, int *recid);
+static void secp256k1_ecdsa_sig_sign_batch(const secp256k1_ecmult_gen_context_t *ctx, secp256k1_ecdsa_sig_t *sigs, int *ok, const secp256k1_scalar_t *seckeys, const secp256k1_scalar_t *messages, const secp256k1_scalar_t *nonces, const secp256k1_scalar_t *blind, size_t n);
 static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, secp256k1_ge_t *pubkey, const secp256k1_scalar_t *message, int recid);
+static int secp256k1_ecdsa_sig_recover_batch(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sigs, secp256k1_ge_t *pubkeys, int *valid, const secp256k1_scalar_t *messages, const int *recids, size_t n);
 
 #endif
@@ -46,13 +46,30 @@ static const secp256k1_fe_t secp256k1_ecdsa_const_p_minus_order = SECP256K1_FE_C
     0, 0, 0, 1, 0x45512319UL, 0x50B75FC4UL, 0x402DA172UL, 0x2FC9BAEEUL
 );
 
+/* Set r to the big-endian integer in p[0..len), without copying it when it is exactly 32 bytes long
+ * after its leading zeroes (which is almost always the case). Returns 0 if it is not less than the
+ * group order. */
+static int secp256k1_ecdsa_sig_parse_int(secp256k1_scalar_t *r, const unsigned char *p, size_t len) {
+    unsigned char tmp[32] = {0};
+    int overflow = 0;
+    while (len > 0 && p[0] == 0) {
+        len--;
+        p++;
+    }
+    if (len > 32) {
+        return 0;
+    }
+    if (len < 32) {
+        memcpy(tmp + 32 - len, p, len);
+        p = tmp;
+    }
+    secp256k1_scalar_set_b32(r, p, &overflow);
+    return !overflow;
+}
+
 static int secp256k1_ecdsa_sig_parse(secp256k1_ecdsa_sig_t *r, const unsigned char *sig, int size) {
-    unsigned char ra[32] = {0}, sa[32] = {0};
-    const unsigned char *rp;
-    const unsigned char *sp;
     int lenr;
     int lens;
-    int overflow;
     if (sig[0] != 0x30) {
         return 0;
     }
@@ -79,33 +96,74 @@ static int secp256k1_ecdsa_sig_parse(secp256k1_ecdsa_sig_t *r, const unsigned ch
     if (lens == 0) {
         return 0;
     }
-    sp = sig + 6 + lenr;
-    while (lens > 0 && sp[0] == 0) {
-        lens--;
-        sp++;
+    return secp256k1_ecdsa_sig_parse_int(&r->r, sig + 4, lenr) &&
+           secp256k1_ecdsa_sig_parse_int(&r->s, sig + 6 + lenr, lens);
+}
+
+/* Read the DER length at sig[*pos..size) and advance *pos past it. For an integer (sequence == 0)
+ * long forms of any size are accepted as long as the value fits; a sequence's length is skipped. */
+static int secp256k1_ecdsa_sig_parse_lax_len(size_t *len, const unsigned char *sig, size_t size, size_t *pos, int sequence) {
+    size_t lenbyte;
+    if (*pos == size) {
+        return 0;
+    }
+    lenbyte = sig[(*pos)++];
+    if (!(lenbyte & 0x80)) {
+        *len = lenbyte;
+        return 1;
+    }
+    lenbyte -= 0x80;
+    if (lenbyte > size - *pos) {
+        return 0;
+    }
+    if (sequence) {
+        *pos += lenbyte;
+        return 1;
+    }
+    while (lenbyte > 0 && sig[*pos] == 0) {
+        (*pos)++;
+        lenbyte--;
+    }
+    if (lenbyte >= sizeof(size_t)) {
+        return 0;
+    }
+    *len = 0;
+    while (lenbyte > 0) {
+        *len = (*len << 8) + sig[(*pos)++];
+        lenbyte--;
+    }
+    return 1;
+}
+
+static int secp256k1_ecdsa_sig_parse_lax(secp256k1_ecdsa_sig_t *r, const unsigned char *sig, size_t size) {
+    size_t pos = 0, rpos, rlen, spos, slen, seqlen;
+    if (size == 0 || sig[pos++] != 0x30) {
+        return 0;
     }
-    if (lens > 32) {
+    if (!secp256k1_ecdsa_sig_parse_lax_len(&seqlen, sig, size, &pos, 1)) {
         return 0;
     }
-    rp = sig + 4;
-    while (lenr > 0 && rp[0] == 0) {
-        lenr--;
-        rp++;
+    if (pos == size || sig[pos++] != 0x02) {
+        return 0;
     }
-    if (lenr > 32) {
+    if (!secp256k1_ecdsa_sig_parse_lax_len(&rlen, sig, size, &pos, 0) || rlen > size - pos) {
         return 0;
     }
-    memcpy(ra + 32 - lenr, rp, lenr);
-    memcpy(sa + 32 - lens, sp, lens);
-    overflow = 0;
-    secp256k1_scalar_set_b32(&r->r, ra, &overflow);
-    if (overflow) {
+    rpos = pos;
+    pos += rlen;
+    if (pos == size || sig[pos++] != 0x02) {
         return 0;
     }
-    secp256k1_scalar_set_b32(&r->s, sa, &overflow);
-    if (overflow) {
+    if (!secp256k1_ecdsa_sig_parse_lax_len(&slen, sig, size, &pos, 0) || slen > size - pos) {
         return 0;
     }
+    spos = pos;
+    if (!secp256k1_ecdsa_sig_parse_int(&r->r, sig + rpos, rlen) ||
+        !secp256k1_ecdsa_sig_parse_int(&r->s, sig + spos, slen)) {
+        /* Out of range values give a signature that parses but never verifies. */
+        secp256k1_scalar_clear(&r->r);
+        secp256k1_scalar_clear(&r->s);
+    }
     return 1;
 }
 
@@ -132,23 +190,12 @@ static int secp256k1_ecdsa_sig_serialize(unsigned char *sig, int *size, const se
     return 1;
 }
 
-static int secp256k1_ecdsa_sig_verify(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, const secp256k1_ge_t *pubkey, const secp256k1_scalar_t *message) {
+/** Check that the recomputed R point pr has x coordinate sig->r modulo the order. */
+static int secp256k1_ecdsa_sig_check_r(const secp256k1_ecdsa_sig_t *sig, const secp256k1_gej_t *pr) {
     unsigned char c[32];
-    secp256k1_scalar_t sn, u1, u2;
     secp256k1_fe_t xr;
-    secp256k1_gej_t pubkeyj;
-    secp256k1_gej_t pr;
-
-    if (secp256k1_scalar_is_zero(&sig->r) || secp256k1_scalar_is_zero(&sig->s)) {
-        return 0;
-    }
 
-    secp256k1_scalar_inverse_var(&sn, &sig->s);
-    secp256k1_scalar_mul(&u1, &sn, message);
-    secp256k1_scalar_mul(&u2, &sn, &sig->r);
-    secp256k1_gej_set_ge(&pubkeyj, pubkey);
-    secp256k1_ecmult(ctx, &pr, &pubkeyj, &u2, &u1);
-    if (secp256k1_gej_is_infinity(&pr)) {
+    if (secp256k1_gej_is_infinity(pr)) {
         return 0;
     }
     secp256k1_scalar_get_b32(c, &sig->r);
@@ -170,7 +217,7 @@ static int secp256k1_ecdsa_sig_verify(const secp256k1_ecmult_context_t *ctx, con
      *  Thus, we can avoid the inversion, but we have to check both cases separately.
      *  secp256k1_gej_eq_x implements the (xr * pr.z^2 mod p == pr.x) test.
      */
-    if (secp256k1_gej_eq_x_var(&xr, &pr)) {
+    if (secp256k1_gej_eq_x_var(&xr, pr)) {
         /* xr.x == xr * xr.z^2 mod p, so the signature is valid. */
         return 1;
     }
@@ -179,15 +226,105 @@ static int secp256k1_ecdsa_sig_verify(const secp256k1_ecmult_context_t *ctx, con
         return 0;
     }
     secp256k1_fe_add(&xr, &secp256k1_ecdsa_const_order_as_fe);
-    if (secp256k1_gej_eq_x_var(&xr, &pr)) {
+    if (secp256k1_gej_eq_x_var(&xr, pr)) {
         /* (xr + n) * pr.z^2 mod p == pr.x, so the signature is valid. */
         return 1;
     }
     return 0;
 }
 
-static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, secp256k1_ge_t *pubkey, const secp256k1_scalar_t *message, int recid) {
+/** Verify sig against pubkey and message, given sn = 1/sig->s. Both r and s must be non-zero. */
+static int secp256k1_ecdsa_sig_verify_inv(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, const secp256k1_scalar_t *sn, const secp256k1_ge_t *pubkey, const secp256k1_scalar_t *message) {
+    secp256k1_scalar_t u1, u2;
+    secp256k1_gej_t pubkeyj;
+    secp256k1_gej_t pr;
+
+    secp256k1_scalar_mul(&u1, sn, message);
+    secp256k1_scalar_mul(&u2, sn, &sig->r);
+    secp256k1_gej_set_ge(&pubkeyj, pubkey);
+    secp256k1_ecmult(ctx, &pr, &pubkeyj, &u2, &u1);
+    return secp256k1_ecdsa_sig_check_r(sig, &pr);
+}
+
+static int secp256k1_ecdsa_sig_verify(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, const secp256k1_ge_t *pubkey, const secp256k1_scalar_t *message) {
+    secp256k1_scalar_t sn;
+
+    if (secp256k1_scalar_is_zero(&sig->r) || secp256k1_scalar_is_zero(&sig->s)) {
+        return 0;
+    }
+
+    secp256k1_scalar_inverse_var(&sn, &sig->s);
+    return secp256k1_ecdsa_sig_verify_inv(ctx, sig, &sn, pubkey, message);
+}
+
+static int secp256k1_ecdsa_sig_verify_point(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, const secp256k1_ecmult_point_table_t *pubkey, const secp256k1_scalar_t *message) {
+    secp256k1_scalar_t sn, u1, u2;
+    secp256k1_gej_t pr;
+
+    if (secp256k1_scalar_is_zero(&sig->r) || secp256k1_scalar_is_zero(&sig->s)) {
+        return 0;
+    }
+
+    secp256k1_scalar_inverse_var(&sn, &sig->s);
+    secp256k1_scalar_mul(&u1, &sn, message);
+    secp256k1_scalar_mul(&u2, &sn, &sig->r);
+    secp256k1_ecmult_point(ctx, &pr, pubkey, &u2, &u1);
+    return secp256k1_ecdsa_sig_check_r(sig, &pr);
+}
+
+/** Verify n signatures, returning the index of the first invalid one (or n if all are valid).
+ *
+ *  Every verification needs its own R point to compare against r, so the multiplications themselves
+ *  cannot be merged, but the inversions of s can: they are done together per chunk, using a single
+ *  modular inversion for SECP256K1_ECDSA_VERIFY_BATCH_CHUNK signatures.
+ */
+static size_t secp256k1_ecdsa_sig_verify_batch(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sigs, const secp256k1_ge_t *pubkeys, const secp256k1_scalar_t *messages, size_t n) {
+    secp256k1_scalar_t s[SECP256K1_ECDSA_VERIFY_BATCH_CHUNK];
+    secp256k1_scalar_t sn[SECP256K1_ECDSA_VERIFY_BATCH_CHUNK];
+    size_t i, j, k, len;
+
+    for (i = 0; i < n; i += len) {
+        len = n - i;
+        if (len > SECP256K1_ECDSA_VERIFY_BATCH_CHUNK) {
+            len = SECP256K1_ECDSA_VERIFY_BATCH_CHUNK;
+        }
+        /* Only signatures before the first one with a zero r or s can take part in the inversion. */
+        for (j = 0; j < len; j++) {
+            if (secp256k1_scalar_is_zero(&sigs[i + j].r) || secp256k1_scalar_is_zero(&sigs[i + j].s)) {
+                break;
+            }
+            s[j] = sigs[i + j].s;
+        }
+        secp256k1_scalar_inverse_all_var(j, sn, s);
+        for (k = 0; k < j; k++) {
+            if (!secp256k1_ecdsa_sig_verify_inv(ctx, &sigs[i + k], &sn[k], &pubkeys[i + k], &messages[i + k])) {
+                return i + k;
+            }
+        }
+        if (j < len) {
+            return i + j;
+        }
+    }
+    return n;
+}
+
+/** Compute the x coordinate of the R point of a signature with recovery id recid. Returns 0 if recid
+ *  asks for r + n, but that is not less than p. */
+static int secp256k1_ecdsa_sig_recover_x(secp256k1_fe_t *fx, const secp256k1_ecdsa_sig_t *sig, int recid) {
     unsigned char brx[32];
+
+    secp256k1_scalar_get_b32(brx, &sig->r);
+    VERIFY_CHECK(secp256k1_fe_set_b32(fx, brx)); /* brx comes from a scalar, so is less than the order; certainly less than p */
+    if (recid & 2) {
+        if (secp256k1_fe_cmp_var(fx, &secp256k1_ecdsa_const_p_minus_order) >= 0) {
+            return 0;
+        }
+        secp256k1_fe_add(fx, &secp256k1_ecdsa_const_order_as_fe);
+    }
+    return 1;
+}
+
+static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sig, secp256k1_ge_t *pubkey, const secp256k1_scalar_t *message, int recid) {
     secp256k1_fe_t fx;
     secp256k1_ge_t x;
     secp256k1_gej_t xj;
@@ -198,13 +335,8 @@ static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context_t *ctx, co
         return 0;
     }
 
-    secp256k1_scalar_get_b32(brx, &sig->r);
-    VERIFY_CHECK(secp256k1_fe_set_b32(&fx, brx)); /* brx comes from a scalar, so is less than the order; certainly less than p */
-    if (recid & 2) {
-        if (secp256k1_fe_cmp_var(&fx, &secp256k1_ecdsa_const_p_minus_order) >= 0) {
-            return 0;
-        }
-        secp256k1_fe_add(&fx, &secp256k1_ecdsa_const_order_as_fe);
+    if (!secp256k1_ecdsa_sig_recover_x(&fx, sig, recid)) {
+        return 0;
     }
     if (!secp256k1_ge_set_xo_var(&x, &fx, recid & 1)) {
         return 0;
@@ -219,35 +351,97 @@ static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context_t *ctx, co
     return !secp256k1_gej_is_infinity(&qj);
 }
 
-static int secp256k1_ecdsa_sig_sign(const secp256k1_ecmult_gen_context_t *ctx, secp256k1_ecdsa_sig_t *sig, const secp256k1_scalar_t *seckey, const secp256k1_scalar_t *message, const secp256k1_scalar_t *nonce, int *recid) {
+/** Recover the public keys of n signatures, setting valid[i] to whether pubkeys[i] could be recovered.
+ *  Returns 1 if all of them could be.
+ *
+ *  Per chunk of SECP256K1_ECDSA_RECOVER_BATCH_CHUNK signatures the r values are inverted with a single
+ *  modular inversion, the R points are decompressed four at a time with secp256k1_ge_set_xo_x4_var,
+ *  and the resulting public keys are converted to affine coordinates with a single field inversion.
+ *  Each key is a different combination of its own R and G, so the multiplications themselves stay
+ *  separate.
+ */
+static int secp256k1_ecdsa_sig_recover_batch(const secp256k1_ecmult_context_t *ctx, const secp256k1_ecdsa_sig_t *sigs, secp256k1_ge_t *pubkeys, int *valid, const secp256k1_scalar_t *messages, const int *recids, size_t n) {
+    secp256k1_scalar_t r[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    secp256k1_scalar_t rn[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    secp256k1_fe_t fx[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    secp256k1_ge_t x[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    secp256k1_gej_t qj[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    int odd[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    int sqrt_ok[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    secp256k1_scalar_t u1, u2;
+    secp256k1_gej_t xj;
+    size_t i, j, len;
+    int ret = 1;
+
+    for (i = 0; i < n; i += len) {
+        len = n - i;
+        if (len > SECP256K1_ECDSA_RECOVER_BATCH_CHUNK) {
+            len = SECP256K1_ECDSA_RECOVER_BATCH_CHUNK;
+        }
+        for (j = 0; j < len; j++) {
+            const secp256k1_ecdsa_sig_t *sig = &sigs[i + j];
+            valid[i + j] = !secp256k1_scalar_is_zero(&sig->r) && !secp256k1_scalar_is_zero(&sig->s) &&
+                           secp256k1_ecdsa_sig_recover_x(&fx[j], sig, recids[i + j]);
+            odd[j] = recids[i + j] & 1;
+            /* Invalid entries take part in the inversion and decompression with r = 1 and x = 1. */
+            if (valid[i + j]) {
+                r[j] = sig->r;
+            } else {
+                secp256k1_scalar_set_int(&r[j], 1);
+                secp256k1_fe_set_int(&fx[j], 1);
+            }
+        }
+        /* Pad the last group of four by repeating the chunk's first point. */
+        for (; j % 4 != 0; j++) {
+            fx[j] = fx[0];
+            odd[j] = odd[0];
+        }
+        for (j = 0; j < len; j += 4) {
+            secp256k1_ge_set_xo_x4_var(&x[j], &sqrt_ok[j], &fx[j], &odd[j]);
+        }
+        secp256k1_scalar_inverse_all_var(len, rn, r);
+        for (j = 0; j < len; j++) {
+            valid[i + j] &= sqrt_ok[j];
+            if (!valid[i + j]) {
+                secp256k1_gej_set_infinity(&qj[j]);
+                continue;
+            }
+            secp256k1_gej_set_ge(&xj, &x[j]);
+            secp256k1_scalar_mul(&u1, &rn[j], &messages[i + j]);
+            secp256k1_scalar_negate(&u1, &u1);
+            secp256k1_scalar_mul(&u2, &rn[j], &sigs[i + j].s);
+            secp256k1_ecmult(ctx, &qj[j], &xj, &u2, &u1);
+            valid[i + j] = !secp256k1_gej_is_infinity(&qj[j]);
+        }
+        secp256k1_ge_set_all_gej_var(len, &pubkeys[i], qj);
+        for (j = 0; j < len; j++) {
+            ret &= valid[i + j];
+        }
+    }
+    return ret;
+}
+
+/** Finish a signature from the affine nonce point r and the inverse of the nonce. */
+static int secp256k1_ecdsa_sig_sign_finish(secp256k1_ecdsa_sig_t *sig, secp256k1_ge_t *r, const secp256k1_scalar_t *seckey, const secp256k1_scalar_t *message, const secp256k1_scalar_t *noncei, int *recid) {
     unsigned char b[32];
-    secp256k1_gej_t rp;
-    secp256k1_ge_t r;
     secp256k1_scalar_t n;
     int overflow = 0;
 
-    secp256k1_ecmult_gen(ctx, &rp, nonce);
-    secp256k1_ge_set_gej(&r, &rp);
-    secp256k1_fe_normalize(&r.x);
-    secp256k1_fe_normalize(&r.y);
-    secp256k1_fe_get_b32(b, &r.x);
+    secp256k1_fe_normalize(&r->x);
+    secp256k1_fe_normalize(&r->y);
+    secp256k1_fe_get_b32(b, &r->x);
     secp256k1_scalar_set_b32(&sig->r, b, &overflow);
     if (secp256k1_scalar_is_zero(&sig->r)) {
         /* P.x = order is on the curve, so technically sig->r could end up zero, which would be an invalid signature. */
-        secp256k1_gej_clear(&rp);
-        secp256k1_ge_clear(&r);
         return 0;
     }
     if (recid) {
-        *recid = (overflow ? 2 : 0) | (secp256k1_fe_is_odd(&r.y) ? 1 : 0);
+        *recid = (overflow ? 2 : 0) | (secp256k1_fe_is_odd(&r->y) ? 1 : 0);
     }
     secp256k1_scalar_mul(&n, &sig->r, seckey);
     secp256k1_scalar_add(&n, &n, message);
-    secp256k1_scalar_inverse(&sig->s, nonce);
-    secp256k1_scalar_mul(&sig->s, &sig->s, &n);
+    secp256k1_scalar_mul(&sig->s, noncei, &n);
     secp256k1_scalar_clear(&n);
-    secp256k1_gej_clear(&rp);
-    secp256k1_ge_clear(&r);
     if (secp256k1_scalar_is_zero(&sig->s)) {
         return 0;
     }
@@ -260,4 +454,47 @@ static int secp256k1_ecdsa_sig_sign(const secp256k1_ecmult_gen_context_t *ctx, s
     return 1;
 }
 
+static int secp256k1_ecdsa_sig_sign(const secp256k1_ecmult_gen_context_t *ctx, secp256k1_ecdsa_sig_t *sig, const secp256k1_scalar_t *seckey, const secp256k1_scalar_t *message, const secp256k1_scalar_t *nonce, int *recid) {
+    secp256k1_gej_t rp;
+    secp256k1_ge_t r;
+    secp256k1_scalar_t noncei;
+    int ret;
+
+    secp256k1_ecmult_gen(ctx, &rp, nonce);
+    secp256k1_ge_set_gej(&r, &rp);
+    secp256k1_scalar_inverse(&noncei, nonce);
+    ret = secp256k1_ecdsa_sig_sign_finish(sig, &r, seckey, message, &noncei, recid);
+    secp256k1_scalar_clear(&noncei);
+    secp256k1_gej_clear(&rp);
+    secp256k1_ge_clear(&r);
+    return ret;
+}
+
+/** Sign n <= SECP256K1_ECDSA_SIGN_BATCH_CHUNK messages, setting ok[i] to whether sigs[i] could be
+ *  created with nonces[i] (see secp256k1_ecdsa_sig_sign; the nonces must be valid and nonzero).
+ *
+ *  The R points are converted to affine coordinates with a single field inversion, and the nonces are
+ *  inverted with a single scalar inversion blinded by blind. Both are constant time, as is everything
+ *  else here, so the batch leaks no more than n calls to secp256k1_ecdsa_sig_sign would.
+ */
+static void secp256k1_ecdsa_sig_sign_batch(const secp256k1_ecmult_gen_context_t *ctx, secp256k1_ecdsa_sig_t *sigs, int *ok, const secp256k1_scalar_t *seckeys, const secp256k1_scalar_t *messages, const secp256k1_scalar_t *nonces, const secp256k1_scalar_t *blind, size_t n) {
+    secp256k1_gej_t rp[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    secp256k1_ge_t r[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    secp256k1_scalar_t noncei[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    size_t i;
+
+    VERIFY_CHECK(n <= SECP256K1_ECDSA_SIGN_BATCH_CHUNK);
+    for (i = 0; i < n; i++) {
+        secp256k1_ecmult_gen(ctx, &rp[i], &nonces[i]);
+    }
+    secp256k1_ge_set_all_gej(n, r, rp);
+    secp256k1_scalar_inverse_all(n, noncei, nonces, blind);
+    for (i = 0; i < n; i++) {
+        ok[i] = secp256k1_ecdsa_sig_sign_finish(&sigs[i], &r[i], &seckeys[i], &messages[i], &noncei[i], NULL);
+        secp256k1_scalar_clear(&noncei[i]);
+        secp256k1_gej_clear(&rp[i]);
+        secp256k1_ge_clear(&r[i]);
+    }
+}
+
 #endif
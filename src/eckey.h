@@ -13,6 +13,10 @@
 #include "ecmult_gen.h"
 
 static int secp256k1_eckey_pubkey_parse(secp256k1_ge_t *elem, const unsigned char *pub, int size);
+/** Parse n 33-byte compressed public keys pub[i] into elem[i], and set valid[i] to whether pub[i] is
+ *  valid (elem[i] is undefined otherwise). Returns whether all of them are. The square roots of up to four
+ *  keys are computed at once. */
+static int secp256k1_eckey_pubkey_parse_batch(secp256k1_ge_t *elem, int *valid, const unsigned char * const *pub, size_t n);
 static int secp256k1_eckey_pubkey_serialize(secp256k1_ge_t *elem, unsigned char *pub, int *size, int compressed);
 
 static int secp256k1_eckey_privkey_parse(secp256k1_scalar_t *key, const unsigned char *privkey, int privkeylen);
@@ -21,6 +25,6 @@ static int secp256k1_eckey_privkey_serialize(const secp256k1_ecmult_gen_context_
 static int secp256k1_eckey_privkey_tweak_add(secp256k1_scalar_t *key, const secp256k1_scalar_t *tweak);
 static int secp256k1_eckey_pubkey_tweak_add(const secp256k1_ecmult_context_t *ctx, secp256k1_ge_t *key, const secp256k1_scalar_t *tweak);
 static int secp256k1_eckey_privkey_tweak_mul(secp256k1_scalar_t *key, const secp256k1_scalar_t *tweak);
-static int secp256k1_eckey_pubkey_tweak_mul(const secp256k1_ecmult_context_t *ctx, secp256k1_ge_t *key, const secp256k1_scalar_t *tweak);
+static int secp256k1_eckey_pubkey_tweak_mul(secp256k1_ge_t *key, const secp256k1_scalar_t *tweak);
 
 #endif
@@ -13,6 +13,7 @@
 #include "field.h"
 #include "group.h"
 #include "ecmult_gen.h"
+#include "ecdh.h"
 
 static int secp256k1_eckey_pubkey_parse(secp256k1_ge_t *elem, const unsigned char *pub, int size) {
     if (size == 33 && (pub[0] == 0x02 || pub[0] == 0x03)) {
@@ -33,6 +34,33 @@ static int secp256k1_eckey_pubkey_parse(secp256k1_ge_t *elem, const unsigned cha
     }
 }
 
+static int secp256k1_eckey_pubkey_parse_batch(secp256k1_ge_t *elem, int *valid, const unsigned char * const *pub, size_t n) {
+    secp256k1_fe_t x[4];
+    secp256k1_ge_t ge[4];
+    int odd[4], ok[4], sqrt_ok[4];
+    int ret = 1;
+    size_t i, j, m;
+    for (i = 0; i < n; i += m) {
+        m = n - i < 4 ? n - i : 4;
+        for (j = 0; j < 4; j++) {
+            /* Pad the last group by repeating its first key. */
+            const unsigned char *p = pub[i + (j < m ? j : 0)];
+            ok[j] = (p[0] == 0x02 || p[0] == 0x03) && secp256k1_fe_set_b32(&x[j], p + 1);
+            if (!ok[j]) {
+                secp256k1_fe_set_int(&x[j], 1);
+            }
+            odd[j] = p[0] == 0x03;
+        }
+        secp256k1_ge_set_xo_x4_var(ge, sqrt_ok, x, odd);
+        for (j = 0; j < m; j++) {
+            valid[i + j] = ok[j] && sqrt_ok[j];
+            elem[i + j] = ge[j];
+            ret &= valid[i + j];
+        }
+    }
+    return ret;
+}
+
 static int secp256k1_eckey_pubkey_serialize(secp256k1_ge_t *elem, unsigned char *pub, int *size, int compressed) {
     if (secp256k1_ge_is_infinity(elem)) {
         return 0;
@@ -185,16 +213,14 @@ static int secp256k1_eckey_privkey_tweak_mul(secp256k1_scalar_t *key, const secp
     return 1;
 }
 
-static int secp256k1_eckey_pubkey_tweak_mul(const secp256k1_ecmult_context_t *ctx, secp256k1_ge_t *key, const secp256k1_scalar_t *tweak) {
-    secp256k1_scalar_t zero;
+static int secp256k1_eckey_pubkey_tweak_mul(secp256k1_ge_t *key, const secp256k1_scalar_t *tweak) {
     secp256k1_gej_t pt;
     if (secp256k1_scalar_is_zero(tweak)) {
         return 0;
     }
 
-    secp256k1_scalar_set_int(&zero, 0);
-    secp256k1_gej_set_ge(&pt, key);
-    secp256k1_ecmult(ctx, &pt, &pt, tweak, &zero);
+    /* The tweak may be secret, so use the constant-time ladder (GLV-split with the endomorphism). */
+    secp256k1_ecdh_point_multiply(&pt, key, tweak);
     secp256k1_ge_set_gej(key, &pt);
     return 1;
 }
@@ -9,9 +9,11 @@
 
 #include "num.h"
 #include "group.h"
+#include "scratch.h"
 
 typedef struct {
     /* For accelerating the computation of a*P + b*G: */
+    int window_g;                         /* window size of the tables below */
     secp256k1_ge_storage_t (*pre_g)[];    /* odd multiples of the generator */
 #ifdef USE_ENDOMORPHISM
     secp256k1_ge_storage_t (*pre_g_128)[]; /* odd multiples of 2^128*generator */
@@ -19,13 +21,49 @@ typedef struct {
 } secp256k1_ecmult_context_t;
 
 static void secp256k1_ecmult_context_init(secp256k1_ecmult_context_t *ctx);
-static void secp256k1_ecmult_context_build(secp256k1_ecmult_context_t *ctx);
-static void secp256k1_ecmult_context_clone(secp256k1_ecmult_context_t *dst,
-                                           const secp256k1_ecmult_context_t *src);
-static void secp256k1_ecmult_context_clear(secp256k1_ecmult_context_t *ctx);
+/** Build the tables of odd multiples of G for a window of window_g bits, i.e. with
+ *  2^(window_g-2) entries each. They are allocated with alloc, or with malloc if that is NULL; the
+ *  same alloc must be passed to secp256k1_ecmult_context_clear. */
+static void secp256k1_ecmult_context_build(secp256k1_ecmult_context_t *ctx, int window_g, const secp256k1_allocator_t *alloc);
+
+/** Number of entries of each table computed by one segment of secp256k1_ecmult_context_build_segment. */
+#define ECMULT_BUILD_SEGMENT_SIZE 1024
+
+/** The tables can also be built in independent segments, in any order and on any threads. Allocate them
+ *  with secp256k1_ecmult_context_build_alloc, which returns the number of segments (0 if there is nothing
+ *  to compute), and then compute each segment with secp256k1_ecmult_context_build_segment. The context
+ *  counts as built once the tables are allocated, so it must not be used before all segments are done. */
+static int secp256k1_ecmult_context_build_alloc(secp256k1_ecmult_context_t *ctx, int window_g, const secp256k1_allocator_t *alloc);
+static void secp256k1_ecmult_context_build_segment(secp256k1_ecmult_context_t *ctx, int segment);
+static void secp256k1_ecmult_context_clear(secp256k1_ecmult_context_t *ctx, const secp256k1_allocator_t *alloc);
 static int secp256k1_ecmult_context_is_built(const secp256k1_ecmult_context_t *ctx);
 
 /** Double multiply: R = na*A + ng*G */
 static void secp256k1_ecmult(const secp256k1_ecmult_context_t *ctx, secp256k1_gej_t *r, const secp256k1_gej_t *a, const secp256k1_scalar_t *na, const secp256k1_scalar_t *ng);
 
+/** Window size of the tables in secp256k1_ecmult_point_table_t. A table that is reused for many
+ *  multiplications can be built much wider than the WINDOW_A one secp256k1_ecmult builds per call. */
+#define ECMULT_POINT_WINDOW 10
+
+/** Precomputed odd multiples of a fixed point A, for computing na*A + ng*G repeatedly. */
+typedef struct {
+    secp256k1_ge_storage_t pre[1 << (ECMULT_POINT_WINDOW - 2)];     /* odd multiples of A */
+#ifdef USE_ENDOMORPHISM
+    secp256k1_ge_storage_t pre_lam[1 << (ECMULT_POINT_WINDOW - 2)]; /* odd multiples of lambda*A */
+#endif
+} secp256k1_ecmult_point_table_t;
+
+/** Fill table with the odd multiples of a, which must not be infinity. */
+static void secp256k1_ecmult_point_table_build(secp256k1_ecmult_point_table_t *table, const secp256k1_ge_t *a);
+
+/** Double multiply with a precomputed table for A: R = na*A + ng*G */
+static void secp256k1_ecmult_point(const secp256k1_ecmult_context_t *ctx, secp256k1_gej_t *r, const secp256k1_ecmult_point_table_t *table, const secp256k1_scalar_t *na, const secp256k1_scalar_t *ng);
+
+/** Multi-multiply: R = ng*G + sum(scalars[i]*points[i], i=0..n-1). ng may be NULL, in which case
+ *  the G term is omitted. Points at infinity are allowed.
+ *  Uses Strauss' algorithm for small n, and Pippenger's bucket method for large n. Temporaries are
+ *  taken from scratch, in as many batches as needed; with a NULL or tiny scratch space the points
+ *  are multiplied one at a time. */
+static void secp256k1_ecmult_multi(const secp256k1_ecmult_context_t *ctx, secp256k1_scratch_t *scratch, secp256k1_gej_t *r, const secp256k1_scalar_t *ng, const secp256k1_ge_t *points, const secp256k1_scalar_t *scalars, size_t n);
+
 #endif
@@ -10,33 +10,77 @@
 #include "scalar.h"
 #include "group.h"
 
+#if defined(COMB_BLOCKS) || defined(COMB_TEETH)
+#  if !defined(COMB_BLOCKS) || !defined(COMB_TEETH)
+#    error "COMB_BLOCKS and COMB_TEETH must be defined together"
+#  endif
+#elif !defined(ECMULT_GEN_KB) || ECMULT_GEN_KB == 86
+/** 43 blocks of 32 points (86 KiB): 43 additions and no doublings per multiplication. */
+#  define COMB_BLOCKS 43
+#  define COMB_TEETH 6
+#elif ECMULT_GEN_KB == 22
+/** 11 blocks of 32 points (22 KiB): 44 additions and 3 doublings. */
+#  define COMB_BLOCKS 11
+#  define COMB_TEETH 6
+#elif ECMULT_GEN_KB == 2
+/** 2 blocks of 16 points (2 KiB): 52 additions and 25 doublings, for small caches. */
+#  define COMB_BLOCKS 2
+#  define COMB_TEETH 5
+#else
+#  error "Set ECMULT_GEN_KB to 2, 22 or 86, or define COMB_BLOCKS and COMB_TEETH"
+#endif
+
+#if !(1 <= COMB_BLOCKS && COMB_BLOCKS <= 256)
+#  error "COMB_BLOCKS must be in the range [1, 256]"
+#endif
+#if !(1 <= COMB_TEETH && COMB_TEETH <= 8)
+#  error "COMB_TEETH must be in the range [1, 8]"
+#endif
+
+/** The spacing between teeth, the smallest that lets the COMB_BLOCKS * COMB_TEETH teeth cover 256 bits. */
+#define COMB_SPACING ((COMB_BLOCKS * COMB_TEETH + 255) / (COMB_BLOCKS * COMB_TEETH))
+/** The number of bits the comb covers, at least 256. */
+#define COMB_BITS (COMB_BLOCKS * COMB_TEETH * COMB_SPACING)
+/** The number of table entries per block; the sign of the top tooth is applied separately. */
+#define COMB_POINTS (1 << (COMB_TEETH - 1))
+
 typedef struct {
-    /* For accelerating the computation of a*G:
-     * To harden against timing attacks, use the following mechanism:
-     * * Break up the multiplicand into groups of 4 bits, called n_0, n_1, n_2, ..., n_63.
-     * * Compute sum(n_i * 16^i * G + U_i, i=0..63), where:
-     *   * U_i = U * 2^i (for i=0..62)
-     *   * U_i = U * (1-2^63) (for i=63)
-     *   where U is a point with no known corresponding scalar. Note that sum(U_i, i=0..63) = 0.
-     * For each i, and each of the 16 possible values of n_i, (n_i * 16^i * G + U_i) is
-     * precomputed (call it prec(i, n_i)). The formula now becomes sum(prec(i, n_i), i=0..63).
-     * None of the resulting prec group elements have a known scalar, and neither do any of
-     * the intermediate sums while computing a*G.
+    /* For accelerating the computation of a*G, with a signed-digit multi-comb:
+     * * Every bit d_i of a 256-bit scalar d is read as a signed digit 2*d_i - 1, so that
+     *   sum((2*d_i - 1) * 2^i * (G/2), i=0..COMB_BITS-1) = (d - (2^COMB_BITS - 1)/2) * G.
+     * * The bit positions are split into COMB_BLOCKS blocks of COMB_TEETH teeth, COMB_SPACING
+     *   bits apart. For each block and each combination of its teeth's digits, the sum of
+     *   +-2^i * (G/2) over the teeth is precomputed. Combinations with a negative top tooth are
+     *   the negations of those with a positive one, so only COMB_POINTS per block are stored.
+     * * Computing d*G then takes COMB_SPACING rounds of one lookup and addition per block,
+     *   with a doubling between rounds.
+     * To harden against timing attacks, the lookups scan every entry of a block, and the
+     * multiplication is blinded: it starts from initial = b*G, kept with a random projective Z,
+     * for a secret b. The doublings turn that into 2^(COMB_SPACING-1) * b*G, which the comb of
+     * a + blind, with blind = (2^COMB_BITS - 1)/2 - 2^(COMB_SPACING-1) * b, cancels out again.
+     * None of the intermediate sums while computing a*G have a known scalar.
      */
-    secp256k1_ge_storage_t (*prec)[64][16]; /* prec[j][i] = 16^j * i * G + U_i */
+    secp256k1_ge_storage_t (*prec)[COMB_BLOCKS][COMB_POINTS]; /* prec[j][i] = sum(+-2^k * (G/2)) over the teeth k of block j */
     secp256k1_scalar_t blind;
     secp256k1_gej_t initial;
 } secp256k1_ecmult_gen_context_t;
 
+/** The wNAF window of secp256k1_ecmult_gen2_small_var, and its number of table entries per bit position. */
+#define ECMULT_GEN2_VAR_WINDOW 5
+#define ECMULT_GEN2_VAR_POINTS (1 << (ECMULT_GEN2_VAR_WINDOW - 2))
+
 typedef struct {
     secp256k1_ge_storage_t (*prec)[16][16]; /* prec[j][i] = 16^j * i * G + U_i */
+    /* For public values: the wNAF digits of a 64-bit number sit at bit positions 0..64, so keeping the odd
+     * multiples of every 2^k * G2 turns each nonzero digit into a single addition, without doublings. */
+    secp256k1_ge_storage_t (*prec_var)[65][ECMULT_GEN2_VAR_POINTS]; /* prec_var[k][i] = (2*i + 1) * 2^k * G2 */
 } secp256k1_ecmult_gen2_context_t;
 
 static void secp256k1_ecmult_gen_context_init(secp256k1_ecmult_gen_context_t* ctx);
-static void secp256k1_ecmult_gen_context_build(secp256k1_ecmult_gen_context_t* ctx);
-static void secp256k1_ecmult_gen_context_clone(secp256k1_ecmult_gen_context_t *dst,
-                                               const secp256k1_ecmult_gen_context_t* src);
-static void secp256k1_ecmult_gen_context_clear(secp256k1_ecmult_gen_context_t* ctx);
+/** Build the comb table, allocated with alloc (or malloc if that is NULL), which must also be passed
+ *  to secp256k1_ecmult_gen_context_clear. */
+static void secp256k1_ecmult_gen_context_build(secp256k1_ecmult_gen_context_t* ctx, const secp256k1_allocator_t *alloc);
+static void secp256k1_ecmult_gen_context_clear(secp256k1_ecmult_gen_context_t* ctx, const secp256k1_allocator_t *alloc);
 static int secp256k1_ecmult_gen_context_is_built(const secp256k1_ecmult_gen_context_t* ctx);
 
 /** Multiply with the generator: R = a*G */
@@ -44,17 +88,28 @@ static void secp256k1_ecmult_gen(const secp256k1_ecmult_gen_context_t* ctx, secp
 
 static void secp256k1_ecmult_gen_blind(secp256k1_ecmult_gen_context_t *ctx, const unsigned char *seed32);
 
+/** Build ctx (which must not be built yet) for multiplying an arbitrary point instead of G, so that
+ *  secp256k1_ecmult_gen computes a*base. The table is always allocated, and must be freed by the caller
+ *  rather than with secp256k1_ecmult_gen_context_clear. The blinding is seeded with seed32 if not NULL. */
+static void secp256k1_ecmult_gen_context_build_point(secp256k1_ecmult_gen_context_t* ctx, const secp256k1_ge_t *base, const unsigned char *seed32);
+
+/** Like secp256k1_ecmult_gen_blind, for a context built with secp256k1_ecmult_gen_context_build_point. */
+static void secp256k1_ecmult_gen_blind_base(secp256k1_ecmult_gen_context_t *ctx, const unsigned char *seed32, const secp256k1_ge_t *base);
+
 static void secp256k1_ecmult_gen2_context_init(secp256k1_ecmult_gen2_context_t* ctx);
-static void secp256k1_ecmult_gen2_context_build(secp256k1_ecmult_gen2_context_t* ctx);
-static void secp256k1_ecmult_gen2_context_clone(secp256k1_ecmult_gen2_context_t *dst,
-                                               const secp256k1_ecmult_gen2_context_t* src);
-static void secp256k1_ecmult_gen2_context_clear(secp256k1_ecmult_gen2_context_t* ctx);
+/** Build the tables, allocated with alloc (or malloc if that is NULL), which must also be passed to
+ *  secp256k1_ecmult_gen2_context_clear. */
+static void secp256k1_ecmult_gen2_context_build(secp256k1_ecmult_gen2_context_t* ctx, const secp256k1_allocator_t *alloc);
+static void secp256k1_ecmult_gen2_context_clear(secp256k1_ecmult_gen2_context_t* ctx, const secp256k1_allocator_t *alloc);
 
 static int secp256k1_ecmult_gen2_context_is_built(const secp256k1_ecmult_gen2_context_t* ctx);
 
 /** Multiply a small number with the generator: r = gn*G2 */
 static void secp256k1_ecmult_gen2_small(const secp256k1_ecmult_gen2_context_t *ctx, secp256k1_gej_t *r, uint64_t gn);
 
+/** Same as secp256k1_ecmult_gen2_small, but variable time in gn, for public values. */
+static void secp256k1_ecmult_gen2_small_var(const secp256k1_ecmult_gen2_context_t *ctx, secp256k1_gej_t *r, uint64_t gn);
+
 /* sec * G + value * G2. */
 static void secp256k1_ecmult_gen_gen2(const secp256k1_ecmult_gen_context_t *ecmult_gen_ctx,
  const secp256k1_ecmult_gen2_context_t *cmult_gen2_ctx, secp256k1_gej_t *rj, const secp256k1_scalar_t *sec, uint64_t value);
@@ -11,6 +11,12 @@
 #include "group.h"
 #include "ecmult_gen.h"
 #include "hash_impl.h"
+#ifdef USE_ECMULT_STATIC_PRECOMPUTATION
+#include "ecmult_static_context.h"
+#if ECMULT_STATIC_COMB_BLOCKS != COMB_BLOCKS || ECMULT_STATIC_COMB_TEETH != COMB_TEETH
+#error "The static ecmult_gen table was generated for another comb; regenerate src/ecmult_static_context.h"
+#endif
+#endif
 
 static void secp256k1_ecmult_gen_context_init(secp256k1_ecmult_gen_context_t *ctx) {
     ctx->prec = NULL;
@@ -18,81 +24,128 @@ static void secp256k1_ecmult_gen_context_init(secp256k1_ecmult_gen_context_t *ct
 
 static void secp256k1_ecmult_gen2_context_init(secp256k1_ecmult_gen2_context_t *ctx) {
     ctx->prec = NULL;
+    ctx->prec_var = NULL;
 }
 
-static void secp256k1_ecmult_gen_context_build(secp256k1_ecmult_gen_context_t *ctx) {
-    secp256k1_ge_t prec[1024];
-    secp256k1_gej_t gj;
-    secp256k1_gej_t nums_gej;
-    int i, j;
+/* Compute the comb table of secp256k1_ecmult_gen for an arbitrary base point. */
+static void secp256k1_ecmult_gen_prec_compute(secp256k1_ge_storage_t (*table)[COMB_BLOCKS][COMB_POINTS], const secp256k1_ge_t *base) {
+    secp256k1_ge_t *prec;
+    secp256k1_gej_t *precj; /* Jacobian versions of prec. */
+    secp256k1_gej_t ds[COMB_TEETH];
+    secp256k1_gej_t u, sum;
+    secp256k1_scalar_t half;
+    size_t pos = 0;
+    int block, tooth, i;
 
-    if (ctx->prec != NULL) {
-        return;
-    }
-
-    ctx->prec = (secp256k1_ge_storage_t (*)[64][16])checked_malloc(sizeof(*ctx->prec));
-
-    /* get the generator */
-    secp256k1_gej_set_ge(&gj, &secp256k1_ge_const_g);
-
-    /* Construct a group element with no known corresponding scalar (nothing up my sleeve). */
-    {
-        static const unsigned char nums_b32[33] = "The scalar for this x is unknown";
-        secp256k1_fe_t nums_x;
-        secp256k1_ge_t nums_ge;
-        VERIFY_CHECK(secp256k1_fe_set_b32(&nums_x, nums_b32));
-        VERIFY_CHECK(secp256k1_ge_set_xo_var(&nums_ge, &nums_x, 0));
-        secp256k1_gej_set_ge(&nums_gej, &nums_ge);
-        /* Add G to make the bits in x uniformly distributed. */
-        secp256k1_gej_add_ge_var(&nums_gej, &nums_gej, &secp256k1_ge_const_g, NULL);
+    /* u = base/2, with a simple double-and-add ladder on the scalar 1/2. */
+    secp256k1_scalar_set_int(&half, 2);
+    secp256k1_scalar_inverse_var(&half, &half);
+    secp256k1_gej_set_infinity(&u);
+    for (i = 255; i >= 0; i--) {
+        secp256k1_gej_double_var(&u, &u, NULL);
+        if (secp256k1_scalar_get_bits_var(&half, i, 1)) {
+            secp256k1_gej_add_ge_var(&u, &u, base, NULL);
+        }
     }
 
-    /* compute prec. */
-    {
-        secp256k1_gej_t precj[1024]; /* Jacobian versions of prec. */
-        secp256k1_gej_t gbase;
-        secp256k1_gej_t numsbase;
-        gbase = gj; /* 16^j * G */
-        numsbase = nums_gej; /* 2^j * nums. */
-        for (j = 0; j < 64; j++) {
-            /* Set precj[j*16 .. j*16+15] to (numsbase, numsbase + gbase, ..., numsbase + 15*gbase). */
-            precj[j*16] = numsbase;
-            for (i = 1; i < 16; i++) {
-                secp256k1_gej_add_var(&precj[j*16 + i], &precj[j*16 + i - 1], &gbase, NULL);
+    /* The temporaries are too large to keep on small thread stacks. */
+    precj = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * COMB_BLOCKS * COMB_POINTS);
+    prec = (secp256k1_ge_t *)checked_malloc(sizeof(secp256k1_ge_t) * COMB_BLOCKS * COMB_POINTS);
+    for (block = 0; block < COMB_BLOCKS; block++) {
+        /* Here u = 2^(block*COMB_TEETH*COMB_SPACING) * base/2. */
+        secp256k1_gej_set_infinity(&sum);
+        for (tooth = 0; tooth < COMB_TEETH; tooth++) {
+            /* sum = sum(2^((block*COMB_TEETH + t)*COMB_SPACING), t=0..tooth) * base/2, and
+             * ds[tooth] = 2^((block*COMB_TEETH + tooth)*COMB_SPACING + 1) * base/2, the difference
+             * between a positive and a negative digit for this tooth. */
+            secp256k1_gej_add_var(&sum, &sum, &u, NULL);
+            secp256k1_gej_double_var(&u, &u, NULL);
+            ds[tooth] = u;
+            for (i = 1; i < COMB_SPACING; i++) {
+                secp256k1_gej_double_var(&u, &u, NULL);
             }
-            /* Multiply gbase by 16. */
-            for (i = 0; i < 4; i++) {
-                secp256k1_gej_double_var(&gbase, &gbase, NULL);
-            }
-            /* Multiply numbase by 2. */
-            secp256k1_gej_double_var(&numsbase, &numsbase, NULL);
-            if (j == 62) {
-                /* In the last iteration, numsbase is (1 - 2^j) * nums instead. */
-                secp256k1_gej_neg(&numsbase, &numsbase);
-                secp256k1_gej_add_var(&numsbase, &numsbase, &nums_gej, NULL);
+        }
+        /* Entry 0 has all digits negative; entry i differs from entry i - 2^t in tooth t only. */
+        secp256k1_gej_neg(&precj[pos++], &sum);
+        for (tooth = 0; tooth < COMB_TEETH - 1; tooth++) {
+            size_t stride = ((size_t)1) << tooth;
+            size_t index;
+            for (index = 0; index < stride; index++, pos++) {
+                secp256k1_gej_add_var(&precj[pos], &precj[pos - stride], &ds[tooth], NULL);
             }
         }
-        secp256k1_ge_set_all_gej_var(1024, prec, precj);
     }
-    for (j = 0; j < 64; j++) {
-        for (i = 0; i < 16; i++) {
-            secp256k1_ge_to_storage(&(*ctx->prec)[j][i], &prec[j*16 + i]);
+    VERIFY_CHECK(pos == COMB_BLOCKS * COMB_POINTS);
+    secp256k1_ge_set_all_gej_var(COMB_BLOCKS * COMB_POINTS, prec, precj);
+    free(precj);
+    for (block = 0; block < COMB_BLOCKS; block++) {
+        for (i = 0; i < COMB_POINTS; i++) {
+            secp256k1_ge_to_storage(&(*table)[block][i], &prec[block * COMB_POINTS + i]);
         }
     }
+    free(prec);
+}
+
+/* Set diff = (2^COMB_BITS - 1)/2 (mod the order), the offset of the signed-digit comb, and
+ * scale = 2^(COMB_SPACING - 1), the factor by which the doublings multiply the initial point. */
+static void secp256k1_ecmult_gen_blind_consts(secp256k1_scalar_t *diff, secp256k1_scalar_t *scale) {
+    secp256k1_scalar_t half, minus_one;
+    int i;
+    secp256k1_scalar_set_int(&half, 2);
+    secp256k1_scalar_inverse_var(&half, &half);
+    secp256k1_scalar_set_int(&minus_one, 1);
+    secp256k1_scalar_negate(&minus_one, &minus_one);
+    secp256k1_scalar_set_int(diff, 1);
+    secp256k1_scalar_set_int(scale, 1);
+    for (i = 0; i < COMB_BITS; i++) {
+        if (i == COMB_SPACING - 1) {
+            *scale = *diff;
+        }
+        secp256k1_scalar_add(diff, diff, diff);
+    }
+    secp256k1_scalar_add(diff, diff, &minus_one);
+    secp256k1_scalar_mul(diff, diff, &half);
+}
+
+static void secp256k1_ecmult_gen_context_build(secp256k1_ecmult_gen_context_t *ctx, const secp256k1_allocator_t *alloc) {
+    if (ctx->prec != NULL) {
+        return;
+    }
+
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    ctx->prec = (secp256k1_ge_storage_t (*)[COMB_BLOCKS][COMB_POINTS])secp256k1_allocator_malloc(alloc, sizeof(*ctx->prec));
+    secp256k1_ecmult_gen_prec_compute(ctx->prec, &secp256k1_ge_const_g);
+#else
+    (void)alloc;
+    ctx->prec = (secp256k1_ge_storage_t (*)[COMB_BLOCKS][COMB_POINTS])secp256k1_ecmult_static_gen_context;
+#endif
     secp256k1_ecmult_gen_blind(ctx, NULL);
 }
 
-static void secp256k1_ecmult_gen2_context_build(secp256k1_ecmult_gen2_context_t *ctx) {
-    secp256k1_ge_t prec[256];
+static void secp256k1_ecmult_gen_context_build_point(secp256k1_ecmult_gen_context_t *ctx, const secp256k1_ge_t *base, const unsigned char *seed32) {
+    VERIFY_CHECK(ctx->prec == NULL);
+    ctx->prec = (secp256k1_ge_storage_t (*)[COMB_BLOCKS][COMB_POINTS])checked_malloc(sizeof(*ctx->prec));
+    secp256k1_ecmult_gen_prec_compute(ctx->prec, base);
+    secp256k1_ecmult_gen_blind_base(ctx, NULL, base);
+    if (seed32 != NULL) {
+        secp256k1_ecmult_gen_blind_base(ctx, seed32, base);
+    }
+}
+
+static void secp256k1_ecmult_gen2_context_build(secp256k1_ecmult_gen2_context_t *ctx, const secp256k1_allocator_t *alloc) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    secp256k1_ge_t *prec;
     secp256k1_gej_t gj;
     secp256k1_gej_t nums_gej;
     int i, j;
+#endif
 
     if (ctx->prec != NULL) {
         return;
     }
 
-    ctx->prec = (secp256k1_ge_storage_t (*)[16][16])checked_malloc(sizeof(*ctx->prec));
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    ctx->prec = (secp256k1_ge_storage_t (*)[16][16])secp256k1_allocator_malloc(alloc, sizeof(*ctx->prec));
 
     /* get the generator */
     secp256k1_gej_set_ge(&gj, &secp256k1_ge_const_g2);
@@ -111,9 +164,12 @@ static void secp256k1_ecmult_gen2_context_build(secp256k1_ecmult_gen2_context_t
 
     /* compute prec. */
     {
-        secp256k1_gej_t precj[256]; /* Jacobian versions of prec. */
+        secp256k1_gej_t *precj; /* Jacobian versions of prec. */
         secp256k1_gej_t gbase;
         secp256k1_gej_t numsbase;
+        /* The temporaries are too large to keep on small thread stacks. */
+        precj = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * 256);
+        prec = (secp256k1_ge_t *)checked_malloc(sizeof(secp256k1_ge_t) * 256);
         gbase = gj; /* 16^j * G */
         numsbase = nums_gej; /* 2^j * nums. */
         for (j = 0; j < 16; j++) {
@@ -135,12 +191,45 @@ static void secp256k1_ecmult_gen2_context_build(secp256k1_ecmult_gen2_context_t
             }
         }
         secp256k1_ge_set_all_gej_var(256, prec, precj);
+        free(precj);
     }
     for (j = 0; j < 16; j++) {
         for (i = 0; i < 16; i++) {
             secp256k1_ge_to_storage(&(*ctx->prec)[j][i], &prec[j*16 + i]);
         }
     }
+    free(prec);
+
+    /* compute prec_var. */
+    ctx->prec_var = (secp256k1_ge_storage_t (*)[65][ECMULT_GEN2_VAR_POINTS])secp256k1_allocator_malloc(alloc, sizeof(*ctx->prec_var));
+    {
+        secp256k1_gej_t *precj;
+        secp256k1_gej_t twice;
+        precj = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * 65 * ECMULT_GEN2_VAR_POINTS);
+        prec = (secp256k1_ge_t *)checked_malloc(sizeof(secp256k1_ge_t) * 65 * ECMULT_GEN2_VAR_POINTS);
+        /* gj = 2^j * G2; precj[j*POINTS + i] = (2*i + 1) * gj. */
+        for (j = 0; j < 65; j++) {
+            secp256k1_gej_double_var(&twice, &gj, NULL);
+            precj[j * ECMULT_GEN2_VAR_POINTS] = gj;
+            for (i = 1; i < ECMULT_GEN2_VAR_POINTS; i++) {
+                secp256k1_gej_add_var(&precj[j * ECMULT_GEN2_VAR_POINTS + i], &precj[j * ECMULT_GEN2_VAR_POINTS + i - 1], &twice, NULL);
+            }
+            gj = twice;
+        }
+        secp256k1_ge_set_all_gej_var(65 * ECMULT_GEN2_VAR_POINTS, prec, precj);
+        free(precj);
+    }
+    for (j = 0; j < 65; j++) {
+        for (i = 0; i < ECMULT_GEN2_VAR_POINTS; i++) {
+            secp256k1_ge_to_storage(&(*ctx->prec_var)[j][i], &prec[j * ECMULT_GEN2_VAR_POINTS + i]);
+        }
+    }
+    free(prec);
+#else
+    (void)alloc;
+    ctx->prec = (secp256k1_ge_storage_t (*)[16][16])secp256k1_ecmult_static_gen2_context;
+    ctx->prec_var = (secp256k1_ge_storage_t (*)[65][ECMULT_GEN2_VAR_POINTS])secp256k1_ecmult_static_gen2_var_context;
+#endif
 }
 
 static int secp256k1_ecmult_gen_context_is_built(const secp256k1_ecmult_gen_context_t* ctx) {
@@ -151,55 +240,65 @@ static int secp256k1_ecmult_gen2_context_is_built(const secp256k1_ecmult_gen2_co
     return ctx->prec != NULL;
 }
 
-static void secp256k1_ecmult_gen_context_clone(secp256k1_ecmult_gen_context_t *dst,
-                                               const secp256k1_ecmult_gen_context_t *src) {
-    if (src->prec == NULL) {
-        dst->prec = NULL;
-    } else {
-        dst->prec = (secp256k1_ge_storage_t (*)[64][16])checked_malloc(sizeof(*dst->prec));
-        memcpy(dst->prec, src->prec, sizeof(*dst->prec));
-        dst->initial = src->initial;
-        dst->blind = src->blind;
-    }
-}
-
-static void secp256k1_ecmult_gen2_context_clone(secp256k1_ecmult_gen2_context_t *dst,
-                                               const secp256k1_ecmult_gen2_context_t *src) {
-    if (src->prec == NULL) {
-        dst->prec = NULL;
-    } else {
-        dst->prec = (secp256k1_ge_storage_t (*)[16][16])checked_malloc(sizeof(*dst->prec));
-        memcpy(dst->prec, src->prec, sizeof(*dst->prec));
-    }
-}
-
-static void secp256k1_ecmult_gen_context_clear(secp256k1_ecmult_gen_context_t *ctx) {
-    free(ctx->prec);
+static void secp256k1_ecmult_gen_context_clear(secp256k1_ecmult_gen_context_t *ctx, const secp256k1_allocator_t *alloc) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    secp256k1_allocator_free(alloc, ctx->prec, sizeof(*ctx->prec));
+#else
+    (void)alloc;
+#endif
     secp256k1_scalar_clear(&ctx->blind);
     secp256k1_gej_clear(&ctx->initial);
     ctx->prec = NULL;
 }
 
-static void secp256k1_ecmult_gen2_context_clear(secp256k1_ecmult_gen2_context_t *ctx) {
-    free(ctx->prec);
+static void secp256k1_ecmult_gen2_context_clear(secp256k1_ecmult_gen2_context_t *ctx, const secp256k1_allocator_t *alloc) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    secp256k1_allocator_free(alloc, ctx->prec, sizeof(*ctx->prec));
+    secp256k1_allocator_free(alloc, ctx->prec_var, sizeof(*ctx->prec_var));
+#else
+    (void)alloc;
+#endif
     ctx->prec = NULL;
+    ctx->prec_var = NULL;
 }
 
 static void secp256k1_ecmult_gen(const secp256k1_ecmult_gen_context_t *ctx, secp256k1_gej_t *r, const secp256k1_scalar_t *gn) {
     secp256k1_ge_t add;
     secp256k1_ge_storage_t adds;
-    secp256k1_scalar_t gnb;
-    int bits;
-    int i, j;
+    secp256k1_fe_t neg;
+    secp256k1_scalar_t d;
+    unsigned char b[32];
+    uint32_t recoded[(COMB_BITS + 31) >> 5];
+    uint32_t comb_off, block, tooth, bit_pos, bits, sign, abs;
+    int i;
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_GEN, 1);
     memset(&adds, 0, sizeof(adds));
+    memset(recoded, 0, sizeof(recoded));
     *r = ctx->initial;
-    /* Blind scalar/point multiplication by computing (n-b)G + bG instead of nG. */
-    secp256k1_scalar_add(&gnb, gn, &ctx->blind);
+    /* Blind scalar/point multiplication by computing 2^(COMB_SPACING-1) * b*G + comb(n + blind) instead
+     * of n*G, where blind = (2^COMB_BITS - 1)/2 - 2^(COMB_SPACING-1) * b as the doublings below also
+     * apply to the initial point. */
+    secp256k1_scalar_add(&d, gn, &ctx->blind);
+    secp256k1_scalar_get_b32(b, &d);
+    for (i = 0; i < 32; i++) {
+        recoded[i >> 2] |= (uint32_t)b[31 - i] << (8 * (i & 3));
+    }
     add.infinity = 0;
-    for (j = 0; j < 64; j++) {
-        bits = secp256k1_scalar_get_bits(&gnb, j * 4, 4);
-        for (i = 0; i < 16; i++) {
-            /** This uses a conditional move to avoid any secret data in array indexes.
+    comb_off = COMB_SPACING - 1;
+    while (1) {
+        bit_pos = comb_off;
+        for (block = 0; block < COMB_BLOCKS; block++) {
+            /* Gather the digits of this block's teeth: bit t of bits is bit
+             * (block*COMB_TEETH + t)*COMB_SPACING + comb_off of d. */
+            bits = 0;
+            for (tooth = 0; tooth < COMB_TEETH; tooth++) {
+                bits |= ((recoded[bit_pos >> 5] >> (bit_pos & 0x1F)) & 1) << tooth;
+                bit_pos += COMB_SPACING;
+            }
+            /* With a negative top tooth, look up the complement and negate it. */
+            sign = (bits >> (COMB_TEETH - 1)) & 1;
+            abs = (bits ^ -sign) & (COMB_POINTS - 1);
+            /** This scans the whole row with conditional moves to avoid any secret data in array indexes.
              *   _Any_ use of secret indexes has been demonstrated to result in timing
              *   sidechannels, even when the cache-line access patterns are uniform.
              *  See also:
@@ -209,29 +308,39 @@ static void secp256k1_ecmult_gen(const secp256k1_ecmult_gen_context_t *ctx, secp
              *    by Dag Arne Osvik, Adi Shamir, and Eran Tromer
              *    (http://www.tau.ac.il/~tromer/papers/cache.pdf)
              */
-            secp256k1_ge_storage_cmov(&adds, &(*ctx->prec)[j][i], i == bits);
+            secp256k1_ge_storage_select(&adds, (*ctx->prec)[block], COMB_POINTS, abs);
+            secp256k1_ge_from_storage(&add, &adds);
+            secp256k1_fe_negate(&neg, &add.y, 1);
+            secp256k1_fe_cmov(&add.y, &neg, sign);
+            secp256k1_gej_add_ge(r, r, &add);
         }
-        secp256k1_ge_from_storage(&add, &adds);
-        secp256k1_gej_add_ge(r, r, &add);
+        if (comb_off-- == 0) {
+            break;
+        }
+        secp256k1_gej_double_var(r, r, NULL);
     }
-    bits = 0;
+    bits = sign = abs = 0;
+    memset(b, 0, sizeof(b));
+    memset(recoded, 0, sizeof(recoded));
     secp256k1_ge_clear(&add);
-    secp256k1_scalar_clear(&gnb);
+    secp256k1_fe_clear(&neg);
+    secp256k1_scalar_clear(&d);
 }
 
-/* Setup blinding values for secp256k1_ecmult_gen. */
-static void secp256k1_ecmult_gen_blind(secp256k1_ecmult_gen_context_t *ctx, const unsigned char *seed32) {
-    secp256k1_scalar_t b;
+/* Setup blinding values for secp256k1_ecmult_gen, for a context whose comb table is for base. */
+static void secp256k1_ecmult_gen_blind_base(secp256k1_ecmult_gen_context_t *ctx, const unsigned char *seed32, const secp256k1_ge_t *base) {
+    secp256k1_scalar_t b, diff, scale;
     secp256k1_gej_t gb;
     secp256k1_fe_t s;
     unsigned char nonce32[32];
     secp256k1_rfc6979_hmac_sha256_t rng;
     int retry;
+    secp256k1_ecmult_gen_blind_consts(&diff, &scale);
     if (!seed32) {
-        /* When seed is NULL, reset the initial point and blinding value. */
-        secp256k1_gej_set_ge(&ctx->initial, &secp256k1_ge_const_g);
+        /* When seed is NULL, reset the initial point and blinding value (to b = -1). */
+        secp256k1_gej_set_ge(&ctx->initial, base);
         secp256k1_gej_neg(&ctx->initial, &ctx->initial);
-        secp256k1_scalar_set_int(&ctx->blind, 1);
+        secp256k1_scalar_add(&ctx->blind, &scale, &diff);
     }
     /* The prior blinding value (if not reset) is chained forward by including it in the hash. */
     secp256k1_scalar_get_b32(nonce32, &ctx->blind);
@@ -258,27 +367,31 @@ static void secp256k1_ecmult_gen_blind(secp256k1_ecmult_gen_context_t *ctx, cons
     secp256k1_rfc6979_hmac_sha256_finalize(&rng);
     memset(nonce32, 0, 32);
     secp256k1_ecmult_gen(ctx, &gb, &b);
+    secp256k1_scalar_mul(&b, &b, &scale);
     secp256k1_scalar_negate(&b, &b);
-    ctx->blind = b;
+    secp256k1_scalar_add(&ctx->blind, &b, &diff);
     ctx->initial = gb;
     secp256k1_scalar_clear(&b);
     secp256k1_gej_clear(&gb);
 }
 
+static void secp256k1_ecmult_gen_blind(secp256k1_ecmult_gen_context_t *ctx, const unsigned char *seed32) {
+    secp256k1_ecmult_gen_blind_base(ctx, seed32, &secp256k1_ge_const_g);
+}
+
 /* Version of secp256k1_ecmult_gen using the second generator and working only on numbers in the range [0 .. 2^64). */
 static void secp256k1_ecmult_gen2_small(const secp256k1_ecmult_gen2_context_t *ctx, secp256k1_gej_t *r, uint64_t gn) {
     secp256k1_ge_t add;
     secp256k1_ge_storage_t adds;
     int bits;
-    int i, j;
+    int j;
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_GEN2, 1);
     memset(&adds, 0, sizeof(adds));
     secp256k1_gej_set_infinity(r);
     add.infinity = 0;
     for (j = 0; j < 16; j++) {
         bits = (gn >> (j * 4)) & 15;
-        for (i = 0; i < 16; i++) {
-            secp256k1_ge_storage_cmov(&adds, &(*ctx->prec)[j][i], i == bits);
-        }
+        secp256k1_ge_storage_select(&adds, (*ctx->prec)[j], 16, bits);
         secp256k1_ge_from_storage(&add, &adds);
         secp256k1_gej_add_ge(r, r, &add);
     }
@@ -286,6 +399,38 @@ static void secp256k1_ecmult_gen2_small(const secp256k1_ecmult_gen2_context_t *c
     secp256k1_ge_clear(&add);
 }
 
+static void secp256k1_ecmult_gen2_small_var(const secp256k1_ecmult_gen2_context_t *ctx, secp256k1_gej_t *r, uint64_t gn) {
+    secp256k1_ge_t add;
+    int bit = 0, carry = 0, now, word;
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_GEN2, 1);
+    secp256k1_gej_set_infinity(r);
+    /* Walk the width-ECMULT_GEN2_VAR_WINDOW NAF of gn from the bottom, as secp256k1_ecmult_wnaf does, and add each
+     * nonzero digit d at position bit as +-prec_var[bit][(|d| - 1)/2]. */
+    while (bit < 64) {
+        if ((int)((gn >> bit) & 1) == carry) {
+            bit++;
+            continue;
+        }
+        now = ECMULT_GEN2_VAR_WINDOW;
+        if (now > 64 - bit) {
+            now = 64 - bit;
+        }
+        word = (int)((gn >> bit) & ((((uint64_t)1) << now) - 1)) + carry;
+        carry = (word >> (ECMULT_GEN2_VAR_WINDOW - 1)) & 1;
+        word -= carry << ECMULT_GEN2_VAR_WINDOW;
+        secp256k1_ge_from_storage(&add, &(*ctx->prec_var)[bit][((word < 0 ? -word : word) - 1) >> 1]);
+        if (word < 0) {
+            secp256k1_ge_neg(&add, &add);
+        }
+        secp256k1_gej_add_ge_var(r, r, &add, NULL);
+        bit += now;
+    }
+    if (carry) {
+        secp256k1_ge_from_storage(&add, &(*ctx->prec_var)[64][0]);
+        secp256k1_gej_add_ge_var(r, r, &add, NULL);
+    }
+}
+
 /* sec * G + value * G2. */
 SECP256K1_INLINE static void secp256k1_ecmult_gen_gen2(const secp256k1_ecmult_gen_context_t *ecmult_gen_ctx,
  const secp256k1_ecmult_gen2_context_t *cmult_gen2_ctx, secp256k1_gej_t *rj, const secp256k1_scalar_t *sec, uint64_t value) {
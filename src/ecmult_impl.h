@@ -9,14 +9,22 @@
 
 #include "group.h"
 #include "scalar.h"
+#include "scratch_impl.h"
 #include "ecmult.h"
 
 /* optimal for 128-bit and 256-bit exponents. */
 #define WINDOW_A 5
 
+/** Smallest and largest window sizes the tables of G can be built with. */
+#define ECMULT_WINDOW_MIN 2
+#define ECMULT_WINDOW_MAX 24
+
 /** larger numbers may result in slightly better performance, at the cost of
-    exponentially larger precomputed tables. */
-#ifdef USE_ENDOMORPHISM
+    exponentially larger precomputed tables. This is the default window size;
+    secp256k1_ecmult_context_build can use any other. */
+#if defined(ECMULT_WINDOW_SIZE)
+#define WINDOW_G ECMULT_WINDOW_SIZE
+#elif defined(USE_ENDOMORPHISM)
 /** Two tables for window size 15: 1.375 MiB. */
 #define WINDOW_G 15
 #else
@@ -24,9 +32,20 @@
 #define WINDOW_G 16
 #endif
 
+#if WINDOW_G < ECMULT_WINDOW_MIN || WINDOW_G > ECMULT_WINDOW_MAX
+#error "Set ECMULT_WINDOW_SIZE to an integer in range [2..24]"
+#endif
+
 /** The number of entries a table with precomputed multiples needs to have. */
 #define ECMULT_TABLE_SIZE(w) (1 << ((w)-2))
 
+#ifdef USE_ECMULT_STATIC_PRECOMPUTATION
+#include "ecmult_static_context.h"
+#if WINDOW_G > ECMULT_STATIC_WINDOW_G || (defined(USE_ENDOMORPHISM) && WINDOW_G > ECMULT_STATIC_WINDOW_G_128)
+#error "WINDOW_G is larger than the window of the static precomputation tables"
+#endif
+#endif
+
 /** Fill a table 'prej' with precomputed odd multiples of a. Prej will contain
  *  the values [1*a,3*a,...,(2*n-1)*a], so it space for n values. zr[0] will
  *  contain prej[0].z / a.z. The other zr[i] values = prej[i].z / prej[i-1].z.
@@ -137,73 +156,155 @@ static void secp256k1_ecmult_odd_multiples_table_storage_var(int n, secp256k1_ge
     } \
 } while(0)
 
+/** How many WNAF positions ahead of its use an entry of the G tables is prefetched. The tables are
+ *  too large for the cache, and a doubling and a few additions per position hide most of the latency. */
+#define ECMULT_PREFETCH_DISTANCE 4
+
+/** Prefetch the entry of pre that ECMULT_TABLE_GET_GE_STORAGE will read for position i of wnaf (which
+ *  has bits positions), if there is a nonzero digit there. */
+SECP256K1_INLINE static void secp256k1_ecmult_table_prefetch(const secp256k1_ge_storage_t *pre, const int *wnaf, int bits, int i) {
+    int n;
+    if (i >= 0 && i < bits && (n = wnaf[i]) != 0) {
+        SECP256K1_PREFETCH(&pre[((n > 0 ? n : -n) - 1) / 2]);
+    }
+}
+
 static void secp256k1_ecmult_context_init(secp256k1_ecmult_context_t *ctx) {
+    ctx->window_g = WINDOW_G;
     ctx->pre_g = NULL;
 #ifdef USE_ENDOMORPHISM
     ctx->pre_g_128 = NULL;
 #endif
 }
 
-static void secp256k1_ecmult_context_build(secp256k1_ecmult_context_t *ctx) {
-    secp256k1_gej_t gj;
-
+static int secp256k1_ecmult_context_build_alloc(secp256k1_ecmult_context_t *ctx, int window_g, const secp256k1_allocator_t *alloc) {
     if (ctx->pre_g != NULL) {
-        return;
+        return 0;
+    }
+    VERIFY_CHECK(window_g >= ECMULT_WINDOW_MIN && window_g <= ECMULT_WINDOW_MAX);
+
+#ifdef USE_ECMULT_STATIC_PRECOMPUTATION
+    (void)alloc;
+    /* The odd multiples of a smaller window are a prefix of those of the static tables, but
+     * there is nothing to use for a larger one. */
+    if (window_g > ECMULT_STATIC_WINDOW_G) {
+        window_g = ECMULT_STATIC_WINDOW_G;
     }
-
-    /* get the generator */
-    secp256k1_gej_set_ge(&gj, &secp256k1_ge_const_g);
-
-    ctx->pre_g = (secp256k1_ge_storage_t (*)[])checked_malloc(sizeof((*ctx->pre_g)[0]) * ECMULT_TABLE_SIZE(WINDOW_G));
-
-    /* precompute the tables with odd multiples */
-    secp256k1_ecmult_odd_multiples_table_storage_var(ECMULT_TABLE_SIZE(WINDOW_G), *ctx->pre_g, &gj);
-
 #ifdef USE_ENDOMORPHISM
-    {
-        secp256k1_gej_t g_128j;
-        int i;
-
-        ctx->pre_g_128 = (secp256k1_ge_storage_t (*)[])checked_malloc(sizeof((*ctx->pre_g_128)[0]) * ECMULT_TABLE_SIZE(WINDOW_G));
-
-        /* calculate 2^128*generator */
-        g_128j = gj;
-        for (i = 0; i < 128; i++) {
-            secp256k1_gej_double_var(&g_128j, &g_128j, NULL);
-        }
-        secp256k1_ecmult_odd_multiples_table_storage_var(ECMULT_TABLE_SIZE(WINDOW_G), *ctx->pre_g_128, &g_128j);
+    if (window_g > ECMULT_STATIC_WINDOW_G_128) {
+        window_g = ECMULT_STATIC_WINDOW_G_128;
     }
+#endif
+    ctx->window_g = window_g;
+    ctx->pre_g = (secp256k1_ge_storage_t (*)[])secp256k1_ecmult_static_pre_g;
+#ifdef USE_ENDOMORPHISM
+    ctx->pre_g_128 = (secp256k1_ge_storage_t (*)[])secp256k1_ecmult_static_pre_g_128;
+#endif
+    return 0;
+#else
+    ctx->window_g = window_g;
+    ctx->pre_g = (secp256k1_ge_storage_t (*)[])secp256k1_allocator_malloc(alloc, sizeof((*ctx->pre_g)[0]) * ECMULT_TABLE_SIZE(window_g));
+#ifdef USE_ENDOMORPHISM
+    ctx->pre_g_128 = (secp256k1_ge_storage_t (*)[])secp256k1_allocator_malloc(alloc, sizeof((*ctx->pre_g_128)[0]) * ECMULT_TABLE_SIZE(window_g));
+#endif
+    return (ECMULT_TABLE_SIZE(window_g) + ECMULT_BUILD_SEGMENT_SIZE - 1) / ECMULT_BUILD_SEGMENT_SIZE;
 #endif
 }
 
-static void secp256k1_ecmult_context_clone(secp256k1_ecmult_context_t *dst,
-                                           const secp256k1_ecmult_context_t *src) {
-    if (src->pre_g == NULL) {
-        dst->pre_g = NULL;
-    } else {
-        size_t size = sizeof((*dst->pre_g)[0]) * ECMULT_TABLE_SIZE(WINDOW_G);
-        dst->pre_g = (secp256k1_ge_storage_t (*)[])checked_malloc(size);
-        memcpy(dst->pre_g, src->pre_g, size);
+/* Segment k holds entries k*ECMULT_BUILD_SEGMENT_SIZE and up of every table. It starts from the odd multiple
+ * it needs, found by double-and-add, and the affine conversion of the tables (G and, with the endomorphism,
+ * 2^128*G) shares a single inversion. */
+static void secp256k1_ecmult_context_build_segment(secp256k1_ecmult_context_t *ctx, int segment) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+#ifdef USE_ENDOMORPHISM
+    const int ntables = 2;
+#else
+    const int ntables = 1;
+#endif
+    secp256k1_gej_t base[2];
+    secp256k1_gej_t dj;
+    secp256k1_ge_t d;
+    secp256k1_gej_t *prej;
+    secp256k1_ge_t *prea;
+    secp256k1_fe_t *zr;
+    secp256k1_fe_t work[4];
+    int first, len, mult, bit, t, i;
+
+    first = segment * ECMULT_BUILD_SEGMENT_SIZE;
+    len = ECMULT_TABLE_SIZE(ctx->window_g) - first;
+    if (len > ECMULT_BUILD_SEGMENT_SIZE) {
+        len = ECMULT_BUILD_SEGMENT_SIZE;
     }
+    VERIFY_CHECK(segment >= 0 && len > 0);
+    prej = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * ntables * len);
+    prea = (secp256k1_ge_t *)checked_malloc(sizeof(secp256k1_ge_t) * ntables * len);
+    zr = (secp256k1_fe_t *)checked_malloc(sizeof(secp256k1_fe_t) * ntables * len);
+
+    secp256k1_gej_set_ge(&base[0], &secp256k1_ge_const_g);
 #ifdef USE_ENDOMORPHISM
-    if (src->pre_g_128 == NULL) {
-        dst->pre_g_128 = NULL;
-    } else {
-        size_t size = sizeof((*dst->pre_g_128)[0]) * ECMULT_TABLE_SIZE(WINDOW_G);
-        dst->pre_g_128 = (secp256k1_ge_storage_t (*)[])checked_malloc(size);
-        memcpy(dst->pre_g_128, src->pre_g_128, size);
+    base[1] = base[0];
+    for (i = 0; i < 128; i++) {
+        secp256k1_gej_double_var(&base[1], &base[1], NULL);
     }
 #endif
+    mult = 2 * first + 1;
+    for (t = 0; t < ntables; t++) {
+        secp256k1_gej_t *pre = &prej[t * len];
+        /* pre[0] = mult * base, from the most significant bit (accounted for by base itself) down. */
+        pre[0] = base[t];
+        bit = 0;
+        while ((mult >> bit) > 1) {
+            bit++;
+        }
+        while (bit-- > 0) {
+            secp256k1_gej_double_var(&pre[0], &pre[0], NULL);
+            if ((mult >> bit) & 1) {
+                secp256k1_gej_add_var(&pre[0], &pre[0], &base[t], NULL);
+            }
+        }
+        secp256k1_gej_double_var(&dj, &base[t], NULL);
+        secp256k1_ge_set_gej(&d, &dj);
+        secp256k1_fe_set_int(&zr[t * len], 1);
+        for (i = 1; i < len; i++) {
+            secp256k1_gej_add_ge_var(&pre[i], &pre[i - 1], &d, &zr[t * len + i]);
+        }
+    }
+    secp256k1_ge_set_all_tables_gej_var(ntables, len, prea, prej, zr, work);
+    for (i = 0; i < len; i++) {
+        secp256k1_ge_to_storage(&(*ctx->pre_g)[first + i], &prea[i]);
+#ifdef USE_ENDOMORPHISM
+        secp256k1_ge_to_storage(&(*ctx->pre_g_128)[first + i], &prea[len + i]);
+#endif
+    }
+    free(prej);
+    free(prea);
+    free(zr);
+#else
+    (void)ctx;
+    (void)segment;
+#endif
+}
+
+static void secp256k1_ecmult_context_build(secp256k1_ecmult_context_t *ctx, int window_g, const secp256k1_allocator_t *alloc) {
+    int segments = secp256k1_ecmult_context_build_alloc(ctx, window_g, alloc);
+    int i;
+    for (i = 0; i < segments; i++) {
+        secp256k1_ecmult_context_build_segment(ctx, i);
+    }
 }
 
 static int secp256k1_ecmult_context_is_built(const secp256k1_ecmult_context_t *ctx) {
     return ctx->pre_g != NULL;
 }
 
-static void secp256k1_ecmult_context_clear(secp256k1_ecmult_context_t *ctx) {
-    free(ctx->pre_g);
+static void secp256k1_ecmult_context_clear(secp256k1_ecmult_context_t *ctx, const secp256k1_allocator_t *alloc) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    secp256k1_allocator_free(alloc, ctx->pre_g, sizeof((*ctx->pre_g)[0]) * ECMULT_TABLE_SIZE(ctx->window_g));
 #ifdef USE_ENDOMORPHISM
-    free(ctx->pre_g_128);
+    secp256k1_allocator_free(alloc, ctx->pre_g_128, sizeof((*ctx->pre_g_128)[0]) * ECMULT_TABLE_SIZE(ctx->window_g));
+#endif
+#else
+    (void)alloc;
 #endif
     secp256k1_ecmult_context_init(ctx);
 }
@@ -278,6 +379,7 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context_t *ctx, secp256k1_ge
     int i;
     int bits;
 
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT, 1);
 #ifdef USE_ENDOMORPHISM
     /* split na into na_1 and na_lam (where na = na_1 + na_lam*lambda, and na_1 and na_lam are ~128 bit) */
     secp256k1_scalar_split_lambda_var(&na_1, &na_lam, na);
@@ -318,8 +420,8 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context_t *ctx, secp256k1_ge
     secp256k1_scalar_split_128(&ng_1, &ng_128, ng);
 
     /* Build wnaf representation for ng_1 and ng_128 */
-    bits_ng_1   = secp256k1_ecmult_wnaf(wnaf_ng_1,   &ng_1,   WINDOW_G);
-    bits_ng_128 = secp256k1_ecmult_wnaf(wnaf_ng_128, &ng_128, WINDOW_G);
+    bits_ng_1   = secp256k1_ecmult_wnaf(wnaf_ng_1,   &ng_1,   ctx->window_g);
+    bits_ng_128 = secp256k1_ecmult_wnaf(wnaf_ng_128, &ng_128, ctx->window_g);
     if (bits_ng_1 > bits) {
         bits = bits_ng_1;
     }
@@ -327,7 +429,7 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context_t *ctx, secp256k1_ge
         bits = bits_ng_128;
     }
 #else
-    bits_ng     = secp256k1_ecmult_wnaf(wnaf_ng,     ng,      WINDOW_G);
+    bits_ng     = secp256k1_ecmult_wnaf(wnaf_ng,     ng,      ctx->window_g);
     if (bits_ng > bits) {
         bits = bits_ng;
     }
@@ -339,6 +441,8 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context_t *ctx, secp256k1_ge
         int n;
         secp256k1_gej_double_var(r, r, NULL);
 #ifdef USE_ENDOMORPHISM
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g, wnaf_ng_1, bits_ng_1, i - ECMULT_PREFETCH_DISTANCE);
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g_128, wnaf_ng_128, bits_ng_128, i - ECMULT_PREFETCH_DISTANCE);
         if (i < bits_na_1 && (n = wnaf_na_1[i])) {
             ECMULT_TABLE_GET_GE(&tmpa, pre_a, n, WINDOW_A);
             secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
@@ -348,20 +452,21 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context_t *ctx, secp256k1_ge
             secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
         }
         if (i < bits_ng_1 && (n = wnaf_ng_1[i])) {
-            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, n, WINDOW_G);
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, n, ctx->window_g);
             secp256k1_gej_add_zinv_var(r, r, &tmpa, &Z);
         }
         if (i < bits_ng_128 && (n = wnaf_ng_128[i])) {
-            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g_128, n, WINDOW_G);
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g_128, n, ctx->window_g);
             secp256k1_gej_add_zinv_var(r, r, &tmpa, &Z);
         }
 #else
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g, wnaf_ng, bits_ng, i - ECMULT_PREFETCH_DISTANCE);
         if (i < bits_na && (n = wnaf_na[i])) {
             ECMULT_TABLE_GET_GE(&tmpa, pre_a, n, WINDOW_A);
             secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
         }
         if (i < bits_ng && (n = wnaf_ng[i])) {
-            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, n, WINDOW_G);
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, n, ctx->window_g);
             secp256k1_gej_add_zinv_var(r, r, &tmpa, &Z);
         }
 #endif
@@ -372,4 +477,538 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context_t *ctx, secp256k1_ge
     }
 }
 
+
+static void secp256k1_ecmult_point_table_build(secp256k1_ecmult_point_table_t *table, const secp256k1_ge_t *a) {
+    secp256k1_gej_t aj;
+#ifdef USE_ENDOMORPHISM
+    secp256k1_ge_t p;
+    int i;
+#endif
+
+    secp256k1_gej_set_ge(&aj, a);
+    secp256k1_ecmult_odd_multiples_table_storage_var(ECMULT_TABLE_SIZE(ECMULT_POINT_WINDOW), table->pre, &aj);
+#ifdef USE_ENDOMORPHISM
+    for (i = 0; i < ECMULT_TABLE_SIZE(ECMULT_POINT_WINDOW); i++) {
+        secp256k1_ge_from_storage(&p, &table->pre[i]);
+        secp256k1_ge_mul_lambda(&p, &p);
+        secp256k1_ge_to_storage(&table->pre_lam[i], &p);
+    }
+#endif
+}
+
+/* The same as secp256k1_ecmult, except that the odd multiples of A come from the table. They are
+ * affine, like those of G, so every addition is a mixed one and there is no global Z to correct. */
+static void secp256k1_ecmult_point(const secp256k1_ecmult_context_t *ctx, secp256k1_gej_t *r, const secp256k1_ecmult_point_table_t *table, const secp256k1_scalar_t *na, const secp256k1_scalar_t *ng) {
+    secp256k1_ge_t tmpa;
+#ifdef USE_ENDOMORPHISM
+    secp256k1_scalar_t na_1, na_lam;
+    secp256k1_scalar_t ng_1, ng_128;
+    int wnaf_na_1[130];
+    int wnaf_na_lam[130];
+    int bits_na_1;
+    int bits_na_lam;
+    int wnaf_ng_1[129];
+    int bits_ng_1;
+    int wnaf_ng_128[129];
+    int bits_ng_128;
+#else
+    int wnaf_na[256];
+    int bits_na;
+    int wnaf_ng[257];
+    int bits_ng;
+#endif
+    int i;
+    int bits;
+
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT, 1);
+#ifdef USE_ENDOMORPHISM
+    secp256k1_scalar_split_lambda_var(&na_1, &na_lam, na);
+    bits_na_1   = secp256k1_ecmult_wnaf(wnaf_na_1,   &na_1,   ECMULT_POINT_WINDOW);
+    bits_na_lam = secp256k1_ecmult_wnaf(wnaf_na_lam, &na_lam, ECMULT_POINT_WINDOW);
+    VERIFY_CHECK(bits_na_1 <= 130);
+    VERIFY_CHECK(bits_na_lam <= 130);
+    bits = bits_na_1;
+    if (bits_na_lam > bits) {
+        bits = bits_na_lam;
+    }
+
+    secp256k1_scalar_split_128(&ng_1, &ng_128, ng);
+    bits_ng_1   = secp256k1_ecmult_wnaf(wnaf_ng_1,   &ng_1,   ctx->window_g);
+    bits_ng_128 = secp256k1_ecmult_wnaf(wnaf_ng_128, &ng_128, ctx->window_g);
+    if (bits_ng_1 > bits) {
+        bits = bits_ng_1;
+    }
+    if (bits_ng_128 > bits) {
+        bits = bits_ng_128;
+    }
+#else
+    bits_na     = secp256k1_ecmult_wnaf(wnaf_na,     na,      ECMULT_POINT_WINDOW);
+    bits_ng     = secp256k1_ecmult_wnaf(wnaf_ng,     ng,      ctx->window_g);
+    bits = bits_na;
+    if (bits_ng > bits) {
+        bits = bits_ng;
+    }
+#endif
+
+    secp256k1_gej_set_infinity(r);
+
+    for (i = bits - 1; i >= 0; i--) {
+        int n;
+        secp256k1_gej_double_var(r, r, NULL);
+#ifdef USE_ENDOMORPHISM
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g, wnaf_ng_1, bits_ng_1, i - ECMULT_PREFETCH_DISTANCE);
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g_128, wnaf_ng_128, bits_ng_128, i - ECMULT_PREFETCH_DISTANCE);
+        if (i < bits_na_1 && (n = wnaf_na_1[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, table->pre, n, ECMULT_POINT_WINDOW);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+        if (i < bits_na_lam && (n = wnaf_na_lam[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, table->pre_lam, n, ECMULT_POINT_WINDOW);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+        if (i < bits_ng_1 && (n = wnaf_ng_1[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, n, ctx->window_g);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+        if (i < bits_ng_128 && (n = wnaf_ng_128[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g_128, n, ctx->window_g);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+#else
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g, wnaf_ng, bits_ng, i - ECMULT_PREFETCH_DISTANCE);
+        if (i < bits_na && (n = wnaf_na[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, table->pre, n, ECMULT_POINT_WINDOW);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+        if (i < bits_ng && (n = wnaf_ng[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, n, ctx->window_g);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+#endif
+    }
+}
+
+#ifdef USE_ENDOMORPHISM
+/** Every input scalar is split into two ~128-bit halves, with a WNAF of at most 130 entries each. */
+#define ECMULT_MULTI_PARTS 2
+#define ECMULT_MULTI_WNAF_SIZE 130
+/** Bound on the bit length of a half scalar after its sign has been moved into the point. */
+#define ECMULT_PIPPENGER_BITS 129
+/** Number of points from which on Pippenger's algorithm beats Strauss'. */
+#define ECMULT_PIPPENGER_THRESHOLD 88
+#else
+#define ECMULT_MULTI_PARTS 1
+#define ECMULT_MULTI_WNAF_SIZE 256
+#define ECMULT_PIPPENGER_BITS 255
+#define ECMULT_PIPPENGER_THRESHOLD 96
+#endif
+
+/** Largest bucket window used by Pippenger's algorithm (2^(w-1) buckets). */
+#define ECMULT_PIPPENGER_MAX_WINDOW 12
+
+/** Number of scratch allocations made by secp256k1_ecmult_strauss_multi. */
+#define ECMULT_STRAUSS_SCRATCH_OBJECTS 6
+
+/** Scratch space needed by secp256k1_ecmult_strauss_multi per point. */
+static size_t secp256k1_ecmult_strauss_point_size(void) {
+    return ECMULT_TABLE_SIZE(WINDOW_A) * (sizeof(secp256k1_gej_t) + sizeof(secp256k1_fe_t) + ECMULT_MULTI_PARTS * sizeof(secp256k1_ge_t)) +
+           2 * sizeof(secp256k1_fe_t) + ECMULT_MULTI_PARTS * (ECMULT_MULTI_WNAF_SIZE + 1) * sizeof(int);
+}
+
+static size_t secp256k1_ecmult_strauss_max_points(const secp256k1_scratch_t *scratch) {
+    return secp256k1_scratch_max_allocation(scratch, ECMULT_STRAUSS_SCRATCH_OBJECTS) / secp256k1_ecmult_strauss_point_size();
+}
+
+/** Strauss' algorithm for many points: one WINDOW_A odd multiples table per point, all made affine
+ *  with a single field inversion, and one shared chain of doublings. Returns 0 if the scratch space
+ *  is too small for n points. */
+static int secp256k1_ecmult_strauss_multi(const secp256k1_ecmult_context_t *ctx, secp256k1_scratch_t *scratch, secp256k1_gej_t *r, const secp256k1_scalar_t *ng, const secp256k1_ge_t *points, const secp256k1_scalar_t *scalars, size_t n) {
+    const size_t ts = ECMULT_TABLE_SIZE(WINDOW_A);
+    size_t checkpoint = secp256k1_scratch_checkpoint(scratch);
+    secp256k1_gej_t *prej;
+    secp256k1_fe_t *zr;
+    secp256k1_fe_t *work;
+    secp256k1_ge_t *pre_a;
+    int *wnaf_na;
+    int *bits_na;
+    secp256k1_ge_t tmpa;
+    secp256k1_gej_t aj;
+#ifdef USE_ENDOMORPHISM
+    secp256k1_ge_t *pre_a_lam;
+    secp256k1_scalar_t na_1, na_lam;
+    /* Splitted G factors. */
+    secp256k1_scalar_t ng_1, ng_128;
+    int wnaf_ng_1[129];
+    int bits_ng_1 = 0;
+    int wnaf_ng_128[129];
+    int bits_ng_128 = 0;
+#else
+    int wnaf_ng[257];
+    int bits_ng = 0;
+#endif
+    size_t np, no, j;
+    int i;
+    int d;
+    int bits = 0;
+
+    prej = (secp256k1_gej_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_gej_t) * ts * n);
+    zr = (secp256k1_fe_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_fe_t) * ts * n);
+    work = (secp256k1_fe_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_fe_t) * 2 * n);
+    pre_a = (secp256k1_ge_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_ge_t) * ECMULT_MULTI_PARTS * ts * n);
+    wnaf_na = (int *)secp256k1_scratch_alloc(scratch, sizeof(int) * ECMULT_MULTI_PARTS * ECMULT_MULTI_WNAF_SIZE * n);
+    bits_na = (int *)secp256k1_scratch_alloc(scratch, sizeof(int) * ECMULT_MULTI_PARTS * n);
+    if (n > 0 && (prej == NULL || zr == NULL || work == NULL || pre_a == NULL || wnaf_na == NULL || bits_na == NULL)) {
+        secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+        return 0;
+    }
+#ifdef USE_ENDOMORPHISM
+    pre_a_lam = pre_a + ts * n;
+#endif
+
+    /* Build the WNAFs and Jacobian odd multiples tables of the points that contribute. */
+    no = 0;
+    for (np = 0; np < n; np++) {
+        int *wnaf = wnaf_na + no * ECMULT_MULTI_PARTS * ECMULT_MULTI_WNAF_SIZE;
+        if (secp256k1_ge_is_infinity(&points[np]) || secp256k1_scalar_is_zero(&scalars[np])) {
+            continue;
+        }
+#ifdef USE_ENDOMORPHISM
+        secp256k1_scalar_split_lambda_var(&na_1, &na_lam, &scalars[np]);
+        bits_na[2 * no] = secp256k1_ecmult_wnaf(wnaf, &na_1, WINDOW_A);
+        bits_na[2 * no + 1] = secp256k1_ecmult_wnaf(wnaf + ECMULT_MULTI_WNAF_SIZE, &na_lam, WINDOW_A);
+        VERIFY_CHECK(bits_na[2 * no] <= 130);
+        VERIFY_CHECK(bits_na[2 * no + 1] <= 130);
+        if (bits_na[2 * no] > bits) {
+            bits = bits_na[2 * no];
+        }
+        if (bits_na[2 * no + 1] > bits) {
+            bits = bits_na[2 * no + 1];
+        }
+#else
+        bits_na[no] = secp256k1_ecmult_wnaf(wnaf, &scalars[np], WINDOW_A);
+        if (bits_na[no] > bits) {
+            bits = bits_na[no];
+        }
+#endif
+        secp256k1_gej_set_ge(&aj, &points[np]);
+        secp256k1_ecmult_odd_multiples_table(ts, prej + no * ts, zr + no * ts, &aj);
+        no++;
+    }
+
+    /* Convert all tables to affine coordinates at once. */
+    secp256k1_ge_set_all_tables_gej_var(no, ts, pre_a, prej, zr, work);
+
+#ifdef USE_ENDOMORPHISM
+    for (j = 0; j < no * ts; j++) {
+        secp256k1_ge_mul_lambda(&pre_a_lam[j], &pre_a[j]);
+    }
+
+    if (ng != NULL) {
+        /* split ng into ng_1 and ng_128 (where gn = gn_1 + gn_128*2^128, and gn_1 and gn_128 are ~128 bit) */
+        secp256k1_scalar_split_128(&ng_1, &ng_128, ng);
+        bits_ng_1   = secp256k1_ecmult_wnaf(wnaf_ng_1,   &ng_1,   ctx->window_g);
+        bits_ng_128 = secp256k1_ecmult_wnaf(wnaf_ng_128, &ng_128, ctx->window_g);
+        if (bits_ng_1 > bits) {
+            bits = bits_ng_1;
+        }
+        if (bits_ng_128 > bits) {
+            bits = bits_ng_128;
+        }
+    }
+#else
+    if (ng != NULL) {
+        bits_ng = secp256k1_ecmult_wnaf(wnaf_ng, ng, ctx->window_g);
+        if (bits_ng > bits) {
+            bits = bits_ng;
+        }
+    }
+#endif
+
+    secp256k1_gej_set_infinity(r);
+
+    for (i = bits - 1; i >= 0; i--) {
+        secp256k1_gej_double_var(r, r, NULL);
+#ifdef USE_ENDOMORPHISM
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g, wnaf_ng_1, bits_ng_1, i - ECMULT_PREFETCH_DISTANCE);
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g_128, wnaf_ng_128, bits_ng_128, i - ECMULT_PREFETCH_DISTANCE);
+#else
+        secp256k1_ecmult_table_prefetch(*ctx->pre_g, wnaf_ng, bits_ng, i - ECMULT_PREFETCH_DISTANCE);
+#endif
+        for (j = 0; j < no; j++) {
+#ifdef USE_ENDOMORPHISM
+            const int *wnaf = wnaf_na + j * ECMULT_MULTI_PARTS * ECMULT_MULTI_WNAF_SIZE;
+            if (i < bits_na[2 * j] && (d = wnaf[i])) {
+                ECMULT_TABLE_GET_GE(&tmpa, pre_a + j * ts, d, WINDOW_A);
+                secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+            }
+            if (i < bits_na[2 * j + 1] && (d = wnaf[ECMULT_MULTI_WNAF_SIZE + i])) {
+                ECMULT_TABLE_GET_GE(&tmpa, pre_a_lam + j * ts, d, WINDOW_A);
+                secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+            }
+#else
+            if (i < bits_na[j] && (d = wnaf_na[j * ECMULT_MULTI_WNAF_SIZE + i])) {
+                ECMULT_TABLE_GET_GE(&tmpa, pre_a + j * ts, d, WINDOW_A);
+                secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+            }
+#endif
+        }
+#ifdef USE_ENDOMORPHISM
+        if (i < bits_ng_1 && (d = wnaf_ng_1[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, d, ctx->window_g);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+        if (i < bits_ng_128 && (d = wnaf_ng_128[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g_128, d, ctx->window_g);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+#else
+        if (i < bits_ng && (d = wnaf_ng[i])) {
+            ECMULT_TABLE_GET_GE_STORAGE(&tmpa, *ctx->pre_g, d, ctx->window_g);
+            secp256k1_gej_add_ge_var(r, r, &tmpa, NULL);
+        }
+#endif
+    }
+
+    secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+    return 1;
+}
+
+/** Append the term s*p to the Pippenger input arrays as one or (with the endomorphism) two terms,
+ *  each with a scalar below 2^ECMULT_PIPPENGER_BITS: a scalar above n/2 is negated, and its point
+ *  with it. Terms with a zero scalar are dropped. Returns the number of terms appended. */
+static size_t secp256k1_ecmult_pippenger_terms(secp256k1_ge_t *tp, secp256k1_scalar_t *tsc, const secp256k1_ge_t *p, const secp256k1_scalar_t *s) {
+    size_t count = 0;
+    size_t i;
+#ifdef USE_ENDOMORPHISM
+    secp256k1_ge_t p_lam;
+    secp256k1_scalar_t s_1, s_lam;
+    secp256k1_scalar_split_lambda_var(&s_1, &s_lam, s);
+    secp256k1_ge_mul_lambda(&p_lam, p);
+    if (!secp256k1_scalar_is_zero(&s_1)) {
+        tp[count] = *p;
+        tsc[count++] = s_1;
+    }
+    if (!secp256k1_scalar_is_zero(&s_lam)) {
+        tp[count] = p_lam;
+        tsc[count++] = s_lam;
+    }
+#else
+    if (!secp256k1_scalar_is_zero(s)) {
+        tp[count] = *p;
+        tsc[count++] = *s;
+    }
+#endif
+    for (i = 0; i < count; i++) {
+        if (secp256k1_scalar_is_high(&tsc[i])) {
+            secp256k1_scalar_negate(&tsc[i], &tsc[i]);
+            secp256k1_ge_neg(&tp[i], &tp[i]);
+        }
+    }
+    return count;
+}
+
+/** Pick the bucket window for Pippenger's algorithm with nterms terms, by minimizing the estimated
+ *  cost: every window costs one affine addition per term, plus two Jacobian additions per bucket. */
+static int secp256k1_ecmult_pippenger_window(size_t nterms) {
+    int w, best = 1;
+    uint64_t cost, best_cost = 0;
+    for (w = 1; w <= ECMULT_PIPPENGER_MAX_WINDOW; w++) {
+        int windows = (ECMULT_PIPPENGER_BITS + w) / w;
+        cost = (uint64_t)windows * (11 * (uint64_t)nterms + 32 * ((uint64_t)1 << (w - 1)));
+        if (w == 1 || cost < best_cost) {
+            best = w;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+/** Number of scratch allocations made by secp256k1_ecmult_pippenger_multi. */
+#define ECMULT_PIPPENGER_SCRATCH_OBJECTS 4
+
+/** Scratch space needed by secp256k1_ecmult_pippenger_multi for n points. */
+static size_t secp256k1_ecmult_pippenger_scratch_size(size_t n) {
+    size_t nterms = ECMULT_MULTI_PARTS * (n + 1);
+    int w = secp256k1_ecmult_pippenger_window(nterms);
+    size_t windows = (ECMULT_PIPPENGER_BITS + w) / w;
+    return nterms * (sizeof(secp256k1_ge_t) + sizeof(secp256k1_scalar_t) + windows * sizeof(int)) +
+           ((size_t)1 << (w - 1)) * sizeof(secp256k1_gej_t);
+}
+
+static size_t secp256k1_ecmult_pippenger_max_points(const secp256k1_scratch_t *scratch) {
+    size_t avail = secp256k1_scratch_max_allocation(scratch, ECMULT_PIPPENGER_SCRATCH_OBJECTS);
+    size_t lo = 0;
+    size_t hi = avail / (ECMULT_MULTI_PARTS * (sizeof(secp256k1_ge_t) + sizeof(secp256k1_scalar_t)));
+    /* The size is (nearly) monotonic in the number of points; find the largest count that fits. */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (secp256k1_ecmult_pippenger_scratch_size(mid) <= avail) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+/** Recode a scalar below 2^ECMULT_PIPPENGER_BITS into windows digits of w bits each, such that
+ *  s = sum(digits[i] * 2^(i*w)) and every digit is in [-(2^(w-1) - 1), 2^(w-1)]. */
+static void secp256k1_ecmult_pippenger_digits(int *digits, int windows, const secp256k1_scalar_t *s, int w) {
+    int carry = 0;
+    int i;
+    for (i = 0; i < windows; i++) {
+        int offset = i * w;
+        int count = w;
+        int v;
+        if (offset + count > 256) {
+            count = 256 - offset;
+        }
+        v = carry + (int)secp256k1_scalar_get_bits_var(s, offset, count);
+        carry = 0;
+        if (v > (1 << (w - 1))) {
+            v -= (1 << w);
+            carry = 1;
+        }
+        digits[i] = v;
+    }
+    VERIFY_CHECK(carry == 0);
+}
+
+/** Pippenger's bucket method: for every window, each term's point is added to the bucket of its
+ *  digit, and the buckets are then summed with their weights using two running sums. Returns 0 if
+ *  the scratch space is too small for n points. */
+static int secp256k1_ecmult_pippenger_multi(const secp256k1_ecmult_context_t *ctx, secp256k1_scratch_t *scratch, secp256k1_gej_t *r, const secp256k1_scalar_t *ng, const secp256k1_ge_t *points, const secp256k1_scalar_t *scalars, size_t n) {
+    size_t checkpoint = secp256k1_scratch_checkpoint(scratch);
+    secp256k1_ge_t *tp;
+    secp256k1_scalar_t *tsc;
+    int *digits;
+    secp256k1_gej_t *buckets;
+    secp256k1_gej_t running, sum;
+    secp256k1_ge_t tmp;
+    size_t nterms = 0;
+    size_t np, t;
+    int w, windows, nbuckets, i, b;
+
+    (void)ctx;
+    tp = (secp256k1_ge_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_ge_t) * ECMULT_MULTI_PARTS * (n + 1));
+    tsc = (secp256k1_scalar_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_scalar_t) * ECMULT_MULTI_PARTS * (n + 1));
+    if (tp == NULL || tsc == NULL) {
+        secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+        return 0;
+    }
+    if (ng != NULL) {
+        nterms += secp256k1_ecmult_pippenger_terms(tp, tsc, &secp256k1_ge_const_g, ng);
+    }
+    for (np = 0; np < n; np++) {
+        if (!secp256k1_ge_is_infinity(&points[np])) {
+            nterms += secp256k1_ecmult_pippenger_terms(tp + nterms, tsc + nterms, &points[np], &scalars[np]);
+        }
+    }
+
+    /* Size the window for the worst case n, so the scratch size estimate is an upper bound. */
+    w = secp256k1_ecmult_pippenger_window(ECMULT_MULTI_PARTS * (n + 1));
+    windows = (ECMULT_PIPPENGER_BITS + w) / w;
+    nbuckets = 1 << (w - 1);
+    digits = (int *)secp256k1_scratch_alloc(scratch, sizeof(int) * windows * ECMULT_MULTI_PARTS * (n + 1));
+    buckets = (secp256k1_gej_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_gej_t) * nbuckets);
+    if (digits == NULL || buckets == NULL) {
+        secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+        return 0;
+    }
+    for (t = 0; t < nterms; t++) {
+        secp256k1_ecmult_pippenger_digits(digits + t * windows, windows, &tsc[t], w);
+    }
+
+    secp256k1_gej_set_infinity(r);
+    for (i = windows - 1; i >= 0; i--) {
+        for (b = 0; b < w; b++) {
+            secp256k1_gej_double_var(r, r, NULL);
+        }
+        for (b = 0; b < nbuckets; b++) {
+            secp256k1_gej_set_infinity(&buckets[b]);
+        }
+        for (t = 0; t < nterms; t++) {
+            int d = digits[t * windows + i];
+            if (d > 0) {
+                secp256k1_gej_add_ge_var(&buckets[d - 1], &buckets[d - 1], &tp[t], NULL);
+            } else if (d < 0) {
+                secp256k1_ge_neg(&tmp, &tp[t]);
+                secp256k1_gej_add_ge_var(&buckets[-d - 1], &buckets[-d - 1], &tmp, NULL);
+            }
+        }
+        /* sum(k * buckets[k-1]) = sum over k of the running sums of buckets[nbuckets-1..k-1]. */
+        secp256k1_gej_set_infinity(&running);
+        secp256k1_gej_set_infinity(&sum);
+        for (b = nbuckets - 1; b >= 0; b--) {
+            secp256k1_gej_add_var(&running, &running, &buckets[b], NULL);
+            secp256k1_gej_add_var(&sum, &sum, &running, NULL);
+        }
+        secp256k1_gej_add_var(r, r, &sum, NULL);
+    }
+
+    secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+    return 1;
+}
+
+/** Compute the multi-multiplication one point at a time with secp256k1_ecmult, without any memory. */
+static void secp256k1_ecmult_multi_simple(const secp256k1_ecmult_context_t *ctx, secp256k1_gej_t *r, const secp256k1_scalar_t *ng, const secp256k1_ge_t *points, const secp256k1_scalar_t *scalars, size_t n) {
+    secp256k1_scalar_t zero;
+    secp256k1_gej_t pj, tmp;
+    size_t i;
+
+    secp256k1_scalar_set_int(&zero, 0);
+    secp256k1_gej_set_infinity(r);
+    if (ng != NULL) {
+        secp256k1_gej_set_ge(&pj, &secp256k1_ge_const_g);
+        secp256k1_ecmult(ctx, r, &pj, &zero, ng);
+    }
+    for (i = 0; i < n; i++) {
+        if (secp256k1_ge_is_infinity(&points[i])) {
+            continue;
+        }
+        secp256k1_gej_set_ge(&pj, &points[i]);
+        secp256k1_ecmult(ctx, &tmp, &pj, &scalars[i], &zero);
+        secp256k1_gej_add_var(r, r, &tmp, NULL);
+    }
+}
+
+static void secp256k1_ecmult_multi(const secp256k1_ecmult_context_t *ctx, secp256k1_scratch_t *scratch, secp256k1_gej_t *r, const secp256k1_scalar_t *ng, const secp256k1_ge_t *points, const secp256k1_scalar_t *scalars, size_t n) {
+    int (*algorithm)(const secp256k1_ecmult_context_t *, secp256k1_scratch_t *, secp256k1_gej_t *, const secp256k1_scalar_t *, const secp256k1_ge_t *, const secp256k1_scalar_t *, size_t);
+    size_t max_points = 0;
+    size_t nbatches, batch, i;
+    secp256k1_gej_t tmp;
+
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_MULTI, 1);
+    SECP256K1_COUNT_OP(SECP256K1_OP_ECMULT_MULTI_POINTS, n);
+    algorithm = secp256k1_ecmult_strauss_multi;
+    if (scratch != NULL) {
+        max_points = secp256k1_ecmult_strauss_max_points(scratch);
+        if (n >= ECMULT_PIPPENGER_THRESHOLD) {
+            size_t max_pippenger = secp256k1_ecmult_pippenger_max_points(scratch);
+            if (max_pippenger >= ECMULT_PIPPENGER_THRESHOLD) {
+                algorithm = secp256k1_ecmult_pippenger_multi;
+                max_points = max_pippenger;
+            }
+        }
+    }
+    if (max_points == 0) {
+        secp256k1_ecmult_multi_simple(ctx, r, ng, points, scalars, n);
+        return;
+    }
+
+    /* Split the points into equally sized batches that each fit in the scratch space. */
+    nbatches = (n + max_points - 1) / max_points;
+    if (nbatches == 0) {
+        nbatches = 1;
+    }
+    batch = (n + nbatches - 1) / nbatches;
+    secp256k1_gej_set_infinity(r);
+    for (i = 0; i < nbatches; i++) {
+        size_t len = n - i * batch < batch ? n - i * batch : batch;
+        if (!algorithm(ctx, scratch, &tmp, i == 0 ? ng : NULL, points + i * batch, scalars + i * batch, len)) {
+            secp256k1_ecmult_multi_simple(ctx, &tmp, i == 0 ? ng : NULL, points + i * batch, scalars + i * batch, len);
+        }
+        secp256k1_gej_add_var(r, r, &tmp, NULL);
+    }
+}
 #endif
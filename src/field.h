@@ -83,15 +83,28 @@ static void secp256k1_fe_add(secp256k1_fe_t *r, const secp256k1_fe_t *a);
  *  The output magnitude is 1 (but not guaranteed to be normalized). */
 static void secp256k1_fe_mul(secp256k1_fe_t *r, const secp256k1_fe_t *a, const secp256k1_fe_t * SECP256K1_RESTRICT b);
 
+/** Sets r[i] to a[i] * b[i] for i = 0..3. Requires the inputs' magnitudes to be at most 8. The output
+ *  magnitudes are 1 (but not guaranteed to be normalized). No output may alias an input other than
+ *  r[i] equaling a[i]. Implementations may compute the four products in parallel. */
+static void secp256k1_fe_mul_x4(secp256k1_fe_t * const *r, const secp256k1_fe_t * const *a, const secp256k1_fe_t * const *b);
+
 /** Sets a field element to be the square of another. Requires the input's magnitude to be at most 8.
  *  The output magnitude is 1 (but not guaranteed to be normalized). */
 static void secp256k1_fe_sqr(secp256k1_fe_t *r, const secp256k1_fe_t *a);
 
+/** Sets r[i] to the square of a[i] for i = 0..3, with the same requirements as secp256k1_fe_mul_x4. */
+static void secp256k1_fe_sqr_x4(secp256k1_fe_t * const *r, const secp256k1_fe_t * const *a);
+
 /** Sets a field element to be the (modular) square root (if any exist) of another. Requires the
  *  input's magnitude to be at most 8. The output magnitude is 1 (but not guaranteed to be
  *  normalized). Return value indicates whether a square root was found. */
 static int secp256k1_fe_sqrt_var(secp256k1_fe_t *r, const secp256k1_fe_t *a);
 
+/** Sets r[i] to a square root of a[i] for i = 0..3, and ret[i] to whether one exists, with the same
+ *  requirements and output magnitudes as secp256k1_fe_sqrt_var. The four square roots are computed
+ *  side by side using secp256k1_fe_mul_x4 and secp256k1_fe_sqr_x4. r may not overlap with a. */
+static void secp256k1_fe_sqrt_x4_var(secp256k1_fe_t *r, int *ret, const secp256k1_fe_t *a);
+
 /** Sets a field element to be the (modular) inverse of another. Requires the input's magnitude to be
  *  at most 8. The output magnitude is 1 (but not guaranteed to be normalized). */
 static void secp256k1_fe_inv(secp256k1_fe_t *r, const secp256k1_fe_t *a);
@@ -0,0 +1,304 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille                                   *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_FIELD_INNER10X26_NEON_IMPL_H_
+#define _SECP256K1_FIELD_INNER10X26_NEON_IMPL_H_
+
+#include <stdint.h>
+#include <arm_neon.h>
+
+/** secp256k1_fe_mul_inner and secp256k1_fe_sqr_inner using NEON's 2-lane 32x32->64 multiply-accumulate.
+ *
+ *  The 19 column sums px = sum(a[i]*b[x-i]) are computed up front, two adjacent columns per vector:
+ *  an even limb a[2q] times the limb pair (b[2m], b[2m+1]) adds to columns (2q+2m, 2q+2m+1), and an
+ *  odd limb a[2q+1] to columns (2q+2m+1, 2q+2m+2). So 50 vmull/vmlal instructions, each on an aligned
+ *  pair of b, replace the 100 scalar multiplications, and one vext per column pair merges the odd-
+ *  aligned sums into the even-aligned ones. The carry and reduction chain is then the scalar one from
+ *  field_10x26_impl.h, with each product sum replaced by its column; as every intermediate value is
+ *  unchanged, so are all of its bounds. A squaring simply uses a as both inputs, which at 50 vector
+ *  multiplications is still cheaper than the 55 of the scalar squaring.
+ */
+
+SECP256K1_INLINE static void secp256k1_fe_columns_neon(uint64_t *p, const uint32_t *a, const uint32_t *b) {
+    uint32x2_t a0, a1, a2, a3, a4, b0, b1, b2, b3, b4;
+    uint64x2_t e0, e1, e2, e3, e4, e5, e6, e7, e8;
+    uint64x2_t o0, o1, o2, o3, o4, o5, o6, o7, o8;
+    const uint64x2_t zero = vdupq_n_u64(0);
+
+    a0 = vld1_u32(a);
+    a1 = vld1_u32(a + 2);
+    a2 = vld1_u32(a + 4);
+    a3 = vld1_u32(a + 6);
+    a4 = vld1_u32(a + 8);
+    b0 = vld1_u32(b);
+    b1 = vld1_u32(b + 2);
+    b2 = vld1_u32(b + 4);
+    b3 = vld1_u32(b + 6);
+    b4 = vld1_u32(b + 8);
+
+    /* ex = (p[2x], p[2x+1]) restricted to the even limbs of a, ox = (p[2x+1], p[2x+2]) to the odd ones. */
+    e0 = vmull_lane_u32(b0, a0, 0);
+    o0 = vmull_lane_u32(b0, a0, 1);
+    e1 = vmull_lane_u32(b1, a0, 0);
+    e1 = vmlal_lane_u32(e1, b0, a1, 0);
+    o1 = vmull_lane_u32(b1, a0, 1);
+    o1 = vmlal_lane_u32(o1, b0, a1, 1);
+    e2 = vmull_lane_u32(b2, a0, 0);
+    e2 = vmlal_lane_u32(e2, b1, a1, 0);
+    e2 = vmlal_lane_u32(e2, b0, a2, 0);
+    o2 = vmull_lane_u32(b2, a0, 1);
+    o2 = vmlal_lane_u32(o2, b1, a1, 1);
+    o2 = vmlal_lane_u32(o2, b0, a2, 1);
+    e3 = vmull_lane_u32(b3, a0, 0);
+    e3 = vmlal_lane_u32(e3, b2, a1, 0);
+    e3 = vmlal_lane_u32(e3, b1, a2, 0);
+    e3 = vmlal_lane_u32(e3, b0, a3, 0);
+    o3 = vmull_lane_u32(b3, a0, 1);
+    o3 = vmlal_lane_u32(o3, b2, a1, 1);
+    o3 = vmlal_lane_u32(o3, b1, a2, 1);
+    o3 = vmlal_lane_u32(o3, b0, a3, 1);
+    e4 = vmull_lane_u32(b4, a0, 0);
+    e4 = vmlal_lane_u32(e4, b3, a1, 0);
+    e4 = vmlal_lane_u32(e4, b2, a2, 0);
+    e4 = vmlal_lane_u32(e4, b1, a3, 0);
+    e4 = vmlal_lane_u32(e4, b0, a4, 0);
+    o4 = vmull_lane_u32(b4, a0, 1);
+    o4 = vmlal_lane_u32(o4, b3, a1, 1);
+    o4 = vmlal_lane_u32(o4, b2, a2, 1);
+    o4 = vmlal_lane_u32(o4, b1, a3, 1);
+    o4 = vmlal_lane_u32(o4, b0, a4, 1);
+    e5 = vmull_lane_u32(b4, a1, 0);
+    e5 = vmlal_lane_u32(e5, b3, a2, 0);
+    e5 = vmlal_lane_u32(e5, b2, a3, 0);
+    e5 = vmlal_lane_u32(e5, b1, a4, 0);
+    o5 = vmull_lane_u32(b4, a1, 1);
+    o5 = vmlal_lane_u32(o5, b3, a2, 1);
+    o5 = vmlal_lane_u32(o5, b2, a3, 1);
+    o5 = vmlal_lane_u32(o5, b1, a4, 1);
+    e6 = vmull_lane_u32(b4, a2, 0);
+    e6 = vmlal_lane_u32(e6, b3, a3, 0);
+    e6 = vmlal_lane_u32(e6, b2, a4, 0);
+    o6 = vmull_lane_u32(b4, a2, 1);
+    o6 = vmlal_lane_u32(o6, b3, a3, 1);
+    o6 = vmlal_lane_u32(o6, b2, a4, 1);
+    e7 = vmull_lane_u32(b4, a3, 0);
+    e7 = vmlal_lane_u32(e7, b3, a4, 0);
+    o7 = vmull_lane_u32(b4, a3, 1);
+    o7 = vmlal_lane_u32(o7, b3, a4, 1);
+    e8 = vmull_lane_u32(b4, a4, 0);
+    o8 = vmull_lane_u32(b4, a4, 1);
+
+    vst1q_u64(p, vaddq_u64(e0, vextq_u64(zero, o0, 1)));
+    vst1q_u64(p + 2, vaddq_u64(e1, vextq_u64(o0, o1, 1)));
+    vst1q_u64(p + 4, vaddq_u64(e2, vextq_u64(o1, o2, 1)));
+    vst1q_u64(p + 6, vaddq_u64(e3, vextq_u64(o2, o3, 1)));
+    vst1q_u64(p + 8, vaddq_u64(e4, vextq_u64(o3, o4, 1)));
+    vst1q_u64(p + 10, vaddq_u64(e5, vextq_u64(o4, o5, 1)));
+    vst1q_u64(p + 12, vaddq_u64(e6, vextq_u64(o5, o6, 1)));
+    vst1q_u64(p + 14, vaddq_u64(e7, vextq_u64(o6, o7, 1)));
+    vst1q_u64(p + 16, vaddq_u64(e8, vextq_u64(o7, o8, 1)));
+    vst1q_u64(p + 18, vextq_u64(o8, zero, 1));
+}
+
+/** Reduce the column sums p[0..18] into r, exactly like the end of the scalar secp256k1_fe_mul_inner. */
+SECP256K1_INLINE static void secp256k1_fe_reduce_columns(uint32_t *r, const uint64_t *p) {
+    uint64_t c, d;
+    uint64_t u0, u1, u2, u3, u4, u5, u6, u7, u8;
+    uint32_t t9, t1, t0, t2, t3, t4, t5, t6, t7;
+    const uint32_t M = 0x3FFFFFFUL, R0 = 0x3D10UL, R1 = 0x400UL;
+
+
+    d  = p[9];
+    t9 = d & M; d >>= 26;
+    VERIFY_BITS(t9, 26);
+    VERIFY_BITS(d, 38);
+
+    c  = p[0];
+    VERIFY_BITS(c, 60);
+    d += p[10];
+    VERIFY_BITS(d, 63);
+    u0 = d & M; d >>= 26; c += u0 * R0;
+    VERIFY_BITS(u0, 26);
+    VERIFY_BITS(d, 37);
+    VERIFY_BITS(c, 61);
+    t0 = c & M; c >>= 26; c += u0 * R1;
+    VERIFY_BITS(t0, 26);
+    VERIFY_BITS(c, 37);
+
+    c += p[1];
+    VERIFY_BITS(c, 62);
+    d += p[11];
+    VERIFY_BITS(d, 63);
+    u1 = d & M; d >>= 26; c += u1 * R0;
+    VERIFY_BITS(u1, 26);
+    VERIFY_BITS(d, 37);
+    VERIFY_BITS(c, 63);
+    t1 = c & M; c >>= 26; c += u1 * R1;
+    VERIFY_BITS(t1, 26);
+    VERIFY_BITS(c, 38);
+
+    c += p[2];
+    VERIFY_BITS(c, 62);
+    d += p[12];
+    VERIFY_BITS(d, 63);
+    u2 = d & M; d >>= 26; c += u2 * R0;
+    VERIFY_BITS(u2, 26);
+    VERIFY_BITS(d, 37);
+    VERIFY_BITS(c, 63);
+    t2 = c & M; c >>= 26; c += u2 * R1;
+    VERIFY_BITS(t2, 26);
+    VERIFY_BITS(c, 38);
+
+    c += p[3];
+    VERIFY_BITS(c, 63);
+    d += p[13];
+    VERIFY_BITS(d, 63);
+    u3 = d & M; d >>= 26; c += u3 * R0;
+    VERIFY_BITS(u3, 26);
+    VERIFY_BITS(d, 37);
+    t3 = c & M; c >>= 26; c += u3 * R1;
+    VERIFY_BITS(t3, 26);
+    VERIFY_BITS(c, 39);
+
+    c += p[4];
+    VERIFY_BITS(c, 63);
+    d += p[14];
+    VERIFY_BITS(d, 62);
+    u4 = d & M; d >>= 26; c += u4 * R0;
+    VERIFY_BITS(u4, 26);
+    VERIFY_BITS(d, 36);
+    t4 = c & M; c >>= 26; c += u4 * R1;
+    VERIFY_BITS(t4, 26);
+    VERIFY_BITS(c, 39);
+
+    c += p[5];
+    VERIFY_BITS(c, 63);
+    d += p[15];
+    VERIFY_BITS(d, 62);
+    u5 = d & M; d >>= 26; c += u5 * R0;
+    VERIFY_BITS(u5, 26);
+    VERIFY_BITS(d, 36);
+    t5 = c & M; c >>= 26; c += u5 * R1;
+    VERIFY_BITS(t5, 26);
+    VERIFY_BITS(c, 39);
+
+    c += p[6];
+    VERIFY_BITS(c, 63);
+    d += p[16];
+    VERIFY_BITS(d, 61);
+    u6 = d & M; d >>= 26; c += u6 * R0;
+    VERIFY_BITS(u6, 26);
+    VERIFY_BITS(d, 35);
+    t6 = c & M; c >>= 26; c += u6 * R1;
+    VERIFY_BITS(t6, 26);
+    VERIFY_BITS(c, 39);
+
+    c += p[7];
+    VERIFY_CHECK(c <= 0x8000007C00000007ULL);
+    d += p[17];
+    VERIFY_BITS(d, 58);
+    u7 = d & M; d >>= 26; c += u7 * R0;
+    VERIFY_BITS(u7, 26);
+    VERIFY_BITS(d, 32);
+    VERIFY_CHECK(c <= 0x800001703FFFC2F7ULL);
+    t7 = c & M; c >>= 26; c += u7 * R1;
+    VERIFY_BITS(t7, 26);
+    VERIFY_BITS(c, 38);
+
+    c += p[8];
+    VERIFY_CHECK(c <= 0x9000007B80000008ULL);
+    d += p[18];
+    VERIFY_BITS(d, 57);
+    u8 = d & M; d >>= 26; c += u8 * R0;
+    VERIFY_BITS(u8, 26);
+    VERIFY_BITS(d, 31);
+    VERIFY_CHECK(c <= 0x9000016FBFFFC2F8ULL);
+
+    r[3] = t3;
+    VERIFY_BITS(r[3], 26);
+    r[4] = t4;
+    VERIFY_BITS(r[4], 26);
+    r[5] = t5;
+    VERIFY_BITS(r[5], 26);
+    r[6] = t6;
+    VERIFY_BITS(r[6], 26);
+    r[7] = t7;
+    VERIFY_BITS(r[7], 26);
+
+    r[8] = c & M; c >>= 26; c += u8 * R1;
+    VERIFY_BITS(r[8], 26);
+    VERIFY_BITS(c, 39);
+    c   += d * R0 + t9;
+    VERIFY_BITS(c, 45);
+    r[9] = c & (M >> 4); c >>= 22; c += d * (R1 << 4);
+    VERIFY_BITS(r[9], 22);
+    VERIFY_BITS(c, 46);
+
+    d    = c * (R0 >> 4) + t0;
+    VERIFY_BITS(d, 56);
+    r[0] = d & M; d >>= 26;
+    VERIFY_BITS(r[0], 26);
+    VERIFY_BITS(d, 30);
+    d   += c * (R1 >> 4) + t1;
+    VERIFY_BITS(d, 53);
+    VERIFY_CHECK(d <= 0x10000003FFFFBFULL);
+    r[1] = d & M; d >>= 26;
+    VERIFY_BITS(r[1], 26);
+    VERIFY_BITS(d, 27);
+    VERIFY_CHECK(d <= 0x4000000ULL);
+    d   += t2;
+    VERIFY_BITS(d, 27);
+    r[2] = d;
+    VERIFY_BITS(r[2], 27);
+}
+
+SECP256K1_INLINE static void secp256k1_fe_mul_inner(uint32_t *r, const uint32_t *a, const uint32_t * SECP256K1_RESTRICT b) {
+    uint64_t p[20];
+
+    VERIFY_BITS(a[0], 30);
+    VERIFY_BITS(a[1], 30);
+    VERIFY_BITS(a[2], 30);
+    VERIFY_BITS(a[3], 30);
+    VERIFY_BITS(a[4], 30);
+    VERIFY_BITS(a[5], 30);
+    VERIFY_BITS(a[6], 30);
+    VERIFY_BITS(a[7], 30);
+    VERIFY_BITS(a[8], 30);
+    VERIFY_BITS(a[9], 26);
+    VERIFY_BITS(b[0], 30);
+    VERIFY_BITS(b[1], 30);
+    VERIFY_BITS(b[2], 30);
+    VERIFY_BITS(b[3], 30);
+    VERIFY_BITS(b[4], 30);
+    VERIFY_BITS(b[5], 30);
+    VERIFY_BITS(b[6], 30);
+    VERIFY_BITS(b[7], 30);
+    VERIFY_BITS(b[8], 30);
+    VERIFY_BITS(b[9], 26);
+
+    secp256k1_fe_columns_neon(p, a, b);
+    secp256k1_fe_reduce_columns(r, p);
+}
+
+SECP256K1_INLINE static void secp256k1_fe_sqr_inner(uint32_t *r, const uint32_t *a) {
+    uint64_t p[20];
+
+    VERIFY_BITS(a[0], 30);
+    VERIFY_BITS(a[1], 30);
+    VERIFY_BITS(a[2], 30);
+    VERIFY_BITS(a[3], 30);
+    VERIFY_BITS(a[4], 30);
+    VERIFY_BITS(a[5], 30);
+    VERIFY_BITS(a[6], 30);
+    VERIFY_BITS(a[7], 30);
+    VERIFY_BITS(a[8], 30);
+    VERIFY_BITS(a[9], 26);
+
+    secp256k1_fe_columns_neon(p, a, a);
+    secp256k1_fe_reduce_columns(r, p);
+}
+
+#endif
@@ -0,0 +1,258 @@
+/**********************************************************************
+ * Copyright (c) 2013-2015 Pieter Wuille                              *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+/**
+ * AArch64 versions of the 5x52 inner multiplication and squaring. They perform exactly the steps of
+ * field_5x52_int128_impl.h (see there for the bounds), with the 128-bit accumulators c and d held in
+ * register pairs, each product formed by mul/umulh and accumulated with adds/adc. The limbs of both
+ * inputs are loaded up front, so r may alias a (but not b, as in the C version).
+ */
+
+#ifndef _SECP256K1_FIELD_INNER5X52_IMPL_H_
+#define _SECP256K1_FIELD_INNER5X52_IMPL_H_
+
+#include <stdint.h>
+
+/* (hi:lo) += x * y */
+#define SECP256K1_ARM64_MULADD(lo, hi, x, y) \
+    "mul %[tl], " x ", " y "\n" \
+    "umulh %[th], " x ", " y "\n" \
+    "adds " lo ", " lo ", %[tl]\n" \
+    "adc " hi ", " hi ", %[th]\n"
+
+/* (hi:lo) = x * y */
+#define SECP256K1_ARM64_MUL(lo, hi, x, y) \
+    "mul " lo ", " x ", " y "\n" \
+    "umulh " hi ", " x ", " y "\n"
+
+/* (hi:lo) >>= 52 */
+#define SECP256K1_ARM64_SHR52(lo, hi) \
+    "extr " lo ", " hi ", " lo ", #52\n" \
+    "lsr " hi ", " hi ", #52\n"
+
+SECP256K1_INLINE static void secp256k1_fe_mul_inner(uint64_t *r, const uint64_t *a, const uint64_t * SECP256K1_RESTRICT b) {
+    uint64_t a0, a1, a2, a3, a4, b0, b1, b2, b3, b4;
+    uint64_t cl, ch, dl, dh, t3, t4, tx, u0, tl, th;
+    const uint64_t R = 0x1000003D10ULL, R4 = 0x1000003D1ULL;
+
+__asm__ __volatile__(
+    "ldp %[a0], %[a1], [%[a]]\n"
+    "ldp %[a2], %[a3], [%[a], #16]\n"
+    "ldr %[a4], [%[a], #32]\n"
+    "ldp %[b0], %[b1], [%[b]]\n"
+    "ldp %[b2], %[b3], [%[b], #16]\n"
+    "ldr %[b4], [%[b], #32]\n"
+
+    /* d = p3 */
+    SECP256K1_ARM64_MUL("%[dl]", "%[dh]", "%[a0]", "%[b3]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a1]", "%[b2]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a2]", "%[b1]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a3]", "%[b0]")
+    /* c = p8 */
+    SECP256K1_ARM64_MUL("%[cl]", "%[ch]", "%[a4]", "%[b4]")
+    /* d += (c & M) * R; c >>= 52 */
+    "and %[tx], %[cl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[tx]", "%[R]")
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+    /* t3 = d & M; d >>= 52 */
+    "and %[t3], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+
+    /* d += p4 */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a0]", "%[b4]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a1]", "%[b3]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a2]", "%[b2]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a3]", "%[b1]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a4]", "%[b0]")
+    /* d += c * R */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[cl]", "%[R]")
+    /* t4 = d & M; d >>= 52 */
+    "and %[t4], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* tx = t4 >> 48; t4 &= (M >> 4) */
+    "lsr %[tx], %[t4], #48\n"
+    "and %[t4], %[t4], #0xFFFFFFFFFFFF\n"
+
+    /* c = p0 */
+    SECP256K1_ARM64_MUL("%[cl]", "%[ch]", "%[a0]", "%[b0]")
+    /* d += p5 */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a1]", "%[b4]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a2]", "%[b3]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a3]", "%[b2]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a4]", "%[b1]")
+    /* u0 = d & M; d >>= 52 */
+    "and %[u0], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* u0 = (u0 << 4) | tx */
+    "orr %[u0], %[tx], %[u0], lsl #4\n"
+    /* c += u0 * (R >> 4) */
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[u0]", "%[R4]")
+    /* r[0] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r]]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+
+    /* c += p1 */
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a0]", "%[b1]")
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a1]", "%[b0]")
+    /* d += p6 */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a2]", "%[b4]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a3]", "%[b3]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a4]", "%[b2]")
+    /* c += (d & M) * R; d >>= 52 */
+    "and %[tx], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[tx]", "%[R]")
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* r[1] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r], #8]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+
+    /* c += p2 */
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a0]", "%[b2]")
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a1]", "%[b1]")
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a2]", "%[b0]")
+    /* d += p7 */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a3]", "%[b4]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a4]", "%[b3]")
+    /* c += (d & M) * R; d >>= 52 */
+    "and %[tx], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[tx]", "%[R]")
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* r[2] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r], #16]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+
+    /* c += d * R + t3 */
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[dl]", "%[R]")
+    "adds %[cl], %[cl], %[t3]\n"
+    "adc %[ch], %[ch], xzr\n"
+    /* r[3] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r], #24]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+    /* r[4] = c + t4 */
+    "add %[cl], %[cl], %[t4]\n"
+    "str %[cl], [%[r], #32]\n"
+    : [a0] "=&r"(a0), [a1] "=&r"(a1), [a2] "=&r"(a2), [a3] "=&r"(a3), [a4] "=&r"(a4),
+      [b0] "=&r"(b0), [b1] "=&r"(b1), [b2] "=&r"(b2), [b3] "=&r"(b3), [b4] "=&r"(b4),
+      [cl] "=&r"(cl), [ch] "=&r"(ch), [dl] "=&r"(dl), [dh] "=&r"(dh),
+      [t3] "=&r"(t3), [t4] "=&r"(t4), [tx] "=&r"(tx), [u0] "=&r"(u0), [tl] "=&r"(tl), [th] "=&r"(th)
+    : [r] "r"(r), [a] "r"(a), [b] "r"(b), [R] "r"(R), [R4] "r"(R4)
+    : "cc", "memory");
+}
+
+SECP256K1_INLINE static void secp256k1_fe_sqr_inner(uint64_t *r, const uint64_t *a) {
+    uint64_t a0, a1, a2, a3, a4;
+    uint64_t cl, ch, dl, dh, t3, t4, tx, u0, tl, th;
+    const uint64_t R = 0x1000003D10ULL, R4 = 0x1000003D1ULL;
+
+__asm__ __volatile__(
+    "ldp %[a0], %[a1], [%[a]]\n"
+    "ldp %[a2], %[a3], [%[a], #16]\n"
+    "ldr %[a4], [%[a], #32]\n"
+
+    /* d = p3 */
+    "lsl %[tx], %[a0], #1\n"
+    SECP256K1_ARM64_MUL("%[dl]", "%[dh]", "%[tx]", "%[a3]")
+    "lsl %[tx], %[a1], #1\n"
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[tx]", "%[a2]")
+    /* c = p8 */
+    SECP256K1_ARM64_MUL("%[cl]", "%[ch]", "%[a4]", "%[a4]")
+    /* d += (c & M) * R; c >>= 52 */
+    "and %[tx], %[cl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[tx]", "%[R]")
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+    /* t3 = d & M; d >>= 52 */
+    "and %[t3], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+
+    /* a4 *= 2; d += p4 */
+    "lsl %[a4], %[a4], #1\n"
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a0]", "%[a4]")
+    "lsl %[tx], %[a1], #1\n"
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[tx]", "%[a3]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a2]", "%[a2]")
+    /* d += c * R */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[cl]", "%[R]")
+    /* t4 = d & M; d >>= 52 */
+    "and %[t4], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* tx = t4 >> 48; t4 &= (M >> 4) */
+    "lsr %[tx], %[t4], #48\n"
+    "and %[t4], %[t4], #0xFFFFFFFFFFFF\n"
+
+    /* c = p0 */
+    SECP256K1_ARM64_MUL("%[cl]", "%[ch]", "%[a0]", "%[a0]")
+    /* d += p5 (u0 is free until the next step) */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a1]", "%[a4]")
+    "lsl %[u0], %[a2], #1\n"
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[u0]", "%[a3]")
+    /* u0 = d & M; d >>= 52 */
+    "and %[u0], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* u0 = (u0 << 4) | tx */
+    "orr %[u0], %[tx], %[u0], lsl #4\n"
+    /* c += u0 * (R >> 4) */
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[u0]", "%[R4]")
+    /* r[0] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r]]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+
+    /* a0 *= 2; c += p1 */
+    "lsl %[a0], %[a0], #1\n"
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a0]", "%[a1]")
+    /* d += p6 */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a2]", "%[a4]")
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a3]", "%[a3]")
+    /* c += (d & M) * R; d >>= 52 */
+    "and %[tx], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[tx]", "%[R]")
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* r[1] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r], #8]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+
+    /* c += p2 */
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a0]", "%[a2]")
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[a1]", "%[a1]")
+    /* d += p7 */
+    SECP256K1_ARM64_MULADD("%[dl]", "%[dh]", "%[a3]", "%[a4]")
+    /* c += (d & M) * R; d >>= 52 */
+    "and %[tx], %[dl], #0xFFFFFFFFFFFFF\n"
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[tx]", "%[R]")
+    SECP256K1_ARM64_SHR52("%[dl]", "%[dh]")
+    /* r[2] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r], #16]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+
+    /* c += d * R + t3 */
+    SECP256K1_ARM64_MULADD("%[cl]", "%[ch]", "%[dl]", "%[R]")
+    "adds %[cl], %[cl], %[t3]\n"
+    "adc %[ch], %[ch], xzr\n"
+    /* r[3] = c & M; c >>= 52 */
+    "and %[tl], %[cl], #0xFFFFFFFFFFFFF\n"
+    "str %[tl], [%[r], #24]\n"
+    SECP256K1_ARM64_SHR52("%[cl]", "%[ch]")
+    /* r[4] = c + t4 */
+    "add %[cl], %[cl], %[t4]\n"
+    "str %[cl], [%[r], #32]\n"
+    : [a0] "=&r"(a0), [a1] "=&r"(a1), [a2] "=&r"(a2), [a3] "=&r"(a3), [a4] "=&r"(a4),
+      [cl] "=&r"(cl), [ch] "=&r"(ch), [dl] "=&r"(dl), [dh] "=&r"(dh),
+      [t3] "=&r"(t3), [t4] "=&r"(t4), [tx] "=&r"(tx), [u0] "=&r"(u0), [tl] "=&r"(tl), [th] "=&r"(th)
+    : [r] "r"(r), [a] "r"(a), [R] "r"(R), [R4] "r"(R4)
+    : "cc", "memory");
+}
+
+#undef SECP256K1_ARM64_MULADD
+#undef SECP256K1_ARM64_MUL
+#undef SECP256K1_ARM64_SHR52
+
+#endif
@@ -0,0 +1,200 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille                                   *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_FIELD_INNER5X52_AVX2_IMPL_H_
+#define _SECP256K1_FIELD_INNER5X52_AVX2_IMPL_H_
+
+#include <stdint.h>
+#include <immintrin.h>
+
+/** Four independent multiplications or squarings at once, one per 64-bit lane of an AVX2 register.
+ *
+ *  AVX2 only multiplies 32x32->64 bits, so inside the kernel each input is re-split from 5 limbs of 52
+ *  bits into the 10 limbs of 26 bits used by field_10x26, and multiplied with the same schedule as
+ *  the 10x26 secp256k1_fe_mul_inner. Splitting a 5x52 limb of at most 56 bits gives a high half of at
+ *  most 30 bits (26 for the top limb), which is exactly what that schedule accepts, and joining the
+ *  26-bit output limbs pairwise again gives a 5x52 result of magnitude 1.
+ */
+
+#define SECP256K1_FE_X4_M 0x3FFFFFFULL
+#define X4_MAC(acc, i, j) (acc) = _mm256_add_epi64((acc), _mm256_mul_epu32(a[i], b[j]))
+#define X4_SQR(acc, i, j) (acc) = _mm256_add_epi64((acc), _mm256_mul_epu32((i) == (j) ? a[i] : a2[i], a[j]))
+#define X4_FOLD(k) do { \
+    u = _mm256_and_si256(d, M); \
+    d = _mm256_srli_epi64(d, 26); \
+    c = _mm256_add_epi64(c, _mm256_mul_epu32(u, R0)); \
+    t[k] = _mm256_and_si256(c, M); \
+    c = _mm256_srli_epi64(c, 26); \
+    c = _mm256_add_epi64(c, _mm256_mul_epu32(u, R1)); \
+} while(0)
+
+SECP256K1_INLINE static __m256i secp256k1_fe_x4_mulc(__m256i x, uint32_t k) {
+    /* x * k for lanes x of up to 64 bits and a 32-bit constant k, keeping the low 64 bits. */
+    const __m256i kv = _mm256_set1_epi64x(k);
+    return _mm256_add_epi64(_mm256_mul_epu32(x, kv), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), kv), 32));
+}
+
+SECP256K1_INLINE static void secp256k1_fe_x4_load(__m256i *a, const uint64_t *a0, const uint64_t *a1, const uint64_t *a2, const uint64_t *a3) {
+    /* Transpose the four 5x52 inputs into lanes, and split every 52-bit limb into two 26-bit ones. */
+    const __m256i M = _mm256_set1_epi64x(SECP256K1_FE_X4_M);
+    int i;
+    for (i = 0; i < 5; i++) {
+        __m256i x = _mm256_set_epi64x(a3[i], a2[i], a1[i], a0[i]);
+        a[2 * i] = _mm256_and_si256(x, M);
+        a[2 * i + 1] = _mm256_srli_epi64(x, 26);
+    }
+}
+
+SECP256K1_INLINE static void secp256k1_fe_x4_reduce(uint64_t *r0, uint64_t *r1, uint64_t *r2, uint64_t *r3, __m256i c, __m256i d, __m256i *t) {
+    /* Finish the reduction once all columns have been folded, as at the end of the 10x26
+     * secp256k1_fe_mul_inner, and join and transpose the result back into four 5x52 elements. */
+    const __m256i M = _mm256_set1_epi64x(SECP256K1_FE_X4_M);
+    const __m256i R0 = _mm256_set1_epi64x(0x3D10);
+    const __m256i R1 = _mm256_set1_epi64x(0x400);
+    int i;
+
+    /* d now has at most 31 bits, and c at most 39. */
+    c = _mm256_add_epi64(c, _mm256_add_epi64(_mm256_mul_epu32(d, R0), t[9]));
+    t[9] = _mm256_and_si256(c, _mm256_srli_epi64(M, 4));
+    c = _mm256_srli_epi64(c, 22);
+    c = _mm256_add_epi64(c, _mm256_mul_epu32(d, _mm256_slli_epi64(R1, 4)));
+
+    d = _mm256_add_epi64(secp256k1_fe_x4_mulc(c, 0x3D1), t[0]);
+    t[0] = _mm256_and_si256(d, M);
+    d = _mm256_srli_epi64(d, 26);
+    d = _mm256_add_epi64(d, _mm256_add_epi64(_mm256_slli_epi64(c, 6), t[1]));
+    t[1] = _mm256_and_si256(d, M);
+    d = _mm256_srli_epi64(d, 26);
+    t[2] = _mm256_add_epi64(d, t[2]);
+
+    for (i = 0; i < 5; i++) {
+        t[2 * i] = _mm256_add_epi64(t[2 * i], _mm256_slli_epi64(t[2 * i + 1], 26));
+    }
+    for (i = 0; i < 5; i++) {
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, t[2 * i]);
+        r0[i] = lanes[0];
+        r1[i] = lanes[1];
+        r2[i] = lanes[2];
+        r3[i] = lanes[3];
+    }
+}
+
+SECP256K1_INLINE static void secp256k1_fe_mul_x4_inner(uint64_t *r0, uint64_t *r1, uint64_t *r2, uint64_t *r3,
+ const uint64_t *a0, const uint64_t *a1, const uint64_t *a2, const uint64_t *a3,
+ const uint64_t *b0, const uint64_t *b1, const uint64_t *b2, const uint64_t *b3) {
+    const __m256i M = _mm256_set1_epi64x(SECP256K1_FE_X4_M);
+    const __m256i R0 = _mm256_set1_epi64x(0x3D10);
+    const __m256i R1 = _mm256_set1_epi64x(0x400);
+    __m256i a[10], b[10], t[10];
+    __m256i c, d, u;
+
+    secp256k1_fe_x4_load(a, a0, a1, a2, a3);
+    secp256k1_fe_x4_load(b, b0, b1, b2, b3);
+
+    /* [d t9 0 0 0 0 0 0 0 0 0] = [p9 0 0 0 0 0 0 0 0 0] */
+    d = _mm256_setzero_si256();
+    X4_MAC(d, 0, 9); X4_MAC(d, 1, 8); X4_MAC(d, 2, 7); X4_MAC(d, 3, 6); X4_MAC(d, 4, 5); X4_MAC(d, 5, 4); X4_MAC(d, 6, 3); X4_MAC(d, 7, 2); X4_MAC(d, 8, 1); X4_MAC(d, 9, 0);
+    t[9] = _mm256_and_si256(d, M);
+    d = _mm256_srli_epi64(d, 26);
+
+    /* Column k (k = 0..8) of the low half is combined with column k + 10 of the high half, whose
+     * low 26 bits u are folded in using [u 0 0 0 0 0 0 0 0 0 0] = [u*R1 u*R0]. The loops are written
+     * out so that the schedule does not depend on the compiler unrolling them. */
+    c = _mm256_setzero_si256();
+    X4_MAC(c, 0, 0);
+    X4_MAC(d, 1, 9); X4_MAC(d, 2, 8); X4_MAC(d, 3, 7); X4_MAC(d, 4, 6); X4_MAC(d, 5, 5); X4_MAC(d, 6, 4); X4_MAC(d, 7, 3); X4_MAC(d, 8, 2); X4_MAC(d, 9, 1);
+    X4_FOLD(0);
+    X4_MAC(c, 0, 1); X4_MAC(c, 1, 0);
+    X4_MAC(d, 2, 9); X4_MAC(d, 3, 8); X4_MAC(d, 4, 7); X4_MAC(d, 5, 6); X4_MAC(d, 6, 5); X4_MAC(d, 7, 4); X4_MAC(d, 8, 3); X4_MAC(d, 9, 2);
+    X4_FOLD(1);
+    X4_MAC(c, 0, 2); X4_MAC(c, 1, 1); X4_MAC(c, 2, 0);
+    X4_MAC(d, 3, 9); X4_MAC(d, 4, 8); X4_MAC(d, 5, 7); X4_MAC(d, 6, 6); X4_MAC(d, 7, 5); X4_MAC(d, 8, 4); X4_MAC(d, 9, 3);
+    X4_FOLD(2);
+    X4_MAC(c, 0, 3); X4_MAC(c, 1, 2); X4_MAC(c, 2, 1); X4_MAC(c, 3, 0);
+    X4_MAC(d, 4, 9); X4_MAC(d, 5, 8); X4_MAC(d, 6, 7); X4_MAC(d, 7, 6); X4_MAC(d, 8, 5); X4_MAC(d, 9, 4);
+    X4_FOLD(3);
+    X4_MAC(c, 0, 4); X4_MAC(c, 1, 3); X4_MAC(c, 2, 2); X4_MAC(c, 3, 1); X4_MAC(c, 4, 0);
+    X4_MAC(d, 5, 9); X4_MAC(d, 6, 8); X4_MAC(d, 7, 7); X4_MAC(d, 8, 6); X4_MAC(d, 9, 5);
+    X4_FOLD(4);
+    X4_MAC(c, 0, 5); X4_MAC(c, 1, 4); X4_MAC(c, 2, 3); X4_MAC(c, 3, 2); X4_MAC(c, 4, 1); X4_MAC(c, 5, 0);
+    X4_MAC(d, 6, 9); X4_MAC(d, 7, 8); X4_MAC(d, 8, 7); X4_MAC(d, 9, 6);
+    X4_FOLD(5);
+    X4_MAC(c, 0, 6); X4_MAC(c, 1, 5); X4_MAC(c, 2, 4); X4_MAC(c, 3, 3); X4_MAC(c, 4, 2); X4_MAC(c, 5, 1); X4_MAC(c, 6, 0);
+    X4_MAC(d, 7, 9); X4_MAC(d, 8, 8); X4_MAC(d, 9, 7);
+    X4_FOLD(6);
+    X4_MAC(c, 0, 7); X4_MAC(c, 1, 6); X4_MAC(c, 2, 5); X4_MAC(c, 3, 4); X4_MAC(c, 4, 3); X4_MAC(c, 5, 2); X4_MAC(c, 6, 1); X4_MAC(c, 7, 0);
+    X4_MAC(d, 8, 9); X4_MAC(d, 9, 8);
+    X4_FOLD(7);
+    X4_MAC(c, 0, 8); X4_MAC(c, 1, 7); X4_MAC(c, 2, 6); X4_MAC(c, 3, 5); X4_MAC(c, 4, 4); X4_MAC(c, 5, 3); X4_MAC(c, 6, 2); X4_MAC(c, 7, 1); X4_MAC(c, 8, 0);
+    X4_MAC(d, 9, 9);
+    X4_FOLD(8);
+
+    secp256k1_fe_x4_reduce(r0, r1, r2, r3, c, d, t);
+}
+
+/* The same for a = b, where every cross product a[i]*a[j] is computed once using the doubled limb a2[i]. */
+SECP256K1_INLINE static void secp256k1_fe_sqr_x4_inner(uint64_t *r0, uint64_t *r1, uint64_t *r2, uint64_t *r3,
+ const uint64_t *x0, const uint64_t *x1, const uint64_t *x2, const uint64_t *x3) {
+    const __m256i M = _mm256_set1_epi64x(SECP256K1_FE_X4_M);
+    const __m256i R0 = _mm256_set1_epi64x(0x3D10);
+    const __m256i R1 = _mm256_set1_epi64x(0x400);
+    __m256i a[10], a2[10], t[10];
+    __m256i c, d, u;
+    int i;
+
+    secp256k1_fe_x4_load(a, x0, x1, x2, x3);
+    for (i = 0; i < 10; i++) {
+        a2[i] = _mm256_add_epi64(a[i], a[i]);
+    }
+
+    /* [d t9 0 0 0 0 0 0 0 0 0] = [p9 0 0 0 0 0 0 0 0 0] */
+    d = _mm256_setzero_si256();
+    X4_SQR(d, 0, 9); X4_SQR(d, 1, 8); X4_SQR(d, 2, 7); X4_SQR(d, 3, 6); X4_SQR(d, 4, 5);
+    t[9] = _mm256_and_si256(d, M);
+    d = _mm256_srli_epi64(d, 26);
+
+    /* Column k (k = 0..8) of the low half is combined with column k + 10 of the high half, whose
+     * low 26 bits u are folded in using [u 0 0 0 0 0 0 0 0 0 0] = [u*R1 u*R0]. The loops are written
+     * out so that the schedule does not depend on the compiler unrolling them. */
+    c = _mm256_setzero_si256();
+    X4_SQR(c, 0, 0);
+    X4_SQR(d, 1, 9); X4_SQR(d, 2, 8); X4_SQR(d, 3, 7); X4_SQR(d, 4, 6); X4_SQR(d, 5, 5);
+    X4_FOLD(0);
+    X4_SQR(c, 0, 1);
+    X4_SQR(d, 2, 9); X4_SQR(d, 3, 8); X4_SQR(d, 4, 7); X4_SQR(d, 5, 6);
+    X4_FOLD(1);
+    X4_SQR(c, 0, 2); X4_SQR(c, 1, 1);
+    X4_SQR(d, 3, 9); X4_SQR(d, 4, 8); X4_SQR(d, 5, 7); X4_SQR(d, 6, 6);
+    X4_FOLD(2);
+    X4_SQR(c, 0, 3); X4_SQR(c, 1, 2);
+    X4_SQR(d, 4, 9); X4_SQR(d, 5, 8); X4_SQR(d, 6, 7);
+    X4_FOLD(3);
+    X4_SQR(c, 0, 4); X4_SQR(c, 1, 3); X4_SQR(c, 2, 2);
+    X4_SQR(d, 5, 9); X4_SQR(d, 6, 8); X4_SQR(d, 7, 7);
+    X4_FOLD(4);
+    X4_SQR(c, 0, 5); X4_SQR(c, 1, 4); X4_SQR(c, 2, 3);
+    X4_SQR(d, 6, 9); X4_SQR(d, 7, 8);
+    X4_FOLD(5);
+    X4_SQR(c, 0, 6); X4_SQR(c, 1, 5); X4_SQR(c, 2, 4); X4_SQR(c, 3, 3);
+    X4_SQR(d, 7, 9); X4_SQR(d, 8, 8);
+    X4_FOLD(6);
+    X4_SQR(c, 0, 7); X4_SQR(c, 1, 6); X4_SQR(c, 2, 5); X4_SQR(c, 3, 4);
+    X4_SQR(d, 8, 9);
+    X4_FOLD(7);
+    X4_SQR(c, 0, 8); X4_SQR(c, 1, 7); X4_SQR(c, 2, 6); X4_SQR(c, 3, 5); X4_SQR(c, 4, 4);
+    X4_SQR(d, 9, 9);
+    X4_FOLD(8);
+
+    secp256k1_fe_x4_reduce(r0, r1, r2, r3, c, d, t);
+}
+
+#undef SECP256K1_FE_X4_M
+#undef X4_MAC
+#undef X4_SQR
+#undef X4_FOLD
+
+#endif
@@ -15,12 +15,18 @@
 #include "util.h"
 #include "num.h"
 #include "field.h"
+#include "modinv64_impl.h"
 
 #if defined(USE_ASM_X86_64)
 #include "field_5x52_asm_impl.h"
+#elif defined(USE_ASM_ARM64)
+#include "field_5x52_arm64_impl.h"
 #else
 #include "field_5x52_int128_impl.h"
 #endif
+#if defined(USE_FIELD_5X52_AVX2)
+#include "field_5x52_avx2_impl.h"
+#endif
 
 /** Implements arithmetic modulo FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFE FFFFFC2F,
  *  represented as 5 uint64_t's in base 2^52. The values are allowed to contain >52 each. In particular,
@@ -383,6 +389,7 @@ static void secp256k1_fe_mul(secp256k1_fe_t *r, const secp256k1_fe_t *a, const s
     secp256k1_fe_verify(b);
     VERIFY_CHECK(r != b);
 #endif
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_MUL, 1);
     secp256k1_fe_mul_inner(r->n, a->n, b->n);
 #ifdef VERIFY
     r->magnitude = 1;
@@ -391,11 +398,40 @@ static void secp256k1_fe_mul(secp256k1_fe_t *r, const secp256k1_fe_t *a, const s
 #endif
 }
 
+static void secp256k1_fe_mul_x4(secp256k1_fe_t * const *r, const secp256k1_fe_t * const *a, const secp256k1_fe_t * const *b) {
+    int i;
+#ifdef VERIFY
+    for (i = 0; i < 4; i++) {
+        VERIFY_CHECK(a[i]->magnitude <= 8);
+        VERIFY_CHECK(b[i]->magnitude <= 8);
+        secp256k1_fe_verify(a[i]);
+        secp256k1_fe_verify(b[i]);
+    }
+#endif
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_MUL, 4);
+#if defined(USE_FIELD_5X52_AVX2)
+    secp256k1_fe_mul_x4_inner(r[0]->n, r[1]->n, r[2]->n, r[3]->n, a[0]->n, a[1]->n, a[2]->n, a[3]->n, b[0]->n, b[1]->n, b[2]->n, b[3]->n);
+#else
+    for (i = 0; i < 4; i++) {
+        secp256k1_fe_mul_inner(r[i]->n, a[i]->n, b[i]->n);
+    }
+#endif
+#ifdef VERIFY
+    for (i = 0; i < 4; i++) {
+        r[i]->magnitude = 1;
+        r[i]->normalized = 0;
+        secp256k1_fe_verify(r[i]);
+    }
+#endif
+    (void)i;
+}
+
 static void secp256k1_fe_sqr(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
 #ifdef VERIFY
     VERIFY_CHECK(a->magnitude <= 8);
     secp256k1_fe_verify(a);
 #endif
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_SQR, 1);
     secp256k1_fe_sqr_inner(r->n, a->n);
 #ifdef VERIFY
     r->magnitude = 1;
@@ -404,6 +440,32 @@ static void secp256k1_fe_sqr(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
 #endif
 }
 
+static void secp256k1_fe_sqr_x4(secp256k1_fe_t * const *r, const secp256k1_fe_t * const *a) {
+    int i;
+#ifdef VERIFY
+    for (i = 0; i < 4; i++) {
+        VERIFY_CHECK(a[i]->magnitude <= 8);
+        secp256k1_fe_verify(a[i]);
+    }
+#endif
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_SQR, 4);
+#if defined(USE_FIELD_5X52_AVX2)
+    secp256k1_fe_sqr_x4_inner(r[0]->n, r[1]->n, r[2]->n, r[3]->n, a[0]->n, a[1]->n, a[2]->n, a[3]->n);
+#else
+    for (i = 0; i < 4; i++) {
+        secp256k1_fe_sqr_inner(r[i]->n, a[i]->n);
+    }
+#endif
+#ifdef VERIFY
+    for (i = 0; i < 4; i++) {
+        r[i]->magnitude = 1;
+        r[i]->normalized = 0;
+        secp256k1_fe_verify(r[i]);
+    }
+#endif
+    (void)i;
+}
+
 static SECP256K1_INLINE void secp256k1_fe_cmov(secp256k1_fe_t *r, const secp256k1_fe_t *a, int flag) {
     uint64_t mask0, mask1;
     mask0 = flag + ~((uint64_t)0);
@@ -451,4 +513,67 @@ static SECP256K1_INLINE void secp256k1_fe_from_storage(secp256k1_fe_t *r, const
 #endif
 }
 
+static void secp256k1_fe_from_signed62(secp256k1_fe_t *r, const secp256k1_modinv64_signed62_t *a) {
+    const uint64_t M52 = UINT64_MAX >> 12;
+    const uint64_t a0 = a->v[0], a1 = a->v[1], a2 = a->v[2], a3 = a->v[3], a4 = a->v[4];
+
+    /* The input is in [0, p), so the top limb is below 2^(256-62*4). */
+    VERIFY_CHECK(a4 >> 8 == 0);
+
+    r->n[0] =  a0                   & M52;
+    r->n[1] = (a0 >> 52 | a1 << 10) & M52;
+    r->n[2] = (a1 >> 42 | a2 << 20) & M52;
+    r->n[3] = (a2 >> 32 | a3 << 30) & M52;
+    r->n[4] = (a3 >> 22 | a4 << 40);
+#ifdef VERIFY
+    r->magnitude = 1;
+    r->normalized = 1;
+    secp256k1_fe_verify(r);
+#endif
+}
+
+static void secp256k1_fe_to_signed62(secp256k1_modinv64_signed62_t *r, const secp256k1_fe_t *a) {
+    const uint64_t M62 = UINT64_MAX >> 2;
+    const uint64_t a0 = a->n[0], a1 = a->n[1], a2 = a->n[2], a3 = a->n[3], a4 = a->n[4];
+
+#ifdef VERIFY
+    VERIFY_CHECK(a->normalized);
+#endif
+
+    r->v[0] = (a0       | a1 << 52) & M62;
+    r->v[1] = (a1 >> 10 | a2 << 42) & M62;
+    r->v[2] = (a2 >> 20 | a3 << 32) & M62;
+    r->v[3] = (a3 >> 30 | a4 << 22) & M62;
+    r->v[4] =  a4 >> 40;
+}
+
+static const secp256k1_modinv64_modinfo_t secp256k1_const_modinfo_fe = {
+    {{-0x1000003D1LL, 0, 0, 0, 256}},
+    0x27C7F6E22DDACACFLL
+};
+
+static void secp256k1_fe_inv(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
+    secp256k1_fe_t tmp = *a;
+    secp256k1_modinv64_signed62_t s;
+
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_INV, 1);
+    secp256k1_fe_normalize(&tmp);
+    secp256k1_fe_to_signed62(&s, &tmp);
+    secp256k1_modinv64(&s, &secp256k1_const_modinfo_fe);
+    secp256k1_fe_from_signed62(r, &s);
+}
+
+#if defined(USE_FIELD_INV_BUILTIN)
+static void secp256k1_fe_inv_var(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
+    secp256k1_fe_t tmp = *a;
+    secp256k1_modinv64_signed62_t s;
+
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_INV_VAR, 1);
+    secp256k1_fe_normalize_var(&tmp);
+    secp256k1_fe_to_signed62(&s, &tmp);
+    secp256k1_modinv64_var(&s, &secp256k1_const_modinfo_fe);
+    secp256k1_fe_from_signed62(r, &s);
+}
+#endif
+
 #endif
@@ -32,6 +32,8 @@ static int secp256k1_fe_sqrt_var(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
     secp256k1_fe_t x2, x3, x6, x9, x11, x22, x44, x88, x176, x220, x223, t1;
     int j;
 
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_SQRT_VAR, 1);
+
     /** The binary representation of (p + 1)/4 has 3 blocks of 1s, with lengths in
      *  { 2, 22, 223 }. Use an addition chain to calculate 2^n - 1 for each block:
      *  1, [2], 3, 6, 9, 11, [22], 44, 88, 176, 220, [223]
@@ -117,100 +119,60 @@ static int secp256k1_fe_sqrt_var(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
     return secp256k1_fe_equal_var(&t1, a);
 }
 
-static void secp256k1_fe_inv(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
-    secp256k1_fe_t x2, x3, x6, x9, x11, x22, x44, x88, x176, x220, x223, t1;
-    int j;
-
-    /** The binary representation of (p - 2) has 5 blocks of 1s, with lengths in
-     *  { 1, 2, 22, 223 }. Use an addition chain to calculate 2^n - 1 for each block:
-     *  [1], [2], 3, 6, 9, 11, [22], 44, 88, 176, 220, [223]
-     */
-
-    secp256k1_fe_sqr(&x2, a);
-    secp256k1_fe_mul(&x2, &x2, a);
-
-    secp256k1_fe_sqr(&x3, &x2);
-    secp256k1_fe_mul(&x3, &x3, a);
-
-    x6 = x3;
-    for (j=0; j<3; j++) {
-        secp256k1_fe_sqr(&x6, &x6);
-    }
-    secp256k1_fe_mul(&x6, &x6, &x3);
-
-    x9 = x6;
-    for (j=0; j<3; j++) {
-        secp256k1_fe_sqr(&x9, &x9);
-    }
-    secp256k1_fe_mul(&x9, &x9, &x3);
-
-    x11 = x9;
-    for (j=0; j<2; j++) {
-        secp256k1_fe_sqr(&x11, &x11);
-    }
-    secp256k1_fe_mul(&x11, &x11, &x2);
-
-    x22 = x11;
-    for (j=0; j<11; j++) {
-        secp256k1_fe_sqr(&x22, &x22);
-    }
-    secp256k1_fe_mul(&x22, &x22, &x11);
-
-    x44 = x22;
-    for (j=0; j<22; j++) {
-        secp256k1_fe_sqr(&x44, &x44);
-    }
-    secp256k1_fe_mul(&x44, &x44, &x22);
-
-    x88 = x44;
-    for (j=0; j<44; j++) {
-        secp256k1_fe_sqr(&x88, &x88);
-    }
-    secp256k1_fe_mul(&x88, &x88, &x44);
-
-    x176 = x88;
-    for (j=0; j<88; j++) {
-        secp256k1_fe_sqr(&x176, &x176);
-    }
-    secp256k1_fe_mul(&x176, &x176, &x88);
-
-    x220 = x176;
-    for (j=0; j<44; j++) {
-        secp256k1_fe_sqr(&x220, &x220);
+/* Set r[i] = x[i]^(2^n) * m[i] for i = 0..3. r may equal x or m. */
+static void secp256k1_fe_sqr_mul_x4(secp256k1_fe_t *r, const secp256k1_fe_t *x, int n, const secp256k1_fe_t *m) {
+    secp256k1_fe_t t[4];
+    secp256k1_fe_t *rp[4], *tp[4];
+    const secp256k1_fe_t *xp[4], *ctp[4], *mp[4];
+    int i;
+    for (i = 0; i < 4; i++) {
+        rp[i] = &r[i];
+        tp[i] = &t[i];
+        xp[i] = &x[i];
+        ctp[i] = &t[i];
+        mp[i] = &m[i];
     }
-    secp256k1_fe_mul(&x220, &x220, &x44);
-
-    x223 = x220;
-    for (j=0; j<3; j++) {
-        secp256k1_fe_sqr(&x223, &x223);
+    secp256k1_fe_sqr_x4(tp, xp);
+    for (i = 1; i < n; i++) {
+        secp256k1_fe_sqr_x4(tp, ctp);
     }
-    secp256k1_fe_mul(&x223, &x223, &x3);
-
-    /* The final result is then assembled using a sliding window over the blocks. */
+    secp256k1_fe_mul_x4(rp, ctp, mp);
+}
 
-    t1 = x223;
-    for (j=0; j<23; j++) {
-        secp256k1_fe_sqr(&t1, &t1);
-    }
-    secp256k1_fe_mul(&t1, &t1, &x22);
-    for (j=0; j<5; j++) {
-        secp256k1_fe_sqr(&t1, &t1);
+static void secp256k1_fe_sqrt_x4_var(secp256k1_fe_t *r, int *ret, const secp256k1_fe_t *a) {
+    secp256k1_fe_t x2[4], x3[4], x6[4], x11[4], x22[4], x44[4], x88[4], t1[4];
+    int i;
+
+    VERIFY_CHECK(r + 4 <= a || a + 4 <= r);
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_SQRT_VAR, 4);
+
+    /* The same addition chain as secp256k1_fe_sqrt_var, see there. */
+    secp256k1_fe_sqr_mul_x4(x2, a, 1, a);
+    secp256k1_fe_sqr_mul_x4(x3, x2, 1, a);
+    secp256k1_fe_sqr_mul_x4(x6, x3, 3, x3);
+    secp256k1_fe_sqr_mul_x4(t1, x6, 3, x3);
+    secp256k1_fe_sqr_mul_x4(x11, t1, 2, x2);
+    secp256k1_fe_sqr_mul_x4(x22, x11, 11, x11);
+    secp256k1_fe_sqr_mul_x4(x44, x22, 22, x22);
+    secp256k1_fe_sqr_mul_x4(x88, x44, 44, x44);
+    secp256k1_fe_sqr_mul_x4(t1, x88, 88, x88);
+    secp256k1_fe_sqr_mul_x4(t1, t1, 44, x44);
+    secp256k1_fe_sqr_mul_x4(t1, t1, 3, x3);
+    secp256k1_fe_sqr_mul_x4(t1, t1, 23, x22);
+    secp256k1_fe_sqr_mul_x4(t1, t1, 6, x2);
+    for (i = 0; i < 4; i++) {
+        secp256k1_fe_sqr(&t1[i], &t1[i]);
+        secp256k1_fe_sqr(&r[i], &t1[i]);
+
+        /* Check that a square root was actually calculated */
+        secp256k1_fe_sqr(&t1[i], &r[i]);
+        ret[i] = secp256k1_fe_equal_var(&t1[i], &a[i]);
     }
-    secp256k1_fe_mul(&t1, &t1, a);
-    for (j=0; j<3; j++) {
-        secp256k1_fe_sqr(&t1, &t1);
-    }
-    secp256k1_fe_mul(&t1, &t1, &x2);
-    for (j=0; j<2; j++) {
-        secp256k1_fe_sqr(&t1, &t1);
-    }
-    secp256k1_fe_mul(r, a, &t1);
 }
 
+/* The builtin secp256k1_fe_inv and secp256k1_fe_inv_var are provided by the field representation. */
+#if defined(USE_FIELD_INV_NUM)
 static void secp256k1_fe_inv_var(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
-#if defined(USE_FIELD_INV_BUILTIN)
-    secp256k1_fe_inv(r, a);
-#elif defined(USE_FIELD_INV_NUM)
     secp256k1_num_t n, m;
     /* secp256k1 field prime, value p defined in "Standards for Efficient Cryptography" (SEC2) 2.7.1. */
     static const unsigned char prime[32] = {
@@ -221,6 +183,7 @@ static void secp256k1_fe_inv_var(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
     };
     unsigned char b[32];
     secp256k1_fe_t c = *a;
+    SECP256K1_COUNT_OP(SECP256K1_OP_FE_INV_VAR, 1);
     secp256k1_fe_normalize_var(&c);
     secp256k1_fe_get_b32(b, &c);
     secp256k1_num_set_bin(&n, b, 32);
@@ -228,9 +191,78 @@ static void secp256k1_fe_inv_var(secp256k1_fe_t *r, const secp256k1_fe_t *a) {
     secp256k1_num_mod_inverse(&n, &n, &m);
     secp256k1_num_get_bin(b, 32, &n);
     VERIFY_CHECK(secp256k1_fe_set_b32(r, b));
-#else
+}
+#elif !defined(USE_FIELD_INV_BUILTIN)
 #error "Please select field inverse implementation"
 #endif
+
+/** Below this many inputs secp256k1_fe_inv_all_var uses a single chain of multiplications. */
+#define SECP256K1_FE_INV_ALL_X4_MIN 8
+
+/* The same as secp256k1_fe_inv_all_var, but on four quarters of the input side by side, so that every
+ * step consists of four independent multiplications for secp256k1_fe_mul_x4. */
+static void secp256k1_fe_inv_all_x4_var(size_t len, secp256k1_fe_t *r, const secp256k1_fe_t *a) {
+    secp256k1_fe_t u[4];
+    secp256k1_fe_t tot[4];
+    secp256k1_fe_t *rp[4];
+    const secp256k1_fe_t *ap[4];
+    const secp256k1_fe_t *bp[4];
+    size_t start[5];
+    size_t m;
+    size_t i;
+    int j;
+
+    /* Quarter j is [start[j], start[j + 1]) and has m or m + 1 elements. */
+    for (j = 0; j <= 4; j++) {
+        start[j] = (j * len) / 4;
+    }
+    m = len / 4;
+    VERIFY_CHECK(m >= 2);
+
+    for (j = 0; j < 4; j++) {
+        r[start[j]] = a[start[j]];
+    }
+    for (i = 1; i < m; i++) {
+        for (j = 0; j < 4; j++) {
+            rp[j] = &r[start[j] + i];
+            ap[j] = &r[start[j] + i - 1];
+            bp[j] = &a[start[j] + i];
+        }
+        secp256k1_fe_mul_x4(rp, ap, bp);
+    }
+    for (j = 0; j < 4; j++) {
+        if (start[j + 1] - start[j] > m) {
+            secp256k1_fe_mul(&r[start[j] + m], &r[start[j] + m - 1], &a[start[j] + m]);
+        }
+        tot[j] = r[start[j + 1] - 1];
+    }
+
+    secp256k1_fe_inv_all_var(4, u, tot);
+
+    for (j = 0; j < 4; j++) {
+        if (start[j + 1] - start[j] > m) {
+            i = start[j] + m;
+            secp256k1_fe_mul(&r[i], &r[i - 1], &u[j]);
+            secp256k1_fe_mul(&u[j], &u[j], &a[i]);
+        }
+    }
+    for (i = m - 1; i > 0; i--) {
+        for (j = 0; j < 4; j++) {
+            rp[j] = &r[start[j] + i];
+            ap[j] = &r[start[j] + i - 1];
+            bp[j] = &u[j];
+        }
+        secp256k1_fe_mul_x4(rp, ap, bp);
+        for (j = 0; j < 4; j++) {
+            rp[j] = &u[j];
+            ap[j] = &u[j];
+            bp[j] = &a[start[j] + i];
+        }
+        secp256k1_fe_mul_x4(rp, ap, bp);
+    }
+    for (j = 0; j < 4; j++) {
+        r[start[j]] = u[j];
+    }
 }
 
 static void secp256k1_fe_inv_all_var(size_t len, secp256k1_fe_t *r, const secp256k1_fe_t *a) {
@@ -242,6 +274,11 @@ static void secp256k1_fe_inv_all_var(size_t len, secp256k1_fe_t *r, const secp25
 
     VERIFY_CHECK((r + len <= a) || (a + len <= r));
 
+    if (len >= SECP256K1_FE_INV_ALL_X4_MIN) {
+        secp256k1_fe_inv_all_x4_var(len, r, a);
+        return;
+    }
+
     r[0] = a[0];
 
     i = 0;
@@ -0,0 +1,142 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille, Gregory Maxwell                  *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+/* Build-time generator for src/ecmult_static_context.h, which holds the precomputed tables of
+ * every context type so that --enable-ecmult-static-precomputation builds can use them from
+ * read-only memory instead of computing them in secp256k1_context_create. */
+
+#define USE_BASIC_CONFIG 1
+
+#include "basic-config.h"
+#include "include/secp256k1.h"
+#include "util.h"
+#include "num_impl.h"
+#include "field_impl.h"
+#include "scalar_impl.h"
+#include "group_impl.h"
+#include "ecmult_impl.h"
+#include "ecmult_gen_impl.h"
+#include "ecdh_impl.h"
+#include "eckey_impl.h"
+#include "borromean_impl.h"
+#include "rangeproof_impl.h"
+
+/** Largest WINDOW_G the tables are generated for, with and without the endomorphism. The
+ *  smaller tables of the other configuration are a prefix of these. */
+#ifdef ECMULT_WINDOW_SIZE
+#define GEN_CONTEXT_WINDOW_G ECMULT_WINDOW_SIZE
+#define GEN_CONTEXT_WINDOW_G_128 ECMULT_WINDOW_SIZE
+#else
+#define GEN_CONTEXT_WINDOW_G 16
+#define GEN_CONTEXT_WINDOW_G_128 15
+#endif
+
+static void print_ge_storage(FILE *fp, const secp256k1_ge_storage_t *p) {
+    secp256k1_ge_t ge;
+    unsigned char b[64];
+    int i;
+    secp256k1_ge_from_storage(&ge, p);
+    secp256k1_fe_normalize_var(&ge.x);
+    secp256k1_fe_normalize_var(&ge.y);
+    secp256k1_fe_get_b32(b, &ge.x);
+    secp256k1_fe_get_b32(b + 32, &ge.y);
+    fprintf(fp, "SC(");
+    for (i = 0; i < 16; i++) {
+        fprintf(fp, "%s%luul", i ? "," : "", (unsigned long)b[4 * i] << 24 | (unsigned long)b[4 * i + 1] << 16 |
+                (unsigned long)b[4 * i + 2] << 8 | (unsigned long)b[4 * i + 3]);
+    }
+    fprintf(fp, ")");
+}
+
+/** Print rows tables of cols entries each, as a two-dimensional array if rows > 0. */
+static void print_table(FILE *fp, const char *name, const secp256k1_ge_storage_t *table, int rows, int cols) {
+    int i, j;
+    if (rows > 0) {
+        fprintf(fp, "static const secp256k1_ge_storage_t %s[%i][%i] SECP256K1_TABLE_ALIGNED = {\n", name, rows, cols);
+    } else {
+        fprintf(fp, "static const secp256k1_ge_storage_t %s[%i] SECP256K1_TABLE_ALIGNED = {\n", name, cols);
+        rows = 1;
+    }
+    for (j = 0; j < rows; j++) {
+        if (rows > 1) {
+            fprintf(fp, "{\n");
+        }
+        for (i = 0; i < cols; i++) {
+            print_ge_storage(fp, &table[j * cols + i]);
+            fprintf(fp, i + 1 < cols ? ",\n" : "\n");
+        }
+        if (rows > 1) {
+            fprintf(fp, j + 1 < rows ? "},\n" : "}\n");
+        }
+    }
+    fprintf(fp, "};\n");
+}
+
+int main(int argc, char **argv) {
+    secp256k1_ecmult_gen_context_t gen_ctx;
+    secp256k1_ecmult_gen2_context_t gen2_ctx;
+    secp256k1_rangeproof_context_t rangeproof_ctx;
+    secp256k1_ge_storage_t *pre_g;
+    secp256k1_ge_storage_t *pre_g_128;
+    secp256k1_gej_t gj;
+    int i;
+    const char outfile[] = "src/ecmult_static_context.h";
+    FILE* fp;
+
+    (void)argc;
+    (void)argv;
+
+    fp = fopen(outfile, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open %s for writing!\n", outfile);
+        return -1;
+    }
+
+    fprintf(fp, "#ifndef _SECP256K1_ECMULT_STATIC_CONTEXT_\n");
+    fprintf(fp, "#define _SECP256K1_ECMULT_STATIC_CONTEXT_\n");
+    fprintf(fp, "#include \"group.h\"\n");
+    fprintf(fp, "#define SC SECP256K1_GE_STORAGE_CONST\n");
+    fprintf(fp, "#define ECMULT_STATIC_WINDOW_G %i\n", GEN_CONTEXT_WINDOW_G);
+    fprintf(fp, "#define ECMULT_STATIC_WINDOW_G_128 %i\n", GEN_CONTEXT_WINDOW_G_128);
+    fprintf(fp, "#define ECMULT_STATIC_COMB_BLOCKS %i\n", COMB_BLOCKS);
+    fprintf(fp, "#define ECMULT_STATIC_COMB_TEETH %i\n", COMB_TEETH);
+
+    secp256k1_ecmult_gen_context_init(&gen_ctx);
+    secp256k1_ecmult_gen_context_build(&gen_ctx, NULL);
+    print_table(fp, "secp256k1_ecmult_static_gen_context", &(*gen_ctx.prec)[0][0], COMB_BLOCKS, COMB_POINTS);
+    secp256k1_ecmult_gen_context_clear(&gen_ctx, NULL);
+
+    secp256k1_ecmult_gen2_context_init(&gen2_ctx);
+    secp256k1_ecmult_gen2_context_build(&gen2_ctx, NULL);
+    print_table(fp, "secp256k1_ecmult_static_gen2_context", &(*gen2_ctx.prec)[0][0], 16, 16);
+    print_table(fp, "secp256k1_ecmult_static_gen2_var_context", &(*gen2_ctx.prec_var)[0][0], 65, ECMULT_GEN2_VAR_POINTS);
+    secp256k1_ecmult_gen2_context_clear(&gen2_ctx, NULL);
+
+    secp256k1_rangeproof_context_init(&rangeproof_ctx);
+    secp256k1_rangeproof_context_build(&rangeproof_ctx, NULL);
+    print_table(fp, "secp256k1_rangeproof_static_context", &(*rangeproof_ctx.prec)[0], 0, 1005);
+    secp256k1_rangeproof_context_clear(&rangeproof_ctx, NULL);
+
+    /* The same odd multiples of G and 2^128*G as secp256k1_ecmult_context_build computes. */
+    secp256k1_gej_set_ge(&gj, &secp256k1_ge_const_g);
+    pre_g = (secp256k1_ge_storage_t *)checked_malloc(sizeof(secp256k1_ge_storage_t) * ECMULT_TABLE_SIZE(GEN_CONTEXT_WINDOW_G));
+    secp256k1_ecmult_odd_multiples_table_storage_var(ECMULT_TABLE_SIZE(GEN_CONTEXT_WINDOW_G), pre_g, &gj);
+    print_table(fp, "secp256k1_ecmult_static_pre_g", pre_g, 0, ECMULT_TABLE_SIZE(GEN_CONTEXT_WINDOW_G));
+    free(pre_g);
+    for (i = 0; i < 128; i++) {
+        secp256k1_gej_double_var(&gj, &gj, NULL);
+    }
+    pre_g_128 = (secp256k1_ge_storage_t *)checked_malloc(sizeof(secp256k1_ge_storage_t) * ECMULT_TABLE_SIZE(GEN_CONTEXT_WINDOW_G_128));
+    secp256k1_ecmult_odd_multiples_table_storage_var(ECMULT_TABLE_SIZE(GEN_CONTEXT_WINDOW_G_128), pre_g_128, &gj);
+    print_table(fp, "secp256k1_ecmult_static_pre_g_128", pre_g_128, 0, ECMULT_TABLE_SIZE(GEN_CONTEXT_WINDOW_G_128));
+    free(pre_g_128);
+
+    fprintf(fp, "#undef SC\n");
+    fprintf(fp, "#endif\n");
+    fclose(fp);
+
+    return 0;
+}
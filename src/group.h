@@ -48,6 +48,10 @@ static void secp256k1_ge_set_xy(secp256k1_ge_t *r, const secp256k1_fe_t *x, cons
  *  for Y. Return value indicates whether the result is valid. */
 static int secp256k1_ge_set_xo_var(secp256k1_ge_t *r, const secp256k1_fe_t *x, int odd);
 
+/** Four secp256k1_ge_set_xo_var at once: set r[i] from x[i] and odd[i], and ret[i] to whether r[i] is
+ *  valid, for i = 0..3. The square roots are computed side by side with secp256k1_fe_sqrt_x4_var. */
+static void secp256k1_ge_set_xo_x4_var(secp256k1_ge_t *r, int *ret, const secp256k1_fe_t *x, const int *odd);
+
 /** Check whether a group element is the point at infinity. */
 static int secp256k1_ge_is_infinity(const secp256k1_ge_t *a);
 
@@ -62,11 +66,20 @@ static void secp256k1_ge_set_gej(secp256k1_ge_t *r, secp256k1_gej_t *a);
 /** Set a batch of group elements equal to the inputs given in jacobian coordinates */
 static void secp256k1_ge_set_all_gej_var(size_t len, secp256k1_ge_t *r, const secp256k1_gej_t *a);
 
+/** Constant-time version of secp256k1_ge_set_all_gej_var, with a single secp256k1_fe_inv. None of the
+ *  inputs may be infinity. */
+static void secp256k1_ge_set_all_gej(size_t len, secp256k1_ge_t *r, const secp256k1_gej_t *a);
+
 /** Set a batch of group elements equal to the inputs given in jacobian
  *  coordinates (with known z-ratios). zr must contain the known z-ratios such
  *  that mul(a[i].z, zr[i+1]) == a[i+1].z. zr[0] is ignored. */
 static void secp256k1_ge_set_table_gej_var(size_t len, secp256k1_ge_t *r, const secp256k1_gej_t *a, const secp256k1_fe_t *zr);
 
+/** Like secp256k1_ge_set_table_gej_var, but for ntables consecutive tables of len entries each,
+ *  sharing a single field inversion between all of them. zr[t*len] is ignored for every table t.
+ *  work must have room for 2*ntables field elements. */
+static void secp256k1_ge_set_all_tables_gej_var(size_t ntables, size_t len, secp256k1_ge_t *r, const secp256k1_gej_t *a, const secp256k1_fe_t *zr, secp256k1_fe_t *work);
+
 /** Bring a batch inputs given in jacobian coordinates (with known z-ratios) to
  *  the same global z "denominator". zr must contain the known z-ratios such
  *  that mul(a[i].z, zr[i+1]) == a[i+1].z. zr[0] is ignored. The x and y
@@ -106,6 +119,11 @@ static void secp256k1_gej_add_ge(secp256k1_gej_t *r, const secp256k1_gej_t *a, c
     guarantee, and b is allowed to be infinity. If rzr is non-NULL, r->z = a->z * *rzr (a cannot be infinity in that case). */
 static void secp256k1_gej_add_ge_var(secp256k1_gej_t *r, const secp256k1_gej_t *a, const secp256k1_ge_t *b, secp256k1_fe_t *rzr);
 
+/** Set r equal to r plus the sum of the n affine points in a, which is overwritten. The points are
+ *  added pairwise in affine coordinates, in rounds that share a single field inversion, until few
+ *  enough are left to add to r one by one. work must have room for n field elements. */
+static void secp256k1_gej_add_all_ge_var(secp256k1_gej_t *r, secp256k1_ge_t *a, size_t n, secp256k1_fe_t *work);
+
 /** Set r equal to the sum of a and b (with the inverse of b's Z coordinate passed as bzinv). */
 static void secp256k1_gej_add_zinv_var(secp256k1_gej_t *r, const secp256k1_gej_t *a, const secp256k1_ge_t *b, const secp256k1_fe_t *bzinv);
 
@@ -129,7 +147,24 @@ static void secp256k1_ge_from_storage(secp256k1_ge_t *r, const secp256k1_ge_stor
 /** If flag is true, set *r equal to *a; otherwise leave it. Constant-time. */
 static void secp256k1_ge_storage_cmov(secp256k1_ge_storage_t *r, const secp256k1_ge_storage_t *a, int flag);
 
+/** Set *r equal to table[index], reading all n entries of the table. index must be in [0, n). Constant-time. */
+static void secp256k1_ge_storage_select(secp256k1_ge_storage_t *r, const secp256k1_ge_storage_t *table, int n, int index);
+
 /** Rescale a jacobian point by b which must be non-zero. Constant-time. */
 static void secp256k1_gej_rescale(secp256k1_gej_t *r, const secp256k1_fe_t *b);
 
+/* Co-Z formulas, for two jacobian points with the same Z coordinate, from Rivain, "Fast and Regular Algorithms
+ * for Scalar Multiplication over Elliptic Curves" (2011). Their results share a Z coordinate again, which is
+ * zero if (and only if) the inputs had equal x coordinates. The x and y coordinates of the inputs must have
+ * magnitude 1, as do those of the outputs. Constant-time. */
+
+/** Set r = 2*p and a = p, both with the Z coordinate of r. p must not be infinity. */
+static void secp256k1_gej_coz_double(secp256k1_gej_t *r, secp256k1_gej_t *a, const secp256k1_ge_t *p);
+
+/** Set b = a + b, and a to the same point on the new Z coordinate (XYCZ-ADD). */
+static void secp256k1_gej_coz_add(secp256k1_gej_t *a, secp256k1_gej_t *b);
+
+/** Set b = a + b and a = a - b (XYCZ-ADDC). */
+static void secp256k1_gej_coz_addc(secp256k1_gej_t *a, secp256k1_gej_t *b);
+
 #endif
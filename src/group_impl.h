@@ -13,6 +13,10 @@
 #include "field.h"
 #include "group.h"
 
+#if defined(USE_FIELD_10X26_NEON)
+#include <arm_neon.h>
+#endif
+
 /** Generator for secp256k1, value 'g' defined in
  *  "Standards for Efficient Cryptography" (SEC2) 2.7.1.
  */
@@ -99,28 +103,57 @@ static void secp256k1_ge_set_all_gej_var(size_t len, secp256k1_ge_t *r, const se
     secp256k1_fe_t *az;
     secp256k1_fe_t *azi;
     size_t i;
-    size_t count = 0;
+    if (len < 1) {
+        return;
+    }
+    /* Points at infinity take part in the batch inversion with a z coordinate of 1. */
     az = (secp256k1_fe_t *)checked_malloc(sizeof(secp256k1_fe_t) * len);
-    for (i = 0; i < len; i++) {
-        if (!a[i].infinity) {
-            az[count++] = a[i].z;
+    i = 0;
+    do {
+        if (a[i].infinity) {
+            secp256k1_fe_set_int(&az[i], 1);
+        } else {
+            az[i] = a[i].z;
         }
-    }
+    } while (++i < len);
 
-    azi = (secp256k1_fe_t *)checked_malloc(sizeof(secp256k1_fe_t) * count);
-    secp256k1_fe_inv_all_var(count, azi, az);
+    azi = (secp256k1_fe_t *)checked_malloc(sizeof(secp256k1_fe_t) * len);
+    secp256k1_fe_inv_all_var(len, azi, az);
     free(az);
 
-    count = 0;
     for (i = 0; i < len; i++) {
         r[i].infinity = a[i].infinity;
         if (!a[i].infinity) {
-            secp256k1_ge_set_gej_zinv(&r[i], &a[i], &azi[count++]);
+            secp256k1_ge_set_gej_zinv(&r[i], &a[i], &azi[i]);
         }
     }
     free(azi);
 }
 
+static void secp256k1_ge_set_all_gej(size_t len, secp256k1_ge_t *r, const secp256k1_gej_t *a) {
+    secp256k1_fe_t u, zi;
+    size_t i;
+    if (len < 1) {
+        return;
+    }
+    /* The x coordinates of r hold the running products of the z coordinates until they are set. */
+    r[0].x = a[0].z;
+    for (i = 1; i < len; i++) {
+        VERIFY_CHECK(!a[i].infinity);
+        secp256k1_fe_mul(&r[i].x, &r[i - 1].x, &a[i].z);
+    }
+    secp256k1_fe_inv(&u, &r[len - 1].x);
+    for (i = len - 1; i > 0; i--) {
+        secp256k1_fe_mul(&zi, &u, &r[i - 1].x);
+        secp256k1_fe_mul(&u, &u, &a[i].z);
+        secp256k1_ge_set_gej_zinv(&r[i], &a[i], &zi);
+    }
+    VERIFY_CHECK(!a[0].infinity);
+    secp256k1_ge_set_gej_zinv(&r[0], &a[0], &u);
+    secp256k1_fe_clear(&u);
+    secp256k1_fe_clear(&zi);
+}
+
 static void secp256k1_ge_set_table_gej_var(size_t len, secp256k1_ge_t *r, const secp256k1_gej_t *a, const secp256k1_fe_t *zr) {
     size_t i = len - 1;
     secp256k1_fe_t zi;
@@ -140,6 +173,33 @@ static void secp256k1_ge_set_table_gej_var(size_t len, secp256k1_ge_t *r, const
     }
 }
 
+static void secp256k1_ge_set_all_tables_gej_var(size_t ntables, size_t len, secp256k1_ge_t *r, const secp256k1_gej_t *a, const secp256k1_fe_t *zr, secp256k1_fe_t *work) {
+    secp256k1_fe_t *az = work;
+    secp256k1_fe_t *azi = work + ntables;
+    size_t t;
+
+    if (ntables < 1 || len < 1)
+        return;
+
+    /* Invert the last z coordinate of every table at once. */
+    for (t = 0; t < ntables; t++) {
+        az[t] = a[t * len + len - 1].z;
+    }
+    secp256k1_fe_inv_all_var(ntables, azi, az);
+
+    /* Within each table, work backwards using the z-ratios, as in secp256k1_ge_set_table_gej_var. */
+    for (t = 0; t < ntables; t++) {
+        size_t i = t * len + len - 1;
+        secp256k1_fe_t zi = azi[t];
+        secp256k1_ge_set_gej_zinv(&r[i], &a[i], &zi);
+        while (i > t * len) {
+            secp256k1_fe_mul(&zi, &zi, &zr[i]);
+            i--;
+            secp256k1_ge_set_gej_zinv(&r[i], &a[i], &zi);
+        }
+    }
+}
+
 static void secp256k1_ge_globalz_set_table_gej(size_t len, secp256k1_ge_t *r, secp256k1_fe_t *globalz, const secp256k1_gej_t *a, const secp256k1_fe_t *zr) {
     size_t i = len - 1;
     secp256k1_fe_t zs;
@@ -209,6 +269,28 @@ static int secp256k1_ge_set_xo_var(secp256k1_ge_t *r, const secp256k1_fe_t *x, i
     return 1;
 }
 
+static void secp256k1_ge_set_xo_x4_var(secp256k1_ge_t *r, int *ret, const secp256k1_fe_t *x, const int *odd) {
+    secp256k1_fe_t c[4], y[4];
+    int i;
+    for (i = 0; i < 4; i++) {
+        secp256k1_fe_t x2;
+        r[i].x = x[i];
+        r[i].infinity = 0;
+        secp256k1_fe_sqr(&x2, &x[i]);
+        secp256k1_fe_mul(&c[i], &x[i], &x2);
+        secp256k1_fe_set_int(&x2, 7);
+        secp256k1_fe_add(&c[i], &x2);
+    }
+    secp256k1_fe_sqrt_x4_var(y, ret, c);
+    for (i = 0; i < 4; i++) {
+        r[i].y = y[i];
+        secp256k1_fe_normalize_var(&r[i].y);
+        if (secp256k1_fe_is_odd(&r[i].y) != odd[i]) {
+            secp256k1_fe_negate(&r[i].y, &r[i].y, 1);
+        }
+    }
+}
+
 static void secp256k1_gej_set_ge(secp256k1_gej_t *r, const secp256k1_ge_t *a) {
    r->infinity = a->infinity;
    r->x = a->x;
@@ -274,6 +356,7 @@ static int secp256k1_ge_is_valid_var(const secp256k1_ge_t *a) {
 static void secp256k1_gej_double_var(secp256k1_gej_t *r, const secp256k1_gej_t *a, secp256k1_fe_t *rzr) {
     /* Operations: 3 mul, 4 sqr, 0 normalize, 12 mul_int/add/negate */
     secp256k1_fe_t t1,t2,t3,t4;
+    SECP256K1_COUNT_OP(SECP256K1_OP_GEJ_DOUBLE_VAR, 1);
     /** For secp256k1, 2Q is infinity if and only if Q is infinity. This is because if 2Q = infinity,
      *  Q must equal -Q, or that Q.y == -(Q.y), or Q.y is 0. For a point on y^2 = x^3 + 7 to have
      *  y=0, x^3 must be -7 mod p. However, -7 has no cube root mod p.
@@ -318,6 +401,7 @@ static void secp256k1_gej_add_var(secp256k1_gej_t *r, const secp256k1_gej_t *a,
     /* Operations: 12 mul, 4 sqr, 2 normalize, 12 mul_int/add/negate */
     secp256k1_fe_t z22, z12, u1, u2, s1, s2, h, i, i2, h2, h3, t;
 
+    SECP256K1_COUNT_OP(SECP256K1_OP_GEJ_ADD_VAR, 1);
     if (a->infinity) {
         VERIFY_CHECK(rzr == NULL);
         *r = *b;
@@ -370,6 +454,7 @@ static void secp256k1_gej_add_var(secp256k1_gej_t *r, const secp256k1_gej_t *a,
 static void secp256k1_gej_add_ge_var(secp256k1_gej_t *r, const secp256k1_gej_t *a, const secp256k1_ge_t *b, secp256k1_fe_t *rzr) {
     /* 8 mul, 3 sqr, 4 normalize, 12 mul_int/add/negate */
     secp256k1_fe_t z12, u1, u2, s1, s2, h, i, i2, h2, h3, t;
+    SECP256K1_COUNT_OP(SECP256K1_OP_GEJ_ADD_VAR, 1);
     if (a->infinity) {
         VERIFY_CHECK(rzr == NULL);
         secp256k1_gej_set_ge(r, b);
@@ -416,10 +501,83 @@ static void secp256k1_gej_add_ge_var(secp256k1_gej_t *r, const secp256k1_gej_t *
     secp256k1_fe_add(&r->y, &h3);
 }
 
+/** Below this many points a round of affine additions saves less than the inversion it costs. */
+#define SECP256K1_GEJ_ADD_ALL_MIN 32
+
+static void secp256k1_gej_add_all_ge_var(secp256k1_gej_t *r, secp256k1_ge_t *a, size_t n, secp256k1_fe_t *work) {
+    /* Per point halved away: 5 mul, 1 sqr, plus a share of one inversion */
+    secp256k1_fe_t *d = work;
+    secp256k1_fe_t *dinv = work + n / 2;
+    secp256k1_fe_t lambda, t;
+    secp256k1_ge_t p1, p2;
+    size_t i, m, k;
+
+    if (n >= SECP256K1_GEJ_ADD_ALL_MIN) {
+        for (i = 0; i < n; i++) {
+            secp256k1_fe_normalize_weak(&a[i].x);
+            secp256k1_fe_normalize_weak(&a[i].y);
+        }
+    }
+    while (n >= SECP256K1_GEJ_ADD_ALL_MIN) {
+        m = n / 2;
+        for (i = 0; i < m; i++) {
+            if (!a[2 * i].infinity && !a[2 * i + 1].infinity) {
+                secp256k1_fe_negate(&d[i], &a[2 * i].x, 1);
+                secp256k1_fe_add(&d[i], &a[2 * i + 1].x);
+                if (!secp256k1_fe_normalizes_to_zero_var(&d[i])) {
+                    continue;
+                }
+            }
+            /* Equal, opposite or infinite points have no affine sum formula; add them to r directly
+             * and drop the pair from this round. */
+            secp256k1_gej_add_ge_var(r, r, &a[2 * i], NULL);
+            secp256k1_gej_add_ge_var(r, r, &a[2 * i + 1], NULL);
+            a[2 * i].infinity = 1;
+            secp256k1_fe_set_int(&d[i], 1);
+        }
+        secp256k1_fe_inv_all_var(m, dinv, d);
+        k = 0;
+        for (i = 0; i < m; i++) {
+            if (a[2 * i].infinity) {
+                continue;
+            }
+            p1 = a[2 * i];
+            p2 = a[2 * i + 1];
+            /* lambda = (y2 - y1) / (x2 - x1); x3 = lambda^2 - x1 - x2; y3 = lambda * (x1 - x3) - y1 */
+            secp256k1_fe_negate(&lambda, &p1.y, 1);
+            secp256k1_fe_add(&lambda, &p2.y);
+            secp256k1_fe_mul(&lambda, &lambda, &dinv[i]);
+            secp256k1_fe_sqr(&a[k].x, &lambda);
+            secp256k1_fe_negate(&t, &p1.x, 1);
+            secp256k1_fe_add(&a[k].x, &t);
+            secp256k1_fe_negate(&t, &p2.x, 1);
+            secp256k1_fe_add(&a[k].x, &t);
+            secp256k1_fe_normalize_weak(&a[k].x);
+            secp256k1_fe_negate(&t, &a[k].x, 1);
+            secp256k1_fe_add(&t, &p1.x);
+            secp256k1_fe_mul(&a[k].y, &lambda, &t);
+            secp256k1_fe_negate(&t, &p1.y, 1);
+            secp256k1_fe_add(&a[k].y, &t);
+            secp256k1_fe_normalize_weak(&a[k].y);
+            a[k].infinity = 0;
+            k++;
+        }
+        SECP256K1_COUNT_OP(SECP256K1_OP_GEJ_ADD_VAR, k);
+        if (n & 1) {
+            a[k++] = a[n - 1];
+        }
+        n = k;
+    }
+    for (i = 0; i < n; i++) {
+        secp256k1_gej_add_ge_var(r, r, &a[i], NULL);
+    }
+}
+
 static void secp256k1_gej_add_zinv_var(secp256k1_gej_t *r, const secp256k1_gej_t *a, const secp256k1_ge_t *b, const secp256k1_fe_t *bzinv) {
     /* 9 mul, 3 sqr, 4 normalize, 12 mul_int/add/negate */
     secp256k1_fe_t az, z12, u1, u2, s1, s2, h, i, i2, h2, h3, t;
 
+    SECP256K1_COUNT_OP(SECP256K1_OP_GEJ_ADD_VAR, 1);
     if (b->infinity) {
         *r = *a;
         return;
@@ -474,10 +632,11 @@ static void secp256k1_gej_add_zinv_var(secp256k1_gej_t *r, const secp256k1_gej_t
 
 
 static void secp256k1_gej_add_ge(secp256k1_gej_t *r, const secp256k1_gej_t *a, const secp256k1_ge_t *b) {
-    /* Operations: 7 mul, 5 sqr, 5 normalize, 17 mul_int/add/negate/cmov */
+    /* Operations: 7 mul, 5 sqr, 4 normalize, 21 mul_int/add/negate/cmov */
     static const secp256k1_fe_t fe_1 = SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 1);
-    secp256k1_fe_t zz, u1, u2, s1, s2, z, t, m, n, q, rr;
-    int infinity;
+    secp256k1_fe_t zz, u1, u2, s1, s2, z, t, tt, m, n, q, rr;
+    secp256k1_fe_t m_alt, rr_alt;
+    int infinity, degenerate;
     VERIFY_CHECK(!b->infinity);
     VERIFY_CHECK(a->infinity == 0 || a->infinity == 1);
 
@@ -512,29 +671,53 @@ static void secp256k1_gej_add_ge(secp256k1_gej_t *r, const secp256k1_gej_t *a, c
     z = a->z;                                           /* z = Z = Z1*Z2 (8) */
     t = u1; secp256k1_fe_add(&t, &u2);                  /* t = T = U1+U2 (2) */
     m = s1; secp256k1_fe_add(&m, &s2);                  /* m = M = S1+S2 (2) */
-    secp256k1_fe_sqr(&n, &m);                           /* n = M^2 (1) */
-    secp256k1_fe_mul(&q, &n, &t);                       /* q = Q = T*M^2 (1) */
-    secp256k1_fe_sqr(&n, &n);                           /* n = M^4 (1) */
     secp256k1_fe_sqr(&rr, &t);                          /* rr = T^2 (1) */
-    secp256k1_fe_mul(&t, &u1, &u2); secp256k1_fe_negate(&t, &t, 1); /* t = -U1*U2 (2) */
-    secp256k1_fe_add(&rr, &t);                                      /* rr = R = T^2-U1*U2 (3) */
-    secp256k1_fe_sqr(&t, &rr);                                      /* t = R^2 (1) */
-    secp256k1_fe_mul(&r->z, &m, &z);                                /* r->z = M*Z (1) */
+    secp256k1_fe_negate(&m_alt, &u2, 1);                /* Malt = -X2*Z1^2 (2) */
+    secp256k1_fe_mul(&tt, &u1, &m_alt);                 /* tt = -U1*U2 (1) */
+    secp256k1_fe_add(&rr, &tt);                         /* rr = R = T^2-U1*U2 (2) */
+    /** If lambda = R/M = 0/0 we have a problem (except in the "trivial"
+     *  case that Z = z1z2 = 0, and this is special-cased later on). */
+    degenerate = secp256k1_fe_normalizes_to_zero(&m) &
+                 secp256k1_fe_normalizes_to_zero(&rr);
+    /* This only occurs when y1 == -y2 and x1^3 == x2^3, but x1 != x2.
+     * This means either x1 == beta*x2 or beta*x1 == x2, where beta is
+     * a nontrivial cube root of one. In either case, an alternate
+     * non-indeterminate expression for lambda is (y1 - y2)/(x1 - x2),
+     * so we set R/M equal to this. */
+    rr_alt = s1;
+    secp256k1_fe_mul_int(&rr_alt, 2);                   /* rr_alt = Y1*Z2^3 - Y2*Z1^3 (2) */
+    secp256k1_fe_add(&m_alt, &u1);                      /* Malt = X1*Z2^2 - X2*Z1^2 (3) */
+
+    secp256k1_fe_cmov(&rr_alt, &rr, !degenerate);
+    secp256k1_fe_cmov(&m_alt, &m, !degenerate);
+    /* Now Ralt / Malt = lambda and is guaranteed not to be 0/0.
+     * From here on out Ralt and Malt represent the numerator
+     * and denominator of lambda; R and M represent the explicit
+     * expressions x1^2 + x2^2 + x1x2 and y1 + y2. */
+    secp256k1_fe_sqr(&n, &m_alt);                       /* n = Malt^2 (1) */
+    secp256k1_fe_mul(&q, &n, &t);                       /* q = Q = T*Malt^2 (1) */
+    /* These two lines use the observation that either M == Malt or M == 0,
+     * so M^3 * Malt is either Malt^4 (which is computed by squaring), or
+     * zero (which is "computed" by cmov). So the cost is one squaring
+     * versus two multiplications. */
+    secp256k1_fe_sqr(&n, &n);
+    secp256k1_fe_cmov(&n, &m, degenerate);              /* n = M^3 * Malt (2) */
+    secp256k1_fe_sqr(&t, &rr_alt);                      /* t = Ralt^2 (1) */
+    secp256k1_fe_mul(&r->z, &m_alt, &z);                /* r->z = Malt*Z (1) */
     infinity = secp256k1_fe_normalizes_to_zero(&r->z) * (1 - a->infinity);
-    secp256k1_fe_mul_int(&r->z, 2 * (1 - a->infinity)); /* r->z = Z3 = 2*M*Z (2) */
-    r->x = t;                                           /* r->x = R^2 (1) */
+    secp256k1_fe_mul_int(&r->z, 2 * (1 - a->infinity)); /* r->z = Z3 = 2*Malt*Z (2) */
     secp256k1_fe_negate(&q, &q, 1);                     /* q = -Q (2) */
-    secp256k1_fe_add(&r->x, &q);                        /* r->x = R^2-Q (3) */
-    secp256k1_fe_normalize(&r->x);
-    secp256k1_fe_mul_int(&q, 3);                        /* q = -3*Q (6) */
-    secp256k1_fe_mul_int(&t, 2);                        /* t = 2*R^2 (2) */
-    secp256k1_fe_add(&t, &q);                           /* t = 2*R^2-3*Q (8) */
-    secp256k1_fe_mul(&t, &t, &rr);                      /* t = R*(2*R^2-3*Q) (1) */
-    secp256k1_fe_add(&t, &n);                           /* t = R*(2*R^2-3*Q)+M^4 (2) */
-    secp256k1_fe_negate(&r->y, &t, 2);                  /* r->y = R*(3*Q-2*R^2)-M^4 (3) */
+    secp256k1_fe_add(&t, &q);                           /* t = Ralt^2-Q (3) */
+    secp256k1_fe_normalize_weak(&t);
+    r->x = t;                                           /* r->x = Ralt^2-Q (1) */
+    secp256k1_fe_mul_int(&t, 2);                        /* t = 2*x3 (2) */
+    secp256k1_fe_add(&t, &q);                           /* t = 2*x3 - Q: (4) */
+    secp256k1_fe_mul(&t, &t, &rr_alt);                  /* t = Ralt*(2*x3 - Q) (1) */
+    secp256k1_fe_add(&t, &n);                           /* t = Ralt*(2*x3 - Q) + M^3*Malt (3) */
+    secp256k1_fe_negate(&r->y, &t, 3);                  /* r->y = Ralt*(Q - 2x3) - M^3*Malt (4) */
     secp256k1_fe_normalize_weak(&r->y);
-    secp256k1_fe_mul_int(&r->x, 4 * (1 - a->infinity)); /* r->x = X3 = 4*(R^2-Q) */
-    secp256k1_fe_mul_int(&r->y, 4 * (1 - a->infinity)); /* r->y = Y3 = 4*R*(3*Q-2*R^2)-4*M^4 (4) */
+    secp256k1_fe_mul_int(&r->x, 4 * (1 - a->infinity)); /* r->x = X3 = 4*(Ralt^2-Q) */
+    secp256k1_fe_mul_int(&r->y, 4 * (1 - a->infinity)); /* r->y = Y3 = 4*Ralt*(Q - 2x3) - 4*M^3*Malt (4) */
 
     /** In case a->infinity == 1, the above code results in r->x, r->y, and r->z all equal to 0.
      *  Replace r with b->x, b->y, 1 in that case.
@@ -556,6 +739,87 @@ static void secp256k1_gej_rescale(secp256k1_gej_t *r, const secp256k1_fe_t *s) {
     secp256k1_fe_mul(&r->z, &r->z, s);                  /* r->z *= s   */
 }
 
+static void secp256k1_gej_coz_double(secp256k1_gej_t *r, secp256k1_gej_t *a, const secp256k1_ge_t *p) {
+    VERIFY_CHECK(!p->infinity);
+    secp256k1_gej_set_ge(a, p);
+    secp256k1_gej_double_var(r, a, NULL);
+    secp256k1_fe_normalize_weak(&r->x);
+    secp256k1_fe_normalize_weak(&r->y);
+    secp256k1_fe_normalize(&r->z);
+    secp256k1_gej_rescale(a, &r->z);
+}
+
+static void secp256k1_gej_coz_add(secp256k1_gej_t *a, secp256k1_gej_t *b) {
+    /* Operations: 5 mul, 2 sqr */
+    secp256k1_fe_t t, w, u1, u2, d, e;
+    secp256k1_fe_negate(&t, &a->x, 1);
+    secp256k1_fe_add(&t, &b->x);              /* T = X2-X1 (3) */
+    secp256k1_fe_mul(&b->z, &a->z, &t);       /* Z3 = Z*(X2-X1) (1) */
+    secp256k1_fe_sqr(&w, &t);                 /* W = (X2-X1)^2 (1) */
+    secp256k1_fe_mul(&u1, &a->x, &w);         /* U1 = X1*W (1) */
+    secp256k1_fe_mul(&u2, &b->x, &w);         /* U2 = X2*W (1) */
+    secp256k1_fe_negate(&d, &a->y, 1);
+    secp256k1_fe_add(&d, &b->y);              /* D = Y2-Y1 (3) */
+    secp256k1_fe_negate(&e, &u1, 1);
+    secp256k1_fe_add(&e, &u2);                /* E = U2-U1 = (X2-X1)^3 (3) */
+    secp256k1_fe_mul(&e, &e, &a->y);          /* E = Y1*(X2-X1)^3 (1) */
+    secp256k1_fe_sqr(&b->x, &d);              /* X3 = D^2 (1) */
+    secp256k1_fe_negate(&t, &u2, 1);
+    secp256k1_fe_add(&b->x, &t);              /* X3 = D^2-U2 (3) */
+    secp256k1_fe_negate(&t, &u1, 1);
+    secp256k1_fe_add(&b->x, &t);              /* X3 = D^2-U1-U2 (5) */
+    secp256k1_fe_negate(&t, &b->x, 5);
+    secp256k1_fe_add(&t, &u1);                /* T = U1-X3 (7) */
+    secp256k1_fe_mul(&b->y, &d, &t);          /* Y3 = D*(U1-X3) (1) */
+    secp256k1_fe_negate(&t, &e, 1);
+    secp256k1_fe_add(&b->y, &t);              /* Y3 = D*(U1-X3)-E (3) */
+    secp256k1_fe_normalize_weak(&b->x);
+    secp256k1_fe_normalize_weak(&b->y);
+    a->x = u1;
+    a->y = e;
+    a->z = b->z;
+}
+
+static void secp256k1_gej_coz_addc(secp256k1_gej_t *a, secp256k1_gej_t *b) {
+    /* Operations: 6 mul, 3 sqr */
+    secp256k1_fe_t t, w, u1, u2, d, f, e;
+    secp256k1_fe_negate(&t, &a->x, 1);
+    secp256k1_fe_add(&t, &b->x);              /* T = X2-X1 (3) */
+    secp256k1_fe_mul(&b->z, &a->z, &t);       /* Z3 = Z*(X2-X1) (1) */
+    secp256k1_fe_sqr(&w, &t);                 /* W = (X2-X1)^2 (1) */
+    secp256k1_fe_mul(&u1, &a->x, &w);         /* U1 = X1*W (1) */
+    secp256k1_fe_mul(&u2, &b->x, &w);         /* U2 = X2*W (1) */
+    secp256k1_fe_negate(&d, &a->y, 1);
+    secp256k1_fe_add(&d, &b->y);              /* D = Y2-Y1 (3) */
+    f = a->y;
+    secp256k1_fe_add(&f, &b->y);              /* F = Y1+Y2 (2) */
+    secp256k1_fe_negate(&e, &u1, 1);
+    secp256k1_fe_add(&e, &u2);                /* E = U2-U1 = (X2-X1)^3 (3) */
+    secp256k1_fe_mul(&e, &e, &a->y);          /* E = Y1*(X2-X1)^3 (1) */
+    secp256k1_fe_negate(&u2, &u2, 1);
+    secp256k1_fe_negate(&t, &u1, 1);
+    secp256k1_fe_add(&u2, &t);                /* U2 = -U1-U2 (4) */
+    /* The sum uses the slope D, the difference (with -Y2 in place of Y2) the slope -F. */
+    secp256k1_fe_sqr(&b->x, &d);
+    secp256k1_fe_add(&b->x, &u2);             /* X3 = D^2-U1-U2 (5) */
+    secp256k1_fe_negate(&t, &b->x, 5);
+    secp256k1_fe_add(&t, &u1);                /* T = U1-X3 (7) */
+    secp256k1_fe_mul(&b->y, &d, &t);          /* Y3 = D*(U1-X3) (1) */
+    secp256k1_fe_sqr(&a->x, &f);
+    secp256k1_fe_add(&a->x, &u2);             /* X4 = F^2-U1-U2 (5) */
+    secp256k1_fe_negate(&t, &u1, 1);
+    secp256k1_fe_add(&t, &a->x);              /* T = X4-U1 (7) */
+    secp256k1_fe_mul(&a->y, &f, &t);          /* Y4 = F*(X4-U1) (1) */
+    secp256k1_fe_negate(&t, &e, 1);
+    secp256k1_fe_add(&b->y, &t);              /* Y3 = D*(U1-X3)-E (3) */
+    secp256k1_fe_add(&a->y, &t);              /* Y4 = F*(X4-U1)-E (3) */
+    secp256k1_fe_normalize_weak(&b->x);
+    secp256k1_fe_normalize_weak(&b->y);
+    secp256k1_fe_normalize_weak(&a->x);
+    secp256k1_fe_normalize_weak(&a->y);
+    a->z = b->z;
+}
+
 static void secp256k1_ge_to_storage(secp256k1_ge_storage_t *r, const secp256k1_ge_t *a) {
     secp256k1_fe_t x, y;
     VERIFY_CHECK(!a->infinity);
@@ -578,6 +842,34 @@ static SECP256K1_INLINE void secp256k1_ge_storage_cmov(secp256k1_ge_storage_t *r
     secp256k1_fe_storage_cmov(&r->y, &a->y, flag);
 }
 
+static void secp256k1_ge_storage_select(secp256k1_ge_storage_t *r, const secp256k1_ge_storage_t *table, int n, int index) {
+#if defined(USE_FIELD_10X26_NEON)
+    /* Keep the selected entry in four registers instead of loading and storing *r for every entry, and
+     * derive the masks with vector compares of a running counter against index. */
+    uint32x4_t x0, x1, y0, y1, mask, count;
+    const uint32x4_t want = vdupq_n_u32(index), one = vdupq_n_u32(1);
+    int i;
+    x0 = x1 = y0 = y1 = count = vdupq_n_u32(0);
+    for (i = 0; i < n; i++) {
+        mask = vceqq_u32(count, want);
+        x0 = vbslq_u32(mask, vld1q_u32(table[i].x.n), x0);
+        x1 = vbslq_u32(mask, vld1q_u32(table[i].x.n + 4), x1);
+        y0 = vbslq_u32(mask, vld1q_u32(table[i].y.n), y0);
+        y1 = vbslq_u32(mask, vld1q_u32(table[i].y.n + 4), y1);
+        count = vaddq_u32(count, one);
+    }
+    vst1q_u32(r->x.n, x0);
+    vst1q_u32(r->x.n + 4, x1);
+    vst1q_u32(r->y.n, y0);
+    vst1q_u32(r->y.n + 4, y1);
+#else
+    int i;
+    for (i = 0; i < n; i++) {
+        secp256k1_ge_storage_cmov(r, &table[i], i == index);
+    }
+#endif
+}
+
 #ifdef USE_ENDOMORPHISM
 static void secp256k1_ge_mul_lambda(secp256k1_ge_t *r, const secp256k1_ge_t *a) {
     static const secp256k1_fe_t beta = SECP256K1_FE_CONST(
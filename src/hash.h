@@ -20,10 +20,40 @@ static void secp256k1_sha256_initialize(secp256k1_sha256_t *hash);
 static void secp256k1_sha256_write(secp256k1_sha256_t *hash, const unsigned char *data, size_t size);
 static void secp256k1_sha256_finalize(secp256k1_sha256_t *hash, unsigned char *out32);
 
+/** The chaining state of a SHA-256 computation that has absorbed a whole number of 64-byte blocks,
+ *  so a common prefix can be hashed once and resumed from many times. */
+typedef struct {
+    uint32_t s[8];
+    size_t bytes;
+} secp256k1_sha256_midstate_t;
+
+/** Save the state of hash, which must have been fed a multiple of 64 bytes. */
+static void secp256k1_sha256_save(const secp256k1_sha256_t *hash, secp256k1_sha256_midstate_t *mid);
+/** Initialize hash to continue from a saved midstate. */
+static void secp256k1_sha256_restore(secp256k1_sha256_t *hash, const secp256k1_sha256_midstate_t *mid);
+
+/** Initialize hash as SHA256(SHA256(tag) || SHA256(tag) || ...). The two tag digests fill exactly
+ *  one block, so callers with a fixed tag can save the result once and restore it per message. */
+static void secp256k1_sha256_initialize_tagged(secp256k1_sha256_t *hash, const unsigned char *tag, size_t taglen);
+
+/** Four-way versions of secp256k1_sha256_write and secp256k1_sha256_finalize, for hash[0..3] that have
+ *  all been fed the same number of bytes: data[i] (len bytes) is appended to hash[i], and the digest of
+ *  hash[i] is written to out32 + 32 * i. With SSE2 the four compressions are computed side by side. */
+static void secp256k1_sha256_write_x4(secp256k1_sha256_t *hash, const unsigned char * const *data, size_t len);
+static void secp256k1_sha256_finalize_x4(secp256k1_sha256_t *hash, unsigned char *out32);
+
 typedef struct {
     secp256k1_sha256_t inner, outer;
 } secp256k1_hmac_sha256_t;
 
+/** The inner and outer pad states of an HMAC key; computing them costs two compressions, after
+ *  which any number of HMACs under that key can start from them for free. */
+typedef struct {
+    secp256k1_sha256_midstate_t inner, outer;
+} secp256k1_hmac_sha256_pads_t;
+
+static void secp256k1_hmac_sha256_pads(secp256k1_hmac_sha256_pads_t *pads, const unsigned char *key, size_t size);
+static void secp256k1_hmac_sha256_initialize_pads(secp256k1_hmac_sha256_t *hash, const secp256k1_hmac_sha256_pads_t *pads);
 static void secp256k1_hmac_sha256_initialize(secp256k1_hmac_sha256_t *hash, const unsigned char *key, size_t size);
 static void secp256k1_hmac_sha256_write(secp256k1_hmac_sha256_t *hash, const unsigned char *data, size_t size);
 static void secp256k1_hmac_sha256_finalize(secp256k1_hmac_sha256_t *hash, unsigned char *out32);
@@ -31,10 +61,17 @@ static void secp256k1_hmac_sha256_finalize(secp256k1_hmac_sha256_t *hash, unsign
 typedef struct {
     unsigned char v[32];
     unsigned char k[32];
+    secp256k1_hmac_sha256_pads_t kpads; /* The pad states for k. */
     int retry;
 } secp256k1_rfc6979_hmac_sha256_t;
 
 static void secp256k1_rfc6979_hmac_sha256_initialize(secp256k1_rfc6979_hmac_sha256_t *rng, const unsigned char *key, size_t keylen, const unsigned char *msg, size_t msglen, const unsigned char *rnd, size_t rndlen);
+/** Compute the state of the inner hash of RFC6979 step 3.2.d after its first 128 bytes, the pad of the
+ *  zero key and V || 0x00 || key[0..30], which only depend on the key (at least 31 bytes long). */
+static void secp256k1_rfc6979_hmac_sha256_key_midstate(secp256k1_sha256_midstate_t *mid, const unsigned char *key, size_t keylen);
+/** Same as secp256k1_rfc6979_hmac_sha256_initialize, but resume step 3.2.d from the result of
+ *  secp256k1_rfc6979_hmac_sha256_key_midstate for key, saving one compression per nonce. */
+static void secp256k1_rfc6979_hmac_sha256_initialize_midstate(secp256k1_rfc6979_hmac_sha256_t *rng, const secp256k1_sha256_midstate_t *keymid, const unsigned char *key, size_t keylen, const unsigned char *msg, size_t msglen, const unsigned char *rnd, size_t rndlen);
 static void secp256k1_rfc6979_hmac_sha256_generate(secp256k1_rfc6979_hmac_sha256_t *rng, unsigned char *out, size_t outlen);
 static void secp256k1_rfc6979_hmac_sha256_finalize(secp256k1_rfc6979_hmac_sha256_t *rng);
 
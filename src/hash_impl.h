@@ -13,6 +13,22 @@
 #include <stdint.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(HAVE_SHA256_SHANI)
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+#if defined(HAVE_SHA256_ARMV8) && !defined(WORDS_BIGENDIAN)
+#define SECP256K1_SHA256_ARMV8 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
 #define Ch(x,y,z) ((z) ^ ((x) & ((y) ^ (z))))
 #define Maj(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
 #define Sigma0(x) (((x) >> 2 | (x) << 30) ^ ((x) >> 13 | (x) << 19) ^ ((x) >> 22 | (x) << 10))
@@ -46,7 +62,7 @@ static void secp256k1_sha256_initialize(secp256k1_sha256_t *hash) {
 }
 
 /** Perform one SHA-256 transformation, processing 16 big endian 32-bit words. */
-static void secp256k1_sha256_transform(uint32_t* s, const uint32_t* chunk) {
+static void secp256k1_sha256_transform_portable(uint32_t* s, const uint32_t* chunk) {
     uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
     uint32_t w0, w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14, w15;
 
@@ -128,6 +144,214 @@ static void secp256k1_sha256_transform(uint32_t* s, const uint32_t* chunk) {
     s[7] += h;
 }
 
+#if defined(__SSE2__) || defined(HAVE_SHA256_SHANI) || defined(SECP256K1_SHA256_ARMV8)
+static const uint32_t secp256k1_sha256_k[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+#endif
+
+#if defined(HAVE_SHA256_SHANI)
+/** SHA-256 transformation using the x86 SHA extensions. The state is kept in the ABEF/CDGH word
+ *  order the instructions expect; each loop iteration does four rounds and extends the schedule. */
+__attribute__((target("sha,sse4.1")))
+static void secp256k1_sha256_transform_shani(uint32_t* s, const uint32_t* chunk) {
+    const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i m[4], st0, st1, save0, save1, msg, t1, t2;
+    int i;
+
+    t1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1);
+    t2 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B);
+    st0 = _mm_alignr_epi8(t1, t2, 8);
+    st1 = _mm_blend_epi16(t2, t1, 0xF0);
+    save0 = st0;
+    save1 = st1;
+    for (i = 0; i < 4; i++) {
+        m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 4 * i)), mask);
+    }
+    for (i = 0; i < 16; i++) {
+        msg = _mm_add_epi32(m[i & 3], _mm_loadu_si128((const __m128i*)(secp256k1_sha256_k + 4 * i)));
+        st1 = _mm_sha256rnds2_epu32(st1, st0, msg);
+        st0 = _mm_sha256rnds2_epu32(st0, st1, _mm_shuffle_epi32(msg, 0x0E));
+        if (i < 12) {
+            m[i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]), _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4)), m[(i + 3) & 3]);
+        }
+    }
+    st0 = _mm_add_epi32(st0, save0);
+    st1 = _mm_add_epi32(st1, save1);
+    t1 = _mm_shuffle_epi32(st0, 0x1B);
+    t2 = _mm_shuffle_epi32(st1, 0xB1);
+    _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(t1, t2, 0xF0));
+    _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(t2, t1, 8));
+}
+
+static int secp256k1_sha256_shani_available(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, NULL) < 7) {
+        return 0;
+    }
+    /* SSE4.1 (which implies SSSE3) for the shuffles, and the SHA extensions themselves. */
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!((ecx >> 19) & 1)) {
+        return 0;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 29) & 1;
+}
+#endif
+
+#if defined(SECP256K1_SHA256_ARMV8)
+/** SHA-256 transformation using the ARMv8 cryptography extensions, four rounds per iteration. */
+__attribute__((target("+crypto")))
+static void secp256k1_sha256_transform_armv8(uint32_t* s, const uint32_t* chunk) {
+    uint32x4_t m[4], st0, st1, save0, save1, msg, tmp;
+    int i;
+
+    st0 = vld1q_u32(s);
+    st1 = vld1q_u32(s + 4);
+    save0 = st0;
+    save1 = st1;
+    for (i = 0; i < 4; i++) {
+        m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8((const uint8_t*)(chunk + 4 * i))));
+    }
+    for (i = 0; i < 16; i++) {
+        msg = vaddq_u32(m[i & 3], vld1q_u32(secp256k1_sha256_k + 4 * i));
+        if (i < 12) {
+            m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]), m[(i + 2) & 3], m[(i + 3) & 3]);
+        }
+        tmp = st0;
+        st0 = vsha256hq_u32(st0, st1, msg);
+        st1 = vsha256h2q_u32(st1, tmp, msg);
+    }
+    vst1q_u32(s, vaddq_u32(st0, save0));
+    vst1q_u32(s + 4, vaddq_u32(st1, save1));
+}
+
+static int secp256k1_sha256_armv8_available(void) {
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+#endif
+
+static void secp256k1_sha256_transform_select(uint32_t* s, const uint32_t* chunk);
+
+/** The transformation in use. It starts out as the selector below, which replaces itself with the
+ *  best implementation the CPU supports on first use. Concurrent first calls all store the same
+ *  value, so no locking is needed. */
+static void (*secp256k1_sha256_transform_impl)(uint32_t* s, const uint32_t* chunk) = secp256k1_sha256_transform_select;
+
+static void secp256k1_sha256_transform_select(uint32_t* s, const uint32_t* chunk) {
+    void (*impl)(uint32_t* s, const uint32_t* chunk) = secp256k1_sha256_transform_portable;
+#if defined(HAVE_SHA256_SHANI)
+    if (secp256k1_sha256_shani_available()) {
+        impl = secp256k1_sha256_transform_shani;
+    }
+#endif
+#if defined(SECP256K1_SHA256_ARMV8)
+    if (secp256k1_sha256_armv8_available()) {
+        impl = secp256k1_sha256_transform_armv8;
+    }
+#endif
+    secp256k1_sha256_transform_impl = impl;
+    impl(s, chunk);
+}
+
+static SECP256K1_INLINE void secp256k1_sha256_transform(uint32_t* s, const uint32_t* chunk) {
+    secp256k1_sha256_transform_impl(s, chunk);
+}
+
+#if defined(__SSE2__)
+
+#define X4_ADD(x, y) _mm_add_epi32((x), (y))
+#define X4_ROR(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+#define X4_SIGMA0(x) _mm_xor_si128(_mm_xor_si128(X4_ROR((x), 2), X4_ROR((x), 13)), X4_ROR((x), 22))
+#define X4_SIGMA1(x) _mm_xor_si128(_mm_xor_si128(X4_ROR((x), 6), X4_ROR((x), 11)), X4_ROR((x), 25))
+#define X4_sigma0(x) _mm_xor_si128(_mm_xor_si128(X4_ROR((x), 7), X4_ROR((x), 18)), _mm_srli_epi32((x), 3))
+#define X4_sigma1(x) _mm_xor_si128(_mm_xor_si128(X4_ROR((x), 17), X4_ROR((x), 19)), _mm_srli_epi32((x), 10))
+#define X4_CH(x, y, z) _mm_xor_si128((z), _mm_and_si128((x), _mm_xor_si128((y), (z))))
+#define X4_MAJ(x, y, z) _mm_or_si128(_mm_and_si128((x), (y)), _mm_and_si128((z), _mm_or_si128((x), (y))))
+#define X4_ROUND(a, b, c, d, e, f, g, h, r) do { \
+    __m128i t1, t2; \
+    if ((r) >= 16) { \
+        w[(r) & 15] = X4_ADD(w[(r) & 15], X4_ADD(X4_sigma1(w[((r) - 2) & 15]), X4_ADD(w[((r) - 7) & 15], X4_sigma0(w[((r) - 15) & 15])))); \
+    } \
+    t1 = X4_ADD(X4_ADD((h), X4_SIGMA1(e)), X4_ADD(X4_CH((e), (f), (g)), X4_ADD(_mm_set1_epi32(secp256k1_sha256_k[r]), w[(r) & 15]))); \
+    t2 = X4_ADD(X4_SIGMA0(a), X4_MAJ((a), (b), (c))); \
+    (d) = X4_ADD((d), t1); \
+    (h) = X4_ADD(t1, t2); \
+} while(0)
+
+/** Perform one SHA-256 transformation on each of the four hashes, one per 32-bit lane of an SSE2 register. */
+static void secp256k1_sha256_transform_x4(secp256k1_sha256_t *hash) {
+    __m128i st[8], w[16];
+    __m128i a, b, c, d, e, f, g, h;
+    uint32_t out[4];
+    int i, r;
+
+    if (secp256k1_sha256_transform_impl != secp256k1_sha256_transform_portable) {
+        /* A hardware transformation (or the selector, which will pick one) beats four SSE2 lanes. */
+        for (i = 0; i < 4; i++) {
+            secp256k1_sha256_transform(hash[i].s, hash[i].buf);
+        }
+        return;
+    }
+    for (i = 0; i < 8; i++) {
+        st[i] = _mm_set_epi32(hash[3].s[i], hash[2].s[i], hash[1].s[i], hash[0].s[i]);
+    }
+    for (i = 0; i < 16; i++) {
+        w[i] = _mm_set_epi32(BE32(hash[3].buf[i]), BE32(hash[2].buf[i]), BE32(hash[1].buf[i]), BE32(hash[0].buf[i]));
+    }
+    a = st[0]; b = st[1]; c = st[2]; d = st[3]; e = st[4]; f = st[5]; g = st[6]; h = st[7];
+    for (r = 0; r < 64; r += 8) {
+        X4_ROUND(a, b, c, d, e, f, g, h, r);
+        X4_ROUND(h, a, b, c, d, e, f, g, r + 1);
+        X4_ROUND(g, h, a, b, c, d, e, f, r + 2);
+        X4_ROUND(f, g, h, a, b, c, d, e, r + 3);
+        X4_ROUND(e, f, g, h, a, b, c, d, r + 4);
+        X4_ROUND(d, e, f, g, h, a, b, c, r + 5);
+        X4_ROUND(c, d, e, f, g, h, a, b, r + 6);
+        X4_ROUND(b, c, d, e, f, g, h, a, r + 7);
+    }
+    st[0] = X4_ADD(st[0], a);
+    st[1] = X4_ADD(st[1], b);
+    st[2] = X4_ADD(st[2], c);
+    st[3] = X4_ADD(st[3], d);
+    st[4] = X4_ADD(st[4], e);
+    st[5] = X4_ADD(st[5], f);
+    st[6] = X4_ADD(st[6], g);
+    st[7] = X4_ADD(st[7], h);
+    for (i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i *)out, st[i]);
+        hash[0].s[i] = out[0];
+        hash[1].s[i] = out[1];
+        hash[2].s[i] = out[2];
+        hash[3].s[i] = out[3];
+    }
+}
+
+#undef X4_ADD
+#undef X4_ROR
+#undef X4_SIGMA0
+#undef X4_SIGMA1
+#undef X4_sigma0
+#undef X4_sigma1
+#undef X4_CH
+#undef X4_MAJ
+#undef X4_ROUND
+#else
+static void secp256k1_sha256_transform_x4(secp256k1_sha256_t *hash) {
+    int i;
+    for (i = 0; i < 4; i++) {
+        secp256k1_sha256_transform(hash[i].s, hash[i].buf);
+    }
+}
+#endif
+
 static void secp256k1_sha256_write(secp256k1_sha256_t *hash, const unsigned char *data, size_t len) {
     size_t bufsize = hash->bytes & 0x3F;
     hash->bytes += len;
@@ -161,32 +385,121 @@ static void secp256k1_sha256_finalize(secp256k1_sha256_t *hash, unsigned char *o
     memcpy(out32, (const unsigned char*)out, 32);
 }
 
-static void secp256k1_hmac_sha256_initialize(secp256k1_hmac_sha256_t *hash, const unsigned char *key, size_t keylen) {
+static void secp256k1_sha256_save(const secp256k1_sha256_t *hash, secp256k1_sha256_midstate_t *mid) {
+    VERIFY_CHECK((hash->bytes & 0x3F) == 0);
+    memcpy(mid->s, hash->s, sizeof(mid->s));
+    mid->bytes = hash->bytes;
+}
+
+static void secp256k1_sha256_restore(secp256k1_sha256_t *hash, const secp256k1_sha256_midstate_t *mid) {
+    memcpy(hash->s, mid->s, sizeof(mid->s));
+    hash->bytes = mid->bytes;
+}
+
+static void secp256k1_sha256_initialize_tagged(secp256k1_sha256_t *hash, const unsigned char *tag, size_t taglen) {
+    unsigned char buf[32];
+    secp256k1_sha256_initialize(hash);
+    secp256k1_sha256_write(hash, tag, taglen);
+    secp256k1_sha256_finalize(hash, buf);
+
+    secp256k1_sha256_initialize(hash);
+    secp256k1_sha256_write(hash, buf, 32);
+    secp256k1_sha256_write(hash, buf, 32);
+}
+
+static void secp256k1_sha256_write_x4(secp256k1_sha256_t *hash, const unsigned char * const *data, size_t len) {
+    size_t bufsize = hash[0].bytes & 0x3F;
+    size_t pos = 0;
+    int i;
+    for (i = 1; i < 4; i++) {
+        VERIFY_CHECK(hash[i].bytes == hash[0].bytes);
+    }
+    for (i = 0; i < 4; i++) {
+        hash[i].bytes += len;
+    }
+    while (bufsize + len >= 64) {
+        /* Fill the buffers, and process them together. */
+        for (i = 0; i < 4; i++) {
+            memcpy(((unsigned char*)hash[i].buf) + bufsize, data[i] + pos, 64 - bufsize);
+        }
+        pos += 64 - bufsize;
+        len -= 64 - bufsize;
+        secp256k1_sha256_transform_x4(hash);
+        bufsize = 0;
+    }
+    if (len) {
+        /* Fill the buffers with what remains. */
+        for (i = 0; i < 4; i++) {
+            memcpy(((unsigned char*)hash[i].buf) + bufsize, data[i] + pos, len);
+        }
+    }
+}
+
+static void secp256k1_sha256_finalize_x4(secp256k1_sha256_t *hash, unsigned char *out32) {
+    static const unsigned char pad[64] = {0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    const unsigned char *pads[4];
+    const unsigned char *sizedescs[4];
+    uint32_t sizedesc[2];
+    uint32_t out[8];
+    int i, j;
+    sizedesc[0] = BE32(hash[0].bytes >> 29);
+    sizedesc[1] = BE32(hash[0].bytes << 3);
+    for (i = 0; i < 4; i++) {
+        pads[i] = pad;
+        sizedescs[i] = (const unsigned char*)sizedesc;
+    }
+    secp256k1_sha256_write_x4(hash, pads, 1 + ((119 - (hash[0].bytes % 64)) % 64));
+    secp256k1_sha256_write_x4(hash, sizedescs, 8);
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 8; j++) {
+            out[j] = BE32(hash[i].s[j]);
+            hash[i].s[j] = 0;
+        }
+        memcpy(out32 + 32 * i, (const unsigned char*)out, 32);
+    }
+}
+
+static void secp256k1_hmac_sha256_pads(secp256k1_hmac_sha256_pads_t *pads, const unsigned char *key, size_t keylen) {
     int n;
     unsigned char rkey[64];
+    secp256k1_sha256_t sha256;
     if (keylen <= 64) {
         memcpy(rkey, key, keylen);
         memset(rkey + keylen, 0, 64 - keylen);
     } else {
-        secp256k1_sha256_t sha256;
         secp256k1_sha256_initialize(&sha256);
         secp256k1_sha256_write(&sha256, key, keylen);
         secp256k1_sha256_finalize(&sha256, rkey);
         memset(rkey + 32, 0, 32);
     }
 
-    secp256k1_sha256_initialize(&hash->outer);
+    secp256k1_sha256_initialize(&sha256);
     for (n = 0; n < 64; n++) {
         rkey[n] ^= 0x5c;
     }
-    secp256k1_sha256_write(&hash->outer, rkey, 64);
+    secp256k1_sha256_write(&sha256, rkey, 64);
+    secp256k1_sha256_save(&sha256, &pads->outer);
 
-    secp256k1_sha256_initialize(&hash->inner);
+    secp256k1_sha256_initialize(&sha256);
     for (n = 0; n < 64; n++) {
         rkey[n] ^= 0x5c ^ 0x36;
     }
-    secp256k1_sha256_write(&hash->inner, rkey, 64);
+    secp256k1_sha256_write(&sha256, rkey, 64);
+    secp256k1_sha256_save(&sha256, &pads->inner);
     memset(rkey, 0, 64);
+    memset(&sha256, 0, sizeof(sha256));
+}
+
+static void secp256k1_hmac_sha256_initialize_pads(secp256k1_hmac_sha256_t *hash, const secp256k1_hmac_sha256_pads_t *pads) {
+    secp256k1_sha256_restore(&hash->inner, &pads->inner);
+    secp256k1_sha256_restore(&hash->outer, &pads->outer);
+}
+
+static void secp256k1_hmac_sha256_initialize(secp256k1_hmac_sha256_t *hash, const unsigned char *key, size_t keylen) {
+    secp256k1_hmac_sha256_pads_t pads;
+    secp256k1_hmac_sha256_pads(&pads, key, keylen);
+    secp256k1_hmac_sha256_initialize_pads(hash, &pads);
+    memset(&pads, 0, sizeof(pads));
 }
 
 static void secp256k1_hmac_sha256_write(secp256k1_hmac_sha256_t *hash, const unsigned char *data, size_t size) {
@@ -202,43 +515,88 @@ static void secp256k1_hmac_sha256_finalize(secp256k1_hmac_sha256_t *hash, unsign
 }
 
 
-static void secp256k1_rfc6979_hmac_sha256_initialize(secp256k1_rfc6979_hmac_sha256_t *rng, const unsigned char *key, size_t keylen, const unsigned char *msg, size_t msglen, const unsigned char *rnd, size_t rndlen) {
+/** The pad states of the all-zero key RFC6979 starts from (3.2.c), i.e. one compression of 64 bytes
+ *  0x36, respectively 0x5c, so every nonce derivation saves two compressions. */
+static const secp256k1_hmac_sha256_pads_t secp256k1_rfc6979_hmac_sha256_zero_pads = {
+    {{0xf454deadul, 0x9725214ful, 0x90daf2a0ul, 0xdf1228eaul, 0x64e5750ful, 0xa3924181ul, 0x824a932bul, 0xf8e04e32ul}, 64},
+    {{0xd385480ful, 0x7abb6477ul, 0x37c9c538ul, 0x5dd82467ul, 0x8e043a72ul, 0x753434b0ul, 0xdeb82818ul, 0x361d45a6ul}, 64}
+};
+
+/** Finish rng->k as the HMAC computed by hmac, which has been fed everything but rnd, and then
+ *  replace rng->v with HMAC_k(v), keeping rng->kpads in sync with the new k. */
+static void secp256k1_rfc6979_hmac_sha256_rekey(secp256k1_rfc6979_hmac_sha256_t *rng, secp256k1_hmac_sha256_t *hmac, const unsigned char *rnd, size_t rndlen) {
+    if (rnd && rndlen) {
+        /* RFC6979 3.6 "Additional data". */
+        secp256k1_hmac_sha256_write(hmac, rnd, rndlen);
+    }
+    secp256k1_hmac_sha256_finalize(hmac, rng->k);
+    secp256k1_hmac_sha256_pads(&rng->kpads, rng->k, 32);
+    secp256k1_hmac_sha256_initialize_pads(hmac, &rng->kpads);
+    secp256k1_hmac_sha256_write(hmac, rng->v, 32);
+    secp256k1_hmac_sha256_finalize(hmac, rng->v);
+}
+
+/** Replace rng->k with HMAC_k(v || sep || key || msg || rnd) (key and msg only if key is not NULL)
+ *  and then rng->v with HMAC_k(v), keeping rng->kpads in sync with the new k. */
+static void secp256k1_rfc6979_hmac_sha256_update(secp256k1_rfc6979_hmac_sha256_t *rng, const unsigned char *sep, const unsigned char *key, size_t keylen, const unsigned char *msg, size_t msglen, const unsigned char *rnd, size_t rndlen) {
     secp256k1_hmac_sha256_t hmac;
+    secp256k1_hmac_sha256_initialize_pads(&hmac, &rng->kpads);
+    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
+    secp256k1_hmac_sha256_write(&hmac, sep, 1);
+    if (key) {
+        secp256k1_hmac_sha256_write(&hmac, key, keylen);
+        secp256k1_hmac_sha256_write(&hmac, msg, msglen);
+    }
+    secp256k1_rfc6979_hmac_sha256_rekey(rng, &hmac, rnd, rndlen);
+}
+
+static void secp256k1_rfc6979_hmac_sha256_initialize(secp256k1_rfc6979_hmac_sha256_t *rng, const unsigned char *key, size_t keylen, const unsigned char *msg, size_t msglen, const unsigned char *rnd, size_t rndlen) {
     static const unsigned char zero[1] = {0x00};
     static const unsigned char one[1] = {0x01};
 
     memset(rng->v, 0x01, 32); /* RFC6979 3.2.b. */
     memset(rng->k, 0x00, 32); /* RFC6979 3.2.c. */
+    rng->kpads = secp256k1_rfc6979_hmac_sha256_zero_pads;
 
     /* RFC6979 3.2.d. */
-    secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
-    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
-    secp256k1_hmac_sha256_write(&hmac, zero, 1);
-    secp256k1_hmac_sha256_write(&hmac, key, keylen);
-    secp256k1_hmac_sha256_write(&hmac, msg, msglen);
-    if (rnd && rndlen) {
-        /* RFC6979 3.6 "Additional data". */
-        secp256k1_hmac_sha256_write(&hmac, rnd, rndlen);
-    }
-    secp256k1_hmac_sha256_finalize(&hmac, rng->k);
-    secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
-    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
-    secp256k1_hmac_sha256_finalize(&hmac, rng->v);
+    secp256k1_rfc6979_hmac_sha256_update(rng, zero, key, keylen, msg, msglen, rnd, rndlen);
 
     /* RFC6979 3.2.f. */
-    secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
-    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
-    secp256k1_hmac_sha256_write(&hmac, one, 1);
-    secp256k1_hmac_sha256_write(&hmac, key, keylen);
+    secp256k1_rfc6979_hmac_sha256_update(rng, one, key, keylen, msg, msglen, rnd, rndlen);
+    rng->retry = 0;
+}
+
+static void secp256k1_rfc6979_hmac_sha256_key_midstate(secp256k1_sha256_midstate_t *mid, const unsigned char *key, size_t keylen) {
+    static const unsigned char zero[1] = {0x00};
+    unsigned char v[32];
+    secp256k1_sha256_t sha256;
+    VERIFY_CHECK(keylen >= 31);
+    (void)keylen;
+    memset(v, 0x01, 32);
+    secp256k1_sha256_restore(&sha256, &secp256k1_rfc6979_hmac_sha256_zero_pads.inner);
+    secp256k1_sha256_write(&sha256, v, 32);
+    secp256k1_sha256_write(&sha256, zero, 1);
+    secp256k1_sha256_write(&sha256, key, 31);
+    secp256k1_sha256_save(&sha256, mid);
+    memset(&sha256, 0, sizeof(sha256));
+}
+
+static void secp256k1_rfc6979_hmac_sha256_initialize_midstate(secp256k1_rfc6979_hmac_sha256_t *rng, const secp256k1_sha256_midstate_t *keymid, const unsigned char *key, size_t keylen, const unsigned char *msg, size_t msglen, const unsigned char *rnd, size_t rndlen) {
+    static const unsigned char one[1] = {0x01};
+    secp256k1_hmac_sha256_t hmac;
+
+    memset(rng->v, 0x01, 32);
+    memset(rng->k, 0x00, 32);
+
+    /* RFC6979 3.2.d, with the key-only prefix already absorbed. */
+    secp256k1_sha256_restore(&hmac.inner, keymid);
+    secp256k1_sha256_restore(&hmac.outer, &secp256k1_rfc6979_hmac_sha256_zero_pads.outer);
+    secp256k1_hmac_sha256_write(&hmac, key + 31, keylen - 31);
     secp256k1_hmac_sha256_write(&hmac, msg, msglen);
-    if (rnd && rndlen) {
-        /* RFC6979 3.6 "Additional data". */
-        secp256k1_hmac_sha256_write(&hmac, rnd, rndlen);
-    }
-    secp256k1_hmac_sha256_finalize(&hmac, rng->k);
-    secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
-    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
-    secp256k1_hmac_sha256_finalize(&hmac, rng->v);
+    secp256k1_rfc6979_hmac_sha256_rekey(rng, &hmac, rnd, rndlen);
+
+    /* RFC6979 3.2.f. */
+    secp256k1_rfc6979_hmac_sha256_update(rng, one, key, keylen, msg, msglen, rnd, rndlen);
     rng->retry = 0;
 }
 
@@ -246,20 +604,13 @@ static void secp256k1_rfc6979_hmac_sha256_generate(secp256k1_rfc6979_hmac_sha256
     /* RFC6979 3.2.h. */
     static const unsigned char zero[1] = {0x00};
     if (rng->retry) {
-        secp256k1_hmac_sha256_t hmac;
-        secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
-        secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
-        secp256k1_hmac_sha256_write(&hmac, zero, 1);
-        secp256k1_hmac_sha256_finalize(&hmac, rng->k);
-        secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
-        secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
-        secp256k1_hmac_sha256_finalize(&hmac, rng->v);
+        secp256k1_rfc6979_hmac_sha256_update(rng, zero, NULL, 0, NULL, 0, NULL, 0);
     }
 
     while (outlen > 0) {
         secp256k1_hmac_sha256_t hmac;
         int now = outlen;
-        secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
+        secp256k1_hmac_sha256_initialize_pads(&hmac, &rng->kpads);
         secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
         secp256k1_hmac_sha256_finalize(&hmac, rng->v);
         if (now > 32) {
@@ -276,6 +627,7 @@ static void secp256k1_rfc6979_hmac_sha256_generate(secp256k1_rfc6979_hmac_sha256
 static void secp256k1_rfc6979_hmac_sha256_finalize(secp256k1_rfc6979_hmac_sha256_t *rng) {
     memset(rng->k, 0, 32);
     memset(rng->v, 0, 32);
+    memset(&rng->kpads, 0, sizeof(rng->kpads));
     rng->retry = 0;
 }
 
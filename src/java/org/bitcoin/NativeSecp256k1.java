@@ -2,6 +2,9 @@ package org.bitcoin;
 
 import java.nio.ByteBuffer;
 import java.nio.ByteOrder;
+import java.security.SecureRandom;
+import java.util.ArrayList;
+import java.util.List;
 
 import com.google.common.base.Preconditions;
 
@@ -10,6 +13,10 @@ import com.google.common.base.Preconditions;
  * This class holds native methods to handle ECDSA verification.
  * You can find an example library that can be used for this at
  * https://github.com/sipa/secp256k1
+ *
+ * Methods taking a long ctx operate on a context created with contextCreate or contextClone,
+ * which must have been created with the flags the operation needs (or CONTEXT_LAZY). The
+ * methods without one use the library's own verification context.
  */
 public class NativeSecp256k1 {
     public static final boolean enabled;
@@ -22,39 +29,340 @@ public class NativeSecp256k1 {
         }
         enabled = isEnabled;
     }
-    
+
+    /** Context flags, as in secp256k1.h. */
+    public static final int CONTEXT_VERIFY = 1 << 0;
+    public static final int CONTEXT_SIGN = 1 << 1;
+    public static final int CONTEXT_COMMIT = 1 << 7;
+    public static final int CONTEXT_RANGEPROOF = 1 << 8;
+    public static final int CONTEXT_LAZY = 1 << 9;
+
+    private static SecureRandom random = new SecureRandom();
+
     private static ThreadLocal<ByteBuffer> nativeECDSABuffer = new ThreadLocal<ByteBuffer>();
+
+    /** The calling thread's direct buffer, grown to at least size bytes and rewound. */
+    private static ByteBuffer nativeBuffer(int size) {
+        ByteBuffer byteBuff = nativeECDSABuffer.get();
+        if (byteBuff == null || byteBuff.capacity() < size) {
+            byteBuff = ByteBuffer.allocateDirect(Math.max(size, 32 + 8 + 520 + 520));
+            byteBuff.order(ByteOrder.nativeOrder());
+            nativeECDSABuffer.set(byteBuff);
+        }
+        byteBuff.rewind();
+        return byteBuff;
+    }
+
+    /** Zeroes length bytes of byteBuff from offset on, so that no secret outlives the call that needed it. */
+    private static void wipe(ByteBuffer byteBuff, int offset, int length) {
+        for (int i = 0; i < length; i++) {
+            byteBuff.put(offset + i, (byte) 0);
+        }
+    }
+
+    /**
+     * Creates a context. Building its tables is the expensive part, so create contexts once and
+     * share them (they are safe to use from many threads, except for contextRandomize).
+     *
+     * @param flags a combination of the CONTEXT_ flags
+     * @returns a handle to pass to the other methods, and eventually to contextDestroy
+     */
+    public static long contextCreate(int flags) {
+        return secp256k1_context_create(flags);
+    }
+
+    /**
+     * Clones a context. The clone shares the tables of ctx, so this is cheap.
+     */
+    public static long contextClone(long ctx) {
+        Preconditions.checkArgument(ctx != 0);
+        return secp256k1_context_clone(ctx);
+    }
+
+    /**
+     * Destroys a context. The handle may not be used afterwards.
+     */
+    public static void contextDestroy(long ctx) {
+        secp256k1_context_destroy(ctx);
+    }
+
+    /**
+     * Updates the blinding of a context used for signing and commitments, which protects against
+     * side channels. No other thread may use the context at the same time.
+     *
+     * @param seed 32 random bytes
+     */
+    public static boolean contextRandomize(long ctx, byte[] seed) {
+        Preconditions.checkArgument(ctx != 0 && seed.length == 32);
+
+        ByteBuffer byteBuff = nativeBuffer(32);
+        byteBuff.put(seed);
+        try {
+            return secp256k1_context_randomize(ctx, byteBuff) == 1;
+        } finally {
+            wipe(byteBuff, 0, 32);
+        }
+    }
+
+    /**
+     * Hands out a randomized clone of one base context to every thread that asks, so that the
+     * threads share the tables of the base but each has its own blinding.
+     */
+    public static class PerThreadContext {
+        private final long base;
+        private final List<Long> clones = new ArrayList<Long>();
+        private final ThreadLocal<Long> threadContext = new ThreadLocal<Long>();
+
+        /** Takes ownership of base, which is destroyed with the clones. */
+        public PerThreadContext(long base) {
+            Preconditions.checkArgument(base != 0);
+            this.base = base;
+        }
+
+        /** The calling thread's context. */
+        public long get() {
+            Long ctx = threadContext.get();
+            if (ctx == null) {
+                byte[] seed = new byte[32];
+                random.nextBytes(seed);
+                ctx = contextClone(base);
+                contextRandomize(ctx, seed);
+                synchronized (clones) {
+                    clones.add(ctx);
+                }
+                threadContext.set(ctx);
+            }
+            return ctx;
+        }
+
+        /** Destroys all clones and the base; no thread may use any of them afterwards. */
+        public void destroy() {
+            synchronized (clones) {
+                for (Long ctx : clones) {
+                    contextDestroy(ctx);
+                }
+                clones.clear();
+            }
+            contextDestroy(base);
+        }
+    }
+
     /**
      * Verifies the given secp256k1 signature in native code.
      * Calling when enabled == false is undefined (probably library not loaded)
-     * 
+     *
      * @param data The data which was signed, must be exactly 32 bytes
      * @param signature The signature
      * @param pub The public key which did the signing
      */
     public static boolean verify(byte[] data, byte[] signature, byte[] pub) {
+        return verify(0, data, signature, pub);
+    }
+
+    /**
+     * As verify(data, signature, pub), on a context with CONTEXT_VERIFY.
+     */
+    public static boolean verify(long ctx, byte[] data, byte[] signature, byte[] pub) {
         Preconditions.checkArgument(data.length == 32 && signature.length <= 520 && pub.length <= 520);
 
-        ByteBuffer byteBuff = nativeECDSABuffer.get();
-        if (byteBuff == null) {
-            byteBuff = ByteBuffer.allocateDirect(32 + 8 + 520 + 520);
-            byteBuff.order(ByteOrder.nativeOrder());
-            nativeECDSABuffer.set(byteBuff);
-        }
-        byteBuff.rewind();
+        ByteBuffer byteBuff = nativeBuffer(32 + 8 + 520 + 520);
         byteBuff.put(data);
         byteBuff.putInt(signature.length);
         byteBuff.putInt(pub.length);
         byteBuff.put(signature);
         byteBuff.put(pub);
-        return secp256k1_ecdsa_verify(byteBuff) == 1;
+        return secp256k1_ecdsa_verify(ctx, byteBuff) == 1;
     }
 
+    /**
+     * Packs (data, signature, pub) tuples into a direct buffer for verifyBatch, each laid out as
+     * byte[32] data, native-endian int signatureLength, native-endian int pubkeyLength,
+     * byte[signatureLength] signature, byte[pubkeyLength] pub. Callers that verify many batches
+     * can fill and reuse a buffer of their own in the same layout instead.
+     */
+    public static ByteBuffer packBatch(byte[][] data, byte[][] signatures, byte[][] pubs) {
+        Preconditions.checkArgument(data.length == signatures.length && data.length == pubs.length);
+        int size = 0;
+        for (int i = 0; i < data.length; i++) {
+            Preconditions.checkArgument(data[i].length == 32 && signatures[i].length <= 520 && pubs[i].length <= 520);
+            size += 32 + 8 + signatures[i].length + pubs[i].length;
+        }
+        ByteBuffer byteBuff = ByteBuffer.allocateDirect(size);
+        byteBuff.order(ByteOrder.nativeOrder());
+        for (int i = 0; i < data.length; i++) {
+            byteBuff.put(data[i]);
+            byteBuff.putInt(signatures[i].length);
+            byteBuff.putInt(pubs[i].length);
+            byteBuff.put(signatures[i]);
+            byteBuff.put(pubs[i]);
+        }
+        return byteBuff;
+    }
+
+    /**
+     * Verifies count packed signatures (see packBatch) with a single native call.
+     * results[i] is set to whether the i'th signature is valid, with the same outcome as verify
+     * would give; an entry that runs past the end of the buffer, and every one after it, is invalid.
+     * Calling when enabled == false is undefined (probably library not loaded)
+     *
+     * @param byteBuff a direct buffer holding count consecutive entries
+     * @param count the number of entries
+     * @param results receives the per-signature outcomes, must have at least count elements
+     * @returns true if all count signatures are valid
+     */
+    public static boolean verifyBatch(ByteBuffer byteBuff, int count, boolean[] results) {
+        return verifyBatch(0, byteBuff, count, results);
+    }
+
+    /**
+     * As verifyBatch(byteBuff, count, results), on a context with CONTEXT_VERIFY.
+     */
+    public static boolean verifyBatch(long ctx, ByteBuffer byteBuff, int count, boolean[] results) {
+        Preconditions.checkArgument(byteBuff.isDirect() && count >= 0 && results.length >= count);
+        return secp256k1_ecdsa_verify_batch(ctx, byteBuff, count, results) == count;
+    }
+
+    /**
+     * Creates a DER signature of data with seckey, on a context with CONTEXT_SIGN.
+     *
+     * @returns the signature, or null if seckey is invalid
+     */
+    public static byte[] sign(long ctx, byte[] data, byte[] seckey) {
+        Preconditions.checkArgument(ctx != 0 && data.length == 32 && seckey.length == 32);
+
+        ByteBuffer byteBuff = nativeBuffer(72);
+        byteBuff.put(data);
+        byteBuff.put(seckey);
+        try {
+            int sigLen = secp256k1_ecdsa_sign(ctx, byteBuff);
+            if (sigLen == 0) {
+                return null;
+            }
+            byte[] sig = new byte[sigLen];
+            byteBuff.rewind();
+            byteBuff.get(sig);
+            return sig;
+        } finally {
+            wipe(byteBuff, 32, 32);
+        }
+    }
+
+    /**
+     * Computes the public key of seckey, on a context with CONTEXT_SIGN.
+     *
+     * @returns the 33 or 65 byte public key, or null if seckey is invalid
+     */
+    public static byte[] pubkeyCreate(long ctx, byte[] seckey, boolean compressed) {
+        Preconditions.checkArgument(ctx != 0 && seckey.length == 32);
+
+        ByteBuffer byteBuff = nativeBuffer(65);
+        byteBuff.put(seckey);
+        try {
+            int pubLen = secp256k1_ec_pubkey_create(ctx, byteBuff, compressed ? 1 : 0);
+            if (pubLen == 0) {
+                return null;
+            }
+            byte[] pub = new byte[pubLen];
+            byteBuff.rewind();
+            byteBuff.get(pub);
+            return pub;
+        } finally {
+            wipe(byteBuff, 0, 32);
+        }
+    }
+
+    /**
+     * Commits to value with blinding factor blind, on a context with CONTEXT_SIGN and CONTEXT_COMMIT.
+     *
+     * @returns the 33 byte commitment, or null if blind is invalid
+     */
+    public static byte[] pedersenCommit(long ctx, byte[] blind, long value) {
+        Preconditions.checkArgument(ctx != 0 && blind.length == 32);
+
+        ByteBuffer byteBuff = nativeBuffer(33);
+        byteBuff.put(blind);
+        try {
+            if (secp256k1_pedersen_commit(ctx, byteBuff, value) == 0) {
+                return null;
+            }
+            byte[] commit = new byte[33];
+            byteBuff.rewind();
+            byteBuff.get(commit);
+            return commit;
+        } finally {
+            wipe(byteBuff, 0, 32);
+        }
+    }
+
+    /**
+     * Verifies a range proof for commit, on a context with CONTEXT_COMMIT and CONTEXT_RANGEPROOF.
+     *
+     * @returns the proven minimum and maximum value (as unsigned longs), or null if the proof is invalid
+     */
+    public static long[] rangeproofVerify(long ctx, byte[] commit, byte[] proof) {
+        Preconditions.checkArgument(ctx != 0 && commit.length == 33);
+
+        ByteBuffer byteBuff = nativeBuffer(33 + proof.length);
+        byteBuff.put(commit);
+        byteBuff.put(proof);
+        if (secp256k1_rangeproof_verify(ctx, byteBuff, proof.length) == 0) {
+            return null;
+        }
+        byteBuff.rewind();
+        long[] range = new long[2];
+        range[0] = byteBuff.getLong();
+        range[1] = byteBuff.getLong();
+        return range;
+    }
+
+    private static native long secp256k1_context_create(int flags);
+
+    private static native long secp256k1_context_clone(long ctx);
+
+    private static native void secp256k1_context_destroy(long ctx);
+
+    /**
+     * @param byteBuff byte[32] seed
+     */
+    private static native int secp256k1_context_randomize(long ctx, ByteBuffer byteBuff);
+
     /**
      * @param byteBuff signature format is byte[32] data,
      *        native-endian int signatureLength, native-endian int pubkeyLength,
      *        byte[signatureLength] signature, byte[pubkeyLength] pub
      * @returns 1 for valid signature, anything else for invalid
      */
-    private static native int secp256k1_ecdsa_verify(ByteBuffer byteBuff);
+    private static native int secp256k1_ecdsa_verify(long ctx, ByteBuffer byteBuff);
+
+    /**
+     * @param byteBuff count entries, each in the format of secp256k1_ecdsa_verify
+     * @param results set to true for the valid signatures and false for the rest
+     * @returns the number of valid signatures
+     */
+    private static native int secp256k1_ecdsa_verify_batch(long ctx, ByteBuffer byteBuff, int count, boolean[] results);
+
+    /**
+     * @param byteBuff byte[32] data, byte[32] seckey; replaced by the signature
+     * @returns the signature length, or 0 on failure
+     */
+    private static native int secp256k1_ecdsa_sign(long ctx, ByteBuffer byteBuff);
+
+    /**
+     * @param byteBuff byte[32] seckey; replaced by the public key
+     * @returns the public key length, or 0 on failure
+     */
+    private static native int secp256k1_ec_pubkey_create(long ctx, ByteBuffer byteBuff, int compressed);
+
+    /**
+     * @param byteBuff byte[32] blind; replaced by the commitment
+     * @returns 33, or 0 on failure
+     */
+    private static native int secp256k1_pedersen_commit(long ctx, ByteBuffer byteBuff, long value);
+
+    /**
+     * @param byteBuff byte[33] commit, byte[proofLength] proof; replaced by native-endian
+     *        long minimum, long maximum
+     * @returns 1 for a valid proof, 0 otherwise
+     */
+    private static native int secp256k1_rangeproof_verify(long ctx, ByteBuffer byteBuff, int proofLength);
 }
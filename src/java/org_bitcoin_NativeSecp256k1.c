@@ -1,23 +1,209 @@
+#include <stdint.h>
+#include <string.h>
+
 #include "org_bitcoin_NativeSecp256k1.h"
 #include "include/secp256k1.h"
 
+/* Entries parsed and handed to secp256k1_ecdsa_verify_batch at a time. */
+#define JNI_VERIFY_BATCH_CHUNK 64
+
+static secp256k1_context_t* secp256k1_jni_ctx = NULL;
+
+/* Contexts are handed to Java as a long; 0 stands for the library's own verification context. */
+static secp256k1_context_t* secp256k1_jni_context(jlong ctx_l) {
+	return ctx_l == 0 ? secp256k1_jni_ctx : (secp256k1_context_t*)(intptr_t)ctx_l;
+}
+
+/* The address of a direct buffer, or NULL if it is not one or holds fewer than size bytes. */
+static unsigned char* secp256k1_jni_buffer(JNIEnv* env, jobject byteBufferObject, jlong size) {
+	unsigned char* data = (unsigned char*) (*env)->GetDirectBufferAddress(env, byteBufferObject);
+	if (data == NULL || size < 0 || (*env)->GetDirectBufferCapacity(env, byteBufferObject) < size) {
+		return NULL;
+	}
+	return data;
+}
+
+JNIEXPORT jlong JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1context_1create
+  (JNIEnv* env, jclass classObject, jint flags)
+{
+	return (jlong)(intptr_t)secp256k1_context_create(flags);
+}
+
+JNIEXPORT jlong JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1context_1clone
+  (JNIEnv* env, jclass classObject, jlong ctx_l)
+{
+	return (jlong)(intptr_t)secp256k1_context_clone(secp256k1_jni_context(ctx_l));
+}
+
+JNIEXPORT void JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1context_1destroy
+  (JNIEnv* env, jclass classObject, jlong ctx_l)
+{
+	if (ctx_l != 0) {
+		secp256k1_context_destroy((secp256k1_context_t*)(intptr_t)ctx_l);
+	}
+}
+
+JNIEXPORT jint JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1context_1randomize
+  (JNIEnv* env, jclass classObject, jlong ctx_l, jobject byteBufferObject)
+{
+	unsigned char* seed = secp256k1_jni_buffer(env, byteBufferObject, 32);
+
+	if (ctx_l == 0 || seed == NULL) {
+		/* The shared verification context cannot be changed under other threads. */
+		return 0;
+	}
+	return secp256k1_context_randomize((secp256k1_context_t*)(intptr_t)ctx_l, seed);
+}
+
 JNIEXPORT jint JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1ecdsa_1verify
-  (JNIEnv* env, jclass classObject, jobject byteBufferObject)
+  (JNIEnv* env, jclass classObject, jlong ctx_l, jobject byteBufferObject)
 {
+	unsigned char* data = secp256k1_jni_buffer(env, byteBufferObject, 32 + 8);
+	int sigLen, pubLen;
+
+	if (data == NULL) {
+		return 0;
+	}
+	memcpy(&sigLen, data + 32, sizeof(int));
+	memcpy(&pubLen, data + 32 + 4, sizeof(int));
+	if (sigLen < 0 || pubLen < 0 || secp256k1_jni_buffer(env, byteBufferObject, 32 + 8 + (jlong)sigLen + pubLen) == NULL) {
+		return 0;
+	}
+	return secp256k1_ecdsa_verify(secp256k1_jni_context(ctx_l), data, data+32+8, sigLen, data+32+8+sigLen, pubLen);
+}
+
+JNIEXPORT jint JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1ecdsa_1sign
+  (JNIEnv* env, jclass classObject, jlong ctx_l, jobject byteBufferObject)
+{
+	unsigned char sig[72];
+	unsigned char* data = secp256k1_jni_buffer(env, byteBufferObject, sizeof(sig));
+	int sigLen = sizeof(sig);
+
+	if (data == NULL || !secp256k1_ecdsa_sign(secp256k1_jni_context(ctx_l), data, sig, &sigLen, data + 32, NULL, NULL)) {
+		return 0;
+	}
+	memcpy(data, sig, sigLen);
+	return sigLen;
+}
+
+JNIEXPORT jint JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1ec_1pubkey_1create
+  (JNIEnv* env, jclass classObject, jlong ctx_l, jobject byteBufferObject, jint compressed)
+{
+	unsigned char pub[65];
+	unsigned char* data = secp256k1_jni_buffer(env, byteBufferObject, sizeof(pub));
+	int pubLen = sizeof(pub);
+
+	if (data == NULL || !secp256k1_ec_pubkey_create(secp256k1_jni_context(ctx_l), pub, &pubLen, data, compressed)) {
+		return 0;
+	}
+	memcpy(data, pub, pubLen);
+	return pubLen;
+}
+
+JNIEXPORT jint JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1pedersen_1commit
+  (JNIEnv* env, jclass classObject, jlong ctx_l, jobject byteBufferObject, jlong value)
+{
+	unsigned char commit[33];
+	unsigned char* data = secp256k1_jni_buffer(env, byteBufferObject, sizeof(commit));
+
+	if (data == NULL || !secp256k1_pedersen_commit(secp256k1_jni_context(ctx_l), commit, data, (uint64_t)value)) {
+		return 0;
+	}
+	memcpy(data, commit, 33);
+	return 33;
+}
+
+JNIEXPORT jint JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1rangeproof_1verify
+  (JNIEnv* env, jclass classObject, jlong ctx_l, jobject byteBufferObject, jint proofLen)
+{
+	uint64_t values[2];
+	unsigned char* data = secp256k1_jni_buffer(env, byteBufferObject, 33 + (jlong)proofLen);
+
+	/* The buffer also receives the two values, which fit in the 33 bytes of the commitment. */
+	if (data == NULL || proofLen < 0 || !secp256k1_rangeproof_verify(secp256k1_jni_context(ctx_l), &values[0], &values[1], data, data + 33, proofLen)) {
+		return 0;
+	}
+	memcpy(data, values, sizeof(values));
+	return 1;
+}
+
+JNIEXPORT jint JNICALL Java_org_bitcoin_NativeSecp256k1_secp256k1_1ecdsa_1verify_1batch
+  (JNIEnv* env, jclass classObject, jlong ctx_l, jobject byteBufferObject, jint count, jbooleanArray resultArray)
+{
+	secp256k1_context_t* ctx = secp256k1_jni_context(ctx_l);
 	unsigned char* data = (unsigned char*) (*env)->GetDirectBufferAddress(env, byteBufferObject);
-	int sigLen = *((int*)(data + 32));
-	int pubLen = *((int*)(data + 32 + 4));
+	jlong capacity = (*env)->GetDirectBufferCapacity(env, byteBufferObject);
+	secp256k1_ecdsa_signature sigs[JNI_VERIFY_BATCH_CHUNK];
+	secp256k1_pubkey pubkeys[JNI_VERIFY_BATCH_CHUNK];
+	const secp256k1_ecdsa_signature* sigPtrs[JNI_VERIFY_BATCH_CHUNK];
+	const unsigned char* msgPtrs[JNI_VERIFY_BATCH_CHUNK];
+	const secp256k1_pubkey* pubPtrs[JNI_VERIFY_BATCH_CHUNK];
+	int entries[JNI_VERIFY_BATCH_CHUNK];
+	jboolean results[JNI_VERIFY_BATCH_CHUNK];
+	jlong pos = 0;
+	jint start, valid = 0;
+	int truncated = 0;
+
+	if (data == NULL || capacity < 0 || count < 0 || resultArray == NULL || (*env)->GetArrayLength(env, resultArray) < count) {
+		return -1;
+	}
+
+	for (start = 0; start < count; start += JNI_VERIFY_BATCH_CHUNK) {
+		int len = count - start < JNI_VERIFY_BATCH_CHUNK ? count - start : JNI_VERIFY_BATCH_CHUNK;
+		int i, n = 0;
+		size_t done, firstInvalid;
+
+		/* Parse the chunk. Entries that do not parse are invalid, and so is everything from an entry
+		 * that runs past the end of the buffer on. */
+		for (i = 0; i < len; i++) {
+			int sigLen, pubLen;
+			results[i] = JNI_FALSE;
+			if (truncated || capacity - pos < 32 + 8) {
+				truncated = 1;
+				continue;
+			}
+			memcpy(&sigLen, data + pos + 32, sizeof(int));
+			memcpy(&pubLen, data + pos + 32 + 4, sizeof(int));
+			if (sigLen < 0 || pubLen < 0 || capacity - pos - 32 - 8 < (jlong)sigLen + pubLen) {
+				truncated = 1;
+				continue;
+			}
+			if (secp256k1_ecdsa_signature_parse_der(ctx, &sigs[n], data + pos + 32 + 8, sigLen) &&
+			    secp256k1_ec_pubkey_parse(ctx, &pubkeys[n], data + pos + 32 + 8 + sigLen, pubLen)) {
+				/* secp256k1_ecdsa_verify accepts high-S signatures, so the batch does too. */
+				secp256k1_ecdsa_signature_normalize(ctx, &sigs[n], &sigs[n]);
+				sigPtrs[n] = &sigs[n];
+				msgPtrs[n] = data + pos;
+				pubPtrs[n] = &pubkeys[n];
+				entries[n] = i;
+				n++;
+			}
+			pos += 32 + 8 + sigLen + pubLen;
+		}
+
+		/* The batch verifier stops at the first invalid signature; carry on after it. */
+		for (done = 0; done < (size_t)n; done += firstInvalid + 1) {
+			size_t j;
+			secp256k1_ecdsa_verify_batch(ctx, &firstInvalid, sigPtrs + done, msgPtrs + done, pubPtrs + done, n - done);
+			for (j = done; j < done + firstInvalid; j++) {
+				results[entries[j]] = JNI_TRUE;
+				valid++;
+			}
+		}
+		(*env)->SetBooleanArrayRegion(env, resultArray, start, len, results);
+	}
 
-	return secp256k1_ecdsa_verify(data, 32, data+32+8, sigLen, data+32+8+sigLen, pubLen);
+	return valid;
 }
 
 static void __javasecp256k1_attach(void) __attribute__((constructor));
 static void __javasecp256k1_detach(void) __attribute__((destructor));
 
 static void __javasecp256k1_attach(void) {
-	secp256k1_start(SECP256K1_START_VERIFY);
+	secp256k1_jni_ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
 }
 
 static void __javasecp256k1_detach(void) {
-	secp256k1_stop();
+	secp256k1_context_destroy(secp256k1_jni_ctx);
+	secp256k1_jni_ctx = NULL;
 }
@@ -0,0 +1,291 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille                                   *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_MODINV32_IMPL_H_
+#define _SECP256K1_MODINV32_IMPL_H_
+
+#include "modinv32.h"
+
+#include "util.h"
+
+/* This file implements modular inversion based on the paper "Fast constant-time gcd computation and
+ * modular inversion" by Daniel J. Bernstein and Bo-Yin Yang.
+ *
+ * Every iteration computes a batch of divsteps on the bottom 30 bits of f and g only, collected in a
+ * 2x2 transition matrix t, and then applies t to the full f and g and to the coefficients d and e
+ * (which track f = d*x and g = e*x mod the modulus). Right shifts of negative values are assumed to
+ * be arithmetic. */
+
+/* A 2x2 matrix [[u, v], [q, r]] of divstep transitions, scaled by 2^30. */
+typedef struct {
+    int32_t u, v, q, r;
+} secp256k1_modinv32_trans2x2_t;
+
+/* Compute the transition matrix and zeta for 30 divsteps (where zeta = -(delta+1/2)), starting from
+ * the bottom 30 bits of f0 and g0. The returned matrix is scaled by 2^30. Constant time. */
+static int32_t secp256k1_modinv32_divsteps_30(int32_t zeta, uint32_t f0, uint32_t g0, secp256k1_modinv32_trans2x2_t *t) {
+    uint32_t u = 1, v = 0, q = 0, r = 1;
+    volatile uint32_t c1, c2;
+    uint32_t mask1, mask2, f = f0, g = g0, x, y, z;
+    int i;
+
+    for (i = 0; i < 30; ++i) {
+        VERIFY_CHECK((f & 1) == 1);
+        /* If zeta < 0 (delta > 0) and g is odd, (f, g) becomes (g, (g - f) / 2); otherwise, if g is
+         * odd, (f, g) becomes (f, (g + f) / 2), and if g is even (f, g / 2). */
+        c1 = zeta >> 31;
+        mask1 = c1;
+        c2 = g & 1;
+        mask2 = -c2;
+        x = (f ^ mask1) - mask1;
+        y = (u ^ mask1) - mask1;
+        z = (v ^ mask1) - mask1;
+        g += x & mask2;
+        q += y & mask2;
+        r += z & mask2;
+        mask1 &= mask2;
+        zeta = (zeta ^ mask1) - 1;
+        f += g & mask1;
+        u += q & mask1;
+        v += r & mask1;
+        g >>= 1;
+        u <<= 1;
+        v <<= 1;
+    }
+    t->u = (int32_t)u;
+    t->v = (int32_t)v;
+    t->q = (int32_t)q;
+    t->r = (int32_t)r;
+    return zeta;
+}
+
+/* Compute the transition matrix and eta for 30 divsteps (where eta = -delta), starting from the
+ * bottom 30 bits of f0 and g0. The returned matrix is scaled by 2^30. Variable time: runs of zero
+ * bits in g are skipped at once, and g is eliminated up to 8 bits at a time. */
+static int32_t secp256k1_modinv32_divsteps_30_var(int32_t eta, uint32_t f0, uint32_t g0, secp256k1_modinv32_trans2x2_t *t) {
+    /* inv256[i] = -(2*i+1)^-1 (mod 256) */
+    static const uint8_t inv256[128] = {
+        0xFF, 0x55, 0x33, 0x49, 0xC7, 0x5D, 0x3B, 0x11, 0x0F, 0xE5, 0xC3, 0x59,
+        0xD7, 0xED, 0xCB, 0x21, 0x1F, 0x75, 0x53, 0x69, 0xE7, 0x7D, 0x5B, 0x31,
+        0x2F, 0x05, 0xE3, 0x79, 0xF7, 0x0D, 0xEB, 0x41, 0x3F, 0x95, 0x73, 0x89,
+        0x07, 0x9D, 0x7B, 0x51, 0x4F, 0x25, 0x03, 0x99, 0x17, 0x2D, 0x0B, 0x61,
+        0x5F, 0xB5, 0x93, 0xA9, 0x27, 0xBD, 0x9B, 0x71, 0x6F, 0x45, 0x23, 0xB9,
+        0x37, 0x4D, 0x2B, 0x81, 0x7F, 0xD5, 0xB3, 0xC9, 0x47, 0xDD, 0xBB, 0x91,
+        0x8F, 0x65, 0x43, 0xD9, 0x57, 0x6D, 0x4B, 0xA1, 0x9F, 0xF5, 0xD3, 0xE9,
+        0x67, 0xFD, 0xDB, 0xB1, 0xAF, 0x85, 0x63, 0xF9, 0x77, 0x8D, 0x6B, 0xC1,
+        0xBF, 0x15, 0xF3, 0x09, 0x87, 0x1D, 0xFB, 0xD1, 0xCF, 0xA5, 0x83, 0x19,
+        0x97, 0xAD, 0x8B, 0xE1, 0xDF, 0x35, 0x13, 0x29, 0xA7, 0x3D, 0x1B, 0xF1,
+        0xEF, 0xC5, 0xA3, 0x39, 0xB7, 0xCD, 0xAB, 0x01
+    };
+    uint32_t u = 1, v = 0, q = 0, r = 1;
+    uint32_t f = f0, g = g0, m, w;
+    int i = 30, limit, zeros;
+
+    for (;;) {
+        /* Use a sentinel bit to count zeros only up to i. */
+        zeros = secp256k1_ctz32_var(g | (UINT32_MAX << i));
+        g >>= zeros;
+        u <<= zeros;
+        v <<= zeros;
+        eta -= zeros;
+        i -= zeros;
+        if (i == 0) {
+            break;
+        }
+        VERIFY_CHECK((f & 1) == 1);
+        VERIFY_CHECK((g & 1) == 1);
+        if (eta < 0) {
+            uint32_t tmp;
+            eta = -eta;
+            tmp = f; f = g; g = -tmp;
+            tmp = u; u = q; q = -tmp;
+            tmp = v; v = r; r = -tmp;
+        }
+        /* Cancel up to 8 bits of g, w = -g/f mod 2^8. */
+        limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+        m = (UINT32_MAX >> (32 - limit)) & 255U;
+        w = (g * inv256[(f >> 1) & 127]) & m;
+        g += f * w;
+        q += u * w;
+        r += v * w;
+        VERIFY_CHECK((g & m) == 0);
+    }
+    t->u = (int32_t)u;
+    t->v = (int32_t)v;
+    t->q = (int32_t)q;
+    t->r = (int32_t)r;
+    return eta;
+}
+
+/* Compute (t/2^30) * [d, e] mod modulus, where d and e are in (-2*modulus, modulus). The result is in
+ * the same range. A multiple of the modulus is added first to make the sums divisible by 2^30. */
+static void secp256k1_modinv32_update_de_30(secp256k1_modinv32_signed30_t *d, secp256k1_modinv32_signed30_t *e, const secp256k1_modinv32_trans2x2_t *t, const secp256k1_modinv32_modinfo_t *modinfo) {
+    const uint32_t M30 = UINT32_MAX >> 2;
+    const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int32_t di, ei, md, me, sd, se;
+    int64_t cd, ce;
+    int i;
+
+    /* Correct for negative d and e by adding u*modulus (resp. v, q, r) when they are negative. */
+    sd = d->v[8] >> 31;
+    se = e->v[8] >> 31;
+    md = (u & sd) + (v & se);
+    me = (q & sd) + (r & se);
+    di = d->v[0];
+    ei = e->v[0];
+    cd = (int64_t)u * di + (int64_t)v * ei;
+    ce = (int64_t)q * di + (int64_t)r * ei;
+    /* Choose md and me such that the bottom 30 bits of cd and ce cancel out. */
+    md -= (modinfo->modulus_inv30 * (uint32_t)cd + md) & M30;
+    me -= (modinfo->modulus_inv30 * (uint32_t)ce + me) & M30;
+    cd += (int64_t)modinfo->modulus.v[0] * md;
+    ce += (int64_t)modinfo->modulus.v[0] * me;
+    VERIFY_CHECK(((uint32_t)cd & M30) == 0);
+    VERIFY_CHECK(((uint32_t)ce & M30) == 0);
+    cd >>= 30;
+    ce >>= 30;
+    for (i = 1; i < 9; i++) {
+        di = d->v[i];
+        ei = e->v[i];
+        cd += (int64_t)u * di + (int64_t)v * ei;
+        ce += (int64_t)q * di + (int64_t)r * ei;
+        cd += (int64_t)modinfo->modulus.v[i] * md;
+        ce += (int64_t)modinfo->modulus.v[i] * me;
+        d->v[i - 1] = (int32_t)((uint32_t)cd & M30);
+        e->v[i - 1] = (int32_t)((uint32_t)ce & M30);
+        cd >>= 30;
+        ce >>= 30;
+    }
+    d->v[8] = (int32_t)cd;
+    e->v[8] = (int32_t)ce;
+}
+
+/* Compute (t/2^30) * [f, g] on the bottom len limbs of f and g, which are exactly divisible. */
+static void secp256k1_modinv32_update_fg_30(int len, secp256k1_modinv32_signed30_t *f, secp256k1_modinv32_signed30_t *g, const secp256k1_modinv32_trans2x2_t *t) {
+    const uint32_t M30 = UINT32_MAX >> 2;
+    const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int32_t fi, gi;
+    int64_t cf, cg;
+    int i;
+
+    fi = f->v[0];
+    gi = g->v[0];
+    cf = (int64_t)u * fi + (int64_t)v * gi;
+    cg = (int64_t)q * fi + (int64_t)r * gi;
+    VERIFY_CHECK(((uint32_t)cf & M30) == 0);
+    VERIFY_CHECK(((uint32_t)cg & M30) == 0);
+    cf >>= 30;
+    cg >>= 30;
+    for (i = 1; i < len; i++) {
+        fi = f->v[i];
+        gi = g->v[i];
+        cf += (int64_t)u * fi + (int64_t)v * gi;
+        cg += (int64_t)q * fi + (int64_t)r * gi;
+        f->v[i - 1] = (int32_t)((uint32_t)cf & M30);
+        g->v[i - 1] = (int32_t)((uint32_t)cg & M30);
+        cf >>= 30;
+        cg >>= 30;
+    }
+    f->v[len - 1] = (int32_t)cf;
+    g->v[len - 1] = (int32_t)cg;
+}
+
+/* Take r in (-2*modulus, modulus), negate it if sign is negative, and reduce it to [0, modulus) with
+ * limbs in [0, 2^30). Constant time. */
+static void secp256k1_modinv32_normalize_30(secp256k1_modinv32_signed30_t *r, int32_t sign, const secp256k1_modinv32_modinfo_t *modinfo) {
+    const int32_t M30 = (int32_t)(UINT32_MAX >> 2);
+    volatile int32_t cond_add, cond_negate;
+    int i;
+
+    /* Add the modulus if r is negative, then negate if requested, giving a value in (-modulus, modulus). */
+    cond_add = r->v[8] >> 31;
+    cond_negate = sign >> 31;
+    for (i = 0; i < 9; i++) {
+        r->v[i] += modinfo->modulus.v[i] & cond_add;
+        r->v[i] = (r->v[i] ^ cond_negate) - cond_negate;
+    }
+    for (i = 0; i < 8; i++) {
+        r->v[i + 1] += r->v[i] >> 30;
+        r->v[i] &= M30;
+    }
+
+    /* Add the modulus again if the result is still negative, giving a value in [0, modulus). */
+    cond_add = r->v[8] >> 31;
+    for (i = 0; i < 9; i++) {
+        r->v[i] += modinfo->modulus.v[i] & cond_add;
+    }
+    for (i = 0; i < 8; i++) {
+        r->v[i + 1] += r->v[i] >> 30;
+        r->v[i] &= M30;
+    }
+    VERIFY_CHECK(r->v[8] >> 30 == 0);
+}
+
+static void secp256k1_modinv32(secp256k1_modinv32_signed30_t *x, const secp256k1_modinv32_modinfo_t *modinfo) {
+    /* Start with d=0, e=1, f=modulus, g=x, zeta=-1 (delta=1/2). */
+    secp256k1_modinv32_signed30_t d = {{0, 0, 0, 0, 0, 0, 0, 0, 0}};
+    secp256k1_modinv32_signed30_t e = {{1, 0, 0, 0, 0, 0, 0, 0, 0}};
+    secp256k1_modinv32_signed30_t f = modinfo->modulus;
+    secp256k1_modinv32_signed30_t g = *x;
+    int32_t zeta = -1;
+    int i;
+
+    /* 20 batches of 30 divsteps are 600 divsteps; 590 suffice for 256-bit inputs. */
+    for (i = 0; i < 20; ++i) {
+        secp256k1_modinv32_trans2x2_t t;
+        zeta = secp256k1_modinv32_divsteps_30(zeta, f.v[0], g.v[0], &t);
+        secp256k1_modinv32_update_de_30(&d, &e, &t, modinfo);
+        secp256k1_modinv32_update_fg_30(9, &f, &g, &t);
+    }
+
+    /* Now g = 0 and f = +/-gcd = +/-1 (or +/-modulus if x was zero, in which case d is zero too),
+     * so d = +/-1/x. */
+    secp256k1_modinv32_normalize_30(&d, f.v[8], modinfo);
+    *x = d;
+}
+
+static void secp256k1_modinv32_var(secp256k1_modinv32_signed30_t *x, const secp256k1_modinv32_modinfo_t *modinfo) {
+    secp256k1_modinv32_signed30_t d = {{0, 0, 0, 0, 0, 0, 0, 0, 0}};
+    secp256k1_modinv32_signed30_t e = {{1, 0, 0, 0, 0, 0, 0, 0, 0}};
+    secp256k1_modinv32_signed30_t f = modinfo->modulus;
+    secp256k1_modinv32_signed30_t g = *x;
+    int32_t eta = -1;
+    int32_t cond, fn, gn;
+    int j, len = 9;
+
+    for (;;) {
+        secp256k1_modinv32_trans2x2_t t;
+        eta = secp256k1_modinv32_divsteps_30_var(eta, f.v[0], g.v[0], &t);
+        secp256k1_modinv32_update_de_30(&d, &e, &t, modinfo);
+        secp256k1_modinv32_update_fg_30(len, &f, &g, &t);
+        /* Stop once g is zero. */
+        if (g.v[0] == 0) {
+            cond = 0;
+            for (j = 1; j < len; ++j) {
+                cond |= g.v[j];
+            }
+            if (cond == 0) {
+                break;
+            }
+        }
+        /* If the top limbs of both f and g are 0 or -1, fold them into the limb below and shorten. */
+        fn = f.v[len - 1];
+        gn = g.v[len - 1];
+        cond = ((int32_t)len - 2) >> 31;
+        cond |= fn ^ (fn >> 31);
+        cond |= gn ^ (gn >> 31);
+        if (cond == 0) {
+            f.v[len - 2] |= (int32_t)((uint32_t)fn << 30);
+            g.v[len - 2] |= (int32_t)((uint32_t)gn << 30);
+            --len;
+        }
+    }
+
+    secp256k1_modinv32_normalize_30(&d, f.v[len - 1], modinfo);
+    *x = d;
+}
+
+#endif
@@ -0,0 +1,42 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille                                   *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_MODINV64_H_
+#define _SECP256K1_MODINV64_H_
+
+#if defined HAVE_CONFIG_H
+#include "libsecp256k1-config.h"
+#endif
+
+#include "util.h"
+
+#if !defined(HAVE___INT128)
+#error "modinv64 requires __int128 support"
+#endif
+
+/** A signed 62-bit limb representation of integers: the value is sum(v[i] * 2^(62*i), i=0..4). */
+typedef struct {
+    int64_t v[5];
+} secp256k1_modinv64_signed62_t;
+
+typedef struct {
+    /* The modulus in signed62 notation, must be odd and in [3, 2^256]. */
+    secp256k1_modinv64_signed62_t modulus;
+
+    /* modulus^{-1} mod 2^62 */
+    uint64_t modulus_inv62;
+} secp256k1_modinv64_modinfo_t;
+
+/** Replace x with its modular inverse mod modinfo->modulus, using the Bernstein-Yang safegcd
+ *  algorithm. x must be in [0, modulus) with all limbs in [0, 2^62) (the top limb only needs to be
+ *  non-negative); the result is in the same form. If x is zero, the result is zero. Constant time
+ *  in x. */
+static void secp256k1_modinv64(secp256k1_modinv64_signed62_t *x, const secp256k1_modinv64_modinfo_t *modinfo);
+
+/** Same as secp256k1_modinv64, but variable time. */
+static void secp256k1_modinv64_var(secp256k1_modinv64_signed62_t *x, const secp256k1_modinv64_modinfo_t *modinfo);
+
+#endif
@@ -0,0 +1,285 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille                                   *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_MODINV64_IMPL_H_
+#define _SECP256K1_MODINV64_IMPL_H_
+
+#include "modinv64.h"
+
+#include "util.h"
+
+/* This file implements modular inversion based on the paper "Fast constant-time gcd computation and
+ * modular inversion" by Daniel J. Bernstein and Bo-Yin Yang.
+ *
+ * Every iteration computes a batch of divsteps on the bottom 62 bits of f and g only, collected in a
+ * 2x2 transition matrix t, and then applies t to the full f and g and to the coefficients d and e
+ * (which track f = d*x and g = e*x mod the modulus). Right shifts of negative values are assumed to
+ * be arithmetic. */
+
+/* A 2x2 matrix [[u, v], [q, r]] of divstep transitions, scaled by 2^62. */
+typedef struct {
+    int64_t u, v, q, r;
+} secp256k1_modinv64_trans2x2_t;
+
+/* Compute the transition matrix and zeta for 59 divsteps (where zeta = -(delta+1/2)), starting from
+ * the bottom 62 bits of f0 and g0. The returned matrix is scaled by 2^62. Constant time. */
+static int64_t secp256k1_modinv64_divsteps_59(int64_t zeta, uint64_t f0, uint64_t g0, secp256k1_modinv64_trans2x2_t *t) {
+    /* u,v,q,r start as the identity matrix scaled by 8, so that after 59 steps it is scaled by 2^62. */
+    uint64_t u = 8, v = 0, q = 0, r = 8;
+    volatile uint64_t c1, c2;
+    uint64_t mask1, mask2, f = f0, g = g0, x, y, z;
+    int i;
+
+    for (i = 3; i < 62; ++i) {
+        VERIFY_CHECK((f & 1) == 1);
+        /* If zeta < 0 (delta > 0) and g is odd, (f, g) becomes (g, (g - f) / 2); otherwise, if g is
+         * odd, (f, g) becomes (f, (g + f) / 2), and if g is even (f, g / 2). */
+        c1 = zeta >> 63;
+        mask1 = c1;
+        c2 = g & 1;
+        mask2 = -c2;
+        x = (f ^ mask1) - mask1;
+        y = (u ^ mask1) - mask1;
+        z = (v ^ mask1) - mask1;
+        g += x & mask2;
+        q += y & mask2;
+        r += z & mask2;
+        mask1 &= mask2;
+        zeta = (zeta ^ mask1) - 1;
+        f += g & mask1;
+        u += q & mask1;
+        v += r & mask1;
+        g >>= 1;
+        u <<= 1;
+        v <<= 1;
+    }
+    t->u = (int64_t)u;
+    t->v = (int64_t)v;
+    t->q = (int64_t)q;
+    t->r = (int64_t)r;
+    return zeta;
+}
+
+/* Compute the transition matrix and eta for 62 divsteps (where eta = -delta), starting from the
+ * bottom 62 bits of f0 and g0. The returned matrix is scaled by 2^62. Variable time: runs of zero
+ * bits in g are skipped at once, and g is eliminated several bits at a time. */
+static int64_t secp256k1_modinv64_divsteps_62_var(int64_t eta, uint64_t f0, uint64_t g0, secp256k1_modinv64_trans2x2_t *t) {
+    uint64_t u = 1, v = 0, q = 0, r = 1;
+    uint64_t f = f0, g = g0, m, w;
+    int i = 62, limit, zeros;
+
+    for (;;) {
+        /* Use a sentinel bit to count zeros only up to i. */
+        zeros = secp256k1_ctz64_var(g | (UINT64_MAX << i));
+        g >>= zeros;
+        u <<= zeros;
+        v <<= zeros;
+        eta -= zeros;
+        i -= zeros;
+        if (i == 0) {
+            break;
+        }
+        VERIFY_CHECK((f & 1) == 1);
+        VERIFY_CHECK((g & 1) == 1);
+        if (eta < 0) {
+            uint64_t tmp;
+            eta = -eta;
+            tmp = f; f = g; g = -tmp;
+            tmp = u; u = q; q = -tmp;
+            tmp = v; v = r; r = -tmp;
+            /* Cancel up to 6 bits of g, as eta can be large after a swap. w = -g/f mod 2^6, using
+             * f^-1 = f * (2 - f^2) mod 2^6. */
+            limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+            m = (UINT64_MAX >> (64 - limit)) & 63U;
+            w = (f * g * (f * f - 2)) & m;
+        } else {
+            /* Cancel up to 4 bits of g. w = -g/f mod 2^4, using f^-1 = f + ((f + 1) & 4) * 2 mod 2^4. */
+            limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+            m = (UINT64_MAX >> (64 - limit)) & 15U;
+            w = f + (((f + 1) & 4) << 1);
+            w = (-w * g) & m;
+        }
+        g += f * w;
+        q += u * w;
+        r += v * w;
+        VERIFY_CHECK((g & m) == 0);
+    }
+    t->u = (int64_t)u;
+    t->v = (int64_t)v;
+    t->q = (int64_t)q;
+    t->r = (int64_t)r;
+    return eta;
+}
+
+/* Compute (t/2^62) * [d, e] mod modulus, where d and e are in (-2*modulus, modulus). The result is in
+ * the same range. A multiple of the modulus is added first to make the sums divisible by 2^62. */
+static void secp256k1_modinv64_update_de_62(secp256k1_modinv64_signed62_t *d, secp256k1_modinv64_signed62_t *e, const secp256k1_modinv64_trans2x2_t *t, const secp256k1_modinv64_modinfo_t *modinfo) {
+    const uint64_t M62 = UINT64_MAX >> 2;
+    const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int64_t di, ei, md, me, sd, se;
+    int128_t cd, ce;
+    int i;
+
+    /* Correct for negative d and e by adding u*modulus (resp. v, q, r) when they are negative. */
+    sd = d->v[4] >> 63;
+    se = e->v[4] >> 63;
+    md = (u & sd) + (v & se);
+    me = (q & sd) + (r & se);
+    di = d->v[0];
+    ei = e->v[0];
+    cd = (int128_t)u * di + (int128_t)v * ei;
+    ce = (int128_t)q * di + (int128_t)r * ei;
+    /* Choose md and me such that the bottom 62 bits of cd and ce cancel out. */
+    md -= (modinfo->modulus_inv62 * (uint64_t)cd + md) & M62;
+    me -= (modinfo->modulus_inv62 * (uint64_t)ce + me) & M62;
+    cd += (int128_t)modinfo->modulus.v[0] * md;
+    ce += (int128_t)modinfo->modulus.v[0] * me;
+    VERIFY_CHECK(((uint64_t)cd & M62) == 0);
+    VERIFY_CHECK(((uint64_t)ce & M62) == 0);
+    cd >>= 62;
+    ce >>= 62;
+    for (i = 1; i < 5; i++) {
+        di = d->v[i];
+        ei = e->v[i];
+        cd += (int128_t)u * di + (int128_t)v * ei;
+        ce += (int128_t)q * di + (int128_t)r * ei;
+        cd += (int128_t)modinfo->modulus.v[i] * md;
+        ce += (int128_t)modinfo->modulus.v[i] * me;
+        d->v[i - 1] = (int64_t)((uint64_t)cd & M62);
+        e->v[i - 1] = (int64_t)((uint64_t)ce & M62);
+        cd >>= 62;
+        ce >>= 62;
+    }
+    d->v[4] = (int64_t)cd;
+    e->v[4] = (int64_t)ce;
+}
+
+/* Compute (t/2^62) * [f, g] on the bottom len limbs of f and g, which are exactly divisible. */
+static void secp256k1_modinv64_update_fg_62(int len, secp256k1_modinv64_signed62_t *f, secp256k1_modinv64_signed62_t *g, const secp256k1_modinv64_trans2x2_t *t) {
+    const uint64_t M62 = UINT64_MAX >> 2;
+    const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int64_t fi, gi;
+    int128_t cf, cg;
+    int i;
+
+    fi = f->v[0];
+    gi = g->v[0];
+    cf = (int128_t)u * fi + (int128_t)v * gi;
+    cg = (int128_t)q * fi + (int128_t)r * gi;
+    VERIFY_CHECK(((uint64_t)cf & M62) == 0);
+    VERIFY_CHECK(((uint64_t)cg & M62) == 0);
+    cf >>= 62;
+    cg >>= 62;
+    for (i = 1; i < len; i++) {
+        fi = f->v[i];
+        gi = g->v[i];
+        cf += (int128_t)u * fi + (int128_t)v * gi;
+        cg += (int128_t)q * fi + (int128_t)r * gi;
+        f->v[i - 1] = (int64_t)((uint64_t)cf & M62);
+        g->v[i - 1] = (int64_t)((uint64_t)cg & M62);
+        cf >>= 62;
+        cg >>= 62;
+    }
+    f->v[len - 1] = (int64_t)cf;
+    g->v[len - 1] = (int64_t)cg;
+}
+
+/* Take r in (-2*modulus, modulus), negate it if sign is negative, and reduce it to [0, modulus) with
+ * limbs in [0, 2^62). Constant time. */
+static void secp256k1_modinv64_normalize_62(secp256k1_modinv64_signed62_t *r, int64_t sign, const secp256k1_modinv64_modinfo_t *modinfo) {
+    const int64_t M62 = (int64_t)(UINT64_MAX >> 2);
+    volatile int64_t cond_add, cond_negate;
+    int i;
+
+    /* Add the modulus if r is negative, then negate if requested, giving a value in (-modulus, modulus). */
+    cond_add = r->v[4] >> 63;
+    cond_negate = sign >> 63;
+    for (i = 0; i < 5; i++) {
+        r->v[i] += modinfo->modulus.v[i] & cond_add;
+        r->v[i] = (r->v[i] ^ cond_negate) - cond_negate;
+    }
+    for (i = 0; i < 4; i++) {
+        r->v[i + 1] += r->v[i] >> 62;
+        r->v[i] &= M62;
+    }
+
+    /* Add the modulus again if the result is still negative, giving a value in [0, modulus). */
+    cond_add = r->v[4] >> 63;
+    for (i = 0; i < 5; i++) {
+        r->v[i] += modinfo->modulus.v[i] & cond_add;
+    }
+    for (i = 0; i < 4; i++) {
+        r->v[i + 1] += r->v[i] >> 62;
+        r->v[i] &= M62;
+    }
+    VERIFY_CHECK(r->v[4] >> 62 == 0);
+}
+
+static void secp256k1_modinv64(secp256k1_modinv64_signed62_t *x, const secp256k1_modinv64_modinfo_t *modinfo) {
+    /* Start with d=0, e=1, f=modulus, g=x, zeta=-1 (delta=1/2). */
+    secp256k1_modinv64_signed62_t d = {{0, 0, 0, 0, 0}};
+    secp256k1_modinv64_signed62_t e = {{1, 0, 0, 0, 0}};
+    secp256k1_modinv64_signed62_t f = modinfo->modulus;
+    secp256k1_modinv64_signed62_t g = *x;
+    int64_t zeta = -1;
+    int i;
+
+    /* 10 batches of 59 divsteps are 590 divsteps, which suffices for 256-bit inputs. */
+    for (i = 0; i < 10; ++i) {
+        secp256k1_modinv64_trans2x2_t t;
+        zeta = secp256k1_modinv64_divsteps_59(zeta, f.v[0], g.v[0], &t);
+        secp256k1_modinv64_update_de_62(&d, &e, &t, modinfo);
+        secp256k1_modinv64_update_fg_62(5, &f, &g, &t);
+    }
+
+    /* Now g = 0 and f = +/-gcd = +/-1 (or +/-modulus if x was zero, in which case d is zero too),
+     * so d = +/-1/x. */
+    secp256k1_modinv64_normalize_62(&d, f.v[4], modinfo);
+    *x = d;
+}
+
+static void secp256k1_modinv64_var(secp256k1_modinv64_signed62_t *x, const secp256k1_modinv64_modinfo_t *modinfo) {
+    secp256k1_modinv64_signed62_t d = {{0, 0, 0, 0, 0}};
+    secp256k1_modinv64_signed62_t e = {{1, 0, 0, 0, 0}};
+    secp256k1_modinv64_signed62_t f = modinfo->modulus;
+    secp256k1_modinv64_signed62_t g = *x;
+    int64_t eta = -1;
+    int64_t cond, fn, gn;
+    int j, len = 5;
+
+    for (;;) {
+        secp256k1_modinv64_trans2x2_t t;
+        eta = secp256k1_modinv64_divsteps_62_var(eta, f.v[0], g.v[0], &t);
+        secp256k1_modinv64_update_de_62(&d, &e, &t, modinfo);
+        secp256k1_modinv64_update_fg_62(len, &f, &g, &t);
+        /* Stop once g is zero. */
+        if (g.v[0] == 0) {
+            cond = 0;
+            for (j = 1; j < len; ++j) {
+                cond |= g.v[j];
+            }
+            if (cond == 0) {
+                break;
+            }
+        }
+        /* If the top limbs of both f and g are 0 or -1, fold them into the limb below and shorten. */
+        fn = f.v[len - 1];
+        gn = g.v[len - 1];
+        cond = ((int64_t)len - 2) >> 63;
+        cond |= fn ^ (fn >> 63);
+        cond |= gn ^ (gn >> 63);
+        if (cond == 0) {
+            f.v[len - 2] |= (int64_t)((uint64_t)fn << 62);
+            g.v[len - 2] |= (int64_t)((uint64_t)gn << 62);
+            --len;
+        }
+    }
+
+    secp256k1_modinv64_normalize_62(&d, f.v[len - 1], modinfo);
+    *x = d;
+}
+
+#endif
@@ -9,6 +9,7 @@
 
 #include "scalar.h"
 #include "group.h"
+#include "scratch.h"
 
 typedef struct {
     secp256k1_ge_storage_t (*prec)[1005];
@@ -16,16 +17,62 @@ typedef struct {
 
 
 static void secp256k1_rangeproof_context_init(secp256k1_rangeproof_context_t* ctx);
-static void secp256k1_rangeproof_context_build(secp256k1_rangeproof_context_t* ctx);
-static void secp256k1_rangeproof_context_clone(secp256k1_rangeproof_context_t *dst,
-                                               const secp256k1_rangeproof_context_t* src);
-static void secp256k1_rangeproof_context_clear(secp256k1_rangeproof_context_t* ctx);
+/** Build the table, allocated with alloc (or malloc if that is NULL), which must also be passed to
+ *  secp256k1_rangeproof_context_clear. */
+static void secp256k1_rangeproof_context_build(secp256k1_rangeproof_context_t* ctx, const secp256k1_allocator_t *alloc);
+/** Build the table in independent segments (one per power of ten), as secp256k1_ecmult_context_build_alloc
+ *  and secp256k1_ecmult_context_build_segment do for the ecmult tables. */
+static int secp256k1_rangeproof_context_build_alloc(secp256k1_rangeproof_context_t* ctx, const secp256k1_allocator_t *alloc);
+static void secp256k1_rangeproof_context_build_segment(secp256k1_rangeproof_context_t* ctx, int segment);
+static void secp256k1_rangeproof_context_clear(secp256k1_rangeproof_context_t* ctx, const secp256k1_allocator_t *alloc);
 static int secp256k1_rangeproof_context_is_built(const secp256k1_rangeproof_context_t* ctx);
 
+/** Scratch space needed by secp256k1_rangeproof_verify_impl, for the largest possible proof. */
+#define SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE (SECP256K1_SCRATCH_ROUND(128 * sizeof(secp256k1_gej_t)) + \
+ 3 * SECP256K1_SCRATCH_ROUND(128 * sizeof(secp256k1_scalar_t)) + 4096)
+
+/** Verify (and with a nonce, rewind) a range proof. Temporaries are taken from scratch, which must
+ *  have SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE bytes available; fails if it does not. commit is the
+ *  serialized commitment; commit_ge is the same commitment already decompressed, or NULL. */
 static int secp256k1_rangeproof_verify_impl(const secp256k1_ecmult_context_t* ecmult_ctx,
  const secp256k1_ecmult_gen_context_t* ecmult_gen_ctx,
  const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx, const secp256k1_rangeproof_context_t* rangeproof_ctx,
+ secp256k1_scratch_t *scratch,
  unsigned char *blindout, uint64_t *value_out, unsigned char *message_out, int *outlen, const unsigned char *nonce,
- uint64_t *min_value, uint64_t *max_value, const unsigned char *commit, const unsigned char *proof, int plen);
+ uint64_t *min_value, uint64_t *max_value, const unsigned char *commit, const secp256k1_ge_t *commit_ge,
+ const unsigned char *proof, int plen);
+
+/** Verify n range proofs, with their ring signatures checked together. Fails if scratch cannot hold the
+ *  temporaries of a single proof. commit_ge is an array of the n commitments already decompressed, or NULL. */
+static int secp256k1_rangeproof_verify_batch_impl(const secp256k1_ecmult_context_t* ecmult_ctx,
+ const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx, const secp256k1_rangeproof_context_t* rangeproof_ctx,
+ secp256k1_scratch_t *scratch, uint64_t *min_value, uint64_t *max_value, const unsigned char * const *commit,
+ const secp256k1_ge_t *commit_ge, const unsigned char * const *proof, const int *plen, size_t n);
+
+/** A parsed range proof whose rings can be verified in parts, possibly on several threads. */
+typedef struct {
+    secp256k1_gej_t pubs[128];
+    secp256k1_scalar_t s[128];
+    unsigned char m[32];
+    const unsigned char *e0; /* points into the proof */
+    int rsizes[32];
+    int rings;
+    uint64_t min_value;
+    uint64_t max_value;
+    unsigned char rbuf[33 * 32]; /* the last point of every ring, once its part is done */
+} secp256k1_rangeproof_split_t;
+
+/** Decode a range proof and expand its pubkeys into split, doing everything but the ring signature. The proof must
+ *  stay valid until secp256k1_rangeproof_verify_split_finish. Returns 0 if the proof is malformed. */
+static int secp256k1_rangeproof_verify_split_init(const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx,
+ const secp256k1_rangeproof_context_t* rangeproof_ctx, secp256k1_rangeproof_split_t *split, const unsigned char *commit,
+ const unsigned char *proof, int plen);
+
+/** Verify rings first..last-1 of an initialized split. */
+static int secp256k1_rangeproof_verify_split_part(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_rangeproof_split_t *split,
+ int first, int last);
+
+/** Once parts covering every ring have passed, check the challenge that links them. */
+static int secp256k1_rangeproof_verify_split_finish(const secp256k1_rangeproof_split_t *split);
 
 #endif
@@ -10,7 +10,11 @@
 #include "scalar.h"
 #include "group.h"
 #include "rangeproof.h"
+#include "scratch_impl.h"
 #include "hash_impl.h"
+#ifdef USE_ECMULT_STATIC_PRECOMPUTATION
+#include "ecmult_static_context.h"
+#endif
 
 static const int secp256k1_rangeproof_offsets[20] = {
       0,  96, 189, 276, 360, 438, 510, 579, 642,
@@ -22,95 +26,90 @@ static void secp256k1_rangeproof_context_init(secp256k1_rangeproof_context_t *ct
     ctx->prec = NULL;
 }
 
-static void secp256k1_rangeproof_context_build(secp256k1_rangeproof_context_t *ctx) {
+static int secp256k1_rangeproof_context_build_alloc(secp256k1_rangeproof_context_t *ctx, const secp256k1_allocator_t *alloc) {
+    if (ctx->prec != NULL) {
+        return 0;
+    }
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    ctx->prec = (secp256k1_ge_storage_t (*)[1005])secp256k1_allocator_malloc(alloc, sizeof(*ctx->prec));
+    return ctx->prec != NULL ? 19 : 0;
+#else
+    (void)alloc;
+    ctx->prec = (secp256k1_ge_storage_t (*)[1005])secp256k1_rangeproof_static_context;
+    return 0;
+#endif
+}
+
+/* Segment i holds the multiples of -10^i*G2, from entry secp256k1_rangeproof_offsets[i] on. */
+static void secp256k1_rangeproof_context_build_segment(secp256k1_rangeproof_context_t *ctx, int segment) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
     secp256k1_ge_t *prec;
     secp256k1_gej_t *precj;
     secp256k1_gej_t gj;
     secp256k1_gej_t one;
-    int i, pos;
-
-    if (ctx->prec != NULL) {
-        return;
-    }
+    int i, pos, pmax;
 
-    precj = (secp256k1_gej_t (*))checked_malloc(sizeof(*precj) * 1005);
-    if (precj == NULL) {
-        return;
-    }
-    prec = (secp256k1_ge_t (*))checked_malloc(sizeof(*prec) * 1005);
-    if (prec == NULL) {
-        free(precj);
-        return;
-    }
+    VERIFY_CHECK(segment >= 0 && segment < 19);
+    pmax = secp256k1_rangeproof_offsets[segment + 1] - secp256k1_rangeproof_offsets[segment];
+    VERIFY_CHECK(pmax % 3 == 0);
+    precj = (secp256k1_gej_t (*))checked_malloc(sizeof(*precj) * pmax);
+    prec = (secp256k1_ge_t (*))checked_malloc(sizeof(*prec) * pmax);
 
-    /* get the generator */
+    /* get the generator, times -10^segment */
     secp256k1_gej_set_ge(&one, &secp256k1_ge_const_g2);
     secp256k1_gej_neg(&one, &one);
-
-    /* compute prec. */
-    pos = 0;
-    for (i = 0; i < 19; i++) {
-        int pmax;
-        pmax = secp256k1_rangeproof_offsets[i + 1];
-        gj = one;
-        while (pos < pmax) {
-            precj[pos] = gj;
-            pos++;
-            secp256k1_gej_double_var(&precj[pos], &gj, NULL);
-            pos++;
-            secp256k1_gej_add_var(&precj[pos], &precj[pos - 1], &gj, NULL);
-            pos++;
-            if (pos < pmax - 1) {
-                secp256k1_gej_double_var(&gj, &precj[pos - 2], NULL);
-            }
-        }
-        if (i < 18) {
-            secp256k1_gej_double_var(&gj, &one, NULL);
-            one = gj;
-            secp256k1_gej_double_var(&gj, &gj, NULL);
-            secp256k1_gej_double_var(&gj, &gj, NULL);
-            secp256k1_gej_add_var(&one, &one, &gj, NULL);
-        }
+    for (i = 0; i < segment; i++) {
+        secp256k1_gej_double_var(&gj, &one, NULL);
+        one = gj;
+        secp256k1_gej_double_var(&gj, &gj, NULL);
+        secp256k1_gej_double_var(&gj, &gj, NULL);
+        secp256k1_gej_add_var(&one, &one, &gj, NULL);
     }
-    VERIFY_CHECK(pos == 1005);
-    secp256k1_ge_set_all_gej_var(1005, prec, precj);
 
-    free(precj);
-
-    ctx->prec = (secp256k1_ge_storage_t (*)[1005])checked_malloc(sizeof(*ctx->prec));
-    if (ctx->prec == NULL) {
-        free(prec);
-        return;
+    /* compute prec: 1, 2 and 3 times one, times each power of 4. */
+    precj[0] = one;
+    for (pos = 0; pos < pmax; pos += 3) {
+        if (pos > 0) {
+            secp256k1_gej_double_var(&precj[pos], &precj[pos - 2], NULL);
+        }
+        secp256k1_gej_double_var(&precj[pos + 1], &precj[pos], NULL);
+        secp256k1_gej_add_var(&precj[pos + 2], &precj[pos + 1], &precj[pos], NULL);
     }
-
-    for (i = 0; i < 1005; i++) {
-        secp256k1_ge_to_storage(&(*ctx->prec)[i], &prec[i]);
+    secp256k1_ge_set_all_gej_var(pmax, prec, precj);
+    for (i = 0; i < pmax; i++) {
+        secp256k1_ge_to_storage(&(*ctx->prec)[secp256k1_rangeproof_offsets[segment] + i], &prec[i]);
     }
+    free(precj);
     free(prec);
+#else
+    (void)ctx;
+    (void)segment;
+#endif
 }
 
+static void secp256k1_rangeproof_context_build(secp256k1_rangeproof_context_t *ctx, const secp256k1_allocator_t *alloc) {
+    int segments = secp256k1_rangeproof_context_build_alloc(ctx, alloc);
+    int i;
+    for (i = 0; i < segments; i++) {
+        secp256k1_rangeproof_context_build_segment(ctx, i);
+    }
+}
 
 static int secp256k1_rangeproof_context_is_built(const secp256k1_rangeproof_context_t* ctx) {
     return ctx->prec != NULL;
 }
 
-static void secp256k1_rangeproof_context_clone(secp256k1_rangeproof_context_t *dst,
-                                               const secp256k1_rangeproof_context_t *src) {
-    if (src->prec == NULL) {
-        dst->prec = NULL;
-    } else {
-        dst->prec = (secp256k1_ge_storage_t (*)[1005])checked_malloc(sizeof(*dst->prec));
-        memcpy(dst->prec, src->prec, sizeof(*dst->prec));
-    }
-}
-
-static void secp256k1_rangeproof_context_clear(secp256k1_rangeproof_context_t *ctx) {
-    free(ctx->prec);
+static void secp256k1_rangeproof_context_clear(secp256k1_rangeproof_context_t *ctx, const secp256k1_allocator_t *alloc) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    secp256k1_allocator_free(alloc, ctx->prec, sizeof(*ctx->prec));
+#else
+    (void)alloc;
+#endif
     ctx->prec = NULL;
 }
 
 SECP256K1_INLINE static void secp256k1_rangeproof_pub_expand(const secp256k1_rangeproof_context_t *ctx, secp256k1_gej_t *pubs,
- int exp, int *rsizes, int rings) {
+ int exp, const int *rsizes, int rings) {
     secp256k1_ge_t ge;
     secp256k1_ge_storage_t *basis;
     int i;
@@ -254,6 +253,28 @@ SECP256K1_INLINE static int secp256k1_range_proveparams(uint64_t *v, int *rings,
     return 1;
 }
 
+/* Write the header of a proof with the given parameters (as computed by secp256k1_range_proveparams) to proof, which
+ * must have room for 10 bytes, and return its length. */
+SECP256K1_INLINE static int secp256k1_rangeproof_header_serialize(unsigned char *proof, int exp, int mantissa, int rsize0, uint64_t min_value) {
+    int len;
+    int i;
+    len = 0;
+    proof[len] = (rsize0 > 1 ? (64 | exp) : 0) | (min_value ? 32 : 0);
+    len++;
+    if (rsize0 > 1) {
+        VERIFY_CHECK(mantissa > 0 && mantissa <= 64);
+        proof[len] = mantissa - 1;
+        len++;
+    }
+    if (min_value) {
+        for (i = 0; i < 8; i++) {
+            proof[len + i] = (min_value >> ((7-i) * 8)) & 255;
+        }
+        len += 8;
+    }
+    return len;
+}
+
 /* strawman interface, writes proof in proof, a buffer of plen, proves with respect to min_value the range for commit which has the provided blinding factor and value. */
 SECP256K1_INLINE static int secp256k1_rangeproof_sign_impl(const secp256k1_ecmult_context_t* ecmult_ctx,
  const secp256k1_ecmult_gen_context_t* ecmult_gen_ctx, const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx,
@@ -263,6 +284,8 @@ SECP256K1_INLINE static int secp256k1_rangeproof_sign_impl(const secp256k1_ecmul
     secp256k1_scalar_t s[128];     /* Signatures in our proof, most forged. */
     secp256k1_scalar_t sec[32];    /* Blinding factors for the correct digits. */
     secp256k1_scalar_t k[32];      /* Nonces for our non-forged signatures. */
+    secp256k1_fe_t dz[32];         /* Z coordinates of the digit commitments, and their inverses. */
+    secp256k1_fe_t dzi[32];
     secp256k1_scalar_t stmp;
     secp256k1_sha256_t sha256_m;
     unsigned char prep[4096];
@@ -276,28 +299,16 @@ SECP256K1_INLINE static int secp256k1_rangeproof_sign_impl(const secp256k1_ecmul
     int secidx[32];                /* Which digit is the correct one. */
     int len;                       /* Number of bytes used so far. */
     int i;
+    int j;
     int overflow;
     int npub;
-    len = 0;
     if (*plen < 65 || min_value > value || min_bits > 64 || min_bits < 0 || exp < -1 || exp > 18) {
         return 0;
     }
     if (!secp256k1_range_proveparams(&v, &rings, rsizes, &npub, secidx, &min_value, &mantissa, &scale, &exp, &min_bits, value)) {
         return 0;
     }
-    proof[len] = (rsizes[0] > 1 ? (64 | exp) : 0) | (min_value ? 32 : 0);
-    len++;
-    if (rsizes[0] > 1) {
-        VERIFY_CHECK(mantissa > 0 && mantissa <= 64);
-        proof[len] = mantissa - 1;
-        len++;
-    }
-    if (min_value) {
-        for (i = 0; i < 8; i++) {
-            proof[len + i] = (min_value >> ((7-i) * 8)) & 255;
-        }
-        len += 8;
-    }
+    len = secp256k1_rangeproof_header_serialize(proof, exp, mantissa, rsizes[0], min_value);
     /* Do we have enough room for the proof? */
     if (*plen - len < 32 * (npub + rings - 1) + 32 + ((rings+6) >> 3)) {
         return 0;
@@ -353,21 +364,23 @@ SECP256K1_INLINE static int secp256k1_rangeproof_sign_impl(const secp256k1_ecmul
         if (secp256k1_gej_is_infinity(&pubs[npub])) {
             return 0;
         }
-        if (i < rings - 1) {
-            int size = 33;
-            secp256k1_ge_t c;
-            /*OPT: split loop and batch invert.*/
-            secp256k1_ge_set_gej_var(&c, &pubs[npub]);
-            if(!secp256k1_eckey_pubkey_serialize(&c, tmp, &size, 1)) {
-                return 0;
-            }
-            secp256k1_sha256_write(&sha256_m, tmp, 33);
-            signs[i>>3] |= (tmp[0] == 3) << (i&7);
-            memcpy(&proof[len], &tmp[1], 32);
-            len += 32;
-        }
+        dz[i] = pubs[npub].z;
         npub += rsizes[i];
     }
+    /* The digit commitments we send are public, so they can share a variable time batch inversion. */
+    secp256k1_fe_inv_all_var(rings - 1, dzi, dz);
+    for (i = 0, j = 0; i < rings - 1; j += rsizes[i], i++) {
+        int size = 33;
+        secp256k1_ge_t c;
+        secp256k1_ge_set_gej_zinv(&c, &pubs[j], &dzi[i]);
+        if(!secp256k1_eckey_pubkey_serialize(&c, tmp, &size, 1)) {
+            return 0;
+        }
+        secp256k1_sha256_write(&sha256_m, tmp, 33);
+        signs[i>>3] |= (tmp[0] == 3) << (i&7);
+        memcpy(&proof[len], &tmp[1], 32);
+        len += 32;
+    }
     secp256k1_rangeproof_pub_expand(rangeproof_ctx, pubs, exp, rsizes, rings);
     secp256k1_sha256_finalize(&sha256_m, tmp);
     if (!secp256k1_borromean_sign(ecmult_ctx, ecmult_gen_ctx, &proof[len], s, pubs, k, sec, rsizes, secidx, rings, tmp, 32)) {
@@ -409,13 +422,12 @@ SECP256K1_INLINE static void secp256k1_rangeproof_ch32xor(unsigned char *x, cons
     }
 }
 
+/* s_orig must have room for 128 scalars and prep for 4096 bytes. */
 SECP256K1_INLINE static int secp256k1_rangeproof_rewind_inner(secp256k1_scalar_t *blind, uint64_t *v,
- unsigned char *m, int *mlen, secp256k1_scalar_t *ev, secp256k1_scalar_t *s,
+ unsigned char *m, int *mlen, secp256k1_scalar_t *ev, secp256k1_scalar_t *s, secp256k1_scalar_t *s_orig, unsigned char *prep,
  int *rsizes, int rings, const unsigned char *nonce, const unsigned char *commit, const unsigned char *proof, int len) {
-    secp256k1_scalar_t s_orig[128];
     secp256k1_scalar_t sec[32];
     secp256k1_scalar_t stmp;
-    unsigned char prep[4096];
     unsigned char tmp[32];
     uint64_t value;
     int offset;
@@ -532,12 +544,14 @@ SECP256K1_INLINE static int secp256k1_rangeproof_rewind_inner(secp256k1_scalar_t
     return 1;
 }
 
-SECP256K1_INLINE static int secp256k1_rangeproof_getheader_impl(int *offset, int *exp, int *mantissa, uint64_t *scale,
+/* Decode the header at *offset, of which at most SECP256K1_RANGEPROOF_HEADER_MAX_SIZE bytes are read; only the first plen
+ * bytes of the proof need to be available. */
+SECP256K1_INLINE static int secp256k1_rangeproof_header_parse(int *offset, int *exp, int *mantissa, uint64_t *scale,
  uint64_t *min_value, uint64_t *max_value, const unsigned char *proof, int plen) {
     int i;
     int has_nz_range;
     int has_min;
-    if (plen < 65 || ((proof[*offset] & 128) != 0)) {
+    if (plen - *offset < 1 || ((proof[*offset] & 128) != 0)) {
         return 0;
     }
     has_nz_range = proof[*offset] & 64;
@@ -545,6 +559,9 @@ SECP256K1_INLINE static int secp256k1_rangeproof_getheader_impl(int *offset, int
     *exp = -1;
     *mantissa = 0;
     if (has_nz_range) {
+        if (plen - *offset < 2) {
+            return 0;
+        }
         *exp = proof[*offset] & 31;
         *offset += 1;
         if (*exp > 18) {
@@ -585,54 +602,153 @@ SECP256K1_INLINE static int secp256k1_rangeproof_getheader_impl(int *offset, int
     return 1;
 }
 
-/* Verifies range proof (len plen) for 33-byte commit, the min/max values proven are put in the min/max arguments; returns 0 on failure 1 on success.*/
-SECP256K1_INLINE static int secp256k1_rangeproof_verify_impl(const secp256k1_ecmult_context_t* ecmult_ctx,
- const secp256k1_ecmult_gen_context_t* ecmult_gen_ctx,
- const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx, const secp256k1_rangeproof_context_t* rangeproof_ctx,
- unsigned char *blindout, uint64_t *value_out, unsigned char *message_out, int *outlen, const unsigned char *nonce,
- uint64_t *min_value, uint64_t *max_value, const unsigned char *commit, const unsigned char *proof, int plen) {
-    secp256k1_gej_t accj;
-    secp256k1_gej_t pubs[128];
-    secp256k1_ge_t c;
-    secp256k1_scalar_t s[128];
-    secp256k1_scalar_t evalues[128]; /* Challenges, only used during proof rewind. */
-    secp256k1_sha256_t sha256_m;
-    int rsizes[32];
-    int ret;
-    int i;
-    int exp;
-    int mantissa;
-    int offset;
-    int rings;
-    int overflow;
-    int npub;
-    int offset_post_header;
-    uint64_t scale;
-    unsigned char signs[31];
-    unsigned char m[33];
-    const unsigned char *e0;
-    offset = 0;
-    if (!secp256k1_rangeproof_getheader_impl(&offset, &exp, &mantissa, &scale, min_value, max_value, proof, plen)) {
+SECP256K1_INLINE static int secp256k1_rangeproof_getheader_impl(int *offset, int *exp, int *mantissa, uint64_t *scale,
+ uint64_t *min_value, uint64_t *max_value, const unsigned char *proof, int plen) {
+    if (plen < 65) {
         return 0;
     }
-    offset_post_header = offset;
+    return secp256k1_rangeproof_header_parse(offset, exp, mantissa, scale, min_value, max_value, proof, plen);
+}
+
+/* Fill rsizes (room for 32 entries) with the ring sizes of a proof covering mantissa bits, and return the number of rings. */
+SECP256K1_INLINE static int secp256k1_rangeproof_ring_sizes(int *rsizes, int *npub, int mantissa) {
+    int i;
+    int rings;
     rings = 1;
     rsizes[0] = 1;
-    npub = 1;
+    *npub = 1;
     if (mantissa != 0) {
         rings = (mantissa >> 1);
         for (i = 0; i < rings; i++) {
             rsizes[i] = 4;
         }
-        npub = (mantissa >> 1) << 2;
+        *npub = (mantissa >> 1) << 2;
         if (mantissa & 1) {
             rsizes[rings] = 2;
-            npub += rsizes[rings];
+            *npub += rsizes[rings];
             rings++;
         }
     }
     VERIFY_CHECK(rings <= 32);
-    if (plen - offset < 32 * (npub + rings - 1) + 32 + ((rings+6) >> 3)) {
+    return rings;
+}
+
+/* The exact length of a proof with the given ring counts whose header is offset bytes long: the sign bits,
+ * the blinded ring commitments except the last, the challenge e0 and one s value per pubkey. */
+SECP256K1_INLINE static int secp256k1_rangeproof_expected_len(int offset, int rings, int npub) {
+    return offset + ((rings + 6) >> 3) + 32 * (rings - 1) + 32 + 32 * npub;
+}
+
+/* Decode the header from the first len bytes of a proof, and compute the length plen the whole proof must have. */
+SECP256K1_INLINE static int secp256k1_rangeproof_peek_impl(int *exp, int *mantissa, uint64_t *min_value, uint64_t *max_value,
+ int *plen, const unsigned char *proof, int len) {
+    int rsizes[32];
+    int offset;
+    int rings;
+    int npub;
+    uint64_t scale;
+    offset = 0;
+    if (!secp256k1_rangeproof_header_parse(&offset, exp, mantissa, &scale, min_value, max_value, proof, len)) {
+        return 0;
+    }
+    rings = secp256k1_rangeproof_ring_sizes(rsizes, &npub, *mantissa);
+    *plen = secp256k1_rangeproof_expected_len(offset, rings, npub);
+    return 1;
+}
+
+/* Compute what secp256k1_rangeproof_sign_impl would produce for these arguments without creating the proof: the exponent,
+ * mantissa and range the proof shows (as secp256k1_rangeproof_peek_impl would decode them), its exact length plen, and
+ * the number npub of ring members, each of which costs the verifier one secp256k1_ecmult. Returns 0 if signing would fail
+ * on the arguments themselves. */
+SECP256K1_INLINE static int secp256k1_rangeproof_cost_impl(int *plen, int *npub, int *exp, int *mantissa,
+ uint64_t *min_value, uint64_t *max_value, int min_bits, uint64_t value) {
+    unsigned char header[10];
+    uint64_t v;
+    uint64_t scale;
+    int rsizes[32];
+    int secidx[32];
+    int rings;
+    int len;
+    int i;
+    if (*min_value > value || min_bits > 64 || min_bits < 0 || *exp < -1 || *exp > 18) {
+        return 0;
+    }
+    if (!secp256k1_range_proveparams(&v, &rings, rsizes, npub, secidx, min_value, mantissa, &scale, exp, &min_bits, value)) {
+        return 0;
+    }
+    len = secp256k1_rangeproof_header_serialize(header, *exp, *mantissa, rsizes[0], *min_value);
+    /* The exact-value case counts a second, unused, key in npub; the proof has one per ring member. */
+    *npub = 0;
+    for (i = 0; i < rings; i++) {
+        *npub += rsizes[i];
+    }
+    return secp256k1_rangeproof_peek_impl(exp, mantissa, min_value, max_value, plen, header, len);
+}
+
+/* Check for the value encoding that secp256k1_rangeproof_rewind_inner will look for in the last ring, from the prover's
+ * random stream and the s values in the proof alone. Unlike a rewind, this needs no point arithmetic and no challenges,
+ * so a proof made with another nonce (by far the most common case while scanning) can be rejected before its ring
+ * signature is verified; one without that encoding cannot be rewound anyway. Proofs with a single ring of one key have
+ * no value encoding and always pass. */
+SECP256K1_INLINE static int secp256k1_rangeproof_rewind_precheck(secp256k1_scalar_t *s_orig, unsigned char *prep, int *rsizes,
+ int rings, int npub, const unsigned char *nonce, const unsigned char *commit, const unsigned char *proof, int offset, int plen) {
+    secp256k1_scalar_t sec[32];
+    unsigned char tmp[32];
+    const unsigned char *sp;
+    uint64_t value;
+    int ret = 0;
+    int idx;
+    int i;
+    int j;
+    if (rings == 1 && rsizes[0] == 1) {
+        return 1;
+    }
+    if (plen != secp256k1_rangeproof_expected_len(offset, rings, npub)) {
+        return 0;
+    }
+    sp = &proof[plen - 32 * npub];
+    memset(prep, 0, 4096);
+    secp256k1_rangeproof_genrand(sec, s_orig, prep, rsizes, rings, nonce, commit, proof, offset);
+    for (j = 0; j < 2; j++) {
+        idx = ((rings - 1) << 2) + rsizes[rings - 1] - 1 - j;
+        memcpy(tmp, &sp[idx * 32], 32);
+        secp256k1_rangeproof_ch32xor(tmp, &prep[idx * 32]);
+        if ((tmp[0] & 128) && (memcmp(&tmp[16], &tmp[24], 8) == 0) && (memcmp(&tmp[8], &tmp[16], 8) == 0)) {
+            value = 0;
+            for (i = 0; i < 8; i++) {
+                value = (value << 8) + tmp[24 + i];
+            }
+            /* The value must also not point at the position it was found in. */
+            ret = rsizes[rings - 1] - 1 - j != (int)((value >> ((rings - 1) << 1)) & 3);
+            break;
+        }
+    }
+    memset(prep, 0, 4096);
+    memset(tmp, 0, 32);
+    for (i = 0; i < 32; i++) {
+        secp256k1_scalar_clear(&sec[i]);
+    }
+    return ret;
+}
+
+/* Decode the ring signature following the header (which ends at offset) of a proof with the given ring sizes:
+ * its pubkeys go to pubs, its s values to s (room for npub entries each), its challenge to e0, and the message
+ * it signs to m (32 bytes). commit_ge is the already decompressed commit, or NULL to decompress it here. */
+SECP256K1_INLINE static int secp256k1_rangeproof_verify_parse(const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx,
+ const secp256k1_rangeproof_context_t* rangeproof_ctx, secp256k1_gej_t *pubs, secp256k1_scalar_t *s, unsigned char *m,
+ const unsigned char **e0, const int *rsizes, int rings, int npub, int offset, int exp, uint64_t min_value,
+ const unsigned char *commit, const secp256k1_ge_t *commit_ge, const unsigned char *proof, int plen) {
+    secp256k1_gej_t accj;
+    secp256k1_ge_t c[32];
+    int nparse;
+    secp256k1_sha256_t sha256_m;
+    int i;
+    int overflow;
+    int valid[32];
+    unsigned char signs[31];
+    unsigned char tmp[31][33];
+    const unsigned char *tmpp[32];
+    if (plen < secp256k1_rangeproof_expected_len(offset, rings, npub)) {
         return 0;
     }
     secp256k1_sha256_initialize(&sha256_m);
@@ -650,32 +766,39 @@ SECP256K1_INLINE static int secp256k1_rangeproof_verify_impl(const secp256k1_ecm
     }
     npub = 0;
     secp256k1_gej_set_infinity(&accj);
-    if (*min_value) {
-        secp256k1_ecmult_gen2_small(ecmult_gen2_ctx, &accj, *min_value);
+    if (min_value) {
+        secp256k1_ecmult_gen2_small_var(ecmult_gen2_ctx, &accj, min_value);
     }
+    /* Decompress the blinded points, and the commitment together with them if needed. */
     for(i = 0; i < rings - 1; i++) {
-        memcpy(&m[1], &proof[offset], 32);
-        m[0] = 2 + signs[i];
-        if (!secp256k1_eckey_pubkey_parse(&c, m, 33)) {
-            return 0;
-        }
-        secp256k1_sha256_write(&sha256_m, m, 33);
-        secp256k1_gej_set_ge(&pubs[npub], &c);
-        secp256k1_gej_add_ge_var(&accj, &accj, &c, NULL);
+        memcpy(&tmp[i][1], &proof[offset + 32 * i], 32);
+        tmp[i][0] = 2 + signs[i];
+        tmpp[i] = tmp[i];
+    }
+    nparse = rings - 1;
+    if (commit_ge) {
+        c[rings - 1] = *commit_ge;
+    } else {
+        tmpp[nparse++] = commit;
+    }
+    if (!secp256k1_eckey_pubkey_parse_batch(c, valid, tmpp, nparse)) {
+        return 0;
+    }
+    for(i = 0; i < rings - 1; i++) {
+        secp256k1_sha256_write(&sha256_m, tmp[i], 33);
+        secp256k1_gej_set_ge(&pubs[npub], &c[i]);
+        secp256k1_gej_add_ge_var(&accj, &accj, &c[i], NULL);
         offset += 32;
         npub += rsizes[i];
     }
     secp256k1_gej_neg(&accj, &accj);
-    if (!secp256k1_eckey_pubkey_parse(&c, commit, 33)) {
-        return 0;
-    }
-    secp256k1_gej_add_ge_var(&pubs[npub], &accj, &c, NULL);
+    secp256k1_gej_add_ge_var(&pubs[npub], &accj, &c[rings - 1], NULL);
     if (secp256k1_gej_is_infinity(&pubs[npub])) {
         return 0;
     }
     secp256k1_rangeproof_pub_expand(rangeproof_ctx, pubs, exp, rsizes, rings);
     npub += rsizes[rings - 1];
-    e0 = &proof[offset];
+    *e0 = &proof[offset];
     offset += 32;
     for (i = 0; i < npub; i++) {
         secp256k1_scalar_set_b32(&s[i], &proof[offset], &overflow);
@@ -689,6 +812,45 @@ SECP256K1_INLINE static int secp256k1_rangeproof_verify_impl(const secp256k1_ecm
         return 0;
     }
     secp256k1_sha256_finalize(&sha256_m, m);
+    return 1;
+}
+
+/* pubs must have room for 128 points, s, evalues and s_orig for 128 scalars each, and prep for 4096 bytes. */
+SECP256K1_INLINE static int secp256k1_rangeproof_verify_inner(const secp256k1_ecmult_context_t* ecmult_ctx,
+ const secp256k1_ecmult_gen_context_t* ecmult_gen_ctx,
+ const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx, const secp256k1_rangeproof_context_t* rangeproof_ctx,
+ secp256k1_gej_t *pubs, secp256k1_scalar_t *s, secp256k1_scalar_t *evalues, secp256k1_scalar_t *s_orig, unsigned char *prep,
+ unsigned char *blindout, uint64_t *value_out, unsigned char *message_out, int *outlen, const unsigned char *nonce,
+ uint64_t *min_value, uint64_t *max_value, const unsigned char *commit, const secp256k1_ge_t *commit_ge,
+ const unsigned char *proof, int plen) {
+    secp256k1_gej_t accj;
+    secp256k1_ge_t c;
+    int rsizes[32];
+    int ret;
+    int i;
+    int exp;
+    int mantissa;
+    int offset;
+    int rings;
+    int npub;
+    uint64_t scale;
+    unsigned char m[32];
+    const unsigned char *e0;
+    offset = 0;
+    if (!secp256k1_rangeproof_getheader_impl(&offset, &exp, &mantissa, &scale, min_value, max_value, proof, plen)) {
+        return 0;
+    }
+    rings = secp256k1_rangeproof_ring_sizes(rsizes, &npub, mantissa);
+    if (nonce && !secp256k1_rangeproof_rewind_precheck(s_orig, prep, rsizes, rings, npub, nonce, commit, proof, offset, plen)) {
+        if (outlen) {
+            *outlen = 0;
+        }
+        return 0;
+    }
+    if (!secp256k1_rangeproof_verify_parse(ecmult_gen2_ctx, rangeproof_ctx, pubs, s, m, &e0, rsizes, rings, npub, offset, exp,
+     *min_value, commit, commit_ge, proof, plen)) {
+        return 0;
+    }
     ret = secp256k1_borromean_verify(ecmult_ctx, nonce ? evalues : NULL, e0, s, pubs, rsizes, rings, m, 32);
     if (ret && nonce) {
         /* Given the nonce, try rewinding the witness to recover its initial state. */
@@ -698,7 +860,7 @@ SECP256K1_INLINE static int secp256k1_rangeproof_verify_impl(const secp256k1_ecm
         if (!ecmult_gen_ctx) {
             return 0;
         }
-        if (!secp256k1_rangeproof_rewind_inner(&blind, &vv, message_out, outlen, evalues, s, rsizes, rings, nonce, commit, proof, offset_post_header)) {
+        if (!secp256k1_rangeproof_rewind_inner(&blind, &vv, message_out, outlen, evalues, s, s_orig, prep, rsizes, rings, nonce, commit, proof, offset)) {
             return 0;
         }
         /* Unwind apparently successful, see if the commitment can be reconstructed. */
@@ -724,5 +886,160 @@ SECP256K1_INLINE static int secp256k1_rangeproof_verify_impl(const secp256k1_ecm
     return ret;
 }
 
+/* Verifies range proof (len plen) for 33-byte commit, the min/max values proven are put in the min/max arguments; returns 0 on failure 1 on success.
+ * If commit_ge is not NULL, it must be the decompressed commit.*/
+SECP256K1_INLINE static int secp256k1_rangeproof_verify_impl(const secp256k1_ecmult_context_t* ecmult_ctx,
+ const secp256k1_ecmult_gen_context_t* ecmult_gen_ctx,
+ const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx, const secp256k1_rangeproof_context_t* rangeproof_ctx,
+ secp256k1_scratch_t *scratch,
+ unsigned char *blindout, uint64_t *value_out, unsigned char *message_out, int *outlen, const unsigned char *nonce,
+ uint64_t *min_value, uint64_t *max_value, const unsigned char *commit, const secp256k1_ge_t *commit_ge,
+ const unsigned char *proof, int plen) {
+    size_t checkpoint = secp256k1_scratch_checkpoint(scratch);
+    secp256k1_gej_t *pubs;
+    secp256k1_scalar_t *s;
+    secp256k1_scalar_t *evalues; /* Challenges, only used during proof rewind. */
+    secp256k1_scalar_t *s_orig;
+    unsigned char *prep;
+    int ret = 0;
+    pubs = (secp256k1_gej_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_gej_t) * 128);
+    s = (secp256k1_scalar_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_scalar_t) * 128);
+    evalues = (secp256k1_scalar_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_scalar_t) * 128);
+    s_orig = (secp256k1_scalar_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_scalar_t) * 128);
+    prep = (unsigned char *)secp256k1_scratch_alloc(scratch, 4096);
+    if (pubs != NULL && s != NULL && evalues != NULL && s_orig != NULL && prep != NULL) {
+        ret = secp256k1_rangeproof_verify_inner(ecmult_ctx, ecmult_gen_ctx, ecmult_gen2_ctx, rangeproof_ctx, pubs, s, evalues, s_orig, prep,
+         blindout, value_out, message_out, outlen, nonce, min_value, max_value, commit, commit_ge, proof, plen);
+    }
+    secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+    return ret;
+}
+
+/* Verifies the n range proofs proof[k] (len plen[k]) for the 33-byte commitments commit[k], putting the proven ranges in min_value[k]
+ * and max_value[k]; returns 1 if all of them verify. Every header is decoded before any point arithmetic is done; the ring
+ * signatures are then verified together, in as many batches as the scratch space requires. commit_ge, if not NULL, holds
+ * the n commitments already decompressed. */
+SECP256K1_INLINE static int secp256k1_rangeproof_verify_batch_impl(const secp256k1_ecmult_context_t* ecmult_ctx,
+ const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx, const secp256k1_rangeproof_context_t* rangeproof_ctx,
+ secp256k1_scratch_t *scratch, uint64_t *min_value, uint64_t *max_value, const unsigned char * const *commit,
+ const secp256k1_ge_t *commit_ge, const unsigned char * const *proof, const int *plen, size_t n) {
+    secp256k1_gej_t *pubs;
+    secp256k1_scalar_t *s;
+    int *rsizes;
+    int *nrings;
+    unsigned char *m;
+    const unsigned char **e0;
+    size_t checkpoint;
+    size_t avail;
+    size_t cost;
+    size_t proof_cost;
+    size_t i;
+    size_t j;
+    size_t k;
+    int tmp_rsizes[32];
+    int offset;
+    int exp;
+    int mantissa;
+    int rings;
+    int npub;
+    int total_rings;
+    int total_pubs;
+    int ret;
+    uint64_t scale;
+    uint64_t tmp_min;
+    uint64_t tmp_max;
+
+    for (k = 0; k < n; k++) {
+        offset = 0;
+        if (!secp256k1_rangeproof_getheader_impl(&offset, &exp, &mantissa, &scale, &min_value[k], &max_value[k], proof[k], plen[k])) {
+            return 0;
+        }
+    }
+
+    avail = secp256k1_scratch_max_allocation(scratch, 6 + SECP256K1_BORROMEAN_VERIFY_BATCH_OBJECTS);
+    for (i = 0; i < n; i = j) {
+        /* Take as many of the remaining proofs as fit into the scratch space. The headers are cheap to decode
+         * again, which keeps the scratch space needed independent of n. */
+        cost = 0;
+        total_rings = 0;
+        total_pubs = 0;
+        for (j = i; j < n; j++) {
+            offset = 0;
+            if (!secp256k1_rangeproof_getheader_impl(&offset, &exp, &mantissa, &scale, &tmp_min, &tmp_max, proof[j], plen[j])) {
+                return 0;
+            }
+            rings = secp256k1_rangeproof_ring_sizes(tmp_rsizes, &npub, mantissa);
+            proof_cost = npub * (sizeof(secp256k1_gej_t) + sizeof(secp256k1_scalar_t)) +
+             rings * (sizeof(int) + SECP256K1_BORROMEAN_VERIFY_BATCH_RING_SIZE) + sizeof(int) + 32 + sizeof(*e0);
+            if (proof_cost > avail - cost) {
+                break;
+            }
+            cost += proof_cost;
+            total_rings += rings;
+            total_pubs += npub;
+        }
+        if (j == i) {
+            return 0;
+        }
+
+        checkpoint = secp256k1_scratch_checkpoint(scratch);
+        pubs = (secp256k1_gej_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_gej_t) * total_pubs);
+        s = (secp256k1_scalar_t *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_scalar_t) * total_pubs);
+        rsizes = (int *)secp256k1_scratch_alloc(scratch, sizeof(int) * total_rings);
+        nrings = (int *)secp256k1_scratch_alloc(scratch, sizeof(int) * (j - i));
+        m = (unsigned char *)secp256k1_scratch_alloc(scratch, 32 * (j - i));
+        e0 = (const unsigned char **)secp256k1_scratch_alloc(scratch, sizeof(*e0) * (j - i));
+        ret = pubs != NULL && s != NULL && rsizes != NULL && nrings != NULL && m != NULL && e0 != NULL;
+        total_rings = 0;
+        total_pubs = 0;
+        for (k = i; ret && k < j; k++) {
+            offset = 0;
+            ret = secp256k1_rangeproof_getheader_impl(&offset, &exp, &mantissa, &scale, &tmp_min, &tmp_max, proof[k], plen[k]);
+            VERIFY_CHECK(ret);
+            rings = secp256k1_rangeproof_ring_sizes(&rsizes[total_rings], &npub, mantissa);
+            nrings[k - i] = rings;
+            ret = secp256k1_rangeproof_verify_parse(ecmult_gen2_ctx, rangeproof_ctx, &pubs[total_pubs], &s[total_pubs], &m[32 * (k - i)],
+             &e0[k - i], &rsizes[total_rings], rings, npub, offset, exp, min_value[k], commit[k], commit_ge ? &commit_ge[k] : NULL,
+             proof[k], plen[k]);
+            total_rings += rings;
+            total_pubs += npub;
+        }
+        if (ret) {
+            ret = secp256k1_borromean_verify_batch(ecmult_ctx, scratch, e0, s, pubs, rsizes, nrings, j - i, m, 32);
+        }
+        secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+        if (!ret) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int secp256k1_rangeproof_verify_split_init(const secp256k1_ecmult_gen2_context_t* ecmult_gen2_ctx,
+ const secp256k1_rangeproof_context_t* rangeproof_ctx, secp256k1_rangeproof_split_t *split, const unsigned char *commit,
+ const unsigned char *proof, int plen) {
+    uint64_t scale;
+    int offset;
+    int exp;
+    int mantissa;
+    int npub;
+    offset = 0;
+    if (!secp256k1_rangeproof_getheader_impl(&offset, &exp, &mantissa, &scale, &split->min_value, &split->max_value, proof, plen)) {
+        return 0;
+    }
+    split->rings = secp256k1_rangeproof_ring_sizes(split->rsizes, &npub, mantissa);
+    return secp256k1_rangeproof_verify_parse(ecmult_gen2_ctx, rangeproof_ctx, split->pubs, split->s, split->m, &split->e0,
+     split->rsizes, split->rings, npub, offset, exp, split->min_value, commit, NULL, proof, plen);
+}
+
+static int secp256k1_rangeproof_verify_split_part(const secp256k1_ecmult_context_t* ecmult_ctx, secp256k1_rangeproof_split_t *split,
+ int first, int last) {
+    VERIFY_CHECK(first >= 0 && first < last && last <= split->rings);
+    return secp256k1_borromean_verify_part(ecmult_ctx, split->rbuf, split->e0, split->s, split->pubs, split->rsizes, first, last, split->m, 32);
+}
+
+static int secp256k1_rangeproof_verify_split_finish(const secp256k1_rangeproof_split_t *split) {
+    return secp256k1_borromean_verify_e0(split->rbuf, split->rings, split->e0, split->m, 32);
+}
 
 #endif
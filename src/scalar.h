@@ -45,6 +45,9 @@ static int secp256k1_scalar_add(secp256k1_scalar_t *r, const secp256k1_scalar_t
 /** Add a power of two to a scalar. The result is not allowed to overflow. */
 static void secp256k1_scalar_add_bit(secp256k1_scalar_t *r, unsigned int bit);
 
+/** Conditionally add a power of two to a scalar, in constant time. The result is not allowed to overflow. */
+static void secp256k1_scalar_cadd_bit(secp256k1_scalar_t *r, unsigned int bit, int flag);
+
 /** Multiply two scalars (modulo the group order). */
 static void secp256k1_scalar_mul(secp256k1_scalar_t *r, const secp256k1_scalar_t *a, const secp256k1_scalar_t *b);
 
@@ -61,6 +64,15 @@ static void secp256k1_scalar_inverse(secp256k1_scalar_t *r, const secp256k1_scal
 /** Compute the inverse of a scalar (modulo the group order), without constant-time guarantee. */
 static void secp256k1_scalar_inverse_var(secp256k1_scalar_t *r, const secp256k1_scalar_t *a);
 
+/** Compute the inverses of len scalars (modulo the group order) using a single inversion, without
+ *  constant-time guarantee. None of the inputs may be zero, and r and a may not overlap. */
+static void secp256k1_scalar_inverse_all_var(size_t len, secp256k1_scalar_t *r, const secp256k1_scalar_t *a);
+
+/** Constant-time version of secp256k1_scalar_inverse_all_var. The product of the inputs is multiplied by
+ *  blind, which must be a nonzero secret, before the single inversion, and blind is multiplied back in
+ *  afterwards, so the inversion itself never operates on a value derived from the inputs alone. */
+static void secp256k1_scalar_inverse_all(size_t len, secp256k1_scalar_t *r, const secp256k1_scalar_t *a, const secp256k1_scalar_t *blind);
+
 /** Compute the complement of a scalar (modulo the group order). */
 static void secp256k1_scalar_negate(secp256k1_scalar_t *r, const secp256k1_scalar_t *a);
 
@@ -77,6 +89,10 @@ static int secp256k1_scalar_is_high(const secp256k1_scalar_t *a);
  * Returns -1 if the number was negated, 1 otherwise */
 static int secp256k1_scalar_wnaf_force_odd(secp256k1_scalar_t *a);
 
+/** Negate a scalar if flag is true, in constant time.
+ * Returns -1 if the number was negated, 1 otherwise */
+static int secp256k1_scalar_cond_negate(secp256k1_scalar_t *a, int flag);
+
 #ifndef USE_NUM_NONE
 /** Convert a scalar to a number. */
 static void secp256k1_scalar_get_num(secp256k1_num_t *r, const secp256k1_scalar_t *a);
@@ -93,9 +109,21 @@ static int secp256k1_scalar_eq(const secp256k1_scalar_t *a, const secp256k1_scal
 static void secp256k1_scalar_split_128(secp256k1_scalar_t *r1, secp256k1_scalar_t *r2, const secp256k1_scalar_t *a);
 /** Find r1 and r2 such that r1+r2*lambda = a, and r1 and r2 are maximum 128 bits long (see secp256k1_gej_mul_lambda). */
 static void secp256k1_scalar_split_lambda_var(secp256k1_scalar_t *r1, secp256k1_scalar_t *r2, const secp256k1_scalar_t *a);
+/** Same as secp256k1_scalar_split_lambda_var, but constant time in a. */
+static void secp256k1_scalar_split_lambda(secp256k1_scalar_t *r1, secp256k1_scalar_t *r2, const secp256k1_scalar_t *a);
 #endif
 
-/** Multiply a and b (without taking the modulus!), divide by 2**shift, and round to the nearest integer. Shift must be at least 256. */
+/** Set an accumulator to zero (also to clear one that held secret data). */
+static void secp256k1_scalar_acc_clear(secp256k1_scalar_acc_t *acc);
+
+/** Add a to an accumulator, without any modular reduction. Up to 2^64 scalars can be added. */
+static void secp256k1_scalar_acc_add(secp256k1_scalar_acc_t *acc, const secp256k1_scalar_t *a);
+
+/** Set r to the sum in an accumulator, modulo the group order. */
+static void secp256k1_scalar_acc_get(secp256k1_scalar_t *r, const secp256k1_scalar_acc_t *acc);
+
+/** Multiply a and b (without taking the modulus!), divide by 2**shift, and round to the nearest integer. Shift must be at least 256.
+ *  Only the shift is treated as variable; the running time does not depend on a or b. */
 static void secp256k1_scalar_mul_shift_var(secp256k1_scalar_t *r, const secp256k1_scalar_t *a, const secp256k1_scalar_t *b, unsigned int shift);
 
 #endif
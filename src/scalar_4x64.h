@@ -14,6 +14,11 @@ typedef struct {
     uint64_t d[4];
 } secp256k1_scalar_t;
 
+/** A sum of scalars, reduced only when read: 256 bits plus a 64-bit carry word. */
+typedef struct {
+    uint64_t d[5];
+} secp256k1_scalar_acc_t;
+
 #define SECP256K1_SCALAR_CONST(d7, d6, d5, d4, d3, d2, d1, d0) {{((uint64_t)(d1)) << 32 | (d0), ((uint64_t)(d3)) << 32 | (d2), ((uint64_t)(d5)) << 32 | (d4), ((uint64_t)(d7)) << 32 | (d6)}}
 
 #endif
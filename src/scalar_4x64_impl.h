@@ -7,6 +7,9 @@
 #ifndef _SECP256K1_SCALAR_REPR_IMPL_H_
 #define _SECP256K1_SCALAR_REPR_IMPL_H_
 
+#include "modinv64_impl.h"
+#include "cpuid_impl.h"
+
 /* Limbs of the secp256k1 order. */
 #define SECP256K1_N_0 ((uint64_t)0xBFD25E8CD0364141ULL)
 #define SECP256K1_N_1 ((uint64_t)0xBAAEDCE6AF48A03BULL)
@@ -113,6 +116,24 @@ static void secp256k1_scalar_add_bit(secp256k1_scalar_t *r, unsigned int bit) {
 #endif
 }
 
+static void secp256k1_scalar_cadd_bit(secp256k1_scalar_t *r, unsigned int bit, int flag) {
+    uint128_t t;
+    VERIFY_CHECK(bit < 256);
+    bit += ((uint32_t) flag - 1) & 0x100;  /* forcing (bit >> 6) > 3 makes this a noop */
+    t = (uint128_t)r->d[0] + (((uint64_t)((bit >> 6) == 0)) << (bit & 0x3F));
+    r->d[0] = t & 0xFFFFFFFFFFFFFFFFULL; t >>= 64;
+    t += (uint128_t)r->d[1] + (((uint64_t)((bit >> 6) == 1)) << (bit & 0x3F));
+    r->d[1] = t & 0xFFFFFFFFFFFFFFFFULL; t >>= 64;
+    t += (uint128_t)r->d[2] + (((uint64_t)((bit >> 6) == 2)) << (bit & 0x3F));
+    r->d[2] = t & 0xFFFFFFFFFFFFFFFFULL; t >>= 64;
+    t += (uint128_t)r->d[3] + (((uint64_t)((bit >> 6) == 3)) << (bit & 0x3F));
+    r->d[3] = t & 0xFFFFFFFFFFFFFFFFULL;
+#ifdef VERIFY
+    VERIFY_CHECK((t >> 64) == 0);
+    VERIFY_CHECK(secp256k1_scalar_check_overflow(r) == 0);
+#endif
+}
+
 static void secp256k1_scalar_set_b32(secp256k1_scalar_t *r, const unsigned char *b32, int *overflow) {
     int over;
     r->d[0] = (uint64_t)b32[31] | (uint64_t)b32[30] << 8 | (uint64_t)b32[29] << 16 | (uint64_t)b32[28] << 24 | (uint64_t)b32[27] << 32 | (uint64_t)b32[26] << 40 | (uint64_t)b32[25] << 48 | (uint64_t)b32[24] << 56;
@@ -180,8 +201,97 @@ static int secp256k1_scalar_wnaf_force_odd(secp256k1_scalar_t *r) {
     return 2 * (mask == 0) - 1;
 }
 
+static int secp256k1_scalar_cond_negate(secp256k1_scalar_t *r, int flag) {
+    /* If flag = 0, mask = 00...00 and this is a no-op;
+     * if flag = 1, mask = 11...11 and this is identical to secp256k1_scalar_negate */
+    uint64_t mask = !flag - 1;
+    uint64_t nonzero = (secp256k1_scalar_is_zero(r) != 0) - 1;
+    uint128_t t = (uint128_t)(r->d[0] ^ mask) + ((SECP256K1_N_0 + 1) & mask);
+    r->d[0] = t & nonzero; t >>= 64;
+    t += (uint128_t)(r->d[1] ^ mask) + (SECP256K1_N_1 & mask);
+    r->d[1] = t & nonzero; t >>= 64;
+    t += (uint128_t)(r->d[2] ^ mask) + (SECP256K1_N_2 & mask);
+    r->d[2] = t & nonzero; t >>= 64;
+    t += (uint128_t)(r->d[3] ^ mask) + (SECP256K1_N_3 & mask);
+    r->d[3] = t & nonzero;
+    return 2 * (mask == 0) - 1;
+}
+
 /* Inspired by the macros in OpenSSL's crypto/bn/asm/x86_64-gcc.c. */
 
+#if defined(USE_ASM_ARM64)
+/* On AArch64 the carries go through the flags (adds/adcs/adc) instead of being recomputed with
+ * comparisons. The accumulator words are copied through 64-bit temporaries, as c2 is 32 bits in
+ * some callers. The overflow contracts are the same as those of the C versions below. */
+
+/** Add a*b to the number defined by (c0,c1,c2). c2 must never overflow. */
+#define muladd(a,b) { \
+    uint64_t tl, th, t0 = c0, t1 = c1, t2 = c2; \
+    __asm__ ("mul %[tl], %[x], %[y]\n" \
+             "umulh %[th], %[x], %[y]\n" \
+             "adds %[t0], %[t0], %[tl]\n" \
+             "adcs %[t1], %[t1], %[th]\n" \
+             "adc %[t2], %[t2], xzr\n" \
+             : [tl] "=&r"(tl), [th] "=&r"(th), [t0] "+r"(t0), [t1] "+r"(t1), [t2] "+r"(t2) \
+             : [x] "r"((uint64_t)(a)), [y] "r"((uint64_t)(b)) \
+             : "cc"); \
+    c0 = t0; c1 = t1; c2 = t2; \
+}
+
+/** Add a*b to the number defined by (c0,c1). c1 must never overflow. */
+#define muladd_fast(a,b) { \
+    uint64_t tl, th, t0 = c0, t1 = c1; \
+    __asm__ ("mul %[tl], %[x], %[y]\n" \
+             "umulh %[th], %[x], %[y]\n" \
+             "adds %[t0], %[t0], %[tl]\n" \
+             "adc %[t1], %[t1], %[th]\n" \
+             : [tl] "=&r"(tl), [th] "=&r"(th), [t0] "+r"(t0), [t1] "+r"(t1) \
+             : [x] "r"((uint64_t)(a)), [y] "r"((uint64_t)(b)) \
+             : "cc"); \
+    c0 = t0; c1 = t1; \
+}
+
+/** Add 2*a*b to the number defined by (c0,c1,c2). c2 must never overflow. */
+#define muladd2(a,b) { \
+    uint64_t tl, th, t0 = c0, t1 = c1, t2 = c2; \
+    __asm__ ("mul %[tl], %[x], %[y]\n" \
+             "umulh %[th], %[x], %[y]\n" \
+             "adds %[t0], %[t0], %[tl]\n" \
+             "adcs %[t1], %[t1], %[th]\n" \
+             "adc %[t2], %[t2], xzr\n" \
+             "adds %[t0], %[t0], %[tl]\n" \
+             "adcs %[t1], %[t1], %[th]\n" \
+             "adc %[t2], %[t2], xzr\n" \
+             : [tl] "=&r"(tl), [th] "=&r"(th), [t0] "+r"(t0), [t1] "+r"(t1), [t2] "+r"(t2) \
+             : [x] "r"((uint64_t)(a)), [y] "r"((uint64_t)(b)) \
+             : "cc"); \
+    c0 = t0; c1 = t1; c2 = t2; \
+}
+
+/** Add a to the number defined by (c0,c1,c2). c2 must never overflow. */
+#define sumadd(a) { \
+    uint64_t t0 = c0, t1 = c1, t2 = c2; \
+    __asm__ ("adds %[t0], %[t0], %[x]\n" \
+             "adcs %[t1], %[t1], xzr\n" \
+             "adc %[t2], %[t2], xzr\n" \
+             : [t0] "+r"(t0), [t1] "+r"(t1), [t2] "+r"(t2) \
+             : [x] "r"((uint64_t)(a)) \
+             : "cc"); \
+    c0 = t0; c1 = t1; c2 = t2; \
+}
+
+/** Add a to the number defined by (c0,c1). c1 must never overflow, c2 must be zero. */
+#define sumadd_fast(a) { \
+    uint64_t t0 = c0, t1 = c1; \
+    __asm__ ("adds %[t0], %[t0], %[x]\n" \
+             "adc %[t1], %[t1], xzr\n" \
+             : [t0] "+r"(t0), [t1] "+r"(t1) \
+             : [x] "r"((uint64_t)(a)) \
+             : "cc"); \
+    c0 = t0; c1 = t1; \
+    VERIFY_CHECK(c2 == 0); \
+}
+#else
 /** Add a*b to the number defined by (c0,c1,c2). c2 must never overflow. */
 #define muladd(a,b) { \
     uint64_t tl, th; \
@@ -250,6 +360,8 @@ static int secp256k1_scalar_wnaf_force_odd(secp256k1_scalar_t *r) {
     VERIFY_CHECK(c2 == 0); \
 }
 
+#endif
+
 /** Extract the lowest 64 bits of (c0,c1,c2) into n, and left shift the number 64 bits. */
 #define extract(n) { \
     (n) = c0; \
@@ -266,6 +378,189 @@ static int secp256k1_scalar_wnaf_force_odd(secp256k1_scalar_t *r) {
     VERIFY_CHECK(c2 == 0); \
 }
 
+#if defined(USE_ASM_X86_64) && defined(HAVE_ASM_X86_64_ADX)
+/* Versions of reduce_512 and mul_512 for CPUs with BMI2 and ADX. MULX leaves the flags alone, so that
+ * ADCX (which only uses CF) and ADOX (which only uses OF) can accumulate the low and the high halves of
+ * a row of products as two independent carry chains. */
+static uint64_t secp256k1_scalar_reduce_512_adx(secp256k1_scalar_t *r, const uint64_t *l) {
+    uint64_t c;
+    __asm__ __volatile__(
+    /* Reduce 512 bits into 385: (r14,r13,r12,r11,r10,r9,r8) = l[0..3] + l[4..7] * SECP256K1_N_C. */
+    "movq 0(%%rsi), %%r8\n"
+    "movq 8(%%rsi), %%r9\n"
+    "movq 16(%%rsi), %%r10\n"
+    "movq 24(%%rsi), %%r11\n"
+    "xorq %%r13, %%r13\n"
+    "xorq %%r14, %%r14\n"
+    "xorq %%r12, %%r12\n"
+    "movq %3, %%rdx\n"
+    "mulxq 32(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r8\n"
+    "adoxq %%rbx, %%r9\n"
+    "mulxq 40(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r9\n"
+    "adoxq %%rbx, %%r10\n"
+    "mulxq 48(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r10\n"
+    "adoxq %%rbx, %%r11\n"
+    "mulxq 56(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r11\n"
+    "adoxq %%rbx, %%r12\n"
+    "adcxq %%r13, %%r12\n"
+    "movq %4, %%rdx\n"
+    "mulxq 32(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r9\n"
+    "adoxq %%rbx, %%r10\n"
+    "mulxq 40(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r10\n"
+    "adoxq %%rbx, %%r11\n"
+    "mulxq 48(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r11\n"
+    "adoxq %%rbx, %%r12\n"
+    "mulxq 56(%%rsi), %%rax, %%rbx\n"
+    "adcxq %%rax, %%r12\n"
+    "adoxq %%rbx, %%r13\n"
+    "adcxq %%r14, %%r13\n"
+    "addq 32(%%rsi), %%r10\n"
+    "adcq 40(%%rsi), %%r11\n"
+    "adcq 48(%%rsi), %%r12\n"
+    "adcq 56(%%rsi), %%r13\n"
+    "adcq $0, %%r14\n"
+    /* Reduce 385 bits into 258: (r15,r11,r10,r9,r8) += (r14,r13,r12) * SECP256K1_N_C. */
+    "xorq %%r15, %%r15\n"
+    "movq %3, %%rdx\n"
+    "mulxq %%r12, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r8\n"
+    "adoxq %%rbx, %%r9\n"
+    "mulxq %%r13, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r9\n"
+    "adoxq %%rbx, %%r10\n"
+    "mulxq %%r14, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r10\n"
+    "adoxq %%rbx, %%r11\n"
+    "movq $0, %%rax\n"
+    "adcxq %%rax, %%r11\n"
+    "adoxq %%rax, %%r15\n"
+    "adcxq %%rax, %%r15\n"
+    "movq %4, %%rdx\n"
+    "mulxq %%r12, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r9\n"
+    "adoxq %%rbx, %%r10\n"
+    "mulxq %%r13, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r10\n"
+    "adoxq %%rbx, %%r11\n"
+    "mulxq %%r14, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r11\n"
+    "adoxq %%rbx, %%r15\n"
+    "adcq $0, %%r15\n"
+    "addq %%r12, %%r10\n"
+    "adcq %%r13, %%r11\n"
+    "adcq %%r14, %%r15\n"
+    /* Reduce 258 bits into 256: (c,r[0..3]) = (r11,r10,r9,r8) + r15 * SECP256K1_N_C. */
+    "movq %%r15, %%rdx\n"
+    "movq %3, %%r12\n"
+    "mulxq %%r12, %%rax, %%rbx\n"
+    "movq %4, %%r13\n"
+    "mulxq %%r13, %%r12, %%r13\n"
+    "xorq %%rcx, %%rcx\n"
+    "addq %%rax, %%r8\n"
+    "adcq %%rbx, %%r9\n"
+    "adcq %%r13, %%r10\n"
+    "adcq $0, %%r11\n"
+    "adcq $0, %%rcx\n"
+    "addq %%r12, %%r9\n"
+    "adcq %%r15, %%r10\n"
+    "adcq $0, %%r11\n"
+    "adcq $0, %%rcx\n"
+    "movq %%r8, 0(%%rdi)\n"
+    "movq %%r9, 8(%%rdi)\n"
+    "movq %%r10, 16(%%rdi)\n"
+    "movq %%r11, 24(%%rdi)\n"
+    : "=c"(c)
+    : "S"(l), "D"(r), "n"(SECP256K1_N_C_0), "n"(SECP256K1_N_C_1)
+    : "rax", "rbx", "rdx", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "cc", "memory");
+    return c;
+}
+
+static void secp256k1_scalar_mul_512_adx(uint64_t l[8], const secp256k1_scalar_t *a, const secp256k1_scalar_t *b) {
+    const uint64_t *pa = a->d;
+    __asm__ __volatile__(
+    "movq 0(%%rcx), %%r8\n"
+    "movq 8(%%rcx), %%r9\n"
+    "movq 16(%%rcx), %%r10\n"
+    "movq 24(%%rcx), %%r11\n"
+    /* (r15,r14,r13,r12,l0) = a * b0 */
+    "movq 0(%%rsi), %%rdx\n"
+    "mulxq %%r8, %%rax, %%r12\n"
+    "movq %%rax, 0(%%rdi)\n"
+    "mulxq %%r9, %%rax, %%r13\n"
+    "addq %%rax, %%r12\n"
+    "mulxq %%r10, %%rax, %%r14\n"
+    "adcq %%rax, %%r13\n"
+    "mulxq %%r11, %%rax, %%r15\n"
+    "adcq %%rax, %%r14\n"
+    "adcq $0, %%r15\n"
+    /* (rcx,r15,r14,r13,r12) += a * b1 */
+    "movq 8(%%rsi), %%rdx\n"
+    "xorq %%rcx, %%rcx\n"
+    "mulxq %%r8, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r12\n"
+    "adoxq %%rbx, %%r13\n"
+    "mulxq %%r9, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r13\n"
+    "adoxq %%rbx, %%r14\n"
+    "mulxq %%r10, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r14\n"
+    "adoxq %%rbx, %%r15\n"
+    "mulxq %%r11, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r15\n"
+    "adoxq %%rbx, %%rcx\n"
+    "adcq $0, %%rcx\n"
+    "movq %%r12, 8(%%rdi)\n"
+    /* (r12,rcx,r15,r14,r13) += a * b2 */
+    "movq 16(%%rsi), %%rdx\n"
+    "xorq %%r12, %%r12\n"
+    "mulxq %%r8, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r13\n"
+    "adoxq %%rbx, %%r14\n"
+    "mulxq %%r9, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r14\n"
+    "adoxq %%rbx, %%r15\n"
+    "mulxq %%r10, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r15\n"
+    "adoxq %%rbx, %%rcx\n"
+    "mulxq %%r11, %%rax, %%rbx\n"
+    "adcxq %%rax, %%rcx\n"
+    "adoxq %%rbx, %%r12\n"
+    "adcq $0, %%r12\n"
+    "movq %%r13, 16(%%rdi)\n"
+    /* (r13,r12,rcx,r15,r14) += a * b3 */
+    "movq 24(%%rsi), %%rdx\n"
+    "xorq %%r13, %%r13\n"
+    "mulxq %%r8, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r14\n"
+    "adoxq %%rbx, %%r15\n"
+    "mulxq %%r9, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r15\n"
+    "adoxq %%rbx, %%rcx\n"
+    "mulxq %%r10, %%rax, %%rbx\n"
+    "adcxq %%rax, %%rcx\n"
+    "adoxq %%rbx, %%r12\n"
+    "mulxq %%r11, %%rax, %%rbx\n"
+    "adcxq %%rax, %%r12\n"
+    "adoxq %%rbx, %%r13\n"
+    "adcq $0, %%r13\n"
+    "movq %%r14, 24(%%rdi)\n"
+    "movq %%r15, 32(%%rdi)\n"
+    "movq %%rcx, 40(%%rdi)\n"
+    "movq %%r12, 48(%%rdi)\n"
+    "movq %%r13, 56(%%rdi)\n"
+    : "+c"(pa)
+    : "S"(b->d), "D"(l)
+    : "rax", "rbx", "rdx", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "cc", "memory");
+}
+#endif
+
 static void secp256k1_scalar_reduce_512(secp256k1_scalar_t *r, const uint64_t *l) {
 #ifdef USE_ASM_X86_64
     /* Reduce 512 bits into 385. */
@@ -273,6 +568,14 @@ static void secp256k1_scalar_reduce_512(secp256k1_scalar_t *r, const uint64_t *l
     uint64_t p0, p1, p2, p3, p4;
     uint64_t c;
 
+#ifdef HAVE_ASM_X86_64_ADX
+    if (secp256k1_x86_64_have_bmi2_adx()) {
+        c = secp256k1_scalar_reduce_512_adx(r, l);
+        secp256k1_scalar_reduce(r, c + secp256k1_scalar_check_overflow(r));
+        return;
+    }
+#endif
+
     __asm__ __volatile__(
     /* Preload. */
     "movq 32(%%rsi), %%r11\n"
@@ -578,6 +881,12 @@ static void secp256k1_scalar_reduce_512(secp256k1_scalar_t *r, const uint64_t *l
 static void secp256k1_scalar_mul_512(uint64_t l[8], const secp256k1_scalar_t *a, const secp256k1_scalar_t *b) {
 #ifdef USE_ASM_X86_64
     const uint64_t *pb = b->d;
+#ifdef HAVE_ASM_X86_64_ADX
+    if (secp256k1_x86_64_have_bmi2_adx()) {
+        secp256k1_scalar_mul_512_adx(l, a, b);
+        return;
+    }
+#endif
     __asm__ __volatile__(
     /* Preload */
     "movq 0(%%rdi), %%r15\n"
@@ -893,6 +1202,40 @@ static void secp256k1_scalar_mul(secp256k1_scalar_t *r, const secp256k1_scalar_t
     secp256k1_scalar_reduce_512(r, l);
 }
 
+SECP256K1_INLINE static void secp256k1_scalar_acc_clear(secp256k1_scalar_acc_t *acc) {
+    acc->d[0] = 0;
+    acc->d[1] = 0;
+    acc->d[2] = 0;
+    acc->d[3] = 0;
+    acc->d[4] = 0;
+}
+
+SECP256K1_INLINE static void secp256k1_scalar_acc_add(secp256k1_scalar_acc_t *acc, const secp256k1_scalar_t *a) {
+    uint128_t t = (uint128_t)acc->d[0] + a->d[0];
+    acc->d[0] = t & 0xFFFFFFFFFFFFFFFFULL; t >>= 64;
+    t += (uint128_t)acc->d[1] + a->d[1];
+    acc->d[1] = t & 0xFFFFFFFFFFFFFFFFULL; t >>= 64;
+    t += (uint128_t)acc->d[2] + a->d[2];
+    acc->d[2] = t & 0xFFFFFFFFFFFFFFFFULL; t >>= 64;
+    t += (uint128_t)acc->d[3] + a->d[3];
+    acc->d[3] = t & 0xFFFFFFFFFFFFFFFFULL; t >>= 64;
+    acc->d[4] += (uint64_t)t;
+}
+
+static void secp256k1_scalar_acc_get(secp256k1_scalar_t *r, const secp256k1_scalar_acc_t *acc) {
+    /* The carry word makes it a (short) 512-bit number, as reduced after a multiplication. */
+    uint64_t l[8];
+    l[0] = acc->d[0];
+    l[1] = acc->d[1];
+    l[2] = acc->d[2];
+    l[3] = acc->d[3];
+    l[4] = acc->d[4];
+    l[5] = 0;
+    l[6] = 0;
+    l[7] = 0;
+    secp256k1_scalar_reduce_512(r, l);
+}
+
 static int secp256k1_scalar_shr_int(secp256k1_scalar_t *r, int n) {
     int ret;
     VERIFY_CHECK(n > 0);
@@ -940,9 +1283,53 @@ SECP256K1_INLINE static void secp256k1_scalar_mul_shift_var(secp256k1_scalar_t *
     r->d[1] = shift < 448 ? (l[1 + shiftlimbs] >> shiftlow | (shift < 384 && shiftlow ? (l[2 + shiftlimbs] << shifthigh) : 0)) : 0;
     r->d[2] = shift < 384 ? (l[2 + shiftlimbs] >> shiftlow | (shift < 320 && shiftlow ? (l[3 + shiftlimbs] << shifthigh) : 0)) : 0;
     r->d[3] = shift < 320 ? (l[3 + shiftlimbs] >> shiftlow) : 0;
-    if ((l[(shift - 1) >> 6] >> ((shift - 1) & 0x3f)) & 1) {
-        secp256k1_scalar_add_bit(r, 0);
-    }
+    secp256k1_scalar_cadd_bit(r, 0, (l[(shift - 1) >> 6] >> ((shift - 1) & 0x3f)) & 1);
+}
+
+static void secp256k1_scalar_from_signed62(secp256k1_scalar_t *r, const secp256k1_modinv64_signed62_t *a) {
+    const uint64_t a0 = a->v[0], a1 = a->v[1], a2 = a->v[2], a3 = a->v[3], a4 = a->v[4];
+
+    /* The input is in [0, n), so the top limb is below 2^(256-62*4). */
+    VERIFY_CHECK(a4 >> 8 == 0);
+
+    r->d[0] = a0      | a1 << 62;
+    r->d[1] = a1 >> 2 | a2 << 60;
+    r->d[2] = a2 >> 4 | a3 << 58;
+    r->d[3] = a3 >> 6 | a4 << 56;
 }
 
+static void secp256k1_scalar_to_signed62(secp256k1_modinv64_signed62_t *r, const secp256k1_scalar_t *a) {
+    const uint64_t M62 = UINT64_MAX >> 2;
+    const uint64_t a0 = a->d[0], a1 = a->d[1], a2 = a->d[2], a3 = a->d[3];
+
+    r->v[0] =  a0                   & M62;
+    r->v[1] = (a0 >> 62 | a1 <<  2) & M62;
+    r->v[2] = (a1 >> 60 | a2 <<  4) & M62;
+    r->v[3] = (a2 >> 58 | a3 <<  6) & M62;
+    r->v[4] =  a3 >> 56;
+}
+
+static const secp256k1_modinv64_modinfo_t secp256k1_const_modinfo_scalar = {
+    {{0x3FD25E8CD0364141LL, 0x2ABB739ABD2280EELL, -0x15LL, 0, 256}},
+    0x34F20099AA774EC1LL
+};
+
+static void secp256k1_scalar_inverse(secp256k1_scalar_t *r, const secp256k1_scalar_t *x) {
+    secp256k1_modinv64_signed62_t s;
+
+    secp256k1_scalar_to_signed62(&s, x);
+    secp256k1_modinv64(&s, &secp256k1_const_modinfo_scalar);
+    secp256k1_scalar_from_signed62(r, &s);
+}
+
+#if defined(USE_SCALAR_INV_BUILTIN)
+static void secp256k1_scalar_inverse_var(secp256k1_scalar_t *r, const secp256k1_scalar_t *x) {
+    secp256k1_modinv64_signed62_t s;
+
+    secp256k1_scalar_to_signed62(&s, x);
+    secp256k1_modinv64_var(&s, &secp256k1_const_modinfo_scalar);
+    secp256k1_scalar_from_signed62(r, &s);
+}
+#endif
+
 #endif
@@ -14,6 +14,11 @@ typedef struct {
     uint32_t d[8];
 } secp256k1_scalar_t;
 
+/** A sum of scalars, reduced only when read: 256 bits plus a 64-bit carry word. */
+typedef struct {
+    uint32_t d[10];
+} secp256k1_scalar_acc_t;
+
 #define SECP256K1_SCALAR_CONST(d7, d6, d5, d4, d3, d2, d1, d0) {{(d0), (d1), (d2), (d3), (d4), (d5), (d6), (d7)}}
 
 #endif
@@ -0,0 +1,40 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille, Gregory Maxwell                  *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_SCRATCH_
+#define _SECP256K1_SCRATCH_
+
+#include <stddef.h>
+
+/** Alignment of every allocation handed out by a scratch space. */
+#define SECP256K1_SCRATCH_ALIGNMENT 16
+
+/** Round size up to a multiple of SECP256K1_SCRATCH_ALIGNMENT. */
+#define SECP256K1_SCRATCH_ROUND(size) ((((size) + SECP256K1_SCRATCH_ALIGNMENT - 1) / SECP256K1_SCRATCH_ALIGNMENT) * SECP256K1_SCRATCH_ALIGNMENT)
+
+/* The typedef is used internally; the struct name is used in the public API
+ * (where it is exposed as a different typedef). */
+typedef struct secp256k1_scratch_space_struct {
+    unsigned char *data;
+    size_t alloc_size; /* Number of bytes handed out so far. */
+    size_t max_size;
+} secp256k1_scratch_t;
+
+/** Create a bump allocator with room for max_size bytes. */
+static secp256k1_scratch_t *secp256k1_scratch_create(size_t max_size);
+static void secp256k1_scratch_destroy(secp256k1_scratch_t *scratch);
+
+/** Return the current allocation point, which allocations made after it can later be released to. */
+static size_t secp256k1_scratch_checkpoint(const secp256k1_scratch_t *scratch);
+/** Release every allocation made since checkpoint was taken. */
+static void secp256k1_scratch_apply_checkpoint(secp256k1_scratch_t *scratch, size_t checkpoint);
+
+/** Return the largest total size that n_objects further allocations can have. */
+static size_t secp256k1_scratch_max_allocation(const secp256k1_scratch_t *scratch, size_t n_objects);
+/** Return a pointer to size bytes of scratch memory, or NULL if not enough space is left. */
+static void *secp256k1_scratch_alloc(secp256k1_scratch_t *scratch, size_t size);
+
+#endif
@@ -0,0 +1,60 @@
+/**********************************************************************
+ * Copyright (c) 2015 Pieter Wuille, Gregory Maxwell                  *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef _SECP256K1_SCRATCH_IMPL_H_
+#define _SECP256K1_SCRATCH_IMPL_H_
+
+#include "util.h"
+#include "scratch.h"
+
+static secp256k1_scratch_t *secp256k1_scratch_create(size_t max_size) {
+    secp256k1_scratch_t *ret = (secp256k1_scratch_t *)checked_malloc(sizeof(*ret));
+    /* Round down, so that the final allocation still ends on an aligned boundary. */
+    max_size -= max_size % SECP256K1_SCRATCH_ALIGNMENT;
+    ret->data = (unsigned char *)checked_malloc(max_size > 0 ? max_size : 1);
+    ret->alloc_size = 0;
+    ret->max_size = max_size;
+    return ret;
+}
+
+static void secp256k1_scratch_destroy(secp256k1_scratch_t *scratch) {
+    if (scratch != NULL) {
+        VERIFY_CHECK(scratch->alloc_size == 0);
+        free(scratch->data);
+        free(scratch);
+    }
+}
+
+static size_t secp256k1_scratch_checkpoint(const secp256k1_scratch_t *scratch) {
+    return scratch->alloc_size;
+}
+
+static void secp256k1_scratch_apply_checkpoint(secp256k1_scratch_t *scratch, size_t checkpoint) {
+    VERIFY_CHECK(checkpoint <= scratch->alloc_size);
+    scratch->alloc_size = checkpoint;
+}
+
+static size_t secp256k1_scratch_max_allocation(const secp256k1_scratch_t *scratch, size_t n_objects) {
+    size_t left = scratch->max_size - scratch->alloc_size;
+    if (left <= n_objects * (SECP256K1_SCRATCH_ALIGNMENT - 1)) {
+        return 0;
+    }
+    return left - n_objects * (SECP256K1_SCRATCH_ALIGNMENT - 1);
+}
+
+static void *secp256k1_scratch_alloc(secp256k1_scratch_t *scratch, size_t size) {
+    void *ret;
+    /* What is left is a multiple of the alignment, so rounding up cannot push size past it. */
+    if (size > scratch->max_size - scratch->alloc_size) {
+        return NULL;
+    }
+    size = SECP256K1_SCRATCH_ROUND(size);
+    ret = (void *)(scratch->data + scratch->alloc_size);
+    scratch->alloc_size += size;
+    return ret;
+}
+
+#endif
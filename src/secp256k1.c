@@ -13,6 +13,8 @@
 #include "field_impl.h"
 #include "scalar_impl.h"
 #include "group_impl.h"
+#include "scratch_impl.h"
+#include "cuckoo_impl.h"
 #include "ecdsa_impl.h"
 #include "ecdh_impl.h"
 #include "ecmult_impl.h"
@@ -23,61 +25,517 @@
 #include "borromean_impl.h"
 #include "rangeproof_impl.h"
 
+/* Tables for a context created with SECP256K1_CONTEXT_LAZY that are built on first use. They are
+ * shared by the context and all its clones, so each of them is built only once. A table is built in
+ * nsegments independent segments, which any number of threads can claim (with next) and compute. */
+typedef struct {
+    int state[4]; /* per table: 0 not built, 1 being allocated, 2 segments being computed, 3 built */
+    int nsegments[4];
+    int next[4]; /* the next segment to claim */
+    int done[4]; /* the number of segments computed */
+    int ecmult_window;
+    secp256k1_ecmult_context_t ecmult_ctx;
+    secp256k1_ecmult_gen_context_t ecmult_gen_ctx;
+    secp256k1_ecmult_gen2_context_t ecmult_gen2_ctx;
+    secp256k1_rangeproof_context_t rangeproof_ctx;
+} secp256k1_context_lazy_t;
+
+#define SECP256K1_CONTEXT_LAZY_ECMULT 0
+#define SECP256K1_CONTEXT_LAZY_ECMULT_GEN 1
+#define SECP256K1_CONTEXT_LAZY_ECMULT_GEN2 2
+#define SECP256K1_CONTEXT_LAZY_RANGEPROOF 3
+
+/* The precomputed tables are never modified after they are built, so a context and all its
+ * clones share them. Only the blinding state in ecmult_gen_ctx is per context. The tables are
+ * freed by whichever of them is destroyed last. In a lazy context, a table that is still missing
+ * when a function needs it is built in lazy and copied into the (otherwise const) context. */
 struct secp256k1_context_struct {
     secp256k1_ecmult_context_t ecmult_ctx;
     secp256k1_ecmult_gen_context_t ecmult_gen_ctx;
     secp256k1_ecmult_gen2_context_t ecmult_gen2_ctx;
     secp256k1_rangeproof_context_t rangeproof_ctx;
+    int *refcount; /* number of contexts sharing the tables above */
+    secp256k1_context_lazy_t *lazy; /* NULL unless created with SECP256K1_CONTEXT_LAZY */
+    int borrowed; /* bits (1 << SECP256K1_CONTEXT_LAZY_*) of the tables that live in a caller's buffer */
+    secp256k1_allocator_t *alloc; /* NULL unless created with secp256k1_context_create_with_allocator */
 };
 
+/* Clones may be destroyed from different threads, so update the count atomically if we can. */
+static void secp256k1_context_refcount_inc(int *refcount) {
+#ifdef HAVE_BUILTIN_SYNC
+    __sync_add_and_fetch(refcount, 1);
+#else
+    ++*refcount;
+#endif
+}
+
+static int secp256k1_context_refcount_dec(int *refcount) {
+#ifdef HAVE_BUILTIN_SYNC
+    return __sync_sub_and_fetch(refcount, 1);
+#else
+    return --*refcount;
+#endif
+}
+
+/* Allocate lazy table i, and return the number of segments to compute it in. */
+static int secp256k1_context_lazy_alloc(const secp256k1_context_t *ctx, secp256k1_context_lazy_t *lazy, int i) {
+    switch (i) {
+    case SECP256K1_CONTEXT_LAZY_ECMULT:
+        return secp256k1_ecmult_context_build_alloc(&lazy->ecmult_ctx, lazy->ecmult_window ? lazy->ecmult_window : WINDOW_G, ctx->alloc);
+    case SECP256K1_CONTEXT_LAZY_RANGEPROOF:
+        return secp256k1_rangeproof_context_build_alloc(&lazy->rangeproof_ctx, ctx->alloc);
+    }
+    /* The comb tables are built in one piece. */
+    return 1;
+}
+
+static void secp256k1_context_lazy_segment(const secp256k1_context_t *ctx, secp256k1_context_lazy_t *lazy, int i, int segment) {
+    switch (i) {
+    case SECP256K1_CONTEXT_LAZY_ECMULT:
+        secp256k1_ecmult_context_build_segment(&lazy->ecmult_ctx, segment);
+        break;
+    case SECP256K1_CONTEXT_LAZY_ECMULT_GEN:
+        secp256k1_ecmult_gen_context_build(&lazy->ecmult_gen_ctx, ctx->alloc);
+        break;
+    case SECP256K1_CONTEXT_LAZY_ECMULT_GEN2:
+        secp256k1_ecmult_gen2_context_build(&lazy->ecmult_gen2_ctx, ctx->alloc);
+        break;
+    case SECP256K1_CONTEXT_LAZY_RANGEPROOF:
+        secp256k1_rangeproof_context_build_segment(&lazy->rangeproof_ctx, segment);
+        break;
+    }
+}
+
+/* Help build lazy table i: allocate it if no other caller has, then compute segments until none is left
+ * to claim. If wait is set, only return once the table is complete. Only thread-safe if we have atomics. */
+static void secp256k1_context_lazy_work(const secp256k1_context_t *ctx, secp256k1_context_lazy_t *lazy, int i, int wait) {
+    int segment;
+#ifdef HAVE_BUILTIN_SYNC
+    if (__sync_bool_compare_and_swap(&lazy->state[i], 0, 1)) {
+        lazy->nsegments[i] = secp256k1_context_lazy_alloc(ctx, lazy, i);
+        __sync_synchronize();
+        *(volatile int *)&lazy->state[i] = lazy->nsegments[i] > 0 ? 2 : 3;
+    }
+    while (*(volatile int *)&lazy->state[i] == 1) {
+        /* Another thread is allocating the table. */
+    }
+    __sync_synchronize();
+    while (*(volatile int *)&lazy->state[i] == 2 && (segment = __sync_fetch_and_add(&lazy->next[i], 1)) < lazy->nsegments[i]) {
+        secp256k1_context_lazy_segment(ctx, lazy, i, segment);
+        /* The atomic increment orders the writes of this segment before the table is marked as built. */
+        if (__sync_add_and_fetch(&lazy->done[i], 1) == lazy->nsegments[i]) {
+            *(volatile int *)&lazy->state[i] = 3;
+        }
+    }
+    if (wait) {
+        while (*(volatile int *)&lazy->state[i] != 3) {
+            /* Other threads are computing the last segments. */
+        }
+        __sync_synchronize();
+    }
+#else
+    (void)wait;
+    if (lazy->state[i] == 0) {
+        lazy->nsegments[i] = secp256k1_context_lazy_alloc(ctx, lazy, i);
+        lazy->state[i] = 2;
+    }
+    while ((segment = lazy->next[i]++) < lazy->nsegments[i]) {
+        secp256k1_context_lazy_segment(ctx, lazy, i, segment);
+    }
+    lazy->state[i] = 3;
+#endif
+}
+
+/* Make sure that the tables selected by flags (SECP256K1_CONTEXT_*) are built, if ctx is lazy. For any
+ * other context this does nothing, and the is_built checks of the callers decide. The table pointer
+ * is what marks a table as built, so it is copied last. */
+static void secp256k1_context_build_lazy(const secp256k1_context_t* ctx, int flags) {
+    secp256k1_context_t *mctx = (secp256k1_context_t *)ctx;
+    secp256k1_context_lazy_t *lazy = ctx->lazy;
+    if (lazy == NULL) {
+        return;
+    }
+    if ((flags & SECP256K1_CONTEXT_VERIFY) && !secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx)) {
+        secp256k1_context_lazy_work(ctx, lazy, SECP256K1_CONTEXT_LAZY_ECMULT, 1);
+        mctx->ecmult_ctx.window_g = lazy->ecmult_ctx.window_g;
+#ifdef USE_ENDOMORPHISM
+        mctx->ecmult_ctx.pre_g_128 = lazy->ecmult_ctx.pre_g_128;
+#endif
+#ifdef HAVE_BUILTIN_SYNC
+        __sync_synchronize();
+#endif
+        mctx->ecmult_ctx.pre_g = lazy->ecmult_ctx.pre_g;
+    }
+    if ((flags & SECP256K1_CONTEXT_SIGN) && !secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx)) {
+        secp256k1_context_lazy_work(ctx, lazy, SECP256K1_CONTEXT_LAZY_ECMULT_GEN, 1);
+        /* The default blinding, as after an eager build. */
+        mctx->ecmult_gen_ctx.blind = lazy->ecmult_gen_ctx.blind;
+        mctx->ecmult_gen_ctx.initial = lazy->ecmult_gen_ctx.initial;
+#ifdef HAVE_BUILTIN_SYNC
+        __sync_synchronize();
+#endif
+        mctx->ecmult_gen_ctx.prec = lazy->ecmult_gen_ctx.prec;
+    }
+    if ((flags & SECP256K1_CONTEXT_COMMIT) && !secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx)) {
+        secp256k1_context_lazy_work(ctx, lazy, SECP256K1_CONTEXT_LAZY_ECMULT_GEN2, 1);
+        mctx->ecmult_gen2_ctx.prec_var = lazy->ecmult_gen2_ctx.prec_var;
+#ifdef HAVE_BUILTIN_SYNC
+        __sync_synchronize();
+#endif
+        mctx->ecmult_gen2_ctx.prec = lazy->ecmult_gen2_ctx.prec;
+    }
+    if ((flags & SECP256K1_CONTEXT_RANGEPROOF) && !secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx)) {
+        secp256k1_context_lazy_work(ctx, lazy, SECP256K1_CONTEXT_LAZY_RANGEPROOF, 1);
+        mctx->rangeproof_ctx = lazy->rangeproof_ctx;
+    }
+}
+
 secp256k1_context_t* secp256k1_context_create(int flags) {
-    secp256k1_context_t* ret = (secp256k1_context_t*)checked_malloc(sizeof(secp256k1_context_t));
+    return secp256k1_context_create_window(flags, 0);
+}
+
+void secp256k1_context_build_work(const secp256k1_context_t* ctx, int flags) {
+    DEBUG_CHECK(ctx != NULL);
+    if (ctx->lazy == NULL) {
+        return;
+    }
+    /* Tables the context was created with (or has installed already) are not built again. */
+    if ((flags & SECP256K1_CONTEXT_VERIFY) && !secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx)) {
+        secp256k1_context_lazy_work(ctx, ctx->lazy, SECP256K1_CONTEXT_LAZY_ECMULT, 0);
+    }
+    if ((flags & SECP256K1_CONTEXT_SIGN) && !secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx)) {
+        secp256k1_context_lazy_work(ctx, ctx->lazy, SECP256K1_CONTEXT_LAZY_ECMULT_GEN, 0);
+    }
+    if ((flags & SECP256K1_CONTEXT_COMMIT) && !secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx)) {
+        secp256k1_context_lazy_work(ctx, ctx->lazy, SECP256K1_CONTEXT_LAZY_ECMULT_GEN2, 0);
+    }
+    if ((flags & SECP256K1_CONTEXT_RANGEPROOF) && !secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx)) {
+        secp256k1_context_lazy_work(ctx, ctx->lazy, SECP256K1_CONTEXT_LAZY_RANGEPROOF, 0);
+    }
+}
+
+int secp256k1_context_wait_built(const secp256k1_context_t* ctx, int flags) {
+    DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, flags);
+    return (!(flags & SECP256K1_CONTEXT_VERIFY) || secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx)) &&
+     (!(flags & SECP256K1_CONTEXT_SIGN) || secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx)) &&
+     (!(flags & SECP256K1_CONTEXT_COMMIT) || secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx)) &&
+     (!(flags & SECP256K1_CONTEXT_RANGEPROOF) || secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
+}
+
+/* Create a context whose tables are allocated with alloc (which it takes ownership of), or with malloc
+ * if that is NULL. */
+static secp256k1_context_t* secp256k1_context_create_alloc(int flags, int ecmult_window, secp256k1_allocator_t *alloc) {
+    secp256k1_context_t* ret;
+    DEBUG_CHECK(ecmult_window == 0 || (ecmult_window >= ECMULT_WINDOW_MIN && ecmult_window <= ECMULT_WINDOW_MAX));
+    ret = (secp256k1_context_t*)checked_malloc(sizeof(secp256k1_context_t));
+    ret->refcount = (int*)checked_malloc(sizeof(*ret->refcount));
+    *ret->refcount = 1;
+    ret->lazy = NULL;
+    ret->borrowed = 0;
+    ret->alloc = alloc;
 
     secp256k1_ecmult_context_init(&ret->ecmult_ctx);
     secp256k1_ecmult_gen_context_init(&ret->ecmult_gen_ctx);
     secp256k1_ecmult_gen2_context_init(&ret->ecmult_gen2_ctx);
     secp256k1_rangeproof_context_init(&ret->rangeproof_ctx);
 
+    if (flags & SECP256K1_CONTEXT_LAZY) {
+        ret->lazy = (secp256k1_context_lazy_t*)checked_malloc(sizeof(*ret->lazy));
+        memset(ret->lazy->state, 0, sizeof(ret->lazy->state));
+        memset(ret->lazy->next, 0, sizeof(ret->lazy->next));
+        memset(ret->lazy->done, 0, sizeof(ret->lazy->done));
+        ret->lazy->ecmult_window = ecmult_window;
+        secp256k1_ecmult_context_init(&ret->lazy->ecmult_ctx);
+        secp256k1_ecmult_gen_context_init(&ret->lazy->ecmult_gen_ctx);
+        secp256k1_ecmult_gen2_context_init(&ret->lazy->ecmult_gen2_ctx);
+        secp256k1_rangeproof_context_init(&ret->lazy->rangeproof_ctx);
+    }
+
     if (flags & SECP256K1_CONTEXT_SIGN) {
-        secp256k1_ecmult_gen_context_build(&ret->ecmult_gen_ctx);
+        secp256k1_ecmult_gen_context_build(&ret->ecmult_gen_ctx, alloc);
     }
     if (flags & SECP256K1_CONTEXT_VERIFY) {
-        secp256k1_ecmult_context_build(&ret->ecmult_ctx);
+        secp256k1_ecmult_context_build(&ret->ecmult_ctx, ecmult_window ? ecmult_window : WINDOW_G, alloc);
     }
     if (flags & SECP256K1_CONTEXT_COMMIT) {
-        secp256k1_ecmult_gen2_context_build(&ret->ecmult_gen2_ctx);
+        secp256k1_ecmult_gen2_context_build(&ret->ecmult_gen2_ctx, alloc);
     }
     if (flags & SECP256K1_CONTEXT_RANGEPROOF) {
-        secp256k1_rangeproof_context_build(&ret->rangeproof_ctx);
+        secp256k1_rangeproof_context_build(&ret->rangeproof_ctx, alloc);
     }
 
     return ret;
 }
 
+secp256k1_context_t* secp256k1_context_create_window(int flags, int ecmult_window) {
+    return secp256k1_context_create_alloc(flags, ecmult_window, NULL);
+}
+
+secp256k1_context_t* secp256k1_context_create_with_allocator(int flags, secp256k1_alloc_function_t alloc_fn,
+ secp256k1_free_function_t free_fn, void *userdata) {
+    secp256k1_allocator_t *alloc;
+    DEBUG_CHECK(alloc_fn != NULL);
+    DEBUG_CHECK(free_fn != NULL);
+    alloc = (secp256k1_allocator_t*)checked_malloc(sizeof(*alloc));
+    alloc->alloc = alloc_fn;
+    alloc->free = free_fn;
+    alloc->data = userdata;
+    return secp256k1_context_create_alloc(flags, 0, alloc);
+}
+
 secp256k1_context_t* secp256k1_context_clone(const secp256k1_context_t* ctx) {
     secp256k1_context_t* ret = (secp256k1_context_t*)checked_malloc(sizeof(secp256k1_context_t));
-    secp256k1_ecmult_context_clone(&ret->ecmult_ctx, &ctx->ecmult_ctx);
-    secp256k1_ecmult_gen_context_clone(&ret->ecmult_gen_ctx, &ctx->ecmult_gen_ctx);
-    secp256k1_ecmult_gen2_context_clone(&ret->ecmult_gen2_ctx, &ctx->ecmult_gen2_ctx);
-    secp256k1_rangeproof_context_clone(&ret->rangeproof_ctx, &ctx->rangeproof_ctx);
+    /* Copy the table pointers and the blinding state; only the latter is ever modified. */
+    *ret = *ctx;
+    secp256k1_context_refcount_inc(ret->refcount);
     return ret;
 }
 
 void secp256k1_context_destroy(secp256k1_context_t* ctx) {
-    secp256k1_ecmult_context_clear(&ctx->ecmult_ctx);
-    secp256k1_ecmult_gen_context_clear(&ctx->ecmult_gen_ctx);
-    secp256k1_ecmult_gen2_context_clear(&ctx->ecmult_gen2_ctx);
-    secp256k1_rangeproof_context_clear(&ctx->rangeproof_ctx);
+    if (secp256k1_context_refcount_dec(ctx->refcount) == 0) {
+        secp256k1_context_lazy_t *lazy = ctx->lazy;
+        /* A table that was built lazily belongs to lazy, and ctx may or may not have a copy of it. A
+         * borrowed table belongs to the caller's buffer. */
+        if (lazy != NULL && lazy->state[SECP256K1_CONTEXT_LAZY_ECMULT]) {
+            secp256k1_ecmult_context_clear(&lazy->ecmult_ctx, ctx->alloc);
+        } else if (!(ctx->borrowed & (1 << SECP256K1_CONTEXT_LAZY_ECMULT))) {
+            secp256k1_ecmult_context_clear(&ctx->ecmult_ctx, ctx->alloc);
+        }
+        if (lazy != NULL && lazy->state[SECP256K1_CONTEXT_LAZY_ECMULT_GEN]) {
+            secp256k1_ecmult_gen_context_clear(&lazy->ecmult_gen_ctx, ctx->alloc);
+            secp256k1_scalar_clear(&ctx->ecmult_gen_ctx.blind);
+            secp256k1_gej_clear(&ctx->ecmult_gen_ctx.initial);
+        } else if (!(ctx->borrowed & (1 << SECP256K1_CONTEXT_LAZY_ECMULT_GEN))) {
+            secp256k1_ecmult_gen_context_clear(&ctx->ecmult_gen_ctx, ctx->alloc);
+        } else {
+            secp256k1_scalar_clear(&ctx->ecmult_gen_ctx.blind);
+            secp256k1_gej_clear(&ctx->ecmult_gen_ctx.initial);
+        }
+        if (lazy != NULL && lazy->state[SECP256K1_CONTEXT_LAZY_ECMULT_GEN2]) {
+            secp256k1_ecmult_gen2_context_clear(&lazy->ecmult_gen2_ctx, ctx->alloc);
+        } else if (!(ctx->borrowed & (1 << SECP256K1_CONTEXT_LAZY_ECMULT_GEN2))) {
+            secp256k1_ecmult_gen2_context_clear(&ctx->ecmult_gen2_ctx, ctx->alloc);
+        }
+        if (lazy != NULL && lazy->state[SECP256K1_CONTEXT_LAZY_RANGEPROOF]) {
+            secp256k1_rangeproof_context_clear(&lazy->rangeproof_ctx, ctx->alloc);
+        } else if (!(ctx->borrowed & (1 << SECP256K1_CONTEXT_LAZY_RANGEPROOF))) {
+            secp256k1_rangeproof_context_clear(&ctx->rangeproof_ctx, ctx->alloc);
+        }
+        free(lazy);
+        free(ctx->refcount);
+        free(ctx->alloc);
+    } else {
+        secp256k1_scalar_clear(&ctx->ecmult_gen_ctx.blind);
+        secp256k1_gej_clear(&ctx->ecmult_gen_ctx.initial);
+    }
 
     free(ctx);
 }
 
+/* A serialized context is a header of SECP256K1_CONTEXT_BLOB_HEADER bytes followed by the tables, in the
+ * order of secp256k1_context_blob_sizes and each padded to a multiple of 64 bytes. The header holds:
+ * *   0: the magic "SECPCTX" followed by the version byte;
+ * *   8: the layout of the tables (see secp256k1_context_blob_layout), 12: COMB_BLOCKS, 16: COMB_TEETH,
+ *       20: ECMULT_GEN2_VAR_POINTS;
+ * *  24: the SECP256K1_CONTEXT_* flags of the tables present, 28: the window of the verification tables,
+ *       32: the total length;
+ * *  64: the SHA256 of the whole serialization, computed with these 32 bytes set to zero;
+ * and zeros elsewhere. The fields are 32-bit little endian; the tables are images of the memory. */
+#define SECP256K1_CONTEXT_BLOB_VERSION 1
+#define SECP256K1_CONTEXT_BLOB_HEADER 128
+#define SECP256K1_CONTEXT_BLOB_CHECKSUM 64
+#define SECP256K1_CONTEXT_BLOB_TABLES 6
+#define SECP256K1_CONTEXT_BLOB_FLAGS (SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_COMMIT | SECP256K1_CONTEXT_RANGEPROOF)
+
+static const unsigned char secp256k1_context_blob_magic[8] = {'S', 'E', 'C', 'P', 'C', 'T', 'X', SECP256K1_CONTEXT_BLOB_VERSION};
+
+static void secp256k1_context_blob_write32(unsigned char *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t secp256k1_context_blob_read32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* What the memory images of the tables depend on besides the comb parameters. */
+static uint32_t secp256k1_context_blob_layout(void) {
+    uint32_t layout = sizeof(secp256k1_ge_storage_t) | (sizeof(((secp256k1_fe_storage_t *)NULL)->n[0]) << 8);
+#ifdef WORDS_BIGENDIAN
+    layout |= 1 << 16;
+#endif
+#ifdef USE_ENDOMORPHISM
+    layout |= 1 << 17;
+#endif
+    return layout;
+}
+
+static size_t secp256k1_context_blob_pad(size_t size) {
+    return (size + 63) & ~(size_t)63;
+}
+
+/* The sizes of pre_g, pre_g_128, the ecmult_gen comb, the gen2 prec and prec_var, and the rangeproof
+ * table, or 0 for those not selected by flags. Returns the total length. */
+static size_t secp256k1_context_blob_sizes(size_t *sizes, int flags, int window_g) {
+    size_t len = SECP256K1_CONTEXT_BLOB_HEADER;
+    int i;
+    sizes[0] = (flags & SECP256K1_CONTEXT_VERIFY) ? sizeof(secp256k1_ge_storage_t) * ECMULT_TABLE_SIZE(window_g) : 0;
+#ifdef USE_ENDOMORPHISM
+    sizes[1] = sizes[0];
+#else
+    sizes[1] = 0;
+#endif
+    sizes[2] = (flags & SECP256K1_CONTEXT_SIGN) ? sizeof(secp256k1_ge_storage_t) * COMB_BLOCKS * COMB_POINTS : 0;
+    sizes[3] = (flags & SECP256K1_CONTEXT_COMMIT) ? sizeof(secp256k1_ge_storage_t) * 16 * 16 : 0;
+    sizes[4] = (flags & SECP256K1_CONTEXT_COMMIT) ? sizeof(secp256k1_ge_storage_t) * 65 * ECMULT_GEN2_VAR_POINTS : 0;
+    sizes[5] = (flags & SECP256K1_CONTEXT_RANGEPROOF) ? sizeof(secp256k1_ge_storage_t) * 1005 : 0;
+    for (i = 0; i < SECP256K1_CONTEXT_BLOB_TABLES; i++) {
+        len += secp256k1_context_blob_pad(sizes[i]);
+    }
+    return len;
+}
+
+static void secp256k1_context_blob_checksum(unsigned char *out32, const unsigned char *blob, size_t len) {
+    static const unsigned char zero[32] = {0};
+    secp256k1_sha256_t hash;
+    secp256k1_sha256_initialize(&hash);
+    secp256k1_sha256_write(&hash, blob, SECP256K1_CONTEXT_BLOB_CHECKSUM);
+    secp256k1_sha256_write(&hash, zero, 32);
+    secp256k1_sha256_write(&hash, blob + SECP256K1_CONTEXT_BLOB_CHECKSUM + 32, len - SECP256K1_CONTEXT_BLOB_CHECKSUM - 32);
+    secp256k1_sha256_finalize(&hash, out32);
+}
+
+int secp256k1_context_serialize(const secp256k1_context_t* ctx, unsigned char *output, size_t *outputlen) {
+    const void *tables[SECP256K1_CONTEXT_BLOB_TABLES];
+    size_t sizes[SECP256K1_CONTEXT_BLOB_TABLES];
+    size_t len, pos;
+    int flags = 0, i;
+    DEBUG_CHECK(ctx != NULL);
+    DEBUG_CHECK(outputlen != NULL);
+
+    if (secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx)) {
+        flags |= SECP256K1_CONTEXT_VERIFY;
+    }
+    if (secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx)) {
+        flags |= SECP256K1_CONTEXT_SIGN;
+    }
+    if (secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx)) {
+        flags |= SECP256K1_CONTEXT_COMMIT;
+    }
+    if (secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx)) {
+        flags |= SECP256K1_CONTEXT_RANGEPROOF;
+    }
+    len = secp256k1_context_blob_sizes(sizes, flags, ctx->ecmult_ctx.window_g);
+    if (output == NULL || *outputlen < len) {
+        *outputlen = len;
+        return output == NULL;
+    }
+    tables[0] = ctx->ecmult_ctx.pre_g;
+#ifdef USE_ENDOMORPHISM
+    tables[1] = ctx->ecmult_ctx.pre_g_128;
+#else
+    tables[1] = NULL;
+#endif
+    tables[2] = ctx->ecmult_gen_ctx.prec;
+    tables[3] = ctx->ecmult_gen2_ctx.prec;
+    tables[4] = ctx->ecmult_gen2_ctx.prec_var;
+    tables[5] = ctx->rangeproof_ctx.prec;
+
+    memset(output, 0, len);
+    memcpy(output, secp256k1_context_blob_magic, sizeof(secp256k1_context_blob_magic));
+    secp256k1_context_blob_write32(output + 8, secp256k1_context_blob_layout());
+    secp256k1_context_blob_write32(output + 12, COMB_BLOCKS);
+    secp256k1_context_blob_write32(output + 16, COMB_TEETH);
+    secp256k1_context_blob_write32(output + 20, ECMULT_GEN2_VAR_POINTS);
+    secp256k1_context_blob_write32(output + 24, flags);
+    secp256k1_context_blob_write32(output + 28, (flags & SECP256K1_CONTEXT_VERIFY) ? ctx->ecmult_ctx.window_g : 0);
+    secp256k1_context_blob_write32(output + 32, len);
+    pos = SECP256K1_CONTEXT_BLOB_HEADER;
+    for (i = 0; i < SECP256K1_CONTEXT_BLOB_TABLES; i++) {
+        if (sizes[i] != 0) {
+            memcpy(output + pos, tables[i], sizes[i]);
+        }
+        pos += secp256k1_context_blob_pad(sizes[i]);
+    }
+    secp256k1_context_blob_checksum(output + SECP256K1_CONTEXT_BLOB_CHECKSUM, output, len);
+    *outputlen = len;
+    return 1;
+}
+
+secp256k1_context_t* secp256k1_context_create_from_buffer(const unsigned char *input, size_t inputlen, int flags) {
+    secp256k1_context_t *ret;
+    const unsigned char *tables[SECP256K1_CONTEXT_BLOB_TABLES];
+    size_t sizes[SECP256K1_CONTEXT_BLOB_TABLES];
+    unsigned char checksum[32];
+    size_t len, pos;
+    int blob_flags, window_g, i;
+    DEBUG_CHECK(input != NULL);
+
+    if (inputlen < SECP256K1_CONTEXT_BLOB_HEADER || ((size_t)input & 7) != 0 ||
+        memcmp(input, secp256k1_context_blob_magic, sizeof(secp256k1_context_blob_magic)) != 0 ||
+        secp256k1_context_blob_read32(input + 8) != secp256k1_context_blob_layout() ||
+        secp256k1_context_blob_read32(input + 12) != COMB_BLOCKS ||
+        secp256k1_context_blob_read32(input + 16) != COMB_TEETH ||
+        secp256k1_context_blob_read32(input + 20) != ECMULT_GEN2_VAR_POINTS) {
+        return NULL;
+    }
+    blob_flags = secp256k1_context_blob_read32(input + 24);
+    window_g = secp256k1_context_blob_read32(input + 28);
+    if ((blob_flags & ~SECP256K1_CONTEXT_BLOB_FLAGS) != 0 ||
+        ((blob_flags & SECP256K1_CONTEXT_VERIFY) ? (window_g < ECMULT_WINDOW_MIN || window_g > ECMULT_WINDOW_MAX) : window_g != 0)) {
+        return NULL;
+    }
+    len = secp256k1_context_blob_sizes(sizes, blob_flags, window_g);
+    if (secp256k1_context_blob_read32(input + 32) != len || inputlen != len) {
+        return NULL;
+    }
+    secp256k1_context_blob_checksum(checksum, input, len);
+    if (memcmp(checksum, input + SECP256K1_CONTEXT_BLOB_CHECKSUM, 32) != 0) {
+        return NULL;
+    }
+    pos = SECP256K1_CONTEXT_BLOB_HEADER;
+    for (i = 0; i < SECP256K1_CONTEXT_BLOB_TABLES; i++) {
+        tables[i] = sizes[i] != 0 ? input + pos : NULL;
+        pos += secp256k1_context_blob_pad(sizes[i]);
+    }
+
+    /* Build what the buffer does not have, and point the rest into it. */
+    ret = secp256k1_context_create_window(flags & ~blob_flags, window_g);
+    if (blob_flags & SECP256K1_CONTEXT_VERIFY) {
+        ret->ecmult_ctx.window_g = window_g;
+        ret->ecmult_ctx.pre_g = (secp256k1_ge_storage_t (*)[])tables[0];
+#ifdef USE_ENDOMORPHISM
+        ret->ecmult_ctx.pre_g_128 = (secp256k1_ge_storage_t (*)[])tables[1];
+#endif
+        ret->borrowed |= 1 << SECP256K1_CONTEXT_LAZY_ECMULT;
+    }
+    if (blob_flags & SECP256K1_CONTEXT_SIGN) {
+        ret->ecmult_gen_ctx.prec = (secp256k1_ge_storage_t (*)[COMB_BLOCKS][COMB_POINTS])tables[2];
+        secp256k1_ecmult_gen_blind(&ret->ecmult_gen_ctx, NULL);
+        ret->borrowed |= 1 << SECP256K1_CONTEXT_LAZY_ECMULT_GEN;
+    }
+    if (blob_flags & SECP256K1_CONTEXT_COMMIT) {
+        ret->ecmult_gen2_ctx.prec = (secp256k1_ge_storage_t (*)[16][16])tables[3];
+        ret->ecmult_gen2_ctx.prec_var = (secp256k1_ge_storage_t (*)[65][ECMULT_GEN2_VAR_POINTS])tables[4];
+        ret->borrowed |= 1 << SECP256K1_CONTEXT_LAZY_ECMULT_GEN2;
+    }
+    if (blob_flags & SECP256K1_CONTEXT_RANGEPROOF) {
+        ret->rangeproof_ctx.prec = (secp256k1_ge_storage_t (*)[1005])tables[5];
+        ret->borrowed |= 1 << SECP256K1_CONTEXT_LAZY_RANGEPROOF;
+    }
+    return ret;
+}
+
 int secp256k1_ecdsa_verify(const secp256k1_context_t* ctx, const unsigned char *msg32, const unsigned char *sig, int siglen, const unsigned char *pubkey, int pubkeylen) {
     secp256k1_ge_t q;
     secp256k1_ecdsa_sig_t s;
     secp256k1_scalar_t m;
     int ret = -3;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
     DEBUG_CHECK(msg32 != NULL);
     DEBUG_CHECK(sig != NULL);
@@ -124,6 +582,7 @@ int secp256k1_ecdsa_sign(const secp256k1_context_t* ctx, const unsigned char *ms
     int overflow = 0;
     unsigned int count = 0;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
     DEBUG_CHECK(msg32 != NULL);
     DEBUG_CHECK(signature != NULL);
@@ -172,6 +631,7 @@ int secp256k1_ecdsa_sign_compact(const secp256k1_context_t* ctx, const unsigned
     int overflow = 0;
     unsigned int count = 0;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
     DEBUG_CHECK(msg32 != NULL);
     DEBUG_CHECK(sig64 != NULL);
@@ -220,6 +680,7 @@ int secp256k1_ecdsa_recover_compact(const secp256k1_context_t* ctx, const unsign
     int ret = 0;
     int overflow = 0;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
     DEBUG_CHECK(msg32 != NULL);
     DEBUG_CHECK(sig64 != NULL);
@@ -297,6 +758,7 @@ int secp256k1_ec_pubkey_create(const secp256k1_context_t* ctx, unsigned char *pu
     int overflow;
     int ret = 0;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
     DEBUG_CHECK(pubkey != NULL);
     DEBUG_CHECK(pubkeylen != NULL);
@@ -357,6 +819,7 @@ int secp256k1_ec_pubkey_tweak_add(const secp256k1_context_t* ctx, unsigned char
     int ret = 0;
     int overflow = 0;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
     DEBUG_CHECK(pubkey != NULL);
     DEBUG_CHECK(tweak != NULL);
@@ -405,6 +868,7 @@ int secp256k1_ec_pubkey_tweak_mul(const secp256k1_context_t* ctx, unsigned char
     int ret = 0;
     int overflow = 0;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
     DEBUG_CHECK(pubkey != NULL);
     DEBUG_CHECK(tweak != NULL);
@@ -413,7 +877,7 @@ int secp256k1_ec_pubkey_tweak_mul(const secp256k1_context_t* ctx, unsigned char
     if (!overflow) {
         ret = secp256k1_eckey_pubkey_parse(&p, pubkey, pubkeylen);
         if (ret) {
-            ret = secp256k1_eckey_pubkey_tweak_mul(&ctx->ecmult_ctx, &p, &factor);
+            ret = secp256k1_eckey_pubkey_tweak_mul(&p, &factor);
         }
         if (ret) {
             int oldlen = pubkeylen;
@@ -432,6 +896,7 @@ int secp256k1_ec_privkey_export(const secp256k1_context_t* ctx, const unsigned c
     DEBUG_CHECK(privkey != NULL);
     DEBUG_CHECK(privkeylen != NULL);
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
 
     secp256k1_scalar_set_b32(&key, seckey, NULL);
@@ -457,6 +922,7 @@ int secp256k1_ec_privkey_import(const secp256k1_context_t* ctx, unsigned char *s
 
 int secp256k1_context_randomize(secp256k1_context_t* ctx, const unsigned char *seed32) {
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
     secp256k1_ecmult_gen_blind(&ctx->ecmult_gen_ctx, seed32);
     return 1;
@@ -471,7 +937,9 @@ int secp256k1_pedersen_commit(const secp256k1_context_t* ctx, unsigned char *com
     int overflow;
     int ret = 0;
     DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
     DEBUG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
     DEBUG_CHECK(commit != NULL);
     DEBUG_CHECK(blind != NULL);
@@ -490,66 +958,174 @@ int secp256k1_pedersen_commit(const secp256k1_context_t* ctx, unsigned char *com
     return ret;
 }
 
+/* Generates n pedersen commitments at once, converting all of them to affine coordinates with a single inversion. */
+int secp256k1_pedersen_commit_batch(const secp256k1_context_t* ctx, unsigned char * const *commits, const unsigned char * const *blinds,
+ const uint64_t *values, size_t n) {
+    secp256k1_gej_t *rj;
+    secp256k1_ge_t *r;
+    unsigned char *valid;
+    secp256k1_scalar_t sec;
+    size_t i;
+    int sz;
+    int overflow;
+    int ret = 1;
+    DEBUG_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    DEBUG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    DEBUG_CHECK(n == 0 || commits != NULL);
+    DEBUG_CHECK(n == 0 || blinds != NULL);
+    DEBUG_CHECK(n == 0 || values != NULL);
+    if (n == 0) {
+        return 1;
+    }
+    rj = (secp256k1_gej_t *)checked_malloc(sizeof(secp256k1_gej_t) * n);
+    r = (secp256k1_ge_t *)checked_malloc(sizeof(secp256k1_ge_t) * n);
+    valid = (unsigned char *)checked_malloc(n);
+    for (i = 0; i < n; i++) {
+        secp256k1_scalar_set_b32(&sec, blinds[i], &overflow);
+        valid[i] = !overflow;
+        if (valid[i]) {
+            secp256k1_ecmult_gen_gen2(&ctx->ecmult_gen_ctx, &ctx->ecmult_gen2_ctx, &rj[i], &sec, values[i]);
+            valid[i] = !secp256k1_gej_is_infinity(&rj[i]);
+        }
+        if (!valid[i]) {
+            /* A stand-in, as the constant time conversion takes no points at infinity. */
+            secp256k1_gej_set_ge(&rj[i], &secp256k1_ge_const_g);
+        }
+    }
+    secp256k1_scalar_clear(&sec);
+    secp256k1_ge_set_all_gej(n, r, rj);
+    for (i = 0; i < n; i++) {
+        r[i].infinity = !valid[i];
+    }
+    free(valid);
+    for (i = 0; i < n; i++) {
+        sz = 33;
+        if (secp256k1_ge_is_infinity(&r[i]) || !secp256k1_eckey_pubkey_serialize(&r[i], commits[i], &sz, 1)) {
+            memset(commits[i], 0, 33);
+            ret = 0;
+        }
+        secp256k1_gej_clear(&rj[i]);
+        secp256k1_ge_clear(&r[i]);
+    }
+    free(rj);
+    free(r);
+    return ret;
+}
+
+/* Writes acc[0] - acc[1], the sums of the positive and the negative blinding factors, to blind_out. */
+static void secp256k1_pedersen_blind_sum_finish(unsigned char *blind_out, const secp256k1_scalar_acc_t *acc) {
+    secp256k1_scalar_t pos;
+    secp256k1_scalar_t neg;
+    secp256k1_scalar_acc_get(&pos, &acc[0]);
+    secp256k1_scalar_acc_get(&neg, &acc[1]);
+    secp256k1_scalar_negate(&neg, &neg);
+    secp256k1_scalar_add(&pos, &pos, &neg);
+    secp256k1_scalar_get_b32(blind_out, &pos);
+    secp256k1_scalar_clear(&pos);
+    secp256k1_scalar_clear(&neg);
+}
+
 /** Takes a list of n pointers to 32 byte blinding values, the first negs of which are treated with positive sign and the rest
  *  negative, then calculates an additional blinding value that adds to zero.
  */
 int secp256k1_pedersen_blind_sum(const secp256k1_context_t* ctx, unsigned char *blind_out, const unsigned char * const *blinds, int n, int npositive) {
-    secp256k1_scalar_t acc;
+    secp256k1_scalar_acc_t acc[2];
     secp256k1_scalar_t x;
     int i;
     int overflow;
     DEBUG_CHECK(ctx != NULL);
     DEBUG_CHECK(blind_out != NULL);
     DEBUG_CHECK(blinds != NULL);
-    secp256k1_scalar_set_int(&acc, 0);
-    for (i = 0; i < n; i++) {
+    /* The positive and the negative factors are summed apart, and only reduced (and subtracted) at the end. */
+    secp256k1_scalar_acc_clear(&acc[0]);
+    secp256k1_scalar_acc_clear(&acc[1]);
+    overflow = 0;
+    for (i = 0; i < n && !overflow; i++) {
         secp256k1_scalar_set_b32(&x, blinds[i], &overflow);
-        if (overflow) {
-            return 0;
-        }
-        if (i >= npositive) {
-            secp256k1_scalar_negate(&x, &x);
-        }
-        secp256k1_scalar_add(&acc, &acc, &x);
+        secp256k1_scalar_acc_add(&acc[i >= npositive], &x);
+    }
+    if (!overflow) {
+        secp256k1_pedersen_blind_sum_finish(blind_out, acc);
     }
-    secp256k1_scalar_get_b32(blind_out, &acc);
-    secp256k1_scalar_clear(&acc);
+    secp256k1_scalar_acc_clear(&acc[0]);
+    secp256k1_scalar_acc_clear(&acc[1]);
     secp256k1_scalar_clear(&x);
-    return 1;
+    return !overflow;
 }
-/* Takes two list of 33-byte commitments and sums the first set and subtracts the second and verifies that they sum to excess. */
-int secp256k1_pedersen_verify_tally(const secp256k1_context_t* ctx, const unsigned char * const *commits, int pcnt,
- const unsigned char * const *ncommits, int ncnt, int64_t excess) {
-    secp256k1_gej_t accj;
-    secp256k1_ge_t add;
-    int i;
+
+int secp256k1_pedersen_blind_sum_batch(const secp256k1_context_t* ctx, unsigned char *blind_out, const unsigned char *blinds, size_t n, const unsigned char *negative) {
+    secp256k1_scalar_acc_t acc[2];
+    secp256k1_scalar_t x;
+    size_t i;
+    int overflow;
     DEBUG_CHECK(ctx != NULL);
-    DEBUG_CHECK(!pcnt || (commits != NULL));
-    DEBUG_CHECK(!ncnt || (ncommits != NULL));
-    DEBUG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
-    secp256k1_gej_set_infinity(&accj);
+    DEBUG_CHECK(blind_out != NULL);
+    DEBUG_CHECK(blinds != NULL || n == 0);
+    secp256k1_scalar_acc_clear(&acc[0]);
+    secp256k1_scalar_acc_clear(&acc[1]);
+    overflow = 0;
+    for (i = 0; i < n && !overflow; i++) {
+        secp256k1_scalar_set_b32(&x, &blinds[i * 32], &overflow);
+        secp256k1_scalar_acc_add(&acc[negative != NULL && ((negative[i >> 3] >> (i & 7)) & 1)], &x);
+    }
+    if (!overflow) {
+        secp256k1_pedersen_blind_sum_finish(blind_out, acc);
+    }
+    secp256k1_scalar_acc_clear(&acc[0]);
+    secp256k1_scalar_acc_clear(&acc[1]);
+    secp256k1_scalar_clear(&x);
+    return !overflow;
+}
+/** Commitments are summed this many at a time, so that rounds of secp256k1_gej_add_all_ge_var share
+ *  their inversions between enough points. */
+#define SECP256K1_PEDERSEN_TALLY_CHUNK 256
+
+/* Sets *accj = excess * G2, the starting point of a tally. */
+static void secp256k1_pedersen_tally_start(const secp256k1_ecmult_gen2_context_t *gen2ctx, secp256k1_gej_t *accj, int64_t excess) {
+    secp256k1_gej_set_infinity(accj);
     if (excess) {
         uint64_t ex;
         int neg;
         /* Take the absolute value, and negate the result if the input was negative. */
         neg = secp256k1_sign_and_abs64(&ex, excess);
-        secp256k1_ecmult_gen2_small(&ctx->ecmult_gen2_ctx, &accj, ex);
+        secp256k1_ecmult_gen2_small_var(gen2ctx, accj, ex);
         if (neg) {
-            secp256k1_gej_neg(&accj, &accj);
+            secp256k1_gej_neg(accj, accj);
         }
     }
-    for (i = 0; i < ncnt; i++) {
-        if (!secp256k1_eckey_pubkey_parse(&add, ncommits[i], 33)) {
+}
+
+/* Takes two list of 33-byte commitments and sums the first set and subtracts the second and verifies that they sum to excess. */
+int secp256k1_pedersen_verify_tally(const secp256k1_context_t* ctx, const unsigned char * const *commits, int pcnt,
+ const unsigned char * const *ncommits, int ncnt, int64_t excess) {
+    secp256k1_gej_t accj;
+    secp256k1_ge_t add[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    secp256k1_fe_t work[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    int valid[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    int i, n;
+    DEBUG_CHECK(ctx != NULL);
+    DEBUG_CHECK(!pcnt || (commits != NULL));
+    DEBUG_CHECK(!ncnt || (ncommits != NULL));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    DEBUG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_pedersen_tally_start(&ctx->ecmult_gen2_ctx, &accj, excess);
+    for (i = 0; i < ncnt; i += n) {
+        n = ncnt - i < SECP256K1_PEDERSEN_TALLY_CHUNK ? ncnt - i : SECP256K1_PEDERSEN_TALLY_CHUNK;
+        if (!secp256k1_eckey_pubkey_parse_batch(add, valid, &ncommits[i], n)) {
             return 0;
         }
-        secp256k1_gej_add_ge_var(&accj, &accj, &add, NULL);
+        secp256k1_gej_add_all_ge_var(&accj, add, n, work);
     }
     secp256k1_gej_neg(&accj, &accj);
-    for (i = 0; i < pcnt; i++) {
-        if (!secp256k1_eckey_pubkey_parse(&add, commits[i], 33)) {
+    for (i = 0; i < pcnt; i += n) {
+        n = pcnt - i < SECP256K1_PEDERSEN_TALLY_CHUNK ? pcnt - i : SECP256K1_PEDERSEN_TALLY_CHUNK;
+        if (!secp256k1_eckey_pubkey_parse_batch(add, valid, &commits[i], n)) {
             return 0;
         }
-        secp256k1_gej_add_ge_var(&accj, &accj, &add, NULL);
+        secp256k1_gej_add_all_ge_var(&accj, add, n, work);
     }
     return secp256k1_gej_is_infinity(&accj);
 }
@@ -568,35 +1144,64 @@ int secp256k1_rangeproof_info(const secp256k1_context_t* ctx, int *exp, int *man
     return secp256k1_rangeproof_getheader_impl(&offset, exp, mantissa, &scale, min_value, max_value, proof, plen);
 }
 
+int secp256k1_rangeproof_peek(const secp256k1_context_t* ctx, int *exp, int *mantissa,
+ uint64_t *min_value, uint64_t *max_value, int *plen, const unsigned char *proof, int len) {
+    DEBUG_CHECK(exp != NULL);
+    DEBUG_CHECK(mantissa != NULL);
+    DEBUG_CHECK(min_value != NULL);
+    DEBUG_CHECK(max_value != NULL);
+    DEBUG_CHECK(plen != NULL);
+    DEBUG_CHECK(proof != NULL);
+    (void)ctx;
+    return secp256k1_rangeproof_peek_impl(exp, mantissa, min_value, max_value, plen, proof, len);
+}
+
 int secp256k1_rangeproof_rewind(const secp256k1_context_t* ctx,
  unsigned char *blind_out, uint64_t *value_out, unsigned char *message_out, int *outlen, const unsigned char *nonce,
  uint64_t *min_value, uint64_t *max_value,
  const unsigned char *commit, const unsigned char *proof, int plen) {
+    secp256k1_scratch_t *scratch;
+    int ret;
     DEBUG_CHECK(ctx != NULL);
     DEBUG_CHECK(commit != NULL);
     DEBUG_CHECK(proof != NULL);
     DEBUG_CHECK(min_value != NULL);
     DEBUG_CHECK(max_value != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
     DEBUG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
     DEBUG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
-    return secp256k1_rangeproof_verify_impl(&ctx->ecmult_ctx, &ctx->ecmult_gen_ctx, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx,
-     blind_out, value_out, message_out, outlen, nonce, min_value, max_value, commit, proof, plen);
+    scratch = secp256k1_scratch_create(SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE);
+    ret = secp256k1_rangeproof_verify_impl(&ctx->ecmult_ctx, &ctx->ecmult_gen_ctx, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx, scratch,
+     blind_out, value_out, message_out, outlen, nonce, min_value, max_value, commit, NULL, proof, plen);
+    secp256k1_scratch_destroy(scratch);
+    return ret;
 }
 
 int secp256k1_rangeproof_verify(const secp256k1_context_t* ctx, uint64_t *min_value, uint64_t *max_value,
  const unsigned char *commit, const unsigned char *proof, int plen) {
+    secp256k1_scratch_t *scratch;
+    int ret;
     DEBUG_CHECK(ctx != NULL);
     DEBUG_CHECK(commit != NULL);
     DEBUG_CHECK(proof != NULL);
     DEBUG_CHECK(min_value != NULL);
     DEBUG_CHECK(max_value != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
     DEBUG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
     DEBUG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
-    return secp256k1_rangeproof_verify_impl(&ctx->ecmult_ctx, NULL, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx,
-     NULL, NULL, NULL, NULL, NULL, min_value, max_value, commit, proof, plen);
+    scratch = secp256k1_scratch_create(SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE);
+    ret = secp256k1_rangeproof_verify_impl(&ctx->ecmult_ctx, NULL, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx, scratch,
+     NULL, NULL, NULL, NULL, NULL, min_value, max_value, commit, NULL, proof, plen);
+    secp256k1_scratch_destroy(scratch);
+    return ret;
 }
 
 int secp256k1_rangeproof_sign(const secp256k1_context_t* ctx, unsigned char *proof, int *plen, uint64_t min_value,
@@ -607,9 +1212,13 @@ int secp256k1_rangeproof_sign(const secp256k1_context_t* ctx, unsigned char *pro
     DEBUG_CHECK(commit != NULL);
     DEBUG_CHECK(blind != NULL);
     DEBUG_CHECK(nonce != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     DEBUG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     DEBUG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
     DEBUG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
     DEBUG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
     return secp256k1_rangeproof_sign_impl(&ctx->ecmult_ctx, &ctx->ecmult_gen_ctx, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx,
      proof, plen, min_value, commit, blind, nonce, exp, min_bits, value);
@@ -704,6 +1313,7 @@ int secp256k1_ec_pubkey_create_ex(const secp256k1_context* ctx, secp256k1_pubkey
     VERIFY_CHECK(ctx != NULL);
     ARG_CHECK(pubkey != NULL);
     memset(pubkey, 0, sizeof(*pubkey));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
     ARG_CHECK(seckey != NULL);
 
@@ -717,6 +1327,56 @@ int secp256k1_ec_pubkey_create_ex(const secp256k1_context* ctx, secp256k1_pubkey
     secp256k1_scalar_clear(&sec);
     return ret;
 }
+int secp256k1_ec_pubkey_create_batch(const secp256k1_context* ctx, secp256k1_pubkey *pubkeys, const unsigned char * const *seckeys, size_t n) {
+    secp256k1_gej *pj;
+    secp256k1_ge *p;
+    unsigned char *valid;
+    secp256k1_scalar sec;
+    size_t i;
+    int overflow;
+    int ret = 1;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(n == 0 || seckeys != NULL);
+    if (n == 0) {
+        return 1;
+    }
+
+    pj = (secp256k1_gej *)checked_malloc(sizeof(secp256k1_gej) * n);
+    p = (secp256k1_ge *)checked_malloc(sizeof(secp256k1_ge) * n);
+    valid = (unsigned char *)checked_malloc(n);
+    for (i = 0; i < n; i++) {
+        secp256k1_scalar_set_b32(&sec, seckeys[i], &overflow);
+        valid[i] = !overflow && !secp256k1_scalar_is_zero(&sec);
+        if (valid[i]) {
+            secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &pj[i], &sec);
+        } else {
+            /* A stand-in, as the constant time conversion takes no points at infinity. */
+            secp256k1_gej_set_ge(&pj[i], &secp256k1_ge_const_g);
+        }
+    }
+    secp256k1_scalar_clear(&sec);
+    secp256k1_ge_set_all_gej(n, p, pj);
+    for (i = 0; i < n; i++) {
+        p[i].infinity = !valid[i];
+    }
+    free(valid);
+    for (i = 0; i < n; i++) {
+        if (secp256k1_ge_is_infinity(&p[i])) {
+            memset(&pubkeys[i], 0, sizeof(pubkeys[i]));
+            ret = 0;
+        } else {
+            secp256k1_pubkey_save(&pubkeys[i], &p[i]);
+        }
+        secp256k1_gej_clear(&pj[i]);
+    }
+    free(pj);
+    free(p);
+    return ret;
+}
+
 typedef int (*secp256k1_nonce_function_t)(
   unsigned char *nonce32,
   const unsigned char *msg32,
@@ -733,6 +1393,7 @@ int secp256k1_ecdsa_sign_ex(const secp256k1_context* ctx, secp256k1_ecdsa_signat
     int ret = 0;
     int overflow = 0;
     VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
     ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
     ARG_CHECK(msg32 != NULL);
     ARG_CHECK(signature != NULL);
@@ -774,55 +1435,296 @@ int secp256k1_ecdsa_sign_ex(const secp256k1_context* ctx, secp256k1_ecdsa_signat
     return ret;
 }
 
-int secp256k1_ec_pubkey_parse(const secp256k1_context* ctx, secp256k1_pubkey* pubkey, const unsigned char *input, size_t inputlen) {
-    secp256k1_ge Q;
-
+int secp256k1_ecdsa_sign_batch(const secp256k1_context* ctx, secp256k1_ecdsa_signature *sigs, int *valid, const unsigned char * const *msgs32, const unsigned char * const *seckeys, size_t n) {
+    secp256k1_ecdsa_sig_t sig[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    secp256k1_scalar sec[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    secp256k1_scalar msg[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    secp256k1_scalar non[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    size_t idx[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    int state[SECP256K1_ECDSA_SIGN_BATCH_CHUNK]; /* 0 invalid key, 1 signed, -1 to be signed on its own */
+    int ok[SECP256K1_ECDSA_SIGN_BATCH_CHUNK];
+    unsigned char nonce32[32];
+    secp256k1_sha256_t sha;
+    secp256k1_scalar blind;
+    size_t i, j, len, m;
+    int overflow;
+    int ret = 1;
     VERIFY_CHECK(ctx != NULL);
-    ARG_CHECK(pubkey != NULL);
-    memset(pubkey, 0, sizeof(*pubkey));
-    ARG_CHECK(input != NULL);
-    if (!secp256k1_eckey_pubkey_parse(&Q, input, inputlen)) {
-        return 0;
-    }
-    secp256k1_pubkey_save(pubkey, &Q);
-    secp256k1_ge_clear(&Q);
-    return 1;
-}
-
-int secp256k1_ec_pubkey_serialize(const secp256k1_context* ctx, unsigned char *output, size_t *outputlen, const secp256k1_pubkey* pubkey, unsigned int flags) {
-    secp256k1_ge Q;
-    size_t len;
-    int ret = 0;
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(n == 0 || sigs != NULL);
+    ARG_CHECK(n == 0 || msgs32 != NULL);
+    ARG_CHECK(n == 0 || seckeys != NULL);
+
+    for (i = 0; i < n; i += len) {
+        len = n - i;
+        if (len > SECP256K1_ECDSA_SIGN_BATCH_CHUNK) {
+            len = SECP256K1_ECDSA_SIGN_BATCH_CHUNK;
+        }
+        /* Derive the first RFC6979 nonce of every valid key, and a blinding factor from all of them. */
+        secp256k1_sha256_initialize(&sha);
+        m = 0;
+        for (j = 0; j < len; j++) {
+            ARG_CHECK(msgs32[i + j] != NULL);
+            ARG_CHECK(seckeys[i + j] != NULL);
+            memset(&sigs[i + j], 0, sizeof(sigs[i + j]));
+            state[j] = 0;
+            secp256k1_scalar_set_b32(&sec[m], seckeys[i + j], &overflow);
+            if (overflow || secp256k1_scalar_is_zero(&sec[m])) {
+                continue;
+            }
+            nonce_function_rfc6979(nonce32, msgs32[i + j], seckeys[i + j], 0, NULL);
+            secp256k1_scalar_set_b32(&non[m], nonce32, &overflow);
+            secp256k1_sha256_write(&sha, nonce32, 32);
+            if (overflow || secp256k1_scalar_is_zero(&non[m])) {
+                /* Left for secp256k1_ecdsa_sign_ex below, which moves on to the next attempt. */
+                state[j] = -1;
+                continue;
+            }
+            secp256k1_scalar_set_b32(&msg[m], msgs32[i + j], NULL);
+            idx[m++] = j;
+        }
+        secp256k1_sha256_finalize(&sha, nonce32);
+        secp256k1_scalar_set_b32(&blind, nonce32, NULL);
+        if (secp256k1_scalar_is_zero(&blind)) {
+            secp256k1_scalar_set_int(&blind, 1);
+        }
 
-    VERIFY_CHECK(ctx != NULL);
-    ARG_CHECK(outputlen != NULL);
-    ARG_CHECK(*outputlen >= ((flags & SECP256K1_FLAGS_BIT_COMPRESSION) ? 33 : 65));
-    len = *outputlen;
-    *outputlen = 0;
-    ARG_CHECK(output != NULL);
-    memset(output, 0, len);
-    ARG_CHECK(pubkey != NULL);
-    ARG_CHECK((flags & SECP256K1_FLAGS_TYPE_MASK) == SECP256K1_FLAGS_TYPE_COMPRESSION);
-    if (secp256k1_pubkey_load(ctx, &Q, pubkey)) {
-        ret = secp256k1_eckey_pubkey_serialize(&Q, output, (int*)&len, flags & SECP256K1_FLAGS_BIT_COMPRESSION);
-        if (ret) {
-            *outputlen = len;
+        secp256k1_ecdsa_sig_sign_batch(&ctx->ecmult_gen_ctx, sig, ok, sec, msg, non, &blind, m);
+        for (j = 0; j < m; j++) {
+            if (ok[j]) {
+                state[idx[j]] = 1;
+                secp256k1_ecdsa_signature_save(&sigs[i + idx[j]], &sig[j].r, &sig[j].s);
+            } else {
+                state[idx[j]] = -1;
+            }
+        }
+        for (j = 0; j < len; j++) {
+            if (state[j] == -1) {
+                /* The first nonce of this entry was unusable; rare enough to redo it on its own. */
+                state[j] = secp256k1_ecdsa_sign_ex(ctx, &sigs[i + j], msgs32[i + j], seckeys[i + j], NULL, NULL);
+            }
+            if (valid != NULL) {
+                valid[i + j] = state[j];
+            }
+            ret &= state[j];
         }
     }
+    memset(nonce32, 0, 32);
+    memset(&sha, 0, sizeof(sha));
+    for (j = 0; j < SECP256K1_ECDSA_SIGN_BATCH_CHUNK; j++) {
+        secp256k1_scalar_clear(&sec[j]);
+        secp256k1_scalar_clear(&non[j]);
+    }
+    secp256k1_scalar_clear(&blind);
     return ret;
 }
 
-int secp256k1_ecdsa_signature_parse_compact(const secp256k1_context* ctx, secp256k1_ecdsa_signature* sig, const unsigned char *input64) {
-    secp256k1_scalar r, s;
-    int ret = 1;
-    int overflow = 0;
-
-    VERIFY_CHECK(ctx != NULL);
-    ARG_CHECK(sig != NULL);
-    ARG_CHECK(input64 != NULL);
+/* A keypair holds the secret scalar (as in secp256k1_ecdsa_signature_load/save), the public key in
+ * secp256k1_pubkey format and the RFC6979 key midstate, in that order. */
+static int secp256k1_keypair_load(secp256k1_scalar* sec, secp256k1_sha256_midstate_t* mid, const secp256k1_keypair* keypair) {
+    if (sizeof(secp256k1_scalar) == 32) {
+        memcpy(sec, &keypair->data[0], 32);
+    } else {
+        secp256k1_scalar_set_b32(sec, &keypair->data[0], NULL);
+    }
+    memcpy(mid->s, &keypair->data[96], 32);
+    mid->bytes = 128;
+    return !secp256k1_scalar_is_zero(sec);
+}
 
-    secp256k1_scalar_set_b32(&r, &input64[0], &overflow);
-    ret &= !overflow;
+static void secp256k1_keypair_save(secp256k1_keypair* keypair, const secp256k1_scalar* sec, secp256k1_ge* pub, const secp256k1_sha256_midstate_t* mid) {
+    secp256k1_pubkey pubkey;
+    if (sizeof(secp256k1_scalar) == 32) {
+        memcpy(&keypair->data[0], sec, 32);
+    } else {
+        secp256k1_scalar_get_b32(&keypair->data[0], sec);
+    }
+    secp256k1_pubkey_save(&pubkey, pub);
+    memcpy(&keypair->data[32], &pubkey.data[0], 64);
+    VERIFY_CHECK(mid->bytes == 128);
+    memcpy(&keypair->data[96], mid->s, 32);
+}
+
+int secp256k1_keypair_create(const secp256k1_context* ctx, secp256k1_keypair *keypair, const unsigned char *seckey) {
+    secp256k1_gej pj;
+    secp256k1_ge p;
+    secp256k1_scalar sec;
+    secp256k1_sha256_midstate_t mid;
+    int overflow;
+    int ret = 0;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(keypair != NULL);
+    memset(keypair, 0, sizeof(*keypair));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(seckey != NULL);
+
+    secp256k1_scalar_set_b32(&sec, seckey, &overflow);
+    ret = (!overflow) & (!secp256k1_scalar_is_zero(&sec));
+    if (ret) {
+        secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &pj, &sec);
+        secp256k1_ge_set_gej(&p, &pj);
+        secp256k1_rfc6979_hmac_sha256_key_midstate(&mid, seckey, 32);
+        secp256k1_keypair_save(keypair, &sec, &p, &mid);
+        memset(&mid, 0, sizeof(mid));
+        secp256k1_gej_clear(&pj);
+    }
+    secp256k1_scalar_clear(&sec);
+    return ret;
+}
+
+int secp256k1_keypair_pub(const secp256k1_context* ctx, secp256k1_pubkey *pubkey, const secp256k1_keypair *keypair) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(pubkey != NULL);
+    ARG_CHECK(keypair != NULL);
+    (void)ctx;
+
+    memcpy(&pubkey->data[0], &keypair->data[32], 64);
+    return 1;
+}
+
+int secp256k1_ecdsa_sign_keypair(const secp256k1_context* ctx, secp256k1_ecdsa_signature *signature, const unsigned char *msg32, const secp256k1_keypair *keypair, secp256k1_nonce_function noncefp, const void* noncedata) {
+    secp256k1_ecdsa_sig_t sig;
+    secp256k1_scalar sec, non, msg;
+    secp256k1_sha256_midstate_t mid;
+    secp256k1_rfc6979_hmac_sha256_t rng;
+    unsigned char seckey[32];
+    unsigned char nonce32[32];
+    unsigned int count = 0;
+    int rfc6979;
+    int overflow = 0;
+    int ret = 0;
+    VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(signature != NULL);
+    ARG_CHECK(keypair != NULL);
+    if (noncefp == NULL) {
+        noncefp = secp256k1_nonce_function_default;
+    }
+    /* Only the built-in RFC6979 function can start from the cached midstate; it also keeps a single
+     * generator across retries instead of rederiving attempts 0..count for every call. */
+    rfc6979 = (noncefp == nonce_function_rfc6979);
+
+    if (secp256k1_keypair_load(&sec, &mid, keypair)) {
+        secp256k1_scalar_get_b32(seckey, &sec);
+        secp256k1_scalar_set_b32(&msg, msg32, NULL);
+        if (rfc6979) {
+            secp256k1_rfc6979_hmac_sha256_initialize_midstate(&rng, &mid, seckey, 32, msg32, 32, (const unsigned char*)noncedata, noncedata != NULL ? 32 : 0);
+        }
+        while (1) {
+            if (rfc6979) {
+                secp256k1_rfc6979_hmac_sha256_generate(&rng, nonce32, 32);
+                ret = 1;
+            } else {
+                ret = noncefp(nonce32, msg32, seckey, count, noncedata);
+                if (!ret) {
+                    break;
+                }
+            }
+            secp256k1_scalar_set_b32(&non, nonce32, &overflow);
+            if (!overflow && !secp256k1_scalar_is_zero(&non)) {
+                if (secp256k1_ecdsa_sig_sign(&ctx->ecmult_gen_ctx, &sig, &sec, &msg, &non, NULL)) {
+                    break;
+                }
+            }
+            count++;
+        }
+        if (rfc6979) {
+            secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+        }
+        memset(nonce32, 0, 32);
+        memset(seckey, 0, 32);
+        memset(&mid, 0, sizeof(mid));
+        secp256k1_scalar_clear(&msg);
+        secp256k1_scalar_clear(&non);
+    }
+    secp256k1_scalar_clear(&sec);
+    if (ret) {
+        secp256k1_ecdsa_signature_save(signature, &sig.r, &sig.s);
+    } else {
+        memset(signature, 0, sizeof(*signature));
+    }
+    return ret;
+}
+
+int secp256k1_ec_pubkey_parse(const secp256k1_context* ctx, secp256k1_pubkey* pubkey, const unsigned char *input, size_t inputlen) {
+    secp256k1_ge Q;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(pubkey != NULL);
+    memset(pubkey, 0, sizeof(*pubkey));
+    ARG_CHECK(input != NULL);
+    if (!secp256k1_eckey_pubkey_parse(&Q, input, inputlen)) {
+        return 0;
+    }
+    secp256k1_pubkey_save(pubkey, &Q);
+    secp256k1_ge_clear(&Q);
+    return 1;
+}
+
+int secp256k1_ec_pubkey_parse_batch(const secp256k1_context* ctx, secp256k1_pubkey* pubkeys, int *valid, const unsigned char * const *inputs, size_t n) {
+    secp256k1_ge Q[16];
+    int ok[16];
+    size_t i, j, m;
+    int ret = 1;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+    ARG_CHECK(n == 0 || inputs != NULL);
+    for (i = 0; i < n; i += m) {
+        m = n - i < 16 ? n - i : 16;
+        ret &= secp256k1_eckey_pubkey_parse_batch(Q, ok, &inputs[i], m);
+        for (j = 0; j < m; j++) {
+            if (ok[j]) {
+                secp256k1_pubkey_save(&pubkeys[i + j], &Q[j]);
+            } else {
+                memset(&pubkeys[i + j], 0, sizeof(pubkeys[i + j]));
+            }
+            if (valid != NULL) {
+                valid[i + j] = ok[j];
+            }
+        }
+    }
+    return ret;
+}
+
+int secp256k1_ec_pubkey_serialize(const secp256k1_context* ctx, unsigned char *output, size_t *outputlen, const secp256k1_pubkey* pubkey, unsigned int flags) {
+    secp256k1_ge Q;
+    size_t len;
+    int ret = 0;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(outputlen != NULL);
+    ARG_CHECK(*outputlen >= ((flags & SECP256K1_FLAGS_BIT_COMPRESSION) ? 33 : 65));
+    len = *outputlen;
+    *outputlen = 0;
+    ARG_CHECK(output != NULL);
+    memset(output, 0, len);
+    ARG_CHECK(pubkey != NULL);
+    ARG_CHECK((flags & SECP256K1_FLAGS_TYPE_MASK) == SECP256K1_FLAGS_TYPE_COMPRESSION);
+    if (secp256k1_pubkey_load(ctx, &Q, pubkey)) {
+        ret = secp256k1_eckey_pubkey_serialize(&Q, output, (int*)&len, flags & SECP256K1_FLAGS_BIT_COMPRESSION);
+        if (ret) {
+            *outputlen = len;
+        }
+    }
+    return ret;
+}
+
+int secp256k1_ecdsa_signature_parse_compact(const secp256k1_context* ctx, secp256k1_ecdsa_signature* sig, const unsigned char *input64) {
+    secp256k1_scalar r, s;
+    int ret = 1;
+    int overflow = 0;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(input64 != NULL);
+
+    secp256k1_scalar_set_b32(&r, &input64[0], &overflow);
+    ret &= !overflow;
     secp256k1_scalar_set_b32(&s, &input64[32], &overflow);
     ret &= !overflow;
     if (ret) {
@@ -833,6 +1735,55 @@ int secp256k1_ecdsa_signature_parse_compact(const secp256k1_context* ctx, secp25
     return ret;
 }
 
+static int secp256k1_ecdsa_signature_parse_der_impl(secp256k1_ecdsa_signature* sig, const unsigned char *input, size_t inputlen, int lax) {
+    secp256k1_ecdsa_sig_t s;
+    /* secp256k1_ecdsa_sig_parse reads the first length bytes before looking at size; no valid encoding
+     * is shorter than 8 bytes. Nearly all lax signatures are valid DER as well, so it is tried first. */
+    if ((inputlen >= 8 && inputlen <= 0x7FFFFFFF && secp256k1_ecdsa_sig_parse(&s, input, (int)inputlen)) ||
+        (lax && secp256k1_ecdsa_sig_parse_lax(&s, input, inputlen))) {
+        secp256k1_ecdsa_signature_save(sig, &s.r, &s.s);
+        return 1;
+    }
+    memset(sig, 0, sizeof(*sig));
+    return 0;
+}
+
+int secp256k1_ecdsa_signature_parse_der(const secp256k1_context* ctx, secp256k1_ecdsa_signature* sig, const unsigned char *input, size_t inputlen) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(input != NULL);
+
+    return secp256k1_ecdsa_signature_parse_der_impl(sig, input, inputlen, 0);
+}
+
+int secp256k1_ecdsa_signature_parse_der_lax(const secp256k1_context* ctx, secp256k1_ecdsa_signature* sig, const unsigned char *input, size_t inputlen) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(input != NULL);
+
+    return secp256k1_ecdsa_signature_parse_der_impl(sig, input, inputlen, 1);
+}
+
+int secp256k1_ecdsa_signature_parse_der_batch(const secp256k1_context* ctx, secp256k1_ecdsa_signature *sigs, int *valid, const unsigned char *input, const size_t *offsets, const size_t *lens, size_t n, int lax) {
+    size_t i;
+    int ret = 1;
+    int ok;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n == 0 || sigs != NULL);
+    ARG_CHECK(n == 0 || input != NULL);
+    ARG_CHECK(n == 0 || offsets != NULL);
+    ARG_CHECK(n == 0 || lens != NULL);
+
+    for (i = 0; i < n; i++) {
+        ok = secp256k1_ecdsa_signature_parse_der_impl(&sigs[i], input + offsets[i], lens[i], lax);
+        if (valid != NULL) {
+            valid[i] = ok;
+        }
+        ret &= ok;
+    }
+    return ret;
+}
+
 int secp256k1_ecdsa_signature_serialize_der(const secp256k1_context* ctx, unsigned char *output, size_t *outputlen, const secp256k1_ecdsa_signature* signature) {
     secp256k1_ecdsa_sig_t sig;
 
@@ -869,6 +1820,7 @@ int secp256k1_ecdsa_verify_ex(const secp256k1_context* ctx, const secp256k1_ecds
     secp256k1_ecdsa_sig_t sig;
     secp256k1_scalar m;
     VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
     ARG_CHECK(msg32 != NULL);
     ARG_CHECK(signature != NULL);
@@ -881,26 +1833,1419 @@ int secp256k1_ecdsa_verify_ex(const secp256k1_context* ctx, const secp256k1_ecds
             secp256k1_ecdsa_sig_verify(&ctx->ecmult_ctx, &sig, &q, &m));
 }
 
-int secp256k1_ec_pubkey_tweak_add_ex(const secp256k1_context* ctx, secp256k1_pubkey *pubkey, const unsigned char *tweak) {
-    secp256k1_ge p;
-    secp256k1_scalar term;
-    int ret = 0;
-    int overflow = 0;
+int secp256k1_ecdsa_verify_batch(const secp256k1_context* ctx, size_t *first_invalid, const secp256k1_ecdsa_signature * const *sigs, const unsigned char * const *msgs32, const secp256k1_pubkey * const *pubkeys, size_t n) {
+    secp256k1_ecdsa_sig_t sig[SECP256K1_ECDSA_VERIFY_BATCH_CHUNK];
+    secp256k1_ge q[SECP256K1_ECDSA_VERIFY_BATCH_CHUNK];
+    secp256k1_scalar m[SECP256K1_ECDSA_VERIFY_BATCH_CHUNK];
+    size_t i, j, len, bad;
     VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
     ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n == 0 || sigs != NULL);
+    ARG_CHECK(n == 0 || msgs32 != NULL);
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+
+    bad = n;
+    for (i = 0; i < n && bad == n; i += len) {
+        len = n - i;
+        if (len > SECP256K1_ECDSA_VERIFY_BATCH_CHUNK) {
+            len = SECP256K1_ECDSA_VERIFY_BATCH_CHUNK;
+        }
+        for (j = 0; j < len; j++) {
+            ARG_CHECK(sigs[i + j] != NULL);
+            ARG_CHECK(msgs32[i + j] != NULL);
+            ARG_CHECK(pubkeys[i + j] != NULL);
+            secp256k1_ecdsa_signature_load(ctx, &sig[j].r, &sig[j].s, sigs[i + j]);
+            if (secp256k1_scalar_is_high(&sig[j].s) || !secp256k1_pubkey_load(ctx, &q[j], pubkeys[i + j])) {
+                break;
+            }
+            secp256k1_scalar_set_b32(&m[j], msgs32[i + j], NULL);
+        }
+        bad = i + secp256k1_ecdsa_sig_verify_batch(&ctx->ecmult_ctx, sig, q, m, j);
+        if (bad == i + len) {
+            /* The whole chunk verified (a malformed entry stops j, and so bad, short of len). */
+            bad = n;
+        }
+    }
+
+    if (first_invalid != NULL) {
+        *first_invalid = bad;
+    }
+    return bad == n;
+}
+
+struct secp256k1_pubkey_precomp_struct {
+    secp256k1_ecmult_point_table_t table;
+};
+
+secp256k1_pubkey_precomp* secp256k1_pubkey_precomp_create(const secp256k1_context* ctx, const secp256k1_pubkey *pubkey) {
+    secp256k1_pubkey_precomp* ret;
+    secp256k1_ge q;
+    VERIFY_CHECK(ctx != NULL);
     ARG_CHECK(pubkey != NULL);
-    ARG_CHECK(tweak != NULL);
+    if (!secp256k1_pubkey_load(ctx, &q, pubkey)) {
+        return NULL;
+    }
+    ret = (secp256k1_pubkey_precomp*)checked_malloc(sizeof(secp256k1_pubkey_precomp));
+    secp256k1_ecmult_point_table_build(&ret->table, &q);
+    return ret;
+}
 
-    secp256k1_scalar_set_b32(&term, tweak, &overflow);
-    ret = !overflow && secp256k1_pubkey_load(ctx, &p, pubkey);
-    memset(pubkey, 0, sizeof(*pubkey));
-    if (ret) {
-        if (secp256k1_eckey_pubkey_tweak_add(&ctx->ecmult_ctx, &p, &term)) {
-            secp256k1_pubkey_save(pubkey, &p);
-        } else {
-            ret = 0;
-        }
+void secp256k1_pubkey_precomp_destroy(secp256k1_pubkey_precomp* precomp) {
+    free(precomp);
+}
+
+int secp256k1_ecdsa_verify_precomp(const secp256k1_context* ctx, const secp256k1_ecdsa_signature *signature, const unsigned char *msg32, const secp256k1_pubkey_precomp *precomp) {
+    secp256k1_ecdsa_sig_t sig;
+    secp256k1_scalar m;
+    VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(signature != NULL);
+    ARG_CHECK(precomp != NULL);
+
+    secp256k1_scalar_set_b32(&m, msg32, NULL);
+    secp256k1_ecdsa_signature_load(ctx, &sig.r, &sig.s, signature);
+    return (!secp256k1_scalar_is_high(&sig.s) &&
+            secp256k1_ecdsa_sig_verify_point(&ctx->ecmult_ctx, &sig, &precomp->table, &m));
+}
+
+/* The salt fills the first block, so that every lookup starts from its saved midstate. */
+struct secp256k1_sigcache_struct {
+    secp256k1_cuckoo_t set;
+    secp256k1_sha256_midstate_t salt;
+    size_t hits;
+    size_t misses;
+};
+
+secp256k1_sigcache* secp256k1_sigcache_create(const secp256k1_context* ctx, size_t max_entries, const unsigned char *seed32) {
+    secp256k1_sigcache* ret;
+    secp256k1_sha256_t sha;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(seed32 != NULL);
+    if (max_entries == 0 || (uint64_t)max_entries > 0xFFFFFFFFULL) {
+        return NULL;
+    }
+    ret = (secp256k1_sigcache*)checked_malloc(sizeof(secp256k1_sigcache));
+    secp256k1_cuckoo_init(&ret->set, max_entries);
+    secp256k1_sha256_initialize_tagged(&sha, seed32, 32);
+    secp256k1_sha256_save(&sha, &ret->salt);
+    ret->hits = 0;
+    ret->misses = 0;
+    return ret;
+}
+
+void secp256k1_sigcache_destroy(secp256k1_sigcache* cache) {
+    if (cache != NULL) {
+        secp256k1_cuckoo_clear(&cache->set);
+        memset(&cache->salt, 0, sizeof(cache->salt));
+        free(cache);
+    }
+}
+
+void secp256k1_sigcache_get_stats(const secp256k1_sigcache* cache, size_t *hits, size_t *misses) {
+    if (hits != NULL) {
+        *hits = *(const volatile size_t *)&cache->hits;
+    }
+    if (misses != NULL) {
+        *misses = *(const volatile size_t *)&cache->misses;
+    }
+}
+
+static void secp256k1_sigcache_count(size_t *counter) {
+#ifdef HAVE_BUILTIN_SYNC
+    __sync_fetch_and_add(counter, 1);
+#else
+    ++*counter;
+#endif
+}
+
+int secp256k1_ecdsa_verify_cached(const secp256k1_context* ctx, secp256k1_sigcache *cache, const secp256k1_ecdsa_signature *signature, const unsigned char *msg32, const secp256k1_pubkey *pubkey) {
+    secp256k1_sha256_t sha;
+    secp256k1_ge q;
+    secp256k1_ecdsa_sig_t sig;
+    secp256k1_scalar m;
+    unsigned char buf[64];
+    unsigned char key[32];
+    int len = 33;
+    VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(cache != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(signature != NULL);
+    ARG_CHECK(pubkey != NULL);
+
+    secp256k1_ecdsa_signature_load(ctx, &sig.r, &sig.s, signature);
+    if (secp256k1_scalar_is_high(&sig.s) || !secp256k1_pubkey_load(ctx, &q, pubkey)) {
+        return 0;
+    }
+
+    /* The entry is the salted hash of r, s, the message and the compressed public key. */
+    secp256k1_sha256_restore(&sha, &cache->salt);
+    secp256k1_scalar_get_b32(buf, &sig.r);
+    secp256k1_scalar_get_b32(buf + 32, &sig.s);
+    secp256k1_sha256_write(&sha, buf, 64);
+    secp256k1_sha256_write(&sha, msg32, 32);
+    secp256k1_eckey_pubkey_serialize(&q, buf, &len, 1);
+    secp256k1_sha256_write(&sha, buf, len);
+    secp256k1_sha256_finalize(&sha, key);
+    if (secp256k1_cuckoo_contains(&cache->set, key)) {
+        secp256k1_sigcache_count(&cache->hits);
+        return 1;
+    }
+
+    secp256k1_sigcache_count(&cache->misses);
+    secp256k1_scalar_set_b32(&m, msg32, NULL);
+    if (!secp256k1_ecdsa_sig_verify(&ctx->ecmult_ctx, &sig, &q, &m)) {
+        return 0;
     }
+    secp256k1_cuckoo_insert(&cache->set, key);
+    return 1;
+}
 
+int secp256k1_ecdsa_recover_batch(const secp256k1_context* ctx, secp256k1_pubkey *pubkeys, int *valid, const unsigned char * const *sigs64, const int *recids, const unsigned char * const *msgs32, size_t n) {
+    secp256k1_ecdsa_sig_t sig[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    secp256k1_scalar m[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    secp256k1_ge q[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    int ok[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    int parsed[SECP256K1_ECDSA_RECOVER_BATCH_CHUNK];
+    size_t i, j, len;
+    int overflow;
+    int ret = 1;
+    VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+    ARG_CHECK(n == 0 || sigs64 != NULL);
+    ARG_CHECK(n == 0 || recids != NULL);
+    ARG_CHECK(n == 0 || msgs32 != NULL);
+
+    for (i = 0; i < n; i += len) {
+        len = n - i;
+        if (len > SECP256K1_ECDSA_RECOVER_BATCH_CHUNK) {
+            len = SECP256K1_ECDSA_RECOVER_BATCH_CHUNK;
+        }
+        for (j = 0; j < len; j++) {
+            ARG_CHECK(sigs64[i + j] != NULL);
+            ARG_CHECK(msgs32[i + j] != NULL);
+            ARG_CHECK(recids[i + j] >= 0 && recids[i + j] <= 3);
+            overflow = 0;
+            secp256k1_scalar_set_b32(&sig[j].r, sigs64[i + j], &overflow);
+            parsed[j] = !overflow;
+            secp256k1_scalar_set_b32(&sig[j].s, sigs64[i + j] + 32, &overflow);
+            parsed[j] &= !overflow;
+            if (!parsed[j]) {
+                /* Zero r makes secp256k1_ecdsa_sig_recover_batch reject the entry. */
+                secp256k1_scalar_clear(&sig[j].r);
+            }
+            secp256k1_scalar_set_b32(&m[j], msgs32[i + j], NULL);
+        }
+        secp256k1_ecdsa_sig_recover_batch(&ctx->ecmult_ctx, sig, q, ok, m, &recids[i], len);
+        for (j = 0; j < len; j++) {
+            if (ok[j]) {
+                secp256k1_pubkey_save(&pubkeys[i + j], &q[j]);
+            } else {
+                memset(&pubkeys[i + j], 0, sizeof(pubkeys[i + j]));
+            }
+            if (valid != NULL) {
+                valid[i + j] = ok[j];
+            }
+            ret &= ok[j];
+        }
+    }
     return ret;
 }
+
+secp256k1_scratch_space* secp256k1_scratch_space_create(const secp256k1_context* ctx, size_t max_size) {
+    VERIFY_CHECK(ctx != NULL);
+    (void)ctx;
+    return secp256k1_scratch_create(max_size);
+}
+
+void secp256k1_scratch_space_destroy(secp256k1_scratch_space* scratch) {
+    secp256k1_scratch_destroy(scratch);
+}
+
+int secp256k1_rangeproof_verify_scratch(const secp256k1_context* ctx, secp256k1_scratch_space* scratch, uint64_t *min_value, uint64_t *max_value,
+ const unsigned char *commit, const unsigned char *proof, int plen) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(commit != NULL);
+    ARG_CHECK(proof != NULL);
+    ARG_CHECK(min_value != NULL);
+    ARG_CHECK(max_value != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
+    return secp256k1_rangeproof_verify_impl(&ctx->ecmult_ctx, NULL, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx, scratch,
+     NULL, NULL, NULL, NULL, NULL, min_value, max_value, commit, NULL, proof, plen);
+}
+
+int secp256k1_rangeproof_verify_batch(const secp256k1_context* ctx, secp256k1_scratch_space* scratch, const unsigned char * const *commits,
+ const unsigned char * const *proofs, const int *plens, size_t n, uint64_t *min_values, uint64_t *max_values) {
+    size_t i;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(n == 0 || commits != NULL);
+    ARG_CHECK(n == 0 || proofs != NULL);
+    ARG_CHECK(n == 0 || plens != NULL);
+    ARG_CHECK(n == 0 || min_values != NULL);
+    ARG_CHECK(n == 0 || max_values != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
+    for (i = 0; i < n; i++) {
+        ARG_CHECK(commits[i] != NULL);
+        ARG_CHECK(proofs[i] != NULL);
+    }
+    return secp256k1_rangeproof_verify_batch_impl(&ctx->ecmult_ctx, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx, scratch,
+     min_values, max_values, commits, NULL, proofs, plens, n);
+}
+
+int secp256k1_rangeproof_cost_estimate(const secp256k1_context* ctx, secp256k1_rangeproof_cost *cost, uint64_t min_value,
+ int exp, int min_bits, uint64_t value) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(cost != NULL);
+    (void)ctx;
+    cost->exp = exp;
+    cost->min_value = min_value;
+    return secp256k1_rangeproof_cost_impl(&cost->plen, &cost->verify_ecmults, &cost->exp, &cost->mantissa,
+     &cost->min_value, &cost->max_value, min_bits, value);
+}
+
+/* Whether a is strictly cheaper than b, first under objective and then under the other measure. */
+static int secp256k1_rangeproof_cost_less(const secp256k1_rangeproof_cost *a, const secp256k1_rangeproof_cost *b, int objective) {
+    if (objective == SECP256K1_RANGEPROOF_MINIMIZE_VERIFY) {
+        return a->verify_ecmults < b->verify_ecmults || (a->verify_ecmults == b->verify_ecmults && a->plen < b->plen);
+    }
+    return a->plen < b->plen || (a->plen == b->plen && a->verify_ecmults < b->verify_ecmults);
+}
+
+int secp256k1_rangeproof_choose_params(const secp256k1_context* ctx, secp256k1_rangeproof_cost *cost, uint64_t min_value,
+ int max_exp, int min_bits, uint64_t value, int objective) {
+    secp256k1_rangeproof_cost candidate;
+    int found;
+    int exp;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(cost != NULL);
+    if (objective != SECP256K1_RANGEPROOF_MINIMIZE_SIZE && objective != SECP256K1_RANGEPROOF_MINIMIZE_VERIFY) {
+        return 0;
+    }
+    if (max_exp < 0) {
+        return secp256k1_rangeproof_cost_estimate(ctx, cost, min_value, max_exp, min_bits, value);
+    }
+    found = 0;
+    /* Only a strictly cheaper candidate replaces the current one, so ties go to the smaller exponent. */
+    for (exp = 0; exp <= max_exp && exp <= 18; exp++) {
+        if (secp256k1_rangeproof_cost_estimate(ctx, &candidate, min_value, exp, min_bits, value) &&
+         (!found || secp256k1_rangeproof_cost_less(&candidate, cost, objective))) {
+            *cost = candidate;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+int secp256k1_rangeproof_sign_optimal(const secp256k1_context* ctx, unsigned char *proof, int *plen, uint64_t min_value,
+ const unsigned char *commit, const unsigned char *blind, const unsigned char *nonce, int max_exp, int min_bits, uint64_t value,
+ int objective) {
+    secp256k1_rangeproof_cost cost;
+    if (!secp256k1_rangeproof_choose_params(ctx, &cost, min_value, max_exp, min_bits, value, objective)) {
+        return 0;
+    }
+    return secp256k1_rangeproof_sign(ctx, proof, plen, min_value, commit, blind, nonce, cost.exp, min_bits, value);
+}
+
+int secp256k1_ct_transaction_verify(const secp256k1_context* ctx, secp256k1_scratch_space* scratch, const unsigned char * const *inputs,
+ size_t ninputs, const unsigned char * const *outputs, size_t noutputs, int64_t excess, const unsigned char * const *proofs,
+ const int *plens, uint64_t *min_values, uint64_t *max_values) {
+    secp256k1_gej accj;
+    secp256k1_ge *outs;
+    secp256k1_ge add[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    secp256k1_fe work[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    int valid[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    size_t checkpoint;
+    size_t i, n;
+    int ret = 1;
+    VERIFY_CHECK(ctx != NULL);
+    VERIFY_CHECK(sizeof(secp256k1_ge) <= 128);
+    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(ninputs == 0 || inputs != NULL);
+    ARG_CHECK(noutputs == 0 || outputs != NULL);
+    ARG_CHECK(noutputs == 0 || proofs != NULL);
+    ARG_CHECK(noutputs == 0 || plens != NULL);
+    ARG_CHECK(noutputs == 0 || min_values != NULL);
+    ARG_CHECK(noutputs == 0 || max_values != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
+    for (i = 0; i < noutputs; i++) {
+        ARG_CHECK(outputs[i] != NULL);
+        ARG_CHECK(proofs[i] != NULL);
+    }
+
+    checkpoint = secp256k1_scratch_checkpoint(scratch);
+    outs = (secp256k1_ge *)secp256k1_scratch_alloc(scratch, sizeof(secp256k1_ge) * noutputs);
+    if (outs == NULL) {
+        return 0;
+    }
+    /* The outputs are decompressed once, for both the balance and their range proofs. The balance,
+     * sum(inputs) - sum(outputs) - excess*H == 0, is far cheaper than the proofs, so it is checked first. */
+    secp256k1_pedersen_tally_start(&ctx->ecmult_gen2_ctx, &accj, excess);
+    for (i = 0; ret && i < noutputs; i += n) {
+        n = noutputs - i < SECP256K1_PEDERSEN_TALLY_CHUNK ? noutputs - i : SECP256K1_PEDERSEN_TALLY_CHUNK;
+        ret = secp256k1_eckey_pubkey_parse_batch(&outs[i], valid, &outputs[i], n);
+        if (ret) {
+            memcpy(add, &outs[i], sizeof(secp256k1_ge) * n);
+            secp256k1_gej_add_all_ge_var(&accj, add, n, work);
+        }
+    }
+    secp256k1_gej_neg(&accj, &accj);
+    for (i = 0; ret && i < ninputs; i += n) {
+        n = ninputs - i < SECP256K1_PEDERSEN_TALLY_CHUNK ? ninputs - i : SECP256K1_PEDERSEN_TALLY_CHUNK;
+        ret = secp256k1_eckey_pubkey_parse_batch(add, valid, &inputs[i], n);
+        if (ret) {
+            secp256k1_gej_add_all_ge_var(&accj, add, n, work);
+        }
+    }
+    ret = ret && secp256k1_gej_is_infinity(&accj);
+    if (ret) {
+        ret = secp256k1_rangeproof_verify_batch_impl(&ctx->ecmult_ctx, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx, scratch,
+         min_values, max_values, outputs, outs, proofs, plens, noutputs);
+    }
+    secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+    return ret;
+}
+
+int secp256k1_ec_pubkey_tweak_add_ex(const secp256k1_context* ctx, secp256k1_pubkey *pubkey, const unsigned char *tweak) {
+    secp256k1_ge p;
+    secp256k1_scalar term;
+    int ret = 0;
+    int overflow = 0;
+    VERIFY_CHECK(ctx != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(pubkey != NULL);
+    ARG_CHECK(tweak != NULL);
+
+    secp256k1_scalar_set_b32(&term, tweak, &overflow);
+    ret = !overflow && secp256k1_pubkey_load(ctx, &p, pubkey);
+    memset(pubkey, 0, sizeof(*pubkey));
+    if (ret) {
+        if (secp256k1_eckey_pubkey_tweak_add(&ctx->ecmult_ctx, &p, &term)) {
+            secp256k1_pubkey_save(pubkey, &p);
+        } else {
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+int secp256k1_ec_pubkey_tweak_add_batch(const secp256k1_context* ctx, secp256k1_pubkey *pubkeys, const unsigned char * const *tweaks, size_t n) {
+    secp256k1_gej *pj;
+    secp256k1_ge *p;
+    secp256k1_scalar term;
+    size_t i;
+    int overflow;
+    int ret = 1;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+    ARG_CHECK(n == 0 || tweaks != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    if (n == 0) {
+        return 1;
+    }
+
+    pj = (secp256k1_gej *)checked_malloc(sizeof(secp256k1_gej) * n);
+    p = (secp256k1_ge *)checked_malloc(sizeof(secp256k1_ge) * n);
+    for (i = 0; i < n; i++) {
+        secp256k1_scalar_set_b32(&term, tweaks[i], &overflow);
+        if (overflow || !secp256k1_pubkey_load(ctx, &p[i], &pubkeys[i])) {
+            secp256k1_gej_set_infinity(&pj[i]);
+        } else {
+            /* The tweaks are public; the comb is used because it is the fastest way to multiply G. */
+            secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &pj[i], &term);
+            secp256k1_gej_add_ge_var(&pj[i], &pj[i], &p[i], NULL);
+        }
+    }
+    secp256k1_ge_set_all_gej_var(n, p, pj);
+    for (i = 0; i < n; i++) {
+        if (secp256k1_ge_is_infinity(&p[i])) {
+            memset(&pubkeys[i], 0, sizeof(pubkeys[i]));
+            ret = 0;
+        } else {
+            secp256k1_pubkey_save(&pubkeys[i], &p[i]);
+        }
+    }
+    free(pj);
+    free(p);
+    return ret;
+}
+
+struct secp256k1_point_precomp_struct {
+    secp256k1_ecmult_gen_context_t gen;
+};
+
+secp256k1_point_precomp* secp256k1_point_precomp_create(const secp256k1_context* ctx, const secp256k1_pubkey *point, const unsigned char *seed32) {
+    secp256k1_point_precomp* ret;
+    secp256k1_ge p;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(point != NULL);
+    if (!secp256k1_pubkey_load(ctx, &p, point)) {
+        return NULL;
+    }
+    ret = (secp256k1_point_precomp*)checked_malloc(sizeof(secp256k1_point_precomp));
+    secp256k1_ecmult_gen_context_init(&ret->gen);
+    secp256k1_ecmult_gen_context_build_point(&ret->gen, &p, seed32);
+    return ret;
+}
+
+void secp256k1_point_precomp_destroy(secp256k1_point_precomp* precomp) {
+    if (precomp != NULL) {
+        /* The table is always allocated, even with static precomputation for G. */
+        free(precomp->gen.prec);
+        secp256k1_scalar_clear(&precomp->gen.blind);
+        secp256k1_gej_clear(&precomp->gen.initial);
+        free(precomp);
+    }
+}
+
+int secp256k1_point_precomp_multiply(const secp256k1_context* ctx, secp256k1_pubkey *result, const secp256k1_point_precomp *precomp, const unsigned char *scalar) {
+    secp256k1_gej rj;
+    secp256k1_ge r;
+    secp256k1_scalar s;
+    int overflow;
+    int ret = 0;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(result != NULL);
+    memset(result, 0, sizeof(*result));
+    ARG_CHECK(precomp != NULL);
+    ARG_CHECK(scalar != NULL);
+
+    secp256k1_scalar_set_b32(&s, scalar, &overflow);
+    ret = (!overflow) & (!secp256k1_scalar_is_zero(&s));
+    if (ret) {
+        secp256k1_ecmult_gen(&precomp->gen, &rj, &s);
+        secp256k1_ge_set_gej(&r, &rj);
+        secp256k1_pubkey_save(result, &r);
+        secp256k1_gej_clear(&rj);
+    }
+    secp256k1_scalar_clear(&s);
+    return ret;
+}
+
+/* Hash a shared point into a 32-byte secret: SHA256 of its compressed serialization. */
+static void secp256k1_ecdh_hash_point(unsigned char *output, secp256k1_ge *pt) {
+    unsigned char x[32];
+    unsigned char y;
+    secp256k1_sha256_t sha;
+
+    secp256k1_fe_normalize(&pt->x);
+    secp256k1_fe_normalize(&pt->y);
+    secp256k1_fe_get_b32(x, &pt->x);
+    y = 0x02 | secp256k1_fe_is_odd(&pt->y);
+
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, &y, 1);
+    secp256k1_sha256_write(&sha, x, 32);
+    secp256k1_sha256_finalize(&sha, output);
+    memset(x, 0, 32);
+    y = 0;
+}
+
+int secp256k1_ecdh(const secp256k1_context* ctx, unsigned char *result, const secp256k1_pubkey *point, const unsigned char *scalar) {
+    secp256k1_gej res;
+    secp256k1_ge pt;
+    secp256k1_scalar s;
+    int overflow = 0;
+    int ret = 0;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(result != NULL);
+    ARG_CHECK(point != NULL);
+    ARG_CHECK(scalar != NULL);
+
+    secp256k1_scalar_set_b32(&s, scalar, &overflow);
+    if (!overflow && !secp256k1_scalar_is_zero(&s) && secp256k1_pubkey_load(ctx, &pt, point)) {
+        secp256k1_ecdh_point_multiply(&res, &pt, &s);
+        secp256k1_ge_set_gej(&pt, &res);
+        secp256k1_ecdh_hash_point(result, &pt);
+        secp256k1_gej_clear(&res);
+        secp256k1_ge_clear(&pt);
+        ret = 1;
+    }
+    secp256k1_scalar_clear(&s);
+    return ret;
+}
+
+int secp256k1_ecdh_batch(const secp256k1_context* ctx, unsigned char *results, const secp256k1_pubkey * const *points, size_t n, const unsigned char *scalar) {
+    secp256k1_gej res[SECP256K1_ECDH_BATCH_MAX];
+    secp256k1_ge pt[SECP256K1_ECDH_BATCH_MAX];
+    secp256k1_scalar s;
+    size_t i, j, m;
+    int overflow = 0;
+    int ret = 0;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n == 0 || results != NULL);
+    ARG_CHECK(n == 0 || points != NULL);
+    ARG_CHECK(scalar != NULL);
+
+    secp256k1_scalar_set_b32(&s, scalar, &overflow);
+    if (!overflow && !secp256k1_scalar_is_zero(&s)) {
+        ret = 1;
+        for (i = 0; i < n; i += m) {
+            m = n - i < SECP256K1_ECDH_BATCH_MAX ? n - i : SECP256K1_ECDH_BATCH_MAX;
+            for (j = 0; j < m; j++) {
+                if (!secp256k1_pubkey_load(ctx, &pt[j], points[i + j])) {
+                    ret = 0;
+                    break;
+                }
+            }
+            if (!ret) {
+                break;
+            }
+            secp256k1_ecdh_point_multiply_batch(res, pt, m, &s);
+            /* As the order is prime, no result is infinity. */
+            secp256k1_ge_set_all_gej(m, pt, res);
+            for (j = 0; j < m; j++) {
+                secp256k1_ecdh_hash_point(&results[32 * (i + j)], &pt[j]);
+                secp256k1_gej_clear(&res[j]);
+                secp256k1_ge_clear(&pt[j]);
+            }
+        }
+    }
+    secp256k1_scalar_clear(&s);
+    return ret;
+}
+
+static int secp256k1_pedersen_commitment_load(const secp256k1_context* ctx, secp256k1_ge* ge, const secp256k1_pedersen_commitment* commit) {
+    if (sizeof(secp256k1_ge_storage) == 64) {
+        /* The same representations as for secp256k1_pubkey, see secp256k1_pubkey_load. */
+        secp256k1_ge_storage s;
+        memcpy(&s, &commit->data[0], 64);
+        secp256k1_ge_from_storage(ge, &s);
+    } else {
+        secp256k1_fe x, y;
+        secp256k1_fe_set_b32(&x, commit->data);
+        secp256k1_fe_set_b32(&y, commit->data + 32);
+        secp256k1_ge_set_xy(ge, &x, &y);
+    }
+    (void)ctx;
+    ARG_CHECK(!secp256k1_fe_is_zero(&ge->x));
+    return 1;
+}
+
+static void secp256k1_pedersen_commitment_save(secp256k1_pedersen_commitment* commit, secp256k1_ge* ge) {
+    if (sizeof(secp256k1_ge_storage) == 64) {
+        secp256k1_ge_storage s;
+        secp256k1_ge_to_storage(&s, ge);
+        memcpy(&commit->data[0], &s, 64);
+    } else {
+        VERIFY_CHECK(!secp256k1_ge_is_infinity(ge));
+        secp256k1_fe_normalize_var(&ge->x);
+        secp256k1_fe_normalize_var(&ge->y);
+        secp256k1_fe_get_b32(commit->data, &ge->x);
+        secp256k1_fe_get_b32(commit->data + 32, &ge->y);
+    }
+}
+
+int secp256k1_pedersen_commitment_parse(const secp256k1_context* ctx, secp256k1_pedersen_commitment* commit, const unsigned char *input) {
+    secp256k1_ge Q;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(commit != NULL);
+    memset(commit, 0, sizeof(*commit));
+    ARG_CHECK(input != NULL);
+    if (!secp256k1_eckey_pubkey_parse(&Q, input, 33)) {
+        return 0;
+    }
+    secp256k1_pedersen_commitment_save(commit, &Q);
+    return 1;
+}
+
+int secp256k1_pedersen_commitment_serialize(const secp256k1_context* ctx, unsigned char *output, const secp256k1_pedersen_commitment* commit) {
+    secp256k1_ge Q;
+    int len = 33;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(output != NULL);
+    ARG_CHECK(commit != NULL);
+    secp256k1_pedersen_commitment_load(ctx, &Q, commit);
+    return secp256k1_eckey_pubkey_serialize(&Q, output, &len, 1);
+}
+
+int secp256k1_pedersen_verify_tally_ex(const secp256k1_context* ctx, const secp256k1_pedersen_commitment * const *commits, size_t pcnt,
+ const secp256k1_pedersen_commitment * const *ncommits, size_t ncnt, int64_t excess) {
+    secp256k1_gej accj;
+    secp256k1_ge add[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    secp256k1_fe work[SECP256K1_PEDERSEN_TALLY_CHUNK];
+    size_t i, j, n;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(!pcnt || (commits != NULL));
+    ARG_CHECK(!ncnt || (ncommits != NULL));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_pedersen_tally_start(&ctx->ecmult_gen2_ctx, &accj, excess);
+    for (i = 0; i < ncnt; i += n) {
+        n = ncnt - i < SECP256K1_PEDERSEN_TALLY_CHUNK ? ncnt - i : SECP256K1_PEDERSEN_TALLY_CHUNK;
+        for (j = 0; j < n; j++) {
+            if (!secp256k1_pedersen_commitment_load(ctx, &add[j], ncommits[i + j])) {
+                return 0;
+            }
+        }
+        secp256k1_gej_add_all_ge_var(&accj, add, n, work);
+    }
+    secp256k1_gej_neg(&accj, &accj);
+    for (i = 0; i < pcnt; i += n) {
+        n = pcnt - i < SECP256K1_PEDERSEN_TALLY_CHUNK ? pcnt - i : SECP256K1_PEDERSEN_TALLY_CHUNK;
+        for (j = 0; j < n; j++) {
+            if (!secp256k1_pedersen_commitment_load(ctx, &add[j], commits[i + j])) {
+                return 0;
+            }
+        }
+        secp256k1_gej_add_all_ge_var(&accj, add, n, work);
+    }
+    return secp256k1_gej_is_infinity(&accj);
+}
+
+int secp256k1_pedersen_commit_ex(const secp256k1_context* ctx, secp256k1_pedersen_commitment *commit, const unsigned char *blind, uint64_t value) {
+    secp256k1_gej rj;
+    secp256k1_ge r;
+    secp256k1_scalar sec;
+    int overflow;
+    int ret = 0;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(commit != NULL);
+    memset(commit, 0, sizeof(*commit));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    ARG_CHECK(blind != NULL);
+    secp256k1_scalar_set_b32(&sec, blind, &overflow);
+    if (!overflow) {
+        secp256k1_ecmult_gen_gen2(&ctx->ecmult_gen_ctx, &ctx->ecmult_gen2_ctx, &rj, &sec, value);
+        if (!secp256k1_gej_is_infinity(&rj)) {
+            secp256k1_ge_set_gej(&r, &rj);
+            secp256k1_pedersen_commitment_save(commit, &r);
+            ret = 1;
+        }
+        secp256k1_gej_clear(&rj);
+        secp256k1_ge_clear(&r);
+    }
+    secp256k1_scalar_clear(&sec);
+    return ret;
+}
+
+int secp256k1_rangeproof_rewind_ex(const secp256k1_context* ctx,
+ unsigned char *blind_out, uint64_t *value_out, unsigned char *message_out, int *outlen, const unsigned char *nonce,
+ uint64_t *min_value, uint64_t *max_value,
+ const secp256k1_pedersen_commitment *commit, const unsigned char *proof, int plen) {
+    secp256k1_scratch_t *scratch;
+    secp256k1_ge c;
+    unsigned char ser[33];
+    int len = 33;
+    int ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(commit != NULL);
+    ARG_CHECK(proof != NULL);
+    ARG_CHECK(min_value != NULL);
+    ARG_CHECK(max_value != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_SIGN);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
+    if (!secp256k1_pedersen_commitment_load(ctx, &c, commit)) {
+        return 0;
+    }
+    /* The serialized form is still needed for hashing, but costs no square root. */
+    secp256k1_eckey_pubkey_serialize(&c, ser, &len, 1);
+    scratch = secp256k1_scratch_create(SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE);
+    ret = secp256k1_rangeproof_verify_impl(&ctx->ecmult_ctx, &ctx->ecmult_gen_ctx, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx, scratch,
+     blind_out, value_out, message_out, outlen, nonce, min_value, max_value, ser, &c, proof, plen);
+    secp256k1_scratch_destroy(scratch);
+    return ret;
+}
+
+int secp256k1_rangeproof_verify_ex(const secp256k1_context* ctx, uint64_t *min_value, uint64_t *max_value,
+ const secp256k1_pedersen_commitment *commit, const unsigned char *proof, int plen) {
+    secp256k1_scratch_t *scratch;
+    secp256k1_ge c;
+    unsigned char ser[33];
+    int len = 33;
+    int ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(commit != NULL);
+    ARG_CHECK(proof != NULL);
+    ARG_CHECK(min_value != NULL);
+    ARG_CHECK(max_value != NULL);
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&ctx->rangeproof_ctx));
+    if (!secp256k1_pedersen_commitment_load(ctx, &c, commit)) {
+        return 0;
+    }
+    secp256k1_eckey_pubkey_serialize(&c, ser, &len, 1);
+    scratch = secp256k1_scratch_create(SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE);
+    ret = secp256k1_rangeproof_verify_impl(&ctx->ecmult_ctx, NULL, &ctx->ecmult_gen2_ctx, &ctx->rangeproof_ctx, scratch,
+     NULL, NULL, NULL, NULL, NULL, min_value, max_value, ser, &c, proof, plen);
+    secp256k1_scratch_destroy(scratch);
+    return ret;
+}
+
+#define SECP256K1_VERIFY_JOB_ECDSA 1
+#define SECP256K1_VERIFY_JOB_RANGEPROOF 2
+#define SECP256K1_VERIFY_JOB_TALLY 3
+#define SECP256K1_VERIFY_JOB_SESSION_BATCH 4
+#define SECP256K1_VERIFY_JOB_RANGEPROOF_PART 5
+
+/* A range proof verified by several jobs of a pool, each covering some of its rings. remaining counts the
+ * parts that have not passed yet; the job that brings it to zero combines the rings. */
+typedef struct secp256k1_verify_split_struct {
+    secp256k1_rangeproof_split_t split;
+    int parsed;
+    size_t remaining;
+    uint64_t *min_value;
+    uint64_t *max_value;
+    struct secp256k1_verify_split_struct *next;
+} secp256k1_verify_split_t;
+
+typedef struct {
+    int type;
+    union {
+        struct {
+            const secp256k1_ecdsa_signature *sig;
+            const unsigned char *msg32;
+            const secp256k1_pubkey *pubkey;
+        } ecdsa;
+        struct {
+            const unsigned char *commit;
+            const unsigned char *proof;
+            int plen;
+            uint64_t *min_value;
+            uint64_t *max_value;
+        } rangeproof;
+        struct {
+            const unsigned char * const *commits;
+            int pcnt;
+            const unsigned char * const *ncommits;
+            int ncnt;
+            int64_t excess;
+        } tally;
+        struct secp256k1_verify_session_batch_struct *batch;
+        struct {
+            secp256k1_verify_split_t *split;
+            int first;
+            int last;
+        } part;
+    } data;
+} secp256k1_verify_job_t;
+
+/* Jobs are only added while no worker runs. Workers claim them by atomically advancing next, and the
+ * first one to see a job fail records it in failed (which is n_jobs while every job has passed). splits
+ * holds the state of the split range proofs, which is freed when the pool is cleared. */
+struct secp256k1_verify_pool_struct {
+    const secp256k1_context *ctx;
+    secp256k1_verify_job_t *jobs;
+    size_t max_jobs;
+    size_t n_jobs;
+    size_t next;
+    size_t failed;
+    secp256k1_verify_split_t *splits;
+};
+
+static size_t secp256k1_verify_pool_claim(secp256k1_verify_pool *pool) {
+#ifdef HAVE_BUILTIN_SYNC
+    return __sync_fetch_and_add(&pool->next, 1);
+#else
+    return pool->next++;
+#endif
+}
+
+/* Returns whether this was the last part of split to finish. */
+static int secp256k1_verify_split_done(secp256k1_verify_split_t *split) {
+#ifdef HAVE_BUILTIN_SYNC
+    return __sync_sub_and_fetch(&split->remaining, 1) == 0;
+#else
+    return --split->remaining == 0;
+#endif
+}
+
+static void secp256k1_verify_pool_fail(secp256k1_verify_pool *pool, size_t index) {
+#ifdef HAVE_BUILTIN_SYNC
+    __sync_bool_compare_and_swap(&pool->failed, pool->n_jobs, index);
+#else
+    if (pool->failed == pool->n_jobs) {
+        pool->failed = index;
+    }
+#endif
+}
+
+/* Number of items in the fixed-size batches of a verification session. */
+#define SECP256K1_VERIFY_SESSION_ECDSA_BATCH 64
+#define SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH 8
+#define SECP256K1_VERIFY_SESSION_MAX_PROOF 5134
+#define SECP256K1_VERIFY_SESSION_OK ((size_t)-1)
+
+#define SECP256K1_VERIFY_BATCH_PENDING 0
+#define SECP256K1_VERIFY_BATCH_PASSED 1
+#define SECP256K1_VERIFY_BATCH_FAILED 2
+
+/* Copies of the items a session has accumulated, which are verified together. items[i] is the index of
+ * entry i among everything added to the session; failed is the index of the first entry that failed. */
+typedef struct secp256k1_verify_session_batch_struct {
+    int type;
+    int state;
+    size_t n;
+    size_t items[SECP256K1_VERIFY_SESSION_ECDSA_BATCH];
+    size_t failed;
+    union {
+        struct {
+            secp256k1_ecdsa_signature sigs[SECP256K1_VERIFY_SESSION_ECDSA_BATCH];
+            unsigned char msgs[SECP256K1_VERIFY_SESSION_ECDSA_BATCH][32];
+            secp256k1_pubkey pubkeys[SECP256K1_VERIFY_SESSION_ECDSA_BATCH];
+        } ecdsa;
+        struct {
+            unsigned char commits[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH][33];
+            unsigned char *proofs; /* SECP256K1_VERIFY_SESSION_MAX_PROOF bytes per entry */
+            int plens[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH];
+            uint64_t *min_values[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH];
+            uint64_t *max_values[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH];
+        } rangeproof;
+    } data;
+    struct secp256k1_verify_session_batch_struct *next;
+} secp256k1_verify_session_batch_t;
+
+static int secp256k1_verify_session_batch_run(const secp256k1_context *ctx, secp256k1_scratch_space *scratch, secp256k1_verify_session_batch_t *batch) {
+    const secp256k1_ecdsa_signature *sigp[SECP256K1_VERIFY_SESSION_ECDSA_BATCH];
+    const unsigned char *msgp[SECP256K1_VERIFY_SESSION_ECDSA_BATCH];
+    const secp256k1_pubkey *pubkeyp[SECP256K1_VERIFY_SESSION_ECDSA_BATCH];
+    const unsigned char *commitp[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH];
+    const unsigned char *proofp[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH];
+    uint64_t min_values[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH];
+    uint64_t max_values[SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH];
+    secp256k1_scratch_space *own = NULL;
+    size_t i, bad = batch->n;
+
+    if (batch->type == SECP256K1_VERIFY_JOB_ECDSA) {
+        for (i = 0; i < batch->n; i++) {
+            sigp[i] = &batch->data.ecdsa.sigs[i];
+            msgp[i] = batch->data.ecdsa.msgs[i];
+            pubkeyp[i] = &batch->data.ecdsa.pubkeys[i];
+        }
+        secp256k1_ecdsa_verify_batch(ctx, &bad, sigp, msgp, pubkeyp, batch->n);
+    } else {
+        if (scratch == NULL) {
+            scratch = own = secp256k1_scratch_create(SECP256K1_RANGEPROOF_SCRATCH_SIZE);
+        }
+        for (i = 0; i < batch->n; i++) {
+            commitp[i] = batch->data.rangeproof.commits[i];
+            proofp[i] = batch->data.rangeproof.proofs + i * SECP256K1_VERIFY_SESSION_MAX_PROOF;
+        }
+        if (!secp256k1_rangeproof_verify_batch(ctx, scratch, commitp, proofp, batch->data.rangeproof.plens, batch->n, min_values, max_values)) {
+            /* Failures are rare, so finding the one to report can afford verifying the proofs one by one. */
+            for (bad = 0; bad < batch->n; bad++) {
+                if (!secp256k1_rangeproof_verify_scratch(ctx, scratch, &min_values[0], &max_values[0], commitp[bad], proofp[bad],
+                 batch->data.rangeproof.plens[bad])) {
+                    break;
+                }
+            }
+        } else {
+            for (i = 0; i < batch->n; i++) {
+                if (batch->data.rangeproof.min_values[i] != NULL) {
+                    *batch->data.rangeproof.min_values[i] = min_values[i];
+                }
+                if (batch->data.rangeproof.max_values[i] != NULL) {
+                    *batch->data.rangeproof.max_values[i] = max_values[i];
+                }
+            }
+        }
+        secp256k1_scratch_destroy(own);
+    }
+    if (bad < batch->n) {
+        batch->failed = batch->items[bad];
+        batch->state = SECP256K1_VERIFY_BATCH_FAILED;
+        return 0;
+    }
+    batch->state = SECP256K1_VERIFY_BATCH_PASSED;
+    return 1;
+}
+
+static int secp256k1_verify_job_run(const secp256k1_context *ctx, secp256k1_scratch_space *scratch, const secp256k1_verify_job_t *job) {
+    uint64_t min_value;
+    uint64_t max_value;
+    switch (job->type) {
+    case SECP256K1_VERIFY_JOB_ECDSA:
+        return secp256k1_ecdsa_verify_ex(ctx, job->data.ecdsa.sig, job->data.ecdsa.msg32, job->data.ecdsa.pubkey);
+    case SECP256K1_VERIFY_JOB_RANGEPROOF:
+        if (scratch != NULL) {
+            if (!secp256k1_rangeproof_verify_scratch(ctx, scratch, &min_value, &max_value, job->data.rangeproof.commit,
+             job->data.rangeproof.proof, job->data.rangeproof.plen)) {
+                return 0;
+            }
+        } else if (!secp256k1_rangeproof_verify(ctx, &min_value, &max_value, job->data.rangeproof.commit,
+         job->data.rangeproof.proof, job->data.rangeproof.plen)) {
+            return 0;
+        }
+        if (job->data.rangeproof.min_value != NULL) {
+            *job->data.rangeproof.min_value = min_value;
+        }
+        if (job->data.rangeproof.max_value != NULL) {
+            *job->data.rangeproof.max_value = max_value;
+        }
+        return 1;
+    case SECP256K1_VERIFY_JOB_TALLY:
+        return secp256k1_pedersen_verify_tally(ctx, job->data.tally.commits, job->data.tally.pcnt, job->data.tally.ncommits,
+         job->data.tally.ncnt, job->data.tally.excess);
+    case SECP256K1_VERIFY_JOB_SESSION_BATCH:
+        return secp256k1_verify_session_batch_run(ctx, scratch, job->data.batch);
+    case SECP256K1_VERIFY_JOB_RANGEPROOF_PART: {
+        secp256k1_verify_split_t *split = job->data.part.split;
+        if (!split->parsed || !secp256k1_rangeproof_verify_split_part(&ctx->ecmult_ctx, &split->split, job->data.part.first, job->data.part.last)) {
+            return 0;
+        }
+        /* The atomic decrement orders the other parts' writes to rbuf before the combining reads them. */
+        if (secp256k1_verify_split_done(split)) {
+            if (!secp256k1_rangeproof_verify_split_finish(&split->split)) {
+                return 0;
+            }
+            if (split->min_value != NULL) {
+                *split->min_value = split->split.min_value;
+            }
+            if (split->max_value != NULL) {
+                *split->max_value = split->split.max_value;
+            }
+        }
+        return 1;
+    }
+    }
+    return 0;
+}
+
+secp256k1_verify_pool* secp256k1_verify_pool_create(const secp256k1_context* ctx, size_t max_jobs) {
+    secp256k1_verify_pool* ret;
+    VERIFY_CHECK(ctx != NULL);
+    ret = (secp256k1_verify_pool*)checked_malloc(sizeof(secp256k1_verify_pool));
+    ret->ctx = ctx;
+    ret->jobs = (secp256k1_verify_job_t*)checked_malloc(sizeof(secp256k1_verify_job_t) * (max_jobs > 0 ? max_jobs : 1));
+    ret->max_jobs = max_jobs;
+    ret->splits = NULL;
+    secp256k1_verify_pool_clear(ret);
+    return ret;
+}
+
+void secp256k1_verify_pool_destroy(secp256k1_verify_pool* pool) {
+    if (pool != NULL) {
+        secp256k1_verify_pool_clear(pool);
+        free(pool->jobs);
+        free(pool);
+    }
+}
+
+void secp256k1_verify_pool_clear(secp256k1_verify_pool* pool) {
+    VERIFY_CHECK(pool != NULL);
+    while (pool->splits != NULL) {
+        secp256k1_verify_split_t *next = pool->splits->next;
+        free(pool->splits);
+        pool->splits = next;
+    }
+    pool->n_jobs = 0;
+    pool->next = 0;
+    pool->failed = 0;
+}
+
+static secp256k1_verify_job_t *secp256k1_verify_pool_add(secp256k1_verify_pool* pool, int type) {
+    secp256k1_verify_job_t *job;
+    if (pool->n_jobs == pool->max_jobs) {
+        return NULL;
+    }
+    if (pool->failed == pool->n_jobs) {
+        /* Keep failed equal to n_jobs as long as nothing has failed. */
+        pool->failed++;
+    }
+    job = &pool->jobs[pool->n_jobs++];
+    job->type = type;
+    return job;
+}
+
+int secp256k1_verify_pool_submit_ecdsa(secp256k1_verify_pool* pool, const secp256k1_ecdsa_signature *sig, const unsigned char *msg32,
+ const secp256k1_pubkey *pubkey) {
+    secp256k1_verify_job_t *job;
+    VERIFY_CHECK(pool != NULL);
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(pubkey != NULL);
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&pool->ctx->ecmult_ctx));
+    job = secp256k1_verify_pool_add(pool, SECP256K1_VERIFY_JOB_ECDSA);
+    if (job == NULL) {
+        return 0;
+    }
+    job->data.ecdsa.sig = sig;
+    job->data.ecdsa.msg32 = msg32;
+    job->data.ecdsa.pubkey = pubkey;
+    return 1;
+}
+
+int secp256k1_verify_pool_submit_rangeproof(secp256k1_verify_pool* pool, uint64_t *min_value, uint64_t *max_value,
+ const unsigned char *commit, const unsigned char *proof, int plen) {
+    secp256k1_verify_job_t *job;
+    VERIFY_CHECK(pool != NULL);
+    ARG_CHECK(commit != NULL);
+    ARG_CHECK(proof != NULL);
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&pool->ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&pool->ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&pool->ctx->rangeproof_ctx));
+    job = secp256k1_verify_pool_add(pool, SECP256K1_VERIFY_JOB_RANGEPROOF);
+    if (job == NULL) {
+        return 0;
+    }
+    job->data.rangeproof.commit = commit;
+    job->data.rangeproof.proof = proof;
+    job->data.rangeproof.plen = plen;
+    job->data.rangeproof.min_value = min_value;
+    job->data.rangeproof.max_value = max_value;
+    return 1;
+}
+
+int secp256k1_verify_pool_submit_rangeproof_split(secp256k1_verify_pool* pool, uint64_t *min_value, uint64_t *max_value,
+ const unsigned char *commit, const unsigned char *proof, int plen, size_t nparts) {
+    secp256k1_verify_split_t *split;
+    secp256k1_verify_job_t *job;
+    size_t part;
+    int first;
+    VERIFY_CHECK(pool != NULL);
+    ARG_CHECK(commit != NULL);
+    ARG_CHECK(proof != NULL);
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&pool->ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&pool->ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&pool->ctx->rangeproof_ctx));
+    if (nparts == 0 || nparts > pool->max_jobs - pool->n_jobs) {
+        return 0;
+    }
+    split = (secp256k1_verify_split_t *)checked_malloc(sizeof(secp256k1_verify_split_t));
+    split->next = pool->splits;
+    pool->splits = split;
+    split->min_value = min_value;
+    split->max_value = max_value;
+    split->parsed = secp256k1_rangeproof_verify_split_init(&pool->ctx->ecmult_gen2_ctx, &pool->ctx->rangeproof_ctx, &split->split,
+     commit, proof, plen);
+    if (!split->parsed) {
+        /* A single job that fails. */
+        nparts = 1;
+    } else if (nparts > (size_t)split->split.rings) {
+        nparts = split->split.rings;
+    }
+    split->remaining = nparts;
+    /* Part k covers rings [k * rings / nparts, (k + 1) * rings / nparts). */
+    first = 0;
+    for (part = 0; part < nparts; part++) {
+        job = secp256k1_verify_pool_add(pool, SECP256K1_VERIFY_JOB_RANGEPROOF_PART);
+        VERIFY_CHECK(job != NULL);
+        job->data.part.split = split;
+        job->data.part.first = first;
+        first = split->parsed ? (int)((part + 1) * split->split.rings / nparts) : 1;
+        job->data.part.last = first;
+    }
+    return 1;
+}
+
+int secp256k1_verify_pool_submit_tally(secp256k1_verify_pool* pool, const unsigned char * const *commits, int pcnt,
+ const unsigned char * const *ncommits, int ncnt, int64_t excess) {
+    secp256k1_verify_job_t *job;
+    VERIFY_CHECK(pool != NULL);
+    ARG_CHECK(commits != NULL);
+    ARG_CHECK(ncommits != NULL);
+    secp256k1_context_build_lazy(pool->ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&pool->ctx->ecmult_gen2_ctx));
+    job = secp256k1_verify_pool_add(pool, SECP256K1_VERIFY_JOB_TALLY);
+    if (job == NULL) {
+        return 0;
+    }
+    job->data.tally.commits = commits;
+    job->data.tally.pcnt = pcnt;
+    job->data.tally.ncommits = ncommits;
+    job->data.tally.ncnt = ncnt;
+    job->data.tally.excess = excess;
+    return 1;
+}
+
+void secp256k1_verify_pool_work(secp256k1_verify_pool* pool, secp256k1_scratch_space* scratch) {
+    size_t i;
+    VERIFY_CHECK(pool != NULL);
+    /* A stale read of failed only costs verifying a few more jobs after a failure. */
+    while (*(volatile size_t *)&pool->failed == pool->n_jobs) {
+        i = secp256k1_verify_pool_claim(pool);
+        if (i >= pool->n_jobs) {
+            break;
+        }
+        if (!secp256k1_verify_job_run(pool->ctx, scratch, &pool->jobs[i])) {
+            secp256k1_verify_pool_fail(pool, i);
+        }
+    }
+}
+
+int secp256k1_verify_pool_result(const secp256k1_verify_pool* pool, size_t *failed) {
+    VERIFY_CHECK(pool != NULL);
+    if (failed != NULL) {
+        *failed = pool->failed;
+    }
+    /* Without a failure, every job has been verified once all of them have been claimed. */
+    return pool->failed == pool->n_jobs && pool->next >= pool->n_jobs;
+}
+
+/* Without a pool, full batches are verified on the spot and then reused. With one, they are handed to
+ * the pool and kept (in the list starting at done) until the session is destroyed. failed is the index
+ * of the first item known to have failed, or SECP256K1_VERIFY_SESSION_OK while none is. */
+struct secp256k1_verify_session_struct {
+    const secp256k1_context *ctx;
+    secp256k1_scratch_space *scratch;
+    secp256k1_scratch_space *own_scratch;
+    secp256k1_verify_pool *pool;
+    secp256k1_verify_session_batch_t *ecdsa;
+    secp256k1_verify_session_batch_t *rangeproof;
+    secp256k1_verify_session_batch_t *done;
+    size_t n_items;
+    size_t failed;
+};
+
+static secp256k1_verify_session_batch_t *secp256k1_verify_session_batch_create(int type) {
+    secp256k1_verify_session_batch_t *batch = (secp256k1_verify_session_batch_t*)checked_malloc(sizeof(secp256k1_verify_session_batch_t));
+    batch->type = type;
+    batch->state = SECP256K1_VERIFY_BATCH_PENDING;
+    batch->n = 0;
+    batch->next = NULL;
+    if (type == SECP256K1_VERIFY_JOB_RANGEPROOF) {
+        batch->data.rangeproof.proofs = (unsigned char*)checked_malloc(SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH * SECP256K1_VERIFY_SESSION_MAX_PROOF);
+    }
+    return batch;
+}
+
+static void secp256k1_verify_session_batch_destroy(secp256k1_verify_session_batch_t *batch) {
+    if (batch->type == SECP256K1_VERIFY_JOB_RANGEPROOF) {
+        free(batch->data.rangeproof.proofs);
+    }
+    free(batch);
+}
+
+static void secp256k1_verify_session_record(secp256k1_verify_session* session, size_t item) {
+    if (item < session->failed) {
+        session->failed = item;
+    }
+}
+
+/* Verify (or hand to the pool) the given batch of session, and give session an empty one in its place. */
+static void secp256k1_verify_session_flush(secp256k1_verify_session* session, secp256k1_verify_session_batch_t **batchp) {
+    secp256k1_verify_session_batch_t *batch = *batchp;
+    secp256k1_verify_job_t *job;
+    if (batch->n == 0) {
+        return;
+    }
+    if (session->pool != NULL && (job = secp256k1_verify_pool_add(session->pool, SECP256K1_VERIFY_JOB_SESSION_BATCH)) != NULL) {
+        job->data.batch = batch;
+        batch->next = session->done;
+        session->done = batch;
+        *batchp = secp256k1_verify_session_batch_create(batch->type);
+        return;
+    }
+    /* Without a pool, or with a full one, the batch is verified right away. */
+    if (!secp256k1_verify_session_batch_run(session->ctx, session->scratch, batch)) {
+        secp256k1_verify_session_record(session, batch->failed);
+    }
+    batch->n = 0;
+    batch->state = SECP256K1_VERIFY_BATCH_PENDING;
+}
+
+secp256k1_verify_session* secp256k1_verify_session_create(const secp256k1_context* ctx, secp256k1_scratch_space* scratch, secp256k1_verify_pool* pool) {
+    secp256k1_verify_session* ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(pool == NULL || pool->ctx == ctx);
+    ret = (secp256k1_verify_session*)checked_malloc(sizeof(secp256k1_verify_session));
+    ret->ctx = ctx;
+    ret->own_scratch = NULL;
+    if (scratch == NULL) {
+        scratch = ret->own_scratch = secp256k1_scratch_create(SECP256K1_RANGEPROOF_SCRATCH_SIZE);
+    }
+    ret->scratch = scratch;
+    ret->pool = pool;
+    ret->ecdsa = secp256k1_verify_session_batch_create(SECP256K1_VERIFY_JOB_ECDSA);
+    ret->rangeproof = secp256k1_verify_session_batch_create(SECP256K1_VERIFY_JOB_RANGEPROOF);
+    ret->done = NULL;
+    ret->n_items = 0;
+    ret->failed = SECP256K1_VERIFY_SESSION_OK;
+    return ret;
+}
+
+void secp256k1_verify_session_destroy(secp256k1_verify_session* session) {
+    secp256k1_verify_session_batch_t *batch;
+    if (session != NULL) {
+        while (session->done != NULL) {
+            batch = session->done;
+            session->done = batch->next;
+            secp256k1_verify_session_batch_destroy(batch);
+        }
+        secp256k1_verify_session_batch_destroy(session->ecdsa);
+        secp256k1_verify_session_batch_destroy(session->rangeproof);
+        secp256k1_scratch_destroy(session->own_scratch);
+        free(session);
+    }
+}
+
+int secp256k1_verify_session_add_ecdsa(secp256k1_verify_session* session, const secp256k1_ecdsa_signature *sig, const unsigned char *msg32,
+ const secp256k1_pubkey *pubkey) {
+    secp256k1_verify_session_batch_t *batch;
+    VERIFY_CHECK(session != NULL);
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(pubkey != NULL);
+    secp256k1_context_build_lazy(session->ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&session->ctx->ecmult_ctx));
+    if (session->failed != SECP256K1_VERIFY_SESSION_OK) {
+        session->n_items++;
+        return 0;
+    }
+    batch = session->ecdsa;
+    batch->items[batch->n] = session->n_items++;
+    batch->data.ecdsa.sigs[batch->n] = *sig;
+    memcpy(batch->data.ecdsa.msgs[batch->n], msg32, 32);
+    batch->data.ecdsa.pubkeys[batch->n] = *pubkey;
+    if (++batch->n == SECP256K1_VERIFY_SESSION_ECDSA_BATCH) {
+        secp256k1_verify_session_flush(session, &session->ecdsa);
+    }
+    return session->failed == SECP256K1_VERIFY_SESSION_OK;
+}
+
+int secp256k1_verify_session_add_rangeproof(secp256k1_verify_session* session, uint64_t *min_value, uint64_t *max_value,
+ const unsigned char *commit, const unsigned char *proof, int plen) {
+    secp256k1_verify_session_batch_t *batch;
+    VERIFY_CHECK(session != NULL);
+    ARG_CHECK(commit != NULL);
+    ARG_CHECK(proof != NULL);
+    secp256k1_context_build_lazy(session->ctx, SECP256K1_CONTEXT_VERIFY);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&session->ctx->ecmult_ctx));
+    secp256k1_context_build_lazy(session->ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&session->ctx->ecmult_gen2_ctx));
+    secp256k1_context_build_lazy(session->ctx, SECP256K1_CONTEXT_RANGEPROOF);
+    ARG_CHECK(secp256k1_rangeproof_context_is_built(&session->ctx->rangeproof_ctx));
+    if (plen < 0 || plen > SECP256K1_VERIFY_SESSION_MAX_PROOF) {
+        /* No proof this long verifies. */
+        secp256k1_verify_session_record(session, session->n_items);
+    }
+    if (session->failed != SECP256K1_VERIFY_SESSION_OK) {
+        session->n_items++;
+        return 0;
+    }
+    batch = session->rangeproof;
+    batch->items[batch->n] = session->n_items++;
+    memcpy(batch->data.rangeproof.commits[batch->n], commit, 33);
+    memcpy(batch->data.rangeproof.proofs + batch->n * SECP256K1_VERIFY_SESSION_MAX_PROOF, proof, plen);
+    batch->data.rangeproof.plens[batch->n] = plen;
+    batch->data.rangeproof.min_values[batch->n] = min_value;
+    batch->data.rangeproof.max_values[batch->n] = max_value;
+    if (++batch->n == SECP256K1_VERIFY_SESSION_RANGEPROOF_BATCH) {
+        secp256k1_verify_session_flush(session, &session->rangeproof);
+    }
+    return session->failed == SECP256K1_VERIFY_SESSION_OK;
+}
+
+int secp256k1_verify_session_add_tally(secp256k1_verify_session* session, const unsigned char * const *commits, int pcnt,
+ const unsigned char * const *ncommits, int ncnt, int64_t excess) {
+    VERIFY_CHECK(session != NULL);
+    ARG_CHECK(commits != NULL);
+    ARG_CHECK(ncommits != NULL);
+    secp256k1_context_build_lazy(session->ctx, SECP256K1_CONTEXT_COMMIT);
+    ARG_CHECK(secp256k1_ecmult_gen2_context_is_built(&session->ctx->ecmult_gen2_ctx));
+    /* A tally costs little more than parsing its commitments, so it is checked right away instead of copied. */
+    if (session->failed == SECP256K1_VERIFY_SESSION_OK && !secp256k1_pedersen_verify_tally(session->ctx, commits, pcnt, ncommits, ncnt, excess)) {
+        secp256k1_verify_session_record(session, session->n_items);
+    }
+    session->n_items++;
+    return session->failed == SECP256K1_VERIFY_SESSION_OK;
+}
+
+int secp256k1_verify_session_finish(secp256k1_verify_session* session) {
+    VERIFY_CHECK(session != NULL);
+    if (session->failed == SECP256K1_VERIFY_SESSION_OK) {
+        secp256k1_verify_session_flush(session, &session->ecdsa);
+        secp256k1_verify_session_flush(session, &session->rangeproof);
+    }
+    return session->failed == SECP256K1_VERIFY_SESSION_OK;
+}
+
+int secp256k1_verify_session_result(const secp256k1_verify_session* session, size_t *failed) {
+    const secp256k1_verify_session_batch_t *batch;
+    size_t bad;
+    VERIFY_CHECK(session != NULL);
+    bad = session->failed;
+    for (batch = session->done; batch != NULL; batch = batch->next) {
+        if (batch->state == SECP256K1_VERIFY_BATCH_FAILED && batch->failed < bad) {
+            bad = batch->failed;
+        } else if (batch->state == SECP256K1_VERIFY_BATCH_PENDING && batch->items[0] < bad) {
+            /* Not worked on, for example because the pool stopped at an earlier failure. */
+            bad = batch->items[0];
+        }
+    }
+    /* Items that were never flushed (because finish was not called, or found a failure) have not been verified. */
+    if (session->ecdsa->n > 0 && session->ecdsa->items[0] < bad) {
+        bad = session->ecdsa->items[0];
+    }
+    if (session->rangeproof->n > 0 && session->rangeproof->items[0] < bad) {
+        bad = session->rangeproof->items[0];
+    }
+    if (failed != NULL) {
+        *failed = bad == SECP256K1_VERIFY_SESSION_OK ? session->n_items : bad;
+    }
+    return bad == SECP256K1_VERIFY_SESSION_OK;
+}
+
+int secp256k1_debug_get_counters(secp256k1_op_counters *counters, int reset) {
+    VERIFY_CHECK(counters != NULL);
+#ifdef ENABLE_OP_COUNTERS
+    counters->fe_mul = secp256k1_op_count[SECP256K1_OP_FE_MUL];
+    counters->fe_sqr = secp256k1_op_count[SECP256K1_OP_FE_SQR];
+    counters->fe_inv = secp256k1_op_count[SECP256K1_OP_FE_INV];
+    counters->fe_inv_var = secp256k1_op_count[SECP256K1_OP_FE_INV_VAR];
+    counters->fe_sqrt_var = secp256k1_op_count[SECP256K1_OP_FE_SQRT_VAR];
+    counters->gej_add_var = secp256k1_op_count[SECP256K1_OP_GEJ_ADD_VAR];
+    counters->gej_double_var = secp256k1_op_count[SECP256K1_OP_GEJ_DOUBLE_VAR];
+    counters->ecmult = secp256k1_op_count[SECP256K1_OP_ECMULT];
+    counters->ecmult_multi = secp256k1_op_count[SECP256K1_OP_ECMULT_MULTI];
+    counters->ecmult_multi_points = secp256k1_op_count[SECP256K1_OP_ECMULT_MULTI_POINTS];
+    counters->ecmult_gen = secp256k1_op_count[SECP256K1_OP_ECMULT_GEN];
+    counters->ecmult_gen2 = secp256k1_op_count[SECP256K1_OP_ECMULT_GEN2];
+    counters->ecmult_const = secp256k1_op_count[SECP256K1_OP_ECMULT_CONST];
+    if (reset) {
+        memset(secp256k1_op_count, 0, sizeof(secp256k1_op_count));
+    }
+    return 1;
+#else
+    (void)reset;
+    memset(counters, 0, sizeof(*counters));
+    return 0;
+#endif
+}
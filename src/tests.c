@@ -149,6 +149,28 @@ void run_util_tests(void) {
     }
 }
 
+/* Counts what goes through the allocator of a context. */
+typedef struct {
+    int allocs;
+    int frees;
+    size_t live;
+} test_allocator_t;
+
+static void *test_allocator_alloc(size_t size, void *userdata) {
+    test_allocator_t *counts = (test_allocator_t *)userdata;
+    counts->allocs++;
+    counts->live += size;
+    return malloc(size);
+}
+
+static void test_allocator_free(void *ptr, size_t size, void *userdata) {
+    test_allocator_t *counts = (test_allocator_t *)userdata;
+    counts->frees++;
+    CHECK(counts->live >= size);
+    counts->live -= size;
+    free(ptr);
+}
+
 void run_context_tests(void) {
     secp256k1_context_t *none = secp256k1_context_create(0);
     secp256k1_context_t *sign = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
@@ -160,16 +182,32 @@ void run_context_tests(void) {
     secp256k1_scalar_t msg, key, nonce;
     secp256k1_ecdsa_sig_t sig;
 
+    secp256k1_context_t *ctx_tmp;
+
     /*** clone and destroy all of them to make sure cloning was complete ***/
     {
-        secp256k1_context_t *ctx_tmp;
-
         ctx_tmp = none; none = secp256k1_context_clone(none); secp256k1_context_destroy(ctx_tmp);
         ctx_tmp = sign; sign = secp256k1_context_clone(sign); secp256k1_context_destroy(ctx_tmp);
         ctx_tmp = vrfy; vrfy = secp256k1_context_clone(vrfy); secp256k1_context_destroy(ctx_tmp);
         ctx_tmp = both; both = secp256k1_context_clone(both); secp256k1_context_destroy(ctx_tmp);
     }
 
+    /*** clones share the tables, but not the blinding state ***/
+    {
+        secp256k1_context_t *clone = secp256k1_context_clone(both);
+        unsigned char seed32[32];
+        CHECK(clone->ecmult_ctx.pre_g == both->ecmult_ctx.pre_g);
+        CHECK(clone->ecmult_gen_ctx.prec == both->ecmult_gen_ctx.prec);
+        CHECK(clone->ecmult_gen2_ctx.prec == both->ecmult_gen2_ctx.prec);
+        CHECK(clone->ecmult_gen2_ctx.prec_var == both->ecmult_gen2_ctx.prec_var);
+        CHECK(clone->rangeproof_ctx.prec == both->rangeproof_ctx.prec);
+        secp256k1_rand256(seed32);
+        CHECK(secp256k1_context_randomize(clone, seed32));
+        CHECK(!secp256k1_scalar_eq(&clone->ecmult_gen_ctx.blind, &both->ecmult_gen_ctx.blind));
+        /* Destroying the original first leaves the tables usable by the clone. */
+        ctx_tmp = both; both = clone; secp256k1_context_destroy(ctx_tmp);
+    }
+
     /*** attempt to use them ***/
     random_scalar_order_test(&msg);
     random_scalar_order_test(&key);
@@ -189,6 +227,184 @@ void run_context_tests(void) {
     CHECK(secp256k1_ecdsa_sig_verify(&vrfy->ecmult_ctx, &sig, &pub, &msg));
     CHECK(secp256k1_ecdsa_sig_verify(&both->ecmult_ctx, &sig, &pub, &msg));
 
+    /*** lazy contexts build each table on first use, shared with all clones ***/
+    {
+        secp256k1_context_t *lazy = secp256k1_context_create(SECP256K1_CONTEXT_LAZY);
+        secp256k1_context_t *clone = secp256k1_context_clone(lazy);
+        secp256k1_context_t *clone2;
+        unsigned char key32[32], msg32[32], sig64[64], sig64b[64], blind[32];
+        unsigned char pubkey[33], pubkeyb[33], commit[33], commitb[33];
+        int pubkeylen = 33, pubkeyblen = 33;
+        int recid, recidb;
+        CHECK(!secp256k1_ecmult_context_is_built(&lazy->ecmult_ctx));
+        CHECK(!secp256k1_ecmult_gen_context_is_built(&lazy->ecmult_gen_ctx));
+        CHECK(!secp256k1_ecmult_gen2_context_is_built(&lazy->ecmult_gen2_ctx));
+        CHECK(!secp256k1_rangeproof_context_is_built(&lazy->rangeproof_ctx));
+
+        secp256k1_scalar_get_b32(key32, &key);
+        secp256k1_scalar_get_b32(msg32, &msg);
+        CHECK(secp256k1_ecdsa_sign_compact(clone, msg32, sig64, key32, NULL, NULL, &recid));
+        CHECK(secp256k1_ecdsa_sign_compact(both, msg32, sig64b, key32, NULL, NULL, &recidb));
+        CHECK(memcmp(sig64, sig64b, 64) == 0 && recid == recidb);
+        CHECK(!secp256k1_ecmult_gen_context_is_built(&lazy->ecmult_gen_ctx));
+        CHECK(secp256k1_ecdsa_recover_compact(lazy, msg32, sig64, pubkey, &pubkeylen, 1, recid));
+        CHECK(secp256k1_ec_pubkey_create(lazy, pubkeyb, &pubkeyblen, key32, 1));
+        CHECK(pubkeylen == 33 && pubkeyblen == 33 && memcmp(pubkey, pubkeyb, 33) == 0);
+        CHECK(lazy->ecmult_gen_ctx.prec == clone->ecmult_gen_ctx.prec);
+        CHECK(!secp256k1_ecmult_context_is_built(&clone->ecmult_ctx));
+
+        /* A clone of a partially built context builds the rest into the same tables. */
+        clone2 = secp256k1_context_clone(clone);
+        secp256k1_rand256(blind);
+        CHECK(secp256k1_pedersen_commit(clone2, commit, blind, 7));
+        CHECK(secp256k1_pedersen_commit(both, commitb, blind, 7));
+        CHECK(memcmp(commit, commitb, 33) == 0);
+        secp256k1_context_build_lazy(lazy, SECP256K1_CONTEXT_COMMIT | SECP256K1_CONTEXT_RANGEPROOF);
+        secp256k1_context_build_lazy(clone2, SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_RANGEPROOF);
+        CHECK(lazy->ecmult_gen2_ctx.prec == clone2->ecmult_gen2_ctx.prec);
+        CHECK(lazy->rangeproof_ctx.prec == clone2->rangeproof_ctx.prec);
+        CHECK(lazy->ecmult_ctx.pre_g == clone2->ecmult_ctx.pre_g);
+
+        /* Destroying the contexts that built the tables leaves them usable by the others. */
+        secp256k1_context_destroy(lazy);
+        secp256k1_context_destroy(clone2);
+        CHECK(secp256k1_pedersen_commit(clone, commit, blind, 7));
+        CHECK(memcmp(commit, commitb, 33) == 0);
+        CHECK(secp256k1_ecdsa_recover_compact(clone, msg32, sig64, pubkey, &pubkeylen, 1, recid));
+        CHECK(memcmp(pubkey, pubkeyb, 33) == 0);
+        secp256k1_context_destroy(clone);
+    }
+
+    /*** the tables of a lazy context can be built ahead of their first use ***/
+    {
+        secp256k1_context_t *lazy = secp256k1_context_create(SECP256K1_CONTEXT_LAZY);
+        secp256k1_context_build_work(lazy, SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_RANGEPROOF);
+        CHECK(lazy->lazy->state[SECP256K1_CONTEXT_LAZY_ECMULT] == 3);
+        CHECK(lazy->lazy->state[SECP256K1_CONTEXT_LAZY_RANGEPROOF] == 3);
+        CHECK(lazy->lazy->state[SECP256K1_CONTEXT_LAZY_ECMULT_GEN] == 0);
+        /* They are only installed into the context by the wait, or the first use. */
+        CHECK(!secp256k1_ecmult_context_is_built(&lazy->ecmult_ctx));
+        CHECK(secp256k1_context_wait_built(lazy, SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_RANGEPROOF));
+        CHECK(lazy->ecmult_ctx.window_g == both->ecmult_ctx.window_g);
+        CHECK(memcmp(*lazy->ecmult_ctx.pre_g, *both->ecmult_ctx.pre_g,
+         sizeof(secp256k1_ge_storage_t) * ECMULT_TABLE_SIZE(both->ecmult_ctx.window_g)) == 0);
+        CHECK(memcmp(*lazy->rangeproof_ctx.prec, *both->rangeproof_ctx.prec, sizeof(*both->rangeproof_ctx.prec)) == 0);
+        CHECK(!secp256k1_ecmult_gen_context_is_built(&lazy->ecmult_gen_ctx));
+        CHECK(secp256k1_context_wait_built(lazy, SECP256K1_CONTEXT_SIGN));
+        CHECK(secp256k1_ecmult_gen_context_is_built(&lazy->ecmult_gen_ctx));
+        secp256k1_context_destroy(lazy);
+        /* Tables a lazy context was created with are not built again. */
+        lazy = secp256k1_context_create(SECP256K1_CONTEXT_LAZY | SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+        secp256k1_context_build_work(lazy, SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+        CHECK(lazy->lazy->state[SECP256K1_CONTEXT_LAZY_ECMULT] == 0);
+        CHECK(lazy->lazy->state[SECP256K1_CONTEXT_LAZY_ECMULT_GEN] == 0);
+        CHECK(secp256k1_context_wait_built(lazy, SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY));
+        secp256k1_context_destroy(lazy);
+        /* Other contexts have what they were created with. */
+        secp256k1_context_build_work(sign, SECP256K1_CONTEXT_VERIFY);
+        CHECK(secp256k1_context_wait_built(sign, SECP256K1_CONTEXT_SIGN));
+        CHECK(!secp256k1_context_wait_built(sign, SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY));
+        CHECK(secp256k1_context_wait_built(none, 0));
+    }
+
+    /*** the tables of a context with an allocator, also those built lazily by clones, go through it ***/
+    {
+        test_allocator_t counts = {0, 0, 0};
+        secp256k1_context_t *actx = secp256k1_context_create_with_allocator(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_LAZY,
+         test_allocator_alloc, test_allocator_free, &counts);
+        secp256k1_context_t *clone = secp256k1_context_clone(actx);
+        unsigned char key32[32], msg32[32], sigder[72], blind[32], commit[33], commitb[33], pubkey[33];
+        int siglen = 72, pubkeylen = 33, allocs;
+        secp256k1_scalar_get_b32(key32, &key);
+        secp256k1_scalar_get_b32(msg32, &msg);
+        CHECK(secp256k1_ecdsa_sign(actx, msg32, sigder, &siglen, key32, NULL, NULL));
+        CHECK(secp256k1_ec_pubkey_create(actx, pubkey, &pubkeylen, key32, 1));
+        allocs = counts.allocs;
+        CHECK(secp256k1_ecdsa_verify(clone, msg32, sigder, siglen, pubkey, pubkeylen) == 1);
+        secp256k1_rand256(blind);
+        CHECK(secp256k1_pedersen_commit(clone, commit, blind, 7));
+        CHECK(secp256k1_pedersen_commit(both, commitb, blind, 7));
+        CHECK(memcmp(commit, commitb, 33) == 0);
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+        CHECK(allocs >= 1);
+        CHECK(counts.allocs >= allocs + 3);
+        CHECK(counts.live > 0);
+#else
+        (void)allocs;
+#endif
+        secp256k1_context_destroy(actx);
+        CHECK(counts.frees == 0);
+        secp256k1_context_destroy(clone);
+        CHECK(counts.frees == counts.allocs);
+        CHECK(counts.live == 0);
+    }
+
+    /*** a serialized context can be used in place, and is rejected when damaged ***/
+    {
+        secp256k1_context_t *loaded, *clone;
+        unsigned char *blob, *copy;
+        unsigned char key32[32], msg32[32], sigder[72], sigderb[72], blind[32], commit[33], commitb[33], pubkey[33];
+        int siglen = 72, siglenb = 72, pubkeylen = 33;
+        size_t len, len2;
+        CHECK(secp256k1_context_serialize(both, NULL, &len) == 1);
+        blob = (unsigned char *)checked_malloc(len);
+        copy = (unsigned char *)checked_malloc(len);
+        len2 = len - 1;
+        CHECK(secp256k1_context_serialize(both, blob, &len2) == 0);
+        CHECK(len2 == len);
+        CHECK(secp256k1_context_serialize(both, blob, &len2) == 1);
+        CHECK(len2 == len);
+        memcpy(copy, blob, len);
+
+        loaded = secp256k1_context_create_from_buffer(blob, len, 0);
+        CHECK(loaded != NULL);
+        CHECK((unsigned char *)loaded->ecmult_ctx.pre_g >= blob && (unsigned char *)loaded->ecmult_ctx.pre_g < blob + len);
+        CHECK((unsigned char *)loaded->rangeproof_ctx.prec >= blob && (unsigned char *)loaded->rangeproof_ctx.prec < blob + len);
+        clone = secp256k1_context_clone(loaded);
+        secp256k1_context_destroy(loaded);
+        secp256k1_scalar_get_b32(key32, &key);
+        secp256k1_scalar_get_b32(msg32, &msg);
+        CHECK(secp256k1_ecdsa_sign(clone, msg32, sigder, &siglen, key32, NULL, NULL));
+        CHECK(secp256k1_ecdsa_sign(both, msg32, sigderb, &siglenb, key32, NULL, NULL));
+        CHECK(siglen == siglenb && memcmp(sigder, sigderb, siglen) == 0);
+        CHECK(secp256k1_ec_pubkey_create(both, pubkey, &pubkeylen, key32, 1));
+        CHECK(secp256k1_ecdsa_verify(clone, msg32, sigder, siglen, pubkey, pubkeylen) == 1);
+        secp256k1_rand256(blind);
+        CHECK(secp256k1_pedersen_commit(clone, commit, blind, 7));
+        CHECK(secp256k1_pedersen_commit(both, commitb, blind, 7));
+        CHECK(memcmp(commit, commitb, 33) == 0);
+        secp256k1_context_destroy(clone);
+        CHECK(memcmp(copy, blob, len) == 0);
+
+        /* Any change, and any other length, is rejected. */
+        CHECK(secp256k1_context_create_from_buffer(blob, len - 64, 0) == NULL);
+        blob[len / 2] ^= 1;
+        CHECK(secp256k1_context_create_from_buffer(blob, len, 0) == NULL);
+        blob[len / 2] ^= 1;
+        blob[28] ^= 1;
+        CHECK(secp256k1_context_create_from_buffer(blob, len, 0) == NULL);
+        blob[28] ^= 1;
+        loaded = secp256k1_context_create_from_buffer(blob, len, 0);
+        CHECK(loaded != NULL);
+        secp256k1_context_destroy(loaded);
+        free(blob);
+        free(copy);
+
+        /* Parts missing from the buffer are built as usual. */
+        CHECK(secp256k1_context_serialize(sign, NULL, &len) == 1);
+        blob = (unsigned char *)checked_malloc(len);
+        CHECK(secp256k1_context_serialize(sign, blob, &len) == 1);
+        loaded = secp256k1_context_create_from_buffer(blob, len, SECP256K1_CONTEXT_VERIFY | SECP256K1_CONTEXT_LAZY);
+        CHECK(loaded != NULL);
+        CHECK(secp256k1_ecmult_context_is_built(&loaded->ecmult_ctx));
+        CHECK(!secp256k1_ecmult_gen2_context_is_built(&loaded->ecmult_gen2_ctx));
+        CHECK(loaded->borrowed == (1 << SECP256K1_CONTEXT_LAZY_ECMULT_GEN));
+        CHECK(secp256k1_pedersen_commit(loaded, commit, blind, 7));
+        CHECK(memcmp(commit, commitb, 33) == 0);
+        secp256k1_context_destroy(loaded);
+        free(blob);
+    }
+
     /* cleanup */
     secp256k1_context_destroy(none);
     secp256k1_context_destroy(sign);
@@ -234,6 +450,138 @@ void run_sha256_tests(void) {
     }
 }
 
+void run_sha256_x4_tests(void) {
+    unsigned char data[4][200];
+    unsigned char out[128];
+    unsigned char expected[32];
+    const unsigned char *ptrs[4];
+    secp256k1_sha256_t hashers[4];
+    secp256k1_sha256_t hasher;
+    void (*impl)(uint32_t* s, const uint32_t* chunk) = secp256k1_sha256_transform_impl;
+    int i, j;
+    for (i = 0; i < 2 * count; i++) {
+        size_t len = secp256k1_rand32() % 200;
+        size_t split = secp256k1_rand32() % (len + 1);
+        for (j = 0; j < 4; j++) {
+            secp256k1_rand256(data[j]);
+            secp256k1_rand256(data[j] + 32);
+            secp256k1_rand256(data[j] + 64);
+            secp256k1_rand256(data[j] + 96);
+            secp256k1_rand256(data[j] + 128);
+            secp256k1_rand256(data[j] + 160);
+            memcpy(data[j] + 192, data[j], 8);
+            secp256k1_sha256_initialize(&hashers[j]);
+            ptrs[j] = data[j];
+        }
+        /* The second half forces the four-lane code, which is bypassed when a hardware transform is in use. */
+        if (i == count) {
+            secp256k1_sha256_transform_impl = secp256k1_sha256_transform_portable;
+        }
+        secp256k1_sha256_write_x4(hashers, ptrs, split);
+        for (j = 0; j < 4; j++) {
+            ptrs[j] = data[j] + split;
+        }
+        secp256k1_sha256_write_x4(hashers, ptrs, len - split);
+        secp256k1_sha256_finalize_x4(hashers, out);
+        for (j = 0; j < 4; j++) {
+            secp256k1_sha256_initialize(&hasher);
+            secp256k1_sha256_write(&hasher, data[j], len);
+            secp256k1_sha256_finalize(&hasher, expected);
+            CHECK(memcmp(&out[32 * j], expected, 32) == 0);
+        }
+    }
+    secp256k1_sha256_transform_impl = impl;
+}
+
+void test_sha256_transform_impl(void (*impl)(uint32_t* s, const uint32_t* chunk)) {
+    uint32_t state[8], expected[8], chunk[16];
+    int i, j;
+    for (i = 0; i < count * 8; i++) {
+        for (j = 0; j < 16; j++) {
+            chunk[j] = secp256k1_rand32();
+        }
+        for (j = 0; j < 8; j++) {
+            state[j] = expected[j] = secp256k1_rand32();
+        }
+        secp256k1_sha256_transform_portable(expected, chunk);
+        impl(state, chunk);
+        CHECK(memcmp(state, expected, sizeof(state)) == 0);
+    }
+}
+
+void run_sha256_transform_tests(void) {
+    uint32_t state[8], expected[8], chunk[16];
+    int i;
+    /* Whichever implementation the dispatcher settles on must agree with the portable one. */
+    for (i = 0; i < 16; i++) {
+        chunk[i] = secp256k1_rand32();
+    }
+    for (i = 0; i < 8; i++) {
+        state[i] = expected[i] = secp256k1_rand32();
+    }
+    secp256k1_sha256_transform(state, chunk);
+    secp256k1_sha256_transform_portable(expected, chunk);
+    CHECK(memcmp(state, expected, sizeof(state)) == 0);
+    CHECK(secp256k1_sha256_transform_impl != secp256k1_sha256_transform_select);
+#if defined(HAVE_SHA256_SHANI)
+    if (secp256k1_sha256_shani_available()) {
+        test_sha256_transform_impl(secp256k1_sha256_transform_shani);
+    }
+#endif
+#if defined(SECP256K1_SHA256_ARMV8)
+    if (secp256k1_sha256_armv8_available()) {
+        test_sha256_transform_impl(secp256k1_sha256_transform_armv8);
+    }
+#endif
+}
+
+void run_sha256_midstate_tests(void) {
+    static const unsigned char tag[17] = "BIP0340/challenge";
+    static const unsigned char tagged_abc[32] = {
+        0x77, 0x0a, 0x5b, 0x7e, 0x7c, 0x30, 0x4b, 0xbc, 0xc3, 0xea, 0x10, 0x73, 0x43, 0xff, 0x95, 0x1d,
+        0xd4, 0x04, 0x31, 0x2e, 0xf4, 0x18, 0xdb, 0x0c, 0x3b, 0x94, 0xe2, 0xeb, 0xfb, 0xb5, 0x00, 0x87
+    };
+    unsigned char zero[32] = {0};
+    unsigned char data[160];
+    unsigned char out[32], expected[32];
+    secp256k1_sha256_t hasher;
+    secp256k1_sha256_midstate_t mid;
+    secp256k1_hmac_sha256_pads_t pads;
+    int i, j;
+
+    /* The precomputed RFC6979 starting pads are those of the all-zero key. */
+    secp256k1_hmac_sha256_pads(&pads, zero, 32);
+    CHECK(memcmp(&pads, &secp256k1_rfc6979_hmac_sha256_zero_pads, sizeof(pads)) == 0);
+
+    secp256k1_sha256_initialize_tagged(&hasher, tag, sizeof(tag));
+    secp256k1_sha256_write(&hasher, (const unsigned char*)"abc", 3);
+    secp256k1_sha256_finalize(&hasher, out);
+    CHECK(memcmp(out, tagged_abc, 32) == 0);
+
+    for (i = 0; i < count; i++) {
+        size_t prefix = 64 * (secp256k1_rand32() % 3);
+        size_t len = prefix + secp256k1_rand32() % (sizeof(data) - prefix + 1);
+        for (j = 0; j < 160; j += 32) {
+            secp256k1_rand256(data + j);
+        }
+        secp256k1_sha256_initialize(&hasher);
+        secp256k1_sha256_write(&hasher, data, len);
+        secp256k1_sha256_finalize(&hasher, expected);
+
+        secp256k1_sha256_initialize(&hasher);
+        secp256k1_sha256_write(&hasher, data, prefix);
+        secp256k1_sha256_save(&hasher, &mid);
+        /* Restoring must work into a hasher in any state, and more than once. */
+        for (j = 0; j < 2; j++) {
+            secp256k1_sha256_write(&hasher, data, j + 1);
+            secp256k1_sha256_restore(&hasher, &mid);
+            secp256k1_sha256_write(&hasher, data + prefix, len - prefix);
+            secp256k1_sha256_finalize(&hasher, out);
+            CHECK(memcmp(out, expected, 32) == 0);
+        }
+    }
+}
+
 void run_hmac_sha256_tests(void) {
     static const char *keys[6] = {
         "\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b",
@@ -295,8 +643,10 @@ void run_rfc6979_hmac_sha256_tests(void) {
         {0x75, 0x97, 0x88, 0x7c, 0xbd, 0x76, 0x32, 0x1f, 0x32, 0xe3, 0x04, 0x40, 0x67, 0x9a, 0x22, 0xcf, 0x7f, 0x8d, 0x9d, 0x2e, 0xac, 0x39, 0x0e, 0x58, 0x1f, 0xea, 0x09, 0x1c, 0xe2, 0x02, 0xba, 0x94}
     };
 
-    secp256k1_rfc6979_hmac_sha256_t rng;
-    unsigned char out[32];
+    secp256k1_rfc6979_hmac_sha256_t rng, rng2;
+    secp256k1_sha256_midstate_t mid;
+    unsigned char out[32], out2b[32];
+    unsigned char rnd[32];
     unsigned char zero[1] = {0};
     int i;
 
@@ -320,6 +670,34 @@ void run_rfc6979_hmac_sha256_tests(void) {
         CHECK(memcmp(out, out2[i], 32) == 0);
     }
     secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+
+    /* Starting from a key midstate gives the same stream, also with additional data. */
+    secp256k1_rfc6979_hmac_sha256_key_midstate(&mid, key1, 32);
+    secp256k1_rfc6979_hmac_sha256_initialize_midstate(&rng, &mid, key1, 32, msg1, 32, NULL, 1);
+    for (i = 0; i < 3; i++) {
+        secp256k1_rfc6979_hmac_sha256_generate(&rng, out, 32);
+        CHECK(memcmp(out, out1[i], 32) == 0);
+    }
+    secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+
+    secp256k1_rfc6979_hmac_sha256_key_midstate(&mid, key2, 32);
+    secp256k1_rfc6979_hmac_sha256_initialize_midstate(&rng, &mid, key2, 32, msg2, 32, zero, 0);
+    for (i = 0; i < 3; i++) {
+        secp256k1_rfc6979_hmac_sha256_generate(&rng, out, 32);
+        CHECK(memcmp(out, out2[i], 32) == 0);
+    }
+    secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+
+    secp256k1_rand256(rnd);
+    secp256k1_rfc6979_hmac_sha256_initialize(&rng, key2, 32, msg1, 32, rnd, 32);
+    secp256k1_rfc6979_hmac_sha256_initialize_midstate(&rng2, &mid, key2, 32, msg1, 32, rnd, 32);
+    for (i = 0; i < 3; i++) {
+        secp256k1_rfc6979_hmac_sha256_generate(&rng, out, 32);
+        secp256k1_rfc6979_hmac_sha256_generate(&rng2, out2b, 32);
+        CHECK(memcmp(out, out2b, 32) == 0);
+    }
+    secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+    secp256k1_rfc6979_hmac_sha256_finalize(&rng2);
 }
 
 /***** NUM TESTS *****/
@@ -609,9 +987,26 @@ void scalar_test(void) {
             /* No overflow happened. */
             secp256k1_scalar_add_bit(&r2, bit);
             CHECK(secp256k1_scalar_eq(&r1, &r2));
+            /* cadd_bit is add_bit when the flag is set, and nothing otherwise. */
+            r2 = s1;
+            secp256k1_scalar_cadd_bit(&r2, bit, 0);
+            CHECK(secp256k1_scalar_eq(&r2, &s1));
+            secp256k1_scalar_cadd_bit(&r2, bit, 1);
+            CHECK(secp256k1_scalar_eq(&r1, &r2));
         }
     }
 
+    {
+        /* Test cond_negate. */
+        secp256k1_scalar_t r1, r2;
+        secp256k1_scalar_negate(&r1, &s1);
+        r2 = s1;
+        CHECK(secp256k1_scalar_cond_negate(&r2, 0) == 1);
+        CHECK(secp256k1_scalar_eq(&r2, &s1));
+        CHECK(secp256k1_scalar_cond_negate(&r2, 1) == -1);
+        CHECK(secp256k1_scalar_eq(&r2, &r1));
+    }
+
     {
         /* Test commutativity of mul. */
         secp256k1_scalar_t r1, r2;
@@ -685,12 +1080,50 @@ void scalar_test(void) {
 
 }
 
+#if defined(USE_SCALAR_4X64) && defined(USE_ASM_X86_64) && defined(HAVE_ASM_X86_64_ADX)
+void test_scalar_adx(void) {
+    /* The BMI2/ADX kernels must agree with the baseline assembly, which is forced by pretending that the
+     * CPU lacks the extensions. */
+    int features = secp256k1_x86_64_features;
+    secp256k1_scalar_t a, b, r1, r2;
+    uint64_t l1[8], l2[8];
+    int i, j;
+    for (i = 0; i < 64 * count; i++) {
+        random_scalar_order_test(&a);
+        random_scalar_order_test(&b);
+        if (i < 4) {
+            /* Include the largest scalar, and the largest 512-bit input to the reduction. */
+            secp256k1_scalar_set_int(&r1, 1);
+            if (i & 1) secp256k1_scalar_negate(&a, &r1);
+            if (i & 2) secp256k1_scalar_negate(&b, &r1);
+        }
+        for (j = 0; j < 8; j++) {
+            l1[j] = i == 4 ? ~(uint64_t)0 : ((uint64_t)secp256k1_rand32() << 32) | secp256k1_rand32();
+        }
+        secp256k1_scalar_reduce_512(&r1, l1);
+        secp256k1_x86_64_features = SECP256K1_X86_64_DETECTED;
+        secp256k1_scalar_reduce_512(&r2, l1);
+        secp256k1_scalar_mul_512(l2, &a, &b);
+        secp256k1_x86_64_features = features;
+        CHECK(secp256k1_scalar_eq(&r1, &r2));
+        secp256k1_scalar_mul_512(l1, &a, &b);
+        CHECK(memcmp(l1, l2, sizeof(l1)) == 0);
+    }
+}
+#endif
+
 void run_scalar_tests(void) {
     int i;
     for (i = 0; i < 128 * count; i++) {
         scalar_test();
     }
 
+#if defined(USE_SCALAR_4X64) && defined(USE_ASM_X86_64) && defined(HAVE_ASM_X86_64_ADX)
+    if (secp256k1_x86_64_have_bmi2_adx()) {
+        test_scalar_adx();
+    }
+#endif
+
     {
         /* (-1)+1 should be zero. */
         secp256k1_scalar_t s, o;
@@ -703,6 +1136,71 @@ void run_scalar_tests(void) {
         CHECK(secp256k1_scalar_is_zero(&o));
     }
 
+    {
+        /* An accumulator must agree with reducing after every addition, also once its carry word is in use. */
+        secp256k1_scalar_acc_t acc;
+        secp256k1_scalar_t x, sum, t;
+        unsigned char b32[32];
+        int j;
+        secp256k1_scalar_acc_clear(&acc);
+        secp256k1_scalar_set_int(&sum, 0);
+        for (j = 0; j < 64; j++) {
+            random_scalar_order_test(&x);
+            secp256k1_scalar_acc_add(&acc, &x);
+            secp256k1_scalar_add(&sum, &sum, &x);
+        }
+        secp256k1_scalar_acc_get(&t, &acc);
+        CHECK(secp256k1_scalar_eq(&t, &sum));
+        /* 4096 * (n - 1) = -4096 */
+        secp256k1_scalar_acc_clear(&acc);
+        secp256k1_scalar_set_int(&x, 1);
+        secp256k1_scalar_negate(&x, &x);
+        for (j = 0; j < 4096; j++) {
+            secp256k1_scalar_acc_add(&acc, &x);
+        }
+        secp256k1_scalar_acc_get(&t, &acc);
+        secp256k1_scalar_set_int(&sum, 4096);
+        secp256k1_scalar_add(&t, &t, &sum);
+        CHECK(secp256k1_scalar_is_zero(&t));
+        /* The largest value it can hold, 2^320 - 1 */
+        memset(&acc, 0xFF, sizeof(acc));
+        secp256k1_scalar_acc_get(&t, &acc);
+        memset(b32, 0, 32);
+        b32[23] = 1;
+        secp256k1_scalar_set_b32(&x, b32, NULL);
+        secp256k1_scalar_mul(&sum, &x, &x);
+        secp256k1_scalar_mul(&sum, &sum, &sum);
+        secp256k1_scalar_mul(&sum, &sum, &x);
+        secp256k1_scalar_set_int(&x, 1);
+        secp256k1_scalar_negate(&x, &x);
+        secp256k1_scalar_add(&sum, &sum, &x);
+        CHECK(secp256k1_scalar_eq(&t, &sum));
+    }
+
+    {
+        /* Batch inversion, blinded or not, must agree with inverting one at a time. */
+        secp256k1_scalar_t x[16], xi[16], xib[16], inv, blind;
+        size_t len, j;
+        for (i = 0; i < count; i++) {
+            len = secp256k1_rand32() & 15;
+            for (j = 0; j < len; j++) {
+                do {
+                    random_scalar_order_test(&x[j]);
+                } while (secp256k1_scalar_is_zero(&x[j]));
+            }
+            do {
+                random_scalar_order_test(&blind);
+            } while (secp256k1_scalar_is_zero(&blind));
+            secp256k1_scalar_inverse_all_var(len, xi, x);
+            secp256k1_scalar_inverse_all(len, xib, x, &blind);
+            for (j = 0; j < len; j++) {
+                secp256k1_scalar_inverse(&inv, &x[j]);
+                CHECK(secp256k1_scalar_eq(&inv, &xi[j]));
+                CHECK(secp256k1_scalar_eq(&inv, &xib[j]));
+            }
+        }
+    }
+
 #ifndef USE_NUM_NONE
     {
         /* A scalar with value of the curve order should be 0. */
@@ -881,13 +1379,13 @@ void run_field_inv_var(void) {
 }
 
 void run_field_inv_all_var(void) {
-    secp256k1_fe_t x[16], xi[16], xii[16];
+    secp256k1_fe_t x[32], xi[32], xii[32];
     int i;
     /* Check it's safe to call for 0 elements */
     secp256k1_fe_inv_all_var(0, xi, x);
     for (i = 0; i < count; i++) {
         size_t j;
-        size_t len = (secp256k1_rand32() & 15) + 1;
+        size_t len = (secp256k1_rand32() & 31) + 1;
         for (j = 0; j < len; j++) {
             random_fe_non_zero(&x[j]);
         }
@@ -902,6 +1400,52 @@ void run_field_inv_all_var(void) {
     }
 }
 
+void run_field_mul_x4(void) {
+    secp256k1_fe_t a[4], b[4], r[4], c;
+    secp256k1_fe_t *rp[4], *arp[4];
+    const secp256k1_fe_t *ap[4], *bp[4];
+    int i, j;
+    for (j = 0; j < 4; j++) {
+        rp[j] = &r[j];
+        arp[j] = &a[j];
+        ap[j] = &a[j];
+        bp[j] = &b[j];
+    }
+    for (i = 0; i < 10*count; i++) {
+        for (j = 0; j < 4; j++) {
+            random_fe(&a[j]);
+            random_fe(&b[j]);
+            /* Exercise the largest input magnitude on some lanes. */
+            if (secp256k1_rand32() & 1) {
+                secp256k1_fe_mul_int(&a[j], 8);
+            }
+            if (secp256k1_rand32() & 1) {
+                secp256k1_fe_mul_int(&b[j], 8);
+            }
+        }
+        secp256k1_fe_mul_x4(rp, ap, bp);
+        for (j = 0; j < 4; j++) {
+            secp256k1_fe_mul(&c, &a[j], &b[j]);
+            CHECK(check_fe_equal(&r[j], &c));
+        }
+        /* The output may alias the first input. */
+        for (j = 0; j < 4; j++) {
+            c = a[j];
+            secp256k1_fe_mul(&c, &c, &b[j]);
+            r[j] = c;
+        }
+        secp256k1_fe_mul_x4(arp, ap, bp);
+        for (j = 0; j < 4; j++) {
+            CHECK(check_fe_equal(&a[j], &r[j]));
+        }
+        secp256k1_fe_sqr_x4(rp, bp);
+        for (j = 0; j < 4; j++) {
+            secp256k1_fe_sqr(&c, &b[j]);
+            CHECK(check_fe_equal(&r[j], &c));
+        }
+    }
+}
+
 void run_sqr(void) {
     secp256k1_fe_t x, s;
 
@@ -964,6 +1508,105 @@ void run_sqrt(void) {
             test_sqrt(&t, NULL);
         }
     }
+
+    /* The four-way version agrees with the single one on squares and non-squares. */
+    for (i = 0; i < count; i++) {
+        secp256k1_fe_t a[4], r[4];
+        int ret[4];
+        int j;
+        for (j = 0; j < 4; j++) {
+            random_fe(&x);
+            secp256k1_fe_sqr(&a[j], &x);
+            if (secp256k1_rand32() & 1) {
+                secp256k1_fe_negate(&a[j], &a[j], 1);
+            }
+        }
+        secp256k1_fe_sqrt_x4_var(r, ret, a);
+        for (j = 0; j < 4; j++) {
+            CHECK(ret[j] == secp256k1_fe_sqrt_var(&s, &a[j]));
+            if (ret[j]) {
+                CHECK(check_fe_equal(&r[j], &s));
+            }
+        }
+    }
+}
+
+/* Check the constant time and variable time inverses against each other and against
+ * multiplication, for zero, values near the moduli, and sparse values with long runs of zeros. */
+void test_inverse_field(const secp256k1_fe_t *x) {
+    secp256k1_fe_t a, b, c;
+    secp256k1_fe_t one = SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 1);
+    secp256k1_fe_inv(&a, x);
+    c = *x;
+    secp256k1_fe_normalize_var(&c);
+    if (secp256k1_fe_is_zero(&c)) {
+        /* The num-based variable time inverse does not accept zero. */
+        secp256k1_fe_normalize_var(&a);
+        CHECK(secp256k1_fe_is_zero(&a));
+        return;
+    }
+    secp256k1_fe_inv_var(&b, x);
+    CHECK(check_fe_equal(&a, &b));
+    secp256k1_fe_mul(&c, &a, x);
+    CHECK(check_fe_equal(&c, &one));
+}
+
+void test_inverse_scalar(const secp256k1_scalar_t *x) {
+    secp256k1_scalar_t a, b, c;
+    secp256k1_scalar_inverse(&a, x);
+    if (secp256k1_scalar_is_zero(x)) {
+        CHECK(secp256k1_scalar_is_zero(&a));
+        return;
+    }
+    secp256k1_scalar_inverse_var(&b, x);
+    CHECK(secp256k1_scalar_eq(&a, &b));
+    secp256k1_scalar_mul(&c, &a, x);
+    CHECK(secp256k1_scalar_is_one(&c));
+}
+
+void run_inverse_tests(void) {
+    static const secp256k1_fe_t fe_cases[] = {
+        SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 0),
+        SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 1),
+        SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 2),
+        SECP256K1_FE_CONST(0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFEUL, 0xFFFFFC2EUL),
+        SECP256K1_FE_CONST(0x80000000UL, 0, 0, 0, 0, 0, 0, 0)
+    };
+    static const secp256k1_scalar_t scalar_cases[] = {
+        SECP256K1_SCALAR_CONST(0, 0, 0, 0, 0, 0, 0, 0),
+        SECP256K1_SCALAR_CONST(0, 0, 0, 0, 0, 0, 0, 1),
+        SECP256K1_SCALAR_CONST(0, 0, 0, 0, 0, 0, 0, 2),
+        SECP256K1_SCALAR_CONST(0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFEUL, 0xBAAEDCE6UL, 0xAF48A03BUL, 0xBFD25E8CUL, 0xD0364140UL),
+        SECP256K1_SCALAR_CONST(0x80000000UL, 0, 0, 0, 0, 0, 0, 0)
+    };
+    secp256k1_fe_t x;
+    secp256k1_scalar_t s;
+    unsigned char b32[32];
+    size_t i;
+    int j;
+
+    for (i = 0; i < sizeof(fe_cases) / sizeof(fe_cases[0]); i++) {
+        test_inverse_field(&fe_cases[i]);
+    }
+    for (i = 0; i < sizeof(scalar_cases) / sizeof(scalar_cases[0]); i++) {
+        test_inverse_scalar(&scalar_cases[i]);
+    }
+    for (i = 0; i < (size_t)(10 * count); i++) {
+        /* A few random bits, to exercise long runs of zeros in the variable time versions. */
+        memset(b32, 0, sizeof(b32));
+        for (j = 0; j < 3; j++) {
+            int bit = secp256k1_rand32() & 255;
+            b32[bit >> 3] |= 1 << (bit & 7);
+        }
+        CHECK(secp256k1_fe_set_b32(&x, b32));
+        test_inverse_field(&x);
+        secp256k1_scalar_set_b32(&s, b32, NULL);
+        test_inverse_scalar(&s);
+        random_fe(&x);
+        test_inverse_field(&x);
+        random_scalar_order_test(&s);
+        test_inverse_scalar(&s);
+    }
 }
 
 /***** GROUP TESTS *****/
@@ -1206,11 +1849,99 @@ void test_ge(void) {
     free(zinv);
 }
 
+void test_add_neg_y_diff_x(void) {
+    /* Adding b to a = -lambda*b (or -lambda^2*b): y1 == -y2 and x1^3 == x2^3, but x1 != x2, which makes
+     * the unified formula in secp256k1_gej_add_ge degenerate. */
+    static const secp256k1_fe_t beta = SECP256K1_FE_CONST(
+        0x7ae96a2bul, 0x657c0710ul, 0x6e64479eul, 0xac3434e9ul,
+        0x9cf04975ul, 0x12f58995ul, 0xc1396c28ul, 0x719501eeul
+    );
+    secp256k1_ge_t a, b;
+    secp256k1_gej_t aj, res, expected;
+    int i;
+    random_group_element_test(&b);
+    secp256k1_fe_normalize(&b.y);
+    a = b;
+    for (i = 0; i < 2; i++) {
+        secp256k1_ge_t neg;
+        secp256k1_fe_mul(&a.x, &a.x, &beta);
+        secp256k1_ge_neg(&neg, &a);
+        random_group_element_jacobian_test(&aj, &neg);
+        secp256k1_gej_add_ge(&res, &aj, &b);
+        secp256k1_gej_add_ge_var(&expected, &aj, &b, NULL);
+        CHECK(!res.infinity);
+        secp256k1_gej_neg(&expected, &expected);
+        secp256k1_gej_add_var(&res, &res, &expected, NULL);
+        CHECK(secp256k1_gej_is_infinity(&res));
+    }
+}
+
+void test_ge_storage_select(void) {
+    secp256k1_ge_storage_t table[16], r;
+    secp256k1_ge_t ge;
+    int i;
+    for (i = 0; i < 16; i++) {
+        random_group_element_test(&ge);
+        secp256k1_fe_normalize(&ge.x);
+        secp256k1_fe_normalize(&ge.y);
+        secp256k1_ge_to_storage(&table[i], &ge);
+    }
+    for (i = 0; i < 16; i++) {
+        memset(&r, i, sizeof(r));
+        secp256k1_ge_storage_select(&r, table, 16, i);
+        CHECK(memcmp(&r, &table[i], sizeof(r)) == 0);
+        secp256k1_ge_storage_select(&r, table, i + 1, i);
+        CHECK(memcmp(&r, &table[i], sizeof(r)) == 0);
+    }
+}
+
 void run_ge(void) {
     int i;
     for (i = 0; i < count * 32; i++) {
         test_ge();
     }
+    for (i = 0; i < count; i++) {
+        test_add_neg_y_diff_x();
+        test_ge_storage_select();
+    }
+}
+
+void test_gej_add_all_ge(void) {
+    secp256k1_ge_t pool[9];
+    secp256k1_ge_t a[200];
+    secp256k1_fe_t work[200];
+    secp256k1_gej_t ref, sum;
+    size_t n = secp256k1_rand32() % 200;
+    size_t i;
+
+    /* Draw the points from a small pool, so that equal and opposite pairs occur. */
+    secp256k1_ge_set_infinity(&pool[0]);
+    for (i = 1; i < 9; i += 2) {
+        random_group_element_test(&pool[i]);
+        secp256k1_ge_neg(&pool[i + 1], &pool[i]);
+    }
+    random_group_element_jacobian_test(&ref, &pool[1]);
+    sum = ref;
+    for (i = 0; i < n; i++) {
+        uint32_t r = secp256k1_rand32();
+        if (r & 1) {
+            random_group_element_test(&a[i]);
+        } else {
+            a[i] = pool[(r >> 1) % 9];
+        }
+        secp256k1_gej_add_ge_var(&ref, &ref, &a[i], NULL);
+    }
+    secp256k1_gej_add_all_ge_var(&sum, a, n, work);
+    secp256k1_gej_neg(&ref, &ref);
+    secp256k1_gej_add_var(&sum, &sum, &ref, NULL);
+    CHECK(secp256k1_gej_is_infinity(&sum));
+}
+
+void run_gej_add_all_ge(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_gej_add_all_ge();
+    }
 }
 
 /***** ECDH TESTS *****/
@@ -1289,10 +2020,187 @@ void ecdh_mult_zero_one(void) {
     ge_equals_ge(&res2, &point);
 }
 
+void ecdh_mult_edge(void) {
+    /* Scalars whose GLV halves hit the special cases of the skewed wNAF (halves of -1 and -2, which
+     * cancel the skews), compared against secp256k1_ecmult. */
+    static const secp256k1_scalar_t minus_lambda = SECP256K1_SCALAR_CONST(
+        0xAC9C52B3UL, 0x3FA3CF1FUL, 0x5AD9E3FDUL, 0x77ED9BA4UL,
+        0xA880B9FCUL, 0x8EC739C2UL, 0xE0CFC810UL, 0xB51283CFUL
+    );
+    secp256k1_scalar_t zero, sc[12];
+    secp256k1_gej_t res, expected, aj;
+    secp256k1_ge_t a;
+    int i;
+
+    secp256k1_scalar_set_int(&zero, 0);
+    for (i = 0; i < 4; i++) {
+        secp256k1_scalar_set_int(&sc[i], i + 1);
+        secp256k1_scalar_negate(&sc[4 + i], &sc[i]);
+        /* -(i+1) - (i+1)*lambda */
+        secp256k1_scalar_mul(&sc[8 + i], &sc[i], &minus_lambda);
+        secp256k1_scalar_add(&sc[8 + i], &sc[8 + i], &sc[4 + i]);
+    }
+    random_group_element_test(&a);
+    secp256k1_gej_set_ge(&aj, &a);
+    for (i = 0; i < 12; i++) {
+        secp256k1_ecdh_point_multiply(&res, &a, &sc[i]);
+        secp256k1_ecmult(&ctx->ecmult_ctx, &expected, &aj, &sc[i], &zero);
+        secp256k1_gej_neg(&expected, &expected);
+        secp256k1_gej_add_var(&res, &res, &expected, NULL);
+        CHECK(secp256k1_gej_is_infinity(&res));
+    }
+}
+
+void ecdh_mult_ladder(void) {
+    /* Scalars around the values for which the ladder meets equal x coordinates ((n-1)/2, and 2^256 - n,
+     * where it switches between k + n and k + 2n), small ones, and random ones, compared against secp256k1_ecmult. */
+    static const secp256k1_scalar_t special[2] = {
+        SECP256K1_SCALAR_CONST(0x7FFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0x5D576E73UL, 0x57A4501DUL, 0xDFE92F46UL, 0x681B20A0UL),
+        SECP256K1_SCALAR_CONST(0x00000000UL, 0x00000000UL, 0x00000000UL, 0x00000001UL, 0x45512319UL, 0x50B75FC4UL, 0x402DA173UL, 0x2FC9BEBFUL)
+    };
+    secp256k1_scalar_t base[4], sc, d;
+    secp256k1_gej_t res, wnaf, expected, aj;
+    secp256k1_ge_t a;
+    int i, j;
+
+    secp256k1_scalar_set_int(&base[0], 0);
+    base[1] = special[0];
+    base[2] = special[1];
+    secp256k1_scalar_negate(&base[3], &special[1]);
+    random_group_element_test(&a);
+    secp256k1_gej_set_ge(&aj, &a);
+    for (i = 0; i < 24; i++) {
+        if (i < 20) {
+            /* base[i / 5] + j, for j in -2..2 */
+            j = i % 5 - 2;
+            secp256k1_scalar_set_int(&d, j < 0 ? -j : j);
+            if (j < 0) {
+                secp256k1_scalar_negate(&d, &d);
+            }
+            secp256k1_scalar_add(&sc, &base[i / 5], &d);
+        } else {
+            random_scalar_order_test(&sc);
+        }
+        secp256k1_ecdh_point_multiply_ladder(&res, &a, &sc);
+        secp256k1_ecdh_point_multiply_wnaf_batch(&wnaf, &a, 1, &sc);
+        secp256k1_ecmult(&ctx->ecmult_ctx, &expected, &aj, &sc, &base[0]);
+        secp256k1_gej_neg(&expected, &expected);
+        secp256k1_gej_add_var(&res, &res, &expected, NULL);
+        CHECK(secp256k1_gej_is_infinity(&res));
+        secp256k1_gej_add_var(&wnaf, &wnaf, &expected, NULL);
+        CHECK(secp256k1_gej_is_infinity(&wnaf));
+    }
+}
+
+void ecdh_point_precomp(void) {
+    secp256k1_point_precomp *precomp;
+    secp256k1_pubkey point;
+    secp256k1_pubkey result;
+    secp256k1_pubkey expected;
+    secp256k1_ge p;
+    secp256k1_ge r;
+    secp256k1_gej rj;
+    secp256k1_scalar_t x;
+    unsigned char seed[32];
+    unsigned char x32[32];
+    int i;
+
+    random_group_element_test(&p);
+    secp256k1_pubkey_save(&point, &p);
+    secp256k1_rand256(seed);
+    precomp = secp256k1_point_precomp_create(ctx, &point, (secp256k1_rand32() & 1) ? seed : NULL);
+    CHECK(precomp != NULL);
+    for (i = 0; i < 4; i++) {
+        random_scalar_order_test(&x);
+        secp256k1_scalar_get_b32(x32, &x);
+        CHECK(secp256k1_point_precomp_multiply(ctx, &result, precomp, x32));
+        secp256k1_ecdh_point_multiply(&rj, &p, &x);
+        secp256k1_ge_set_gej(&r, &rj);
+        secp256k1_pubkey_save(&expected, &r);
+        CHECK(memcmp(&result, &expected, sizeof(result)) == 0);
+    }
+    memset(x32, 0, 32);
+    CHECK(!secp256k1_point_precomp_multiply(ctx, &result, precomp, x32));
+    memset(x32, 0xFF, 32);
+    CHECK(!secp256k1_point_precomp_multiply(ctx, &result, precomp, x32));
+    secp256k1_point_precomp_destroy(precomp);
+}
+
+void ecdh_hashed(void) {
+    unsigned char s_one[32] = { 0 };
+    unsigned char s_a[32], s_b[32];
+    unsigned char out_a[32], out_b[32], out_ser[32];
+    unsigned char point_ser[33];
+    int point_ser_len = 33;
+    secp256k1_pubkey point_a, point_b;
+    secp256k1_scalar_t sa, sb;
+    secp256k1_sha256_t sha;
+
+    random_scalar_order_test(&sa);
+    random_scalar_order_test(&sb);
+    secp256k1_scalar_get_b32(s_a, &sa);
+    secp256k1_scalar_get_b32(s_b, &sb);
+    CHECK(secp256k1_ec_pubkey_create_ex(ctx, &point_a, s_a));
+    CHECK(secp256k1_ec_pubkey_create_ex(ctx, &point_b, s_b));
+
+    /* Both sides compute the same secret. */
+    CHECK(secp256k1_ecdh(ctx, out_a, &point_b, s_a));
+    CHECK(secp256k1_ecdh(ctx, out_b, &point_a, s_b));
+    CHECK(memcmp(out_a, out_b, 32) == 0);
+
+    /* The secret is the hash of the compressed shared point. */
+    CHECK(secp256k1_ec_pubkey_create(ctx, point_ser, &point_ser_len, s_b, 1));
+    CHECK(secp256k1_point_multiply(point_ser, &point_ser_len, s_a) == 1);
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, point_ser, point_ser_len);
+    secp256k1_sha256_finalize(&sha, out_ser);
+    CHECK(memcmp(out_a, out_ser, 32) == 0);
+
+    /* Zero and overflowing scalars are rejected. */
+    CHECK(!secp256k1_ecdh(ctx, out_a, &point_a, s_one));
+    memset(s_one, 0xFF, 32);
+    CHECK(!secp256k1_ecdh(ctx, out_a, &point_a, s_one));
+}
+
+void ecdh_batch(void) {
+    unsigned char seckeys[40][32];
+    unsigned char scalar[32];
+    unsigned char results[40 * 32];
+    unsigned char expected[32];
+    secp256k1_pubkey points[40];
+    const secp256k1_pubkey *pointp[40];
+    secp256k1_scalar_t x;
+    size_t n = secp256k1_rand32() % 40;
+    size_t i;
+
+    for (i = 0; i < 40; i++) {
+        pointp[i] = &points[i];
+    }
+    for (i = 0; i < n; i++) {
+        random_scalar_order_test(&x);
+        secp256k1_scalar_get_b32(seckeys[i], &x);
+        CHECK(secp256k1_ec_pubkey_create_ex(ctx, &points[i], seckeys[i]));
+    }
+    random_scalar_order_test(&x);
+    secp256k1_scalar_get_b32(scalar, &x);
+    CHECK(secp256k1_ecdh_batch(ctx, results, pointp, n, scalar));
+    for (i = 0; i < n; i++) {
+        CHECK(secp256k1_ecdh(ctx, expected, &points[i], scalar));
+        CHECK(memcmp(&results[32 * i], expected, 32) == 0);
+    }
+    memset(scalar, 0, 32);
+    CHECK(!secp256k1_ecdh_batch(ctx, results, pointp, n, scalar));
+}
+
 void run_ecdh_tests(void) {
     ecdh_mult_zero();
+    ecdh_mult_edge();
+    ecdh_mult_ladder();
     ecdh_random_mult();
     ecdh_commutativity();
+    ecdh_point_precomp();
+    ecdh_hashed();
+    ecdh_batch();
 }
 
 void run_ecdh_api_tests(void) {
@@ -1598,6 +2506,167 @@ void run_ecmult_constants(void) {
     test_ecmult_constants();
 }
 
+void run_ecmult_window_tests(void) {
+    static const int windows[4] = {ECMULT_WINDOW_MIN, 3, 8, WINDOW_G + 1};
+    secp256k1_scratch_t *scratch = secp256k1_scratch_create(1 << 16);
+    int w, i;
+    for (w = 0; w < 4; w++) {
+        secp256k1_context_t *wctx = secp256k1_context_create_window(SECP256K1_CONTEXT_VERIFY, windows[w]);
+        CHECK(wctx->ecmult_ctx.window_g <= windows[w]);
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+        {
+            /* The segments of the build give the same tables as a single chain of odd multiples. */
+            const int n = ECMULT_TABLE_SIZE(wctx->ecmult_ctx.window_g);
+            secp256k1_ge_storage_t *pre = (secp256k1_ge_storage_t *)checked_malloc(sizeof(secp256k1_ge_storage_t) * n);
+            secp256k1_gej_t gj;
+            secp256k1_gej_set_ge(&gj, &secp256k1_ge_const_g);
+            secp256k1_ecmult_odd_multiples_table_storage_var(n, pre, &gj);
+            CHECK(memcmp(pre, *wctx->ecmult_ctx.pre_g, sizeof(secp256k1_ge_storage_t) * n) == 0);
+#ifdef USE_ENDOMORPHISM
+            for (i = 0; i < 128; i++) {
+                secp256k1_gej_double_var(&gj, &gj, NULL);
+            }
+            secp256k1_ecmult_odd_multiples_table_storage_var(n, pre, &gj);
+            CHECK(memcmp(pre, *wctx->ecmult_ctx.pre_g_128, sizeof(secp256k1_ge_storage_t) * n) == 0);
+#endif
+            free(pre);
+        }
+#endif
+        for (i = 0; i < count; i++) {
+            secp256k1_gej_t a, r1, r2;
+            secp256k1_ge_t ag;
+            secp256k1_scalar_t na, ng;
+            random_group_element_test(&ag);
+            secp256k1_gej_set_ge(&a, &ag);
+            random_scalar_order_test(&na);
+            random_scalar_order_test(&ng);
+            secp256k1_ecmult(&ctx->ecmult_ctx, &r1, &a, &na, &ng);
+            secp256k1_ecmult(&wctx->ecmult_ctx, &r2, &a, &na, &ng);
+            secp256k1_gej_neg(&r1, &r1);
+            secp256k1_gej_add_var(&r2, &r2, &r1, NULL);
+            CHECK(secp256k1_gej_is_infinity(&r2));
+            secp256k1_ecmult_multi(&wctx->ecmult_ctx, scratch, &r2, &ng, &ag, &na, 1);
+            secp256k1_gej_add_var(&r2, &r2, &r1, NULL);
+            CHECK(secp256k1_gej_is_infinity(&r2));
+        }
+        secp256k1_context_destroy(wctx);
+    }
+    secp256k1_scratch_destroy(scratch);
+}
+
+void run_scratch_tests(void) {
+    secp256k1_scratch_t *scratch = secp256k1_scratch_create(1000);
+    size_t checkpoint;
+    unsigned char *a;
+    unsigned char *b;
+
+    /* The usable size is rounded down to the alignment. */
+    CHECK(secp256k1_scratch_max_allocation(scratch, 0) == 1000 - 1000 % SECP256K1_SCRATCH_ALIGNMENT);
+    CHECK(secp256k1_scratch_max_allocation(scratch, 1) == secp256k1_scratch_max_allocation(scratch, 0) - (SECP256K1_SCRATCH_ALIGNMENT - 1));
+    a = (unsigned char *)secp256k1_scratch_alloc(scratch, 1);
+    CHECK(a != NULL);
+    checkpoint = secp256k1_scratch_checkpoint(scratch);
+    CHECK(checkpoint == SECP256K1_SCRATCH_ALIGNMENT);
+    b = (unsigned char *)secp256k1_scratch_alloc(scratch, 500);
+    CHECK(b == a + SECP256K1_SCRATCH_ALIGNMENT);
+    memset(b, 0, 500);
+    CHECK(secp256k1_scratch_alloc(scratch, 500) == NULL);
+    secp256k1_scratch_apply_checkpoint(scratch, checkpoint);
+    CHECK(secp256k1_scratch_alloc(scratch, 500) == b);
+    /* Everything that is left can be allocated, one more byte cannot. */
+    CHECK(secp256k1_scratch_alloc(scratch, secp256k1_scratch_max_allocation(scratch, 0) + 1) == NULL);
+    CHECK(secp256k1_scratch_alloc(scratch, secp256k1_scratch_max_allocation(scratch, 1)) != NULL);
+    CHECK(secp256k1_scratch_max_allocation(scratch, 0) == 0);
+    secp256k1_scratch_apply_checkpoint(scratch, 0);
+    secp256k1_scratch_destroy(scratch);
+}
+
+void test_ecmult_multi(size_t n) {
+    secp256k1_ge_t points[200];
+    secp256k1_scalar_t scalars[200];
+    secp256k1_scalar_t ng, zero;
+    secp256k1_gej_t expected, r, tmp, pj;
+    int use_ng = secp256k1_rand32() & 1;
+    secp256k1_scratch_t *scratch = secp256k1_scratch_create(1 << 20);
+    secp256k1_scratch_t *small;
+    size_t i;
+
+    CHECK(n <= 200);
+    secp256k1_scalar_set_int(&zero, 0);
+    random_scalar_order_test(&ng);
+    secp256k1_gej_set_infinity(&expected);
+    if (use_ng) {
+        secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &expected, &ng);
+    }
+    for (i = 0; i < n; i++) {
+        random_group_element_test(&points[i]);
+        random_scalar_order_test(&scalars[i]);
+        switch (secp256k1_rand32() & 15) {
+        case 0:
+            secp256k1_scalar_set_int(&scalars[i], 0);
+            break;
+        case 1:
+            secp256k1_ge_set_infinity(&points[i]);
+            break;
+        case 2:
+            /* Cancel out the previous term. */
+            if (i > 0) {
+                points[i] = points[i - 1];
+                secp256k1_scalar_negate(&scalars[i], &scalars[i - 1]);
+            }
+            break;
+        }
+        if (!secp256k1_ge_is_infinity(&points[i])) {
+            secp256k1_gej_set_ge(&pj, &points[i]);
+            secp256k1_ecmult(&ctx->ecmult_ctx, &tmp, &pj, &scalars[i], &zero);
+            secp256k1_gej_add_var(&expected, &expected, &tmp, NULL);
+        }
+    }
+    secp256k1_gej_neg(&expected, &expected);
+
+    secp256k1_ecmult_multi(&ctx->ecmult_ctx, scratch, &r, use_ng ? &ng : NULL, points, scalars, n);
+    secp256k1_gej_add_var(&tmp, &r, &expected, NULL);
+    CHECK(secp256k1_gej_is_infinity(&tmp));
+    CHECK(secp256k1_ecmult_strauss_multi(&ctx->ecmult_ctx, scratch, &r, use_ng ? &ng : NULL, points, scalars, n));
+    secp256k1_gej_add_var(&tmp, &r, &expected, NULL);
+    CHECK(secp256k1_gej_is_infinity(&tmp));
+    CHECK(secp256k1_ecmult_pippenger_multi(&ctx->ecmult_ctx, scratch, &r, use_ng ? &ng : NULL, points, scalars, n));
+    secp256k1_gej_add_var(&tmp, &r, &expected, NULL);
+    CHECK(secp256k1_gej_is_infinity(&tmp));
+    CHECK(secp256k1_scratch_checkpoint(scratch) == 0);
+
+    /* A scratch space with room for only a few points forces several batches, and none at all
+     * falls back to one multiplication per point. */
+    small = secp256k1_scratch_create(3 * secp256k1_ecmult_strauss_point_size() + (ECMULT_STRAUSS_SCRATCH_OBJECTS + 1) * SECP256K1_SCRATCH_ALIGNMENT);
+    CHECK(secp256k1_ecmult_strauss_max_points(small) >= 3);
+    secp256k1_ecmult_multi(&ctx->ecmult_ctx, small, &r, use_ng ? &ng : NULL, points, scalars, n);
+    secp256k1_gej_add_var(&tmp, &r, &expected, NULL);
+    CHECK(secp256k1_gej_is_infinity(&tmp));
+    if (secp256k1_ecmult_pippenger_scratch_size(n) > secp256k1_scratch_max_allocation(small, ECMULT_PIPPENGER_SCRATCH_OBJECTS)) {
+        CHECK(!secp256k1_ecmult_pippenger_multi(&ctx->ecmult_ctx, small, &r, use_ng ? &ng : NULL, points, scalars, n));
+    }
+    CHECK(secp256k1_scratch_checkpoint(small) == 0);
+    secp256k1_scratch_destroy(small);
+    secp256k1_ecmult_multi(&ctx->ecmult_ctx, NULL, &r, use_ng ? &ng : NULL, points, scalars, n);
+    secp256k1_gej_add_var(&tmp, &r, &expected, NULL);
+    CHECK(secp256k1_gej_is_infinity(&tmp));
+    secp256k1_scratch_destroy(scratch);
+}
+
+void run_ecmult_multi(void) {
+    int i;
+    size_t n;
+    for (n = 0; n <= 3; n++) {
+        test_ecmult_multi(n);
+    }
+    for (i = 0; i < count; i++) {
+        test_ecmult_multi(secp256k1_rand32() % 40);
+    }
+    test_ecmult_multi(ECMULT_PIPPENGER_THRESHOLD - 1);
+    test_ecmult_multi(ECMULT_PIPPENGER_THRESHOLD);
+    test_ecmult_multi(200);
+}
+
 void test_ecmult_gen_blind(void) {
     /* Test ecmult_gen() blinding and confirm that the blinding changes, the affline points match, and the z's don't match. */
     secp256k1_scalar_t key;
@@ -1633,11 +2702,107 @@ void test_ecmult_gen_blind_reset(void) {
     CHECK(gej_xyz_equals_gej(&initial, &ctx->ecmult_gen_ctx.initial));
 }
 
+void test_ecmult_gen_comb_entry(void) {
+    /* Entry i of block j holds sum(+-2^((j*COMB_TEETH + t)*COMB_SPACING) * G/2), with a positive sign for
+     * every tooth t whose bit is set in i (so the top tooth is always negative). */
+    secp256k1_scalar_t half, pow2, sum, zero;
+    secp256k1_gej_t expectedj;
+    secp256k1_ge_t expected, entry;
+    uint32_t block = secp256k1_rand32() % COMB_BLOCKS;
+    uint32_t index = secp256k1_rand32() % COMB_POINTS;
+    uint32_t k;
+    int tooth;
+
+    secp256k1_scalar_set_int(&half, 2);
+    secp256k1_scalar_inverse_var(&half, &half);
+    secp256k1_scalar_set_int(&zero, 0);
+    secp256k1_scalar_set_int(&sum, 0);
+    secp256k1_scalar_set_int(&pow2, 1);
+    for (k = 0; k < block * COMB_TEETH * COMB_SPACING; k++) {
+        secp256k1_scalar_add(&pow2, &pow2, &pow2);
+    }
+    for (tooth = 0; tooth < COMB_TEETH; tooth++) {
+        secp256k1_scalar_t term = pow2;
+        if (!((index >> tooth) & 1)) {
+            secp256k1_scalar_negate(&term, &term);
+        }
+        secp256k1_scalar_add(&sum, &sum, &term);
+        for (k = 0; k < COMB_SPACING; k++) {
+            secp256k1_scalar_add(&pow2, &pow2, &pow2);
+        }
+    }
+    secp256k1_scalar_mul(&sum, &sum, &half);
+    secp256k1_gej_set_ge(&expectedj, &secp256k1_ge_const_g);
+    secp256k1_ecmult(&ctx->ecmult_ctx, &expectedj, &expectedj, &zero, &sum);
+    secp256k1_ge_set_gej(&expected, &expectedj);
+    secp256k1_ge_from_storage(&entry, &(*ctx->ecmult_gen_ctx.prec)[block][index]);
+    ge_equals_ge(&expected, &entry);
+}
+
 void run_ecmult_gen_blind(void) {
     int i;
     test_ecmult_gen_blind_reset();
     for (i = 0; i < 10; i++) {
         test_ecmult_gen_blind();
+        test_ecmult_gen_comb_entry();
+    }
+}
+
+void test_ecmult_gen2_small_var(uint64_t value) {
+    secp256k1_gej_t ctj, varj;
+    secp256k1_ge_t ct, var;
+    secp256k1_ecmult_gen2_small(&ctx->ecmult_gen2_ctx, &ctj, value);
+    secp256k1_ecmult_gen2_small_var(&ctx->ecmult_gen2_ctx, &varj, value);
+    secp256k1_ge_set_gej(&ct, &ctj);
+    secp256k1_ge_set_gej(&var, &varj);
+    ge_equals_ge(&ct, &var);
+}
+
+void run_ecmult_gen2_small_var(void) {
+    int i;
+    test_ecmult_gen2_small_var(0);
+    test_ecmult_gen2_small_var(1);
+    test_ecmult_gen2_small_var(UINT64_MAX);
+    test_ecmult_gen2_small_var(((uint64_t)1) << 63);
+    test_ecmult_gen2_small_var((((uint64_t)1) << 63) - 1);
+    for (i = 0; i < 4 * count; i++) {
+        /* Random values of every magnitude, with runs of set bits that carry into the next window. */
+        uint64_t value = ((uint64_t)secp256k1_rand32() << 32) | secp256k1_rand32();
+        value >>= secp256k1_rand32() & 63;
+        if (secp256k1_rand32() & 1) {
+            value |= (((uint64_t)1) << ((secp256k1_rand32() & 63) + 1)) - 1;
+        }
+        test_ecmult_gen2_small_var(value);
+    }
+}
+
+void run_op_counters(void) {
+    secp256k1_op_counters counters;
+    secp256k1_scalar_t na, ng;
+    secp256k1_ge_t ge;
+    secp256k1_gej_t a, r;
+    int i;
+    random_scalar_order_test(&na);
+    random_scalar_order_test(&ng);
+    random_group_element_test(&ge);
+    random_group_element_jacobian_test(&a, &ge);
+    secp256k1_debug_get_counters(&counters, 1);
+    secp256k1_ecmult(&ctx->ecmult_ctx, &r, &a, &na, &ng);
+#ifdef ENABLE_OP_COUNTERS
+    CHECK(secp256k1_debug_get_counters(&counters, 1) == 1);
+    CHECK(counters.ecmult == 1);
+    CHECK(counters.ecmult_gen == 0);
+    CHECK(counters.gej_double_var > 0);
+    CHECK(counters.gej_add_var > 0);
+    CHECK(counters.fe_mul > counters.gej_add_var);
+    CHECK(counters.fe_sqr > 0);
+#else
+    CHECK(secp256k1_debug_get_counters(&counters, 1) == 0);
+#endif
+    /* After a reset (or without counters) everything reads as zero. */
+    secp256k1_debug_get_counters(&counters, 0);
+    for (i = 0; i < (int)(sizeof(counters) / sizeof(uint64_t)); i++) {
+        CHECK(((uint64_t *)&counters)[i] == 0);
     }
 }
 
@@ -1924,6 +3089,132 @@ void run_random_pubkeys(void) {
     }
 }
 
+void test_pubkey_parse_batch(void) {
+    unsigned char in[40][33];
+    const unsigned char *inp[40];
+    secp256k1_pubkey pubkeys[40];
+    secp256k1_pubkey pubkey;
+    int valid[40];
+    size_t n = secp256k1_rand32() % 40 + 1;
+    size_t i;
+    int all = 1;
+    int ret;
+
+    for (i = 0; i < n; i++) {
+        uint32_t r = secp256k1_rand32();
+        secp256k1_rand256(&in[i][1]);
+        in[i][0] = 2 + (r & 1);
+        if ((r & 30) == 0) {
+            /* Invalid header byte. */
+            in[i][0] = (r >> 5) & 0xFF;
+        } else if ((r & 30) == 2) {
+            /* X coordinate not below the field size. */
+            memset(&in[i][1], 0xFF, 32);
+        }
+        inp[i] = in[i];
+    }
+    ret = secp256k1_ec_pubkey_parse_batch(ctx, pubkeys, valid, inp, n);
+    for (i = 0; i < n; i++) {
+        int res = secp256k1_ec_pubkey_parse(ctx, &pubkey, in[i], 33);
+        CHECK(valid[i] == res);
+        CHECK(memcmp(&pubkeys[i], &pubkey, sizeof(pubkey)) == 0);
+        all &= res;
+    }
+    CHECK(ret == all);
+    CHECK(secp256k1_ec_pubkey_parse_batch(ctx, pubkeys, NULL, inp, n) == all);
+    CHECK(secp256k1_ec_pubkey_parse_batch(ctx, NULL, NULL, NULL, 0) == 1);
+}
+
+void test_pubkey_create_batch(void) {
+    unsigned char keys[40][32];
+    const unsigned char *keyp[40];
+    secp256k1_pubkey pubkeys[40];
+    secp256k1_pubkey pubkey;
+    secp256k1_scalar_t key;
+    size_t n = secp256k1_rand32() % 40 + 1;
+    size_t i;
+    int all = 1;
+    int ret;
+
+    for (i = 0; i < n; i++) {
+        uint32_t r = secp256k1_rand32();
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(keys[i], &key);
+        if ((r & 15) == 0) {
+            memset(keys[i], 0, 32);
+        } else if ((r & 15) == 1) {
+            memset(keys[i], 0xFF, 32);
+        }
+        keyp[i] = keys[i];
+    }
+    ret = secp256k1_ec_pubkey_create_batch(ctx, pubkeys, keyp, n);
+    for (i = 0; i < n; i++) {
+        int res = secp256k1_ec_pubkey_create_ex(ctx, &pubkey, keys[i]);
+        CHECK(memcmp(&pubkeys[i], &pubkey, sizeof(pubkey)) == 0);
+        all &= res;
+    }
+    CHECK(ret == all);
+    CHECK(secp256k1_ec_pubkey_create_batch(ctx, NULL, NULL, 0) == 1);
+}
+
+void test_pubkey_tweak_add_batch(void) {
+    unsigned char tweaks[40][32];
+    unsigned char seckey[32];
+    const unsigned char *tweakp[40];
+    secp256k1_pubkey pubkeys[40];
+    secp256k1_pubkey expected[40];
+    secp256k1_scalar_t key;
+    secp256k1_scalar_t tweak;
+    size_t n = secp256k1_rand32() % 40 + 1;
+    size_t i;
+    int all = 1;
+    int ret;
+
+    for (i = 0; i < n; i++) {
+        uint32_t r = secp256k1_rand32();
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(seckey, &key);
+        CHECK(secp256k1_ec_pubkey_create_ex(ctx, &pubkeys[i], seckey));
+        random_scalar_order_test(&tweak);
+        if ((r & 15) == 0) {
+            /* The tweak that cancels the key. */
+            secp256k1_scalar_negate(&tweak, &key);
+        } else if ((r & 15) == 1) {
+            secp256k1_scalar_clear(&tweak);
+        }
+        secp256k1_scalar_get_b32(tweaks[i], &tweak);
+        if ((r & 15) == 2) {
+            memset(tweaks[i], 0xFF, 32);
+        }
+        tweakp[i] = tweaks[i];
+    }
+    /* Deriving from one parent key is the common case. */
+    if (secp256k1_rand32() & 1) {
+        for (i = 1; i < n; i++) {
+            pubkeys[i] = pubkeys[0];
+        }
+    }
+    for (i = 0; i < n; i++) {
+        expected[i] = pubkeys[i];
+        all &= secp256k1_ec_pubkey_tweak_add_ex(ctx, &expected[i], tweaks[i]);
+    }
+    ret = secp256k1_ec_pubkey_tweak_add_batch(ctx, pubkeys, tweakp, n);
+    for (i = 0; i < n; i++) {
+        CHECK(memcmp(&pubkeys[i], &expected[i], sizeof(expected[i])) == 0);
+    }
+    CHECK(ret == all);
+    CHECK(secp256k1_ec_pubkey_tweak_add_batch(ctx, NULL, NULL, 0) == 1);
+}
+
+void run_pubkey_parse_batch(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_pubkey_parse_batch();
+        test_pubkey_create_batch();
+        test_pubkey_tweak_add_batch();
+    }
+}
+
 void run_ecdsa_end_to_end(void) {
     int i;
     for (i = 0; i < 64*count; i++) {
@@ -1931,6 +3222,579 @@ void run_ecdsa_end_to_end(void) {
     }
 }
 
+void test_ecdsa_verify_batch(void) {
+    secp256k1_ecdsa_signature sigs[70];
+    secp256k1_pubkey pubkeys[70];
+    unsigned char msgs[70][32];
+    const secp256k1_ecdsa_signature *sigptr[70];
+    const secp256k1_pubkey *pubkeyptr[70];
+    const unsigned char *msgptr[70];
+    unsigned char privkey[32];
+    secp256k1_scalar_t key;
+    size_t n = secp256k1_rand32() % 70 + 1;
+    size_t i, bad, first_invalid;
+
+    for (i = 0; i < n; i++) {
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msgs[i]);
+        CHECK(secp256k1_ec_pubkey_create_ex(ctx, &pubkeys[i], privkey) == 1);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sigs[i], msgs[i], privkey, NULL, NULL) == 1);
+        sigptr[i] = &sigs[i];
+        pubkeyptr[i] = &pubkeys[i];
+        msgptr[i] = msgs[i];
+    }
+
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, &first_invalid, sigptr, msgptr, pubkeyptr, 0) == 1);
+    CHECK(first_invalid == 0);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, &first_invalid, sigptr, msgptr, pubkeyptr, n) == 1);
+    CHECK(first_invalid == n);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, NULL, sigptr, msgptr, pubkeyptr, n) == 1);
+
+    /* DER signatures parse back to the same object; truncated ones do not parse. */
+    {
+        secp256k1_ecdsa_signature sig;
+        unsigned char der[72];
+        size_t derlen = sizeof(der);
+        CHECK(secp256k1_ecdsa_signature_serialize_der(ctx, der, &derlen, &sigs[0]) == 1);
+        CHECK(secp256k1_ecdsa_signature_parse_der(ctx, &sig, der, derlen) == 1);
+        CHECK(memcmp(&sig, &sigs[0], sizeof(sig)) == 0);
+        CHECK(secp256k1_ecdsa_signature_parse_der(ctx, &sig, der, secp256k1_rand32() % derlen) == 0);
+    }
+
+    /* A wrong message is reported at its own index, even with a later failure present. */
+    bad = secp256k1_rand32() % n;
+    msgs[bad][secp256k1_rand32() % 32] ^= 1 + (secp256k1_rand32() % 255);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, &first_invalid, sigptr, msgptr, pubkeyptr, n) == 0);
+    CHECK(first_invalid == bad);
+    CHECK(secp256k1_ecdsa_verify_ex(ctx, sigptr[bad], msgptr[bad], pubkeyptr[bad]) == 0);
+    if (bad + 1 < n) {
+        memset(&sigs[n - 1], 0, sizeof(sigs[n - 1]));
+        CHECK(secp256k1_ecdsa_verify_batch(ctx, &first_invalid, sigptr, msgptr, pubkeyptr, n) == 0);
+        CHECK(first_invalid == bad);
+    }
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, &first_invalid, sigptr, msgptr, pubkeyptr, bad) == 1);
+    CHECK(first_invalid == bad);
+
+    /* High-S and zero signatures are rejected at the right index. */
+    if (bad > 0) {
+        unsigned char sig64[64];
+        i = secp256k1_rand32() % bad;
+        CHECK(secp256k1_ecdsa_signature_serialize_compact(ctx, sig64, &sigs[i]) == 1);
+        if (secp256k1_rand32() & 1) {
+            secp256k1_scalar_t s;
+            secp256k1_scalar_set_b32(&s, &sig64[32], NULL);
+            secp256k1_scalar_negate(&s, &s);
+            secp256k1_scalar_get_b32(&sig64[32], &s);
+        } else {
+            memset(&sig64[32], 0, 32);
+        }
+        CHECK(secp256k1_ecdsa_signature_parse_compact(ctx, &sigs[i], sig64) == 1);
+        CHECK(secp256k1_ecdsa_verify_batch(ctx, &first_invalid, sigptr, msgptr, pubkeyptr, n) == 0);
+        CHECK(first_invalid == i);
+    }
+}
+
+void test_ecdsa_sign_keypair(void) {
+    secp256k1_keypair keypair, zero_keypair;
+    secp256k1_pubkey pubkey, pubkey2;
+    secp256k1_ecdsa_signature sig, sig2;
+    secp256k1_scalar_t key, nonce;
+    unsigned char privkey[32];
+    unsigned char msg[32];
+    unsigned char ndata[32];
+    int i;
+
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(privkey, &key);
+    CHECK(secp256k1_keypair_create(ctx, &keypair, privkey) == 1);
+    CHECK(secp256k1_keypair_pub(ctx, &pubkey, &keypair) == 1);
+    CHECK(secp256k1_ec_pubkey_create_ex(ctx, &pubkey2, privkey) == 1);
+    CHECK(memcmp(&pubkey, &pubkey2, sizeof(pubkey)) == 0);
+
+    for (i = 0; i < 4; i++) {
+        secp256k1_rand256_test(msg);
+        random_scalar_order_test(&nonce);
+        secp256k1_scalar_get_b32(ndata, &nonce);
+        /* The default nonce function, with and without extra data, through the cached midstate. */
+        CHECK(secp256k1_ecdsa_sign_keypair(ctx, &sig, msg, &keypair, NULL, NULL) == 1);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig2, msg, privkey, NULL, NULL) == 1);
+        CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+        CHECK(secp256k1_ecdsa_verify_ex(ctx, &sig, msg, &pubkey) == 1);
+        CHECK(secp256k1_ecdsa_sign_keypair(ctx, &sig, msg, &keypair, secp256k1_nonce_function_rfc6979, ndata) == 1);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig2, msg, privkey, secp256k1_nonce_function_rfc6979, ndata) == 1);
+        CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+        /* Other nonce functions are called as usual, including their retries and failures. */
+        CHECK(secp256k1_ecdsa_sign_keypair(ctx, &sig, msg, &keypair, nonce_function_test_retry, ndata) == 1);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig2, msg, privkey, nonce_function_test_retry, ndata) == 1);
+        CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+        CHECK(secp256k1_ecdsa_sign_keypair(ctx, &sig, msg, &keypair, nonce_function_test_fail, ndata) == 0);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig2, msg, privkey, nonce_function_test_fail, ndata) == 0);
+        CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+        CHECK(secp256k1_ecdsa_sign_keypair(ctx, &sig, msg, &keypair, precomputed_nonce_function, ndata) == 1);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig2, msg, privkey, precomputed_nonce_function, ndata) == 1);
+        CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+    }
+
+    /* Invalid secret keys give a zeroed keypair, which cannot sign. */
+    memset(privkey, 0, 32);
+    CHECK(secp256k1_keypair_create(ctx, &keypair, privkey) == 0);
+    memset(privkey, 0xFF, 32);
+    CHECK(secp256k1_keypair_create(ctx, &keypair, privkey) == 0);
+    memset(&zero_keypair, 0, sizeof(zero_keypair));
+    CHECK(memcmp(&keypair, &zero_keypair, sizeof(keypair)) == 0);
+    CHECK(secp256k1_ecdsa_sign_keypair(ctx, &sig, msg, &keypair, NULL, NULL) == 0);
+    memset(&sig2, 0, sizeof(sig2));
+    CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+}
+
+void test_ecdsa_sign_batch(void) {
+    secp256k1_ecdsa_signature sigs[70];
+    secp256k1_ecdsa_signature sig;
+    unsigned char msgs[70][32];
+    unsigned char keys[70][32];
+    const unsigned char *msgptr[70];
+    const unsigned char *keyptr[70];
+    int valid[70];
+    secp256k1_scalar_t key;
+    size_t n = secp256k1_rand32() % 70 + 1;
+    size_t i, bad = n;
+
+    for (i = 0; i < n; i++) {
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(keys[i], &key);
+        secp256k1_rand256_test(msgs[i]);
+        msgptr[i] = msgs[i];
+        keyptr[i] = keys[i];
+    }
+    if (secp256k1_rand32() & 1) {
+        /* One invalid key only affects its own entry. */
+        bad = secp256k1_rand32() % n;
+        memset(keys[bad], (secp256k1_rand32() & 1) ? 0xFF : 0, 32);
+    }
+
+    CHECK(secp256k1_ecdsa_sign_batch(ctx, sigs, valid, msgptr, keyptr, 0) == 1);
+    CHECK(secp256k1_ecdsa_sign_batch(ctx, sigs, valid, msgptr, keyptr, n) == (bad == n));
+    for (i = 0; i < n; i++) {
+        CHECK(valid[i] == (i != bad));
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig, msgs[i], keys[i], NULL, NULL) == valid[i]);
+        CHECK(memcmp(&sig, &sigs[i], sizeof(sig)) == 0);
+    }
+    CHECK(secp256k1_ecdsa_sign_batch(ctx, sigs, NULL, msgptr, keyptr, n) == (bad == n));
+}
+
+void test_ecdsa_sign_batch_retry(void) {
+    /* Keys whose first RFC6979 nonce fails are infeasible to find, so check directly that an entry of
+     * the batch core can fail (here with s = 0) without affecting the others. */
+    secp256k1_ecdsa_sig_t sigs[2];
+    secp256k1_scalar_t sec[2], msg[2], non[2], blind;
+    int ok[2];
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        random_scalar_order_test(&sec[i]);
+        random_scalar_order_test(&msg[i]);
+        do {
+            random_scalar_order_test(&non[i]);
+        } while (secp256k1_scalar_is_zero(&non[i]));
+    }
+    do {
+        random_scalar_order_test(&blind);
+    } while (secp256k1_scalar_is_zero(&blind));
+    secp256k1_ecdsa_sig_sign_batch(&ctx->ecmult_gen_ctx, sigs, ok, sec, msg, non, &blind, 2);
+    CHECK(ok[0] && ok[1]);
+    /* s = 0 when m = -r * sec. */
+    secp256k1_scalar_mul(&msg[1], &sigs[1].r, &sec[1]);
+    secp256k1_scalar_negate(&msg[1], &msg[1]);
+    secp256k1_ecdsa_sig_sign_batch(&ctx->ecmult_gen_ctx, sigs, ok, sec, msg, non, &blind, 2);
+    CHECK(ok[0] && !ok[1]);
+    for (i = 0; i < 2; i++) {
+        secp256k1_ecdsa_sig_t sig;
+        CHECK(secp256k1_ecdsa_sig_sign(&ctx->ecmult_gen_ctx, &sig, &sec[i], &msg[i], &non[i], NULL) == ok[i]);
+        if (ok[i]) {
+            CHECK(secp256k1_scalar_eq(&sig.r, &sigs[i].r));
+            CHECK(secp256k1_scalar_eq(&sig.s, &sigs[i].s));
+        }
+    }
+}
+
+void run_ecdsa_sign_batch(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_sign_batch();
+        test_ecdsa_sign_batch_retry();
+    }
+}
+
+void run_ecdsa_sign_keypair(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_sign_keypair();
+    }
+}
+
+void run_ecdsa_verify_batch(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_verify_batch();
+    }
+}
+
+/* Append a lax DER length of len to buf at *pos, in long form with leading zeroes if requested. */
+static void test_lax_der_len(unsigned char *buf, size_t *pos, size_t len, int longform) {
+    int zeroes = secp256k1_rand32() % 3;
+    if (!longform) {
+        buf[(*pos)++] = len;
+        return;
+    }
+    buf[(*pos)++] = 0x80 + zeroes + 1 + (len > 255);
+    while (zeroes-- > 0) {
+        buf[(*pos)++] = 0;
+    }
+    if (len > 255) {
+        buf[(*pos)++] = len >> 8;
+    }
+    buf[(*pos)++] = len & 0xFF;
+}
+
+void test_ecdsa_der_parse_lax(void) {
+    unsigned char buf[8 * 200];
+    unsigned char sig64[64];
+    unsigned char msg[32];
+    unsigned char privkey[32];
+    secp256k1_ecdsa_signature sig, sig2, zero;
+    secp256k1_ecdsa_signature sigs[8], expected[8];
+    secp256k1_scalar_t key;
+    size_t offsets[8], lens[8];
+    int valid[8];
+    size_t pos, n, i, bad;
+    int j, k;
+
+    memset(&zero, 0, sizeof(zero));
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(privkey, &key);
+    secp256k1_rand256_test(msg);
+    CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig, msg, privkey, NULL, NULL) == 1);
+    CHECK(secp256k1_ecdsa_signature_serialize_compact(ctx, sig64, &sig) == 1);
+
+    /* Build an encoding with random lax violations: padded integers, long-form lengths, a wrong
+     * sequence length and trailing garbage. */
+    pos = 0;
+    buf[pos++] = 0x30;
+    k = secp256k1_rand32() % 300;
+    test_lax_der_len(buf, &pos, k, k > 127 || (secp256k1_rand32() & 1));
+    for (j = 0; j < 2; j++) {
+        int pad = secp256k1_rand32() % 41;
+        int len = pad + 32;
+        int skip = 0;
+        if ((secp256k1_rand32() & 3) == 0) {
+            /* Drop the leading zero bytes of this integer instead. */
+            while (skip < 32 && sig64[32 * j + skip] == 0) {
+                skip++;
+            }
+            pad = 0;
+            len = 32 - skip;
+        }
+        buf[pos++] = 0x02;
+        test_lax_der_len(buf, &pos, len, len > 127 || (secp256k1_rand32() & 1));
+        for (k = 0; k < pad; k++) {
+            buf[pos++] = 0;
+        }
+        memcpy(buf + pos, sig64 + 32 * j + skip, 32 - skip);
+        pos += 32 - skip;
+    }
+    for (k = secp256k1_rand32() % 16; k > 0; k--) {
+        buf[pos++] = secp256k1_rand32();
+    }
+    CHECK(secp256k1_ecdsa_signature_parse_der_lax(ctx, &sig2, buf, pos) == 1);
+    CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+    /* Truncating it into the integers makes it fail. */
+    CHECK(secp256k1_ecdsa_signature_parse_der_lax(ctx, &sig2, buf, secp256k1_rand32() % 40) == 0);
+    CHECK(memcmp(&sig2, &zero, sizeof(zero)) == 0);
+
+    /* Integers that do not fit parse as a zero signature, which does not verify. */
+    pos = 0;
+    buf[pos++] = 0x30;
+    buf[pos++] = 0x45;
+    buf[pos++] = 0x02;
+    buf[pos++] = 0x21;
+    buf[pos++] = 0x01;
+    memcpy(buf + pos, sig64, 32);
+    pos += 32;
+    buf[pos++] = 0x02;
+    buf[pos++] = 0x20;
+    memcpy(buf + pos, sig64 + 32, 32);
+    pos += 32;
+    CHECK(secp256k1_ecdsa_signature_parse_der(ctx, &sig2, buf, pos) == 0);
+    CHECK(secp256k1_ecdsa_signature_parse_der_lax(ctx, &sig2, buf, pos) == 1);
+    CHECK(memcmp(&sig2, &zero, sizeof(zero)) == 0);
+    buf[4] = 0;
+    memset(buf + 5, 0xFF, 32);
+    CHECK(secp256k1_ecdsa_signature_parse_der(ctx, &sig2, buf, pos) == 0);
+    CHECK(secp256k1_ecdsa_signature_parse_der_lax(ctx, &sig2, buf, pos) == 1);
+    CHECK(memcmp(&sig2, &zero, sizeof(zero)) == 0);
+
+    /* Signatures scattered through one buffer parse in place. */
+    n = secp256k1_rand32() % 8 + 1;
+    pos = 0;
+    for (i = 0; i < n; i++) {
+        secp256k1_rand256_test(msg);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &expected[i], msg, privkey, NULL, NULL) == 1);
+        pos += secp256k1_rand32() % 16;
+        offsets[i] = pos;
+        lens[i] = 72;
+        CHECK(secp256k1_ecdsa_signature_serialize_der(ctx, buf + pos, &lens[i], &expected[i]) == 1);
+        pos += lens[i];
+    }
+    CHECK(secp256k1_ecdsa_signature_parse_der_batch(ctx, sigs, valid, buf, offsets, lens, n, secp256k1_rand32() & 1) == 1);
+    for (i = 0; i < n; i++) {
+        CHECK(valid[i] == 1);
+        CHECK(memcmp(&sigs[i], &expected[i], sizeof(sigs[i])) == 0);
+    }
+    bad = secp256k1_rand32() % n;
+    buf[offsets[bad]] = 0x31;
+    CHECK(secp256k1_ecdsa_signature_parse_der_batch(ctx, sigs, valid, buf, offsets, lens, n, secp256k1_rand32() & 1) == 0);
+    for (i = 0; i < n; i++) {
+        CHECK(valid[i] == (i != bad));
+        CHECK(memcmp(&sigs[i], i == bad ? &zero : &expected[i], sizeof(sigs[i])) == 0);
+    }
+    CHECK(secp256k1_ecdsa_signature_parse_der_batch(ctx, sigs, NULL, buf, offsets, lens, n, 0) == 0);
+    CHECK(secp256k1_ecdsa_signature_parse_der_batch(ctx, NULL, NULL, NULL, NULL, NULL, 0, 0) == 1);
+}
+
+void run_ecdsa_der_parse_lax(void) {
+    int i;
+    for (i = 0; i < 16*count; i++) {
+        test_ecdsa_der_parse_lax();
+    }
+}
+
+void test_ecdsa_verify_precomp(void) {
+    secp256k1_ecdsa_signature sig;
+    secp256k1_pubkey pubkey;
+    secp256k1_pubkey_precomp *precomp;
+    secp256k1_ecmult_point_table_t table;
+    secp256k1_gej_t pj, r1, r2;
+    secp256k1_ge_t p;
+    unsigned char privkey[32];
+    unsigned char msg[32];
+    unsigned char sig64[64];
+    secp256k1_scalar_t key, na, ng;
+    int i;
+
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(privkey, &key);
+    CHECK(secp256k1_ec_pubkey_create_ex(ctx, &pubkey, privkey) == 1);
+    precomp = secp256k1_pubkey_precomp_create(ctx, &pubkey);
+    CHECK(precomp != NULL);
+
+    for (i = 0; i < 4; i++) {
+        secp256k1_rand256_test(msg);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig, msg, privkey, NULL, NULL) == 1);
+        CHECK(secp256k1_ecdsa_verify_precomp(ctx, &sig, msg, precomp) == 1);
+        msg[secp256k1_rand32() % 32] ^= 1 + (secp256k1_rand32() % 255);
+        CHECK(secp256k1_ecdsa_verify_precomp(ctx, &sig, msg, precomp) == 0);
+        CHECK(secp256k1_ecdsa_verify_ex(ctx, &sig, msg, &pubkey) == 0);
+    }
+
+    /* High-S signatures are rejected, like by secp256k1_ecdsa_verify_ex. */
+    secp256k1_rand256_test(msg);
+    CHECK(secp256k1_ecdsa_sign_ex(ctx, &sig, msg, privkey, NULL, NULL) == 1);
+    CHECK(secp256k1_ecdsa_signature_serialize_compact(ctx, sig64, &sig) == 1);
+    secp256k1_scalar_set_b32(&na, &sig64[32], NULL);
+    secp256k1_scalar_negate(&na, &na);
+    secp256k1_scalar_get_b32(&sig64[32], &na);
+    CHECK(secp256k1_ecdsa_signature_parse_compact(ctx, &sig, sig64) == 1);
+    CHECK(secp256k1_ecdsa_verify_precomp(ctx, &sig, msg, precomp) == 0);
+    secp256k1_pubkey_precomp_destroy(precomp);
+    secp256k1_pubkey_precomp_destroy(NULL);
+
+    /* The table gives the same results as secp256k1_ecmult, including for zero scalars. */
+    random_group_element_test(&p);
+    secp256k1_gej_set_ge(&pj, &p);
+    secp256k1_ecmult_point_table_build(&table, &p);
+    for (i = 0; i < 4; i++) {
+        random_scalar_order_test(&na);
+        random_scalar_order_test(&ng);
+        if (i == 1) {
+            secp256k1_scalar_set_int(&na, 0);
+        } else if (i == 2) {
+            secp256k1_scalar_set_int(&ng, 0);
+        }
+        secp256k1_ecmult(&ctx->ecmult_ctx, &r1, &pj, &na, &ng);
+        secp256k1_ecmult_point(&ctx->ecmult_ctx, &r2, &table, &na, &ng);
+        secp256k1_gej_neg(&r2, &r2);
+        secp256k1_gej_add_var(&r1, &r1, &r2, NULL);
+        CHECK(secp256k1_gej_is_infinity(&r1));
+    }
+}
+
+void run_ecdsa_verify_precomp(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_verify_precomp();
+    }
+}
+
+void run_cuckoo_tests(void) {
+    secp256k1_cuckoo_t set;
+    unsigned char keys[64][32];
+    int i, found = 0;
+
+    /* Below capacity every key fits, and keys that were never added are not found. */
+    secp256k1_cuckoo_init(&set, 256);
+    for (i = 0; i < 64; i++) {
+        secp256k1_rand256(keys[i]);
+        CHECK(!secp256k1_cuckoo_contains(&set, keys[i]));
+        secp256k1_cuckoo_insert(&set, keys[i]);
+        CHECK(secp256k1_cuckoo_contains(&set, keys[i]));
+    }
+    for (i = 0; i < 64; i++) {
+        CHECK(secp256k1_cuckoo_contains(&set, keys[i]));
+        keys[i][secp256k1_rand32() % 32] ^= 1 + (secp256k1_rand32() % 255);
+        CHECK(!secp256k1_cuckoo_contains(&set, keys[i]));
+    }
+    secp256k1_cuckoo_clear(&set);
+
+    /* A full set evicts keys, but keeps the most recent one. */
+    secp256k1_cuckoo_init(&set, 16);
+    for (i = 0; i < 64; i++) {
+        secp256k1_rand256(keys[i]);
+        secp256k1_cuckoo_insert(&set, keys[i]);
+        CHECK(secp256k1_cuckoo_contains(&set, keys[i]));
+    }
+    for (i = 0; i < 64; i++) {
+        found += secp256k1_cuckoo_contains(&set, keys[i]);
+    }
+    CHECK(found > 0 && found <= 16);
+    secp256k1_cuckoo_clear(&set);
+}
+
+void test_ecdsa_verify_cached(void) {
+    secp256k1_sigcache *cache;
+    secp256k1_ecdsa_signature sigs[8];
+    secp256k1_pubkey pubkey;
+    unsigned char msgs[8][32];
+    unsigned char privkey[32];
+    unsigned char seed[32];
+    secp256k1_scalar_t key;
+    size_t hits, misses;
+    int i;
+
+    secp256k1_rand256(seed);
+    CHECK(secp256k1_sigcache_create(ctx, 0, seed) == NULL);
+    cache = secp256k1_sigcache_create(ctx, 64, seed);
+    CHECK(cache != NULL);
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(privkey, &key);
+    CHECK(secp256k1_ec_pubkey_create_ex(ctx, &pubkey, privkey) == 1);
+    for (i = 0; i < 8; i++) {
+        secp256k1_rand256_test(msgs[i]);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sigs[i], msgs[i], privkey, NULL, NULL) == 1);
+    }
+
+    /* The first verification of each signature misses, the second one hits. */
+    for (i = 0; i < 8; i++) {
+        CHECK(secp256k1_ecdsa_verify_cached(ctx, cache, &sigs[i], msgs[i], &pubkey) == 1);
+    }
+    for (i = 0; i < 8; i++) {
+        CHECK(secp256k1_ecdsa_verify_cached(ctx, cache, &sigs[i], msgs[i], &pubkey) == 1);
+    }
+    secp256k1_sigcache_get_stats(cache, &hits, &misses);
+    CHECK(hits == 8 && misses == 8);
+
+    /* Invalid signatures are rejected, and are not added. */
+    msgs[0][secp256k1_rand32() % 32] ^= 1 + (secp256k1_rand32() % 255);
+    CHECK(secp256k1_ecdsa_verify_cached(ctx, cache, &sigs[0], msgs[0], &pubkey) == 0);
+    CHECK(secp256k1_ecdsa_verify_cached(ctx, cache, &sigs[1], msgs[0], &pubkey) == 0);
+    CHECK(secp256k1_ecdsa_verify_cached(ctx, cache, &sigs[0], msgs[0], &pubkey) == 0);
+    secp256k1_sigcache_get_stats(cache, &hits, NULL);
+    secp256k1_sigcache_get_stats(cache, NULL, &misses);
+    CHECK(hits == 8 && misses == 11);
+
+    /* Another salt gives another cache. */
+    secp256k1_sigcache_destroy(cache);
+    seed[0] ^= 1;
+    cache = secp256k1_sigcache_create(ctx, 64, seed);
+    CHECK(secp256k1_ecdsa_verify_cached(ctx, cache, &sigs[1], msgs[1], &pubkey) == 1);
+    secp256k1_sigcache_get_stats(cache, &hits, &misses);
+    CHECK(hits == 0 && misses == 1);
+    secp256k1_sigcache_destroy(cache);
+    secp256k1_sigcache_destroy(NULL);
+}
+
+void run_ecdsa_verify_cached(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_verify_cached();
+    }
+}
+
+void test_ecdsa_recover_batch(void) {
+    unsigned char sigs[70][64];
+    unsigned char msgs[70][32];
+    const unsigned char *sigptr[70];
+    const unsigned char *msgptr[70];
+    int recids[70];
+    int valid[70];
+    secp256k1_pubkey pubkeys[70];
+    unsigned char privkey[32];
+    secp256k1_scalar_t key;
+    size_t n = secp256k1_rand32() % 70 + 1;
+    size_t i;
+    int all = 1;
+    int ret;
+
+    for (i = 0; i < n; i++) {
+        uint32_t r = secp256k1_rand32();
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msgs[i]);
+        CHECK(secp256k1_ecdsa_sign_compact(ctx, msgs[i], sigs[i], privkey, NULL, NULL, &recids[i]) == 1);
+        if ((r & 15) == 0) {
+            /* Another recovery id, which usually recovers a different key or fails. */
+            recids[i] = (r >> 4) & 3;
+        } else if ((r & 15) == 1) {
+            memset(&sigs[i][32 * ((r >> 4) & 1)], 0xFF, 32);
+        } else if ((r & 15) == 2) {
+            memset(sigs[i], 0, 32);
+        } else if ((r & 15) == 3) {
+            secp256k1_rand256(sigs[i]);
+        }
+        sigptr[i] = sigs[i];
+        msgptr[i] = msgs[i];
+    }
+
+    ret = secp256k1_ecdsa_recover_batch(ctx, pubkeys, valid, sigptr, recids, msgptr, n);
+    for (i = 0; i < n; i++) {
+        unsigned char pubkey[33], pubkeyb[33];
+        int pubkeylen = 33;
+        size_t pubkeyblen = 33;
+        int res = secp256k1_ecdsa_recover_compact(ctx, msgs[i], sigs[i], pubkey, &pubkeylen, 1, recids[i]);
+        CHECK(valid[i] == res);
+        if (res) {
+            CHECK(secp256k1_ec_pubkey_serialize(ctx, pubkeyb, &pubkeyblen, &pubkeys[i], SECP256K1_EC_COMPRESSED) == 1);
+            CHECK(pubkeyblen == 33);
+            CHECK(memcmp(pubkey, pubkeyb, 33) == 0);
+        } else {
+            secp256k1_pubkey zero;
+            memset(&zero, 0, sizeof(zero));
+            CHECK(memcmp(&pubkeys[i], &zero, sizeof(zero)) == 0);
+        }
+        all &= res;
+    }
+    CHECK(ret == all);
+    CHECK(secp256k1_ecdsa_recover_batch(ctx, pubkeys, NULL, sigptr, recids, msgptr, n) == all);
+    CHECK(secp256k1_ecdsa_recover_batch(ctx, NULL, NULL, NULL, NULL, NULL, 0) == 1);
+}
+
+void run_ecdsa_recover_batch(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_recover_batch();
+    }
+}
+
 /* Tests several edge cases. */
 void test_ecdsa_edge_cases(void) {
     const unsigned char msg32[32] = {
@@ -1973,6 +3837,23 @@ void test_ecdsa_edge_cases(void) {
     CHECK(secp256k1_ecdsa_recover_compact(ctx, msg32, sig64, pubkey, &pubkeylen, 0, 1));
     CHECK(!secp256k1_ecdsa_recover_compact(ctx, msg32, sig64, pubkey, &pubkeylen, 0, 2));
     CHECK(!secp256k1_ecdsa_recover_compact(ctx, msg32, sig64, pubkey, &pubkeylen, 0, 3));
+    {
+        /* The same signatures recovered as one batch. */
+        const unsigned char *sigs[8];
+        const unsigned char *msgs[8];
+        int recids[8];
+        secp256k1_pubkey pubkeys[8];
+        int valid[8];
+        for (recid = 0; recid < 8; recid++) {
+            sigs[recid] = recid < 4 ? sig64 : sigb64;
+            msgs[recid] = msg32;
+            recids[recid] = recid & 3;
+        }
+        CHECK(secp256k1_ecdsa_recover_batch(ctx, pubkeys, valid, sigs, recids, msgs, 8) == 0);
+        CHECK(!valid[0] && valid[1] && !valid[2] && !valid[3]);
+        CHECK(valid[4] && valid[5] && valid[6] && valid[7]);
+        CHECK(secp256k1_ecdsa_recover_batch(ctx, pubkeys, valid, &sigs[4], &recids[4], &msgs[4], 4) == 1);
+    }
 
     for (recid = 0; recid < 4; recid++) {
         int i;
@@ -2311,6 +4192,10 @@ void test_pedersen(void) {
     const unsigned char *cptr[19];
     unsigned char blinds[32*19];
     const unsigned char *bptr[19];
+    unsigned char bcommits[33*19];
+    unsigned char *bcptr[19];
+    secp256k1_pedersen_commitment parsed[19];
+    const secp256k1_pedersen_commitment *pptr[19];
     secp256k1_scalar_t s;
     uint64_t values[19];
     int64_t totalv;
@@ -2355,8 +4240,33 @@ void test_pedersen(void) {
     for (i = 0; i < total; i++) {
         CHECK(secp256k1_pedersen_commit(ctx, &commits[i * 33], &blinds[i * 32], values[i]));
     }
+    for (i = 0; i < total; i++) {
+        bcptr[i] = &bcommits[i * 33];
+    }
+    CHECK(secp256k1_pedersen_commit_batch(ctx, bcptr, bptr, values, total));
+    CHECK(memcmp(bcommits, commits, 33 * total) == 0);
+    /* An overflowing blinding factor fails only its own commitment. */
+    memset(&blinds[18 * 32], 0xFF, 32);
+    bptr[total] = bptr[18];
+    values[total] = 0;
+    bcptr[total] = &bcommits[total * 33];
+    CHECK(!secp256k1_pedersen_commit_batch(ctx, bcptr, bptr, values, total + 1));
+    CHECK(memcmp(bcommits, commits, 33 * total) == 0);
+    for (i = 0; i < 33; i++) {
+        CHECK(bcommits[total * 33 + i] == 0);
+    }
+    bptr[total] = &blinds[total * 32];
     CHECK(secp256k1_pedersen_verify_tally(ctx, cptr, inputs, &cptr[inputs], outputs, totalv));
     CHECK(!secp256k1_pedersen_verify_tally(ctx, cptr, inputs, &cptr[inputs], outputs, totalv + 1));
+    for (i = 0; i < total; i++) {
+        unsigned char ser[33];
+        CHECK(secp256k1_pedersen_commitment_parse(ctx, &parsed[i], cptr[i]));
+        CHECK(secp256k1_pedersen_commitment_serialize(ctx, ser, &parsed[i]));
+        CHECK(memcmp(ser, cptr[i], 33) == 0);
+        pptr[i] = &parsed[i];
+    }
+    CHECK(secp256k1_pedersen_verify_tally_ex(ctx, pptr, inputs, &pptr[inputs], outputs, totalv));
+    CHECK(!secp256k1_pedersen_verify_tally_ex(ctx, pptr, inputs, &pptr[inputs], outputs, totalv + 1));
     random_scalar_order(&s);
     for (i = 0; i < 4; i++) {
         secp256k1_scalar_get_b32(&blinds[i * 32], &s);
@@ -2375,37 +4285,139 @@ void test_pedersen(void) {
     CHECK(secp256k1_pedersen_verify_tally(ctx, &cptr[1], 1, &cptr[0], 1, -INT64_MAX));
 }
 
+void test_pedersen_blind_sum_batch(void) {
+    static unsigned char blinds[600 * 32];
+    const unsigned char *bptr[600];
+    unsigned char negative[75];
+    unsigned char sum[32];
+    unsigned char sum2[32];
+    unsigned char zero[32];
+    secp256k1_scalar_t s;
+    int n = secp256k1_rand32() % 600;
+    int npositive;
+    int i;
+    int j;
+    int k;
+
+    secp256k1_rand256(negative);
+    secp256k1_rand256(&negative[32]);
+    secp256k1_rand256(&negative[43]);
+    for (i = 0; i < n; i++) {
+        random_scalar_order(&s);
+        secp256k1_scalar_get_b32(&blinds[i * 32], &s);
+    }
+    /* The same sum, with the positive factors put first for secp256k1_pedersen_blind_sum. */
+    npositive = 0;
+    for (i = 0; i < n; i++) {
+        npositive += !((negative[i >> 3] >> (i & 7)) & 1);
+    }
+    j = 0;
+    k = npositive;
+    for (i = 0; i < n; i++) {
+        if ((negative[i >> 3] >> (i & 7)) & 1) {
+            bptr[k++] = &blinds[i * 32];
+        } else {
+            bptr[j++] = &blinds[i * 32];
+        }
+    }
+    CHECK(secp256k1_pedersen_blind_sum_batch(ctx, sum, blinds, n, negative));
+    CHECK(secp256k1_pedersen_blind_sum(ctx, sum2, bptr, n, npositive));
+    CHECK(memcmp(sum, sum2, 32) == 0);
+    CHECK(secp256k1_pedersen_blind_sum_batch(ctx, sum, blinds, n, NULL));
+    CHECK(secp256k1_pedersen_blind_sum(ctx, sum2, bptr, n, n));
+    CHECK(memcmp(sum, sum2, 32) == 0);
+    memset(zero, 0, 32);
+    CHECK(secp256k1_pedersen_blind_sum_batch(ctx, sum, blinds, 0, negative));
+    CHECK(memcmp(sum, zero, 32) == 0);
+    /* A factor that is not below the order fails the sum. */
+    if (n > 0) {
+        memset(&blinds[(n - 1) * 32], 0xFF, 32);
+        CHECK(!secp256k1_pedersen_blind_sum_batch(ctx, sum, blinds, n, negative));
+    }
+}
+
 void run_pedersen(void) {
     int i;
     for (i = 0; i < 10*count; i++) {
         test_pedersen();
     }
+    for (i = 0; i < count; i++) {
+        test_pedersen_blind_sum_batch();
+    }
+}
+
+void test_pedersen_tally_large(void) {
+    /* Enough commitments for several chunks and rounds of affine additions, with a repeated
+     * commitment so that equal points meet in the tree. */
+    static unsigned char commits[600][33];
+    static secp256k1_pedersen_commitment parsed[600];
+    const unsigned char *cptr[600];
+    const secp256k1_pedersen_commitment *pptr[600];
+    unsigned char blinds[2][32];
+    const unsigned char *bptr[599];
+    secp256k1_scalar_t s;
+    int total = 300 + secp256k1_rand32() % 300;
+    int i;
+
+    random_scalar_order(&s);
+    secp256k1_scalar_get_b32(blinds[0], &s);
+    for (i = 0; i < total - 1; i++) {
+        bptr[i] = blinds[0];
+    }
+    /* All but the last commitment are equal and positive; the last one is negative and balances
+     * their blinding factors. */
+    CHECK(secp256k1_pedersen_blind_sum(ctx, blinds[1], bptr, total - 1, total - 1));
+    CHECK(secp256k1_pedersen_commit(ctx, commits[0], blinds[0], 3));
+    CHECK(secp256k1_pedersen_commit(ctx, commits[total - 1], blinds[1], 0));
+    for (i = 0; i < total; i++) {
+        if (i > 0 && i < total - 1) {
+            memcpy(commits[i], commits[0], 33);
+        }
+        cptr[i] = commits[i];
+        CHECK(secp256k1_pedersen_commitment_parse(ctx, &parsed[i], commits[i]));
+        pptr[i] = &parsed[i];
+    }
+    CHECK(secp256k1_pedersen_verify_tally(ctx, cptr, total - 1, &cptr[total - 1], 1, 3 * (int64_t)(total - 1)));
+    CHECK(!secp256k1_pedersen_verify_tally(ctx, cptr, total - 1, &cptr[total - 1], 1, 3 * (int64_t)total));
+    CHECK(secp256k1_pedersen_verify_tally_ex(ctx, pptr, total - 1, &pptr[total - 1], 1, 3 * (int64_t)(total - 1)));
+    CHECK(!secp256k1_pedersen_verify_tally_ex(ctx, pptr, total - 1, &pptr[total - 1], 1, 3 * (int64_t)total));
+}
+
+void run_pedersen_tally_large(void) {
+    int i;
+    for (i = 0; i < 2; i++) {
+        test_pedersen_tally_large();
+    }
 }
 
 void test_borromean(void) {
     unsigned char e0[32];
     secp256k1_scalar_t s[64];
     secp256k1_gej_t pubs[64];
-    secp256k1_scalar_t k[8];
-    secp256k1_scalar_t sec[8];
+    secp256k1_scalar_t k[40];
+    secp256k1_scalar_t sec[40];
     secp256k1_ge_t ge;
     secp256k1_scalar_t one;
     unsigned char m[32];
-    int rsizes[8];
-    int secidx[8];
+    int rsizes[40];
+    int secidx[40];
     int nrings;
     int i;
     int j;
     int c;
     secp256k1_rand256_test(m);
     nrings = 1 + (secp256k1_rand32()&7);
+    if ((secp256k1_rand32()&3) == 0) {
+        /* More rings than verification keeps on the stack, each with a single key. */
+        nrings = 33 + (secp256k1_rand32()&7);
+    }
     c = 0;
     secp256k1_scalar_set_int(&one, 1);
     if (secp256k1_rand32()&1) {
         secp256k1_scalar_negate(&one, &one);
     }
     for (i = 0; i < nrings; i++) {
-        rsizes[i] = 1 + (secp256k1_rand32()&7);
+        rsizes[i] = nrings > 8 ? 1 : 1 + (secp256k1_rand32()&7);
         secidx[i] = secp256k1_rand32() % rsizes[i];
         random_scalar_order(&sec[i]);
         random_scalar_order(&k[i]);
@@ -2447,10 +4459,38 @@ void test_borromean(void) {
     }
 }
 
+void test_rangeproof_peek(const unsigned char *proof, int len) {
+    int exp, exp2;
+    int mantissa, mantissa2;
+    uint64_t minv, minv2;
+    uint64_t maxv, maxv2;
+    int plen;
+    int i;
+    CHECK(secp256k1_rangeproof_info(ctx, &exp, &mantissa, &minv, &maxv, proof, len));
+    CHECK(secp256k1_rangeproof_peek(ctx, &exp2, &mantissa2, &minv2, &maxv2, &plen, proof, SECP256K1_RANGEPROOF_HEADER_MAX_SIZE));
+    CHECK(exp2 == exp && mantissa2 == mantissa && minv2 == minv && maxv2 == maxv);
+    CHECK(plen == len);
+    /* Once a prefix suffices, every longer one gives the same answer. */
+    for (i = 0; i <= SECP256K1_RANGEPROOF_HEADER_MAX_SIZE; i++) {
+        if (secp256k1_rangeproof_peek(ctx, &exp2, &mantissa2, &minv2, &maxv2, &plen, proof, i)) {
+            break;
+        }
+    }
+    CHECK(i > 0 && i <= SECP256K1_RANGEPROOF_HEADER_MAX_SIZE);
+    for (; i <= len; i += 1 + i * 3) {
+        CHECK(secp256k1_rangeproof_peek(ctx, &exp2, &mantissa2, &minv2, &maxv2, &plen, proof, i));
+        CHECK(exp2 == exp && mantissa2 == mantissa && minv2 == minv && maxv2 == maxv);
+        CHECK(plen == len);
+    }
+}
+
 void test_rangeproof(void) {
     const uint64_t testvs[11] = {0, 1, 5, 11, 65535, 65537, INT32_MAX, UINT32_MAX, INT64_MAX - 1, INT64_MAX, UINT64_MAX};
     unsigned char commit[33];
     unsigned char commit2[33];
+    unsigned char commit3[33];
+    secp256k1_pedersen_commitment pcommit;
+    secp256k1_rangeproof_cost cost;
     unsigned char proof[5134];
     unsigned char blind[32];
     unsigned char blindout[32];
@@ -2465,6 +4505,9 @@ void test_rangeproof(void) {
     int i;
     int j;
     int k;
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, SECP256K1_RANGEPROOF_SCRATCH_SIZE);
+    secp256k1_scratch_space *small = secp256k1_scratch_space_create(ctx, SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE - 1);
+    CHECK(SECP256K1_RANGEPROOF_VERIFY_SCRATCH_SIZE <= SECP256K1_RANGEPROOF_SCRATCH_SIZE);
     secp256k1_rand256(blind);
     for (i = 0; i < 11; i++) {
         v = testvs[i];
@@ -2486,6 +4529,9 @@ void test_rangeproof(void) {
             len = 5134;
             CHECK(secp256k1_rangeproof_sign(ctx, proof, &len, v, commit, blind, commit, -1, 64, v));
             CHECK(len <= 73);
+            CHECK(secp256k1_rangeproof_cost_estimate(ctx, &cost, v, -1, 64, v));
+            CHECK(cost.plen == len && cost.exp == -1 && cost.verify_ecmults == 1);
+            test_rangeproof_peek(proof, len);
             CHECK(secp256k1_rangeproof_rewind(ctx, blindout, &vout, NULL, NULL, commit, &minv, &maxv, commit, proof, len));
             CHECK(memcmp(blindout, blind, 32) == 0);
             CHECK(vout == v);
@@ -2503,7 +4549,12 @@ void test_rangeproof(void) {
         CHECK(len <= 5134);
         CHECK(minv <= v);
         CHECK(maxv >= v);
+        CHECK(secp256k1_rangeproof_verify_scratch(ctx, scratch, &minv, &maxv, commit, proof, len));
+        CHECK(!secp256k1_rangeproof_verify_scratch(ctx, small, &minv, &maxv, commit, proof, len));
+        CHECK(secp256k1_scratch_checkpoint(scratch) == 0);
     }
+    secp256k1_scratch_space_destroy(scratch);
+    secp256k1_scratch_space_destroy(small);
     secp256k1_rand256(blind);
     {
         /*Malleability test.*/
@@ -2553,8 +4604,34 @@ void test_rangeproof(void) {
         CHECK(vout == v);
         CHECK(minv <= v);
         CHECK(maxv >= v);
+        /* The estimate predicts the proof exactly. */
+        CHECK(secp256k1_rangeproof_cost_estimate(ctx, &cost, vmin, exp, min_bits, v));
+        CHECK(cost.plen == len);
+        CHECK(cost.min_value == minv && cost.max_value == maxv);
+        CHECK(secp256k1_rangeproof_info(ctx, &k, &j, &minv, &maxv, proof, len));
+        CHECK(cost.exp == k && cost.mantissa == j);
+        CHECK(cost.verify_ecmults == (j == 0 ? 1 : (j >> 1) * 4 + (j & 1) * 2));
         CHECK(secp256k1_rangeproof_rewind(ctx, blindout, &vout, NULL, NULL, commit, &minv, &maxv, commit, proof, len));
+        CHECK(secp256k1_pedersen_commit_ex(ctx, &pcommit, blind, v));
+        CHECK(secp256k1_pedersen_commitment_serialize(ctx, commit3, &pcommit));
+        CHECK(memcmp(commit3, commit, 33) == 0);
+        CHECK(secp256k1_rangeproof_verify_ex(ctx, &minv, &maxv, &pcommit, proof, len));
+        CHECK(minv <= v);
+        CHECK(maxv >= v);
+        memset(blindout, 0, 32);
+        CHECK(secp256k1_rangeproof_rewind_ex(ctx, blindout, &vout, NULL, NULL, commit, &minv, &maxv, &pcommit, proof, len));
+        CHECK(memcmp(blindout, blind, 32) == 0);
+        CHECK(vout == v);
+        CHECK(secp256k1_pedersen_commit_ex(ctx, &pcommit, blind, v + 1));
+        CHECK(!secp256k1_rangeproof_verify_ex(ctx, &minv, &maxv, &pcommit, proof, len));
         memcpy(commit2, commit, 33);
+        test_rangeproof_peek(proof, len);
+        /* With any other nonce the rewind fails (normally already in the precheck), and recovers no message. */
+        memcpy(message, commit, 32);
+        message[secp256k1_rand32() % 32] ^= 1 + (secp256k1_rand32() % 255);
+        mlen = 4096;
+        CHECK(!secp256k1_rangeproof_rewind(ctx, blindout, &vout, message + 32, &mlen, message, &minv, &maxv, commit, proof, len));
+        CHECK(mlen == 0);
     }
     for (j = 0; j < 10; j++) {
         for (i = 0; i < 96; i++) {
@@ -2569,6 +4646,104 @@ void test_rangeproof(void) {
     }
 }
 
+void test_rangeproof_choose_params(void) {
+    secp256k1_rangeproof_cost cost;
+    secp256k1_rangeproof_cost other;
+    unsigned char commit[33];
+    unsigned char proof[5134];
+    unsigned char blind[32];
+    uint64_t v;
+    uint64_t vmin;
+    uint64_t minv;
+    uint64_t maxv;
+    int objective;
+    int max_exp;
+    int min_bits;
+    int len;
+    int exp;
+
+    v = secp256k1_rands64(0, UINT64_MAX >> (secp256k1_rand32() & 63));
+    vmin = 0;
+    if (v < INT64_MAX && (secp256k1_rand32() & 1)) {
+        vmin = secp256k1_rands64(0, v);
+    }
+    max_exp = secp256k1_rand32() % 19;
+    min_bits = secp256k1_rand32() % 65;
+    CHECK(!secp256k1_rangeproof_choose_params(ctx, &cost, vmin, max_exp, min_bits, v, 2));
+    CHECK(secp256k1_rangeproof_choose_params(ctx, &cost, v, -1, min_bits, v, SECP256K1_RANGEPROOF_MINIMIZE_SIZE));
+    CHECK(cost.exp == -1 && cost.min_value == v && cost.max_value == v);
+    secp256k1_rand256(blind);
+    CHECK(secp256k1_pedersen_commit(ctx, commit, blind, v));
+    for (objective = SECP256K1_RANGEPROOF_MINIMIZE_SIZE; objective <= SECP256K1_RANGEPROOF_MINIMIZE_VERIFY; objective++) {
+        CHECK(secp256k1_rangeproof_choose_params(ctx, &cost, vmin, max_exp, min_bits, v, objective));
+        CHECK(cost.exp >= 0 && cost.exp <= max_exp);
+        /* No allowed exponent does better on the objective. */
+        for (exp = 0; exp <= max_exp; exp++) {
+            CHECK(secp256k1_rangeproof_cost_estimate(ctx, &other, vmin, exp, min_bits, v));
+            if (objective == SECP256K1_RANGEPROOF_MINIMIZE_SIZE) {
+                CHECK(cost.plen <= other.plen);
+            } else {
+                CHECK(cost.verify_ecmults <= other.verify_ecmults);
+            }
+        }
+        len = 5134;
+        CHECK(secp256k1_rangeproof_sign_optimal(ctx, proof, &len, vmin, commit, blind, commit, max_exp, min_bits, v, objective));
+        CHECK(len == cost.plen);
+        CHECK(secp256k1_rangeproof_verify(ctx, &minv, &maxv, commit, proof, len));
+        CHECK(minv == cost.min_value && maxv == cost.max_value);
+        CHECK(minv <= v && maxv >= v);
+    }
+}
+
+void test_rangeproof_context_build(void) {
+    secp256k1_rangeproof_context_t rctx;
+    secp256k1_ge_t ge;
+    secp256k1_gej_t g2j;
+    secp256k1_gej_t r;
+    secp256k1_scalar_t s;
+    secp256k1_scalar_t ten;
+    secp256k1_scalar_t zero;
+    unsigned char b32[32];
+    uint64_t mult;
+    int segments;
+    int i;
+    int j;
+    int e;
+
+    /* Segments can be computed in any order. */
+    secp256k1_rangeproof_context_init(&rctx);
+    segments = secp256k1_rangeproof_context_build_alloc(&rctx, NULL);
+    for (i = segments - 1; i >= 0; i--) {
+        secp256k1_rangeproof_context_build_segment(&rctx, i);
+    }
+    CHECK(secp256k1_rangeproof_context_is_built(&rctx));
+    CHECK(memcmp(*rctx.prec, *ctx->rangeproof_ctx.prec, sizeof(*rctx.prec)) == 0);
+    secp256k1_rangeproof_context_clear(&rctx, NULL);
+
+    /* Entry e of segment i is (e % 3 + 1) * 4^(e / 3) * -10^i * G2. */
+    secp256k1_gej_set_ge(&g2j, &secp256k1_ge_const_g2);
+    secp256k1_scalar_set_int(&zero, 0);
+    secp256k1_scalar_set_int(&ten, 10);
+    secp256k1_scalar_set_int(&s, 1);
+    secp256k1_scalar_negate(&s, &s);
+    for (i = 0; i < 19; i++) {
+        secp256k1_scalar_t sm;
+        secp256k1_scalar_t m;
+        e = secp256k1_rand32() % (secp256k1_rangeproof_offsets[i + 1] - secp256k1_rangeproof_offsets[i]);
+        mult = (uint64_t)(e % 3 + 1) << (2 * (e / 3));
+        memset(b32, 0, 24);
+        for (j = 0; j < 8; j++) {
+            b32[24 + j] = mult >> (56 - 8 * j);
+        }
+        secp256k1_scalar_set_b32(&m, b32, NULL);
+        secp256k1_scalar_mul(&sm, &s, &m);
+        secp256k1_ecmult(&ctx->ecmult_ctx, &r, &g2j, &sm, &zero);
+        secp256k1_ge_from_storage(&ge, &(*ctx->rangeproof_ctx.prec)[secp256k1_rangeproof_offsets[i] + e]);
+        ge_equals_gej(&ge, &r);
+        secp256k1_scalar_mul(&s, &s, &ten);
+    }
+}
+
 void run_borromean(void) {
     int i;
     for (i = 0; i < 10*count; i++) {
@@ -2576,8 +4751,394 @@ void run_borromean(void) {
     }
 }
 
+void test_rangeproof_verify_batch(void) {
+    unsigned char commits[8][33];
+    unsigned char proofs[8][5134];
+    unsigned char blind[32];
+    const unsigned char *commitp[8];
+    const unsigned char *proofp[8];
+    int plens[8];
+    uint64_t minv[8];
+    uint64_t maxv[8];
+    uint64_t minv1;
+    uint64_t maxv1;
+    uint64_t v;
+    int i;
+    int n;
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 8 * SECP256K1_RANGEPROOF_SCRATCH_SIZE);
+    secp256k1_scratch_space *single = secp256k1_scratch_space_create(ctx, SECP256K1_RANGEPROOF_SCRATCH_SIZE);
+    secp256k1_scratch_space *tiny = secp256k1_scratch_space_create(ctx, 64);
+
+    n = 1 + secp256k1_rand32() % 8;
+    for (i = 0; i < n; i++) {
+        int exp = (int)secp256k1_rands64(0, 19) - 1;
+        int min_bits = (int)secp256k1_rands64(0, 64);
+        v = secp256k1_rands64(0, INT64_MAX >> (secp256k1_rand32() & 63));
+        secp256k1_rand256(blind);
+        CHECK(secp256k1_pedersen_commit(ctx, commits[i], blind, v));
+        plens[i] = 5134;
+        CHECK(secp256k1_rangeproof_sign(ctx, proofs[i], &plens[i], secp256k1_rands64(0, v), commits[i], blind, commits[i], exp, min_bits, v));
+        commitp[i] = commits[i];
+        proofp[i] = proofs[i];
+    }
+    CHECK(secp256k1_rangeproof_verify_batch(ctx, scratch, commitp, proofp, plens, 0, minv, maxv));
+    CHECK(secp256k1_rangeproof_verify_batch(ctx, scratch, commitp, proofp, plens, n, minv, maxv));
+    CHECK(secp256k1_scratch_checkpoint(scratch) == 0);
+    CHECK(secp256k1_rangeproof_verify_batch(ctx, single, commitp, proofp, plens, n, minv, maxv));
+    for (i = 0; i < n; i++) {
+        CHECK(secp256k1_rangeproof_verify(ctx, &minv1, &maxv1, commits[i], proofs[i], plens[i]));
+        CHECK(minv[i] == minv1);
+        CHECK(maxv[i] == maxv1);
+    }
+    CHECK(!secp256k1_rangeproof_verify_batch(ctx, tiny, commitp, proofp, plens, n, minv, maxv));
+
+    /* A proof checked against the wrong commitment, or any single bad proof, fails the batch. */
+    if (n > 1) {
+        commitp[0] = commits[1];
+        CHECK(!secp256k1_rangeproof_verify_batch(ctx, scratch, commitp, proofp, plens, n, minv, maxv));
+        commitp[0] = commits[0];
+    }
+    i = secp256k1_rand32() % n;
+    proofs[i][plens[i] - 1 - secp256k1_rand32() % 32] ^= 1 + (secp256k1_rand32() & 127);
+    CHECK(!secp256k1_rangeproof_verify_batch(ctx, scratch, commitp, proofp, plens, n, minv, maxv));
+    CHECK(!secp256k1_rangeproof_verify_batch(ctx, single, commitp, proofp, plens, n, minv, maxv));
+    CHECK(secp256k1_scratch_checkpoint(scratch) == 0);
+    CHECK(secp256k1_rangeproof_verify_batch(ctx, scratch, commitp, proofp, plens, i, minv, maxv));
+
+    secp256k1_scratch_space_destroy(scratch);
+    secp256k1_scratch_space_destroy(single);
+    secp256k1_scratch_space_destroy(tiny);
+}
+
+void test_ct_transaction_verify(void) {
+    unsigned char commits[8][33];
+    unsigned char blinds[8][32];
+    unsigned char proofs[4][5134];
+    const unsigned char *commitp[8];
+    const unsigned char *blindp[8];
+    const unsigned char *proofp[4];
+    int plens[4];
+    uint64_t values[8];
+    uint64_t minv[4];
+    uint64_t maxv[4];
+    uint64_t minv1;
+    uint64_t maxv1;
+    uint64_t total = 0;
+    uint64_t fee;
+    int ninputs = 1 + secp256k1_rand32() % 4;
+    int noutputs = 1 + secp256k1_rand32() % 4;
+    int i;
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, SECP256K1_CT_TRANSACTION_SCRATCH_SIZE(4));
+    secp256k1_scratch_space *tiny = secp256k1_scratch_space_create(ctx, 64);
+
+    /* Inputs come first in commits, followed by the outputs, whose values add up to the inputs' minus the fee. */
+    for (i = 0; i < ninputs; i++) {
+        values[i] = secp256k1_rand32();
+        total += values[i];
+    }
+    fee = secp256k1_rands64(0, total);
+    total -= fee;
+    for (i = 0; i < noutputs; i++) {
+        values[ninputs + i] = total;
+        if (i < noutputs - 1) {
+            values[ninputs + i] = secp256k1_rands64(0, total);
+        }
+        total -= values[ninputs + i];
+    }
+    for (i = 0; i < ninputs + noutputs; i++) {
+        blindp[i] = blinds[i];
+        commitp[i] = commits[i];
+        if (i < ninputs + noutputs - 1) {
+            secp256k1_rand256(blinds[i]);
+        } else {
+            CHECK(secp256k1_pedersen_blind_sum(ctx, blinds[i], blindp, i, ninputs));
+        }
+        CHECK(secp256k1_pedersen_commit(ctx, commits[i], blinds[i], values[i]));
+    }
+    for (i = 0; i < noutputs; i++) {
+        plens[i] = 5134;
+        CHECK(secp256k1_rangeproof_sign(ctx, proofs[i], &plens[i], 0, commits[ninputs + i], blinds[ninputs + i], commits[ninputs + i],
+         0, 0, values[ninputs + i]));
+        proofp[i] = proofs[i];
+    }
+
+    CHECK(secp256k1_ct_transaction_verify(ctx, scratch, commitp, ninputs, &commitp[ninputs], noutputs, fee, proofp, plens, minv, maxv));
+    CHECK(secp256k1_scratch_checkpoint(scratch) == 0);
+    for (i = 0; i < noutputs; i++) {
+        CHECK(secp256k1_rangeproof_verify(ctx, &minv1, &maxv1, commits[ninputs + i], proofs[i], plens[i]));
+        CHECK(minv[i] == minv1);
+        CHECK(maxv[i] == maxv1);
+    }
+    CHECK(secp256k1_pedersen_verify_tally(ctx, commitp, ninputs, &commitp[ninputs], noutputs, fee));
+    CHECK(!secp256k1_ct_transaction_verify(ctx, scratch, commitp, ninputs, &commitp[ninputs], noutputs, fee + 1, proofp, plens, minv, maxv));
+    CHECK(!secp256k1_ct_transaction_verify(ctx, tiny, commitp, ninputs, &commitp[ninputs], noutputs, fee, proofp, plens, minv, maxv));
+    /* Dropping an input unbalances the transaction. */
+    if (ninputs > 1) {
+        CHECK(!secp256k1_ct_transaction_verify(ctx, scratch, commitp, ninputs - 1, &commitp[ninputs], noutputs, fee, proofp, plens, minv, maxv));
+    }
+    /* A balanced transaction with swapped, or corrupted, proofs fails. */
+    if (noutputs > 1) {
+        proofp[0] = proofs[1];
+        CHECK(!secp256k1_ct_transaction_verify(ctx, scratch, commitp, ninputs, &commitp[ninputs], noutputs, fee, proofp, plens, minv, maxv));
+        proofp[0] = proofs[0];
+    }
+    i = secp256k1_rand32() % noutputs;
+    proofs[i][plens[i] - 1 - secp256k1_rand32() % 32] ^= 1 + (secp256k1_rand32() & 127);
+    CHECK(!secp256k1_ct_transaction_verify(ctx, scratch, commitp, ninputs, &commitp[ninputs], noutputs, fee, proofp, plens, minv, maxv));
+    CHECK(secp256k1_scratch_checkpoint(scratch) == 0);
+    /* Without outputs, the inputs must balance against the excess alone. */
+    CHECK(secp256k1_ct_transaction_verify(ctx, scratch, commitp, 0, NULL, 0, 0, NULL, NULL, NULL, NULL));
+
+    secp256k1_scratch_space_destroy(scratch);
+    secp256k1_scratch_space_destroy(tiny);
+}
+
+void test_verify_pool(void) {
+    secp256k1_ecdsa_signature sigs[8];
+    secp256k1_pubkey pubkeys[8];
+    unsigned char msgs[8][32];
+    unsigned char privkey[32];
+    unsigned char blinds[2][32];
+    unsigned char commits[3][33];
+    const unsigned char *cptr[2];
+    unsigned char proof[5134];
+    int plen;
+    uint64_t minv;
+    uint64_t maxv;
+    secp256k1_scalar_t key;
+    secp256k1_verify_pool *pool;
+    secp256k1_scratch_space *scratch;
+    size_t failed;
+    size_t i;
+    size_t bad;
+
+    for (i = 0; i < 8; i++) {
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msgs[i]);
+        CHECK(secp256k1_ec_pubkey_create_ex(ctx, &pubkeys[i], privkey) == 1);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sigs[i], msgs[i], privkey, NULL, NULL) == 1);
+    }
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(blinds[0], &key);
+    memcpy(blinds[1], blinds[0], 32);
+    CHECK(secp256k1_pedersen_commit(ctx, commits[0], blinds[0], 3));
+    CHECK(secp256k1_pedersen_commit(ctx, commits[1], blinds[1], 3));
+    CHECK(secp256k1_pedersen_commit(ctx, commits[2], blinds[1], 4));
+    cptr[0] = commits[0];
+    cptr[1] = commits[1];
+    plen = 5134;
+    CHECK(secp256k1_rangeproof_sign(ctx, proof, &plen, 0, commits[0], blinds[0], commits[0], 0, 0, 3));
+
+    pool = secp256k1_verify_pool_create(ctx, 10);
+    scratch = secp256k1_scratch_space_create(ctx, SECP256K1_RANGEPROOF_SCRATCH_SIZE);
+    CHECK(secp256k1_verify_pool_result(pool, &failed) == 1);
+    CHECK(failed == 0);
+    for (i = 0; i < 8; i++) {
+        CHECK(secp256k1_verify_pool_submit_ecdsa(pool, &sigs[i], msgs[i], &pubkeys[i]) == 1);
+    }
+    CHECK(secp256k1_verify_pool_submit_rangeproof(pool, &minv, &maxv, commits[0], proof, plen) == 1);
+    CHECK(secp256k1_verify_pool_submit_tally(pool, &cptr[0], 1, &cptr[1], 1, 0) == 1);
+    CHECK(secp256k1_verify_pool_submit_tally(pool, &cptr[0], 1, &cptr[1], 1, 0) == 0);
+    /* Nothing is verified until some thread works on the pool. */
+    CHECK(secp256k1_verify_pool_result(pool, NULL) == 0);
+    secp256k1_verify_pool_work(pool, scratch);
+    secp256k1_verify_pool_work(pool, NULL);
+    CHECK(secp256k1_verify_pool_result(pool, &failed) == 1);
+    CHECK(failed == 10);
+    CHECK(minv <= 3 && maxv >= 3);
+
+    /* A failing job stops the workers and is reported by its index. */
+    secp256k1_verify_pool_clear(pool);
+    bad = secp256k1_rand32() % 8;
+    msgs[bad][0] ^= 1;
+    CHECK(secp256k1_verify_pool_submit_tally(pool, &cptr[0], 1, &cptr[1], 1, 0) == 1);
+    for (i = 0; i < 8; i++) {
+        CHECK(secp256k1_verify_pool_submit_ecdsa(pool, &sigs[i], msgs[i], &pubkeys[i]) == 1);
+    }
+    CHECK(secp256k1_verify_pool_submit_rangeproof(pool, NULL, NULL, commits[2], proof, plen) == 1);
+    secp256k1_verify_pool_work(pool, NULL);
+    CHECK(secp256k1_verify_pool_result(pool, &failed) == 0);
+    CHECK(failed == bad + 1);
+    msgs[bad][0] ^= 1;
+    secp256k1_verify_pool_clear(pool);
+    CHECK(secp256k1_verify_pool_submit_rangeproof(pool, NULL, NULL, commits[2], proof, plen) == 1);
+    CHECK(secp256k1_verify_pool_submit_tally(pool, &cptr[0], 1, &cptr[1], 1, 1) == 1);
+    secp256k1_verify_pool_work(pool, scratch);
+    CHECK(secp256k1_verify_pool_result(pool, &failed) == 0);
+    CHECK(failed == 0);
+
+    secp256k1_scratch_space_destroy(scratch);
+    secp256k1_verify_pool_destroy(pool);
+}
+
+void test_verify_pool_split(void) {
+    static const size_t nparts[5] = {1, 2, 7, 32, 40};
+    unsigned char blind[32];
+    unsigned char commits[2][33];
+    unsigned char proof[5134];
+    int plen;
+    uint64_t minv;
+    uint64_t maxv;
+    uint64_t v;
+    secp256k1_scalar_t key;
+    secp256k1_verify_pool *pool;
+    size_t failed;
+    size_t i;
+    size_t j;
+    int pos;
+    unsigned char flip;
+
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(blind, &key);
+    v = secp256k1_rands64(0, UINT64_MAX);
+    CHECK(secp256k1_pedersen_commit(ctx, commits[0], blind, v));
+    CHECK(secp256k1_pedersen_commit(ctx, commits[1], blind, v + 1));
+    plen = 5134;
+    CHECK(secp256k1_rangeproof_sign(ctx, proof, &plen, 0, commits[0], blind, commits[0], 0, 64, v));
+    pool = secp256k1_verify_pool_create(ctx, 40);
+    CHECK(secp256k1_verify_pool_submit_rangeproof_split(pool, &minv, &maxv, commits[0], proof, plen, 0) == 0);
+    CHECK(secp256k1_verify_pool_submit_rangeproof_split(pool, &minv, &maxv, commits[0], proof, plen, 41) == 0);
+    for (i = 0; i < 5; i++) {
+        /* The parts of a 32-ring proof pass in any order, and the last one to finish reports the range. */
+        secp256k1_verify_pool_clear(pool);
+        minv = maxv = 0;
+        CHECK(secp256k1_verify_pool_submit_rangeproof_split(pool, &minv, &maxv, commits[0], proof, plen, nparts[i]) == 1);
+        CHECK(pool->n_jobs == (nparts[i] > 32 ? 32 : nparts[i]));
+        for (j = pool->n_jobs; j > 0; j--) {
+            CHECK(minv == 0 && maxv == 0);
+            CHECK(secp256k1_verify_job_run(ctx, NULL, &pool->jobs[j - 1]));
+        }
+        CHECK(minv == 0 && maxv == UINT64_MAX);
+        /* A wrong commitment, or a changed s value, fails in some part. */
+        secp256k1_verify_pool_clear(pool);
+        CHECK(secp256k1_verify_pool_submit_rangeproof_split(pool, NULL, NULL, commits[1], proof, plen, nparts[i]) == 1);
+        secp256k1_verify_pool_work(pool, NULL);
+        CHECK(secp256k1_verify_pool_result(pool, &failed) == 0);
+        CHECK(failed < pool->n_jobs);
+        pos = plen - 1 - (int)(secp256k1_rand32() % (128 * 32));
+        flip = 1 + (secp256k1_rand32() % 255);
+        proof[pos] ^= flip;
+        secp256k1_verify_pool_clear(pool);
+        CHECK(secp256k1_verify_pool_submit_rangeproof_split(pool, NULL, NULL, commits[0], proof, plen, nparts[i]) == 1);
+        secp256k1_verify_pool_work(pool, NULL);
+        CHECK(secp256k1_verify_pool_result(pool, &failed) == 0);
+        proof[pos] ^= flip;
+        secp256k1_verify_pool_clear(pool);
+        CHECK(secp256k1_verify_pool_submit_rangeproof_split(pool, &minv, &maxv, commits[0], proof, plen - 1, nparts[i]) == 1);
+        CHECK(pool->n_jobs == 1);
+        secp256k1_verify_pool_work(pool, NULL);
+        CHECK(secp256k1_verify_pool_result(pool, &failed) == 0);
+        CHECK(failed == 0);
+    }
+    secp256k1_verify_pool_destroy(pool);
+}
+
+void test_verify_session(void) {
+    secp256k1_ecdsa_signature sigs[8];
+    secp256k1_pubkey pubkeys[8];
+    unsigned char msgs[8][32];
+    unsigned char privkey[32];
+    unsigned char blind[32];
+    unsigned char commits[2][33];
+    const unsigned char *cptr[2];
+    unsigned char proof[5134];
+    int plen;
+    uint64_t minv[20];
+    uint64_t maxv[20];
+    secp256k1_scalar_t key;
+    secp256k1_verify_pool *pool;
+    secp256k1_verify_session *session;
+    size_t nitems = 100 + secp256k1_rand32() % 100;
+    size_t failed;
+    size_t bad;
+    size_t i;
+    int nproofs;
+    int round;
+
+    for (i = 0; i < 8; i++) {
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msgs[i]);
+        CHECK(secp256k1_ec_pubkey_create_ex(ctx, &pubkeys[i], privkey) == 1);
+        CHECK(secp256k1_ecdsa_sign_ex(ctx, &sigs[i], msgs[i], privkey, NULL, NULL) == 1);
+    }
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(blind, &key);
+    CHECK(secp256k1_pedersen_commit(ctx, commits[0], blind, 3));
+    CHECK(secp256k1_pedersen_commit(ctx, commits[1], blind, 4));
+    cptr[0] = commits[0];
+    cptr[1] = commits[1];
+    plen = 5134;
+    CHECK(secp256k1_rangeproof_sign(ctx, proof, &plen, 0, commits[0], blind, commits[0], 0, 0, 3));
+
+    /* A stream of signatures, proofs and tallies crossing several batch boundaries, verified on the calling thread
+     * (rounds 0 and 1), on a pool (rounds 2 and 3), or partly on a pool too small for every batch (rounds 4 and 5).
+     * In the odd rounds item bad is broken; in the even ones bad is nitems and everything passes. */
+    for (round = 0; round < 6; round++) {
+        bad = round & 1 ? secp256k1_rand32() % nitems : nitems;
+        pool = round < 2 ? NULL : secp256k1_verify_pool_create(ctx, round < 4 ? 100 : 1);
+        session = secp256k1_verify_session_create(ctx, NULL, pool);
+        nproofs = 0;
+        for (i = 0; i < nitems; i++) {
+            uint32_t r = secp256k1_rand32() % 16;
+            if (r == 0 && nproofs < 20) {
+                minv[nproofs] = maxv[nproofs] = 0;
+                (void)secp256k1_verify_session_add_rangeproof(session, &minv[nproofs], &maxv[nproofs], commits[i == bad], proof, plen);
+                nproofs++;
+            } else if (r == 1) {
+                (void)secp256k1_verify_session_add_tally(session, &cptr[0], 1, &cptr[0], 1, i == bad);
+            } else {
+                msgs[i & 7][0] ^= i == bad;
+                (void)secp256k1_verify_session_add_ecdsa(session, &sigs[i & 7], msgs[i & 7], &pubkeys[i & 7]);
+                msgs[i & 7][0] ^= i == bad;
+            }
+        }
+        if (pool == NULL) {
+            CHECK(secp256k1_verify_session_finish(session) == (bad == nitems));
+        } else {
+            (void)secp256k1_verify_session_finish(session);
+            secp256k1_verify_pool_work(pool, NULL);
+            secp256k1_verify_pool_work(pool, NULL);
+        }
+        CHECK(secp256k1_verify_session_result(session, &failed) == (bad == nitems));
+        /* Earlier items whose batch was not verified yet when the failure stopped the session count as failed too. */
+        CHECK(bad == nitems ? failed == nitems : failed <= bad);
+        if (bad == nitems) {
+            while (nproofs-- > 0) {
+                CHECK(minv[nproofs] <= 3 && maxv[nproofs] >= 3);
+            }
+        }
+        secp256k1_verify_session_destroy(session);
+        secp256k1_verify_pool_destroy(pool);
+    }
+
+    /* A failure found while adding is reported right away, and an unfinished session has not verified anything. */
+    session = secp256k1_verify_session_create(ctx, NULL, NULL);
+    CHECK(secp256k1_verify_session_add_ecdsa(session, &sigs[0], msgs[0], &pubkeys[0]) == 1);
+    CHECK(secp256k1_verify_session_result(session, &failed) == 0);
+    CHECK(failed == 0);
+    CHECK(secp256k1_verify_session_add_rangeproof(session, NULL, NULL, commits[0], proof, -1) == 0);
+    CHECK(secp256k1_verify_session_add_ecdsa(session, &sigs[0], msgs[0], &pubkeys[0]) == 0);
+    CHECK(secp256k1_verify_session_finish(session) == 0);
+    CHECK(secp256k1_verify_session_result(session, &failed) == 0);
+    CHECK(failed == 0);
+    secp256k1_verify_session_destroy(session);
+    secp256k1_verify_session_destroy(NULL);
+}
+
 void run_rangeproof(void) {
+    int i;
     test_rangeproof();
+    test_rangeproof_context_build();
+    for (i = 0; i < count; i++) {
+        test_rangeproof_verify_batch();
+        test_ct_transaction_verify();
+        test_rangeproof_choose_params();
+    }
+    test_verify_pool();
+    test_verify_pool_split();
+    test_verify_session();
 }
 
 
@@ -2636,10 +5197,14 @@ int main(int argc, char **argv) {
     run_util_tests();
 
     run_pedersen();
+    run_pedersen_tally_large();
     run_borromean();
     run_rangeproof();
 
     run_sha256_tests();
+    run_sha256_x4_tests();
+    run_sha256_transform_tests();
+    run_sha256_midstate_tests();
     run_hmac_sha256_tests();
     run_rfc6979_hmac_sha256_tests();
 
@@ -2655,20 +5220,28 @@ int main(int argc, char **argv) {
     run_field_inv();
     run_field_inv_var();
     run_field_inv_all_var();
+    run_field_mul_x4();
     run_field_misc();
     run_field_convert();
     run_sqr();
     run_sqrt();
+    run_inverse_tests();
 
     /* group tests */
     run_ge();
+    run_gej_add_all_ge();
 
     /* ecmult tests */
     run_wnaf();
     run_point_times_order();
     run_ecmult_chain();
     run_ecmult_constants();
+    run_ecmult_window_tests();
+    run_scratch_tests();
+    run_ecmult_multi();
     run_ecmult_gen_blind();
+    run_ecmult_gen2_small_var();
+    run_op_counters();
 
     /* ecdh tests */
     run_ecdh_tests();
@@ -2676,8 +5249,17 @@ int main(int argc, char **argv) {
 
     /* ecdsa tests */
     run_random_pubkeys();
+    run_pubkey_parse_batch();
     run_ecdsa_sign_verify();
     run_ecdsa_end_to_end();
+    run_ecdsa_sign_keypair();
+    run_ecdsa_sign_batch();
+    run_ecdsa_verify_batch();
+    run_ecdsa_der_parse_lax();
+    run_ecdsa_verify_precomp();
+    run_cuckoo_tests();
+    run_ecdsa_verify_cached();
+    run_ecdsa_recover_batch();
     run_ecdsa_edge_cases();
 #ifdef ENABLE_OPENSSL_TESTS
     run_ecdsa_openssl();
@@ -55,6 +55,30 @@
 #define DEBUG_CHECK(cond) do { (void)(cond); } while(0)
 #endif
 
+/* Per-thread counts of hot operations, for secp256k1_debug_get_counters. Without --enable-op-counters,
+ * SECP256K1_COUNT_OP compiles to nothing. */
+#define SECP256K1_OP_FE_MUL 0
+#define SECP256K1_OP_FE_SQR 1
+#define SECP256K1_OP_FE_INV 2
+#define SECP256K1_OP_FE_INV_VAR 3
+#define SECP256K1_OP_FE_SQRT_VAR 4
+#define SECP256K1_OP_GEJ_ADD_VAR 5
+#define SECP256K1_OP_GEJ_DOUBLE_VAR 6
+#define SECP256K1_OP_ECMULT 7
+#define SECP256K1_OP_ECMULT_MULTI 8
+#define SECP256K1_OP_ECMULT_MULTI_POINTS 9
+#define SECP256K1_OP_ECMULT_GEN 10
+#define SECP256K1_OP_ECMULT_GEN2 11
+#define SECP256K1_OP_ECMULT_CONST 12
+#define SECP256K1_OP_NUM 13
+
+#ifdef ENABLE_OP_COUNTERS
+static __thread uint64_t secp256k1_op_count[SECP256K1_OP_NUM] __attribute__((unused));
+#define SECP256K1_COUNT_OP(op, n) (secp256k1_op_count[(op)] += (n))
+#else
+#define SECP256K1_COUNT_OP(op, n) ((void)0)
+#endif
+
 /* Like DEBUG_CHECK(), but when VERIFY is defined instead of NDEBUG not defined. */
 #ifdef VERIFY
 #define VERIFY_CHECK CHECK
@@ -68,6 +92,57 @@ static SECP256K1_INLINE void *checked_malloc(size_t size) {
     return ret;
 }
 
+/* The alignment of the precomputed tables: a cache line, which then holds exactly one secp256k1_ge_storage_t
+ * entry instead of parts of two. */
+#define SECP256K1_TABLE_ALIGNMENT 64
+
+#if SECP256K1_GNUC_PREREQ(3,0)
+# define SECP256K1_TABLE_ALIGNED __attribute__((aligned(SECP256K1_TABLE_ALIGNMENT)))
+#else
+# define SECP256K1_TABLE_ALIGNED
+#endif
+
+/* Hint that the memory at p will be read soon. */
+#if SECP256K1_GNUC_PREREQ(3,1)
+# define SECP256K1_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#else
+# define SECP256K1_PREFETCH(p) ((void)(p))
+#endif
+
+/* Where the precomputed tables of a context live. free is passed the size that was allocated. */
+typedef struct {
+    void *(*alloc)(size_t size, void *data);
+    void (*free)(void *ptr, size_t size, void *data);
+    void *data;
+} secp256k1_allocator_t;
+
+/* Like checked_malloc, but with alloc unless that is NULL. Without alloc, the memory is aligned to
+ * SECP256K1_TABLE_ALIGNMENT, with the pointer malloc returned stored just below it. */
+static SECP256K1_INLINE void *secp256k1_allocator_malloc(const secp256k1_allocator_t *alloc, size_t size) {
+    unsigned char *raw, *ret;
+    if (alloc == NULL) {
+        raw = (unsigned char *)checked_malloc(size + sizeof(void *) + SECP256K1_TABLE_ALIGNMENT - 1);
+        ret = raw + sizeof(void *);
+        ret += (SECP256K1_TABLE_ALIGNMENT - (size_t)ret % SECP256K1_TABLE_ALIGNMENT) % SECP256K1_TABLE_ALIGNMENT;
+        ((void **)ret)[-1] = raw;
+        return ret;
+    }
+    ret = (unsigned char *)alloc->alloc(size, alloc->data);
+    CHECK(ret != NULL);
+    return ret;
+}
+
+static SECP256K1_INLINE void secp256k1_allocator_free(const secp256k1_allocator_t *alloc, void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    if (alloc == NULL) {
+        free(((void **)ptr)[-1]);
+    } else {
+        alloc->free(ptr, size, alloc->data);
+    }
+}
+
 /* Macro for restrict, when available and not in a VERIFY build. */
 #if defined(SECP256K1_BUILD) && defined(VERIFY)
 # define SECP256K1_RESTRICT
@@ -100,6 +175,7 @@ static SECP256K1_INLINE void *checked_malloc(size_t size) {
 #  define SECP256K1_GNUC_EXT
 # endif
 SECP256K1_GNUC_EXT typedef unsigned __int128 uint128_t;
+SECP256K1_GNUC_EXT typedef __int128 int128_t;
 #endif
 
 /* Extract the sign of an int64, take the abs and return a uint64, constant time. */
@@ -129,5 +205,33 @@ SECP256K1_INLINE static int secp256k1_clz64_var(uint64_t x) {
 
 }
 
+/* Number of trailing zero bits of a non-zero x. */
+SECP256K1_INLINE static int secp256k1_ctz32_var(uint32_t x) {
+# if defined(HAVE_BUILTIN_CTZLL)
+    return __builtin_ctz(x);
+# else
+    static const uint8_t debruijn[32] = {
+        0x00, 0x01, 0x02, 0x18, 0x03, 0x13, 0x06, 0x19, 0x16, 0x04, 0x14, 0x0A,
+        0x10, 0x07, 0x0C, 0x1A, 0x1F, 0x17, 0x12, 0x05, 0x15, 0x09, 0x0F, 0x0B,
+        0x1E, 0x11, 0x08, 0x0E, 0x1D, 0x0D, 0x1C, 0x1B
+    };
+    return debruijn[(uint32_t)((x & -x) * 0x04D7651FU) >> 27];
+# endif
+}
+
+SECP256K1_INLINE static int secp256k1_ctz64_var(uint64_t x) {
+# if defined(HAVE_BUILTIN_CTZLL)
+    return __builtin_ctzll(x);
+# else
+    static const uint8_t debruijn[64] = {
+        0, 1, 2, 53, 3, 7, 54, 27, 4, 38, 41, 8, 34, 55, 48, 28,
+        62, 5, 39, 46, 44, 42, 22, 9, 24, 35, 59, 56, 49, 18, 29, 11,
+        63, 52, 6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+        51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12
+    };
+    return debruijn[(uint64_t)((x & -x) * 0x022FDD63CC95386DULL) >> 58];
+# endif
+}
+
 
 #endif